@@ -0,0 +1,132 @@
+#ifndef _I_FUSELIB_BINLOG_H_
+#define _I_FUSELIB_BINLOG_H_
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include <stdint.h>
+#include <time.h>
+#include <sys/types.h>
+
+#include <pthread.h>
+
+// binary trace files, one per rollover
+#define BINLOG_PATH_FMT                 "irods.trace.XXXXXX"
+#define BINLOG_MAGIC                    "IRFSTRC1"
+#define BINLOG_VERSION                  1
+#define BINLOG_BLOCK_MAGIC              0x4B4C4254      // "TBLK"
+
+#define BINLOG_RING_SIZE                4096            // records per thread, a power of 2
+#define BINLOG_BLOCK_RECORDS            4096            // records per block in the file
+#define BINLOG_DRAIN_INTERVAL_MS        100
+#define BINLOG_DEFAULT_MAX_RECORDS      1048576         // records per file before rolling over
+#define BINLOG_DEFAULT_MAX_RECORDS_STR  "1048576"
+
+// one traced operation, as filled in by the thread that ran it
+struct binlog_record {
+   uint64_t start_ns;                   // CLOCK_MONOTONIC
+   uint64_t path_hash;                  // keyed hash of the path, the new one for symlink and link
+   uint64_t size;
+   int64_t offset;                      // flags for open, isdatasync for fsync
+   uint32_t duration_us;
+   int32_t rc;
+   uint32_t tid;
+   uint8_t op;                          // bit number of the TRACE_* method
+};
+
+// file layout: a header, then blocks of up to BINLOG_BLOCK_RECORDS records.
+// a block stores each field of its records as one column, in the order
+// start_ns, duration_us, op, tid, rc, path_hash, size, offset.
+struct binlog_file_header {
+   char magic[8];                       // BINLOG_MAGIC
+   uint32_t version;
+   uint32_t record_size;                // sizeof(struct binlog_record), also tells the byte order
+   uint64_t start_realtime_ns;          // CLOCK_REALTIME and CLOCK_MONOTONIC at the same moment,
+   uint64_t start_monotonic_ns;         // to turn start_ns into wall clock time
+};
+
+struct binlog_block_header {
+   uint32_t magic;                      // BINLOG_BLOCK_MAGIC
+   uint32_t num_records;
+   uint64_t dropped;                    // records lost to full rings since the last block
+};
+
+// single producer (the owning thread), single consumer (the drain thread)
+struct binlog_ring {
+   struct binlog_record records[BINLOG_RING_SIZE];
+   volatile uint64_t head;              // next slot to fill, written by the owner
+   volatile uint64_t tail;              // next slot to drain, written by the drain thread
+   volatile uint64_t dropped;           // written by the owner
+   uint64_t dropped_drained;            // read by the drain thread so far
+   uint32_t tid;
+   int exited;                          // the owner is gone, free once drained
+   struct binlog_ring* next;
+};
+
+struct binlog_context {
+
+   pthread_t drain_thread;
+   pthread_mutex_t lock;                // govern rings, the file and running
+   pthread_cond_t cond;                 // for waking up the drain thread
+   pthread_key_t ring_key;              // each thread's ring
+
+   struct binlog_ring* rings;
+
+   FILE* logfile;                       // current open trace file
+   char* logfile_dir;                   // directory in which to create trace files
+   char* logfile_path;                  // path to the current open trace file
+   uint64_t num_records;                // records in the current file
+   uint64_t max_records;                // records per file before rolling over
+
+   uint64_t hash_key[2];                // siphash key derived from the path salt
+
+   uint64_t methods;                    // bitfield of which methods to log
+   int running;                         // set to 1 if the drain thread is running; 0 otherwise
+
+   // block being filled by the drain thread, one array per column
+   uint32_t block_len;
+   uint64_t block_dropped;
+   uint64_t* block_start_ns;
+   uint32_t* block_duration_us;
+   uint8_t* block_op;
+   uint32_t* block_tid;
+   int32_t* block_rc;
+   uint64_t* block_path_hash;
+   uint64_t* block_size;
+   int64_t* block_offset;
+};
+
+// time, trace, and return the result of call, if method is traced
+#define binlog_call( ctx, method, path, size, offset, call ) \
+   do { \
+      if( ((ctx)->methods & (method)) == 0 ) { \
+         return call; \
+      } \
+      uint64_t _start_ns = binlog_now(); \
+      int _rc = call; \
+      binlog_record( ctx, method, path, size, offset, _start_ns, _rc ); \
+      return _rc; \
+   } while(0)
+
+#ifdef  __cplusplus
+extern "C" {
+#endif
+
+struct binlog_context* binlog_init( uint64_t methods, uint64_t max_records, char const* log_path_salt, char const* log_dir );
+int binlog_free( struct binlog_context* ctx );
+int binlog_start_threads( struct binlog_context* ctx );
+int binlog_stop_threads( struct binlog_context* ctx );
+
+uint64_t binlog_now(void);
+uint64_t binlog_hash_path( struct binlog_context* ctx, char const* path );
+void binlog_record( struct binlog_context* ctx, uint64_t method, char const* path, uint64_t size, int64_t offset, uint64_t start_ns, int rc );
+
+int binlog_drain( struct binlog_context* ctx );
+void* binlog_drain_thread( void* arg );
+
+#ifdef  __cplusplus
+}
+#endif
+
+#endif
@@ -0,0 +1,91 @@
+/*** For more information please refer to files in the COPYRIGHT directory ***/
+
+#ifndef I_FUSE_LIB_BLOCK_CACHE_H
+#define I_FUSE_LIB_BLOCK_CACHE_H
+
+#include "rodsClient.h"
+#include "rodsPath.h"
+#include "iFuseLib.h"
+#include "iFuseLib.Lock.h"
+
+#define FUSE_BLOCK_CACHE_DIR  "/tmp/fuseBlockCache"
+
+#define BLOCK_CACHE_DEFAULT_BLOCK_SIZE  (4*1024*1024)   /* 4 mb */
+#define BLOCK_CACHE_DATA_EXT            ".blk"          /* sparse copy of the object */
+#define BLOCK_CACHE_MAP_EXT             ".blkmap"       /* header + bitmap of blocks present */
+#define BLOCK_CACHE_MAP_MAGIC           0x69424331      /* "iBC1" */
+#define NUM_BLOCK_CACHE_HASH_SLOT       201
+
+typedef struct BlockCacheConfig {
+    int blockCache;
+    int clearCache;
+    char *cachePath;
+    rodsLong_t blockSize;
+    rodsLong_t cacheMaxSize; /* 0 means unlimited */
+} blockCacheConfig_t;
+
+/* stored at the beginning of the map file, the bitmap follows.
+ * a cached copy is valid only for the size and mtime it was fetched for */
+typedef struct BlockCacheMapHeader {
+    unsigned int magic;
+    unsigned int reserved;
+    rodsLong_t blockSize;
+    rodsLong_t fileSize;
+    rodsLong_t mtime;
+    rodsLong_t numBlocks;
+} blockCacheMapHeader_t;
+
+typedef struct BlockCache {
+    char *path;                 /* iRODS path, the hash key */
+    rodsLong_t fileSize;
+    time_t mtime;
+    rodsLong_t numBlocks;
+    rodsLong_t numCachedBlocks;
+    unsigned char *bitmap;      /* NULL while the cache is not opened */
+    unsigned char *fetching;    /* blocks a reader is fetching right now */
+    int dataFd;
+    int mapFd;
+    int refCount;               /* open descriptors */
+    int invalid;                /* removed while opened */
+    time_t lastAccess;
+    pthread_mutex_t lock;
+    pthread_cond_t cond;
+} blockCache_t;
+
+typedef struct BlockCacheStats {
+    rodsLong_t hits;            /* reads served from local blocks only */
+    rodsLong_t misses;          /* reads that fetched at least one block */
+    rodsLong_t fetchedBytes;
+    rodsLong_t cachedBytes;     /* current, over all files */
+    rodsLong_t evictions;       /* files evicted to stay under cacheMaxSize */
+} blockCacheStats_t;
+
+/* reads size bytes at offset from the server, returns bytes read or an error */
+typedef int (*blockCacheFetch_t) (void *arg, char *buf, size_t size, off_t offset);
+
+#ifdef  __cplusplus
+extern "C" {
+#endif
+
+int
+initBlockCache (blockCacheConfig_t *blockCacheConfig, rodsEnv *myRodsEnv);
+int
+uninitBlockCache (blockCacheConfig_t *blockCacheConfig);
+int
+isBlockCacheEnabled ();
+blockCache_t *
+openBlockCache (const char *path, struct stat *stbuf);
+int
+readBlockCache (blockCache_t *blockCache, char *buf, size_t size, off_t offset, blockCacheFetch_t fetch, void *fetchArg);
+int
+closeBlockCache (blockCache_t *blockCache);
+int
+invalidateBlockCache (const char *path);
+int
+getBlockCacheStats (blockCacheStats_t *stats);
+
+#ifdef  __cplusplus
+}
+#endif
+
+#endif	/* I_FUSE_LIB_BLOCK_CACHE_H */
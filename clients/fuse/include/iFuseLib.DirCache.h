@@ -0,0 +1,81 @@
+/*** For more information please refer to files in the COPYRIGHT directory ***/
+
+#ifndef I_FUSE_LIB_DIR_CACHE_H
+#define I_FUSE_LIB_DIR_CACHE_H
+
+#include <sys/stat.h>
+#include "rodsClient.h"
+#include "iFuseLib.h"
+
+#define DIR_CACHE_EXPIRE_TIME           60      /* in sec, listings of others' changes go stale */
+#define DIR_CACHE_DEFAULT_MAX_ENTRIES   200000  /* names over all cached listings */
+#define NUM_DIR_CACHE_HASH_SLOT         1021
+
+typedef struct DirCacheConfig {
+    int timeout;        /* in sec, 0 disables the directory cache */
+    int maxEntries;
+} dirCacheConfig_t;
+
+typedef struct DirCacheEntry {
+    char *name;
+    struct stat stbuf;
+} dirCacheEntry_t;
+
+/* a complete listing of one collection. it is never changed once cached,
+ * a change of the collection drops the listing */
+typedef struct DirCache {
+    char *path;
+    dirCacheEntry_t *entries;
+    int numEntries;
+    time_t cachedTime;
+    int refCount;       /* table + readers, under the global lock */
+    struct DirCache *lruPrev;   /* toward most recently used */
+    struct DirCache *lruNext;   /* toward least recently used */
+} dirCache_t;
+
+typedef struct DirCacheStats {
+    rodsLong_t listings;
+    rodsLong_t entries;
+    rodsLong_t hits;
+    rodsLong_t misses;
+    rodsLong_t expirations;
+    rodsLong_t evictions;
+    rodsLong_t invalidations;
+} dirCacheStats_t;
+
+#ifdef  __cplusplus
+extern "C" {
+#endif
+
+int
+setDirCacheConfig (dirCacheConfig_t *config);
+int
+initDirCache ();
+int
+uninitDirCache ();
+int
+isDirCacheEnabled ();
+dirCache_t *
+lookupDirCache (const char *path);
+void
+releaseDirCache (dirCache_t *dirCache);
+unsigned long
+getDirCacheGeneration ();
+int
+addDirCache (const char *path, dirCacheEntry_t *entries, int numEntries, unsigned long generation);
+void
+freeDirCacheEntries (dirCacheEntry_t *entries, int numEntries);
+int
+invalidateDirCache (const char *path);
+int
+invalidateDirCacheOfParent (const char *path);
+int
+invalidateDirCacheTree (const char *path);
+int
+getDirCacheStats (dirCacheStats_t *stats);
+
+#ifdef  __cplusplus
+}
+#endif
+
+#endif	/* I_FUSE_LIB_DIR_CACHE_H */
@@ -7,7 +7,6 @@
 #include "iFuseLib.Lock.h"
 
 #define FUSE_LAZY_UPLOAD_BUFFER_DIR  "/tmp/fuseLazyUploadBuffer"
-#define FUSE_LAZY_UPLOAD_MEM_BUFFER_SIZE    (500*1024)
 
 #ifdef USE_BOOST
 #include <boost/thread/thread.hpp>
@@ -18,17 +17,32 @@
 typedef struct LazyUploadConfig {
     int lazyUpload;
     char *bufferPath;
+    int numWorkers; /* 0 means "use default" */
+    rodsLong_t chunkSize; /* 0 means "use default" */
 } lazyUploadConfig_t;
 
 #define NUM_LAZYUPLOAD_FILE_HASH_SLOT   201
 
+#define LAZY_UPLOAD_DEFAULT_NUM_WORKERS     4
+#define LAZY_UPLOAD_DEFAULT_CHUNK_SIZE      (8*1024*1024)   /* 8 mb */
+#define LAZY_UPLOAD_CONN_IDLE_TIMEOUT       300             /* sec, idle worker connections are closed */
+
+/* buffered data is streamed to iRODS in chunks while the file is still
+ * being written. only the contiguous part of the buffer is sent, the
+ * rest waits for a flush */
 typedef struct LazyUploadFileInfo {
     char *path;
+    char *objPath;                  /* set once streaming started */
     int accmode;
     int localHandle;
     int commitCount;
-    off_t curLocalOffsetStart;
-    off_t curOffset;
+    off_t curLocalOffsetStart;      /* iRODS offset of the buffer start */
+    off_t curOffset;                /* bytes in the buffer, holes included */
+    off_t contiguousOffset;         /* iRODS offset, data below is written without holes */
+    off_t streamedOffset;           /* iRODS offset, data below is handed to the workers */
+    int streaming;                  /* the iRODS file is reopened for ranged writes */
+    int inflight;                   /* chunks queued or being sent */
+    int uploadError;                /* first error of a chunk since the last commit */
 #ifdef USE_BOOST
     boost::mutex* mutex;
 #else
@@ -36,6 +50,23 @@ typedef struct LazyUploadFileInfo {
 #endif
 } lazyUploadFileInfo_t;
 
+typedef struct LazyUploadJob {
+    lazyUploadFileInfo_t *fileInfo;
+    off_t offset;       /* in the iRODS file */
+    off_t localOffset;  /* in the buffer file */
+    size_t size;
+} lazyUploadJob_t;
+
+typedef struct LazyUploadWorker {
+#ifdef USE_BOOST
+    boost::thread* thread;
+#else
+    pthread_t thread;
+#endif
+    rcComm_t *conn;     /* kept logged in between chunks */
+    time_t lastUsed;
+} lazyUploadWorker_t;
+
 #ifdef  __cplusplus
 extern "C" {
 #endif
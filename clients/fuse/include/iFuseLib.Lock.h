@@ -5,7 +5,7 @@
 /*
  * Locking order:
  *
- * PathCacheLock (we allow getAndUseConnByPath as an exception, todo add a separate cache for this purpose
+ * PathCacheShard (we allow getAndUseConnByPath as an exception, it uses a separate cache)
  * PathCache
  * DescLock
  * iFuseDesc
@@ -38,20 +38,24 @@ typedef struct ConcurrentList {
 #ifdef USE_BOOST
 
 	#include <boost/thread/thread_time.hpp>
-	extern boost::mutex*             PathCacheLock;
 	extern boost::thread*            ConnManagerThr;
 	extern boost::mutex*             ConnManagerLock;
 	extern boost::condition_variable ConnManagerCond;
     extern boost::mutex*             PreloadLock;
+    extern boost::condition_variable PreloadCond;
+    extern boost::mutex*             PreloadFileHandleLock;
     extern boost::mutex*             LazyUploadLock;
+    extern boost::condition_variable LazyUploadCond;
 #else
 	#include <pthread.h>
-	extern pthread_mutex_t PathCacheLock;
 	extern pthread_t ConnManagerThr;
 	extern pthread_mutex_t ConnManagerLock;
 	extern pthread_cond_t ConnManagerCond;
     extern pthread_mutex_t PreloadLock;
+    extern pthread_cond_t PreloadCond;
+    extern pthread_mutex_t PreloadFileHandleLock;
     extern pthread_mutex_t LazyUploadLock;
+    extern pthread_cond_t LazyUploadCond;
 #endif
 
 #ifdef USE_BOOST
@@ -64,6 +68,7 @@ typedef struct ConcurrentList {
 	    (Lock) = 0;
 
 #define LOCK_STRUCT(s) LOCK(((s).mutex))
+#define TRYLOCK_STRUCT(s) ((s).mutex->try_lock() ? 0 : -1)
 #define UNLOCK_STRUCT(s) UNLOCK(((s).mutex))
 #define FREE_STRUCT_LOCK(s) \
 	FREE_LOCK((s).mutex);
@@ -73,6 +78,8 @@ typedef struct ConcurrentList {
 	void initConnReqWaitMutex(connReqWait_t *myConnReqWait);
 	void deleteConnReqWaitMutex(connReqWait_t *myConnReqWait);
 	void timeoutWait(boost::mutex **ConnManagerLock, boost::condition_variable *ConnManagerCond, int sleepTime);
+	void waitConnReq(connReqWait_t *myConnReqWait);
+	void notifyConnReq(connReqWait_t *myConnReqWait);
 	void notifyTimeoutWait(boost::mutex **ConnManagerLock, boost::condition_variable *ConnManagerCond);
 #else
 #ifdef FUSE_DEBUG
@@ -91,6 +98,7 @@ typedef struct ConcurrentList {
 #define INIT_STRUCT_LOCK(s) INIT_LOCK((s).lock)
 #define INIT_LOCK(s) (pthread_mutex_init (&(s), NULL))
 #define LOCK_STRUCT(s) LOCK((s).lock)
+#define TRYLOCK_STRUCT(s) (pthread_mutex_trylock (&((s).lock)))
 #define UNLOCK_STRUCT(s) UNLOCK((s).lock)
 #define FREE_STRUCT_LOCK(s) FREE_LOCK((s).lock)
 #define FREE_LOCK(s) pthread_mutex_destroy (&(s))
@@ -100,6 +108,8 @@ typedef struct ConcurrentList {
 	void initConnReqWaitMutex(connReqWait_t *myConnReqWait);
 	void deleteConnReqWaitMutex(connReqWait_t *myConnReqWait);
 	void timeoutWait(pthread_mutex_t *ConnManagerLock, pthread_cond_t *ConnManagerCond, int sleepTime);
+	void waitConnReq(connReqWait_t *myConnReqWait);
+	void notifyConnReq(connReqWait_t *myConnReqWait);
 	void notifyTimeoutWait(pthread_mutex_t *mutex, pthread_cond_t *cond);
 #endif
 
@@ -113,8 +123,6 @@ typedef struct ConcurrentList {
 #endif
 
 extern rodsEnv MyRodsEnv;
-extern iFuseDesc_t IFuseDesc[MAX_IFUSE_DESC];
-extern concurrentList_t *IFuseDescFreeList;
 
 #define UNREF(s, t) \
 	if(s != NULL) { \
@@ -150,7 +158,7 @@ extern concurrentList_t *IFuseDescFreeList;
 
 fileCache_t *newFileCache(int iFd, char *objPath, char *localPath, char *cacheFilePath, time_t cachedTime, int mode, rodsLong_t fileCache, cacheState_t state);
 pathCache_t *newPathCache (char *inPath, fileCache_t *fileCache, struct stat *stbuf, time_t cachedTime);
-iFuseConn_t *newIFuseConn(int *status);
+iFuseConn_t *newIFuseConn(struct IFuseConnPool *pool, int *status);
 iFuseDesc_t *newIFuseDesc (char *objPath, char *localPath, fileCache_t *fileCache, int *status);
 
 int _freeFileCache(fileCache_t *fileCache);
@@ -170,22 +178,32 @@ int _listSize(concurrentList_t *l);
 int listSize(concurrentList_t *l);
 
 iFuseConn_t *getAndUseConnByPath (char *localPath, int *status);
-int lookupPathNotExist(PathCacheTable *pctable, char *inPath);
+iFuseConn_t *getAndUseConnByHost (char *host, char *localPath, int *status);
+int redirectIFuseConn (iFuseConn_t **iFuseConn, char *localPath, dataObjInp_t *dataObjInp);
+int unrefIFuseConn (iFuseConn_t *iFuseConn);
+iFuseConn_t *getAndUseConnByFileCache (fileCache_t *fileCache, int *status);
+int setFileCacheConn (fileCache_t *fileCache, iFuseConn_t *iFuseConn);
+int holdIFuseConn (iFuseConn_t *iFuseConn);
+int unholdIFuseConn (iFuseConn_t *iFuseConn);
+int useHeldIFuseConn (iFuseConn_t *iFuseConn);
 int lookupPathExist(PathCacheTable *pctable, char *inPath, pathCache_t **paca);
+int lookupPathNotExist(PathCacheTable *pctable, char *inPath);
 int matchAndLockPathCache(PathCacheTable *pctable, char *inPath, pathCache_t **outPathCache);
-int _matchAndLockPathCache(PathCacheTable *pctable, char *inPath, pathCache_t **outPathCache);
 int updatePathCacheStatFromFileCache (pathCache_t *tmpPathCache);
 int _updatePathCacheStatFromFileCache (pathCache_t *tmpPathCache);
+int _setPathCacheStat (pathCache_t *tmpPathCache, struct stat *stbuf);
 int clearPathFromCache(PathCacheTable *pctable, char *inPath);
+int clearPathNotExist(PathCacheTable *pctable, char *inPath);
 int pathNotExist(PathCacheTable *pctable, char *inPath);
 int pathExist(PathCacheTable *pctable, char *inPath, fileCache_t *fileCache, struct stat *stbuf, pathCache_t **outPathCache);
+int pathExistBatch(PathCacheTable *pctable, char **inPaths, struct stat *stbufs, int count);
 fileCache_t *addFileCache (int iFd, char *objPath, char *localPath, char *cachePath, int mode, rodsLong_t fileCache, cacheState_t state);
 int _addFileCacheForPath(pathCache_t *pathCache, fileCache_t *fileCache);
-int _pathNotExist(PathCacheTable *pctable, char *path);
-int _pathReplace(PathCacheTable *pctable, char *inPath, fileCache_t *fileCache, struct stat *stbuf, pathCache_t **outPathCache);
+int pathReplace(PathCacheTable *pctable, char *inPath, fileCache_t *fileCache, struct stat *stbuf, pathCache_t **outPathCache);
 int _getAndUseConnForPathCache(iFuseConn_t **iFuseConn, pathCache_t *paca);
 int _getAndUseIFuseConn (iFuseConn_t **iFuseConn);
 int getAndUseIFuseConn (iFuseConn_t **iFuseConn);
+int getAndUseSpareIFuseConn (iFuseConn_t **iFuseConn);
 
 int iFuseFileCacheLseek(fileCache_t *fileCache, off_t offset);
 int _iFuseFileCacheLseek(fileCache_t *fileCache, off_t offset);
@@ -194,6 +212,8 @@ int _iFuseFileCacheFlush(fileCache_t *fileCache);
 int ifuseFileCacheSwapOut (fileCache_t *fileCache);
 /* close any open files inside the file cache */
 int ifuseFileCacheClose(fileCache_t *fileCache);
+fileCache_t *getAndLockSharedFileCache(char *objPath, struct stat *stbuf);
+int shareFileCache(fileCache_t *fileCache, struct stat *stbuf);
 int getFileCachePath (const char *inPath, char *cacehPath);
 int setAndMkFileCacheDir ();
 int ifuseFileCacheWrite (fileCache_t *fileCache, char *buf, size_t size, off_t offset);
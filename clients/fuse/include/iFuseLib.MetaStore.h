@@ -0,0 +1,99 @@
+/*** For more information please refer to files in the COPYRIGHT directory ***/
+
+#ifndef I_FUSE_LIB_META_STORE_H
+#define I_FUSE_LIB_META_STORE_H
+
+#include "rodsClient.h"
+#include "rodsPath.h"
+#include "iFuseLib.h"
+#include "iFuseLib.Lock.h"
+
+#define FUSE_META_STORE_DIR  "/tmp/fuseMetaStore"
+
+#define META_STORE_EXT                  ".meta"
+#define META_STORE_MAGIC                "IRFSMETA"
+#define META_STORE_VERSION              1
+#define META_STORE_RECORD_MAGIC         0x6d524563      /* "cERm" */
+#define META_STORE_DEFAULT_TIMEOUT      3600            /* in sec */
+#define META_STORE_DEFAULT_MAX_SIZE     (256*1024*1024) /* 256 mb */
+#define META_STORE_INDEX_INIT_SLOTS     1024            /* must be a power of 2 */
+#define META_STORE_COMPACT_MIN_SIZE     (1024*1024)     /* smaller logs are not compacted */
+#define NUM_META_STORE_COLL_HASH_SLOT   201
+
+typedef struct MetaStoreConfig {
+    int metaStore;
+    char *cachePath;
+    int timeout;            /* in sec, entries older than this are not trusted alone */
+    int collCheck;          /* trust older entries of collections whose mtime is unchanged */
+    rodsLong_t maxSize;     /* of the log file */
+} metaStoreConfig_t;
+
+/* at the beginning of the log file, records follow */
+typedef struct MetaStoreHeader {
+    char magic[8];
+    unsigned int version;
+    unsigned int recordSize;    /* sizeof(metaStoreRecord_t), also tells the byte order */
+} metaStoreHeader_t;
+
+/* one appended stat of a path, the path and padding to 8 bytes follow.
+ * the latest record of a path wins, a record with cachedTime 0 tells that
+ * the path is gone */
+typedef struct MetaStoreRecord {
+    unsigned int magic;
+    unsigned int len;           /* including the path and padding */
+    unsigned int sum;           /* fnv-1a of the record with sum 0 */
+    unsigned int pathLen;
+    rodsLong_t cachedTime;      /* when the stat was got from the server */
+    rodsLong_t collMtime;       /* mtime of the parent collection at that time, 0 if unknown */
+    rodsLong_t size;
+    rodsLong_t mtime;
+    rodsLong_t ctime;
+    unsigned int mode;
+    unsigned int reserved;
+} metaStoreRecord_t;
+
+/* a parent collection stat'ed on the server in this mount */
+typedef struct MetaStoreColl {
+    time_t mtime;
+    time_t checkedTime;
+} metaStoreColl_t;
+
+typedef struct MetaStoreStats {
+    rodsLong_t hits;
+    rodsLong_t collHits;        /* older entries trusted after a collection check */
+    rodsLong_t misses;
+    rodsLong_t appends;
+    rodsLong_t records;         /* live paths */
+    rodsLong_t compactions;
+} metaStoreStats_t;
+
+#ifdef  __cplusplus
+extern "C" {
+#endif
+
+int
+initMetaStore (metaStoreConfig_t *metaStoreConfig, rodsEnv *myRodsEnv);
+int
+uninitMetaStore (metaStoreConfig_t *metaStoreConfig);
+int
+isMetaStoreEnabled ();
+int
+lookupMetaStore (const char *path, struct stat *stbuf, time_t *collMtime);
+int
+refreshMetaStore (const char *path);
+int
+putMetaStore (const char *path, struct stat *stbuf, time_t collMtime);
+int
+removeMetaStore (const char *path);
+int
+checkMetaStoreColl (const char *collPath, time_t *mtime);
+int
+setMetaStoreColl (const char *collPath, time_t mtime);
+int
+getMetaStoreStats (metaStoreStats_t *stats);
+
+#ifdef  __cplusplus
+}
+#endif
+
+#endif	/* I_FUSE_LIB_META_STORE_H */
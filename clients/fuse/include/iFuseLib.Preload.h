@@ -20,45 +20,124 @@ typedef struct PreloadConfig {
     char *cachePath;
     rodsLong_t cacheMaxSize; /* 0 means unlimited */
     rodsLong_t preloadMinSize; /* 0 means "use default" */ 
+    int numWorkers; /* 0 means "use default" */
+    int maxQueue; /* 0 means "use default" */
+    rodsLong_t mmapMaxSize; /* 0 means never mmap */
+    int classify; /* preload only files with a reuse history */
+    int reuseWindow; /* in sec, a reopen within this is a reuse */
 } preloadConfig_t;
 
 #define PRELOAD_FILES_IN_DOWNLOADING_EXT    ".part"
-#define NUM_PRELOAD_THREAD_HASH_SLOT	201
+#define NUM_PRELOAD_JOB_HASH_SLOT	201
 
-typedef struct PreloadThreadInfo {
-#ifdef USE_BOOST
-    boost::thread* thread;
-#else
-    pthread_t thread;
-#endif
+#define PRELOAD_DEFAULT_NUM_WORKERS     4
+#define PRELOAD_DEFAULT_MAX_QUEUE       1024
+#define PRELOAD_CONN_IDLE_TIMEOUT       300     /* sec, idle worker connections are closed */
+
+/* foreground jobs are taken before any speculative one */
+#define PRELOAD_PRIORITY_FOREGROUND     0       /* the file is being opened */
+#define PRELOAD_PRIORITY_SPECULATIVE    1
+#define NUM_PRELOAD_PRIORITIES          2
+
+typedef struct PreloadJob {
     char *path;
+    struct stat stbuf;
+    int priority;
     int running;
+} preloadJob_t;
+
+typedef struct PreloadWorker {
 #ifdef USE_BOOST
-    boost::mutex* mutex;
+    boost::thread* thread;
 #else
-    pthread_mutex_t lock;
+    pthread_t thread;
 #endif
-} preloadThreadInfo_t;
+    rcComm_t *conn;     /* kept logged in between jobs */
+    time_t lastUsed;
+} preloadWorker_t;
 
-#define PRELOAD_THREAD_RUNNING    1
-#define PRELOAD_THREAD_IDLE    0
+#define PRELOAD_JOURNAL_FILE            ".preloadjournal"   /* in the cache dir */
+#define PRELOAD_JOURNAL_MAGIC           0x69504a32          /* "iPJ2" */
+#define PRELOAD_JOURNAL_COMPACT_MIN     4096                /* records */
+#define NUM_PRELOAD_CACHE_HASH_SLOT     65521
 
-typedef struct PreloadThreadData {
-    char *path;
-    struct stat stbuf;
-    preloadThreadInfo_t *threadInfo;
-} preloadThreadData_t;
+/* a completely preloaded file */
+typedef struct PreloadCacheEntry {
+    char *path;             /* iRODS path */
+    rodsLong_t size;
+    time_t lastAccess;
+    int heapIndex;          /* position in the eviction heap */
+} preloadCacheEntry_t;
+
+#define PRELOAD_DEFAULT_REUSE_WINDOW    (24*60*60)  /* in sec */
+#define PRELOAD_HISTORY_MAX_ENTRIES     65536
+
+/* how a file was read, from its history */
+#define PRELOAD_ACCESS_UNKNOWN      0   /* no history */
+#define PRELOAD_ACCESS_SEQUENTIAL   1   /* streamed once */
+#define PRELOAD_ACCESS_RANDOM       2
+#define PRELOAD_ACCESS_REREAD       3   /* reopened within the reuse window */
+#define IS_STREAMED_ACCESS(pattern) \
+    ((pattern) == PRELOAD_ACCESS_UNKNOWN || (pattern) == PRELOAD_ACCESS_SEQUENTIAL)
+
+/* opens of a version of a file, whether it is preloaded or not */
+typedef struct PreloadHistoryEntry {
+    char *path;             /* iRODS path */
+    rodsLong_t size;
+    time_t mtime;
+    time_t lastOpen;
+    int opens;
+    int pattern;            /* of the last open that read */
+    struct PreloadHistoryEntry *lruPrev;    /* toward most recently opened */
+    struct PreloadHistoryEntry *lruNext;    /* toward least recently opened */
+} preloadHistoryEntry_t;
+
+#define PRELOAD_JOURNAL_ADD     1
+#define PRELOAD_JOURNAL_REMOVE  2
+#define PRELOAD_JOURNAL_ACCESS  3
+#define PRELOAD_JOURNAL_HISTORY 4
+
+/* the journal is the magic followed by records, each record is
+ * followed by pathLen bytes of the iRODS path. mtime, opens and
+ * pattern are only set in HISTORY records */
+typedef struct PreloadJournalRecord {
+    int type;
+    int pathLen;
+    rodsLong_t size;
+    rodsLong_t lastAccess;
+    rodsLong_t mtime;
+    int opens;
+    int pattern;
+} preloadJournalRecord_t;
+
+typedef struct PreloadStats {
+    int queued;                 /* current, all priorities */
+    int queuedForeground;       /* current */
+    int running;                /* current */
+    rodsLong_t completed;
+    rodsLong_t failed;
+    rodsLong_t dropped;         /* rejected or pushed out of a full queue */
+    rodsLong_t merged;          /* requests for files already queued or running */
+    rodsLong_t connects;        /* connections opened by workers */
+    rodsLong_t downloadedBytes;
+    double downloadTime;        /* sec, summed over workers */
+    int cachedFiles;            /* current */
+    rodsLong_t cachedBytes;     /* current */
+    rodsLong_t evictions;
+    rodsLong_t streamedOpens;   /* not preloaded for lack of reuse */
+    rodsLong_t reusedOpens;     /* preloaded for reuse */
+} preloadStats_t;
 
 #define NUM_PRELOAD_FILEHANDLE_HASH_SLOT    201
 
+/* an opened cache file shared by all readers of the path.
+ * reads are positional, so they only lock the table to take a reference */
 typedef struct PreloadFileHandleInfo {
     char *path;
     int handle;
-#ifdef USE_BOOST
-    boost::mutex* mutex;
-#else
-    pthread_mutex_t lock;
-#endif
+    char *map;          /* whole file mapped, NULL if not */
+    rodsLong_t mapSize;
+    int refCount;       /* the table + reads in progress */
 } preloadFileHandleInfo_t;
 
 #ifdef  __cplusplus
@@ -74,7 +153,7 @@ uninitPreload (preloadConfig_t *preloadConfig);
 int
 isPreloadEnabled ();
 int
-preloadFile (const char *path, struct stat *stbuf);
+preloadFile (const char *path, struct stat *stbuf, int priority);
 int
 invalidatePreloadedFile (const char *path);
 int
@@ -85,14 +164,22 @@ int
 isPreloadedFile (const char *path);
 int
 isFilePreloading (const char *path);
-int
+preloadFileHandleInfo_t *
 openPreloadedFile (const char *path);
 int
-readPreloadedFile (int fileDesc, char *buf, size_t size, off_t offset);
+readPreloadedFile (preloadFileHandleInfo_t *preloadFileHandleInfo, char *buf, size_t size, off_t offset);
+int
+releasePreloadedFile (preloadFileHandleInfo_t *preloadFileHandleInfo);
 int
 closePreloadedFile (const char *path);
 int
 moveToPreloadedDir (const char *path, const char *iRODSPath);
+int
+getPreloadStats (preloadStats_t *stats);
+int
+classifyPreloadAccess (const char *path, struct stat *stbuf);
+int
+recordPreloadAccess (const char *path, int pattern);
 
 #ifdef  __cplusplus
 }
@@ -0,0 +1,67 @@
+/*** For more information please refer to files in the COPYRIGHT directory ***/
+
+#ifndef I_FUSE_LIB_RANGE_FETCH_H
+#define I_FUSE_LIB_RANGE_FETCH_H
+
+#include "rodsClient.h"
+#include "rodsPath.h"
+#include "iFuseLib.h"
+#include "iFuseLib.Lock.h"
+
+#define RANGE_FETCH_DEFAULT_RANGE_SIZE  (16*1024*1024)  /* 16 mb */
+#define RANGE_FETCH_DEFAULT_NUM_STREAMS 4               /* per fetch */
+#define RANGE_FETCH_DEFAULT_MIN_SIZE    (64*1024*1024)  /* smaller objects are fetched in one stream */
+#define RANGE_FETCH_DEFAULT_MAX_RETRIES 3               /* per range */
+#define RANGE_FETCH_MAX_STREAMS         32
+#define RANGE_FETCH_READ_SIZE           (4*1024*1024)   /* per read request */
+
+typedef struct RangeFetchConfig {
+    int rangeFetch;
+    rodsLong_t rangeSize;
+    int numStreams;
+    rodsLong_t minSize;
+    int maxRetries;
+} rangeFetchConfig_t;
+
+/* one rangeFetch call, shared by its streams */
+typedef struct RangeFetchJob {
+    const char *objPath;
+    int fd;                     /* local file the ranges are written to */
+    rodsLong_t end;
+    rodsLong_t nextRange;       /* offset of the next range no stream took yet */
+    rodsLong_t eof;             /* where the object turned out to end, if before end */
+    int status;                 /* first error, stops all streams */
+    pthread_mutex_t lock;
+} rangeFetchJob_t;
+
+typedef struct RangeFetchStats {
+    rodsLong_t fetches;
+    rodsLong_t ranges;
+    rodsLong_t retries;         /* ranges resumed on a new connection after an error */
+    rodsLong_t failed;          /* fetches given up */
+    rodsLong_t fetchedBytes;
+    rodsLong_t connects;
+} rangeFetchStats_t;
+
+#ifdef  __cplusplus
+extern "C" {
+#endif
+
+int
+initRangeFetch (rangeFetchConfig_t *rangeFetchConfig, rodsEnv *myRodsEnv);
+int
+uninitRangeFetch (rangeFetchConfig_t *rangeFetchConfig);
+int
+isRangeFetchEnabled ();
+int
+isRangeFetchable (rodsLong_t size);
+rodsLong_t
+rangeFetch (const char *objPath, rodsLong_t offset, rodsLong_t length, int fd);
+int
+getRangeFetchStats (rangeFetchStats_t *stats);
+
+#ifdef  __cplusplus
+}
+#endif
+
+#endif	/* I_FUSE_LIB_RANGE_FETCH_H */
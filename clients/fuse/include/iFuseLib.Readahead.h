@@ -0,0 +1,101 @@
+/*** For more information please refer to files in the COPYRIGHT directory ***/
+
+#ifndef I_FUSE_LIB_READAHEAD_H
+#define I_FUSE_LIB_READAHEAD_H
+
+#include "rodsClient.h"
+#include "rodsPath.h"
+#include "iFuseLib.h"
+#include "iFuseLib.Lock.h"
+
+#define READAHEAD_DEFAULT_BLOCK_SIZE    (1024*1024)     /* 1 mb */
+#define READAHEAD_DEFAULT_MAX_WINDOW    16              /* in blocks */
+#define READAHEAD_DEFAULT_NUM_WORKERS   4
+#define READAHEAD_DEFAULT_MAX_MEMORY    (256*1024*1024) /* 256 mb over all descriptors */
+#define READAHEAD_INIT_WINDOW           2               /* in blocks */
+#define READAHEAD_SEQ_THRESHOLD         2               /* sequential reads before prefetching */
+
+typedef struct ReadaheadConfig {
+    int readahead;
+    rodsLong_t blockSize;
+    int maxWindow;
+    int numWorkers;
+    rodsLong_t maxMemory;
+} readaheadConfig_t;
+
+typedef enum {
+    READAHEAD_BLOCK_PENDING,    /* queued, no worker picked it up yet */
+    READAHEAD_BLOCK_INFLIGHT,   /* a worker is reading it */
+    READAHEAD_BLOCK_READY,
+    READAHEAD_BLOCK_FAILED,
+} readaheadBlockState_t;
+
+typedef struct ReadaheadBlock {
+    rodsLong_t offset;          /* block aligned */
+    rodsLong_t size;            /* bytes requested */
+    rodsLong_t len;             /* bytes read */
+    readaheadBlockState_t state;
+    int discarded;              /* no longer wanted, freed by the worker */
+    char *buf;
+    struct Readahead *readahead;
+    struct ReadaheadBlock *next;
+} readaheadBlock_t;
+
+/* a server handle of the object kept open for the next block, on the
+ * pooled conn it was opened on */
+typedef struct ReadaheadHandle {
+    iFuseConn_t *iFuseConn;
+    int l1descInx;
+    struct ReadaheadHandle *next;
+} readaheadHandle_t;
+
+/* per-descriptor readahead state */
+typedef struct Readahead {
+    char *objPath;
+    rodsLong_t fileSize;
+    rodsLong_t lastOffset;      /* end of the last read */
+    rodsLong_t nextOffset;      /* first block not scheduled yet */
+    int seqCount;
+    int window;                 /* in blocks */
+    readaheadBlock_t *blocks;   /* ordered by offset */
+    readaheadHandle_t *handles; /* idle, at most one per worker */
+    int closed;
+    int refCount;               /* descriptor + queued jobs */
+    pthread_mutex_t lock;
+    pthread_cond_t cond;
+} readahead_t;
+
+typedef struct ReadaheadStats {
+    rodsLong_t hits;            /* reads served from memory */
+    rodsLong_t misses;          /* reads that went to the server */
+    rodsLong_t stalls;          /* hits that waited for an in-flight block */
+    rodsLong_t prefetchedBytes;
+    rodsLong_t wastedBytes;     /* prefetched but never read */
+    rodsLong_t inflightBytes;   /* current */
+    rodsLong_t bufferedBytes;   /* current, in-flight included */
+} readaheadStats_t;
+
+#ifdef  __cplusplus
+extern "C" {
+#endif
+
+int
+initReadahead (readaheadConfig_t *readaheadConfig);
+int
+uninitReadahead (readaheadConfig_t *readaheadConfig);
+int
+isReadaheadEnabled ();
+readahead_t *
+openReadahead (const char *objPath, rodsLong_t fileSize);
+int
+readReadahead (readahead_t *readahead, char *buf, size_t size, off_t offset);
+int
+closeReadahead (readahead_t *readahead);
+int
+getReadaheadStats (readaheadStats_t *stats);
+
+#ifdef  __cplusplus
+}
+#endif
+
+#endif	/* I_FUSE_LIB_READAHEAD_H */
@@ -0,0 +1,67 @@
+/*** For more information please refer to files in the COPYRIGHT directory ***/
+
+#ifndef I_FUSE_LIB_STAT_BATCH_H
+#define I_FUSE_LIB_STAT_BATCH_H
+
+#include "rodsClient.h"
+#include "rodsPath.h"
+#include "iFuseLib.h"
+#include "iFuseLib.Lock.h"
+
+#define STAT_BATCH_DEFAULT_WINDOW       1000    /* in usec */
+#define STAT_BATCH_MAX_NAMES            64      /* the server binds each name of an in clause */
+#define STAT_BATCH_MAX_COND_LEN         4096    /* of an in clause */
+#define STAT_BATCH_NOT_BATCHED          1       /* statInBatch left the path to the caller */
+#define NUM_STAT_BATCH_HASH_SLOT        201
+
+typedef struct StatBatchConfig {
+    int statBatch;
+    int window;                 /* in usec the first miss of a collection waits for others */
+} statBatchConfig_t;
+
+typedef struct StatBatchWaiter {
+    char *name;                 /* in the collection of the batch */
+    struct stat stbuf;
+    int status;
+    struct StatBatchWaiter *next;
+} statBatchWaiter_t;
+
+/* getattr misses in one collection, resolved at once by the first of them */
+typedef struct StatBatch {
+    char *collPath;             /* fuse path, the hash key while the batch takes misses */
+    statBatchWaiter_t *waiters;
+    int numWaiters;
+    int condLen;                /* of the in clause of the names so far */
+    int closed;                 /* takes no more misses */
+    int done;                   /* results are in */
+    int refCount;               /* waiters yet to take their result */
+    pthread_cond_t cond;
+} statBatch_t;
+
+typedef struct StatBatchStats {
+    rodsLong_t batches;         /* of more than one path */
+    rodsLong_t batchedPaths;
+    rodsLong_t queries;
+    rodsLong_t fallbacks;       /* paths stat'ed one by one in a batch */
+} statBatchStats_t;
+
+#ifdef  __cplusplus
+extern "C" {
+#endif
+
+int
+initStatBatch (statBatchConfig_t *statBatchConfig, rodsEnv *myRodsEnv);
+int
+uninitStatBatch (statBatchConfig_t *statBatchConfig);
+int
+isStatBatchEnabled ();
+int
+statInBatch (const char *path, struct stat *stbuf);
+int
+getStatBatchStats (statBatchStats_t *stats);
+
+#ifdef  __cplusplus
+}
+#endif
+
+#endif	/* I_FUSE_LIB_STAT_BATCH_H */
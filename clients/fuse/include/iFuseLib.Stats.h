@@ -0,0 +1,92 @@
+/*** For more information please refer to files in the COPYRIGHT directory ***/
+
+#ifndef I_FUSE_LIB_STATS_H
+#define I_FUSE_LIB_STATS_H
+
+#include "rodsClient.h"
+#include "iFuseLib.h"
+
+#define STATS_DIR_PATH              "/.irodsfs"
+#define STATS_FILE_PATH             "/.irodsfs/stats"
+#define STATS_DEFAULT_DUMP_INTERVAL 60      /* in sec, when a dump file is given */
+
+/* latency histograms in micro seconds. values below STATS_HIST_SUB_BUCKETS
+ * are counted exactly, above that every power of 2 is split into
+ * STATS_HIST_SUB_BUCKETS buckets, a relative error of 1/8 at most */
+#define STATS_HIST_SUB_BUCKET_BITS  3
+#define STATS_HIST_SUB_BUCKETS      (1 << STATS_HIST_SUB_BUCKET_BITS)
+#define STATS_HIST_MAX_EXP          36      /* 2^36 usec, about 19 hours */
+#define NUM_STATS_HIST_BUCKETS      ((STATS_HIST_MAX_EXP - STATS_HIST_SUB_BUCKET_BITS + 1) * STATS_HIST_SUB_BUCKETS)
+
+#define MAX_STATS_APIS              48      /* distinct api numbers, the last slot takes the rest */
+
+typedef enum {
+    STATS_OP_GETATTR,
+    STATS_OP_READLINK,
+    STATS_OP_READDIR,
+    STATS_OP_MKNOD,
+    STATS_OP_MKDIR,
+    STATS_OP_SYMLINK,
+    STATS_OP_UNLINK,
+    STATS_OP_RMDIR,
+    STATS_OP_RENAME,
+    STATS_OP_LINK,
+    STATS_OP_CHMOD,
+    STATS_OP_CHOWN,
+    STATS_OP_TRUNCATE,
+    STATS_OP_UTIMENS,
+    STATS_OP_OPEN,
+    STATS_OP_READ,
+    STATS_OP_WRITE,
+    STATS_OP_STATFS,
+    STATS_OP_RELEASE,
+    STATS_OP_FSYNC,
+    STATS_OP_FLUSH,
+    NUM_STATS_OPS
+} statsOp_t;
+
+typedef struct StatsConfig {
+    char *dumpPath;         /* NULL for no periodic dump */
+    int dumpInterval;       /* in sec */
+} statsConfig_t;
+
+/* counters of one op or api. each thread has its own and is the only
+ * writer, readers add them up without locking */
+typedef struct StatsHist {
+    rodsLong_t count;
+    rodsLong_t errors;
+    rodsLong_t bytes;
+    rodsLong_t totalUsec;
+    rodsLong_t maxUsec;
+    unsigned int buckets[NUM_STATS_HIST_BUCKETS];
+} statsHist_t;
+
+typedef struct ThreadStats {
+    statsHist_t ops[NUM_STATS_OPS];
+    statsHist_t apis[MAX_STATS_APIS];   /* indexed like the api slots */
+    struct ThreadStats *prev;
+    struct ThreadStats *next;
+} threadStats_t;
+
+#ifdef  __cplusplus
+extern "C" {
+#endif
+
+int
+initStats (statsConfig_t *statsConfig);
+int
+uninitStats (statsConfig_t *statsConfig);
+int
+isStatsEnabled ();
+int
+wrapStatsOperations (struct fuse_operations *oper);
+void
+recordStatsOp (statsOp_t op, rodsLong_t elapsedUsec, int status, rodsLong_t bytes);
+int
+formatStats (char **outBuf, size_t *outLen);
+
+#ifdef  __cplusplus
+}
+#endif
+
+#endif	/* I_FUSE_LIB_STATS_H */
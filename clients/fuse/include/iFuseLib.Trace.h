@@ -19,6 +19,7 @@
 #endif
 
 #include "iFuseLib.Logging.h"
+#include "iFuseLib.BinLog.h"
 #include "iFuseLib.Http.h"
 
 #ifdef  __cplusplus
@@ -81,11 +82,13 @@ int traced_irodsReaddir(const char *path, void *buf, fuse_fill_dir_t filler, off
 int trace_get_environment_variables( char** http_host, int* portnum, int* sync_delay, int* max_lines, uint64_t* methods, char** log_path_salt );
 int trace_read_arg( int argc, char** argv, int i );
 int trace_begin( struct log_context** ctx );
+int trace_start_threads( void );
 int trace_end( struct log_context** ctx );
 
 void trace_usage(void);
 
 extern log_context* LOGCTX;
+extern struct binlog_context* BINLOGCTX;
 
 // helpful macros
 #define strdup_or_default( s, d ) ((s) != NULL ? strdup(s) : ((d) != NULL ? strdup(d) : NULL))
@@ -0,0 +1,76 @@
+/*** For more information please refer to files in the COPYRIGHT directory ***/
+
+#ifndef I_FUSE_LIB_WRITE_BUFFER_H
+#define I_FUSE_LIB_WRITE_BUFFER_H
+
+#include "rodsClient.h"
+#include "rodsPath.h"
+#include "iFuseLib.h"
+#include "iFuseLib.Lock.h"
+
+#define WRITE_BUFFER_DEFAULT_SIZE           (8*1024*1024)   /* 8 mb */
+#define WRITE_BUFFER_MAX_SIZE               (32*1024*1024)  /* largest single write request */
+#define WRITE_BUFFER_DEFAULT_FLUSH_INTERVAL 5               /* sec a buffer may stay dirty */
+
+typedef struct WriteBufferConfig {
+    int writeBuffer;
+    rodsLong_t bufferSize;
+    int flushInterval;
+} writeBufferConfig_t;
+
+/* per-descriptor write-back buffer. it holds one dirty range, writes
+ * that touch or overlap it are merged, any other write flushes it first
+ * so the server sees the writes in order */
+typedef struct WriteBuffer {
+    char *localPath;
+    fileCache_t *fileCache;     /* not referenced, the descriptor outlives the buffer */
+    char *buf;
+    rodsLong_t offset;          /* file offset of buf[0] */
+    rodsLong_t len;             /* dirty bytes, 0 if clean */
+    time_t dirtySince;
+    int error;                  /* of a background flush, reported by the next call */
+    int closed;
+    int refCount;               /* descriptor + flusher, under the global lock */
+    pthread_mutex_t lock;
+} writeBuffer_t;
+
+typedef struct WriteBufferStats {
+    rodsLong_t writes;          /* write calls received */
+    rodsLong_t writtenBytes;
+    rodsLong_t requests;        /* write requests sent to the server */
+    rodsLong_t sentBytes;       /* less than writtenBytes if writes overlapped */
+    rodsLong_t sizeFlushes;     /* buffer full */
+    rodsLong_t seekFlushes;     /* write away from the dirty range */
+    rodsLong_t timeFlushes;     /* dirty for flushInterval */
+    rodsLong_t syncFlushes;     /* flush, fsync, close, read, truncate, rename */
+    rodsLong_t bypassed;        /* writes too large to buffer */
+} writeBufferStats_t;
+
+#ifdef  __cplusplus
+extern "C" {
+#endif
+
+int
+initWriteBuffer (writeBufferConfig_t *writeBufferConfig);
+int
+uninitWriteBuffer (writeBufferConfig_t *writeBufferConfig);
+int
+isWriteBufferEnabled ();
+writeBuffer_t *
+openWriteBuffer (const char *localPath, fileCache_t *fileCache);
+int
+writeWriteBuffer (writeBuffer_t *writeBuffer, char *buf, size_t size, off_t offset);
+int
+flushWriteBuffer (writeBuffer_t *writeBuffer);
+int
+flushWriteBuffersForPath (const char *localPath);
+int
+closeWriteBuffer (writeBuffer_t *writeBuffer);
+int
+getWriteBufferStats (writeBufferStats_t *stats);
+
+#ifdef  __cplusplus
+}
+#endif
+
+#endif	/* I_FUSE_LIB_WRITE_BUFFER_H */
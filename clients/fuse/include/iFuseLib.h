@@ -15,11 +15,15 @@
 #endif
 
 #define MAX_BUF_CACHE   2
-#define MAX_IFUSE_DESC   512
+#define IFUSE_DESC_CHUNK_SIZE   512	/* descriptors added each time the table grows */
+#define MAX_IFUSE_DESC_CHUNKS   256
+#define MAX_IFUSE_DESC   (IFUSE_DESC_CHUNK_SIZE * MAX_IFUSE_DESC_CHUNKS)
+#define NUM_SHARED_FILE_CACHE_HASH_SLOT	201
 #define MAX_READ_CACHE_SIZE   (1024*1024)	/* 1 mb */
 #define MAX_NEWLY_CREATED_CACHE_SIZE   (4*1024*1024)	/* 4 mb */
-#define HIGH_NUM_CONN	5	/* high water mark */
-#define MAX_NUM_CONN	10
+#define MAX_NUM_CONN	10	/* per server host */
+#define MIN_NUM_CONN	1	/* kept connected per server host */
+#define CONN_POOL_DEMAND_WINDOW	60	/* in sec, pools are sized for the peak demand over it */
 
 #define NUM_NEWLY_CREATED_SLOT	5
 #define MAX_NEWLY_CREATED_TIME	5	/* in sec */
@@ -58,10 +62,14 @@ typedef struct ConnReqWait {
     pthread_cond_t cond;
 #endif
     int state;
+    struct IFuseConn *iFuseConn;  /* handed over by the releasing thread, NULL to retry */
 } connReqWait_t;
 
 typedef struct PathCache pathCache_t;
 typedef struct newlyCreatedFile fileCache_t;
+struct Readahead;
+struct BlockCache;
+struct WriteBuffer;
 
 typedef struct IFuseDesc {
     bufCache_t  bufCache[MAX_BUF_CACHE];
@@ -71,6 +79,14 @@ typedef struct IFuseDesc {
     char *objPath;
     char *localPath;
     int index;
+    struct Readahead *readahead;    /* NULL unless reads are prefetched */
+    struct BlockCache *blockCache;  /* NULL unless reads go through the block cache */
+    struct WriteBuffer *writeBuffer;    /* NULL unless writes are coalesced */
+    rodsLong_t nextReadOffset;  /* where the last read ended */
+    int seqReads;
+    int randomReads;
+    int streaming;              /* reads skip the block cache while they stay sequential */
+    unsigned int nextFree;  /* (index + 1) of the next free descriptor, 0 ends the free stack */
 #ifdef USE_BOOST
     boost::mutex* mutex;
 #else
@@ -78,8 +94,18 @@ typedef struct IFuseDesc {
 #endif
 } iFuseDesc_t;
 
-#define NUM_PATH_HASH_SLOT	201
+/* reads this close to where the last one ended are sequential, the kernel
+ * may reorder the readahead it sends */
+#define DESC_SEQ_READ_SLACK	(256*1024)
+#define DESC_MAX_STRAY_READS	4	/* non-sequential reads a stream tolerates */
+#define IS_RANDOM_DESC_ACCESS(desc) \
+    ((desc)->randomReads > DESC_MAX_STRAY_READS && (desc)->randomReads * 16 > (desc)->seqReads)
+
 #define CACHE_EXPIRE_TIME	600	/* 10 minutes before expiration */
+#define NON_EXIST_CACHE_EXPIRE_TIME	5	/* in sec, misses are cheap to recheck */
+#define PATH_CACHE_DEFAULT_NUM_SHARDS	16
+#define PATH_CACHE_DEFAULT_MAX_ENTRIES	100000
+#define PATH_CACHE_INDEX_INIT_SLOTS	64	/* must be a power of 2 */
 
 typedef struct PathCache {
     iFuseConn_t *iFuseConn;
@@ -89,6 +115,12 @@ typedef struct PathCache {
     int expired;
     fileCache_t *fileCache;
     iFuseDesc_t *desc;
+    int statValid;              /* stbuf is a stat of the path, not zeroed for an entry that only keeps a conn */
+    unsigned long hashValue;
+    struct PathCache *lruPrev;  /* toward most recently used */
+    struct PathCache *lruNext;  /* toward least recently used */
+    time_t pageCacheMtime;      /* version the kernel was last let read, 0 for none */
+    rodsLong_t pageCacheSize;
 #ifdef USE_BOOST
     boost::mutex* mutex;
 #else
@@ -96,18 +128,82 @@ typedef struct PathCache {
 #endif
 } pathCache_t;
 
-typedef struct {
-    Hashtable *NonExistPathTable;
-    Hashtable *PathArrayTable;
+/* open addressing table (linear probing) of entries plus their lru list */
+typedef struct PathCacheIndex {
+    pathCache_t **slots;
+    int numSlots;
+    int numEntries;
+    int maxEntries;
+    int timeout;        /* in sec, 0 means no expiration */
+    pathCache_t *lruHead;
+    pathCache_t *lruTail;
+} pathCacheIndex_t;
 
+/* one independently locked slice of the path cache */
+typedef struct PathCacheShard {
+    pathCacheIndex_t exist;
+    pathCacheIndex_t nonExist;  /* paths known to be ENOENT */
+    rodsLong_t hits;
+    rodsLong_t nonExistHits;
+    rodsLong_t misses;
+    rodsLong_t evictions;
+    rodsLong_t expirations;
+#ifdef USE_BOOST
+    boost::mutex* mutex;
+#else
     pthread_mutex_t lock;
-    pthread_mutex_t *PathCacheLock;
+#endif
+} pathCacheShard_t;
+
+typedef struct {
+    pathCacheShard_t *shards;
+    int numShards;
 } PathCacheTable;
 
-typedef struct PathCacheQue {
-    pathCache_t *top;
-    pathCache_t *bottom;
-} pathCacheQue_t;
+typedef struct PathCacheConfig {
+    int numShards;
+    int maxEntries;     /* over all shards */
+    int timeout;        /* in sec, 0 means no expiration */
+    int nonExistTimeout;    /* in sec, 0 disables caching of non-existing paths */
+} pathCacheConfig_t;
+
+typedef struct PageCacheConfig {
+    int check;          /* keep the kernel's pages of files unchanged on the server since they were read */
+    int attrTimeout;    /* in sec, of the kernel's attribute and lookup caches, negative keeps fuse's default */
+    char *immutableColls;   /* colon separated collections whose data objects never change */
+} pageCacheConfig_t;
+
+typedef struct PathCacheStats {
+    rodsLong_t entries;
+    rodsLong_t nonExistEntries;
+    rodsLong_t hits;
+    rodsLong_t nonExistHits;
+    rodsLong_t misses;
+    rodsLong_t evictions;
+    rodsLong_t expirations;
+} pathCacheStats_t;
+
+typedef struct ConnPoolConfig {
+    int maxConn;        /* per server host */
+    int minConn;        /* kept connected to rodsHost even when idle */
+    int idleTimeout;    /* in sec, idle connections above the pool size are closed */
+    int checkInterval;  /* in sec, 0 disables checking idle connections */
+    int redirect;       /* open data objects on the server holding them */
+} connPoolConfig_t;
+
+typedef struct ConnPoolStats {
+    rodsLong_t hosts;
+    rodsLong_t connections;
+    rodsLong_t created;         /* on demand, a request waited for the connect */
+    rodsLong_t prewarmed;       /* by the conn manager ahead of demand */
+    rodsLong_t reused;
+    rodsLong_t waits;           /* requests that found the pool exhausted */
+    rodsLong_t handoffs;        /* released connections given to a waiter */
+    rodsLong_t checks;
+    rodsLong_t checkFailures;
+    rodsLong_t reaped;
+    rodsLong_t redirects;
+} connPoolStats_t;
 
 typedef struct specialPath {
     char *path;
@@ -126,6 +222,10 @@ typedef struct newlyCreatedFile {
     char *localPath;
     char *objPath;
     int mode;
+    int openCount;  /* descriptors using iFd, it is closed when the last one goes */
+    int shared;     /* read only server handle other opens of the same version may use */
+    time_t mtime;   /* version of the object a shared handle was opened on */
+    iFuseConn_t *iFuseConn;    /* the conn a server handle iFd is open on, the handle is only valid there */
 #ifdef USE_BOOST
     boost::mutex* mutex;
 #else
@@ -142,9 +242,23 @@ extern "C" {
 
 int
 initIFuseDesc ();
+iFuseDesc_t *
+getIFuseDesc (int descInx);
+iFuseDesc_t *
+allocIFuseDesc ();
+void
+releaseIFuseDesc (iFuseDesc_t *desc);
 int initFileCache();
 void initConn();
 int
+setConnPoolConfig (connPoolConfig_t *config);
+int
+startConnManager ();
+int
+getConnPoolStats (connPoolStats_t *stats);
+int
+isConnRedirectEnabled ();
+int
 lockDesc (int descInx);
 int
 unlockDesc (int descInx);
@@ -182,27 +296,22 @@ checkFuseDesc (int descInx);
 PathCacheTable*
 initPathCache ();
 int
-getHashSlot (int value, int numHashSlot);
+setPathCacheConfig (pathCacheConfig_t *config);
+int
+setPageCacheConfig (pageCacheConfig_t *config);
 int
-chkCacheExpire (pathCacheQue_t *pathCacheQue);
+clearPageCacheConfig ();
 int
-addPathToCache (char *inPath, fileCache_t *fileCache, Hashtable *pathQueArray,
-struct stat *stbuf, pathCache_t **outPathCache);
+keepPageCache (PathCacheTable *pctable, char *inPath, char *objPath, struct stat *stbuf);
 int
-_addPathToCache (char *inPath, fileCache_t *fileCache, Hashtable *pathQueArray,
-struct stat *stbuf, pathCache_t **outPathCache);
+getPathCacheStats (PathCacheTable *pctable, pathCacheStats_t *stats);
 int
-addToCacheSlot (char *inPath, char *fileCachePath, pathCacheQue_t *pathCacheQue,
-struct stat *stbuf, pathCache_t **outPathCache);
+getHashSlot (int value, int numHashSlot);
 int
 pathSum (char *inPath);
 int
 isSpecialPath (char *inPath);
 int
-rmPathFromCache (char *inPath, Hashtable *pathQueArray);
-int
-_rmPathFromCache (char *inPath, Hashtable *pathQueArray);
-int
 addNewlyCreatedToCache (char *path, char *localPath, int descInx, int mode,
 pathCache_t **tmpPathCache);
 int
@@ -245,8 +354,6 @@ int
 getNewlyCreatedDescByPath (char *path);
 int
 renmeLocalPath(PathCacheTable *pctable, char *from, char *to, char *toIrodsPath);
-int	_chkCacheExpire (pathCacheQue_t *pathCacheQue);
-int _matchAndLockPathCache (PathCacheTable *pctable, char *inPath, pathCacheQue_t *pathQueArray, pathCache_t **outPathCache);
 int _iFuseConnInuse (iFuseConn_t *iFuseConn);
 #ifdef  __cplusplus
 }
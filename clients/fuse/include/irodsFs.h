@@ -30,6 +30,8 @@
 #define CONN_MANAGER_SLEEP_TIME 60
 #define CONN_REQ_SLEEP_TIME 30
 
+struct IFuseConnPool;
+
 typedef struct IFuseConn {
     rcComm_t *conn;    
 #ifdef USE_BOOST
@@ -46,6 +48,10 @@ typedef struct IFuseConn {
     int inuseCnt;
     int pendingCnt;
     int status;
+    struct IFuseConnPool *pool;	/* of the server host it is connected to */
+    time_t checkTime;	/* the last time the idle connection was checked */
+    int isFree;	/* on the free list of its pool */
+    int handleCnt;	/* server handles of file caches open on it, never reaped while > 0 */
     /* struct IFuseConn *next; */
 } iFuseConn_t;
 
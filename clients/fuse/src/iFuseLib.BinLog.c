@@ -0,0 +1,523 @@
+#include <errno.h>
+#include <sys/syscall.h>
+#include <openssl/sha.h>
+
+#include "iFuseLib.BinLog.h"
+
+// concatenate a directory and a file name
+static char* binlog_fullpath( char const* root, char const* name ) {
+
+   size_t len = strlen(root) + strlen(name) + 2;
+   char* dest = (char*)calloc( len, 1 );
+
+   if( dest == NULL ) {
+      return NULL;
+   }
+
+   strcpy( dest, root );
+   if( strlen(root) > 0 && root[strlen(root) - 1] != '/' ) {
+      strcat( dest, "/" );
+   }
+   strcat( dest, name );
+
+   return dest;
+}
+
+
+// SipHash-2-4: cheap enough to run on every operation, and unlike a plain
+// hash it cannot be inverted or recomputed without the key
+#define SIPROUND \
+   do { \
+      v0 += v1; v1 = (v1 << 13) | (v1 >> 51); v1 ^= v0; v0 = (v0 << 32) | (v0 >> 32); \
+      v2 += v3; v3 = (v3 << 16) | (v3 >> 48); v3 ^= v2; \
+      v0 += v3; v3 = (v3 << 21) | (v3 >> 43); v3 ^= v0; \
+      v2 += v1; v1 = (v1 << 17) | (v1 >> 47); v1 ^= v2; v2 = (v2 << 32) | (v2 >> 32); \
+   } while(0)
+
+static uint64_t binlog_siphash( uint64_t const key[2], unsigned char const* data, size_t len ) {
+
+   uint64_t v0 = 0x736f6d6570736575ULL ^ key[0];
+   uint64_t v1 = 0x646f72616e646f6dULL ^ key[1];
+   uint64_t v2 = 0x6c7967656e657261ULL ^ key[0];
+   uint64_t v3 = 0x7465646279746573ULL ^ key[1];
+   uint64_t b = ((uint64_t)len) << 56;
+   uint64_t m;
+   size_t i;
+
+   for( i = 0; i + 8 <= len; i += 8 ) {
+      memcpy( &m, data + i, 8 );
+      v3 ^= m;
+      SIPROUND;
+      SIPROUND;
+      v0 ^= m;
+   }
+
+   // the last 0-7 bytes, little endian
+   for( size_t j = 0; i + j < len; j++ ) {
+      b |= ((uint64_t)data[i + j]) << (8 * j);
+   }
+
+   v3 ^= b;
+   SIPROUND;
+   SIPROUND;
+   v0 ^= b;
+
+   v2 ^= 0xff;
+   SIPROUND;
+   SIPROUND;
+   SIPROUND;
+   SIPROUND;
+
+   return v0 ^ v1 ^ v2 ^ v3;
+}
+
+
+// open a new trace file and write its header
+static FILE* binlog_open( char* log_path ) {
+
+   int rc = 0;
+   struct binlog_file_header header;
+   struct timespec ts;
+
+   // open temporary file
+   int fd = mkstemp( log_path );
+   if( fd < 0 ) {
+
+      rc = -errno;
+      fprintf(stderr, "binlog_open: mkstemp(%s) errno = %d\n", log_path, rc );
+
+      return NULL;
+   }
+
+   FILE* f = fdopen( fd, "w" );
+   if( f == NULL ) {
+
+      rc = -errno;
+      fprintf(stderr, "binlog_open: fdopen(%s) errno = %d\n", log_path, rc );
+
+      close( fd );
+      return NULL;
+   }
+
+   memset( &header, 0, sizeof(header) );
+   memcpy( header.magic, BINLOG_MAGIC, sizeof(header.magic) );
+   header.version = BINLOG_VERSION;
+   header.record_size = sizeof(struct binlog_record);
+
+   clock_gettime( CLOCK_REALTIME, &ts );
+   header.start_realtime_ns = (uint64_t)ts.tv_sec * 1000000000ULL + ts.tv_nsec;
+   header.start_monotonic_ns = binlog_now();
+
+   if( fwrite( &header, sizeof(header), 1, f ) != 1 ) {
+
+      fprintf(stderr, "binlog_open: failed to write the header of %s\n", log_path );
+
+      fclose( f );
+      return NULL;
+   }
+
+   return f;
+}
+
+
+// runs when a traced thread exits.  the drain thread frees the ring once it is empty
+static void binlog_ring_exit( void* arg ) {
+
+   struct binlog_ring* ring = (struct binlog_ring*)arg;
+   ring->exited = 1;
+}
+
+
+// set up a binary log context
+struct binlog_context* binlog_init( uint64_t methods, uint64_t max_records, char const* log_path_salt, char const* log_dir ) {
+
+   unsigned char digest[SHA256_DIGEST_LENGTH];
+
+   struct binlog_context* ctx = (struct binlog_context*)calloc( sizeof(struct binlog_context), 1 );
+   if( ctx == NULL ) {
+      return NULL;
+   }
+
+   ctx->methods = methods;
+   ctx->max_records = max_records > 0 ? max_records : BINLOG_DEFAULT_MAX_RECORDS;
+   ctx->logfile_dir = strdup( log_dir );
+
+   ctx->block_start_ns = (uint64_t*)calloc( BINLOG_BLOCK_RECORDS, sizeof(uint64_t) );
+   ctx->block_duration_us = (uint32_t*)calloc( BINLOG_BLOCK_RECORDS, sizeof(uint32_t) );
+   ctx->block_op = (uint8_t*)calloc( BINLOG_BLOCK_RECORDS, sizeof(uint8_t) );
+   ctx->block_tid = (uint32_t*)calloc( BINLOG_BLOCK_RECORDS, sizeof(uint32_t) );
+   ctx->block_rc = (int32_t*)calloc( BINLOG_BLOCK_RECORDS, sizeof(int32_t) );
+   ctx->block_path_hash = (uint64_t*)calloc( BINLOG_BLOCK_RECORDS, sizeof(uint64_t) );
+   ctx->block_size = (uint64_t*)calloc( BINLOG_BLOCK_RECORDS, sizeof(uint64_t) );
+   ctx->block_offset = (int64_t*)calloc( BINLOG_BLOCK_RECORDS, sizeof(int64_t) );
+
+   if( ctx->logfile_dir == NULL || ctx->block_start_ns == NULL || ctx->block_duration_us == NULL ||
+       ctx->block_op == NULL || ctx->block_tid == NULL || ctx->block_rc == NULL ||
+       ctx->block_path_hash == NULL || ctx->block_size == NULL || ctx->block_offset == NULL ) {
+
+      // OOM
+      binlog_free( ctx );
+      return NULL;
+   }
+
+   // the path hash key is derived from the salt
+   SHA256( (unsigned char const*)log_path_salt, strlen(log_path_salt), digest );
+   memcpy( ctx->hash_key, digest, sizeof(ctx->hash_key) );
+
+   ctx->logfile_path = binlog_fullpath( log_dir, BINLOG_PATH_FMT );
+   if( ctx->logfile_path == NULL ) {
+
+      // OOM
+      binlog_free( ctx );
+      return NULL;
+   }
+
+   ctx->logfile = binlog_open( ctx->logfile_path );
+   if( ctx->logfile == NULL ) {
+
+      fprintf(stderr, "binlog_open(%s) failed\n", ctx->logfile_path );
+
+      binlog_free( ctx );
+      return NULL;
+   }
+
+   pthread_mutex_init( &ctx->lock, NULL );
+   pthread_cond_init( &ctx->cond, NULL );
+   pthread_key_create( &ctx->ring_key, binlog_ring_exit );
+
+   return ctx;
+}
+
+
+// free a binary log context, after the drain thread wrote the last records
+int binlog_free( struct binlog_context* ctx ) {
+
+   if( ctx->running ) {
+      return -EINVAL;
+   }
+
+   if( ctx->logfile != NULL ) {
+
+      pthread_key_delete( ctx->ring_key );
+      pthread_cond_destroy( &ctx->cond );
+      pthread_mutex_destroy( &ctx->lock );
+
+      fclose( ctx->logfile );
+      ctx->logfile = NULL;
+   }
+
+   // threads still running are not traced any more
+   while( ctx->rings != NULL ) {
+      struct binlog_ring* ring = ctx->rings;
+      ctx->rings = ring->next;
+      free( ring );
+   }
+
+   free( ctx->logfile_path );
+   free( ctx->logfile_dir );
+   free( ctx->block_start_ns );
+   free( ctx->block_duration_us );
+   free( ctx->block_op );
+   free( ctx->block_tid );
+   free( ctx->block_rc );
+   free( ctx->block_path_hash );
+   free( ctx->block_size );
+   free( ctx->block_offset );
+
+   memset( ctx, 0, sizeof(struct binlog_context) );
+   free( ctx );
+
+   return 0;
+}
+
+
+// start up the drain thread
+int binlog_start_threads( struct binlog_context* ctx ) {
+
+   int rc = 0;
+
+   ctx->running = 1;
+
+   rc = pthread_create( &ctx->drain_thread, NULL, binlog_drain_thread, ctx );
+   if( rc != 0 ) {
+
+      fprintf(stderr, "pthread_create(drain) rc = %d\n", rc );
+      ctx->running = 0;
+      return rc;
+   }
+
+   return 0;
+}
+
+
+// stop the drain thread, writing out whatever is buffered
+int binlog_stop_threads( struct binlog_context* ctx ) {
+
+   if( ctx->running ) {
+
+      pthread_mutex_lock( &ctx->lock );
+      ctx->running = 0;
+      pthread_cond_signal( &ctx->cond );
+      pthread_mutex_unlock( &ctx->lock );
+
+      pthread_join( ctx->drain_thread, NULL );
+   }
+
+   return binlog_drain( ctx );
+}
+
+
+uint64_t binlog_now(void) {
+
+   struct timespec ts;
+   clock_gettime( CLOCK_MONOTONIC, &ts );
+
+   return (uint64_t)ts.tv_sec * 1000000000ULL + ts.tv_nsec;
+}
+
+
+// hash a path
+uint64_t binlog_hash_path( struct binlog_context* ctx, char const* path ) {
+
+   if( path == NULL ) {
+      return 0;
+   }
+
+   // omit the last / in the path
+   size_t path_len = strlen(path);
+   if( path_len > 0 && path[path_len - 1] == '/' )
+      path_len --;
+
+   return binlog_siphash( ctx->hash_key, (unsigned char const*)path, path_len );
+}
+
+
+// the calling thread's ring, made on first use
+static struct binlog_ring* binlog_get_ring( struct binlog_context* ctx ) {
+
+   struct binlog_ring* ring = (struct binlog_ring*)pthread_getspecific( ctx->ring_key );
+   if( ring != NULL ) {
+      return ring;
+   }
+
+   ring = (struct binlog_ring*)calloc( sizeof(struct binlog_ring), 1 );
+   if( ring == NULL ) {
+      return NULL;
+   }
+
+   ring->tid = (uint32_t)syscall( __NR_gettid );
+
+   pthread_mutex_lock( &ctx->lock );
+   ring->next = ctx->rings;
+   ctx->rings = ring;
+   pthread_mutex_unlock( &ctx->lock );
+
+   pthread_setspecific( ctx->ring_key, ring );
+
+   return ring;
+}
+
+
+// add a record to the calling thread's ring.  never blocks: if the drain
+// thread falls behind, the record is dropped and counted
+void binlog_record( struct binlog_context* ctx, uint64_t method, char const* path, uint64_t size, int64_t offset, uint64_t start_ns, int rc ) {
+
+   struct binlog_ring* ring = binlog_get_ring( ctx );
+   if( ring == NULL ) {
+      return;
+   }
+
+   uint64_t head = ring->head;
+   if( head - ring->tail >= BINLOG_RING_SIZE ) {
+      ring->dropped++;
+      return;
+   }
+
+   uint64_t duration_us = (binlog_now() - start_ns) / 1000;
+
+   struct binlog_record* record = &ring->records[ head & (BINLOG_RING_SIZE - 1) ];
+   record->start_ns = start_ns;
+   record->path_hash = binlog_hash_path( ctx, path );
+   record->size = size;
+   record->offset = offset;
+   record->duration_us = duration_us > UINT32_MAX ? UINT32_MAX : (uint32_t)duration_us;
+   record->rc = rc;
+   record->tid = ring->tid;
+   record->op = (uint8_t)__builtin_ctzll( method );
+
+   // the record must be complete before the drain thread can see it
+   __sync_synchronize();
+   ring->head = head + 1;
+
+   // wake the drain thread early rather than drop records
+   if( head + 1 - ring->tail == BINLOG_RING_SIZE / 2 ) {
+      pthread_cond_signal( &ctx->cond );
+   }
+}
+
+
+// write the current block and roll the file over if it is full
+// precond: lock ctx->lock
+static int binlog_write_block( struct binlog_context* ctx ) {
+
+   struct binlog_block_header header;
+   uint32_t n = ctx->block_len;
+   FILE* f = ctx->logfile;
+   int rc = 0;
+
+   if( n == 0 && ctx->block_dropped == 0 ) {
+      return 0;
+   }
+
+   header.magic = BINLOG_BLOCK_MAGIC;
+   header.num_records = n;
+   header.dropped = ctx->block_dropped;
+
+   if( fwrite( &header, sizeof(header), 1, f ) != 1 ||
+       fwrite( ctx->block_start_ns, sizeof(uint64_t), n, f ) != n ||
+       fwrite( ctx->block_duration_us, sizeof(uint32_t), n, f ) != n ||
+       fwrite( ctx->block_op, sizeof(uint8_t), n, f ) != n ||
+       fwrite( ctx->block_tid, sizeof(uint32_t), n, f ) != n ||
+       fwrite( ctx->block_rc, sizeof(int32_t), n, f ) != n ||
+       fwrite( ctx->block_path_hash, sizeof(uint64_t), n, f ) != n ||
+       fwrite( ctx->block_size, sizeof(uint64_t), n, f ) != n ||
+       fwrite( ctx->block_offset, sizeof(int64_t), n, f ) != n ) {
+
+      fprintf(stderr, "binlog_write_block: failed to write %s\n", ctx->logfile_path );
+      rc = -EIO;
+   }
+
+   ctx->block_len = 0;
+   ctx->block_dropped = 0;
+   ctx->num_records += n;
+
+   if( ctx->num_records < ctx->max_records ) {
+      return rc;
+   }
+
+   // roll over to a new file, the full one stays for the decoder
+   char* new_logpath = binlog_fullpath( ctx->logfile_dir, BINLOG_PATH_FMT );
+   if( new_logpath == NULL ) {
+      return -ENOMEM;
+   }
+
+   FILE* new_logfile = binlog_open( new_logpath );
+   if( new_logfile == NULL ) {
+
+      // keep appending to the old one
+      free( new_logpath );
+      return -EPERM;
+   }
+
+   fclose( ctx->logfile );
+   free( ctx->logfile_path );
+
+   ctx->logfile = new_logfile;
+   ctx->logfile_path = new_logpath;
+   ctx->num_records = 0;
+
+   return rc;
+}
+
+
+// move the records of every ring into blocks
+int binlog_drain( struct binlog_context* ctx ) {
+
+   int rc = 0;
+   struct binlog_ring** ringp;
+
+   pthread_mutex_lock( &ctx->lock );
+
+   ringp = &ctx->rings;
+   while( *ringp != NULL ) {
+
+      struct binlog_ring* ring = *ringp;
+      int exited = ring->exited;
+
+      uint64_t head = ring->head;
+      __sync_synchronize();
+
+      for( uint64_t i = ring->tail; i < head; i++ ) {
+
+         struct binlog_record* record = &ring->records[ i & (BINLOG_RING_SIZE - 1) ];
+         uint32_t n = ctx->block_len;
+
+         ctx->block_start_ns[n] = record->start_ns;
+         ctx->block_duration_us[n] = record->duration_us;
+         ctx->block_op[n] = record->op;
+         ctx->block_tid[n] = record->tid;
+         ctx->block_rc[n] = record->rc;
+         ctx->block_path_hash[n] = record->path_hash;
+         ctx->block_size[n] = record->size;
+         ctx->block_offset[n] = record->offset;
+         ctx->block_len++;
+
+         if( ctx->block_len == BINLOG_BLOCK_RECORDS ) {
+            rc = binlog_write_block( ctx );
+         }
+      }
+
+      // the slots may be reused once they are copied
+      __sync_synchronize();
+      ring->tail = head;
+
+      uint64_t dropped = ring->dropped;
+      ctx->block_dropped += dropped - ring->dropped_drained;
+      ring->dropped_drained = dropped;
+
+      if( exited && ring->head == head ) {
+         *ringp = ring->next;
+         free( ring );
+      }
+      else {
+         ringp = &ring->next;
+      }
+   }
+
+   int write_rc = binlog_write_block( ctx );
+   if( rc == 0 ) {
+      rc = write_rc;
+   }
+
+   fflush( ctx->logfile );
+
+   pthread_mutex_unlock( &ctx->lock );
+
+   return rc;
+}
+
+
+// drain thread
+void* binlog_drain_thread( void* arg ) {
+
+   struct binlog_context* ctx = (struct binlog_context*)arg;
+
+   while( 1 ) {
+
+      struct timespec ts;
+      clock_gettime( CLOCK_REALTIME, &ts );
+
+      // wait a bit
+      ts.tv_nsec += BINLOG_DRAIN_INTERVAL_MS * 1000000L;
+      if( ts.tv_nsec >= 1000000000L ) {
+         ts.tv_sec++;
+         ts.tv_nsec -= 1000000000L;
+      }
+
+      pthread_mutex_lock( &ctx->lock );
+      if( ctx->running ) {
+         pthread_cond_timedwait( &ctx->cond, &ctx->lock, &ts );
+      }
+      int running = ctx->running;
+      pthread_mutex_unlock( &ctx->lock );
+
+      if( !running ) {
+         // got asked to stop?  binlog_stop_threads drains the rest
+         break;
+      }
+
+      binlog_drain( ctx );
+   }
+
+   return NULL;
+}
@@ -0,0 +1,913 @@
+/*** For more information please refer to files in the COPYRIGHT directory ***/
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <errno.h>
+#include <time.h>
+#include <assert.h>
+#include <pthread.h>
+#include <dirent.h>
+#include <sys/types.h>
+#include <sys/stat.h>
+#include "irodsFs.h"
+#include "iFuseLib.h"
+#include "iFuseOper.h"
+#include "hashtable.h"
+#include "list.h"
+#include "iFuseLib.BlockCache.h"
+#include "iFuseLib.Lock.h"
+#include "iFuseLib.FSUtils.h"
+#ifdef ENABLE_RANGE_FETCH
+#include "iFuseLib.RangeFetch.h"
+#endif
+
+/**************************************************************************
+ * global variables
+ **************************************************************************/
+static blockCacheConfig_t BlockCacheConfig;
+static blockCacheStats_t BlockCacheStats;
+static rodsEnv *BlockCacheRodsEnv;
+
+/* protects BlockCacheTable, BlockCacheList, BlockCacheStats and the
+ * refCount, invalid and lastAccess fields of every blockCache_t.
+ * never taken together with a blockCache_t lock */
+static pthread_mutex_t BlockCacheLock;
+static Hashtable *BlockCacheTable;
+static List *BlockCacheList;
+
+/**************************************************************************
+ * function definitions
+ **************************************************************************/
+static blockCache_t *_newBlockCache(const char *path, rodsLong_t fileSize, time_t mtime);
+static void _freeBlockCache(blockCache_t *blockCache);
+static int _loadBlockCache(blockCache_t *blockCache);
+static void _unloadBlockCache(blockCache_t *blockCache);
+static int _resetBlockCache(blockCache_t *blockCache);
+static void _removeBlockCache(blockCache_t *blockCache);
+static int _setBlockCached(blockCache_t *blockCache, rodsLong_t blockIdx);
+static int _reserveBlockCacheSpace(blockCache_t *blockCache);
+static int _evictBlockCache(blockCache_t *except);
+static int _fetchBlock(blockCache_t *blockCache, rodsLong_t blockIdx, char *blockBuf, blockCacheFetch_t fetch, void *fetchArg);
+static int _scanBlockCaches(const char *dirPath);
+static int _readMapHeader(int mapFd, blockCacheMapHeader_t *header);
+static rodsLong_t _countCachedBlocks(const unsigned char *bitmap, rodsLong_t numBlocks);
+static int _getBlockCacheDataPath(const char *path, char *dataPath);
+static int _getBlockCacheMapPath(const char *path, char *mapPath);
+static int _getiRODSPath(const char *path, char *iRODSPath);
+
+#define BLOCK_CACHE_BITMAP_LEN(n)   (((n) + 7) / 8)
+#define IS_BLOCK_SET(b, i)          ((b)[(i) / 8] & (1 << ((i) % 8)))
+#define SET_BLOCK(b, i)             ((b)[(i) / 8] |= (1 << ((i) % 8)))
+#define CLEAR_BLOCK(b, i)           ((b)[(i) / 8] &= ~(1 << ((i) % 8)))
+
+/**************************************************************************
+ * public functions
+ **************************************************************************/
+int
+initBlockCache (blockCacheConfig_t *blockCacheConfig, rodsEnv *myRodsEnv) {
+    rodsLog (LOG_DEBUG, "initBlockCache: MyBlockCacheConfig.blockCache = %d", blockCacheConfig->blockCache);
+    rodsLog (LOG_DEBUG, "initBlockCache: MyBlockCacheConfig.clearCache = %d", blockCacheConfig->clearCache);
+    rodsLog (LOG_DEBUG, "initBlockCache: MyBlockCacheConfig.cachePath = %s", blockCacheConfig->cachePath);
+    rodsLog (LOG_DEBUG, "initBlockCache: MyBlockCacheConfig.blockSize = %lld", blockCacheConfig->blockSize);
+    rodsLog (LOG_DEBUG, "initBlockCache: MyBlockCacheConfig.cacheMaxSize = %lld", blockCacheConfig->cacheMaxSize);
+
+    // copy given configuration
+    memcpy(&BlockCacheConfig, blockCacheConfig, sizeof(blockCacheConfig_t));
+    bzero(&BlockCacheStats, sizeof(blockCacheStats_t));
+    BlockCacheRodsEnv = myRodsEnv;
+
+    if(BlockCacheConfig.blockCache == 0) {
+        return (0);
+    }
+
+    // init hashtable and list
+    BlockCacheTable = newHashTable(NUM_BLOCK_CACHE_HASH_SLOT);
+    BlockCacheList = newListNoRegion();
+
+    // init lock
+    pthread_mutex_init(&BlockCacheLock, NULL);
+
+    makeDirs(BlockCacheConfig.cachePath);
+
+    if(BlockCacheConfig.clearCache) {
+        // clear all cache
+        emptyDir(BlockCacheConfig.cachePath);
+    } else {
+        // pick up blocks cached by previous mounts
+        _scanBlockCaches(BlockCacheConfig.cachePath);
+        rodsLog (LOG_DEBUG, "initBlockCache: found %lld bytes of cached blocks", BlockCacheStats.cachedBytes);
+
+        pthread_mutex_lock(&BlockCacheLock);
+        _evictBlockCache(NULL);
+        pthread_mutex_unlock(&BlockCacheLock);
+    }
+
+    return (0);
+}
+
+int
+uninitBlockCache (blockCacheConfig_t *blockCacheConfig) {
+    ListNode *node;
+    blockCacheStats_t stats;
+
+    if(BlockCacheConfig.blockCache == 0) {
+        return (0);
+    }
+
+    getBlockCacheStats(&stats);
+    rodsLog (LOG_NOTICE, "block cache: %lld hits, %lld misses, %lld bytes fetched, %lld bytes cached, %lld evictions",
+        stats.hits, stats.misses, stats.fetchedBytes, stats.cachedBytes, stats.evictions);
+
+    pthread_mutex_lock(&BlockCacheLock);
+    // cached blocks stay on disk for the next mount
+    node = BlockCacheList->head;
+    while(node != NULL) {
+        blockCache_t *blockCache = (blockCache_t *)node->value;
+        node = node->next;
+
+        _unloadBlockCache(blockCache);
+        _freeBlockCache(blockCache);
+    }
+    deleteListNoRegion(BlockCacheList);
+    deleteHashTable(BlockCacheTable, nop);
+    pthread_mutex_unlock(&BlockCacheLock);
+
+    if(blockCacheConfig->clearCache) {
+        emptyDir(BlockCacheConfig.cachePath);
+    }
+
+    pthread_mutex_destroy(&BlockCacheLock);
+    BlockCacheConfig.blockCache = 0;
+    return (0);
+}
+
+int
+isBlockCacheEnabled () {
+    // check whether block cache is enabled
+    if(BlockCacheConfig.blockCache == 0) {
+        return -1;
+    }
+    return 0;
+}
+
+blockCache_t *
+openBlockCache (const char *path, struct stat *stbuf) {
+    int status;
+    char iRODSPath[MAX_NAME_LEN];
+    blockCache_t *blockCache;
+
+    if(path == NULL || stbuf == NULL || stbuf->st_size <= 0) {
+        return NULL;
+    }
+
+    status = _getiRODSPath(path, iRODSPath);
+    if(status < 0) {
+        rodsLog (LOG_DEBUG, "openBlockCache: failed to get iRODS path - %s", path);
+        return NULL;
+    }
+
+    pthread_mutex_lock(&BlockCacheLock);
+
+    blockCache = (blockCache_t *)lookupFromHashTable(BlockCacheTable, iRODSPath);
+    if(blockCache != NULL && (blockCache->fileSize != stbuf->st_size || blockCache->mtime != stbuf->st_mtime)) {
+        if(blockCache->refCount > 0) {
+            // another descriptor still reads the old content
+            rodsLog (LOG_DEBUG, "openBlockCache: %s changed while opened, not caching", iRODSPath);
+            pthread_mutex_unlock(&BlockCacheLock);
+            return NULL;
+        }
+
+        rodsLog (LOG_DEBUG, "openBlockCache: %s changed, dropping cached blocks", iRODSPath);
+        _removeBlockCache(blockCache);
+        blockCache = NULL;
+    }
+
+    if(blockCache == NULL) {
+        blockCache = _newBlockCache(iRODSPath, stbuf->st_size, stbuf->st_mtime);
+        if(blockCache == NULL) {
+            pthread_mutex_unlock(&BlockCacheLock);
+            return NULL;
+        }
+        insertIntoHashTable(BlockCacheTable, iRODSPath, blockCache);
+        listAppendNoRegion(BlockCacheList, blockCache);
+    }
+
+    if(blockCache->refCount == 0) {
+        status = _loadBlockCache(blockCache);
+        if(status < 0) {
+            rodsLogError (LOG_ERROR, status, "openBlockCache: cannot open block cache of %s", iRODSPath);
+            _removeBlockCache(blockCache);
+            pthread_mutex_unlock(&BlockCacheLock);
+            return NULL;
+        }
+    }
+
+    blockCache->refCount++;
+    blockCache->lastAccess = time(NULL);
+
+    pthread_mutex_unlock(&BlockCacheLock);
+    return blockCache;
+}
+
+/*
+ * read from locally cached blocks, fetching missing blocks whole through
+ * fetch and storing them. returns bytes read or an error.
+ */
+int
+readBlockCache (blockCache_t *blockCache, char *buf, size_t size, off_t offset, blockCacheFetch_t fetch, void *fetchArg) {
+    rodsLong_t blockSize = BlockCacheConfig.blockSize;
+    rodsLong_t readEnd;
+    rodsLong_t cur;
+    char *blockBuf = NULL;
+    int fetched = 0;
+    int refetched = 0;
+    int status = 0;
+
+    if(blockCache == NULL || buf == NULL || fetch == NULL) {
+        return SYS_INTERNAL_NULL_INPUT_ERR;
+    }
+
+    readEnd = offset + size;
+    if(readEnd > blockCache->fileSize) {
+        readEnd = blockCache->fileSize;
+    }
+
+    cur = offset;
+    while(cur < readEnd) {
+        rodsLong_t blockIdx = cur / blockSize;
+        rodsLong_t blockOffset = blockIdx * blockSize;
+        rodsLong_t blockLen = blockSize;
+        rodsLong_t len;
+        int cached;
+
+        if(blockOffset + blockLen > blockCache->fileSize) {
+            blockLen = blockCache->fileSize - blockOffset;
+        }
+        len = blockOffset + blockLen - cur;
+        if(len > readEnd - cur) {
+            len = readEnd - cur;
+        }
+
+        pthread_mutex_lock(&blockCache->lock);
+        while(!IS_BLOCK_SET(blockCache->bitmap, blockIdx) && IS_BLOCK_SET(blockCache->fetching, blockIdx)) {
+            // another reader is fetching the block
+            pthread_cond_wait(&blockCache->cond, &blockCache->lock);
+        }
+        cached = IS_BLOCK_SET(blockCache->bitmap, blockIdx) ? 1 : 0;
+        if(!cached) {
+            SET_BLOCK(blockCache->fetching, blockIdx);
+        }
+        pthread_mutex_unlock(&blockCache->lock);
+
+        if(cached) {
+            // dataFd does not change while we hold a reference
+            status = pread(blockCache->dataFd, buf + (cur - offset), len, cur);
+            if(status < 0) {
+                status = errno ? (-1 * errno) : -1;
+                break;
+            }
+            if(status < len) {
+                // cached data is shorter than the bitmap claims
+                rodsLog (LOG_ERROR, "readBlockCache: short block %lld of %s, dropping cached blocks", blockIdx, blockCache->path);
+                pthread_mutex_lock(&BlockCacheLock);
+                if(!blockCache->invalid) {
+                    _removeBlockCache(blockCache);
+                }
+                pthread_mutex_unlock(&BlockCacheLock);
+                if(refetched) {
+                    status = -EIO;
+                    break;
+                }
+
+                // the data is still on the server, fetch the block again
+                refetched = 1;
+                pthread_mutex_lock(&blockCache->lock);
+                CLEAR_BLOCK(blockCache->bitmap, blockIdx);
+                pthread_mutex_unlock(&blockCache->lock);
+                status = 0;
+                continue;
+            }
+        } else {
+            if(blockBuf == NULL) {
+                blockBuf = (char *)malloc(blockSize);
+                if(blockBuf == NULL) {
+                    pthread_mutex_lock(&blockCache->lock);
+                    CLEAR_BLOCK(blockCache->fetching, blockIdx);
+                    pthread_cond_broadcast(&blockCache->cond);
+                    pthread_mutex_unlock(&blockCache->lock);
+                    status = SYS_MALLOC_ERR;
+                    break;
+                }
+            }
+
+            status = _fetchBlock(blockCache, blockIdx, blockBuf, fetch, fetchArg);
+
+            pthread_mutex_lock(&blockCache->lock);
+            CLEAR_BLOCK(blockCache->fetching, blockIdx);
+            pthread_cond_broadcast(&blockCache->cond);
+            pthread_mutex_unlock(&blockCache->lock);
+
+            if(status < 0) {
+                break;
+            }
+            fetched = 1;
+
+            if(status < cur - blockOffset + len) {
+                // the object is shorter than it was when opened
+                if(status > cur - blockOffset) {
+                    memcpy(buf + (cur - offset), blockBuf + (cur - blockOffset), status - (cur - blockOffset));
+                    cur = blockOffset + status;
+                }
+                status = 0;
+                break;
+            }
+            memcpy(buf + (cur - offset), blockBuf + (cur - blockOffset), len);
+        }
+
+        cur += len;
+        status = 0;
+    }
+
+    if(blockBuf != NULL) {
+        free(blockBuf);
+    }
+
+    pthread_mutex_lock(&BlockCacheLock);
+    if(fetched) {
+        BlockCacheStats.misses++;
+    } else if(status >= 0) {
+        BlockCacheStats.hits++;
+    }
+    blockCache->lastAccess = time(NULL);
+    pthread_mutex_unlock(&BlockCacheLock);
+
+    if(status < 0 && cur == offset) {
+        return status;
+    }
+    return cur > offset ? (int)(cur - offset) : 0;
+}
+
+int
+closeBlockCache (blockCache_t *blockCache) {
+    if(blockCache == NULL) {
+        return 0;
+    }
+
+    pthread_mutex_lock(&BlockCacheLock);
+    blockCache->refCount--;
+    if(blockCache->refCount == 0) {
+        if(blockCache->invalid) {
+            // files are gone already, only memory is left
+            BlockCacheStats.cachedBytes -= blockCache->numCachedBlocks * BlockCacheConfig.blockSize;
+            _unloadBlockCache(blockCache);
+            _freeBlockCache(blockCache);
+        } else {
+            _unloadBlockCache(blockCache);
+            _evictBlockCache(NULL);
+        }
+    }
+    pthread_mutex_unlock(&BlockCacheLock);
+    return 0;
+}
+
+int
+invalidateBlockCache (const char *path) {
+    int status;
+    char iRODSPath[MAX_NAME_LEN];
+    blockCache_t *blockCache;
+
+    if(BlockCacheConfig.blockCache == 0) {
+        return 0;
+    }
+
+    status = _getiRODSPath(path, iRODSPath);
+    if(status < 0) {
+        rodsLog (LOG_DEBUG, "invalidateBlockCache: failed to get iRODS path - %s", path);
+        return status;
+    }
+
+    pthread_mutex_lock(&BlockCacheLock);
+    blockCache = (blockCache_t *)lookupFromHashTable(BlockCacheTable, iRODSPath);
+    if(blockCache != NULL) {
+        rodsLog (LOG_DEBUG, "invalidateBlockCache: %s", iRODSPath);
+        _removeBlockCache(blockCache);
+    }
+    pthread_mutex_unlock(&BlockCacheLock);
+    return 0;
+}
+
+int
+getBlockCacheStats (blockCacheStats_t *stats) {
+    if(stats == NULL) {
+        return SYS_INTERNAL_NULL_INPUT_ERR;
+    }
+
+    if(BlockCacheConfig.blockCache == 0) {
+        memcpy(stats, &BlockCacheStats, sizeof(blockCacheStats_t));
+        return 0;
+    }
+
+    pthread_mutex_lock(&BlockCacheLock);
+    memcpy(stats, &BlockCacheStats, sizeof(blockCacheStats_t));
+    pthread_mutex_unlock(&BlockCacheLock);
+    return 0;
+}
+
+/**************************************************************************
+ * private functions
+ **************************************************************************/
+static blockCache_t *
+_newBlockCache(const char *path, rodsLong_t fileSize, time_t mtime) {
+    blockCache_t *blockCache;
+
+    blockCache = (blockCache_t *)malloc(sizeof(blockCache_t));
+    if(blockCache == NULL) {
+        return NULL;
+    }
+
+    bzero(blockCache, sizeof(blockCache_t));
+    blockCache->path = strdup(path);
+    blockCache->fileSize = fileSize;
+    blockCache->mtime = mtime;
+    blockCache->numBlocks = (fileSize + BlockCacheConfig.blockSize - 1) / BlockCacheConfig.blockSize;
+    blockCache->dataFd = -1;
+    blockCache->mapFd = -1;
+    blockCache->lastAccess = time(NULL);
+    pthread_mutex_init(&blockCache->lock, NULL);
+    pthread_cond_init(&blockCache->cond, NULL);
+    return blockCache;
+}
+
+static void
+_freeBlockCache(blockCache_t *blockCache) {
+    pthread_cond_destroy(&blockCache->cond);
+    pthread_mutex_destroy(&blockCache->lock);
+    free(blockCache->path);
+    free(blockCache);
+}
+
+/* precond: lock BlockCacheLock, refCount is 0.
+ * opens the data and map files, a map that does not match the object
+ * starts the cache over */
+static int
+_loadBlockCache(blockCache_t *blockCache) {
+    int status;
+    char dataPath[MAX_NAME_LEN];
+    char mapPath[MAX_NAME_LEN];
+    blockCacheMapHeader_t header;
+    size_t bitmapLen = BLOCK_CACHE_BITMAP_LEN(blockCache->numBlocks);
+
+    if((status = _getBlockCacheDataPath(blockCache->path, dataPath)) < 0) {
+        return status;
+    }
+    if((status = _getBlockCacheMapPath(blockCache->path, mapPath)) < 0) {
+        return status;
+    }
+
+    makeParentDirs(dataPath);
+
+    blockCache->dataFd = open(dataPath, O_RDWR | O_CREAT, 0600);
+    if(blockCache->dataFd < 0) {
+        status = errno ? (-1 * errno) : -1;
+        _unloadBlockCache(blockCache);
+        return status;
+    }
+    blockCache->mapFd = open(mapPath, O_RDWR | O_CREAT, 0600);
+    if(blockCache->mapFd < 0) {
+        status = errno ? (-1 * errno) : -1;
+        _unloadBlockCache(blockCache);
+        return status;
+    }
+
+    blockCache->bitmap = (unsigned char *)calloc(bitmapLen, 1);
+    blockCache->fetching = (unsigned char *)calloc(bitmapLen, 1);
+    if(blockCache->bitmap == NULL || blockCache->fetching == NULL) {
+        _unloadBlockCache(blockCache);
+        return SYS_MALLOC_ERR;
+    }
+
+    status = _readMapHeader(blockCache->mapFd, &header);
+    if(status < 0 ||
+       header.blockSize != BlockCacheConfig.blockSize ||
+       header.fileSize != blockCache->fileSize ||
+       header.mtime != (rodsLong_t)blockCache->mtime ||
+       header.numBlocks != blockCache->numBlocks ||
+       pread(blockCache->mapFd, blockCache->bitmap, bitmapLen, sizeof(blockCacheMapHeader_t)) != (ssize_t)bitmapLen) {
+        status = _resetBlockCache(blockCache);
+        if(status < 0) {
+            _unloadBlockCache(blockCache);
+            return status;
+        }
+        return 0;
+    }
+
+    // the scan at mount counted the same blocks
+    BlockCacheStats.cachedBytes -= blockCache->numCachedBlocks * BlockCacheConfig.blockSize;
+    blockCache->numCachedBlocks = _countCachedBlocks(blockCache->bitmap, blockCache->numBlocks);
+    BlockCacheStats.cachedBytes += blockCache->numCachedBlocks * BlockCacheConfig.blockSize;
+
+    rodsLog (LOG_DEBUG, "_loadBlockCache: %s has %lld of %lld blocks cached",
+        blockCache->path, blockCache->numCachedBlocks, blockCache->numBlocks);
+    return 0;
+}
+
+/* precond: lock BlockCacheLock, refCount is 0 */
+static void
+_unloadBlockCache(blockCache_t *blockCache) {
+    if(blockCache->dataFd >= 0) {
+        close(blockCache->dataFd);
+        blockCache->dataFd = -1;
+    }
+    if(blockCache->mapFd >= 0) {
+        close(blockCache->mapFd);
+        blockCache->mapFd = -1;
+    }
+    if(blockCache->bitmap != NULL) {
+        free(blockCache->bitmap);
+        blockCache->bitmap = NULL;
+    }
+    if(blockCache->fetching != NULL) {
+        free(blockCache->fetching);
+        blockCache->fetching = NULL;
+    }
+}
+
+/* precond: lock BlockCacheLock, files opened */
+static int
+_resetBlockCache(blockCache_t *blockCache) {
+    blockCacheMapHeader_t header;
+    size_t bitmapLen = BLOCK_CACHE_BITMAP_LEN(blockCache->numBlocks);
+
+    BlockCacheStats.cachedBytes -= blockCache->numCachedBlocks * BlockCacheConfig.blockSize;
+    blockCache->numCachedBlocks = 0;
+    bzero(blockCache->bitmap, bitmapLen);
+
+    // drop old blocks, the data file stays sparse
+    if(ftruncate(blockCache->dataFd, 0) < 0 || ftruncate(blockCache->mapFd, 0) < 0) {
+        return errno ? (-1 * errno) : -1;
+    }
+
+    bzero(&header, sizeof(blockCacheMapHeader_t));
+    header.magic = BLOCK_CACHE_MAP_MAGIC;
+    header.blockSize = BlockCacheConfig.blockSize;
+    header.fileSize = blockCache->fileSize;
+    header.mtime = blockCache->mtime;
+    header.numBlocks = blockCache->numBlocks;
+
+    if(pwrite(blockCache->mapFd, &header, sizeof(blockCacheMapHeader_t), 0) != sizeof(blockCacheMapHeader_t)) {
+        return errno ? (-1 * errno) : -1;
+    }
+    if(ftruncate(blockCache->mapFd, sizeof(blockCacheMapHeader_t) + bitmapLen) < 0) {
+        return errno ? (-1 * errno) : -1;
+    }
+    return 0;
+}
+
+/* precond: lock BlockCacheLock.
+ * removes the cached files, an opened cache is freed by its last close */
+static void
+_removeBlockCache(blockCache_t *blockCache) {
+    char dataPath[MAX_NAME_LEN];
+    char mapPath[MAX_NAME_LEN];
+
+    if(_getBlockCacheDataPath(blockCache->path, dataPath) == 0) {
+        unlink(dataPath);
+    }
+    if(_getBlockCacheMapPath(blockCache->path, mapPath) == 0) {
+        unlink(mapPath);
+    }
+
+    deleteFromHashTable(BlockCacheTable, blockCache->path);
+    listRemoveNoRegion2(BlockCacheList, blockCache);
+
+    if(blockCache->refCount > 0) {
+        blockCache->invalid = 1;
+        return;
+    }
+
+    BlockCacheStats.cachedBytes -= blockCache->numCachedBlocks * BlockCacheConfig.blockSize;
+    _unloadBlockCache(blockCache);
+    _freeBlockCache(blockCache);
+}
+
+/* precond: lock blockCache.
+ * the data is on disk before the bit that claims it */
+static int
+_setBlockCached(blockCache_t *blockCache, rodsLong_t blockIdx) {
+    off_t mapOffset = sizeof(blockCacheMapHeader_t) + blockIdx / 8;
+
+    SET_BLOCK(blockCache->bitmap, blockIdx);
+    if(pwrite(blockCache->mapFd, blockCache->bitmap + blockIdx / 8, 1, mapOffset) != 1) {
+        CLEAR_BLOCK(blockCache->bitmap, blockIdx);
+        return errno ? (-1 * errno) : -1;
+    }
+    blockCache->numCachedBlocks++;
+    return 0;
+}
+
+/* account one more cached block, evicting closed files if needed */
+static int
+_reserveBlockCacheSpace(blockCache_t *blockCache) {
+    int status = 0;
+
+    pthread_mutex_lock(&BlockCacheLock);
+    BlockCacheStats.cachedBytes += BlockCacheConfig.blockSize;
+    if(BlockCacheConfig.cacheMaxSize > 0 && BlockCacheStats.cachedBytes > BlockCacheConfig.cacheMaxSize) {
+        _evictBlockCache(blockCache);
+        if(BlockCacheStats.cachedBytes > BlockCacheConfig.cacheMaxSize) {
+            // everything left is in use
+            BlockCacheStats.cachedBytes -= BlockCacheConfig.blockSize;
+            status = -ENOSPC;
+        }
+    }
+    pthread_mutex_unlock(&BlockCacheLock);
+    return status;
+}
+
+/* precond: lock BlockCacheLock.
+ * evicts least recently used files nobody has opened until the cache
+ * fits in cacheMaxSize */
+static int
+_evictBlockCache(blockCache_t *except) {
+    int evicted = 0;
+
+    if(BlockCacheConfig.cacheMaxSize <= 0) {
+        return 0;
+    }
+
+    while(BlockCacheStats.cachedBytes > BlockCacheConfig.cacheMaxSize) {
+        blockCache_t *oldest = NULL;
+        ListNode *node;
+
+        for(node = BlockCacheList->head; node != NULL; node = node->next) {
+            blockCache_t *blockCache = (blockCache_t *)node->value;
+            if(blockCache == except || blockCache->refCount > 0 || blockCache->numCachedBlocks == 0) {
+                continue;
+            }
+            if(oldest == NULL || blockCache->lastAccess < oldest->lastAccess) {
+                oldest = blockCache;
+            }
+        }
+
+        if(oldest == NULL) {
+            break;
+        }
+
+        rodsLog (LOG_DEBUG, "_evictBlockCache: evict %s", oldest->path);
+        _removeBlockCache(oldest);
+        BlockCacheStats.evictions++;
+        evicted++;
+    }
+    return evicted;
+}
+
+/* fetch a whole block into blockBuf and store it. returns bytes fetched,
+ * fewer than the block length if the object got shorter */
+static int
+_fetchBlock(blockCache_t *blockCache, rodsLong_t blockIdx, char *blockBuf, blockCacheFetch_t fetch, void *fetchArg) {
+    rodsLong_t blockSize = BlockCacheConfig.blockSize;
+    rodsLong_t blockOffset = blockIdx * blockSize;
+    rodsLong_t blockLen = blockSize;
+    rodsLong_t got = 0;
+    int status;
+
+    if(blockOffset + blockLen > blockCache->fileSize) {
+        blockLen = blockCache->fileSize - blockOffset;
+    }
+
+#ifdef ENABLE_RANGE_FETCH
+    // large blocks go straight to the data file in parallel ranges
+    if(isRangeFetchable(blockLen) == 0 && _reserveBlockCacheSpace(blockCache) == 0) {
+        got = rangeFetch(blockCache->path, blockOffset, blockLen, blockCache->dataFd);
+        if(got > 0 && pread(blockCache->dataFd, blockBuf, got, blockOffset) != got) {
+            got = errno ? (-1 * errno) : -1;
+        }
+
+        status = -1;
+        if(got == blockLen && fdatasync(blockCache->dataFd) == 0) {
+            pthread_mutex_lock(&blockCache->lock);
+            status = _setBlockCached(blockCache, blockIdx);
+            pthread_mutex_unlock(&blockCache->lock);
+        }
+
+        pthread_mutex_lock(&BlockCacheLock);
+        if(status < 0) {
+            BlockCacheStats.cachedBytes -= blockSize;
+        }
+        if(got > 0) {
+            BlockCacheStats.fetchedBytes += got;
+        }
+        pthread_mutex_unlock(&BlockCacheLock);
+
+        if(got < 0) {
+            rodsLogError (LOG_ERROR, (int)got, "_fetchBlock: range fetch of block %lld of %s error", blockIdx, blockCache->path);
+        }
+        return (int)got;
+    }
+#endif
+
+    while(got < blockLen) {
+        status = fetch(fetchArg, blockBuf + got, blockLen - got, blockOffset + got);
+        if(status < 0) {
+            rodsLogError (LOG_ERROR, status, "_fetchBlock: fetch of block %lld of %s error", blockIdx, blockCache->path);
+            return status;
+        }
+        if(status == 0) {
+            break;
+        }
+        got += status;
+    }
+
+    pthread_mutex_lock(&BlockCacheLock);
+    BlockCacheStats.fetchedBytes += got;
+    pthread_mutex_unlock(&BlockCacheLock);
+
+    if(got < blockLen) {
+        return got;
+    }
+
+    if(_reserveBlockCacheSpace(blockCache) < 0) {
+        rodsLog (LOG_DEBUG, "_fetchBlock: cache is full, block %lld of %s is not stored", blockIdx, blockCache->path);
+        return got;
+    }
+
+    if(pwrite(blockCache->dataFd, blockBuf, blockLen, blockOffset) != blockLen || fdatasync(blockCache->dataFd) < 0) {
+        rodsLog (LOG_ERROR, "_fetchBlock: cannot store block %lld of %s, errno = %d", blockIdx, blockCache->path, errno);
+        pthread_mutex_lock(&BlockCacheLock);
+        BlockCacheStats.cachedBytes -= blockSize;
+        pthread_mutex_unlock(&BlockCacheLock);
+        return got;
+    }
+
+    pthread_mutex_lock(&blockCache->lock);
+    status = _setBlockCached(blockCache, blockIdx);
+    pthread_mutex_unlock(&blockCache->lock);
+    if(status < 0) {
+        pthread_mutex_lock(&BlockCacheLock);
+        BlockCacheStats.cachedBytes -= blockSize;
+        pthread_mutex_unlock(&BlockCacheLock);
+    }
+    return got;
+}
+
+/* register caches left by previous mounts, without opening them */
+static int
+_scanBlockCaches(const char *dirPath) {
+    DIR *dir = opendir(dirPath);
+    char filepath[MAX_NAME_LEN];
+    char iRODSPath[MAX_NAME_LEN];
+    struct dirent *entry;
+    struct stat statbuf;
+    int mapExtLen = strlen(BLOCK_CACHE_MAP_EXT);
+    int dataExtLen = strlen(BLOCK_CACHE_DATA_EXT);
+    int cachePathLen = strlen(BlockCacheConfig.cachePath);
+
+    if (dir == NULL) {
+        return 0;
+    }
+
+    while ((entry = readdir(dir)) != NULL) {
+        int filenameLen;
+
+        if (!strcmp(entry->d_name, ".") || !strcmp(entry->d_name, "..")) {
+            continue;
+        }
+
+        snprintf(filepath, MAX_NAME_LEN, "%s/%s", dirPath, entry->d_name);
+        if (stat(filepath, &statbuf) < 0) {
+            continue;
+        }
+
+        if (S_ISDIR(statbuf.st_mode)) {
+            _scanBlockCaches(filepath);
+            continue;
+        }
+
+        filenameLen = strlen(entry->d_name);
+        if (filenameLen > dataExtLen && !strcmp(entry->d_name + filenameLen - dataExtLen, BLOCK_CACHE_DATA_EXT)) {
+            char mapPath[MAX_NAME_LEN];
+            struct stat mapStatbuf;
+
+            // data without a map is useless
+            snprintf(mapPath, MAX_NAME_LEN, "%.*s%s", (int)(strlen(filepath) - dataExtLen), filepath, BLOCK_CACHE_MAP_EXT);
+            if (stat(mapPath, &mapStatbuf) < 0) {
+                rodsLog (LOG_DEBUG, "_scanBlockCaches: removing orphaned block data : %s", filepath);
+                unlink(filepath);
+            }
+            continue;
+        }
+
+        if (filenameLen > mapExtLen && !strcmp(entry->d_name + filenameLen - mapExtLen, BLOCK_CACHE_MAP_EXT)) {
+            blockCacheMapHeader_t header;
+            unsigned char *bitmap;
+            size_t bitmapLen;
+            blockCache_t *blockCache;
+            int mapFd;
+            int valid = 0;
+
+            // <cachePath><iRODSPath>.blkmap
+            snprintf(iRODSPath, MAX_NAME_LEN, "%.*s", (int)(strlen(filepath) - cachePathLen - mapExtLen), filepath + cachePathLen);
+
+            mapFd = open(filepath, O_RDONLY);
+            if (mapFd < 0) {
+                continue;
+            }
+
+            if (_readMapHeader(mapFd, &header) == 0 && header.blockSize == BlockCacheConfig.blockSize) {
+                bitmapLen = BLOCK_CACHE_BITMAP_LEN(header.numBlocks);
+                bitmap = (unsigned char *)malloc(bitmapLen);
+                if (bitmap != NULL && pread(mapFd, bitmap, bitmapLen, sizeof(blockCacheMapHeader_t)) == (ssize_t)bitmapLen) {
+                    blockCache = _newBlockCache(iRODSPath, header.fileSize, (time_t)header.mtime);
+                    if (blockCache != NULL) {
+                        blockCache->numCachedBlocks = _countCachedBlocks(bitmap, header.numBlocks);
+                        blockCache->lastAccess = statbuf.st_mtime;
+                        insertIntoHashTable(BlockCacheTable, iRODSPath, blockCache);
+                        listAppendNoRegion(BlockCacheList, blockCache);
+                        BlockCacheStats.cachedBytes += blockCache->numCachedBlocks * BlockCacheConfig.blockSize;
+                        valid = 1;
+                    }
+                }
+                if (bitmap != NULL) {
+                    free(bitmap);
+                }
+            }
+            close(mapFd);
+
+            if (!valid) {
+                char dataPath[MAX_NAME_LEN];
+
+                // written with another block size or damaged
+                rodsLog (LOG_DEBUG, "_scanBlockCaches: removing unusable block cache : %s", filepath);
+                unlink(filepath);
+                if (_getBlockCacheDataPath(iRODSPath, dataPath) == 0) {
+                    unlink(dataPath);
+                }
+            }
+        }
+    }
+    closedir(dir);
+
+    return 0;
+}
+
+static int
+_readMapHeader(int mapFd, blockCacheMapHeader_t *header) {
+    if(pread(mapFd, header, sizeof(blockCacheMapHeader_t), 0) != sizeof(blockCacheMapHeader_t)) {
+        return -1;
+    }
+    if(header->magic != BLOCK_CACHE_MAP_MAGIC || header->blockSize <= 0 || header->numBlocks < 0) {
+        return -1;
+    }
+    if(header->numBlocks != (header->fileSize + header->blockSize - 1) / header->blockSize) {
+        return -1;
+    }
+    return 0;
+}
+
+static rodsLong_t
+_countCachedBlocks(const unsigned char *bitmap, rodsLong_t numBlocks) {
+    rodsLong_t i;
+    rodsLong_t count = 0;
+
+    for(i=0;i<numBlocks;i++) {
+        if(IS_BLOCK_SET(bitmap, i)) {
+            count++;
+        }
+    }
+    return count;
+}
+
+static int
+_getBlockCacheDataPath(const char *path, char *dataPath) {
+    if (path == NULL || dataPath == NULL) {
+        rodsLog (LOG_DEBUG, "_getBlockCacheDataPath: given path or dataPath is NULL");
+        return (SYS_INTERNAL_NULL_INPUT_ERR);
+    }
+
+    if(strlen(path) > 0 && path[0] == '/') {
+        snprintf(dataPath, MAX_NAME_LEN, "%s%s%s", BlockCacheConfig.cachePath, path, BLOCK_CACHE_DATA_EXT);
+    } else {
+        snprintf(dataPath, MAX_NAME_LEN, "%s/%s%s", BlockCacheConfig.cachePath, path, BLOCK_CACHE_DATA_EXT);
+    }
+    return (0);
+}
+
+static int
+_getBlockCacheMapPath(const char *path, char *mapPath) {
+    if (path == NULL || mapPath == NULL) {
+        rodsLog (LOG_DEBUG, "_getBlockCacheMapPath: given path or mapPath is NULL");
+        return (SYS_INTERNAL_NULL_INPUT_ERR);
+    }
+
+    if(strlen(path) > 0 && path[0] == '/') {
+        snprintf(mapPath, MAX_NAME_LEN, "%s%s%s", BlockCacheConfig.cachePath, path, BLOCK_CACHE_MAP_EXT);
+    } else {
+        snprintf(mapPath, MAX_NAME_LEN, "%s/%s%s", BlockCacheConfig.cachePath, path, BLOCK_CACHE_MAP_EXT);
+    }
+    return (0);
+}
+
+static int
+_getiRODSPath(const char *path, char *iRODSPath) {
+    return getiRODSPath(path, iRODSPath, BlockCacheRodsEnv->rodsHome, BlockCacheRodsEnv->rodsCwd);
+}
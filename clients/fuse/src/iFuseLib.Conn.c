@@ -5,6 +5,7 @@
 #include <errno.h>
 #include <time.h>
 #include <assert.h>
+#include <pthread.h>
 #include "irodsFs.h"
 #include "iFuseLib.h"
 #include "iFuseOper.h"
@@ -14,171 +15,374 @@
 
 /*
  * An ifuseconn->inuseLock is locked when before it goes from free to inuse and during the whole time it is in use, it is only unlocked when it is unused.
+ *
+ * Connections are pooled per server host. An idle connection sits on the
+ * free list of its pool, a released connection is handed directly to the
+ * oldest request waiting in the pool. The conn manager sizes every pool
+ * to the peak demand of the last CONN_POOL_DEMAND_WINDOW seconds, connects
+ * ahead of demand, checks idle connections and closes connections idle
+ * for too long above the pool size.
+ *
+ * lock order: iFuseConn struct, then ConnPoolLock.
  */
-concurrentList_t *ConnectedConn;
-concurrentList_t *FreeConn;
-concurrentList_t *ConnReqWaitQue;
+typedef struct IFuseConnPool {
+    char host[NAME_LEN];
+    List *conns;            /* every connection to the host */
+    List *freeConns;        /* idle, the most recently used last */
+    List *waiters;          /* connReqWait_t, the oldest first */
+    int numConn;            /* in conns + being connected */
+    int numBusy;            /* taken from the pool and not given back */
+    int minConn;
+    int target;             /* number of connections the manager keeps */
+    int peak;               /* of busy + waiting since the last sample */
+    int demand[CONN_POOL_DEMAND_WINDOW];    /* peak per second */
+    time_t sampleTime;
+    struct IFuseConnPool *next;
+} iFuseConnPool_t;
+
+/**************************************************************************
+ * global variables
+ **************************************************************************/
+static connPoolConfig_t ConnPoolConfig = {
+    MAX_NUM_CONN,
+    MIN_NUM_CONN,
+    IFUSE_CONN_TIMEOUT,
+    CONN_MANAGER_SLEEP_TIME,
+    0
+};
+static connPoolStats_t ConnPoolStats;
+
+/* protects the pools, the lists and counters in them and the stats */
+static pthread_mutex_t ConnPoolLock;
+static iFuseConnPool_t *ConnPools = NULL;   /* the last is of rodsHost */
+static iFuseConnPool_t *DefaultConnPool = NULL;
 static PathCacheTable *pctable;
 
 static int ConnManagerStarted = 0;
+static int ConnManagerStop = 0;
 
+/**************************************************************************
+ * function definitions
+ **************************************************************************/
+static iFuseConnPool_t *_newConnPool(char *host, int minConn);
+static iFuseConnPool_t *_getConnPool(char *host);
+static int _getAndUseConnFromPool(iFuseConnPool_t *pool, iFuseConn_t **iFuseConn);
+static int _newConnOfPool(iFuseConnPool_t *pool, iFuseConn_t **iFuseConn);
+static int _getAndUseConnOfPool(iFuseConn_t **iFuseConn, pathCache_t *paca, iFuseConnPool_t *pool);
+static int _releaseIFuseConn(iFuseConn_t *iFuseConn, int active);
+static void _takeFreeConn(iFuseConnPool_t *pool, iFuseConn_t *iFuseConn);
+static iFuseConn_t *_popFreeConn(iFuseConnPool_t *pool);
+static void _putConnToPool(iFuseConnPool_t *pool, iFuseConn_t *iFuseConn, int busy);
+static void _wakeConnWaiter(iFuseConnPool_t *pool);
+static void _noteConnDemand(iFuseConnPool_t *pool);
+static void _sizeConnPool(iFuseConnPool_t *pool, time_t curTime);
+static void _checkConnPool(iFuseConnPool_t *pool, time_t curTime);
+static void _prewarmConnPool(iFuseConnPool_t *pool);
+static int _ifuseConnect(iFuseConn_t *iFuseConn, rodsEnv *myRodsEnv);
+
+/**************************************************************************
+ * public functions
+ **************************************************************************/
 void initConn() {
-	ConnectedConn = newConcurrentList();
-	FreeConn = newConcurrentList();
-	ConnReqWaitQue = newConcurrentList();
+	pthread_mutex_init(&ConnPoolLock, NULL);
+	bzero(&ConnPoolStats, sizeof(connPoolStats_t));
 	pctable = initPathCache();
+	DefaultConnPool = _newConnPool(MyRodsEnv.rodsHost, ConnPoolConfig.minConn);
+	ConnPools = DefaultConnPool;
+}
+
+int
+setConnPoolConfig (connPoolConfig_t *config) {
+    if (config == NULL) {
+        return SYS_INTERNAL_NULL_INPUT_ERR;
+    }
+
+    if (config->maxConn > 0) {
+        ConnPoolConfig.maxConn = config->maxConn;
+    }
+    if (config->minConn >= 0) {
+        ConnPoolConfig.minConn = config->minConn;
+    }
+    if (ConnPoolConfig.minConn > ConnPoolConfig.maxConn) {
+        ConnPoolConfig.minConn = ConnPoolConfig.maxConn;
+    }
+    if (config->idleTimeout > 0) {
+        ConnPoolConfig.idleTimeout = config->idleTimeout;
+    }
+    /* 0 disables checking idle connections */
+    if (config->checkInterval >= 0) {
+        ConnPoolConfig.checkInterval = config->checkInterval;
+    }
+    ConnPoolConfig.redirect = config->redirect;
+    return 0;
 }
+
+/* the manager runs in the mounted daemon, a thread started before
+ * fuse_main forks into the background would be lost */
+int
+startConnManager () {
+    int status = 0;
+
+    if (ConnManagerStarted) {
+        return 0;
+    }
+
+    rodsLog (LOG_DEBUG, "startConnManager: maxConn = %d", ConnPoolConfig.maxConn);
+    rodsLog (LOG_DEBUG, "startConnManager: minConn = %d", ConnPoolConfig.minConn);
+    rodsLog (LOG_DEBUG, "startConnManager: idleTimeout = %d", ConnPoolConfig.idleTimeout);
+    rodsLog (LOG_DEBUG, "startConnManager: checkInterval = %d", ConnPoolConfig.checkInterval);
+
+#ifdef USE_BOOST
+    ConnManagerThr = new boost::thread( connManager );
+#else
+    status = pthread_create  (&ConnManagerThr, pthread_attr_default,(void *(*)(void *)) connManager, (void *) NULL);
+#endif
+    if (status != 0) {
+        rodsLog (LOG_ERROR, "startConnManager: pthread_create failure, status = %d", status);
+        return status;
+    }
+    ConnManagerStarted = 1;
+    return 0;
+}
+
+int
+getConnPoolStats (connPoolStats_t *stats) {
+    if (stats == NULL) {
+        return SYS_INTERNAL_NULL_INPUT_ERR;
+    }
+
+    pthread_mutex_lock(&ConnPoolLock);
+    memcpy(stats, &ConnPoolStats, sizeof(connPoolStats_t));
+    pthread_mutex_unlock(&ConnPoolLock);
+    return 0;
+}
+
+int
+isConnRedirectEnabled () {
+    if (ConnPoolConfig.redirect == 0) {
+        return -1;
+    }
+    return 0;
+}
+
 /* getIFuseConnByPath - try to use the same conn as opened desc of the
  * same path */
 iFuseConn_t *getAndUseConnByPath( char *localPath, int *status ) {
-    iFuseConn_t *iFuseConn;
+    iFuseConn_t *iFuseConn = NULL;
     /* make sure iFuseConn is not released after getAndLockIFuseDescByPath finishes */
     pathCache_t *tmpPathCache;
     matchAndLockPathCache(pctable, localPath, &tmpPathCache);
 
+    if(tmpPathCache==NULL) {
+        /* no match. remember the conn assigned below for the path, the
+         * data object opened on it can only be used through it */
+        pathExist(pctable, localPath, NULL, NULL, NULL);
+        matchAndLockPathCache(pctable, localPath, &tmpPathCache);
+    }
+
     if(tmpPathCache!=NULL) {
         *status = _getAndUseConnForPathCache (&iFuseConn, tmpPathCache);
     	UNLOCK_STRUCT (*tmpPathCache);
     }
     else {
-		/* no match. just assign one */
-        pathExist(pctable, localPath, NULL, NULL, NULL); // need to find a way to clean up
         *status = getAndUseIFuseConn( &iFuseConn );
-
 	}
 
     return iFuseConn;
 }
 
-/* precond: lock paca */
-int _getAndUseConnForPathCache(iFuseConn_t **iFuseConn, pathCache_t *paca) {
-	int status;
-	/* if connection already closed by connection manager, get new ifuseconn */
-    if(paca->iFuseConn != NULL) {
-    	LOCK_STRUCT(*(paca->iFuseConn));
-    	if(paca->iFuseConn->conn != NULL) {
-    		if(paca->iFuseConn->inuseCnt == 0) {
-				_useIFuseConn(paca->iFuseConn);
-				UNLOCK_STRUCT(*(paca->iFuseConn));
-				/* ifuseReconnect(paca->iFuseConn); */
-				*iFuseConn = paca->iFuseConn;
-				return 0;
-            }
-            else {
-				UNLOCK_STRUCT(*(paca->iFuseConn));
-    		}
-        }
-        else {
-    		UNLOCK_STRUCT(*(paca->iFuseConn));
-    		/* disconnect by not freed yet */
-			UNREF(paca->iFuseConn, IFuseConn);
-    	}
+/* getAndUseConnByHost - use a conn to host for the path from now on */
+iFuseConn_t *getAndUseConnByHost( char *host, char *localPath, int *status ) {
+    iFuseConn_t *iFuseConn = NULL;
+    iFuseConnPool_t *pool;
+    pathCache_t *tmpPathCache;
+
+    pool = _getConnPool(host);
+    if(pool == NULL) {
+        *status = SYS_MALLOC_ERR;
+        return NULL;
+    }
+
+    matchAndLockPathCache(pctable, localPath, &tmpPathCache);
+    if(tmpPathCache==NULL) {
+        pathExist(pctable, localPath, NULL, NULL, NULL);
+        matchAndLockPathCache(pctable, localPath, &tmpPathCache);
+    }
+
+    if(tmpPathCache!=NULL) {
+        *status = _getAndUseConnOfPool (&iFuseConn, tmpPathCache, pool);
+    	UNLOCK_STRUCT (*tmpPathCache);
+    }
+    else {
+        *status = _getAndUseConnFromPool( pool, &iFuseConn );
     }
 
+    return iFuseConn;
+}
+
+/* redirectIFuseConn - move an open of a data object to the server holding
+ * it. returns an error only if no conn is held anymore */
+int
+redirectIFuseConn( iFuseConn_t **iFuseConn, char *localPath, dataObjInp_t *dataObjInp ) {
     iFuseConn_t *tmpIFuseConn;
-    // UNLOCK_STRUCT( *paca );
-    status = getAndUseIFuseConn( &tmpIFuseConn );
-    // LOCK_STRUCT( *paca );
-	if(status < 0) {
-		rodsLog (LOG_ERROR,
-			  "ifuseClose: cannot get ifuse connection for %s error, status = %d",
-			   paca->localPath, status);
-		return status;
-	}
-    // if ( paca->iFuseConn != NULL ) {
-	    /* has been changed by other threads, or current paca->ifuseconn inuse,
-	     * return new ifuseconn without setting paca->ifuseconn */
-    //  *iFuseConn = tmpIFuseConn;
-    //}
-    //else {
-	    /* conn in use, cannot be deleted by conn manager
-	     * therefore, it is safe to do the following without locking conn */
-	    REF(paca->iFuseConn, tmpIFuseConn);
-	    *iFuseConn = paca->iFuseConn;
-    //}
-	return 0;
+    char *outHost = NULL;
+    int status;
+
+    if (isConnRedirectEnabled() != 0) {
+        return 0;
+    }
+
+    /* the open of an existing replica, also for writing */
+    status = rcGetHostForGet ((*iFuseConn)->conn, dataObjInp, &outHost);
+    if (status < 0 || outHost == NULL || strcmp (outHost, THIS_ADDRESS) == 0 ||
+      strcmp (outHost, (*iFuseConn)->pool->host) == 0) {
+        if (status < 0) {
+            rodsLogError (LOG_DEBUG, status, "redirectIFuseConn: rcGetHostForGet of %s error", dataObjInp->objPath);
+        }
+        if (outHost != NULL) {
+            free (outHost);
+        }
+        return 0;
+    }
+
+    unuseIFuseConn (*iFuseConn);
+    tmpIFuseConn = getAndUseConnByHost (outHost, localPath, &status);
+    if (status < 0) {
+        rodsLogError (LOG_ERROR, status, "redirectIFuseConn: cannot connect to %s for %s", outHost, localPath);
+        free (outHost);
+        *iFuseConn = getAndUseConnByPath (localPath, &status);
+        return status;
+    }
+
+    rodsLog (LOG_DEBUG, "redirectIFuseConn: %s redirected to %s", localPath, outHost);
+    free (outHost);
+
+    pthread_mutex_lock(&ConnPoolLock);
+    ConnPoolStats.redirects++;
+    pthread_mutex_unlock(&ConnPoolLock);
+
+    *iFuseConn = tmpIFuseConn;
+    return 0;
 }
 
-int getAndUseIFuseConn( iFuseConn_t **iFuseConn ) {
-    int ret = _getAndUseIFuseConn( iFuseConn );
-	return ret;
+/* getAndUseConnByFileCache - use the conn the server handle of fileCache
+ * is open on, an l1descInx is only valid there. waits for the conn if it
+ * is busy. the conn of the path is used if the handle has none.
+ * precond: lock fileCache */
+iFuseConn_t *getAndUseConnByFileCache( fileCache_t *fileCache, int *status ) {
+    iFuseConn_t *tmpIFuseConn = fileCache->iFuseConn;
 
+    if(tmpIFuseConn == NULL) {
+        return getAndUseConnByPath( fileCache->localPath, status );
+    }
+
+    *status = useHeldIFuseConn(tmpIFuseConn);
+    if(*status < 0) {
+        rodsLog (LOG_ERROR, "getAndUseConnByFileCache: conn of the handle of %s is lost", fileCache->localPath);
+        return NULL;
+    }
+    return tmpIFuseConn;
 }
 
-void _waitForConn() {
-    connReqWait_t myConnReqWait;
-	bzero (&myConnReqWait, sizeof (myConnReqWait));
-	initConnReqWaitMutex(&myConnReqWait);
-	addToConcurrentList(ConnReqWaitQue, &myConnReqWait);
+/* setFileCacheConn - the server handle of fileCache is open on iFuseConn,
+ * NULL once it is closed. the conn is kept, and not reaped, until then.
+ * precond: lock fileCache or single thread use */
+int setFileCacheConn( fileCache_t *fileCache, iFuseConn_t *iFuseConn ) {
+    iFuseConn_t *oldIFuseConn = fileCache->iFuseConn;
 
-	while (myConnReqWait.state == 0) {
-		timeoutWait (&myConnReqWait.mutex, &myConnReqWait.cond, CONN_REQ_SLEEP_TIME);
-	}
+    if(oldIFuseConn == iFuseConn) {
+        return 0;
+    }
+    if(iFuseConn != NULL) {
+        holdIFuseConn(iFuseConn);
+    }
+    fileCache->iFuseConn = iFuseConn;
+    if(oldIFuseConn != NULL) {
+        unholdIFuseConn(oldIFuseConn);
+    }
+    return 0;
+}
 
-	deleteConnReqWaitMutex(&myConnReqWait);
+/* holdIFuseConn - a server handle is open on iFuseConn. the conn is kept,
+ * and not reaped, until unholdIFuseConn */
+int holdIFuseConn( iFuseConn_t *iFuseConn ) {
+    LOCK_STRUCT(*iFuseConn);
+    iFuseConn->status++;
+    iFuseConn->handleCnt++;
+    UNLOCK_STRUCT(*iFuseConn);
+    return 0;
 }
 
-int _getAndUseIFuseConn( iFuseConn_t **iFuseConn ) {
+int unholdIFuseConn( iFuseConn_t *iFuseConn ) {
+    LOCK_STRUCT(*iFuseConn);
+    iFuseConn->handleCnt--;
+    UNLOCK_STRUCT(*iFuseConn);
+    return unrefIFuseConn(iFuseConn);
+}
+
+/* useHeldIFuseConn - use a conn a server handle is open on. waits for the
+ * conn if it is busy. -EBADF if a failed reconnect lost it, and the handle
+ * with it */
+int useHeldIFuseConn( iFuseConn_t *iFuseConn ) {
     int status;
-    iFuseConn_t *tmpIFuseConn;
 
-    *iFuseConn = NULL;
+    LOCK_STRUCT(*iFuseConn);
+    if(iFuseConn->conn == NULL) {
+        UNLOCK_STRUCT(*iFuseConn);
+        return -EBADF;
+    }
+    _takeFreeConn(iFuseConn->pool, iFuseConn);
+    status = _useIFuseConn(iFuseConn);
+    UNLOCK_STRUCT(*iFuseConn);
+    return status;
+}
 
-    while (*iFuseConn == NULL) {
-        /* get a free IFuseConn */
+/* precond: lock paca */
+int _getAndUseConnForPathCache(iFuseConn_t **iFuseConn, pathCache_t *paca) {
+	return _getAndUseConnOfPool(iFuseConn, paca, NULL);
+}
 
-        if (listSize(ConnectedConn) >= MAX_NUM_CONN && listSize(FreeConn) == 0) {
-            /* have to wait */
-        	_waitForConn();
-			/* start from begining */
-			continue;
-        }
-        else {
-			tmpIFuseConn = (iFuseConn_t *) removeFirstElementOfConcurrentList(FreeConn);
-			if(tmpIFuseConn == NULL) {
-				if(listSize(ConnectedConn) < MAX_NUM_CONN) {
-			        /* may cause num of conn > max num of conn */
-			        /* get here when nothing free. make one */
-			        tmpIFuseConn = newIFuseConn(&status);
-			        if (status < 0) {
-						_freeIFuseConn(tmpIFuseConn);
-						return status;
-					}
-
-			        _useFreeIFuseConn (tmpIFuseConn);
-			        addToConcurrentList(ConnectedConn, tmpIFuseConn);
-
-			        *iFuseConn = tmpIFuseConn;
-			        break;
+int getAndUseIFuseConn( iFuseConn_t **iFuseConn ) {
+    int ret = _getAndUseIFuseConn( iFuseConn );
+	return ret;
 
-				}
-				_waitForConn();
-				continue;
-            }
-            else {
-				useIFuseConn(tmpIFuseConn);
-				*iFuseConn = tmpIFuseConn;
-				break;
-			}
-        }
+}
 
+/* for background work. get a connection only if one is idle or a new one
+ * can be made while leaving room for foreground requests. never waits */
+int getAndUseSpareIFuseConn( iFuseConn_t **iFuseConn ) {
+    int status;
+    iFuseConnPool_t *pool = DefaultConnPool;
+    iFuseConn_t *tmpIFuseConn;
 
-    }	/* while *iFuseConn */
+    *iFuseConn = NULL;
 
-    if (++ConnManagerStarted == HIGH_NUM_CONN) {
-	/* don't do it the first time */
+    pthread_mutex_lock(&ConnPoolLock);
+    tmpIFuseConn = _popFreeConn(pool);
+    if(tmpIFuseConn != NULL) {
+        pool->numBusy++;
+        _noteConnDemand(pool);
+        ConnPoolStats.reused++;
+        pthread_mutex_unlock(&ConnPoolLock);
 
-#ifdef USE_BOOST
-    	ConnManagerThr = new boost::thread( connManager );
-#else
-        status = pthread_create  (&ConnManagerThr, pthread_attr_default,(void *(*)(void *)) connManager, (void *) NULL);
-#endif
-        if (status < 0) {
-        	ConnManagerStarted--;
-            rodsLog (LOG_ERROR, "pthread_create failure, status = %d", status);
+        status = useIFuseConn(tmpIFuseConn);
+        if(status < 0) {
+            return status;
         }
+        *iFuseConn = tmpIFuseConn;
+        return 0;
     }
-    return 0;
+
+    if(pool->numConn >= ConnPoolConfig.maxConn - 1) {
+        pthread_mutex_unlock(&ConnPoolLock);
+        return -EAGAIN;
+    }
+
+    return _newConnOfPool(pool, iFuseConn);
+}
+
+int _getAndUseIFuseConn( iFuseConn_t **iFuseConn ) {
+    return _getAndUseConnFromPool( DefaultConnPool, iFuseConn );
 }
 
 int
@@ -210,6 +414,10 @@ _useIFuseConn( iFuseConn_t *iFuseConn ) {
     LOCK_STRUCT(*iFuseConn);
     iFuseConn->inuseCnt++;
     iFuseConn->pendingCnt--;
+    if (iFuseConn->conn == NULL) {
+        /* the previous user failed to reconnect */
+        _ifuseConnect (iFuseConn, &MyRodsEnv);
+    }
 
     /* move unlock to caller site */
     /* UNLOCK (ConnLock); */
@@ -229,53 +437,39 @@ _useFreeIFuseConn( iFuseConn_t *iFuseConn ) {
 
 int
 unuseIFuseConn( iFuseConn_t *iFuseConn ) {
-    if ( iFuseConn == NULL || iFuseConn->conn == NULL ) {
+    if ( iFuseConn == NULL ) {
         return USER__NULL_INPUT_ERR;
     }
-	LOCK_STRUCT(*iFuseConn);
-    iFuseConn->actTime = time (NULL);
-    iFuseConn->inuseCnt--;
-    if(iFuseConn->pendingCnt == 0) {
-    	addToConcurrentList(FreeConn, iFuseConn);
+    return _releaseIFuseConn (iFuseConn, 1);
+}
+
+/* drop a reference of a path cache. a conn dropped from its pool is freed
+ * with its last reference */
+int
+unrefIFuseConn( iFuseConn_t *iFuseConn ) {
+    int unused;
+
+    if ( iFuseConn == NULL ) {
+        return USER__NULL_INPUT_ERR;
     }
+
+    LOCK_STRUCT(*iFuseConn);
+    iFuseConn->status--;
+    unused = iFuseConn->status == 0 && iFuseConn->conn == NULL &&
+        iFuseConn->inuseCnt == 0 && iFuseConn->pendingCnt == 0;
     UNLOCK_STRUCT(*iFuseConn);
-    UNLOCK(iFuseConn->inuseLock);
-    signalConnManager ();
+
+    if (unused) {
+        _freeIFuseConn (iFuseConn);
+    }
     return 0;
 }
 
 int
 ifuseConnect( iFuseConn_t *iFuseConn, rodsEnv *myRodsEnv ) {
-	int status = 0;
+	int status;
 	LOCK_STRUCT(*iFuseConn);
-	if(iFuseConn->conn == NULL) {
-		rErrMsg_t errMsg;
-		iFuseConn->conn = rcConnect (myRodsEnv->rodsHost, myRodsEnv->rodsPort,
-		  myRodsEnv->rodsUserName, myRodsEnv->rodsZone, NO_RECONN, &errMsg);
-
-		if (iFuseConn->conn == NULL) {
-		/* try one more */
-			iFuseConn->conn = rcConnect (myRodsEnv->rodsHost, myRodsEnv->rodsPort,
-			  myRodsEnv->rodsUserName, myRodsEnv->rodsZone, NO_RECONN, &errMsg);
-		if (iFuseConn->conn == NULL) {
-				rodsLogError (LOG_ERROR, errMsg.status,
-				  "ifuseConnect: rcConnect failure %s", errMsg.msg);
-				UNLOCK_STRUCT(*iFuseConn);
-				if (errMsg.status < 0) {
-                    return errMsg.status;
-                }
-                else {
-                    return -1;
-				}
-			}
-		}
-
-		status = clientLogin (iFuseConn->conn);
-		if (status != 0) {
-			rcDisconnect (iFuseConn->conn);
-			iFuseConn->conn=NULL;
-		}
-	}
+	status = _ifuseConnect (iFuseConn, myRodsEnv);
     UNLOCK_STRUCT(*iFuseConn);
     return status;
 }
@@ -296,18 +490,38 @@ void ifuseDisconnect(iFuseConn_t *tmpIFuseConn) {
 
 int
 signalConnManager() {
-	if (listSize(ConnectedConn) > HIGH_NUM_CONN) {
-        notifyTimeoutWait(&ConnManagerLock, &ConnManagerCond);
-    }
+    notifyTimeoutWait(&ConnManagerLock, &ConnManagerCond);
     return 0;
 }
 
 int
 disconnectAll() {
+    iFuseConnPool_t *pool;
     iFuseConn_t *tmpIFuseConn;
-    while ((tmpIFuseConn = (iFuseConn_t *) removeFirstElementOfConcurrentList(ConnectedConn)) != NULL) {
-    	ifuseDisconnect(tmpIFuseConn);
-	}
+
+    if (ConnManagerStarted) {
+        ConnManagerStop = 1;
+        signalConnManager ();
+#ifdef USE_BOOST
+        ConnManagerThr->join();
+#else
+        pthread_join (ConnManagerThr, NULL);
+#endif
+        ConnManagerStarted = 0;
+    }
+
+    pthread_mutex_lock(&ConnPoolLock);
+    for (pool = ConnPools; pool != NULL; pool = pool->next) {
+        while (pool->conns->head != NULL) {
+            tmpIFuseConn = (iFuseConn_t *) pool->conns->head->value;
+            listRemoveNoRegion(pool->conns, pool->conns->head);
+            pthread_mutex_unlock(&ConnPoolLock);
+            ifuseDisconnect(tmpIFuseConn);
+            pthread_mutex_lock(&ConnPoolLock);
+        }
+        clearListNoRegion(pool->freeConns);
+    }
+    pthread_mutex_unlock(&ConnPoolLock);
     return 0;
 }
 /* have to do this after getIFuseConn - lock */
@@ -327,76 +541,543 @@ ifuseReconnect( iFuseConn_t *iFuseConn ) {
 
 void
 connManager() {
+    iFuseConnPool_t *pool;
     time_t curTime;
+
+    while (!ConnManagerStop) {
+        curTime = time (NULL);
+
+        /* pools are only added in front, the rest of the list never changes */
+        pthread_mutex_lock(&ConnPoolLock);
+        pool = ConnPools;
+        pthread_mutex_unlock(&ConnPoolLock);
+
+        while (pool != NULL) {
+            _sizeConnPool(pool, curTime);
+            _checkConnPool(pool, curTime);
+            _prewarmConnPool(pool);
+            pool = pool->next;
+        }
+
+        timeoutWait(&ConnManagerLock, &ConnManagerCond, 1);
+    }
+}
+
+/**************************************************************************
+ * private functions
+ **************************************************************************/
+static iFuseConnPool_t *
+_newConnPool(char *host, int minConn) {
+    iFuseConnPool_t *pool = (iFuseConnPool_t *) malloc (sizeof (iFuseConnPool_t));
+    if (pool == NULL) {
+        return NULL;
+    }
+
+    bzero (pool, sizeof (iFuseConnPool_t));
+    rstrcpy (pool->host, host, NAME_LEN);
+    pool->conns = newListNoRegion();
+    pool->freeConns = newListNoRegion();
+    pool->waiters = newListNoRegion();
+    pool->minConn = minConn;
+    pool->target = minConn;
+    ConnPoolStats.hosts++;
+    return pool;
+}
+
+/* the pool of a resource server, made on first use. only the pool of
+ * rodsHost keeps minConn connections */
+static iFuseConnPool_t *
+_getConnPool(char *host) {
+    iFuseConnPool_t *pool;
+
+    pthread_mutex_lock(&ConnPoolLock);
+    for (pool = ConnPools; pool != NULL; pool = pool->next) {
+        if (strcmp (pool->host, host) == 0) {
+            break;
+        }
+    }
+
+    if (pool == NULL) {
+        pool = _newConnPool(host, 0);
+        if (pool != NULL) {
+            pool->next = ConnPools;
+            ConnPools = pool;
+        }
+    }
+    pthread_mutex_unlock(&ConnPoolLock);
+    return pool;
+}
+
+/* get a connection of the pool. waits until one is released if the pool
+ * is at maxConn, the releasing thread hands it over */
+static int
+_getAndUseConnFromPool( iFuseConnPool_t *pool, iFuseConn_t **iFuseConn ) {
+    int status;
+    iFuseConn_t *tmpIFuseConn;
+    connReqWait_t myConnReqWait;
+
+    *iFuseConn = NULL;
+
+    pthread_mutex_lock(&ConnPoolLock);
+    while (*iFuseConn == NULL) {
+        /* get a free IFuseConn */
+        tmpIFuseConn = _popFreeConn(pool);
+        if (tmpIFuseConn != NULL) {
+            pool->numBusy++;
+            _noteConnDemand(pool);
+            ConnPoolStats.reused++;
+            pthread_mutex_unlock(&ConnPoolLock);
+
+            status = useIFuseConn(tmpIFuseConn);
+            if (status < 0) {
+                return status;
+            }
+            *iFuseConn = tmpIFuseConn;
+            return 0;
+        }
+
+        if (pool->numConn < ConnPoolConfig.maxConn) {
+            /* get here when nothing free. make one */
+            return _newConnOfPool(pool, iFuseConn);
+        }
+
+        /* have to wait */
+        bzero (&myConnReqWait, sizeof (myConnReqWait));
+        initConnReqWaitMutex(&myConnReqWait);
+        listAppendNoRegion(pool->waiters, &myConnReqWait);
+        _noteConnDemand(pool);
+        ConnPoolStats.waits++;
+        pthread_mutex_unlock(&ConnPoolLock);
+
+        waitConnReq(&myConnReqWait);
+        deleteConnReqWaitMutex(&myConnReqWait);
+
+        tmpIFuseConn = myConnReqWait.iFuseConn;
+        if (tmpIFuseConn != NULL) {
+            /* handed over, it was counted busy for us */
+            status = useIFuseConn(tmpIFuseConn);
+            if (status < 0) {
+                return status;
+            }
+            *iFuseConn = tmpIFuseConn;
+            return 0;
+        }
+
+        /* a conn went away, start from begining */
+        pthread_mutex_lock(&ConnPoolLock);
+    }
+    pthread_mutex_unlock(&ConnPoolLock);
+    return 0;
+}
+
+/* precond: lock ConnPoolLock, unlocked on return. connect a new conn of
+ * the pool for the caller */
+static int
+_newConnOfPool( iFuseConnPool_t *pool, iFuseConn_t **iFuseConn ) {
+    int status;
+    iFuseConn_t *tmpIFuseConn;
+
+    pool->numConn++;
+    pool->numBusy++;
+    _noteConnDemand(pool);
+    pthread_mutex_unlock(&ConnPoolLock);
+
+    tmpIFuseConn = newIFuseConn(pool, &status);
+    if (status < 0) {
+        if (tmpIFuseConn != NULL) {
+            _freeIFuseConn(tmpIFuseConn);
+        }
+        pthread_mutex_lock(&ConnPoolLock);
+        pool->numConn--;
+        pool->numBusy--;
+        _wakeConnWaiter(pool);
+        pthread_mutex_unlock(&ConnPoolLock);
+        return status;
+    }
+
+    _useFreeIFuseConn (tmpIFuseConn);
+
+    pthread_mutex_lock(&ConnPoolLock);
+    listAppendNoRegion(pool->conns, tmpIFuseConn);
+    ConnPoolStats.connections++;
+    ConnPoolStats.created++;
+    pthread_mutex_unlock(&ConnPoolLock);
+
+    *iFuseConn = tmpIFuseConn;
+    return 0;
+}
+
+/* precond: lock paca. pool is where a new conn is taken from, NULL for the
+ * pool of the conn of the path */
+static int
+_getAndUseConnOfPool(iFuseConn_t **iFuseConn, pathCache_t *paca, iFuseConnPool_t *pool) {
+	int status;
+    iFuseConn_t *tmpIFuseConn;
+
+	/* if connection already closed by connection manager, get new ifuseconn */
+    if(paca->iFuseConn != NULL) {
+        tmpIFuseConn = paca->iFuseConn;
+    	LOCK_STRUCT(*tmpIFuseConn);
+        if(pool == NULL) {
+            pool = tmpIFuseConn->pool;
+        }
+    	if(tmpIFuseConn->conn != NULL && tmpIFuseConn->pool == pool) {
+    		if(tmpIFuseConn->inuseCnt == 0) {
+                _takeFreeConn(pool, tmpIFuseConn);
+				_useIFuseConn(tmpIFuseConn);
+				UNLOCK_STRUCT(*tmpIFuseConn);
+				*iFuseConn = tmpIFuseConn;
+				return 0;
+            }
+            else {
+				UNLOCK_STRUCT(*tmpIFuseConn);
+    		}
+        }
+        else {
+    		UNLOCK_STRUCT(*tmpIFuseConn);
+    		/* disconnected or of another host, not needed by the path anymore */
+            paca->iFuseConn = NULL;
+			unrefIFuseConn(tmpIFuseConn);
+    	}
+    }
+
+    if(pool == NULL) {
+        pool = DefaultConnPool;
+    }
+
+    status = _getAndUseConnFromPool( pool, &tmpIFuseConn );
+	if(status < 0) {
+		rodsLog (LOG_ERROR,
+			  "ifuseClose: cannot get ifuse connection for %s error, status = %d",
+			   paca->localPath, status);
+		return status;
+	}
+
+    /* the conn of the path is in use, the new one takes its place */
+    if(paca->iFuseConn != NULL) {
+        unrefIFuseConn(paca->iFuseConn);
+    }
+    /* conn in use, cannot be deleted by conn manager
+     * therefore, it is safe to do the following without locking conn */
+    REF(paca->iFuseConn, tmpIFuseConn);
+    *iFuseConn = paca->iFuseConn;
+	return 0;
+}
+
+/* give a conn back, active unless the conn manager used it for a check */
+static int
+_releaseIFuseConn( iFuseConn_t *iFuseConn, int active ) {
+    iFuseConnPool_t *pool = iFuseConn->pool;
+    int unused = 0;
+
+	LOCK_STRUCT(*iFuseConn);
+    if (active) {
+        iFuseConn->actTime = time (NULL);
+    }
+    iFuseConn->inuseCnt--;
+    if (iFuseConn->inuseCnt == 0 && iFuseConn->pendingCnt == 0) {
+        if (iFuseConn->conn == NULL) {
+            /* lost by a failed reconnect, try once more before dropping it */
+            _ifuseConnect (iFuseConn, &MyRodsEnv);
+        }
+
+        pthread_mutex_lock(&ConnPoolLock);
+        if (iFuseConn->conn != NULL) {
+            _putConnToPool (pool, iFuseConn, 1);
+        }
+        else {
+            listRemoveNoRegion2 (pool->conns, iFuseConn);
+            pool->numConn--;
+            pool->numBusy--;
+            ConnPoolStats.connections--;
+            _wakeConnWaiter (pool);
+            unused = iFuseConn->status == 0;
+        }
+        pthread_mutex_unlock(&ConnPoolLock);
+    }
+    UNLOCK_STRUCT(*iFuseConn);
+    UNLOCK(iFuseConn->inuseLock);
+
+    if (unused) {
+        _freeIFuseConn (iFuseConn);
+    }
+    return 0;
+}
+
+/* precond: lock iFuseConn. a free conn used through its path is busy */
+static void
+_takeFreeConn(iFuseConnPool_t *pool, iFuseConn_t *iFuseConn) {
+    pthread_mutex_lock(&ConnPoolLock);
+    if (iFuseConn->isFree) {
+        listRemoveNoRegion2(pool->freeConns, iFuseConn);
+        iFuseConn->isFree = 0;
+        pool->numBusy++;
+        _noteConnDemand(pool);
+        ConnPoolStats.reused++;
+    }
+    pthread_mutex_unlock(&ConnPoolLock);
+}
+
+/* precond: lock ConnPoolLock. the most recently used conn is the least
+ * likely to have been closed by the server */
+static iFuseConn_t *
+_popFreeConn(iFuseConnPool_t *pool) {
+    iFuseConn_t *tmpIFuseConn;
+
+    if (pool->freeConns->tail == NULL) {
+        return NULL;
+    }
+
+    tmpIFuseConn = (iFuseConn_t *) pool->freeConns->tail->value;
+    listRemoveNoRegion(pool->freeConns, pool->freeConns->tail);
+    tmpIFuseConn->isFree = 0;
+    return tmpIFuseConn;
+}
+
+/* precond: lock ConnPoolLock. hand an idle conn to the oldest waiter or
+ * put it on the free list. busy if it was counted busy */
+static void
+_putConnToPool(iFuseConnPool_t *pool, iFuseConn_t *iFuseConn, int busy) {
+    connReqWait_t *myConnReqWait;
+
+    if (pool->waiters->head != NULL) {
+        myConnReqWait = (connReqWait_t *) pool->waiters->head->value;
+        listRemoveNoRegion(pool->waiters, pool->waiters->head);
+        if (!busy) {
+            pool->numBusy++;
+        }
+        ConnPoolStats.handoffs++;
+        myConnReqWait->iFuseConn = iFuseConn;
+        notifyConnReq(myConnReqWait);
+        return;
+    }
+
+    if (busy) {
+        pool->numBusy--;
+    }
+    iFuseConn->isFree = 1;
+    listAppendNoRegion(pool->freeConns, iFuseConn);
+}
+
+/* precond: lock ConnPoolLock. a conn went away, the oldest waiter may
+ * make a new one */
+static void
+_wakeConnWaiter(iFuseConnPool_t *pool) {
+    connReqWait_t *myConnReqWait;
+
+    if (pool->waiters->head == NULL) {
+        return;
+    }
+
+    myConnReqWait = (connReqWait_t *) pool->waiters->head->value;
+    listRemoveNoRegion(pool->waiters, pool->waiters->head);
+    myConnReqWait->iFuseConn = NULL;
+    notifyConnReq(myConnReqWait);
+}
+
+/* precond: lock ConnPoolLock */
+static void
+_noteConnDemand(iFuseConnPool_t *pool) {
+    int demand = pool->numBusy + pool->waiters->size;
+    if (demand > pool->peak) {
+        pool->peak = demand;
+    }
+}
+
+/* keep the peak demand of every second of the window, the pool is sized
+ * for the largest with one spare conn */
+static void
+_sizeConnPool(iFuseConnPool_t *pool, time_t curTime) {
+    int maxDemand = 0;
+    int i;
+
+    pthread_mutex_lock(&ConnPoolLock);
+    if (curTime != pool->sampleTime) {
+        time_t t = pool->sampleTime + 1;
+        if (curTime - t >= CONN_POOL_DEMAND_WINDOW) {
+            t = curTime - CONN_POOL_DEMAND_WINDOW + 1;
+        }
+        /* seconds the manager slept through had no peak of their own */
+        for (; t < curTime; t++) {
+            pool->demand[t % CONN_POOL_DEMAND_WINDOW] = 0;
+        }
+        pool->demand[curTime % CONN_POOL_DEMAND_WINDOW] = pool->peak;
+        pool->sampleTime = curTime;
+    }
+    else if (pool->peak > pool->demand[curTime % CONN_POOL_DEMAND_WINDOW]) {
+        pool->demand[curTime % CONN_POOL_DEMAND_WINDOW] = pool->peak;
+    }
+    pool->peak = pool->numBusy + pool->waiters->size;
+
+    for (i = 0; i < CONN_POOL_DEMAND_WINDOW; i++) {
+        if (pool->demand[i] > maxDemand) {
+            maxDemand = pool->demand[i];
+        }
+    }
+
+    pool->target = maxDemand > 0 ? maxDemand + 1 : 0;
+    if (pool->target < pool->minConn) {
+        pool->target = pool->minConn;
+    }
+    if (pool->target > ConnPoolConfig.maxConn) {
+        pool->target = ConnPoolConfig.maxConn;
+    }
+    pthread_mutex_unlock(&ConnPoolLock);
+}
+
+/* close free conns idle for idleTimeout above the pool size, check the
+ * others idle for checkInterval */
+static void
+_checkConnPool(iFuseConnPool_t *pool, time_t curTime) {
+    List *checkList = newListNoRegion();
+    List *closeList = newListNoRegion();
     iFuseConn_t *tmpIFuseConn;
     ListNode *node;
-    List *TimeOutList = newListNoRegion();
 
-    while (1) {
-        curTime = time (NULL);
+    pthread_mutex_lock(&ConnPoolLock);
+    node = pool->freeConns->head;
+    while (node != NULL) {
+        tmpIFuseConn = (iFuseConn_t *) node->value;
+        node = node->next;
 
-		/* exceed high water mark for number of connection ? */
-		if (listSize(ConnectedConn) > HIGH_NUM_CONN) {
+        /* the conn lock comes first, a conn being taken through its path is skipped */
+        if (TRYLOCK_STRUCT(*tmpIFuseConn) != 0) {
+            continue;
+        }
 
-			LOCK_STRUCT(*ConnectedConn);
-			int disconnTarget = _listSize(ConnectedConn) - HIGH_NUM_CONN;
-	        node = ConnectedConn->list->head;
-	        while (node != NULL) {
-	        	tmpIFuseConn = (iFuseConn_t *) node->value;
-				if (tmpIFuseConn->inuseCnt == 0 && tmpIFuseConn->pendingCnt == 0 && curTime - tmpIFuseConn->actTime > IFUSE_CONN_TIMEOUT) {
-					listAppendNoRegion(TimeOutList, tmpIFuseConn);
-				}
-				node = node->next;
-			}
-	        UNLOCK_STRUCT(*ConnectedConn);
-
-			node = TimeOutList->head;
-			int disconned = 0;
-			while (node != NULL && disconned < disconnTarget) {
-				tmpIFuseConn = (iFuseConn_t *) node->value;
-				LOCK_STRUCT(*tmpIFuseConn);
-				if (tmpIFuseConn->inuseCnt == 0 && tmpIFuseConn->pendingCnt == 0 && curTime - tmpIFuseConn->actTime > IFUSE_CONN_TIMEOUT) {
-					removeFromConcurrentList2(FreeConn, tmpIFuseConn);
-					removeFromConcurrentList2(ConnectedConn, tmpIFuseConn);
-					if(tmpIFuseConn->status == 0) { /* no struct is referring to it, we can unlock it and free it */
-						UNLOCK_STRUCT(*tmpIFuseConn);
-						/* rodsLog(LOG_ERROR, "[FREE IFUSE CONN] %s:%d %p", __FILE__, __LINE__, tmpIFuseConn); */
-						_freeIFuseConn(tmpIFuseConn);
-                    }
-                    else {   /* set to timed out */
-						_ifuseDisconnect(tmpIFuseConn);
-						UNLOCK_STRUCT(*tmpIFuseConn);
-					}
-					disconned ++;
+        /* a conn with open handles is kept, they would be lost with it */
+        if (pool->numConn > pool->target && tmpIFuseConn->handleCnt == 0 &&
+          curTime - tmpIFuseConn->actTime > ConnPoolConfig.idleTimeout) {
+            listRemoveNoRegion2(pool->freeConns, tmpIFuseConn);
+            listRemoveNoRegion2(pool->conns, tmpIFuseConn);
+            tmpIFuseConn->isFree = 0;
+            pool->numConn--;
+            ConnPoolStats.connections--;
+            ConnPoolStats.reaped++;
+            if (tmpIFuseConn->status == 0) {
+                /* no struct is referring to it, we can free it */
+                listAppendNoRegion(closeList, tmpIFuseConn);
+            }
+            else {
+                /* set to timed out, the path cache frees it */
+                _ifuseDisconnect(tmpIFuseConn);
+            }
+        }
+        else if (ConnPoolConfig.checkInterval > 0 &&
+          curTime - tmpIFuseConn->actTime >= ConnPoolConfig.checkInterval &&
+          curTime - tmpIFuseConn->checkTime >= ConnPoolConfig.checkInterval) {
+            listRemoveNoRegion2(pool->freeConns, tmpIFuseConn);
+            tmpIFuseConn->isFree = 0;
+            tmpIFuseConn->checkTime = curTime;
+            pool->numBusy++;
+            tmpIFuseConn->inuseCnt++;
+            LOCK(tmpIFuseConn->inuseLock);
+            listAppendNoRegion(checkList, tmpIFuseConn);
+        }
+        UNLOCK_STRUCT(*tmpIFuseConn);
+    }
+    pthread_mutex_unlock(&ConnPoolLock);
+
+    for (node = closeList->head; node != NULL; node = node->next) {
+        _freeIFuseConn((iFuseConn_t *) node->value);
+    }
+
+    for (node = checkList->head; node != NULL; node = node->next) {
+        miscSvrInfo_t *outSvrInfo = NULL;
+        int status;
+
+        tmpIFuseConn = (iFuseConn_t *) node->value;
+        status = rcGetMiscSvrInfo (tmpIFuseConn->conn, &outSvrInfo);
+        if (outSvrInfo != NULL) {
+            free (outSvrInfo);
+        }
+
+        pthread_mutex_lock(&ConnPoolLock);
+        ConnPoolStats.checks++;
+        if (status < 0) {
+            ConnPoolStats.checkFailures++;
+        }
+        pthread_mutex_unlock(&ConnPoolLock);
+
+        if (status < 0) {
+            rodsLogError (LOG_DEBUG, status, "_checkConnPool: conn to %s failed the check, reconnecting", pool->host);
+            ifuseReconnect (tmpIFuseConn);
+        }
+        _releaseIFuseConn (tmpIFuseConn, 0);
+    }
+
+    clearListNoRegion(checkList);
+    deleteListNoRegion(checkList);
+    clearListNoRegion(closeList);
+    deleteListNoRegion(closeList);
+}
+
+/* connect up to the pool size off the request path */
+static void
+_prewarmConnPool(iFuseConnPool_t *pool) {
+    iFuseConn_t *tmpIFuseConn;
+    int status;
+
+    pthread_mutex_lock(&ConnPoolLock);
+    while (!ConnManagerStop && pool->numConn < pool->target) {
+        pool->numConn++;
+        pthread_mutex_unlock(&ConnPoolLock);
+
+        tmpIFuseConn = newIFuseConn(pool, &status);
+
+        pthread_mutex_lock(&ConnPoolLock);
+        if (status < 0) {
+            pool->numConn--;
+            _wakeConnWaiter(pool);
+            pthread_mutex_unlock(&ConnPoolLock);
+            if (tmpIFuseConn != NULL) {
+                _freeIFuseConn(tmpIFuseConn);
+            }
+            /* try again next time */
+            return;
+        }
+
+        tmpIFuseConn->actTime = time (NULL);
+        tmpIFuseConn->checkTime = tmpIFuseConn->actTime;
+        listAppendNoRegion(pool->conns, tmpIFuseConn);
+        ConnPoolStats.connections++;
+        ConnPoolStats.prewarmed++;
+        _putConnToPool(pool, tmpIFuseConn, 0);
+    }
+    pthread_mutex_unlock(&ConnPoolLock);
+}
+
+/* precond: lock iFuseConn */
+static int
+_ifuseConnect( iFuseConn_t *iFuseConn, rodsEnv *myRodsEnv ) {
+	int status = 0;
+	if(iFuseConn->conn == NULL) {
+		rErrMsg_t errMsg;
+		char *host = iFuseConn->pool != NULL ? iFuseConn->pool->host : myRodsEnv->rodsHost;
+		iFuseConn->conn = rcConnect (host, myRodsEnv->rodsPort,
+		  myRodsEnv->rodsUserName, myRodsEnv->rodsZone, NO_RECONN, &errMsg);
+
+		if (iFuseConn->conn == NULL) {
+		/* try one more */
+			iFuseConn->conn = rcConnect (host, myRodsEnv->rodsPort,
+			  myRodsEnv->rodsUserName, myRodsEnv->rodsZone, NO_RECONN, &errMsg);
+		if (iFuseConn->conn == NULL) {
+				rodsLogError (LOG_ERROR, errMsg.status,
+				  "ifuseConnect: rcConnect failure %s", errMsg.msg);
+				if (errMsg.status < 0) {
+                    return errMsg.status;
                 }
                 else {
-					UNLOCK_STRUCT(*tmpIFuseConn);
+                    return -1;
 				}
-				node = node->next;
 			}
-	    	clearListNoRegion(TimeOutList);
 		}
 
-		while (listSize(ConnectedConn) <= MAX_NUM_CONN || listSize(FreeConn) != 0) {
-			/* signal one in the wait queue */
-			connReqWait_t *myConnReqWait = (connReqWait_t *) removeFirstElementOfConcurrentList(ConnReqWaitQue);
-			/* if there is no conn req left, exit loop */
-			if(myConnReqWait == NULL) {
-				break;
-			}
-			myConnReqWait->state = 1;
-			notifyTimeoutWait(&myConnReqWait->mutex, &myConnReqWait->cond);
+		status = clientLogin (iFuseConn->conn);
+		if (status != 0) {
+			rcDisconnect (iFuseConn->conn);
+			iFuseConn->conn=NULL;
 		}
-	#if 0
-			rodsSleep (CONN_MANAGER_SLEEP_TIME, 0);
-	#else
-			timeoutWait(&ConnManagerLock, &ConnManagerCond, CONN_MANAGER_SLEEP_TIME);
-	#endif
-	
-
-    }
-    deleteListNoRegion(TimeOutList);
+	}
+    return status;
 }
-
-
-
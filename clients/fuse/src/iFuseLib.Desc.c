@@ -10,13 +10,31 @@
 #include "iFuseOper.h"
 #include "hashtable.h"
 #include "list.h"
+#ifdef ENABLE_READAHEAD
+#include "iFuseLib.Readahead.h"
+#endif
+#ifdef ENABLE_BLOCK_CACHE
+#include "iFuseLib.BlockCache.h"
+#endif
+#ifdef ENABLE_WRITE_BUFFER
+#include "iFuseLib.WriteBuffer.h"
+#endif
 
-/* Lock DescLock when this array is read/writen, or the inUseFlag var in an array element is read/written.
- * Locking DescLock prevent allocating/freeing new IFuseDesc.
- * After being added to the pathCache or newlyCreatedCache,
- * LOCK_STRUCT when an array element (except its inUseFlag) is read/written */
-iFuseDesc_t IFuseDesc[MAX_IFUSE_DESC];
-concurrentList_t *IFuseDescFreeList;
+/* Descriptors live in chunks of IFUSE_DESC_CHUNK_SIZE that are allocated
+ * when the free stack runs dry and are never moved or freed, so a descriptor
+ * is reached from its index without a lock. Free descriptors are kept on a
+ * lock-free stack whose top packs a change counter (high 32 bits) with the
+ * (index + 1) of the top descriptor, the counter keeps a pop from succeeding
+ * on a top that was popped and pushed back meanwhile.
+ * LOCK_STRUCT when a descriptor in use is read/written */
+static iFuseDesc_t *IFuseDescChunks[MAX_IFUSE_DESC_CHUNKS];
+static volatile int NumIFuseDesc = 0;
+static volatile uint64_t IFuseDescFreeTop = 0;
+static pthread_mutex_t IFuseDescGrowLock;
+
+static void _pushFreeIFuseDesc (iFuseDesc_t *desc);
+static iFuseDesc_t *_popFreeIFuseDesc ();
+static iFuseDesc_t *_growIFuseDesc ();
 
 int
 initIFuseDesc() {
@@ -24,20 +42,40 @@ initIFuseDesc() {
     //pthread_mutex_init (&PathCacheLock, NULL);
     pthread_mutex_init (&ConnManagerLock, NULL);
     pthread_cond_init (&ConnManagerCond, NULL);
-    IFuseDescFreeList = newConcurrentList();
-    int i;
-    for(i=0;i<MAX_IFUSE_DESC;i++) {
-    	INIT_STRUCT_LOCK(IFuseDesc[i]);
-    	IFuseDesc[i].index = i;
-    	if(i>=3) {
-    		addToConcurrentList(IFuseDescFreeList, &IFuseDesc[i]);
-    	}
+    pthread_mutex_init (&IFuseDescGrowLock, NULL);
+    /* the first chunk, 0 - 2 are never handed out */
+    iFuseDesc_t *desc = _growIFuseDesc ();
+    if (desc == NULL) {
+        return SYS_MALLOC_ERR;
     }
+    _pushFreeIFuseDesc (desc);
 #endif
-    // JMC - overwrites objects construction? -  memset (IFuseDesc, 0, sizeof (iFuseDesc_t) * MAX_IFUSE_DESC);
     return 0;
 }
 
+iFuseDesc_t *
+getIFuseDesc( int descInx ) {
+    if (descInx < 0 || descInx >= NumIFuseDesc) {
+        return NULL;
+    }
+    return &IFuseDescChunks[descInx / IFUSE_DESC_CHUNK_SIZE][descInx % IFUSE_DESC_CHUNK_SIZE];
+}
+
+/* take a free descriptor, growing the table if there is none */
+iFuseDesc_t *
+allocIFuseDesc() {
+    iFuseDesc_t *desc = _popFreeIFuseDesc ();
+    if (desc == NULL) {
+        desc = _growIFuseDesc ();
+    }
+    return desc;
+}
+
+void
+releaseIFuseDesc( iFuseDesc_t *desc ) {
+    _pushFreeIFuseDesc (desc);
+}
+
 int _lockDesc(iFuseDesc_t *desc) {
 
 	int status = 0;
@@ -59,12 +97,12 @@ int
 lockDesc( int descInx ) {
     int status;
 
-    if (descInx < 3 || descInx >= MAX_IFUSE_DESC) {
+    if (descInx < 3 || descInx >= NumIFuseDesc) {
         rodsLog (LOG_ERROR,
          "lockDesc: descInx %d out of range", descInx);
         return SYS_FILE_DESC_OUT_OF_RANGE;
     }
-    status = _lockDesc(&IFuseDesc[descInx]);
+    status = _lockDesc(getIFuseDesc(descInx));
     return status;
 }
 
@@ -86,18 +124,18 @@ int _unlockDesc(iFuseDesc_t *desc) {
 int unlockDesc( int descInx ) {
     int status;
 
-    if (descInx < 3 || descInx >= MAX_IFUSE_DESC) {
+    if (descInx < 3 || descInx >= NumIFuseDesc) {
         rodsLog (LOG_ERROR,
          "unlockDesc: descInx %d out of range", descInx);
         return SYS_FILE_DESC_OUT_OF_RANGE;
     }
-    status = _unlockDesc(&IFuseDesc[descInx]);
+    status = _unlockDesc(getIFuseDesc(descInx));
     return status;
 }
 
 int
 checkFuseDesc( int descInx ) {
-    if (descInx < 3 || descInx >= MAX_IFUSE_DESC) {
+    if (descInx < 3 || descInx >= NumIFuseDesc) {
         rodsLog (LOG_ERROR,
          "checkFuseDesc: descInx %d out of range", descInx);
         return SYS_FILE_DESC_OUT_OF_RANGE;
@@ -129,19 +167,27 @@ ifuseClose( iFuseDesc_t *desc ) {
 
 	UNLOCK_STRUCT(*desc);
 	if(status < 0) {
-		rodsLogError(LOG_ERROR, status, "ifuseClose: free desc struct error",
-				desc->localPath);
+		rodsLogError(LOG_ERROR, status, "ifuseClose: free desc struct error");
 
 	}
+	else {
+		/* only once unlocked, the next owner reinitializes the lock */
+		releaseIFuseDesc(desc);
+	}
 
 	return status;
 }
 int
 ifuseFlush( int descInx ) {
     int status;
-    LOCK_STRUCT(IFuseDesc[descInx]);
-	status = _ifuseFlush (&IFuseDesc[descInx]);
-    UNLOCK_STRUCT(IFuseDesc[descInx]);
+    iFuseDesc_t *desc = getIFuseDesc(descInx);
+
+    if (desc == NULL) {
+        return SYS_FILE_DESC_OUT_OF_RANGE;
+    }
+    LOCK_STRUCT(*desc);
+	status = _ifuseFlush (desc);
+    UNLOCK_STRUCT(*desc);
 
     return status;
 }
@@ -151,6 +197,15 @@ ifuseFlush( int descInx ) {
 int
 _ifuseFlush( iFuseDesc_t *desc ) {
 	int status;
+#ifdef ENABLE_WRITE_BUFFER
+	if (desc->writeBuffer != NULL) {
+		status = flushWriteBuffer(desc->writeBuffer);
+		if(status < 0) {
+			rodsLogError(LOG_ERROR, status, "ifuseFlush: write buffer flush of %s error",
+					desc->localPath);
+		}
+	}
+#endif
 	status = iFuseFileCacheFlush(desc->fileCache);
 	if(status < 0) {
 		rodsLogError(LOG_ERROR, status, "ifuseFlush: flush of %s error",
@@ -167,7 +222,18 @@ _ifuseFlush( iFuseDesc_t *desc ) {
 /* precond: lock desc */
 int
 _ifuseWrite( iFuseDesc_t *desc, char *buf, size_t size, off_t offset ) {
-	int status = ifuseFileCacheWrite(desc->fileCache, buf, size, offset);
+	int status;
+#ifdef ENABLE_WRITE_BUFFER
+	if (desc->writeBuffer != NULL) {
+		status = writeWriteBuffer(desc->writeBuffer, buf, size, offset);
+		if(status < 0) {
+			rodsLogError(LOG_ERROR, status, "ifuseWrite: write of %s error",
+					desc->localPath);
+		}
+		return status;
+	}
+#endif
+	status = ifuseFileCacheWrite(desc->fileCache, buf, size, offset);
 	if(status < 0) {
 		rodsLogError(LOG_ERROR, status, "ifuseWrite: write of %s error",
 				desc->localPath);
@@ -177,15 +243,65 @@ _ifuseWrite( iFuseDesc_t *desc, char *buf, size_t size, off_t offset ) {
 }
 
 
-/* precond: lock desc */
-int _ifuseRead(iFuseDesc_t *desc, char *buf, size_t size, off_t offset) {
-	int status = ifuseFileCacheRead(desc->fileCache, buf, size, offset);
+/* uses only what is set when desc is opened, without the desc lock */
+static int _ifuseReadRemote(void *arg, char *buf, size_t size, off_t offset) {
+	iFuseDesc_t *desc = (iFuseDesc_t *) arg;
+	int served = 0;
+	int status;
+
+#ifdef ENABLE_READAHEAD
+	if (desc->readahead != NULL) {
+		served = readReadahead(desc->readahead, buf, size, offset);
+		if (served == (int) size) {
+			return served;
+		}
+	}
+#endif
+
+	status = ifuseFileCacheRead(desc->fileCache, buf + served, size - served, offset + served);
 	if (status < 0) {
 		rodsLogError(LOG_ERROR, status, "ifuseRead: read of %s error",
 				desc->localPath);
+		return status;
+	}
+	return served + status;
+}
 
+/* reads of the same handle may run at the same time, desc is locked only
+ * to classify the access */
+int _ifuseRead(iFuseDesc_t *desc, char *buf, size_t size, off_t offset) {
+	int streaming;
+
+	LOCK_STRUCT(*desc);
+	if (offset >= desc->nextReadOffset - DESC_SEQ_READ_SLACK &&
+			offset <= desc->nextReadOffset + DESC_SEQ_READ_SLACK) {
+		desc->seqReads++;
+	} else {
+		desc->randomReads++;
+		if (desc->streaming && IS_RANDOM_DESC_ACCESS(desc)) {
+			/* no stream after all, cached blocks will be read again */
+			desc->streaming = 0;
+		}
 	}
-	return status;
+	desc->nextReadOffset = offset + size;
+	streaming = desc->streaming;
+	UNLOCK_STRUCT(*desc);
+
+#ifdef ENABLE_WRITE_BUFFER
+	if (desc->writeBuffer != NULL) {
+		/* reads must see what was written through this descriptor */
+		int status = flushWriteBuffer(desc->writeBuffer);
+		if (status < 0) {
+			return status;
+		}
+	}
+#endif
+#ifdef ENABLE_BLOCK_CACHE
+	if (desc->blockCache != NULL && !streaming) {
+		return readBlockCache(desc->blockCache, buf, size, offset, _ifuseReadRemote, desc);
+	}
+#endif
+	return _ifuseReadRemote(desc, buf, size, offset);
 }
 
 
@@ -210,3 +326,89 @@ _ifuseLseek( iFuseDesc_t *desc, off_t offset ) {
 	}
     return 0;
 }
+
+/**************************************************************************
+ * private functions
+ **************************************************************************/
+static void
+_pushFreeIFuseDesc (iFuseDesc_t *desc) {
+    uint64_t top, newTop;
+
+    do {
+        top = IFuseDescFreeTop;
+        desc->nextFree = (unsigned int) (top & 0xffffffff);
+        newTop = (((top >> 32) + 1) << 32) | (uint64_t) (desc->index + 1);
+    } while (!__sync_bool_compare_and_swap (&IFuseDescFreeTop, top, newTop));
+}
+
+static iFuseDesc_t *
+_popFreeIFuseDesc () {
+    uint64_t top, newTop;
+    iFuseDesc_t *desc;
+
+    do {
+        top = IFuseDescFreeTop;
+        if ((top & 0xffffffff) == 0) {
+            return NULL;
+        }
+        /* may be popped by another thread meanwhile, the swap fails then */
+        desc = getIFuseDesc ((int) (top & 0xffffffff) - 1);
+        newTop = (((top >> 32) + 1) << 32) | (uint64_t) desc->nextFree;
+    } while (!__sync_bool_compare_and_swap (&IFuseDescFreeTop, top, newTop));
+
+    return desc;
+}
+
+/* add a chunk of descriptors, returns one of them and pushes the rest */
+static iFuseDesc_t *
+_growIFuseDesc () {
+    iFuseDesc_t *chunk, *desc;
+    int numChunks, i;
+
+    pthread_mutex_lock (&IFuseDescGrowLock);
+
+    /* another thread may have grown the table while this one waited */
+    desc = _popFreeIFuseDesc ();
+    if (desc != NULL) {
+        pthread_mutex_unlock (&IFuseDescGrowLock);
+        return desc;
+    }
+
+    numChunks = NumIFuseDesc / IFUSE_DESC_CHUNK_SIZE;
+    if (numChunks >= MAX_IFUSE_DESC_CHUNKS) {
+        pthread_mutex_unlock (&IFuseDescGrowLock);
+        return NULL;
+    }
+
+    chunk = (iFuseDesc_t *) calloc (IFUSE_DESC_CHUNK_SIZE, sizeof (iFuseDesc_t));
+    if (chunk == NULL) {
+        pthread_mutex_unlock (&IFuseDescGrowLock);
+        return NULL;
+    }
+    for (i = 0; i < IFUSE_DESC_CHUNK_SIZE; i++) {
+        INIT_STRUCT_LOCK(chunk[i]);
+        chunk[i].index = numChunks * IFUSE_DESC_CHUNK_SIZE + i;
+    }
+
+    /* publish the chunk before any of its indexes can be seen */
+    IFuseDescChunks[numChunks] = chunk;
+    __sync_synchronize ();
+    NumIFuseDesc += IFUSE_DESC_CHUNK_SIZE;
+
+    for (i = IFUSE_DESC_CHUNK_SIZE - 1; i > 0; i--) {
+        if (chunk[i].index >= 3) {
+            _pushFreeIFuseDesc (&chunk[i]);
+        }
+    }
+    desc = &chunk[0];
+    if (desc->index < 3) {
+        desc = _popFreeIFuseDesc ();
+    }
+
+    pthread_mutex_unlock (&IFuseDescGrowLock);
+
+    if (numChunks > 0) {
+        rodsLog (LOG_NOTICE, "growIFuseDesc: descriptor table grown to %d", NumIFuseDesc);
+    }
+    return desc;
+}
@@ -0,0 +1,362 @@
+/*** For more information please refer to files in the COPYRIGHT directory ***/
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <errno.h>
+#include <time.h>
+#include <assert.h>
+#include <pthread.h>
+#include "irodsFs.h"
+#include "iFuseLib.h"
+#include "hashtable.h"
+#include "iFuseLib.DirCache.h"
+
+/**************************************************************************
+ * global variables
+ **************************************************************************/
+static dirCacheConfig_t DirCacheConfig = {
+    DIR_CACHE_EXPIRE_TIME,
+    DIR_CACHE_DEFAULT_MAX_ENTRIES
+};
+static dirCacheStats_t DirCacheStats;
+
+/* protects everything below and the refCount of listings */
+static pthread_mutex_t DirCacheLock;
+static Hashtable *DirCacheTable = NULL;  /* path -> dirCache_t */
+static dirCache_t *DirCacheLruHead = NULL;
+static dirCache_t *DirCacheLruTail = NULL;
+/* bumped by every invalidation, a listing read across one is not cached */
+static unsigned long DirCacheGeneration = 0;
+
+/**************************************************************************
+ * function definitions
+ **************************************************************************/
+static void _removeDirCache(dirCache_t *dirCache);
+static void _releaseDirCache(dirCache_t *dirCache);
+static void _lruUnlink(dirCache_t *dirCache);
+static void _lruPushFront(dirCache_t *dirCache);
+static int _isInTree(const char *path, const char *top);
+
+/**************************************************************************
+ * public functions
+ **************************************************************************/
+int
+setDirCacheConfig (dirCacheConfig_t *config) {
+    if (config == NULL) {
+        return SYS_INTERNAL_NULL_INPUT_ERR;
+    }
+
+    /* 0 disables the directory cache */
+    if (config->timeout >= 0) {
+        DirCacheConfig.timeout = config->timeout;
+    }
+    if (config->maxEntries > 0) {
+        DirCacheConfig.maxEntries = config->maxEntries;
+    }
+    return 0;
+}
+
+int
+initDirCache () {
+    rodsLog (LOG_DEBUG, "initDirCache: timeout = %d", DirCacheConfig.timeout);
+    rodsLog (LOG_DEBUG, "initDirCache: maxEntries = %d", DirCacheConfig.maxEntries);
+
+    bzero(&DirCacheStats, sizeof(dirCacheStats_t));
+    pthread_mutex_init(&DirCacheLock, NULL);
+    DirCacheTable = newHashTable(NUM_DIR_CACHE_HASH_SLOT);
+    return 0;
+}
+
+int
+uninitDirCache () {
+    pthread_mutex_lock(&DirCacheLock);
+    while (DirCacheLruHead != NULL) {
+        _removeDirCache(DirCacheLruHead);
+    }
+    deleteHashTable(DirCacheTable, nop);
+    DirCacheTable = NULL;
+    pthread_mutex_unlock(&DirCacheLock);
+
+    pthread_mutex_destroy(&DirCacheLock);
+    return 0;
+}
+
+int
+isDirCacheEnabled () {
+    if (DirCacheConfig.timeout <= 0 || DirCacheTable == NULL) {
+        return -1;
+    }
+    return 0;
+}
+
+/* a listing returned is referenced, give it back with releaseDirCache */
+dirCache_t *
+lookupDirCache (const char *path) {
+    dirCache_t *dirCache;
+
+    if (isDirCacheEnabled() != 0) {
+        return NULL;
+    }
+
+    pthread_mutex_lock(&DirCacheLock);
+    dirCache = (dirCache_t *)lookupFromHashTable(DirCacheTable, (char *) path);
+    if (dirCache != NULL && time(NULL) - dirCache->cachedTime >= DirCacheConfig.timeout) {
+        _removeDirCache(dirCache);
+        DirCacheStats.expirations++;
+        dirCache = NULL;
+    }
+
+    if (dirCache != NULL) {
+        dirCache->refCount++;
+        _lruUnlink(dirCache);
+        _lruPushFront(dirCache);
+        DirCacheStats.hits++;
+    } else {
+        DirCacheStats.misses++;
+    }
+    pthread_mutex_unlock(&DirCacheLock);
+    return dirCache;
+}
+
+void
+releaseDirCache (dirCache_t *dirCache) {
+    if (dirCache == NULL) {
+        return;
+    }
+
+    pthread_mutex_lock(&DirCacheLock);
+    _releaseDirCache(dirCache);
+    pthread_mutex_unlock(&DirCacheLock);
+}
+
+/* read before listing a collection and passed to addDirCache */
+unsigned long
+getDirCacheGeneration () {
+    unsigned long generation;
+
+    if (isDirCacheEnabled() != 0) {
+        return 0;
+    }
+
+    pthread_mutex_lock(&DirCacheLock);
+    generation = DirCacheGeneration;
+    pthread_mutex_unlock(&DirCacheLock);
+    return generation;
+}
+
+/*
+ * cache a complete listing. entries are owned by the cache from here on,
+ * also when they are not cached because a change happened since
+ * generation was read or the listing is too large.
+ */
+int
+addDirCache (const char *path, dirCacheEntry_t *entries, int numEntries, unsigned long generation) {
+    dirCache_t *dirCache;
+    dirCache_t *oldDirCache;
+
+    if (isDirCacheEnabled() != 0 || numEntries > DirCacheConfig.maxEntries) {
+        freeDirCacheEntries(entries, numEntries);
+        return 0;
+    }
+
+    dirCache = (dirCache_t *)malloc(sizeof(dirCache_t));
+    if (dirCache == NULL) {
+        freeDirCacheEntries(entries, numEntries);
+        return SYS_MALLOC_ERR;
+    }
+
+    bzero(dirCache, sizeof(dirCache_t));
+    dirCache->path = strdup(path);
+    dirCache->entries = entries;
+    dirCache->numEntries = numEntries;
+    dirCache->cachedTime = time(NULL);
+    dirCache->refCount = 1;
+
+    pthread_mutex_lock(&DirCacheLock);
+    if (generation != DirCacheGeneration) {
+        // the listing may not have seen a change made while it was read
+        _releaseDirCache(dirCache);
+        pthread_mutex_unlock(&DirCacheLock);
+        return 0;
+    }
+
+    oldDirCache = (dirCache_t *)lookupFromHashTable(DirCacheTable, (char *) path);
+    if (oldDirCache != NULL) {
+        _removeDirCache(oldDirCache);
+    }
+
+    insertIntoHashTable(DirCacheTable, dirCache->path, dirCache);
+    _lruPushFront(dirCache);
+    DirCacheStats.listings++;
+    DirCacheStats.entries += numEntries;
+
+    // drop least recently used listings until the names fit
+    while (DirCacheStats.entries > DirCacheConfig.maxEntries && DirCacheLruTail != dirCache) {
+        _removeDirCache(DirCacheLruTail);
+        DirCacheStats.evictions++;
+    }
+    pthread_mutex_unlock(&DirCacheLock);
+    return 0;
+}
+
+void
+freeDirCacheEntries (dirCacheEntry_t *entries, int numEntries) {
+    int i;
+
+    if (entries == NULL) {
+        return;
+    }
+
+    for (i = 0; i < numEntries; i++) {
+        free(entries[i].name);
+    }
+    free(entries);
+}
+
+/* the listing of path changed */
+int
+invalidateDirCache (const char *path) {
+    dirCache_t *dirCache;
+
+    if (isDirCacheEnabled() != 0) {
+        return 0;
+    }
+
+    pthread_mutex_lock(&DirCacheLock);
+    DirCacheGeneration++;
+    dirCache = (dirCache_t *)lookupFromHashTable(DirCacheTable, (char *) path);
+    if (dirCache != NULL) {
+        _removeDirCache(dirCache);
+        DirCacheStats.invalidations++;
+    }
+    pthread_mutex_unlock(&DirCacheLock);
+    return 0;
+}
+
+/* path was created or removed, which changes the listing of its parent */
+int
+invalidateDirCacheOfParent (const char *path) {
+    char parent[MAX_NAME_LEN];
+    char *slash;
+
+    rstrcpy(parent, (char *) path, MAX_NAME_LEN);
+    slash = strrchr(parent, '/');
+    if (slash == NULL) {
+        return 0;
+    }
+
+    if (slash == parent) {
+        parent[1] = '\0';
+    } else {
+        *slash = '\0';
+    }
+    return invalidateDirCache(parent);
+}
+
+/* path and every collection below it, for renames and removals of collections */
+int
+invalidateDirCacheTree (const char *path) {
+    dirCache_t *dirCache;
+
+    if (isDirCacheEnabled() != 0) {
+        return 0;
+    }
+
+    pthread_mutex_lock(&DirCacheLock);
+    DirCacheGeneration++;
+    dirCache = DirCacheLruHead;
+    while (dirCache != NULL) {
+        dirCache_t *nextDirCache = dirCache->lruNext;
+        if (_isInTree(dirCache->path, path)) {
+            _removeDirCache(dirCache);
+            DirCacheStats.invalidations++;
+        }
+        dirCache = nextDirCache;
+    }
+    pthread_mutex_unlock(&DirCacheLock);
+    return 0;
+}
+
+int
+getDirCacheStats (dirCacheStats_t *stats) {
+    if (stats == NULL) {
+        return SYS_INTERNAL_NULL_INPUT_ERR;
+    }
+
+    if (DirCacheTable == NULL) {
+        memcpy(stats, &DirCacheStats, sizeof(dirCacheStats_t));
+        return 0;
+    }
+
+    pthread_mutex_lock(&DirCacheLock);
+    memcpy(stats, &DirCacheStats, sizeof(dirCacheStats_t));
+    pthread_mutex_unlock(&DirCacheLock);
+    return 0;
+}
+
+/**************************************************************************
+ * private functions
+ **************************************************************************/
+/* precond: lock DirCacheLock */
+static void
+_removeDirCache(dirCache_t *dirCache) {
+    deleteFromHashTable(DirCacheTable, dirCache->path);
+    _lruUnlink(dirCache);
+    DirCacheStats.listings--;
+    DirCacheStats.entries -= dirCache->numEntries;
+    _releaseDirCache(dirCache);
+}
+
+/* precond: lock DirCacheLock */
+static void
+_releaseDirCache(dirCache_t *dirCache) {
+    dirCache->refCount--;
+    if (dirCache->refCount == 0) {
+        freeDirCacheEntries(dirCache->entries, dirCache->numEntries);
+        free(dirCache->path);
+        free(dirCache);
+    }
+}
+
+/* precond: lock DirCacheLock */
+static void
+_lruUnlink(dirCache_t *dirCache) {
+    if (dirCache->lruPrev != NULL) {
+        dirCache->lruPrev->lruNext = dirCache->lruNext;
+    } else {
+        DirCacheLruHead = dirCache->lruNext;
+    }
+    if (dirCache->lruNext != NULL) {
+        dirCache->lruNext->lruPrev = dirCache->lruPrev;
+    } else {
+        DirCacheLruTail = dirCache->lruPrev;
+    }
+    dirCache->lruPrev = NULL;
+    dirCache->lruNext = NULL;
+}
+
+/* precond: lock DirCacheLock */
+static void
+_lruPushFront(dirCache_t *dirCache) {
+    dirCache->lruPrev = NULL;
+    dirCache->lruNext = DirCacheLruHead;
+    if (DirCacheLruHead != NULL) {
+        DirCacheLruHead->lruPrev = dirCache;
+    } else {
+        DirCacheLruTail = dirCache;
+    }
+    DirCacheLruHead = dirCache;
+}
+
+static int
+_isInTree(const char *path, const char *top) {
+    size_t len = strlen(top);
+
+    if (strcmp(top, "/") == 0) {
+        return 1;
+    }
+    if (strncmp(path, top, len) != 0) {
+        return 0;
+    }
+    return path[len] == '\0' || path[len] == '/';
+}
@@ -16,9 +16,15 @@
 concurrentList_t* FileCacheList;
 char *ReadCacheDir = NULL;
 char FuseCacheDir[MAX_NAME_LEN];
+/* read only server handles by objPath, at most one per object. Lock
+ * SharedFileCacheLock before the fileCache when both are needed */
+static Hashtable *SharedFileCacheTable;
+static pthread_mutex_t SharedFileCacheLock;
 
 int initFileCache() {
     FileCacheList = newConcurrentList();
+    SharedFileCacheTable = newHashTable(NUM_SHARED_FILE_CACHE_HASH_SLOT);
+    pthread_mutex_init(&SharedFileCacheLock, NULL);
     return 0;
 }
 int iFuseFileCacheLseek(fileCache_t *fileCache, off_t offset) {
@@ -35,10 +41,13 @@ int _iFuseFileCacheLseek(fileCache_t *fileCache, off_t offset) {
 		return 0;
 	}
 	if (fileCache->state == NO_FILE_CACHE) {
-        iFuseConn_t *conn = getAndUseConnByPath( fileCache->localPath, &status );
+        iFuseConn_t *conn = getAndUseConnByFileCache( fileCache, &status );
 		openedDataObjInp_t dataObjLseekInp;
 		fileLseekOut_t *dataObjLseekOut = NULL;
 
+		if (conn == NULL) {
+			return status;
+		}
 		bzero(&dataObjLseekInp, sizeof(dataObjLseekInp));
 		dataObjLseekInp.l1descInx = fileCache->iFd;
 		dataObjLseekInp.offset = offset;
@@ -102,6 +111,10 @@ int _iFuseFileCacheFlush(fileCache_t *fileCache) {
 	//LOCK_STRUCT(*fileCache);
 
     RECONNECT_IF_NECESSARY(status, conn, ifusePut (conn->conn, fileCache->objPath, fileCache->fileCachePath, fileCache->mode, stbuf.st_size));
+    if (status >= 0 && stbuf.st_size > MAX_READ_CACHE_SIZE) {
+        /* the file is served by the handle ifusePut opened from now on */
+        setFileCacheConn(fileCache, conn);
+    }
     unuseIFuseConn(conn);
 
     if (status < 0) {
@@ -182,6 +195,10 @@ int ifuseFileCacheSwapOut (fileCache_t *fileCache) {
     /* put cache file to server */
     iFuseConn_t *conn = getAndUseConnByPath( fileCache->localPath, &status );
     RECONNECT_IF_NECESSARY(status, conn, ifusePut (conn->conn, fileCache->objPath, fileCache->fileCachePath, fileCache->mode, stbuf.st_size));
+    if (status >= 0) {
+        /* the file is served by the handle ifusePut opened from now on */
+        setFileCacheConn(fileCache, conn);
+    }
     unuseIFuseConn(conn);
 
     if (status < 0) {
@@ -227,14 +244,40 @@ int ifuseFileCacheSwapOut (fileCache_t *fileCache) {
 /* close any open files inside the file cache */
 int ifuseFileCacheClose(fileCache_t *fileCache) {
 	int status = 0;
+	/* set before any other descriptor could get the fileCache */
+	int shared = fileCache->shared;
+
+	if(shared) {
+		pthread_mutex_lock(&SharedFileCacheLock);
+	}
 	LOCK_STRUCT(*fileCache);
+	if(fileCache->openCount > 1) {
+		/* other descriptors still use the handle */
+		fileCache->openCount--;
+		UNLOCK_STRUCT(*fileCache);
+		if(shared) {
+			pthread_mutex_unlock(&SharedFileCacheLock);
+		}
+		return 0;
+	}
+	fileCache->openCount = 0;
+	if(shared) {
+		/* a newer version may have taken its place */
+		if(lookupFromHashTable(SharedFileCacheTable, fileCache->objPath) == fileCache) {
+			deleteFromHashTable(SharedFileCacheTable, fileCache->objPath);
+		}
+		pthread_mutex_unlock(&SharedFileCacheLock);
+	}
 	if(fileCache->state == NO_FILE_CACHE) {
 		/* close remote file */
         //UNLOCK_STRUCT( *fileCache );
-        iFuseConn_t *conn = getAndUseConnByPath( fileCache->localPath, &status );
+        iFuseConn_t *conn = getAndUseConnByFileCache( fileCache, &status );
         //LOCK_STRUCT( *fileCache );
-		status = closeIrodsFd (conn->conn, fileCache->iFd);
-		unuseIFuseConn(conn);
+		if (conn != NULL) {
+			status = closeIrodsFd (conn->conn, fileCache->iFd);
+			unuseIFuseConn(conn);
+		}
+		setFileCacheConn(fileCache, NULL);
 		fileCache->offset = 0;
     }
     else {
@@ -247,6 +290,42 @@ int ifuseFileCacheClose(fileCache_t *fileCache) {
 	return status;
 }
 
+/* find the open read only handle of the version of objPath in stbuf and
+ * return its fileCache locked, for the caller to open a descriptor on it.
+ * returns NULL if there is none */
+fileCache_t *getAndLockSharedFileCache(char *objPath, struct stat *stbuf) {
+	fileCache_t *fileCache;
+
+	pthread_mutex_lock(&SharedFileCacheLock);
+	fileCache = (fileCache_t *) lookupFromHashTable(SharedFileCacheTable, objPath);
+	if(fileCache != NULL) {
+		LOCK_STRUCT(*fileCache);
+		if(fileCache->openCount == 0 || fileCache->state != NO_FILE_CACHE ||
+		   fileCache->fileSize != stbuf->st_size || fileCache->mtime != stbuf->st_mtime) {
+			UNLOCK_STRUCT(*fileCache);
+			fileCache = NULL;
+		}
+	}
+	pthread_mutex_unlock(&SharedFileCacheLock);
+	return fileCache;
+}
+
+/* let later read only opens of the same version use the handle of fileCache.
+ * precond: fileCache is a read only server handle with a descriptor on it */
+int shareFileCache(fileCache_t *fileCache, struct stat *stbuf) {
+	pthread_mutex_lock(&SharedFileCacheLock);
+	LOCK_STRUCT(*fileCache);
+	fileCache->shared = 1;
+	fileCache->mtime = stbuf->st_mtime;
+	UNLOCK_STRUCT(*fileCache);
+
+	/* an older version stays open for its descriptors but is not handed out */
+	deleteFromHashTable(SharedFileCacheTable, fileCache->objPath);
+	insertIntoHashTable(SharedFileCacheTable, fileCache->objPath, fileCache);
+	pthread_mutex_unlock(&SharedFileCacheLock);
+	return 0;
+}
+
 fileCache_t *addFileCache( int iFd, char *objPath, char *localPath, char *cachePath, int mode, rodsLong_t fileSize, cacheState_t state ) {
     uint cachedTime = time (0);
     fileCache_t *fileCache, *swapCache;
@@ -350,7 +429,10 @@ int _ifuseFileCacheWrite (fileCache_t *fileCache, char *buf, size_t size, off_t
         dataObjWriteInp.l1descInx = fileCache->iFd;
         dataObjWriteInp.len = size;
 
-        conn = getAndUseConnByPath( fileCache->localPath, &status );
+        conn = getAndUseConnByFileCache( fileCache, &status );
+		if (conn == NULL) {
+			return -EBADF;
+		}
 		status = rcDataObjWrite (conn->conn, &dataObjWriteInp, &dataObjWriteInpBBuf);
 		unuseIFuseConn (conn);
 		if (status < 0) {
@@ -390,8 +472,14 @@ int _ifuseFileCacheWrite (fileCache_t *fileCache, char *buf, size_t size, off_t
             dataObjOpenInp.openFlags = O_RDWR;
 
             int status;
-            conn = getAndUseConnByPath( fileCache->localPath, &status );
+            conn = getAndUseConnByFileCache( fileCache, &status );
+            if (conn == NULL) {
+                return -ENOENT;
+            }
             status = rcDataObjOpen (conn->conn, &dataObjOpenInp);
+            if (status >= 0) {
+                setFileCacheConn(fileCache, conn);
+            }
             unuseIFuseConn (conn);
                    
             if (status < 0) {
@@ -438,8 +526,11 @@ int _ifuseFileCacheRead( fileCache_t *fileCache, char *buf, size_t size, off_t o
         dataObjReadInp.l1descInx = fileCache->iFd;
         dataObjReadInp.len = size;
         //UNLOCK_STRUCT(*fileCache);
-        conn = getAndUseConnByPath( fileCache->localPath, &status );
+        conn = getAndUseConnByFileCache( fileCache, &status );
         //LOCK_STRUCT(*fileCache);
+		if (conn == NULL) {
+			return -EBADF;
+		}
 		status = rcDataObjRead (conn->conn,
             		&dataObjReadInp, &dataObjReadOutBBuf);
 		unuseIFuseConn (conn);
@@ -13,7 +13,6 @@
 #include "iFuseLib.LazyUpload.h"
 #include "iFuseLib.Lock.h"
 #include "iFuseLib.FSUtils.h"
-#include "putUtil.h"
 
 /**************************************************************************
  * global variables
@@ -25,6 +24,13 @@ static rodsArguments_t *LazyUploadRodsArgs;
 static Hashtable *LazyUploadBufferedFileTable_Created;
 static Hashtable *LazyUploadBufferedFileTable_Opened;
 
+static List *LazyUploadJobQueue;
+static lazyUploadWorker_t *LazyUploadWorkers = NULL;
+static int LazyUploadNumWorkers = 0;
+static int LazyUploadRunning = 0;
+static rodsLong_t LazyUploadStreamedBytes = 0;
+static rodsLong_t LazyUploadStreamedChunks = 0;
+
 extern PathCacheTable *pctable;
 
 /**************************************************************************
@@ -36,7 +42,14 @@ static int _removeAllBufferedFiles();
 static int _getiRODSPath(const char *path, char *iRODSPath);
 static int _isLazyUploadFile(const char *iRODSPath);
 static int _commitLocalBuffer(const char *iRODSPath, struct fuse_file_info *fi, lazyUploadFileInfo_t *lazyUploadFileInfo);
-static int _upload(const char *iRODSPath);
+static int _startStreaming(const char *iRODSPath, struct fuse_file_info *fi, lazyUploadFileInfo_t *lazyUploadFileInfo);
+static int _streamLocalBuffer(const char *iRODSPath, struct fuse_file_info *fi, lazyUploadFileInfo_t *lazyUploadFileInfo, off_t endOffset);
+static void _waitForChunks(lazyUploadFileInfo_t *lazyUploadFileInfo);
+static void *_lazyUploadWorker(void *arg);
+static int _uploadChunk(lazyUploadJob_t *job, rcComm_t **conn);
+static int _connect(rcComm_t **conn);
+static void _waitForEvent(int sleepTime);
+static void _notifyEvent();
 
 
 /**************************************************************************
@@ -44,6 +57,9 @@ static int _upload(const char *iRODSPath);
  **************************************************************************/
 int
 initLazyUpload (lazyUploadConfig_t *lazyUploadConfig, rodsEnv *myLazyUploadRodsEnv, rodsArguments_t *myLazyUploadRodsArgs) {
+    int i;
+    int status;
+
     rodsLog (LOG_DEBUG, "initLazyUpload: MyLazyUploadConfig.lazyUpload = %d", lazyUploadConfig->lazyUpload);
     rodsLog (LOG_DEBUG, "initLazyUpload: MyLazyUploadConfig.bufferPath = %s", lazyUploadConfig->bufferPath);
     rodsLog (LOG_DEBUG, "initLazyUpload: empty space = %lld", getEmptySpace(lazyUploadConfig->bufferPath));
@@ -57,22 +73,84 @@ initLazyUpload (lazyUploadConfig_t *lazyUploadConfig, rodsEnv *myLazyUploadRodsE
     LazyUploadBufferedFileTable_Created = newHashTable(NUM_LAZYUPLOAD_FILE_HASH_SLOT);
     LazyUploadBufferedFileTable_Opened = newHashTable(NUM_LAZYUPLOAD_FILE_HASH_SLOT);
 
+    LazyUploadJobQueue = newListNoRegion();
+
     // init lock
     INIT_LOCK(LazyUploadLock);
+#ifndef USE_BOOST
+    pthread_cond_init(&LazyUploadCond, NULL);
+#endif
 
     _prepareBufferDir(lazyUploadConfig->bufferPath);
 
     // remove lazy-upload Buffered files
     _removeAllBufferedFiles();
 
+    if(LazyUploadConfig.lazyUpload == 0) {
+        return (0);
+    }
+
+    // start workers
+    LazyUploadRunning = 1;
+    LazyUploadWorkers = (lazyUploadWorker_t *)calloc(LazyUploadConfig.numWorkers, sizeof(lazyUploadWorker_t));
+    for(i=0;i<LazyUploadConfig.numWorkers;i++) {
+#ifdef USE_BOOST
+        LazyUploadWorkers[i].thread = new boost::thread(_lazyUploadWorker, (void *)&LazyUploadWorkers[i]);
+#else
+        status = pthread_create(&LazyUploadWorkers[i].thread, NULL, _lazyUploadWorker, (void *)&LazyUploadWorkers[i]);
+        if(status != 0) {
+            rodsLog (LOG_ERROR, "initLazyUpload: pthread_create failure, status = %d", status);
+            break;
+        }
+#endif
+        LazyUploadNumWorkers++;
+    }
+
+    if(LazyUploadNumWorkers == 0) {
+        // nobody would send the chunks
+        LazyUploadConfig.lazyUpload = 0;
+    }
+
     return (0);
 }
 
 int
 uninitLazyUpload (lazyUploadConfig_t *lazyUploadConfig) {
+    int i;
+
+    if(LazyUploadWorkers != NULL) {
+        // files are closed by now, so is the queue empty
+        LOCK(LazyUploadLock);
+        LazyUploadRunning = 0;
+        _notifyEvent();
+        UNLOCK(LazyUploadLock);
+
+        for(i=0;i<LazyUploadNumWorkers;i++) {
+#ifdef USE_BOOST
+            LazyUploadWorkers[i].thread->join();
+            delete LazyUploadWorkers[i].thread;
+#else
+            pthread_join(LazyUploadWorkers[i].thread, NULL);
+#endif
+            if(LazyUploadWorkers[i].conn != NULL) {
+                rcDisconnect(LazyUploadWorkers[i].conn);
+                LazyUploadWorkers[i].conn = NULL;
+            }
+        }
+        free(LazyUploadWorkers);
+        LazyUploadWorkers = NULL;
+        LazyUploadNumWorkers = 0;
+
+        rodsLog (LOG_NOTICE, "lazy-upload: %lld bytes streamed in %lld chunks", LazyUploadStreamedBytes, LazyUploadStreamedChunks);
+    }
+
     // remove incomplete lazy-upload caches
     _removeAllBufferedFiles();
 
+    deleteListNoRegion(LazyUploadJobQueue);
+#ifndef USE_BOOST
+    pthread_cond_destroy(&LazyUploadCond);
+#endif
     FREE_LOCK(LazyUploadLock);
     return (0);
 }
@@ -139,11 +217,17 @@ mknodLazyUploadBufferedFile(const char *path) {
     // add to hash table
     lazyUploadFileInfo = (lazyUploadFileInfo_t *)malloc(sizeof(lazyUploadFileInfo_t));
     lazyUploadFileInfo->path = strdup(iRODSPath);
+    lazyUploadFileInfo->objPath = NULL; // clear
     lazyUploadFileInfo->accmode = 0; // clear
     lazyUploadFileInfo->localHandle = -1; // clear
     lazyUploadFileInfo->commitCount = 0; // clear
     lazyUploadFileInfo->curLocalOffsetStart = 0; // clear
     lazyUploadFileInfo->curOffset = 0; // clear
+    lazyUploadFileInfo->contiguousOffset = 0; // clear
+    lazyUploadFileInfo->streamedOffset = 0; // clear
+    lazyUploadFileInfo->streaming = 0; // clear
+    lazyUploadFileInfo->inflight = 0; // clear
+    lazyUploadFileInfo->uploadError = 0; // clear
     INIT_STRUCT_LOCK((*lazyUploadFileInfo));
 
     insertIntoHashTable(LazyUploadBufferedFileTable_Created, iRODSPath, lazyUploadFileInfo);
@@ -225,7 +309,6 @@ writeLazyUploadBufferedFile (const char *path, const char *buf, size_t size, off
     lazyUploadFileInfo_t *lazyUploadFileInfo = NULL;
     char iRODSPath[MAX_NAME_LEN];
     char bufferPath[MAX_NAME_LEN];
-    off_t seek_status;
     int descInx;
 
     // convert input path to iRODSPath
@@ -258,8 +341,8 @@ writeLazyUploadBufferedFile (const char *path, const char *buf, size_t size, off
         return -EBADF;
     }
 
-    if(offset - lazyUploadFileInfo->curLocalOffsetStart < 0) {
-        // backward?
+    if(offset < lazyUploadFileInfo->streamedOffset) {
+        // backward, or into data already sent
         // commit local buffered data
         status = _commitLocalBuffer(iRODSPath, fi, lazyUploadFileInfo);
         if(status < 0) {
@@ -276,63 +359,53 @@ writeLazyUploadBufferedFile (const char *path, const char *buf, size_t size, off
             return -EBADF;
         }
 
-        status = _ifuseWrite (&IFuseDesc[descInx], (char *)buf, size, offset);
+        status = _ifuseWrite (getIFuseDesc (descInx), (char *)buf, size, offset);
         unlockDesc (descInx);
         UNLOCK(LazyUploadLock);
         return status;
     }
 
     // try to write to local buffer
-    seek_status = lseek (lazyUploadFileInfo->localHandle, offset - lazyUploadFileInfo->curLocalOffsetStart, SEEK_SET);
-    if (seek_status != (offset - lazyUploadFileInfo->curLocalOffsetStart)) {
-        status = (int)seek_status;
-        rodsLog (LOG_DEBUG, "writeLazyUploadBufferedFile: failed to seek file desc - %d, %ld -> %ld", lazyUploadFileInfo->localHandle, offset - lazyUploadFileInfo->curLocalOffsetStart, seek_status);
-        UNLOCK(LazyUploadLock);
-        return status;
-    }
+    status = pwrite (lazyUploadFileInfo->localHandle, buf, size, offset - lazyUploadFileInfo->curLocalOffsetStart);
+    rodsLog (LOG_DEBUG, "writeLazyUploadBufferedFile: write to opened lazy-upload Buffered file - %d", lazyUploadFileInfo->localHandle);
 
-    // TEST
-    //if (lazyUploadFileInfo->curOffset > 10*1024*1024) {
-    //    status = -1;
-    //   errno = ENOSPC;
-    //} else {
-    //    status = write (lazyUploadFileInfo->localHandle, buf, size);
-    //}
-    // TEST END
+    if (status < 0 && errno == ENOSPC) {
+        // handle no space
+        // mode switch
+        status = _commitLocalBuffer(iRODSPath, fi, lazyUploadFileInfo);
+        if(status < 0) {
+            rodsLog (LOG_DEBUG, "writeLazyUploadBufferedFile: failed to change to appending mode - %s", iRODSPath);
+            UNLOCK(LazyUploadLock);
+            return status; 
+        }
 
-    status = write (lazyUploadFileInfo->localHandle, buf, size);
-    rodsLog (LOG_DEBUG, "writeLazyUploadBufferedFile: write to opened lazy-upload Buffered file - %d", lazyUploadFileInfo->localHandle);
+        // write to local buffer again
+        status = pwrite (lazyUploadFileInfo->localHandle, buf, size, offset - lazyUploadFileInfo->curLocalOffsetStart);
+        rodsLog (LOG_DEBUG, "writeLazyUploadBufferedFile: write to opened lazy-upload Buffered file - %d", lazyUploadFileInfo->localHandle);
+    }
 
     if (status < 0) {
-        // no space?
-        if (errno == ENOSPC) {
-            // handle no space
-            // mode switch
-            status = _commitLocalBuffer(iRODSPath, fi, lazyUploadFileInfo);
-            if(status < 0) {
-                rodsLog (LOG_DEBUG, "writeLazyUploadBufferedFile: failed to change to appending mode - %s", iRODSPath);
-                UNLOCK(LazyUploadLock);
-                return status; 
-            }
-
-            // write to local buffer again
-            seek_status = lseek (lazyUploadFileInfo->localHandle, offset - lazyUploadFileInfo->curLocalOffsetStart, SEEK_SET);
-            if (seek_status != (offset - lazyUploadFileInfo->curLocalOffsetStart)) {
-                status = (int)seek_status;
-                rodsLog (LOG_DEBUG, "writeLazyUploadBufferedFile: failed to seek file desc - %d, %ld -> %ld", lazyUploadFileInfo->localHandle, offset - lazyUploadFileInfo->curLocalOffsetStart, seek_status);
-                UNLOCK(LazyUploadLock);
-                return status;
-            }
+        status = -errno;
+        UNLOCK(LazyUploadLock);
+        return status;
+    }
 
-            status = write (lazyUploadFileInfo->localHandle, buf, size);
-            rodsLog (LOG_DEBUG, "writeLazyUploadBufferedFile: write to opened lazy-upload Buffered file - %d", lazyUploadFileInfo->localHandle);
+    if (offset + status - lazyUploadFileInfo->curLocalOffsetStart > lazyUploadFileInfo->curOffset) {
+        lazyUploadFileInfo->curOffset = offset + status - lazyUploadFileInfo->curLocalOffsetStart;
+    }
+    if (offset <= lazyUploadFileInfo->contiguousOffset && offset + status > lazyUploadFileInfo->contiguousOffset) {
+        lazyUploadFileInfo->contiguousOffset = offset + status;
+    }
 
-            if(status >= 0) {
-                lazyUploadFileInfo->curOffset += status;
-            }
+    // send whole chunks while the application keeps writing
+    if (lazyUploadFileInfo->contiguousOffset - lazyUploadFileInfo->streamedOffset >= LazyUploadConfig.chunkSize) {
+        off_t endOffset = lazyUploadFileInfo->contiguousOffset - ((lazyUploadFileInfo->contiguousOffset - lazyUploadFileInfo->streamedOffset) % LazyUploadConfig.chunkSize);
+        int streamStatus = _streamLocalBuffer(iRODSPath, fi, lazyUploadFileInfo, endOffset);
+        if (streamStatus < 0) {
+            rodsLog (LOG_DEBUG, "writeLazyUploadBufferedFile: failed to stream buffered data - %s", iRODSPath);
+            UNLOCK(LazyUploadLock);
+            return streamStatus;
         }
-    } else {
-        lazyUploadFileInfo->curOffset += status;
     }
 
     UNLOCK(LazyUploadLock);
@@ -397,6 +470,9 @@ closeLazyUploadBufferedFile (const char *path) {
 
     lazyUploadFileInfo = (lazyUploadFileInfo_t *)lookupFromHashTable(LazyUploadBufferedFileTable_Opened, iRODSPath);
     if(lazyUploadFileInfo != NULL) {
+        // workers may still read from the handle
+        _waitForChunks(lazyUploadFileInfo);
+
         // has lazy-upload file handle opened
         if(lazyUploadFileInfo->localHandle > 0) {
             close(lazyUploadFileInfo->localHandle);
@@ -411,6 +487,11 @@ closeLazyUploadBufferedFile (const char *path) {
             lazyUploadFileInfo->path = NULL;
         }
 
+        if(lazyUploadFileInfo->objPath != NULL) {
+            free(lazyUploadFileInfo->objPath);
+            lazyUploadFileInfo->objPath = NULL;
+        }
+
         free(lazyUploadFileInfo);
     }
     
@@ -422,20 +503,15 @@ closeLazyUploadBufferedFile (const char *path) {
 /**************************************************************************
  * private functions
  **************************************************************************/
+/* precond: lock LazyUploadLock.
+ * sends what is left in the buffer and waits for the chunks in flight */
 static int
 _commitLocalBuffer(const char *iRODSPath, struct fuse_file_info *fi, lazyUploadFileInfo_t *lazyUploadFileInfo) {
     int status;
-    int desc;
-    char bufferPath[MAX_NAME_LEN];
+    int myError;
     int descInx;
+    off_t endOffset;
 
-    status = _getBufferPath(iRODSPath, bufferPath);
-    if(status < 0) {
-        rodsLog (LOG_DEBUG, "_upload: failed to get Buffered lazy upload file path - %s", iRODSPath);
-        return status;
-    }
-
-    // close local buffer file handle
     if(lazyUploadFileInfo->localHandle < 0) {
         rodsLog (LOG_DEBUG, "_commitLocalBuffer: wrong file descriptor - %s, %d", iRODSPath, lazyUploadFileInfo->localHandle);
         return -EBADF;
@@ -446,242 +522,394 @@ _commitLocalBuffer(const char *iRODSPath, struct fuse_file_info *fi, lazyUploadF
         return 0;
     }
 
-    fsync(lazyUploadFileInfo->localHandle);
-    close(lazyUploadFileInfo->localHandle);
-    lazyUploadFileInfo->localHandle = -1;
+    // whole chunks are gone already, only the tail is left
+    endOffset = lazyUploadFileInfo->curLocalOffsetStart + lazyUploadFileInfo->curOffset;
+    status = _streamLocalBuffer(iRODSPath, fi, lazyUploadFileInfo, endOffset);
+    if(status < 0) {
+        return status;
+    }
 
-    rodsLog (LOG_DEBUG, "_commitLocalBuffer: upload - %s", iRODSPath);
-    
-    if(lazyUploadFileInfo->commitCount == 0) {
-        // put and reopen iRODS file
-        dataObjInp_t dataObjInp;
-        int fd;
-        pathCache_t *tmpPathCache = NULL;
-        iFuseConn_t *iFuseConn = NULL;
-        iFuseDesc_t *desc = NULL;
-        struct stat stbuf;
-        char objPath[MAX_NAME_LEN];
+    rodsLog (LOG_DEBUG, "_commitLocalBuffer: waiting for %d chunks - %s", lazyUploadFileInfo->inflight, iRODSPath);
+    _waitForChunks(lazyUploadFileInfo);
 
-        descInx = GET_IFUSE_DESC_INDEX(fi);
+    if(lazyUploadFileInfo->uploadError < 0) {
+        status = lazyUploadFileInfo->uploadError;
+        rodsLogError (LOG_ERROR, status, "_commitLocalBuffer: upload of %s error", iRODSPath);
 
-        rodsLog (LOG_DEBUG, "_commitLocalBuffer: closing existing iRODS file handle - %s - %d", iRODSPath, descInx);
+        // send the whole buffer again on the next commit
+        lazyUploadFileInfo->uploadError = 0;
+        lazyUploadFileInfo->streamedOffset = lazyUploadFileInfo->curLocalOffsetStart;
+        if ((myError = getErrno (status)) > 0) {
+            return (-myError);
+        } else {
+            return -EIO;
+        }
+    }
 
-        status = ifuseClose (&IFuseDesc[descInx]);
-        if (status < 0) {
-            int myError;
-            if ((myError = getErrno (status)) > 0) {
-                return (-myError);
-            } else {
-                return -ENOENT;
+    // let getattr see the new size
+    descInx = GET_IFUSE_DESC_INDEX(fi);
+    if (checkFuseDesc (descInx) >= 0) {
+        fileCache_t *fileCache = getIFuseDesc (descInx)->fileCache;
+        if (fileCache != NULL) {
+            LOCK_STRUCT(*fileCache);
+            if (fileCache->fileSize < endOffset) {
+                fileCache->fileSize = endOffset;
             }
+            UNLOCK_STRUCT(*fileCache);
         }
+        unlockDesc (descInx);
+    }
 
-        // put
-        rodsLog (LOG_DEBUG, "_commitLocalBuffer: uploading buffered file - %s", iRODSPath);
+    rodsLog (LOG_DEBUG, "_commitLocalBuffer: reset local buffered file - %s", iRODSPath);
 
-        status = _upload(iRODSPath);
-        if(status != 0) {
-            rodsLog (LOG_DEBUG, "_commitLocalBuffer: upload error - %s, %d", iRODSPath, status);
-            return status;
-        }
+    // reset local buffer file
+    if (ftruncate (lazyUploadFileInfo->localHandle, 0) < 0) {
+        rodsLog (LOG_DEBUG, "_commitLocalBuffer: failed to truncate buffered file - %s, errno = %d", iRODSPath, errno);
+    }
+    lazyUploadFileInfo->commitCount++;
+    lazyUploadFileInfo->curLocalOffsetStart = endOffset;
+    lazyUploadFileInfo->curOffset = 0;
+    lazyUploadFileInfo->contiguousOffset = endOffset;
+    lazyUploadFileInfo->streamedOffset = endOffset;
+    return (0);
+}
 
-        // reopen file
-        rodsLog (LOG_DEBUG, "_commitLocalBuffer: reopening iRODS file handle - %s", iRODSPath);
+/* precond: lock LazyUploadLock.
+ * reopens the iRODS file without the local file cache, so the chunks
+ * written by the workers are not overwritten when it is closed */
+static int
+_startStreaming(const char *iRODSPath, struct fuse_file_info *fi, lazyUploadFileInfo_t *lazyUploadFileInfo) {
+    int status;
+    dataObjInp_t dataObjInp;
+    int fd;
+    pathCache_t *tmpPathCache = NULL;
+    iFuseConn_t *iFuseConn = NULL;
+    iFuseDesc_t *desc = NULL;
+    struct stat stbuf;
+    char objPath[MAX_NAME_LEN];
+    int descInx;
 
-        memset (&dataObjInp, 0, sizeof (dataObjInp));
-        //dataObjInp.openFlags = lazyUploadFileInfo->accmode;
-        dataObjInp.openFlags = O_RDWR | O_APPEND;
+    descInx = GET_IFUSE_DESC_INDEX(fi);
 
-        status = parseRodsPathStr ((char *) iRODSPath, LazyUploadRodsEnv, objPath);
-        rstrcpy(dataObjInp.objPath, objPath, MAX_NAME_LEN);
-        if (status < 0) {
-            rodsLogError (LOG_ERROR, status, "_commitLocalBuffer: parseRodsPathStr of %s error", iRODSPath);
-            /* use ENOTDIR for this type of error */
-            return -ENOTDIR;
-        }
+    rodsLog (LOG_DEBUG, "_startStreaming: closing existing iRODS file handle - %s - %d", iRODSPath, descInx);
 
-        iFuseConn = getAndUseConnByPath((char *) iRODSPath, &status);
-        /* status = getAndUseIFuseConn(&iFuseConn); */
-        if(status < 0) {
-            rodsLogError (LOG_ERROR, status, "_commitLocalBuffer: cannot get connection for %s error", iRODSPath);
-            /* use ENOTDIR for this type of error */
-            return -ENOTDIR;
+    status = ifuseClose (getIFuseDesc (descInx));
+    if (status < 0) {
+        int myError;
+        if ((myError = getErrno (status)) > 0) {
+            return (-myError);
+        } else {
+            return -ENOENT;
         }
+    }
+
+    // reopen file
+    rodsLog (LOG_DEBUG, "_startStreaming: reopening iRODS file handle - %s", iRODSPath);
+
+    memset (&dataObjInp, 0, sizeof (dataObjInp));
+    dataObjInp.openFlags = O_RDWR;
 
-        status = _irodsGetattr (iFuseConn, iRODSPath, &stbuf);
+    status = parseRodsPathStr ((char *) iRODSPath, LazyUploadRodsEnv, objPath);
+    rstrcpy(dataObjInp.objPath, objPath, MAX_NAME_LEN);
+    if (status < 0) {
+        rodsLogError (LOG_ERROR, status, "_startStreaming: parseRodsPathStr of %s error", iRODSPath);
+        /* use ENOTDIR for this type of error */
+        return -ENOTDIR;
+    }
 
-        fd = rcDataObjOpen (iFuseConn->conn, &dataObjInp);
+    iFuseConn = getAndUseConnByPath((char *) iRODSPath, &status);
+    if(status < 0) {
+        rodsLogError (LOG_ERROR, status, "_startStreaming: cannot get connection for %s error", iRODSPath);
+        /* use ENOTDIR for this type of error */
+        return -ENOTDIR;
+    }
+
+    status = _irodsGetattr (iFuseConn, iRODSPath, &stbuf);
+
+    fd = rcDataObjOpen (iFuseConn->conn, &dataObjInp);
+
+    if (fd < 0) {
         unuseIFuseConn (iFuseConn);
+        rodsLogError (LOG_ERROR, status, "_startStreaming: rcDataObjOpen of %s error, status = %d", iRODSPath, fd);
+        return -ENOENT;
+    }
 
-        if (fd < 0) {
-            rodsLogError (LOG_ERROR, status, "_commitLocalBuffer: rcDataObjOpen of %s error, status = %d", iRODSPath, fd);
-            return -ENOENT;
+    fileCache_t *fileCache = addFileCache(fd, objPath, (char *) iRODSPath, NULL, stbuf.st_mode, stbuf.st_size, NO_FILE_CACHE);
+    setFileCacheConn (fileCache, iFuseConn);
+    unuseIFuseConn (iFuseConn);
+    matchAndLockPathCache(pctable, (char *) iRODSPath, &tmpPathCache);
+    if(tmpPathCache == NULL) {
+        pathExist(pctable, (char *) iRODSPath, fileCache, status >= 0 ? &stbuf : NULL, NULL);
+    } else {
+        _addFileCacheForPath(tmpPathCache, fileCache);
+        if (status >= 0) {
+            _setPathCacheStat(tmpPathCache, &stbuf);
         }
+        UNLOCK_STRUCT(*tmpPathCache);
+    }
 
-		fileCache_t *fileCache = addFileCache(fd, objPath, (char *) iRODSPath, NULL, stbuf.st_mode, stbuf.st_size, NO_FILE_CACHE);
-        matchAndLockPathCache(pctable, (char *) iRODSPath, &tmpPathCache);
-        if(tmpPathCache == NULL) {
-            pathExist(pctable, (char *) iRODSPath, fileCache, &stbuf, NULL);
-        } else {
-			_addFileCacheForPath(tmpPathCache, fileCache);
-            UNLOCK_STRUCT(*tmpPathCache);
+    LOCK_STRUCT(*fileCache);
+    desc = newIFuseDesc (objPath, (char *) iRODSPath, fileCache, &status);
+    UNLOCK_STRUCT(*fileCache);
+    if (desc == NULL) {
+        rodsLogError (LOG_ERROR, status, "_startStreaming: allocIFuseDesc of %s error", iRODSPath);
+        return -ENOENT;
+    }
+
+    SET_IFUSE_DESC_INDEX(fi, desc->index);
+    rodsLog (LOG_DEBUG, "_startStreaming: created new file handle - %s - %d", iRODSPath, desc->index);
+
+    lazyUploadFileInfo->objPath = strdup(objPath);
+    lazyUploadFileInfo->streaming = 1;
+    return (0);
+}
+
+/* precond: lock LazyUploadLock.
+ * queues the buffered data up to endOffset in chunks */
+static int
+_streamLocalBuffer(const char *iRODSPath, struct fuse_file_info *fi, lazyUploadFileInfo_t *lazyUploadFileInfo, off_t endOffset) {
+    int status;
+    lazyUploadJob_t *job;
+
+    if(endOffset <= lazyUploadFileInfo->streamedOffset) {
+        return 0;
+    }
+
+    if(!lazyUploadFileInfo->streaming) {
+        status = _startStreaming(iRODSPath, fi, lazyUploadFileInfo);
+        if(status < 0) {
+            return status;
         }
+    }
 
-        desc = newIFuseDesc (objPath, (char *) iRODSPath, fileCache, &status);
-        if (desc == NULL) {
-            rodsLogError (LOG_ERROR, status, "_commitLocalBuffer: allocIFuseDesc of %s error", iRODSPath);
-            return -ENOENT;
+    while(lazyUploadFileInfo->streamedOffset < endOffset) {
+        job = (lazyUploadJob_t *)malloc(sizeof(lazyUploadJob_t));
+        job->fileInfo = lazyUploadFileInfo;
+        job->offset = lazyUploadFileInfo->streamedOffset;
+        job->localOffset = lazyUploadFileInfo->streamedOffset - lazyUploadFileInfo->curLocalOffsetStart;
+        job->size = endOffset - lazyUploadFileInfo->streamedOffset;
+        if((rodsLong_t)job->size > LazyUploadConfig.chunkSize) {
+            job->size = LazyUploadConfig.chunkSize;
         }
 
-        SET_IFUSE_DESC_INDEX(fi, desc->index);
-        rodsLog (LOG_DEBUG, "_commitLocalBuffer: created new file handle - %s - %d", iRODSPath, desc->index);
+        listAppendNoRegion(LazyUploadJobQueue, job);
+        lazyUploadFileInfo->inflight++;
+        lazyUploadFileInfo->streamedOffset += job->size;
+    }
 
-    } else {
-        // append
-        int localDesc = open (bufferPath, O_RDONLY, 0755);
-        char *buffer = (char*)malloc(FUSE_LAZY_UPLOAD_MEM_BUFFER_SIZE);
-        int grandTotalReadLen = 0;
+    _notifyEvent();
+    return 0;
+}
 
-        if(localDesc < 0) {
-            rodsLog (LOG_DEBUG, "_commitLocalBuffer: file descriptor error - %s, %d", iRODSPath, localDesc);
-            return -ENOENT;
-        }
+/* precond: lock LazyUploadLock */
+static void
+_waitForChunks(lazyUploadFileInfo_t *lazyUploadFileInfo) {
+    while(lazyUploadFileInfo->inflight > 0) {
+        _waitForEvent(LAZY_UPLOAD_CONN_IDLE_TIMEOUT);
+    }
+}
 
-        descInx = GET_IFUSE_DESC_INDEX(fi);
+static void *_lazyUploadWorker(void *arg) {
+    int status;
+    lazyUploadWorker_t *worker = (lazyUploadWorker_t *)arg;
+    lazyUploadJob_t *job = NULL;
 
-        if (checkFuseDesc (descInx) < 0) {
-            return -EBADF;
+    LOCK(LazyUploadLock);
+    while(LazyUploadRunning) {
+        if(LazyUploadJobQueue->head == NULL) {
+            _waitForEvent(LAZY_UPLOAD_CONN_IDLE_TIMEOUT);
+
+            if(worker->conn != NULL && time(NULL) - worker->lastUsed >= LAZY_UPLOAD_CONN_IDLE_TIMEOUT) {
+                // do not hold an agent on the server for nothing
+                rcComm_t *conn = worker->conn;
+                worker->conn = NULL;
+                UNLOCK(LazyUploadLock);
+                rodsLog (LOG_DEBUG, "_lazyUploadWorker: closing idle connection");
+                rcDisconnect(conn);
+                LOCK(LazyUploadLock);
+            }
+            continue;
         }
 
-        status = 0;
-        while(grandTotalReadLen < lazyUploadFileInfo->curOffset) {
-            int totalReadLen = 0;
-            int totalWriteLen = 0;
-
-            while(totalReadLen < FUSE_LAZY_UPLOAD_MEM_BUFFER_SIZE) {
-                int readLen = read(localDesc, buffer + totalReadLen, FUSE_LAZY_UPLOAD_MEM_BUFFER_SIZE - totalReadLen);
-                if(readLen > 0) {
-                    totalReadLen += readLen;
-                } else if(readLen == 0) {
-                    // EOF
-                    break;
-                } else if(readLen < 0) {
-                    rodsLog (LOG_DEBUG, "_commitLocalBuffer: buffered file read error - %s, %d", iRODSPath, localDesc);
-                    status = getErrno (readLen);
-                    break;
-                }
-            }
+        job = (lazyUploadJob_t *)LazyUploadJobQueue->head->value;
+        listRemoveNoRegion(LazyUploadJobQueue, LazyUploadJobQueue->head);
+        UNLOCK(LazyUploadLock);
 
-            if(status >= 0) {
-                while(totalWriteLen < totalReadLen) {
-                    int writeLen = _ifuseWrite (&IFuseDesc[descInx], buffer + totalWriteLen, totalReadLen - totalWriteLen, lazyUploadFileInfo->curLocalOffsetStart + totalWriteLen);
-                    if(writeLen > 0) {
-                        totalWriteLen += writeLen;
-                    } else if(writeLen == 0) {
-                        // EOF
-                        break;
-                    } else if(writeLen < 0) {
-                        rodsLog (LOG_DEBUG, "_commitLocalBuffer: iRODS file write error - %s", iRODSPath);
-                        status = getErrno (writeLen);
-                        break;
-                    }
-                }
-            }
+        status = _uploadChunk(job, &worker->conn);
 
-            grandTotalReadLen += totalReadLen;
+        LOCK(LazyUploadLock);
+        worker->lastUsed = time(NULL);
+        if(status < 0) {
+            rodsLog (LOG_DEBUG, "_lazyUploadWorker: upload error - %s, %lld, %d", job->fileInfo->path, (rodsLong_t)job->offset, status);
+            if(job->fileInfo->uploadError == 0) {
+                job->fileInfo->uploadError = status;
+            }
+        } else {
+            LazyUploadStreamedBytes += job->size;
+            LazyUploadStreamedChunks++;
         }
 
-        unlockDesc (descInx);
-
-        free(buffer);
-        close(localDesc);
+        // wake up a commit waiting for the file
+        job->fileInfo->inflight--;
+        _notifyEvent();
+        free(job);
     }
+    UNLOCK(LazyUploadLock);
 
-    rodsLog (LOG_DEBUG, "_commitLocalBuffer: reset local buffered file - %s", iRODSPath);
-
-    // reset local buffer file
-    desc = open (bufferPath, O_RDWR|O_CREAT|O_TRUNC, 0755);
-    lazyUploadFileInfo->localHandle = desc;
-    lazyUploadFileInfo->commitCount++;
-    lazyUploadFileInfo->curLocalOffsetStart += lazyUploadFileInfo->curOffset;
-    lazyUploadFileInfo->curOffset = 0;
-    return (0);
+    return NULL;
 }
 
+/* the buffer handle and objPath of the file stay valid while the chunk is in flight */
 static int
-_upload (const char *iRODSPath) {
+_uploadChunk(lazyUploadJob_t *job, rcComm_t **conn) {
     int status;
-    rcComm_t *conn;
-    rodsPathInp_t rodsPathInp;
-    rErrMsg_t errMsg;
-    char bufferPath[MAX_NAME_LEN];
-    char destiRODSDir[MAX_NAME_LEN];
+    int fd;
+    char *buffer;
+    size_t totalReadLen = 0;
+    dataObjInp_t dataObjInp;
+    openedDataObjInp_t dataObjLseekInp;
+    fileLseekOut_t *dataObjLseekOut = NULL;
+    openedDataObjInp_t dataObjWriteInp;
+    bytesBuf_t dataObjWriteInpBBuf;
+    openedDataObjInp_t dataObjCloseInp;
+
+    buffer = (char *)malloc(job->size);
+    if(buffer == NULL) {
+        return SYS_MALLOC_ERR;
+    }
+
+    while(totalReadLen < job->size) {
+        ssize_t readLen = pread(job->fileInfo->localHandle, buffer + totalReadLen, job->size - totalReadLen, job->localOffset + totalReadLen);
+        if(readLen < 0) {
+            rodsLog (LOG_DEBUG, "_uploadChunk: buffered file read error - %s, errno = %d", job->fileInfo->path, errno);
+            free(buffer);
+            return UNIX_FILE_READ_ERR - errno;
+        } else if(readLen == 0) {
+            // a hole at the end
+            memset(buffer + totalReadLen, 0, job->size - totalReadLen);
+            break;
+        }
+        totalReadLen += readLen;
+    }
 
-    status = getParentDir(iRODSPath, destiRODSDir);
-    if(status < 0) {
-        rodsLog (LOG_DEBUG, "_upload: failed to get parent dir - %s", iRODSPath);
-        return status;
+    if(*conn == NULL) {
+        status = _connect(conn);
+        if(status < 0) {
+            free(buffer);
+            return status;
+        }
     }
 
-    status = _getBufferPath(iRODSPath, bufferPath);
-    if(status < 0) {
-        rodsLog (LOG_DEBUG, "_upload: failed to get Buffered lazy upload file path - %s", iRODSPath);
-        return status;
+    memset (&dataObjInp, 0, sizeof (dataObjInp));
+    rstrcpy (dataObjInp.objPath, job->fileInfo->objPath, MAX_NAME_LEN);
+    dataObjInp.openFlags = O_WRONLY;
+
+    fd = rcDataObjOpen (*conn, &dataObjInp);
+    if (fd < 0) {
+        status = fd;
+        goto error;
     }
 
-    // set src path
-    memset( &rodsPathInp, 0, sizeof( rodsPathInp_t ) );
-    addSrcInPath( &rodsPathInp, bufferPath );
-    status = parseLocalPath (&rodsPathInp.srcPath[0]);
-    if(status < 0) {
-        rodsLog (LOG_DEBUG, "_upload: parseLocalPath error : %d", status);
-        return status;
+    bzero (&dataObjLseekInp, sizeof (dataObjLseekInp));
+    dataObjLseekInp.l1descInx = fd;
+    dataObjLseekInp.offset = job->offset;
+    dataObjLseekInp.whence = SEEK_SET;
+
+    status = rcDataObjLseek (*conn, &dataObjLseekInp, &dataObjLseekOut);
+    if (dataObjLseekOut != NULL) {
+        free (dataObjLseekOut);
     }
 
-    // set dest path
-    rodsPathInp.destPath = ( rodsPath_t* )malloc( sizeof( rodsPath_t ) );
-    memset( rodsPathInp.destPath, 0, sizeof( rodsPath_t ) );
-    rstrcpy( rodsPathInp.destPath->inPath, destiRODSDir, MAX_NAME_LEN );
-    status = parseRodsPath (rodsPathInp.destPath, LazyUploadRodsEnv);
-    if(status < 0) {
-        rodsLog (LOG_DEBUG, "_upload: parseRodsPath error : %d", status);
-        return status;
+    if (status >= 0) {
+        bzero (&dataObjWriteInp, sizeof (dataObjWriteInp));
+        dataObjWriteInpBBuf.buf = buffer;
+        dataObjWriteInpBBuf.len = job->size;
+        dataObjWriteInp.l1descInx = fd;
+        dataObjWriteInp.len = job->size;
+
+        status = rcDataObjWrite (*conn, &dataObjWriteInp, &dataObjWriteInpBBuf);
+        if (status >= 0 && status != (int) job->size) {
+            status = SYS_COPY_LEN_ERR;
+        }
     }
 
+    bzero (&dataObjCloseInp, sizeof (dataObjCloseInp));
+    dataObjCloseInp.l1descInx = fd;
+    if (status >= 0) {
+        status = rcDataObjClose (*conn, &dataObjCloseInp);
+    } else {
+        rcDataObjClose (*conn, &dataObjCloseInp);
+    }
+
+    if (status < 0) {
+        goto error;
+    }
+
+    free(buffer);
+    return 0;
+
+error:
+    rodsLogError (LOG_ERROR, status, "_uploadChunk: upload of %s at %lld error", job->fileInfo->objPath, (rodsLong_t)job->offset);
+    if (isReadMsgError (status)) {
+        // the connection is broken, get a new one for the next chunk
+        rcDisconnect(*conn);
+        *conn = NULL;
+    }
+    free(buffer);
+    return status;
+}
+
+static int
+_connect(rcComm_t **conn) {
+    int status;
+    rErrMsg_t errMsg;
+
     // Connect
-    conn = rcConnect (LazyUploadRodsEnv->rodsHost, LazyUploadRodsEnv->rodsPort, LazyUploadRodsEnv->rodsUserName, LazyUploadRodsEnv->rodsZone, RECONN_TIMEOUT, &errMsg);
-    if (conn == NULL) {
-        rodsLog (LOG_DEBUG, "_upload: error occurred while connecting to irods");
+    *conn = rcConnect (LazyUploadRodsEnv->rodsHost, LazyUploadRodsEnv->rodsPort, LazyUploadRodsEnv->rodsUserName, LazyUploadRodsEnv->rodsZone, RECONN_TIMEOUT, &errMsg);
+    if (*conn == NULL) {
+        rodsLog (LOG_DEBUG, "_connect: error occurred while connecting to irods");
         return -EPIPE;
     }
 
     // Login
-    if (strcmp (LazyUploadRodsEnv->rodsUserName, PUBLIC_USER_NAME) != 0) { 
-        status = clientLogin(conn);
+    if (strcmp (LazyUploadRodsEnv->rodsUserName, PUBLIC_USER_NAME) != 0) {
+        status = clientLogin(*conn);
         if (status != 0) {
-            rodsLog (LOG_DEBUG, "_upload: ClientLogin error : %d", status);
-            rcDisconnect(conn);
+            rodsLog (LOG_DEBUG, "_connect: ClientLogin error : %d", status);
+            rcDisconnect(*conn);
+            *conn = NULL;
             return status;
         }
     }
 
-    // upload Buffered file
-    rodsLog (LOG_DEBUG, "_upload: upload %s", bufferPath);
-    bool prev = LazyUploadRodsArgs->force;
-    LazyUploadRodsArgs->force = True;
-    status = putUtil (&conn, LazyUploadRodsEnv, LazyUploadRodsArgs, &rodsPathInp);
-    LazyUploadRodsArgs->force = prev;
-    rodsLog (LOG_DEBUG, "_upload: complete uploading %s -> %s", bufferPath, destiRODSDir);
-
-    // Disconnect 
-    rcDisconnect(conn);
+    return (0);
+}
 
-    if(status < 0) {
-        rodsLog (LOG_DEBUG, "_upload: putUtil error : %d", status);
-        return status;
-    }
+/* precond: lock LazyUploadLock */
+static void
+_waitForEvent(int sleepTime) {
+#ifdef USE_BOOST
+    boost::system_time const tt = boost::get_system_time() + boost::posix_time::seconds(sleepTime);
+    boost::unique_lock<boost::mutex> boost_lock(*LazyUploadLock, boost::adopt_lock);
+    LazyUploadCond.timed_wait(boost_lock, tt);
+    boost_lock.release();
+#else
+    struct timespec timeout;
+    bzero (&timeout, sizeof (timeout));
+    timeout.tv_sec = time (0) + sleepTime;
+    pthread_cond_timedwait (&LazyUploadCond, &LazyUploadLock, &timeout);
+#endif
+}
 
-    return 0;
+/* precond: lock LazyUploadLock.
+ * workers and commits share the condition, so everyone is woken up */
+static void
+_notifyEvent() {
+#ifdef USE_BOOST
+    LazyUploadCond.notify_all();
+#else
+    pthread_cond_broadcast(&LazyUploadCond);
+#endif
 }
 
 static int
@@ -15,13 +15,16 @@
 #ifdef USE_BOOST
 	/*boost::mutex DescLock;*/
 	/* boost::mutex ConnLock;*/
-	boost::mutex* PathCacheLock = new boost::mutex();
+	/* boost::mutex* PathCacheLock; */
 	/* boost::mutex FileCacheLock; */
 	boost::thread*            ConnManagerThr;
 	boost::mutex*             ConnManagerLock = new boost::mutex();
 	boost::condition_variable ConnManagerCond;
     boost::mutex*             PreloadLock = new boost::mutex();
+    boost::condition_variable PreloadCond;
+    boost::mutex*             PreloadFileHandleLock = new boost::mutex();
     boost::mutex*             LazyUploadLock = new boost::mutex();
+    boost::condition_variable LazyUploadCond;
 #else
 	/*pthread_mutex_t DescLock;*/
 	/*pthread_mutex_t ConnLock;*/
@@ -31,7 +34,10 @@
 	pthread_mutex_t ConnManagerLock;
 	pthread_cond_t ConnManagerCond;
     pthread_mutex_t PreloadLock;
+    pthread_cond_t PreloadCond;
+    pthread_mutex_t PreloadFileHandleLock;
     pthread_mutex_t LazyUploadLock;
+    pthread_cond_t LazyUploadCond;
 #endif
 
 #ifdef USE_BOOST
@@ -67,6 +73,18 @@
 	void notifyTimeoutWait( boost::mutex **ConnManagerLock, boost::condition_variable *ConnManagerCond ) {
     	ConnManagerCond->notify_all( );
 	}
+	/* the state is tested under the mutex, a notify cannot be missed */
+	void waitConnReq( connReqWait_t *myConnReqWait ) {
+	    boost::unique_lock< boost::mutex > boost_lock( *myConnReqWait->mutex );
+	    while ( myConnReqWait->state == 0 ) {
+	        myConnReqWait->cond.wait( boost_lock );
+	    }
+	}
+	void notifyConnReq( connReqWait_t *myConnReqWait ) {
+	    boost::unique_lock< boost::mutex > boost_lock( *myConnReqWait->mutex );
+	    myConnReqWait->state = 1;
+	    myConnReqWait->cond.notify_all( );
+	}
 #else
 /*#define UNLOCK(Lock) (pthread_mutex_unlock (&(Lock)))
 #define LOCK(Lock) (pthread_mutex_lock (&(Lock)))
@@ -104,4 +122,18 @@
 		pthread_cond_signal (cond);
 		pthread_mutex_unlock (mutex);
 	}
+	/* the state is tested under the mutex, a notify cannot be missed */
+	void waitConnReq(connReqWait_t *myConnReqWait) {
+		pthread_mutex_lock (&myConnReqWait->mutex);
+		while (myConnReqWait->state == 0) {
+			pthread_cond_wait (&myConnReqWait->cond, &myConnReqWait->mutex);
+		}
+		pthread_mutex_unlock (&myConnReqWait->mutex);
+	}
+	void notifyConnReq(connReqWait_t *myConnReqWait) {
+		pthread_mutex_lock (&myConnReqWait->mutex);
+		myConnReqWait->state = 1;
+		pthread_cond_signal (&myConnReqWait->cond);
+		pthread_mutex_unlock (&myConnReqWait->mutex);
+	}
 #endif
@@ -0,0 +1,781 @@
+/*** For more information please refer to files in the COPYRIGHT directory ***/
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <stddef.h>
+#include <errno.h>
+#include <time.h>
+#include <assert.h>
+#include <pthread.h>
+#include <sys/types.h>
+#include <sys/stat.h>
+#include <sys/mman.h>
+#include "irodsFs.h"
+#include "iFuseLib.h"
+#include "iFuseOper.h"
+#include "hashtable.h"
+#include "iFuseLib.MetaStore.h"
+#include "iFuseLib.Lock.h"
+#include "iFuseLib.FSUtils.h"
+
+/**************************************************************************
+ * global variables
+ **************************************************************************/
+static metaStoreConfig_t MetaStoreConfig;
+static metaStoreStats_t MetaStoreStats;
+static rodsEnv *MetaStoreRodsEnv;
+
+/* protects everything below, the log is only touched under it */
+static pthread_mutex_t MetaStoreLock;
+static int MetaStoreLoaded = 0;         /* 1 once loaded, -1 if it could not be */
+static char MetaStorePath[MAX_NAME_LEN];
+static int MetaStoreFd = -1;
+static char *MetaStoreMap = NULL;       /* maxSize bytes reserved, the log is read through it */
+static rodsLong_t MetaStoreEnd = 0;     /* where the next record is appended */
+static rodsLong_t MetaStoreLiveBytes = 0;   /* of the latest records of present paths */
+
+/* open addressing table (linear probing) of the offsets of the latest
+ * record of each path, 0 marks an empty slot */
+static rodsLong_t *MetaStoreIndex = NULL;
+static int MetaStoreIndexSlots = 0;
+static int MetaStoreIndexEntries = 0;
+
+static Hashtable *MetaStoreCollTable = NULL;    /* collections checked in this mount */
+
+/**************************************************************************
+ * function definitions
+ **************************************************************************/
+static int _loadMetaStore();
+static int _openMetaStore();
+static void _closeMetaStore();
+static int _scanMetaStore(rodsLong_t fileSize);
+static int _compactMetaStore();
+static unsigned int _recordSum(const char *record, unsigned int len);
+static int _isValidRecord(rodsLong_t offset, rodsLong_t fileSize);
+static metaStoreRecord_t *_getRecord(rodsLong_t offset);
+static int _findIndexSlot(const char *path, unsigned int pathLen, int *found);
+static int _growIndex();
+static int _setIndex(rodsLong_t offset);
+static int _appendRecord(const char *path, rodsLong_t cachedTime, rodsLong_t collMtime, struct stat *stbuf);
+static int _removeRecord(const char *path);
+static void _fillStat(metaStoreRecord_t *record, struct stat *stbuf);
+
+/**************************************************************************
+ * public functions
+ **************************************************************************/
+int
+initMetaStore (metaStoreConfig_t *metaStoreConfig, rodsEnv *myRodsEnv) {
+    char hostName[MAX_NAME_LEN];
+
+    rodsLog (LOG_DEBUG, "initMetaStore: MyMetaStoreConfig.metaStore = %d", metaStoreConfig->metaStore);
+    rodsLog (LOG_DEBUG, "initMetaStore: MyMetaStoreConfig.cachePath = %s", metaStoreConfig->cachePath);
+    rodsLog (LOG_DEBUG, "initMetaStore: MyMetaStoreConfig.timeout = %d", metaStoreConfig->timeout);
+    rodsLog (LOG_DEBUG, "initMetaStore: MyMetaStoreConfig.collCheck = %d", metaStoreConfig->collCheck);
+
+    // copy given configuration
+    memcpy(&MetaStoreConfig, metaStoreConfig, sizeof(metaStoreConfig_t));
+    bzero(&MetaStoreStats, sizeof(metaStoreStats_t));
+    MetaStoreRodsEnv = myRodsEnv;
+
+    if(MetaStoreConfig.metaStore == 0) {
+        return (0);
+    }
+
+    // init lock
+    pthread_mutex_init(&MetaStoreLock, NULL);
+    MetaStoreCollTable = newHashTable(NUM_META_STORE_COLL_HASH_SLOT);
+
+    // paths are relative to the mounted collection, one log per mount source
+    rstrcpy(hostName, myRodsEnv->rodsHost, MAX_NAME_LEN);
+    snprintf(MetaStorePath, MAX_NAME_LEN, "%s/%s@%s_%d_%lx%s", MetaStoreConfig.cachePath,
+        myRodsEnv->rodsUserName, hostName, myRodsEnv->rodsPort, myhash(myRodsEnv->rodsCwd), META_STORE_EXT);
+
+    // the log is loaded at the first lookup, not to hold up the mount
+    MetaStoreLoaded = 0;
+    return (0);
+}
+
+int
+uninitMetaStore (metaStoreConfig_t *metaStoreConfig) {
+    metaStoreStats_t stats;
+
+    if(MetaStoreConfig.metaStore == 0) {
+        return (0);
+    }
+
+    getMetaStoreStats(&stats);
+    rodsLog (LOG_NOTICE, "metadata store: %lld hits, %lld after collection checks, %lld misses, %lld appends, %lld paths, %lld compactions",
+        stats.hits, stats.collHits, stats.misses, stats.appends, stats.records, stats.compactions);
+
+    pthread_mutex_lock(&MetaStoreLock);
+    _closeMetaStore();
+    if(MetaStoreCollTable != NULL) {
+        deleteHashTable(MetaStoreCollTable, free);
+        MetaStoreCollTable = NULL;
+    }
+    pthread_mutex_unlock(&MetaStoreLock);
+
+    pthread_mutex_destroy(&MetaStoreLock);
+    return (0);
+}
+
+int
+isMetaStoreEnabled () {
+    // check whether metadata store is enabled
+    if(MetaStoreConfig.metaStore == 0) {
+        return -1;
+    }
+    return 0;
+}
+
+/*
+ * returns 0 with the stored stat of path in stbuf if it is recent enough.
+ * returns 1 if the stat is older but may be trusted once the parent
+ * collection is found to have collMtime still (collCheck), -1 otherwise.
+ */
+int
+lookupMetaStore (const char *path, struct stat *stbuf, time_t *collMtime) {
+    metaStoreRecord_t *record;
+    int found;
+    int slot;
+    int status = -1;
+
+    if(MetaStoreConfig.metaStore == 0) {
+        return -1;
+    }
+
+    pthread_mutex_lock(&MetaStoreLock);
+    if(_loadMetaStore() == 0) {
+        slot = _findIndexSlot(path, strlen(path), &found);
+        if(found) {
+            record = _getRecord(MetaStoreIndex[slot]);
+            if(record->cachedTime != 0) {
+                if(MetaStoreConfig.timeout <= 0 || time(0) - record->cachedTime < MetaStoreConfig.timeout) {
+                    status = 0;
+                } else if(MetaStoreConfig.collCheck && record->collMtime != 0) {
+                    status = 1;
+                }
+
+                if(status >= 0) {
+                    _fillStat(record, stbuf);
+                    if(collMtime != NULL) {
+                        *collMtime = record->collMtime;
+                    }
+                }
+            }
+        }
+    }
+
+    if(status == 0) {
+        MetaStoreStats.hits++;
+    } else if(status < 0) {
+        MetaStoreStats.misses++;
+    }
+    pthread_mutex_unlock(&MetaStoreLock);
+    return status;
+}
+
+/* the entry of path was checked, trust it for another timeout */
+int
+refreshMetaStore (const char *path) {
+    metaStoreRecord_t *record;
+    struct stat stbuf;
+    int found;
+    int slot;
+    int status = -1;
+
+    if(MetaStoreConfig.metaStore == 0) {
+        return -1;
+    }
+
+    pthread_mutex_lock(&MetaStoreLock);
+    if(_loadMetaStore() == 0) {
+        slot = _findIndexSlot(path, strlen(path), &found);
+        if(found) {
+            record = _getRecord(MetaStoreIndex[slot]);
+            if(record->cachedTime != 0) {
+                _fillStat(record, &stbuf);
+                status = _appendRecord(path, time(0), record->collMtime, &stbuf);
+                MetaStoreStats.collHits++;
+            }
+        }
+    }
+    pthread_mutex_unlock(&MetaStoreLock);
+    return status;
+}
+
+/* store the stat of path just got from the server. collMtime is the mtime
+ * of its parent collection, 0 if not known */
+int
+putMetaStore (const char *path, struct stat *stbuf, time_t collMtime) {
+    metaStoreRecord_t *record;
+    rodsLong_t now = time(0);
+    int found;
+    int slot;
+    int status;
+
+    if(MetaStoreConfig.metaStore == 0) {
+        return -1;
+    }
+
+    pthread_mutex_lock(&MetaStoreLock);
+    status = _loadMetaStore();
+    if(status < 0) {
+        pthread_mutex_unlock(&MetaStoreLock);
+        return status;
+    }
+
+    // an unchanged stat is appended again only when half its time is over,
+    // so listing the same collections over and over does not grow the log
+    slot = _findIndexSlot(path, strlen(path), &found);
+    if(found) {
+        record = _getRecord(MetaStoreIndex[slot]);
+        if(record->cachedTime != 0 &&
+           record->mode == (unsigned int)stbuf->st_mode &&
+           record->size == stbuf->st_size &&
+           record->mtime == stbuf->st_mtime &&
+           record->ctime == stbuf->st_ctime &&
+           record->collMtime == collMtime &&
+           (MetaStoreConfig.timeout <= 0 || now - record->cachedTime < MetaStoreConfig.timeout / 2)) {
+            pthread_mutex_unlock(&MetaStoreLock);
+            return 0;
+        }
+    }
+
+    status = _appendRecord(path, now, collMtime, stbuf);
+    pthread_mutex_unlock(&MetaStoreLock);
+    return status;
+}
+
+/* path is gone or changed. a collection takes the paths under it along */
+int
+removeMetaStore (const char *path) {
+    metaStoreRecord_t *record;
+    unsigned int pathLen = strlen(path);
+    rodsLong_t compactions;
+    int isDir;
+    int found;
+    int slot;
+    int i;
+
+    if(MetaStoreConfig.metaStore == 0) {
+        return -1;
+    }
+
+    pthread_mutex_lock(&MetaStoreLock);
+    if(_loadMetaStore() < 0) {
+        pthread_mutex_unlock(&MetaStoreLock);
+        return -1;
+    }
+
+    slot = _findIndexSlot(path, pathLen, &found);
+    if(!found || _getRecord(MetaStoreIndex[slot])->cachedTime == 0) {
+        pthread_mutex_unlock(&MetaStoreLock);
+        return 0;
+    }
+
+    isDir = S_ISDIR(_getRecord(MetaStoreIndex[slot])->mode);
+    _removeRecord(path);
+
+    if(isDir) {
+        // slots are only replaced, never added, while removing. a compaction
+        // builds another index, removed paths are not in it any more
+        compactions = MetaStoreStats.compactions;
+        for(i = 0; MetaStoreLoaded > 0 && i < MetaStoreIndexSlots; i++) {
+            if(compactions != MetaStoreStats.compactions) {
+                compactions = MetaStoreStats.compactions;
+                i = -1;
+                continue;
+            }
+            if(MetaStoreIndex[i] == 0) {
+                continue;
+            }
+            record = _getRecord(MetaStoreIndex[i]);
+            if(record->cachedTime != 0 && record->pathLen > pathLen && record->pathLen < MAX_NAME_LEN) {
+                char recordPath[MAX_NAME_LEN];
+                // the mapping moves if the log is compacted
+                rstrcpy(recordPath, (char *)(record + 1), MAX_NAME_LEN);
+                if(strncmp(recordPath, path, pathLen) == 0 && recordPath[pathLen] == '/') {
+                    _removeRecord(recordPath);
+                }
+            }
+        }
+    }
+
+    pthread_mutex_unlock(&MetaStoreLock);
+    return 0;
+}
+
+/* returns 0 with the mtime of collPath if it was stat'ed on the server
+ * within the timeout, -1 otherwise */
+int
+checkMetaStoreColl (const char *collPath, time_t *mtime) {
+    metaStoreColl_t *coll;
+    int status = -1;
+
+    if(MetaStoreConfig.metaStore == 0) {
+        return -1;
+    }
+
+    pthread_mutex_lock(&MetaStoreLock);
+    coll = (metaStoreColl_t *)lookupFromHashTable(MetaStoreCollTable, (char *) collPath);
+    if(coll != NULL && time(0) - coll->checkedTime < MetaStoreConfig.timeout) {
+        *mtime = coll->mtime;
+        status = 0;
+    }
+    pthread_mutex_unlock(&MetaStoreLock);
+    return status;
+}
+
+int
+setMetaStoreColl (const char *collPath, time_t mtime) {
+    metaStoreColl_t *coll;
+
+    if(MetaStoreConfig.metaStore == 0) {
+        return -1;
+    }
+
+    pthread_mutex_lock(&MetaStoreLock);
+    coll = (metaStoreColl_t *)lookupFromHashTable(MetaStoreCollTable, (char *) collPath);
+    if(coll == NULL) {
+        coll = (metaStoreColl_t *)malloc(sizeof(metaStoreColl_t));
+        if(coll == NULL) {
+            pthread_mutex_unlock(&MetaStoreLock);
+            return SYS_MALLOC_ERR;
+        }
+        insertIntoHashTable(MetaStoreCollTable, (char *) collPath, coll);
+    }
+    coll->mtime = mtime;
+    coll->checkedTime = time(0);
+    pthread_mutex_unlock(&MetaStoreLock);
+    return 0;
+}
+
+int
+getMetaStoreStats (metaStoreStats_t *stats) {
+    if(stats == NULL) {
+        return SYS_INTERNAL_NULL_INPUT_ERR;
+    }
+
+    if(MetaStoreConfig.metaStore == 0) {
+        bzero(stats, sizeof(metaStoreStats_t));
+        return (0);
+    }
+
+    pthread_mutex_lock(&MetaStoreLock);
+    memcpy(stats, &MetaStoreStats, sizeof(metaStoreStats_t));
+    pthread_mutex_unlock(&MetaStoreLock);
+    return (0);
+}
+
+/**************************************************************************
+ * private functions
+ **************************************************************************/
+/* precond: lock MetaStoreLock */
+static int
+_loadMetaStore() {
+    int status;
+
+    if(MetaStoreLoaded != 0) {
+        return MetaStoreLoaded > 0 ? 0 : -1;
+    }
+
+    status = _openMetaStore();
+    if(status < 0) {
+        rodsLog (LOG_ERROR, "_loadMetaStore: cannot load %s, status = %d, metadata store is disabled", MetaStorePath, status);
+        _closeMetaStore();
+        MetaStoreLoaded = -1;
+        return -1;
+    }
+
+    rodsLog (LOG_DEBUG, "_loadMetaStore: loaded %lld paths from %s", MetaStoreStats.records, MetaStorePath);
+
+    MetaStoreLoaded = 1;
+
+    // mostly replaced or removed records
+    if(MetaStoreEnd > META_STORE_COMPACT_MIN_SIZE && MetaStoreLiveBytes < MetaStoreEnd / 2) {
+        _compactMetaStore();
+    }
+    return MetaStoreLoaded > 0 ? 0 : -1;
+}
+
+/* precond: lock MetaStoreLock.
+ * open or create the log, map it and index its records */
+static int
+_openMetaStore() {
+    metaStoreHeader_t header;
+    struct stat stbuf;
+    int status;
+
+    makeDirs(MetaStoreConfig.cachePath);
+
+    MetaStoreFd = open(MetaStorePath, O_RDWR | O_CREAT, 0600);
+    if(MetaStoreFd < 0) {
+        return errno ? (-1 * errno) : -1;
+    }
+
+    if(fstat(MetaStoreFd, &stbuf) < 0) {
+        return errno ? (-1 * errno) : -1;
+    }
+
+    // a log of another version or grown past the limit starts over
+    if(stbuf.st_size < (off_t)sizeof(metaStoreHeader_t) ||
+       stbuf.st_size > MetaStoreConfig.maxSize ||
+       pread(MetaStoreFd, &header, sizeof(header), 0) != sizeof(header) ||
+       memcmp(header.magic, META_STORE_MAGIC, sizeof(header.magic)) != 0 ||
+       header.version != META_STORE_VERSION ||
+       header.recordSize != sizeof(metaStoreRecord_t)) {
+
+        bzero(&header, sizeof(header));
+        memcpy(header.magic, META_STORE_MAGIC, sizeof(header.magic));
+        header.version = META_STORE_VERSION;
+        header.recordSize = sizeof(metaStoreRecord_t);
+
+        if(ftruncate(MetaStoreFd, 0) < 0 ||
+           pwrite(MetaStoreFd, &header, sizeof(header), 0) != sizeof(header)) {
+            return errno ? (-1 * errno) : -1;
+        }
+        stbuf.st_size = sizeof(header);
+    }
+
+    // the mapping covers appends up to maxSize without remapping
+    MetaStoreMap = (char *)mmap(NULL, MetaStoreConfig.maxSize, PROT_READ, MAP_SHARED, MetaStoreFd, 0);
+    if(MetaStoreMap == MAP_FAILED) {
+        MetaStoreMap = NULL;
+        return errno ? (-1 * errno) : -1;
+    }
+
+    status = _scanMetaStore(stbuf.st_size);
+    if(status < 0) {
+        return status;
+    }
+    return 0;
+}
+
+/* precond: lock MetaStoreLock */
+static void
+_closeMetaStore() {
+    if(MetaStoreMap != NULL) {
+        munmap(MetaStoreMap, MetaStoreConfig.maxSize);
+        MetaStoreMap = NULL;
+    }
+    if(MetaStoreFd >= 0) {
+        close(MetaStoreFd);
+        MetaStoreFd = -1;
+    }
+    if(MetaStoreIndex != NULL) {
+        free(MetaStoreIndex);
+        MetaStoreIndex = NULL;
+    }
+    MetaStoreIndexSlots = 0;
+    MetaStoreIndexEntries = 0;
+    MetaStoreEnd = 0;
+    MetaStoreLiveBytes = 0;
+    MetaStoreStats.records = 0;
+}
+
+/* precond: lock MetaStoreLock.
+ * index the records of the mapped log. a record torn by a crash ends the
+ * log, it is cut there */
+static int
+_scanMetaStore(rodsLong_t fileSize) {
+    rodsLong_t offset = sizeof(metaStoreHeader_t);
+
+    MetaStoreIndexSlots = META_STORE_INDEX_INIT_SLOTS;
+    MetaStoreIndexEntries = 0;
+    MetaStoreIndex = (rodsLong_t *)calloc(MetaStoreIndexSlots, sizeof(rodsLong_t));
+    if(MetaStoreIndex == NULL) {
+        return SYS_MALLOC_ERR;
+    }
+    MetaStoreLiveBytes = 0;
+    MetaStoreStats.records = 0;
+
+    while(_isValidRecord(offset, fileSize)) {
+        if(_setIndex(offset) < 0) {
+            return SYS_MALLOC_ERR;
+        }
+        offset += _getRecord(offset)->len;
+    }
+
+    if(offset < fileSize) {
+        rodsLog (LOG_NOTICE, "_scanMetaStore: %s is cut at %lld of %lld bytes", MetaStorePath, offset, fileSize);
+        if(ftruncate(MetaStoreFd, offset) < 0) {
+            return errno ? (-1 * errno) : -1;
+        }
+    }
+
+    MetaStoreEnd = offset;
+    return 0;
+}
+
+/* precond: lock MetaStoreLock.
+ * rewrite the log with the latest records of present paths only */
+static int
+_compactMetaStore() {
+    char tmpPath[MAX_NAME_LEN];
+    metaStoreHeader_t header;
+    FILE *fp;
+    int fd;
+    int status;
+    int i;
+
+    snprintf(tmpPath, MAX_NAME_LEN, "%s.tmp", MetaStorePath);
+    fd = open(tmpPath, O_WRONLY | O_CREAT | O_TRUNC, 0600);
+    fp = fd < 0 ? NULL : fdopen(fd, "w");
+    if(fp == NULL) {
+        if(fd >= 0) {
+            close(fd);
+        }
+        rodsLog (LOG_ERROR, "_compactMetaStore: cannot create %s, errno = %d", tmpPath, errno);
+        return errno ? (-1 * errno) : -1;
+    }
+
+    memcpy(&header, MetaStoreMap, sizeof(header));
+    fwrite(&header, sizeof(header), 1, fp);
+    for(i = 0; i < MetaStoreIndexSlots; i++) {
+        metaStoreRecord_t *record;
+
+        if(MetaStoreIndex[i] == 0) {
+            continue;
+        }
+        record = _getRecord(MetaStoreIndex[i]);
+        if(record->cachedTime != 0) {
+            fwrite(record, record->len, 1, fp);
+        }
+    }
+
+    if(fflush(fp) != 0 || ferror(fp)) {
+        rodsLog (LOG_ERROR, "_compactMetaStore: cannot write %s, errno = %d", tmpPath, errno);
+        fclose(fp);
+        unlink(tmpPath);
+        return errno ? (-1 * errno) : -1;
+    }
+    fclose(fp);
+
+    if(rename(tmpPath, MetaStorePath) < 0) {
+        rodsLog (LOG_ERROR, "_compactMetaStore: cannot rename %s, errno = %d", tmpPath, errno);
+        unlink(tmpPath);
+        return errno ? (-1 * errno) : -1;
+    }
+
+    rodsLog (LOG_DEBUG, "_compactMetaStore: %lld of %lld bytes are left", MetaStoreLiveBytes + (rodsLong_t)sizeof(header), MetaStoreEnd);
+
+    _closeMetaStore();
+    MetaStoreStats.compactions++;
+    status = _openMetaStore();
+    if(status < 0) {
+        rodsLog (LOG_ERROR, "_compactMetaStore: cannot reload %s, status = %d, metadata store is disabled", MetaStorePath, status);
+        _closeMetaStore();
+        MetaStoreLoaded = -1;
+    }
+    return status;
+}
+
+static unsigned int
+_recordSum(const char *record, unsigned int len) {
+    unsigned int sum = 2166136261u;
+    unsigned int i;
+
+    for(i = 0; i < len; i++) {
+        unsigned char c = record[i];
+        if(i >= offsetof(metaStoreRecord_t, sum) && i < offsetof(metaStoreRecord_t, sum) + sizeof(unsigned int)) {
+            c = 0;
+        }
+        sum ^= c;
+        sum *= 16777619u;
+    }
+    return sum;
+}
+
+/* precond: lock MetaStoreLock */
+static int
+_isValidRecord(rodsLong_t offset, rodsLong_t fileSize) {
+    metaStoreRecord_t *record;
+
+    if(offset + (rodsLong_t)sizeof(metaStoreRecord_t) > fileSize) {
+        return 0;
+    }
+
+    record = _getRecord(offset);
+    if(record->magic != META_STORE_RECORD_MAGIC ||
+       record->len % 8 != 0 ||
+       record->pathLen == 0 ||
+       record->len < sizeof(metaStoreRecord_t) + record->pathLen + 1 ||
+       offset + record->len > fileSize) {
+        return 0;
+    }
+
+    if(((char *)(record + 1))[record->pathLen] != '\0') {
+        return 0;
+    }
+    return _recordSum((char *)record, record->len) == record->sum;
+}
+
+static metaStoreRecord_t *
+_getRecord(rodsLong_t offset) {
+    return (metaStoreRecord_t *)(MetaStoreMap + offset);
+}
+
+/* precond: lock MetaStoreLock.
+ * returns the slot of path, or the empty slot it would go in */
+static int
+_findIndexSlot(const char *path, unsigned int pathLen, int *found) {
+    int mask = MetaStoreIndexSlots - 1;
+    int slot = myhash((char *) path) & mask;
+
+    while(MetaStoreIndex[slot] != 0) {
+        metaStoreRecord_t *record = _getRecord(MetaStoreIndex[slot]);
+        if(record->pathLen == pathLen && memcmp(record + 1, path, pathLen) == 0) {
+            *found = 1;
+            return slot;
+        }
+        slot = (slot + 1) & mask;
+    }
+
+    *found = 0;
+    return slot;
+}
+
+/* precond: lock MetaStoreLock */
+static int
+_growIndex() {
+    rodsLong_t *oldIndex = MetaStoreIndex;
+    int oldSlots = MetaStoreIndexSlots;
+    int found;
+    int i;
+
+    MetaStoreIndex = (rodsLong_t *)calloc(oldSlots * 2, sizeof(rodsLong_t));
+    if(MetaStoreIndex == NULL) {
+        MetaStoreIndex = oldIndex;
+        return SYS_MALLOC_ERR;
+    }
+    MetaStoreIndexSlots = oldSlots * 2;
+
+    for(i = 0; i < oldSlots; i++) {
+        if(oldIndex[i] != 0) {
+            metaStoreRecord_t *record = _getRecord(oldIndex[i]);
+            int slot = _findIndexSlot((char *)(record + 1), record->pathLen, &found);
+            MetaStoreIndex[slot] = oldIndex[i];
+        }
+    }
+
+    free(oldIndex);
+    return 0;
+}
+
+/* precond: lock MetaStoreLock.
+ * make the record at offset the latest of its path */
+static int
+_setIndex(rodsLong_t offset) {
+    metaStoreRecord_t *record = _getRecord(offset);
+    metaStoreRecord_t *oldRecord;
+    int found;
+    int slot;
+
+    // keep the load under 1/2
+    if((MetaStoreIndexEntries + 1) * 2 > MetaStoreIndexSlots) {
+        if(_growIndex() < 0) {
+            return SYS_MALLOC_ERR;
+        }
+    }
+
+    slot = _findIndexSlot((char *)(record + 1), record->pathLen, &found);
+    if(found) {
+        oldRecord = _getRecord(MetaStoreIndex[slot]);
+        if(oldRecord->cachedTime != 0) {
+            MetaStoreLiveBytes -= oldRecord->len;
+            MetaStoreStats.records--;
+        }
+    } else {
+        MetaStoreIndexEntries++;
+    }
+
+    MetaStoreIndex[slot] = offset;
+    if(record->cachedTime != 0) {
+        MetaStoreLiveBytes += record->len;
+        MetaStoreStats.records++;
+    }
+    return 0;
+}
+
+/* precond: lock MetaStoreLock.
+ * a stbuf of NULL appends the record telling that path is gone */
+static int
+_appendRecord(const char *path, rodsLong_t cachedTime, rodsLong_t collMtime, struct stat *stbuf) {
+    metaStoreRecord_t *record;
+    unsigned int pathLen = strlen(path);
+    unsigned int len = (sizeof(metaStoreRecord_t) + pathLen + 1 + 7) & ~7;
+    int status;
+
+    if(MetaStoreEnd + len > MetaStoreConfig.maxSize) {
+        if(MetaStoreLiveBytes + (rodsLong_t)sizeof(metaStoreHeader_t) + len > MetaStoreConfig.maxSize / 2) {
+            // compacting would not free enough, keep what is there
+            return -ENOSPC;
+        }
+        status = _compactMetaStore();
+        if(status < 0) {
+            return status;
+        }
+    }
+
+    record = (metaStoreRecord_t *)calloc(1, len);
+    if(record == NULL) {
+        return SYS_MALLOC_ERR;
+    }
+
+    record->magic = META_STORE_RECORD_MAGIC;
+    record->len = len;
+    record->pathLen = pathLen;
+    if(stbuf != NULL) {
+        record->cachedTime = cachedTime;
+        record->collMtime = collMtime;
+        record->size = stbuf->st_size;
+        record->mtime = stbuf->st_mtime;
+        record->ctime = stbuf->st_ctime;
+        record->mode = stbuf->st_mode;
+    }
+    memcpy(record + 1, path, pathLen);
+    record->sum = _recordSum((char *)record, len);
+
+    if(pwrite(MetaStoreFd, record, len, MetaStoreEnd) != (ssize_t)len) {
+        status = errno ? (-1 * errno) : -1;
+        rodsLog (LOG_ERROR, "_appendRecord: cannot append to %s, status = %d", MetaStorePath, status);
+        free(record);
+        return status;
+    }
+    free(record);
+
+    status = _setIndex(MetaStoreEnd);
+    MetaStoreEnd += len;
+    MetaStoreStats.appends++;
+    return status;
+}
+
+/* precond: lock MetaStoreLock */
+static int
+_removeRecord(const char *path) {
+    int status;
+
+    status = _appendRecord(path, 0, 0, NULL);
+    if(status < 0 && MetaStoreFd >= 0) {
+        // the old record must not be found, in this mount or the next one
+        rodsLog (LOG_ERROR, "_removeRecord: cannot remove %s, status = %d, metadata store is cleared and disabled", path, status);
+        if(ftruncate(MetaStoreFd, 0) < 0) {
+            unlink(MetaStorePath);
+        }
+        _closeMetaStore();
+        MetaStoreLoaded = -1;
+    }
+    return status;
+}
+
+static void
+_fillStat(metaStoreRecord_t *record, struct stat *stbuf) {
+    memset(stbuf, 0, sizeof(struct stat));
+    if(S_ISDIR(record->mode)) {
+        fillDirStat(stbuf, record->ctime, record->mtime, record->mtime);
+    } else {
+        fillFileStat(stbuf, record->mode & 07777, record->size, record->ctime, record->mtime, record->mtime);
+    }
+    stbuf->st_mode = record->mode;
+}
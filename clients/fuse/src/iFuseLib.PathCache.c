@@ -12,76 +12,176 @@
 #include "restructs.h"
 #include "iFuseLib.Lock.h"
 
-PathCacheTable *initPathCache() {
-    PathCacheTable *pctable = (PathCacheTable *) malloc(sizeof (PathCacheTable));
-    pctable->PathCacheLock = &pctable->lock;
-    pctable->NonExistPathTable = newHashTable(NUM_PATH_HASH_SLOT);
-    pctable->PathArrayTable = newHashTable(NUM_PATH_HASH_SLOT);
-    pthread_mutex_init(pctable->PathCacheLock, NULL); // *&
-    return pctable;
-}
+/**************************************************************************
+ * global variables
+ **************************************************************************/
+static pathCacheConfig_t PathCacheConfig = {
+    PATH_CACHE_DEFAULT_NUM_SHARDS,
+    PATH_CACHE_DEFAULT_MAX_ENTRIES,
+    CACHE_EXPIRE_TIME,
+    NON_EXIST_CACHE_EXPIRE_TIME
+};
+static pageCacheConfig_t PageCacheConfig = {
+    0,
+    -1,
+    NULL
+};
+static char **ImmutableColls = NULL;
+static int NumImmutableColls = 0;
+
+/**************************************************************************
+ * function definitions
+ **************************************************************************/
+static int _initPathCacheIndex (pathCacheIndex_t *index, int maxEntries, int timeout);
+static int _initPathCacheShard (pathCacheShard_t *shard, int maxEntries);
+static pathCacheShard_t *_getPathCacheShard (PathCacheTable *pctable, unsigned long hashValue);
+static unsigned long _getPathCacheSlot (PathCacheTable *pctable, pathCacheIndex_t *index, unsigned long hashValue);
+static int _findPathCacheSlot (PathCacheTable *pctable, pathCacheIndex_t *index, char *inPath, unsigned long hashValue);
+static int _growPathCacheIndex (PathCacheTable *pctable, pathCacheIndex_t *index);
+static int _insertPathCacheEntry (PathCacheTable *pctable, pathCacheIndex_t *index, pathCache_t *tmpPathCache);
+static void _removePathCacheSlot (PathCacheTable *pctable, pathCacheIndex_t *index, int slot);
+static void _lruUnlink (pathCacheIndex_t *index, pathCache_t *tmpPathCache);
+static void _lruPushFront (pathCacheIndex_t *index, pathCache_t *tmpPathCache);
+static int _isPathCachePinned (pathCache_t *tmpPathCache);
+static int _isPathCacheExpired (pathCacheIndex_t *index, pathCache_t *tmpPathCache, time_t now);
+static int _rmPathFromIndex (PathCacheTable *pctable, pathCacheIndex_t *index, char *inPath, unsigned long hashValue);
+static int _addPathToIndex (PathCacheTable *pctable, pathCacheShard_t *shard, pathCacheIndex_t *index, pathCache_t *tmpPathCache);
+static int _shrinkPathCacheIndex (PathCacheTable *pctable, pathCacheShard_t *shard, pathCacheIndex_t *index, time_t now);
+static int _lookupPathCacheIndex (PathCacheTable *pctable, pathCacheShard_t *shard, pathCacheIndex_t *index, char *inPath, unsigned long hashValue, pathCache_t **outPathCache);
+static int _isInImmutableColl (char *objPath);
+static void _freeImmutableColls ();
 
+/**************************************************************************
+ * public functions
+ **************************************************************************/
 int
-matchAndLockPathCache( PathCacheTable *pctable, char *inPath, pathCache_t **outPathCache ) {
-    int status;
-    LOCK(*pctable->PathCacheLock);
-    status = _matchAndLockPathCache(pctable, inPath, outPathCache);
-    UNLOCK(*pctable->PathCacheLock);
-    return status;
+setPathCacheConfig (pathCacheConfig_t *config) {
+    if (config == NULL) {
+        return SYS_INTERNAL_NULL_INPUT_ERR;
+    }
+
+    if (config->numShards > 0) {
+        PathCacheConfig.numShards = config->numShards;
+    }
+    if (config->maxEntries > 0) {
+        PathCacheConfig.maxEntries = config->maxEntries;
+    }
+    /* 0 disables expiration */
+    if (config->timeout >= 0) {
+        PathCacheConfig.timeout = config->timeout;
+    }
+    /* 0 disables the non-existing path cache */
+    if (config->nonExistTimeout >= 0) {
+        PathCacheConfig.nonExistTimeout = config->nonExistTimeout;
+    }
+    return 0;
 }
 
 int
-_matchAndLockPathCache( PathCacheTable *pctable, char *inPath, pathCache_t **outPathCache ) {
-	*outPathCache = (pathCache_t *)lookupFromHashTable(pctable->PathArrayTable, inPath);
+setPageCacheConfig (pageCacheConfig_t *config) {
+    char *colls, *coll, *savePtr;
 
-	if(*outPathCache!=NULL) {
-		LOCK_STRUCT(**outPathCache);
-		return 1;
+    if (config == NULL) {
+        return SYS_INTERNAL_NULL_INPUT_ERR;
     }
 
+    PageCacheConfig.check = config->check;
+    PageCacheConfig.attrTimeout = config->attrTimeout;
+    /* only the split list is used, the caller keeps its string */
+    _freeImmutableColls ();
+
+    if (config->immutableColls == NULL) {
+        return 0;
+    }
+
+    /* split the list once, opens only compare prefixes */
+    colls = strdup (config->immutableColls);
+    for (coll = strtok_r (colls, ":", &savePtr); coll != NULL; coll = strtok_r (NULL, ":", &savePtr)) {
+        int len = strlen (coll);
+        /* the root needs no trailing '/' stripped */
+        while (len > 1 && coll[len - 1] == '/') {
+            coll[--len] = '\0';
+        }
+        ImmutableColls = (char **) realloc (ImmutableColls, sizeof (char *) * (NumImmutableColls + 1));
+        ImmutableColls[NumImmutableColls++] = strdup (coll);
+    }
+    free (colls);
     return 0;
 }
 
 int
-addPathToCache( pthread_mutex_t *PathCacheLock, char *inPath, fileCache_t *fileCache, Hashtable *pathQueArray, struct stat *stbuf, pathCache_t **outPathCache ) {
-    int status;
+clearPageCacheConfig () {
+    _freeImmutableColls ();
+    return 0;
+}
 
-    LOCK (*PathCacheLock);
-    status = _addPathToCache (inPath, fileCache, pathQueArray, stbuf, outPathCache);
-    UNLOCK (*PathCacheLock);
-    return status;
+PathCacheTable *initPathCache() {
+    PathCacheTable *pctable;
+    int maxEntriesPerShard;
+    int i;
+
+    pctable = (PathCacheTable *) malloc (sizeof (PathCacheTable));
+    if (pctable == NULL) {
+        return NULL;
+    }
+
+    pctable->numShards = PathCacheConfig.numShards;
+    pctable->shards = (pathCacheShard_t *) malloc (sizeof (pathCacheShard_t) * pctable->numShards);
+    if (pctable->shards == NULL) {
+        free (pctable);
+        return NULL;
+    }
+
+    maxEntriesPerShard = PathCacheConfig.maxEntries / pctable->numShards;
+    if (maxEntriesPerShard < 1) {
+        maxEntriesPerShard = 1;
+    }
+
+    for (i = 0; i < pctable->numShards; i++) {
+        _initPathCacheShard (&pctable->shards[i], maxEntriesPerShard);
+    }
+    return pctable;
 }
 
 int
-_addPathToCache( char *inPath, fileCache_t *fileCache, Hashtable *pathQueArray, struct stat *stbuf, pathCache_t **outPathCache ) {
-    pathCache_t *tmpPathCache = newPathCache(inPath, fileCache, stbuf, time(0));
-    insertIntoHashTable(pathQueArray, inPath, tmpPathCache);
-    if(outPathCache!=NULL) {
-    	*outPathCache = tmpPathCache;
+getPathCacheStats (PathCacheTable *pctable, pathCacheStats_t *stats) {
+    int i;
+
+    if (pctable == NULL || stats == NULL) {
+        return SYS_INTERNAL_NULL_INPUT_ERR;
+    }
+
+    bzero (stats, sizeof (pathCacheStats_t));
+    for (i = 0; i < pctable->numShards; i++) {
+        pathCacheShard_t *shard = &pctable->shards[i];
+        LOCK_STRUCT(*shard);
+        stats->entries += shard->exist.numEntries;
+        stats->nonExistEntries += shard->nonExist.numEntries;
+        stats->hits += shard->hits;
+        stats->nonExistHits += shard->nonExistHits;
+        stats->misses += shard->misses;
+        stats->evictions += shard->evictions;
+        stats->expirations += shard->expirations;
+        UNLOCK_STRUCT(*shard);
     }
     return 0;
 }
 
 int
-rmPathFromCache( pthread_mutex_t *PathCacheLock, char *inPath, Hashtable *pathQueArray ) {
+matchAndLockPathCache( PathCacheTable *pctable, char *inPath, pathCache_t **outPathCache ) {
+    unsigned long hashValue = myhash (inPath);
+    pathCacheShard_t *shard = _getPathCacheShard (pctable, hashValue);
     int status;
-    LOCK (*PathCacheLock);
-    status = _rmPathFromCache (inPath, pathQueArray);
-    UNLOCK (*PathCacheLock);
-    return status;
-}
 
-int
-_rmPathFromCache( char *inPath, Hashtable *pathQueArray ) {
-    pathCache_t *tmpPathCache = (pathCache_t *) deleteFromHashTable(pathQueArray, inPath);
-
-    if(tmpPathCache!=NULL) {
-    	_freePathCache (tmpPathCache);
-	    return 1;
-    }
-    else {
-	    return 0;
+    LOCK_STRUCT(*shard);
+    status = _lookupPathCacheIndex (pctable, shard, &shard->exist, inPath, hashValue, outPathCache);
+    if (status == 1) {
+        shard->hits++;
+    } else {
+        shard->misses++;
     }
+    UNLOCK_STRUCT(*shard);
+    return status;
 }
 
 int updatePathCacheStatFromFileCache (pathCache_t *tmpPathCache) {
@@ -120,79 +220,241 @@ int _updatePathCacheStatFromFileCache( pathCache_t *tmpPathCache ) {
 	}
 }
 
-int _pathNotExist(PathCacheTable *pctable, char *path) {
-    _rmPathFromCache((char *) path, pctable->PathArrayTable);
-    _rmPathFromCache((char *) path, pctable->NonExistPathTable);
-
-	insertIntoHashTable(pctable->NonExistPathTable, (char *) path, NULL);
-	return 0;
+/* precond: lock tmpPathCache. stbuf is a stat of the path just taken */
+int _setPathCacheStat( pathCache_t *tmpPathCache, struct stat *stbuf ) {
+    tmpPathCache->stbuf = *stbuf;
+    tmpPathCache->statValid = 1;
+    return 0;
 }
 
-int _pathExist(PathCacheTable *pctable, char *inPath, fileCache_t *fileCache, struct stat *stbuf, pathCache_t **outPathCache) {
-    _rmPathFromCache((char *) inPath, pctable->PathArrayTable);
-    _rmPathFromCache((char *) inPath, pctable->NonExistPathTable);
-    _addPathToCache(inPath, fileCache, pctable->PathArrayTable, stbuf, outPathCache);
-	return 0;
-}
+int lookupPathExist(PathCacheTable *pctable, char *inPath, pathCache_t **paca) {
+    unsigned long hashValue = myhash (inPath);
+    pathCacheShard_t *shard = _getPathCacheShard (pctable, hashValue);
+    int status;
 
-int _pathReplace(PathCacheTable *pctable, char *inPath, fileCache_t *fileCache, struct stat *stbuf, pathCache_t **outPathCache) {
-    _rmPathFromCache(inPath, pctable->PathArrayTable);
-    _addPathToCache(inPath, fileCache, pctable->PathArrayTable, stbuf, outPathCache);
-    deleteFromHashTable(pctable->NonExistPathTable, (char *) inPath);
-	return 0;
+    LOCK_STRUCT(*shard);
+    status = _lookupPathCacheIndex (pctable, shard, &shard->exist, inPath, hashValue, paca);
+    if (status == 1) {
+        UNLOCK_STRUCT(**paca);
+        shard->hits++;
+    } else {
+        shard->misses++;
+    }
+    UNLOCK_STRUCT(*shard);
+    return status;
 }
 
-int _lookupPathExist(PathCacheTable *pctable, char *inPath, pathCache_t **paca) {
-	return (*paca = (pathCache_t *) lookupFromHashTable(pctable->NonExistPathTable, inPath)) == NULL? 0 : 1;
-}
+int lookupPathNotExist(PathCacheTable *pctable, char *inPath) {
+    unsigned long hashValue = myhash (inPath);
+    pathCacheShard_t *shard = _getPathCacheShard (pctable, hashValue);
+    pathCache_t *tmpPathCache;
+    int status;
 
-int lookupPathExist(PathCacheTable *pctable, char *inPath, pathCache_t **paca) {
-	int status;
-	LOCK(*pctable->PathCacheLock);
-	status = _lookupPathExist(pctable, inPath, paca);
-	UNLOCK(*pctable->PathCacheLock);
-	return status;
-}
-int _lookupPathNotExist(PathCacheTable *pctable, char *inPath) {
-	return lookupFromHashTable(pctable->NonExistPathTable, inPath) == NULL? 0 : 1;
+    LOCK_STRUCT(*shard);
+    status = _lookupPathCacheIndex (pctable, shard, &shard->nonExist, inPath, hashValue, &tmpPathCache);
+    if (status == 1) {
+        UNLOCK_STRUCT(*tmpPathCache);
+        shard->nonExistHits++;
+    }
+    UNLOCK_STRUCT(*shard);
+    return status;
 }
 
-int lookupPathNotExist(PathCacheTable *pctable, char *inPath) {
-	int status;
-	LOCK(*pctable->PathCacheLock);
-	status = _lookupPathNotExist(pctable, inPath);
-	UNLOCK(*pctable->PathCacheLock);
-	return status;
-}
 int pathNotExist(PathCacheTable *pctable, char *inPath) {
-	int status = 0;
-	LOCK(*pctable->PathCacheLock);
-	status = _pathNotExist(pctable, inPath);
-	UNLOCK(*pctable->PathCacheLock);
-	return status;
+    unsigned long hashValue = myhash (inPath);
+    pathCacheShard_t *shard = _getPathCacheShard (pctable, hashValue);
+    pathCache_t *tmpPathCache = NULL;
+    int status = 0;
+
+    if (shard->nonExist.timeout > 0) {
+        tmpPathCache = newPathCache (inPath, NULL, NULL, time(0));
+        if (tmpPathCache != NULL) {
+            tmpPathCache->hashValue = hashValue;
+        }
+    }
+
+    LOCK_STRUCT(*shard);
+    _rmPathFromIndex (pctable, &shard->exist, inPath, hashValue);
+    if (tmpPathCache != NULL) {
+        _rmPathFromIndex (pctable, &shard->nonExist, inPath, hashValue);
+        status = _addPathToIndex (pctable, shard, &shard->nonExist, tmpPathCache);
+    }
+    UNLOCK_STRUCT(*shard);
+
+    if (status < 0) {
+        _freePathCache (tmpPathCache);
+    }
+    return status;
 }
+
+/* also drops any non-existing entry of the path, which is how creations
+ * (mknod, mkdir, readdir results) invalidate the non-existing path cache */
 int pathExist(PathCacheTable *pctable, char *inPath, fileCache_t *fileCache, struct stat *stbuf, pathCache_t **outPathCache) {
-	int status = 0;
-	LOCK(*pctable->PathCacheLock);
-	status = _pathExist(pctable, inPath, fileCache, stbuf, outPathCache);
-	UNLOCK(*pctable->PathCacheLock);
-	return status;
+    unsigned long hashValue = myhash (inPath);
+    pathCacheShard_t *shard = _getPathCacheShard (pctable, hashValue);
+    pathCache_t *tmpPathCache;
+    int status;
+
+    tmpPathCache = newPathCache (inPath, fileCache, stbuf, time(0));
+    if (tmpPathCache == NULL) {
+        if (outPathCache != NULL) {
+            *outPathCache = NULL;
+        }
+        return SYS_MALLOC_ERR;
+    }
+    tmpPathCache->hashValue = hashValue;
+
+    LOCK_STRUCT(*shard);
+    _rmPathFromIndex (pctable, &shard->nonExist, inPath, hashValue);
+    _rmPathFromIndex (pctable, &shard->exist, inPath, hashValue);
+    status = _addPathToIndex (pctable, shard, &shard->exist, tmpPathCache);
+    UNLOCK_STRUCT(*shard);
+
+    if (status < 0) {
+        _freePathCache (tmpPathCache);
+        tmpPathCache = NULL;
+    }
+    if (outPathCache != NULL) {
+        *outPathCache = tmpPathCache;
+    }
+    return status;
 }
 
-int _clearPathFromCache(PathCacheTable *pctable, char *inPath) {
-    _rmPathFromCache(inPath, pctable->PathArrayTable);
-    deleteFromHashTable(pctable->NonExistPathTable, inPath);
-	return 0;
+/* pathExist for the entries of a listing page, taking each shard lock once.
+ * paths that are cached and not expired are kept, they may hold a file cache.
+ * those without a stat get the one of the listing */
+int pathExistBatch(PathCacheTable *pctable, char **inPaths, struct stat *stbufs, int count) {
+    pathCache_t **entries;
+    time_t now = time(0);
+    int added = 0;
+    int i, s;
+
+    if (count <= 0) {
+        return 0;
+    }
+
+    entries = (pathCache_t **) malloc (sizeof (pathCache_t *) * count);
+    if (entries == NULL) {
+        return SYS_MALLOC_ERR;
+    }
+
+    for (i = 0; i < count; i++) {
+        entries[i] = newPathCache (inPaths[i], NULL, &stbufs[i], now);
+        if (entries[i] != NULL) {
+            entries[i]->hashValue = myhash (inPaths[i]);
+        }
+    }
+
+    for (s = 0; s < pctable->numShards; s++) {
+        pathCacheShard_t *shard = &pctable->shards[s];
+        int locked = 0;
+
+        for (i = 0; i < count; i++) {
+            pathCache_t *tmpPathCache = entries[i];
+            int slot;
+
+            if (tmpPathCache == NULL || _getPathCacheShard (pctable, tmpPathCache->hashValue) != shard) {
+                continue;
+            }
+            if (!locked) {
+                LOCK_STRUCT(*shard);
+                locked = 1;
+            }
+
+            _rmPathFromIndex (pctable, &shard->nonExist, inPaths[i], tmpPathCache->hashValue);
+            slot = _findPathCacheSlot (pctable, &shard->exist, inPaths[i], tmpPathCache->hashValue);
+            if (slot >= 0) {
+                pathCache_t *oldPathCache = shard->exist.slots[slot];
+                int expired;
+
+                LOCK_STRUCT(*oldPathCache);
+                expired = _isPathCacheExpired (&shard->exist, oldPathCache, now);
+                if (!expired && !oldPathCache->statValid) {
+                    _setPathCacheStat (oldPathCache, &stbufs[i]);
+                }
+                UNLOCK_STRUCT(*oldPathCache);
+                if (!expired) {
+                    continue;
+                }
+                _rmPathFromIndex (pctable, &shard->exist, inPaths[i], tmpPathCache->hashValue);
+                shard->expirations++;
+            }
+
+            if (_insertPathCacheEntry (pctable, &shard->exist, tmpPathCache) == 0) {
+                entries[i] = NULL;
+                added++;
+            }
+        }
+
+        if (locked) {
+            _shrinkPathCacheIndex (pctable, shard, &shard->exist, now);
+            UNLOCK_STRUCT(*shard);
+        }
+    }
+
+    /* not inserted */
+    for (i = 0; i < count; i++) {
+        if (entries[i] != NULL) {
+            _freePathCache (entries[i]);
+        }
+    }
+    free (entries);
+    return added;
 }
 
+int pathReplace(PathCacheTable *pctable, char *inPath, fileCache_t *fileCache, struct stat *stbuf, pathCache_t **outPathCache) {
+    return pathExist (pctable, inPath, fileCache, stbuf, outPathCache);
+}
+
+/* forget whether the path exists or not */
 int clearPathFromCache(PathCacheTable *pctable, char *inPath) {
-	int status = 0;
-	LOCK(*pctable->PathCacheLock);
-	status = _clearPathFromCache(pctable, inPath);
-	UNLOCK(*pctable->PathCacheLock);
-	return status;
+    unsigned long hashValue = myhash (inPath);
+    pathCacheShard_t *shard = _getPathCacheShard (pctable, hashValue);
+
+    LOCK_STRUCT(*shard);
+    _rmPathFromIndex (pctable, &shard->exist, inPath, hashValue);
+    _rmPathFromIndex (pctable, &shard->nonExist, inPath, hashValue);
+    UNLOCK_STRUCT(*shard);
+    return 0;
 }
 
+/* for operations that may create the path without knowing its stat */
+int clearPathNotExist(PathCacheTable *pctable, char *inPath) {
+    unsigned long hashValue = myhash (inPath);
+    pathCacheShard_t *shard = _getPathCacheShard (pctable, hashValue);
+
+    LOCK_STRUCT(*shard);
+    _rmPathFromIndex (pctable, &shard->nonExist, inPath, hashValue);
+    UNLOCK_STRUCT(*shard);
+    return 0;
+}
+
+
+/* whether an open of inPath may leave the kernel the pages it has of the
+ * file. that is the case if the file is in an immutable collection, or if
+ * the version in stbuf, just stat'ed on the server, is the one recorded at
+ * the last open. records the version in stbuf for the next open */
+int keepPageCache(PathCacheTable *pctable, char *inPath, char *objPath, struct stat *stbuf) {
+    pathCache_t *tmpPathCache;
+    int keep = 0;
+
+    if (_isInImmutableColl (objPath)) {
+        return 1;
+    }
+    if (PageCacheConfig.check == 0) {
+        return 0;
+    }
+
+    if (matchAndLockPathCache (pctable, inPath, &tmpPathCache) == 1) {
+        keep = tmpPathCache->pageCacheMtime != 0 &&
+               tmpPathCache->pageCacheMtime == stbuf->st_mtime &&
+               tmpPathCache->pageCacheSize == stbuf->st_size;
+        tmpPathCache->pageCacheMtime = stbuf->st_mtime;
+        tmpPathCache->pageCacheSize = stbuf->st_size;
+        UNLOCK_STRUCT(*tmpPathCache);
+    }
+    return keep;
+}
 
 int _addFileCacheForPath(pathCache_t *pathCache, fileCache_t *fileCache) {
 	if(pathCache->fileCache != NULL) {
@@ -203,3 +465,339 @@ int _addFileCacheForPath(pathCache_t *pathCache, fileCache_t *fileCache) {
 	return 0;
 }
 
+/**************************************************************************
+ * private functions
+ **************************************************************************/
+static int
+_initPathCacheIndex (pathCacheIndex_t *index, int maxEntries, int timeout) {
+    index->numSlots = PATH_CACHE_INDEX_INIT_SLOTS;
+    index->slots = (pathCache_t **) calloc (index->numSlots, sizeof (pathCache_t *));
+    index->numEntries = 0;
+    index->maxEntries = maxEntries;
+    index->timeout = timeout;
+    index->lruHead = NULL;
+    index->lruTail = NULL;
+    return index->slots == NULL ? SYS_MALLOC_ERR : 0;
+}
+
+static int
+_initPathCacheShard (pathCacheShard_t *shard, int maxEntries) {
+    int status;
+
+    shard->hits = 0;
+    shard->nonExistHits = 0;
+    shard->misses = 0;
+    shard->evictions = 0;
+    shard->expirations = 0;
+    INIT_STRUCT_LOCK(*shard);
+
+    status = _initPathCacheIndex (&shard->exist, maxEntries, PathCacheConfig.timeout);
+    if (status < 0) {
+        return status;
+    }
+    return _initPathCacheIndex (&shard->nonExist, maxEntries, PathCacheConfig.nonExistTimeout);
+}
+
+static pathCacheShard_t *
+_getPathCacheShard (PathCacheTable *pctable, unsigned long hashValue) {
+    return &pctable->shards[hashValue % pctable->numShards];
+}
+
+/* the low bits already picked the shard, so probe with the rest */
+static unsigned long
+_getPathCacheSlot (PathCacheTable *pctable, pathCacheIndex_t *index, unsigned long hashValue) {
+    return (hashValue / pctable->numShards) & (index->numSlots - 1);
+}
+
+/* precond: lock shard */
+static int
+_findPathCacheSlot (PathCacheTable *pctable, pathCacheIndex_t *index, char *inPath, unsigned long hashValue) {
+    unsigned long mask = index->numSlots - 1;
+    unsigned long slot = _getPathCacheSlot (pctable, index, hashValue);
+    pathCache_t *tmpPathCache;
+
+    while ((tmpPathCache = index->slots[slot]) != NULL) {
+        if (tmpPathCache->hashValue == hashValue && strcmp (tmpPathCache->localPath, inPath) == 0) {
+            return (int) slot;
+        }
+        slot = (slot + 1) & mask;
+    }
+    return -1;
+}
+
+/* precond: lock shard */
+static int
+_growPathCacheIndex (PathCacheTable *pctable, pathCacheIndex_t *index) {
+    pathCache_t **oldSlots = index->slots;
+    int oldNumSlots = index->numSlots;
+    pathCache_t **newSlots;
+    unsigned long mask;
+    int i;
+
+    newSlots = (pathCache_t **) calloc (oldNumSlots * 2, sizeof (pathCache_t *));
+    if (newSlots == NULL) {
+        return SYS_MALLOC_ERR;
+    }
+
+    index->slots = newSlots;
+    index->numSlots = oldNumSlots * 2;
+    mask = index->numSlots - 1;
+
+    for (i = 0; i < oldNumSlots; i++) {
+        if (oldSlots[i] != NULL) {
+            unsigned long slot = _getPathCacheSlot (pctable, index, oldSlots[i]->hashValue);
+            while (newSlots[slot] != NULL) {
+                slot = (slot + 1) & mask;
+            }
+            newSlots[slot] = oldSlots[i];
+        }
+    }
+    free (oldSlots);
+    return 0;
+}
+
+/* precond: lock shard, inPath is not in the index */
+static int
+_insertPathCacheEntry (PathCacheTable *pctable, pathCacheIndex_t *index, pathCache_t *tmpPathCache) {
+    unsigned long mask;
+    unsigned long slot;
+
+    /* keep load factor under 3/4 so probe sequences stay short */
+    if ((index->numEntries + 1) * 4 > index->numSlots * 3) {
+        int status = _growPathCacheIndex (pctable, index);
+        if (status < 0) {
+            return status;
+        }
+    }
+
+    mask = index->numSlots - 1;
+    slot = _getPathCacheSlot (pctable, index, tmpPathCache->hashValue);
+    while (index->slots[slot] != NULL) {
+        slot = (slot + 1) & mask;
+    }
+    index->slots[slot] = tmpPathCache;
+    index->numEntries++;
+    _lruPushFront (index, tmpPathCache);
+    return 0;
+}
+
+/* precond: lock shard. backward shift deletion, no tombstones are left behind */
+static void
+_removePathCacheSlot (PathCacheTable *pctable, pathCacheIndex_t *index, int slot) {
+    unsigned long mask = index->numSlots - 1;
+    unsigned long hole = (unsigned long) slot;
+    unsigned long next = hole;
+
+    _lruUnlink (index, index->slots[slot]);
+    index->slots[hole] = NULL;
+    index->numEntries--;
+
+    for (;;) {
+        unsigned long home;
+        next = (next + 1) & mask;
+        if (index->slots[next] == NULL) {
+            break;
+        }
+        home = _getPathCacheSlot (pctable, index, index->slots[next]->hashValue);
+        /* leave the entry where it is if its home lies cyclically in (hole, next] */
+        if (hole <= next ? (hole < home && home <= next) : (hole < home || home <= next)) {
+            continue;
+        }
+        index->slots[hole] = index->slots[next];
+        index->slots[next] = NULL;
+        hole = next;
+    }
+}
+
+static void
+_lruUnlink (pathCacheIndex_t *index, pathCache_t *tmpPathCache) {
+    if (tmpPathCache->lruPrev != NULL) {
+        tmpPathCache->lruPrev->lruNext = tmpPathCache->lruNext;
+    } else {
+        index->lruHead = tmpPathCache->lruNext;
+    }
+    if (tmpPathCache->lruNext != NULL) {
+        tmpPathCache->lruNext->lruPrev = tmpPathCache->lruPrev;
+    } else {
+        index->lruTail = tmpPathCache->lruPrev;
+    }
+    tmpPathCache->lruPrev = NULL;
+    tmpPathCache->lruNext = NULL;
+}
+
+static void
+_lruPushFront (pathCacheIndex_t *index, pathCache_t *tmpPathCache) {
+    tmpPathCache->lruPrev = NULL;
+    tmpPathCache->lruNext = index->lruHead;
+    if (index->lruHead != NULL) {
+        index->lruHead->lruPrev = tmpPathCache;
+    } else {
+        index->lruTail = tmpPathCache;
+    }
+    index->lruHead = tmpPathCache;
+}
+
+/* precond: lock tmpPathCache.
+ * an entry holding a newly created file cache is the only copy of its stat
+ * until the file is flushed, and the stat of an open file is kept up to
+ * date through its file cache, so neither must be expired or evicted */
+static int
+_isPathCachePinned (pathCache_t *tmpPathCache) {
+    int pinned = 0;
+
+    if (tmpPathCache->fileCache != NULL) {
+        if (TRYLOCK_STRUCT(*(tmpPathCache->fileCache)) != 0) {
+            return 1;
+        }
+        pinned = tmpPathCache->fileCache->state == HAVE_NEWLY_CREATED_CACHE ||
+            tmpPathCache->fileCache->openCount > 0;
+        UNLOCK_STRUCT(*(tmpPathCache->fileCache));
+    }
+    return pinned;
+}
+
+/* precond: lock tmpPathCache */
+static int
+_isPathCacheExpired (pathCacheIndex_t *index, pathCache_t *tmpPathCache, time_t now) {
+    if (index->timeout <= 0) {
+        return 0;
+    }
+    if (now - (time_t) tmpPathCache->cachedTime < index->timeout) {
+        return 0;
+    }
+    return !_isPathCachePinned (tmpPathCache);
+}
+
+/* precond: lock shard */
+static int
+_rmPathFromIndex (PathCacheTable *pctable, pathCacheIndex_t *index, char *inPath, unsigned long hashValue) {
+    pathCache_t *tmpPathCache;
+    int slot;
+
+    slot = _findPathCacheSlot (pctable, index, inPath, hashValue);
+    if (slot < 0) {
+        return 0;
+    }
+
+    tmpPathCache = index->slots[slot];
+    /* wait for current users of the entry before freeing it */
+    LOCK_STRUCT(*tmpPathCache);
+    _removePathCacheSlot (pctable, index, slot);
+    UNLOCK_STRUCT(*tmpPathCache);
+    _freePathCache (tmpPathCache);
+    return 1;
+}
+
+/* precond: lock shard, inPath is not in the index */
+static int
+_addPathToIndex (PathCacheTable *pctable, pathCacheShard_t *shard, pathCacheIndex_t *index, pathCache_t *tmpPathCache) {
+    int status;
+
+    status = _insertPathCacheEntry (pctable, index, tmpPathCache);
+    if (status < 0) {
+        return status;
+    }
+    _shrinkPathCacheIndex (pctable, shard, index, tmpPathCache->cachedTime);
+    return 0;
+}
+
+/* precond: lock shard.
+ * drop expired entries and then least recently used entries from the tail
+ * of the lru list until the index is back under its limit. entries that are
+ * locked by someone else or pinned are skipped */
+static int
+_shrinkPathCacheIndex (PathCacheTable *pctable, pathCacheShard_t *shard, pathCacheIndex_t *index, time_t now) {
+    pathCache_t *tmpPathCache = index->lruTail;
+    int removed = 0;
+
+    while (tmpPathCache != NULL) {
+        pathCache_t *prevPathCache = tmpPathCache->lruPrev;
+        int overLimit = index->numEntries > index->maxEntries;
+        int expired;
+
+        if (TRYLOCK_STRUCT(*tmpPathCache) != 0) {
+            tmpPathCache = prevPathCache;
+            continue;
+        }
+
+        expired = _isPathCacheExpired (index, tmpPathCache, now);
+        if (!expired && !overLimit) {
+            /* the rest of the list is newer */
+            UNLOCK_STRUCT(*tmpPathCache);
+            break;
+        }
+        if (!expired && _isPathCachePinned (tmpPathCache)) {
+            UNLOCK_STRUCT(*tmpPathCache);
+            tmpPathCache = prevPathCache;
+            continue;
+        }
+
+        _removePathCacheSlot (pctable, index, _findPathCacheSlot (pctable, index, tmpPathCache->localPath, tmpPathCache->hashValue));
+        UNLOCK_STRUCT(*tmpPathCache);
+        _freePathCache (tmpPathCache);
+
+        if (expired) {
+            shard->expirations++;
+        } else {
+            shard->evictions++;
+        }
+        removed++;
+        tmpPathCache = prevPathCache;
+    }
+    return removed;
+}
+
+/* precond: lock shard. on a hit the entry is returned locked */
+static int
+_lookupPathCacheIndex (PathCacheTable *pctable, pathCacheShard_t *shard, pathCacheIndex_t *index, char *inPath, unsigned long hashValue, pathCache_t **outPathCache) {
+    pathCache_t *tmpPathCache;
+    int slot;
+
+    *outPathCache = NULL;
+
+    slot = _findPathCacheSlot (pctable, index, inPath, hashValue);
+    if (slot < 0) {
+        return 0;
+    }
+
+    tmpPathCache = index->slots[slot];
+    LOCK_STRUCT(*tmpPathCache);
+    if (_isPathCacheExpired (index, tmpPathCache, time(0))) {
+        _removePathCacheSlot (pctable, index, slot);
+        UNLOCK_STRUCT(*tmpPathCache);
+        _freePathCache (tmpPathCache);
+        shard->expirations++;
+        return 0;
+    }
+
+    _lruUnlink (index, tmpPathCache);
+    _lruPushFront (index, tmpPathCache);
+    *outPathCache = tmpPathCache;
+    return 1;
+}
+
+static int
+_isInImmutableColl (char *objPath) {
+    int i;
+
+    for (i = 0; i < NumImmutableColls; i++) {
+        int len = strlen (ImmutableColls[i]);
+        if (strncmp (objPath, ImmutableColls[i], len) == 0 &&
+            (objPath[len] == '/' || (len == 1 && ImmutableColls[i][0] == '/'))) {
+            return 1;
+        }
+    }
+    return 0;
+}
+
+static void
+_freeImmutableColls () {
+    int i;
+
+    for (i = 0; i < NumImmutableColls; i++) {
+        free (ImmutableColls[i]);
+    }
+    free (ImmutableColls);
+    ImmutableColls = NULL;
+    NumImmutableColls = 0;
+}
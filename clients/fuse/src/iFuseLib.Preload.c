@@ -5,6 +5,7 @@
 #include <sys/types.h>
 #include <sys/stat.h>
 #include <sys/wait.h>
+#include <sys/mman.h>
 #include "irodsFs.h"
 #include "iFuseLib.h"
 #include "iFuseOper.h"
@@ -14,6 +15,9 @@
 #include "iFuseLib.Lock.h"
 #include "iFuseLib.FSUtils.h"
 #include "getUtil.h"
+#ifdef ENABLE_RANGE_FETCH
+#include "iFuseLib.RangeFetch.h"
+#endif
 
 /**************************************************************************
  * global variables
@@ -22,22 +26,53 @@ static preloadConfig_t PreloadConfig;
 static rodsEnv *PreloadRodsEnv;
 static rodsArguments_t *PreloadRodsArgs;
 
-static concurrentList_t *PreloadThreadList;
-static Hashtable *PreloadThreadTable;
+static Hashtable *PreloadJobTable;     /* queued or running, by iRODS path */
+static List *PreloadJobQueue[NUM_PRELOAD_PRIORITIES];
+static preloadWorker_t *PreloadWorkers = NULL;
+static int PreloadNumWorkers = 0;
+static int PreloadRunning = 0;
+static preloadStats_t PreloadStats;
 static Hashtable *PreloadFileHandleTable;
 
+/* index of preloaded files, so accounting and eviction never walk the
+ * cache dir. entries are in a min-heap on lastAccess */
+static Hashtable *PreloadCacheTable = NULL;
+static preloadCacheEntry_t **PreloadCacheHeap = NULL;
+static int PreloadCacheHeapSize = 0;
+static int PreloadCacheHeapSlots = 0;
+static rodsLong_t PreloadCacheSize = 0;     /* bytes of indexed files */
+static rodsLong_t PreloadPendingSize = 0;   /* bytes of queued and running jobs */
+static int PreloadJournalFd = -1;
+static int PreloadJournalRecords = 0;
+
+/* opens of recent files, preloaded or not, with the index in the journal.
+ * a file is only preloaded once it is opened again */
+static Hashtable *PreloadHistoryTable = NULL;
+static preloadHistoryEntry_t *PreloadHistoryHead = NULL;   /* most recently opened */
+static preloadHistoryEntry_t *PreloadHistoryTail = NULL;
+static int PreloadHistoryCount = 0;
+
 /**************************************************************************
  * function definitions
  **************************************************************************/
-static void *_preloadThread(void *arg);
-static int _download(const char *path, struct stat *stbufIn);
+static void *_preloadWorker(void *arg);
+static int _enqueueJob(const char *path, struct stat *stbuf, int priority);
+static preloadJob_t *_dequeueJob();
+static void _freeJob(preloadJob_t *job);
+static int _queuedJobs();
+static void _waitForJob(int sleepTime);
+static void _notifyWorkers(int all);
+static int _connect(rcComm_t **conn);
+static int _download(const char *path, struct stat *stbufIn, rcComm_t **conn);
 static int _completeDownload(const char *workPath, const char *cachePath, struct stat *stbuf);
+#ifdef ENABLE_RANGE_FETCH
+static int _downloadRanges(const char *path, struct stat *stbuf, const char *workPath);
+#endif
 static int _hasValidCache(const char *path, struct stat *stbuf);
 static int _getCachePath(const char *path, char *cachePath);
 static int _hasCache(const char *path);
 static int _invalidateCache(const char *path);
 static int _evictOldCache(off_t sizeNeeded);
-static int _findOldestCache(const char *path, char *oldCachePath, struct stat *oldStatbuf);
 static int _getCacheWorkPath(const char *path, char *cachePath);
 static int _preparePreloadCacheDir(const char *path);
 static int _removeAllCaches();
@@ -45,18 +80,52 @@ static int _removeAllIncompleteCaches();
 static int _removeIncompleteCaches(const char *path);
 static int _renameCache(const char *fromPath, const char *toPath);
 static int _truncateCache(const char *path, off_t size);
+static int _closeFileHandle(const char *path);
+static int _isFileHandleMapped(const char *path);
+static void _freeFileHandle(preloadFileHandleInfo_t *preloadFileHandleInfo);
 static int _getiRODSPath(const char *path, char *iRODSPath);
+static int _initCacheIndex();
+static void _uninitCacheIndex();
+static void _clearCacheIndex();
+static preloadCacheEntry_t *_putIndexEntry(const char *path, rodsLong_t size, time_t lastAccess);
+static void _deleteIndexEntry(preloadCacheEntry_t *entry);
+static int _indexAdd(const char *path, rodsLong_t size);
+static int _indexRemove(const char *path);
+static int _indexRemoveDir(const char *dirPath);
+static int _indexRename(const char *fromPath, const char *toPath);
+static int _indexSetSize(const char *path, rodsLong_t size);
+static int _indexTouch(const char *path);
+static void _heapSwap(int i, int j);
+static void _heapUp(int i);
+static void _heapDown(int i);
+static int _scanCacheDir(const char *dirPath);
+static int _getJournalPath(char *journalPath);
+static int _loadJournal();
+static int _writeJournal();
+static int _appendJournal(int type, const char *path, rodsLong_t size, time_t lastAccess);
+static int _appendRecord(preloadJournalRecord_t *record, const char *path);
+static preloadHistoryEntry_t *_putHistoryEntry(const char *path, rodsLong_t size, time_t mtime, time_t lastOpen, int opens, int pattern);
+static void _deleteHistoryEntry(preloadHistoryEntry_t *entry);
+static void _clearHistory();
+static int _appendHistory(preloadHistoryEntry_t *entry);
 
 /**************************************************************************
  * public functions
  **************************************************************************/
 int
 initPreload (preloadConfig_t *preloadConfig, rodsEnv *myPreloadRodsEnv, rodsArguments_t *myPreloadRodsArgs) {
+    int i;
+    int status;
+
     rodsLog (LOG_DEBUG, "initPreload: MyPreloadConfig.preload = %d", preloadConfig->preload);
     rodsLog (LOG_DEBUG, "initPreload: MyPreloadConfig.clearCache = %d", preloadConfig->clearCache);
     rodsLog (LOG_DEBUG, "initPreload: MyPreloadConfig.cachePath = %s", preloadConfig->cachePath);
     rodsLog (LOG_DEBUG, "initPreload: MyPreloadConfig.cacheMaxSize = %lld", preloadConfig->cacheMaxSize);
     rodsLog (LOG_DEBUG, "initPreload: MyPreloadConfig.preloadMinSize = %lld", preloadConfig->preloadMinSize);
+    rodsLog (LOG_DEBUG, "initPreload: MyPreloadConfig.numWorkers = %d", preloadConfig->numWorkers);
+    rodsLog (LOG_DEBUG, "initPreload: MyPreloadConfig.maxQueue = %d", preloadConfig->maxQueue);
+    rodsLog (LOG_DEBUG, "initPreload: MyPreloadConfig.classify = %d", preloadConfig->classify);
+    rodsLog (LOG_DEBUG, "initPreload: MyPreloadConfig.reuseWindow = %d", preloadConfig->reuseWindow);
     rodsLog (LOG_DEBUG, "initPreload: empty space = %lld", getEmptySpace(preloadConfig->cachePath));
 
     // copy given configuration
@@ -65,14 +134,21 @@ initPreload (preloadConfig_t *preloadConfig, rodsEnv *myPreloadRodsEnv, rodsArgu
     PreloadRodsArgs = myPreloadRodsArgs;
 
     // init hashtables
-    PreloadThreadTable = newHashTable(NUM_PRELOAD_THREAD_HASH_SLOT);
+    PreloadJobTable = newHashTable(NUM_PRELOAD_JOB_HASH_SLOT);
     PreloadFileHandleTable = newHashTable(NUM_PRELOAD_FILEHANDLE_HASH_SLOT);
 
-    // init lists
-    PreloadThreadList = newConcurrentList();
+    // init job queues
+    for(i=0;i<NUM_PRELOAD_PRIORITIES;i++) {
+        PreloadJobQueue[i] = newListNoRegion();
+    }
+    bzero(&PreloadStats, sizeof(preloadStats_t));
 
     // init lock
     INIT_LOCK(PreloadLock);
+    INIT_LOCK(PreloadFileHandleLock);
+#ifndef USE_BOOST
+    pthread_cond_init(&PreloadCond, NULL);
+#endif
 
     _preparePreloadCacheDir(preloadConfig->cachePath);
 
@@ -84,31 +160,87 @@ initPreload (preloadConfig_t *preloadConfig, rodsEnv *myPreloadRodsEnv, rodsArgu
         _removeAllIncompleteCaches();
     }
 
+    if(PreloadConfig.preload == 0) {
+        return (0);
+    }
+
+    // build cache index
+    _initCacheIndex();
+
+    // start workers
+    PreloadRunning = 1;
+    PreloadWorkers = (preloadWorker_t *)calloc(PreloadConfig.numWorkers, sizeof(preloadWorker_t));
+    for(i=0;i<PreloadConfig.numWorkers;i++) {
+#ifdef USE_BOOST
+        PreloadWorkers[i].thread = new boost::thread(_preloadWorker, (void *)&PreloadWorkers[i]);
+#else
+        status = pthread_create(&PreloadWorkers[i].thread, NULL, _preloadWorker, (void *)&PreloadWorkers[i]);
+        if(status != 0) {
+            rodsLog (LOG_ERROR, "initPreload: pthread_create failure, status = %d", status);
+            break;
+        }
+#endif
+        PreloadNumWorkers++;
+    }
+
+    if(PreloadNumWorkers == 0) {
+        // nobody would take the jobs
+        PreloadConfig.preload = 0;
+    }
+
     return (0);
 }
 
 int
 waitPreloadJobs () {
     int i;
-    int size;
+    int p;
+    preloadStats_t stats;
 
-    // destroy preload thread list
-    size = listSize(PreloadThreadList);
-    for(i=0;i<size;i++) {
-        LOCK(PreloadLock);
-        preloadThreadInfo_t *threadInfo = (preloadThreadInfo_t *)removeFirstElementOfConcurrentList(PreloadThreadList);
-        if(threadInfo != NULL) {
-            rodsLog (LOG_DEBUG, "waitPreloadJobs: Waiting for a preload job - %s", threadInfo->path);
-            UNLOCK(PreloadLock);
+    if(PreloadWorkers == NULL) {
+        return 0;
+    }
+
+    // queued jobs are dropped, running ones are waited for
+    LOCK(PreloadLock);
+    PreloadRunning = 0;
+    for(p=0;p<NUM_PRELOAD_PRIORITIES;p++) {
+        while(PreloadJobQueue[p]->head != NULL) {
+            preloadJob_t *job = (preloadJob_t *)PreloadJobQueue[p]->head->value;
+            listRemoveNoRegion(PreloadJobQueue[p], PreloadJobQueue[p]->head);
+            deleteFromHashTable(PreloadJobTable, job->path);
+            PreloadStats.dropped++;
+            _freeJob(job);
+        }
+    }
+    _notifyWorkers(1);
+    UNLOCK(PreloadLock);
+
+    for(i=0;i<PreloadNumWorkers;i++) {
+        rodsLog (LOG_DEBUG, "waitPreloadJobs: Waiting for preload worker %d", i);
 #ifdef USE_BOOST
-            threadInfo->thread->join();
+        PreloadWorkers[i].thread->join();
+        delete PreloadWorkers[i].thread;
 #else
-            pthread_join(threadInfo->thread, NULL);
+        pthread_join(PreloadWorkers[i].thread, NULL);
 #endif
-        } else {
-            UNLOCK(PreloadLock);
+        if(PreloadWorkers[i].conn != NULL) {
+            rcDisconnect(PreloadWorkers[i].conn);
+            PreloadWorkers[i].conn = NULL;
         }
     }
+    free(PreloadWorkers);
+    PreloadWorkers = NULL;
+    PreloadNumWorkers = 0;
+
+    getPreloadStats(&stats);
+    rodsLog (LOG_NOTICE, "preload: %lld completed, %lld failed, %lld dropped, %lld merged, %lld connects, %lld bytes in %.1f sec (%.1f MB/s per worker)",
+        stats.completed, stats.failed, stats.dropped, stats.merged, stats.connects, stats.downloadedBytes, stats.downloadTime,
+        stats.downloadTime > 0 ? stats.downloadedBytes / stats.downloadTime / (1024*1024) : 0.0);
+    if(PreloadConfig.classify) {
+        rodsLog (LOG_NOTICE, "preload: %lld opens streamed, %lld opens preloaded for reuse",
+            stats.streamedOpens, stats.reusedOpens);
+    }
     return 0;
 }
 
@@ -122,6 +254,12 @@ uninitPreload (preloadConfig_t *preloadConfig) {
         _removeAllIncompleteCaches();
     }
 
+    _uninitCacheIndex();
+
+#ifndef USE_BOOST
+    pthread_cond_destroy(&PreloadCond);
+#endif
+    FREE_LOCK(PreloadFileHandleLock);
     FREE_LOCK(PreloadLock);
     return (0);
 }
@@ -136,15 +274,17 @@ isPreloadEnabled() {
 }
 
 int
-preloadFile (const char *path, struct stat *stbuf) {
+preloadFile (const char *path, struct stat *stbuf, int priority) {
     int status;
-    preloadThreadInfo_t *existingThreadInfo = NULL;
-    preloadThreadInfo_t *threadInfo = NULL;
-    preloadThreadData_t *threadData = NULL;
+    preloadJob_t *existingJob = NULL;
     char iRODSPath[MAX_NAME_LEN];
     off_t cacheSize;
     off_t freeSize;
 
+    if(priority < 0 || priority >= NUM_PRELOAD_PRIORITIES) {
+        priority = PRELOAD_PRIORITY_SPECULATIVE;
+    }
+
     // convert input path to iRODSPath
     status = _getiRODSPath(path, iRODSPath);
     if(status < 0) {
@@ -154,10 +294,17 @@ preloadFile (const char *path, struct stat *stbuf) {
 
     LOCK(PreloadLock);
 
-    // check the given file is preloading
-    existingThreadInfo = (preloadThreadInfo_t *)lookupFromHashTable(PreloadThreadTable, iRODSPath);
-    if(existingThreadInfo != NULL) {
-        rodsLog (LOG_DEBUG, "preloadFile: preloading is already running - %s", iRODSPath);
+    // check the given file is queued or preloading
+    existingJob = (preloadJob_t *)lookupFromHashTable(PreloadJobTable, iRODSPath);
+    if(existingJob != NULL) {
+        rodsLog (LOG_DEBUG, "preloadFile: preloading is already queued - %s", iRODSPath);
+        PreloadStats.merged++;
+        if(!existingJob->running && priority < existingJob->priority) {
+            // someone is waiting for it now
+            listRemoveNoRegion2(PreloadJobQueue[existingJob->priority], existingJob);
+            existingJob->priority = priority;
+            listAppendNoRegion(PreloadJobQueue[priority], existingJob);
+        }
         UNLOCK(PreloadLock);
         return 0;
     }
@@ -182,7 +329,8 @@ preloadFile (const char *path, struct stat *stbuf) {
                 return (0);
             }
 
-            cacheSize = getFileSizeRecursive(PreloadConfig.cachePath);
+            // files being downloaded count as cached
+            cacheSize = PreloadCacheSize + PreloadPendingSize;
             if((cacheSize + stbuf->st_size) > (off_t)PreloadConfig.cacheMaxSize) {
                 // evict?
                 status = _evictOldCache((cacheSize + stbuf->st_size) - (off_t)PreloadConfig.cacheMaxSize);
@@ -205,32 +353,12 @@ preloadFile (const char *path, struct stat *stbuf) {
             }
         }
 
-        // does not have valid cache. now, start a new preloading
-
-        // create a new thread to preload
-        threadInfo = (preloadThreadInfo_t *)malloc(sizeof(preloadThreadInfo_t));
-        threadInfo->path = strdup(iRODSPath);
-        threadInfo->running = PRELOAD_THREAD_RUNNING;
-        INIT_STRUCT_LOCK((*threadInfo));
-
-        addToConcurrentList(PreloadThreadList, threadInfo);
-        insertIntoHashTable(PreloadThreadTable, iRODSPath, threadInfo);
-
-        // prepare thread argument
-        threadData = (preloadThreadData_t *)malloc(sizeof(preloadThreadData_t));
-        threadData->path = strdup(iRODSPath);
-        memcpy(&threadData->stbuf, stbuf, sizeof(struct stat));
-        threadData->threadInfo = threadInfo;
-
-        rodsLog (LOG_DEBUG, "preloadFile: start preloading - %s", iRODSPath);
-#ifdef USE_BOOST
-        status = threadInfo->thread = new boost::thread(_preloadThread, (void *)threadData);
-#else
-        status = pthread_create(&threadInfo->thread, NULL, _preloadThread, (void *)threadData);
-#endif
+        // does not have valid cache. now, queue a new preloading
+        rodsLog (LOG_DEBUG, "preloadFile: queue preloading - %s", iRODSPath);
+        status = _enqueueJob(iRODSPath, stbuf, priority);
     } else {
         rodsLog (LOG_DEBUG, "preloadFile: given file is already preloaded - %s", iRODSPath);
-        UNLOCK(PreloadLock);
+        _indexTouch(iRODSPath);
         status = 0;
     }
 
@@ -328,7 +456,7 @@ isPreloadedFile (const char *path) {
 int
 isFilePreloading (const char *path) {
     int status;
-    preloadThreadInfo_t *threadInfo = NULL;
+    preloadJob_t *job = NULL;
     char iRODSPath[MAX_NAME_LEN];
 
     // convert input path to iRODSPath
@@ -341,9 +469,9 @@ isFilePreloading (const char *path) {
     // check the given file is already preloaded or preloading
     LOCK(PreloadLock);
 
-    // check the given file is preloading
-    threadInfo = (preloadThreadInfo_t *)lookupFromHashTable(PreloadThreadTable, iRODSPath);
-    if(threadInfo != NULL) {
+    // queued jobs count, they would download the file later
+    job = (preloadJob_t *)lookupFromHashTable(PreloadJobTable, iRODSPath);
+    if(job != NULL) {
         UNLOCK(PreloadLock);
         return 0;
     }
@@ -352,100 +480,131 @@ isFilePreloading (const char *path) {
     return -1;
 }
 
-int
+preloadFileHandleInfo_t *
 openPreloadedFile (const char *path) {
     int status;
     char iRODSPath[MAX_NAME_LEN];
     char preloadCachePath[MAX_NAME_LEN];
     preloadFileHandleInfo_t *preloadFileHandleInfo = NULL;
+    preloadFileHandleInfo_t *existing = NULL;
+    struct stat statbuf;
     int desc;
 
     status = _getiRODSPath(path, iRODSPath);
     if(status < 0) {
         rodsLog (LOG_DEBUG, "openPreloadedFile: failed to get iRODS path - %s", path);
-        return status;
+        return NULL;
+    }
+
+    // fast path, the file is opened already
+    LOCK(PreloadFileHandleLock);
+    preloadFileHandleInfo = (preloadFileHandleInfo_t *)lookupFromHashTable(PreloadFileHandleTable, iRODSPath);
+    if(preloadFileHandleInfo != NULL) {
+        preloadFileHandleInfo->refCount++;
+        UNLOCK(PreloadFileHandleLock);
+        return preloadFileHandleInfo;
     }
+    UNLOCK(PreloadFileHandleLock);
 
     status = _getCachePath(iRODSPath, preloadCachePath);
     if(status < 0) {
         rodsLog (LOG_DEBUG, "openPreloadedFile: failed to get cache path - %s", path);
-        return status;
+        return NULL;
     }
 
     LOCK(PreloadLock);
 
-    desc = -1;
-
-    preloadFileHandleInfo = (preloadFileHandleInfo_t *)lookupFromHashTable(PreloadFileHandleTable, iRODSPath);
-    if(preloadFileHandleInfo != NULL) {
-        // has preload file handle opened
-        if(preloadFileHandleInfo->handle > 0) {
-            // reuse handle
-            desc = preloadFileHandleInfo->handle;
-            rodsLog (LOG_DEBUG, "openPreloadedFile: file is already opened - %s", iRODSPath);
-        } else {
-            // reuse handleinfo
-            if(_hasCache(iRODSPath) >= 0) {
-                desc = open (preloadCachePath, O_RDONLY);
+    if(_hasCache(iRODSPath) < 0) {
+        UNLOCK(PreloadLock);
+        return NULL;
+    }
 
-                if(desc > 0) {
-                    preloadFileHandleInfo->handle = desc;
-                    rodsLog (LOG_DEBUG, "openPreloadedFile: opens a file handle - %s", iRODSPath);
-                }
-            }
-        }
-    } else {
-        // if preloaded cache file is not opened
-        // open new
-        if(_hasCache(iRODSPath) >= 0) {
-            desc = open (preloadCachePath, O_RDONLY);
-            rodsLog (LOG_DEBUG, "openPreloadedFile: open a preloaded cache path - %s", iRODSPath);
-
-            if(desc > 0) {
-                preloadFileHandleInfo = (preloadFileHandleInfo_t *)malloc(sizeof(preloadFileHandleInfo_t));
-                preloadFileHandleInfo->path = strdup(iRODSPath);
-                preloadFileHandleInfo->handle = desc;
-                INIT_STRUCT_LOCK((*preloadFileHandleInfo));
-
-                insertIntoHashTable(PreloadFileHandleTable, iRODSPath, preloadFileHandleInfo);
-            }
+    desc = open (preloadCachePath, O_RDONLY);
+    if(desc < 0) {
+        UNLOCK(PreloadLock);
+        return NULL;
+    }
+    rodsLog (LOG_DEBUG, "openPreloadedFile: open a preloaded cache path - %s", iRODSPath);
+    _indexTouch(iRODSPath);
+
+    // map and publish the handle before _truncateCache can look for it,
+    // a truncate in between would leave the map past the end of the file
+    preloadFileHandleInfo = (preloadFileHandleInfo_t *)malloc(sizeof(preloadFileHandleInfo_t));
+    preloadFileHandleInfo->path = strdup(iRODSPath);
+    preloadFileHandleInfo->handle = desc;
+    preloadFileHandleInfo->map = NULL;
+    preloadFileHandleInfo->mapSize = 0;
+    preloadFileHandleInfo->refCount = 2;
+
+    if(PreloadConfig.mmapMaxSize > 0 && fstat(desc, &statbuf) == 0 && 
+       statbuf.st_size > 0 && statbuf.st_size <= PreloadConfig.mmapMaxSize) {
+        void *map = mmap(NULL, statbuf.st_size, PROT_READ, MAP_SHARED, desc, 0);
+        if(map != MAP_FAILED) {
+            preloadFileHandleInfo->map = (char *)map;
+            preloadFileHandleInfo->mapSize = statbuf.st_size;
         }
     }
 
+    LOCK(PreloadFileHandleLock);
+    existing = (preloadFileHandleInfo_t *)lookupFromHashTable(PreloadFileHandleTable, iRODSPath);
+    if(existing != NULL) {
+        // another reader opened it meanwhile
+        existing->refCount++;
+        UNLOCK(PreloadFileHandleLock);
+        UNLOCK(PreloadLock);
+        _freeFileHandle(preloadFileHandleInfo);
+        return existing;
+    }
+    insertIntoHashTable(PreloadFileHandleTable, iRODSPath, preloadFileHandleInfo);
+    UNLOCK(PreloadFileHandleLock);
+
     UNLOCK(PreloadLock);
 
-    return desc;
+    return preloadFileHandleInfo;
 }
 
 int
-readPreloadedFile (int fileDesc, char *buf, size_t size, off_t offset) {
-    int status;
-    off_t seek_status;
-
-    LOCK(PreloadLock);
+readPreloadedFile (preloadFileHandleInfo_t *preloadFileHandleInfo, char *buf, size_t size, off_t offset) {
+    ssize_t status;
 
-    seek_status = lseek (fileDesc, offset, SEEK_SET);
-    if (seek_status != offset) {
-        status = (int)seek_status;
-        rodsLog (LOG_DEBUG, "readPreloadedFile: failed to seek file desc - %d, %ld -> %ld", fileDesc, offset, seek_status);
+    if(preloadFileHandleInfo->map != NULL) {
+        if(offset >= preloadFileHandleInfo->mapSize) {
+            return 0;
+        }
+        if((rodsLong_t)(offset + size) > preloadFileHandleInfo->mapSize) {
+            size = preloadFileHandleInfo->mapSize - offset;
+        }
+        memcpy(buf, preloadFileHandleInfo->map + offset, size);
+        return size;
+    }
 
-        UNLOCK(PreloadLock);
-        return status;
+    status = pread (preloadFileHandleInfo->handle, buf, size, offset);
+    if(status < 0) {
+        rodsLog (LOG_DEBUG, "readPreloadedFile: failed to read - %s, errno = %d", preloadFileHandleInfo->path, errno);
+        return -errno;
     }
 
-    status = read (fileDesc, buf, size);
-    rodsLog (LOG_DEBUG, "readPreloadedFile: read from opened preloaded file - %d", fileDesc);
+    return (int)status;
+}
 
-    UNLOCK(PreloadLock);
+int
+releasePreloadedFile (preloadFileHandleInfo_t *preloadFileHandleInfo) {
+    LOCK(PreloadFileHandleLock);
+    preloadFileHandleInfo->refCount--;
+    if(preloadFileHandleInfo->refCount > 0) {
+        UNLOCK(PreloadFileHandleLock);
+        return 0;
+    }
+    UNLOCK(PreloadFileHandleLock);
 
-    return status;
+    _freeFileHandle(preloadFileHandleInfo);
+    return 0;
 }
 
 int
 closePreloadedFile (const char *path) {
     int status;
     char iRODSPath[MAX_NAME_LEN];
-    preloadFileHandleInfo_t *preloadFileHandleInfo = NULL;
 
     status = _getiRODSPath(path, iRODSPath);
     if(status < 0) {
@@ -453,29 +612,8 @@ closePreloadedFile (const char *path) {
         return status;
     }
 
-    LOCK(PreloadLock);
-
-    preloadFileHandleInfo = (preloadFileHandleInfo_t *)lookupFromHashTable(PreloadFileHandleTable, iRODSPath);
-    if(preloadFileHandleInfo != NULL) {
-        // has preload file handle opened
-        if(preloadFileHandleInfo->handle > 0) {
-            close(preloadFileHandleInfo->handle);
-            preloadFileHandleInfo->handle = -1;
-            rodsLog (LOG_DEBUG, "closePreloadedFile: close preloaded cache handle - %s", iRODSPath);
-        }
-
-        // remove from hash table
-        deleteFromHashTable(PreloadFileHandleTable, iRODSPath);
-
-        if(preloadFileHandleInfo->path != NULL) {
-            free(preloadFileHandleInfo->path);
-            preloadFileHandleInfo->path = NULL;
-        }
-    
-        free(preloadFileHandleInfo);
-    }
-    
-    UNLOCK(PreloadLock);
+    // reads in progress keep the handle until they are done
+    _closeFileHandle(iRODSPath);
 
     return status;
 }
@@ -485,6 +623,7 @@ moveToPreloadedDir (const char *path, const char *iRODSPath) {
     int status;
     char preloadCachePath[MAX_NAME_LEN];
     off_t cacheSize;
+    struct stat statbuf;
 
     if (path == NULL || iRODSPath == NULL) {
         rodsLog (LOG_DEBUG, "moveToPreloadedDir: input path or iRODSPath is NULL");
@@ -497,93 +636,371 @@ moveToPreloadedDir (const char *path, const char *iRODSPath) {
         return status;
     }
 
+    if((status = stat(path, &statbuf)) < 0) {
+        rodsLog (LOG_DEBUG, "moveToPreloadedDir: stat error : %d", status);
+        return status;
+    }
+
     // make dir
     makeParentDirs(preloadCachePath);
-    
+
+    LOCK(PreloadLock);
+
+    // index first, a crash leaves a stale entry rather than an untracked file
+    _indexAdd(iRODSPath, statbuf.st_size);
+
     // move the file
     status = rename(path, preloadCachePath);
     if(status < 0) {
         rodsLog (LOG_DEBUG, "moveToPreloadedDir: rename error : %d", status);
+        _indexRemove(iRODSPath);
+        UNLOCK(PreloadLock);
         return status;
     }
 
     // check whether preload cache exceeds limit
     if(PreloadConfig.cacheMaxSize > 0) {
-        cacheSize = getFileSizeRecursive(PreloadConfig.cachePath);
+        cacheSize = PreloadCacheSize;
         if(cacheSize > (off_t)PreloadConfig.cacheMaxSize) {
             // evict?
             status = _evictOldCache(cacheSize - (off_t)PreloadConfig.cacheMaxSize);
             if(status < 0) {
                 rodsLog (LOG_DEBUG, "moveToPreloadedDir: failed to evict old cache");
+                UNLOCK(PreloadLock);
                 return status;
             }
         }
     }
 
+    UNLOCK(PreloadLock);
+    return (0);
+}
+
+int
+getPreloadStats (preloadStats_t *stats) {
+    if(stats == NULL) {
+        return (SYS_INTERNAL_NULL_INPUT_ERR);
+    }
+
+    LOCK(PreloadLock);
+    memcpy(stats, &PreloadStats, sizeof(preloadStats_t));
+    stats->queued = _queuedJobs();
+    stats->queuedForeground = PreloadJobQueue[PRELOAD_PRIORITY_FOREGROUND]->size;
+    stats->cachedFiles = PreloadCacheHeapSize;
+    stats->cachedBytes = PreloadCacheSize;
+    UNLOCK(PreloadLock);
     return (0);
 }
 
+/*
+ * tell how path is to be read in this open, and count the open in its
+ * history. only PRELOAD_ACCESS_REREAD files are worth preloading: the
+ * preloaded, the queued and those opened again within the reuse window.
+ * others are read from the server, the pattern of their last read tells
+ * whether it was a stream.
+ */
+int
+classifyPreloadAccess (const char *path, struct stat *stbuf) {
+    int status;
+    int pattern;
+    int opens = 0;
+    char iRODSPath[MAX_NAME_LEN];
+    preloadHistoryEntry_t *entry;
+    time_t now = time(NULL);
+
+    if(PreloadConfig.classify == 0) {
+        // every open is preloaded
+        return PRELOAD_ACCESS_REREAD;
+    }
+
+    status = _getiRODSPath(path, iRODSPath);
+    if(status < 0) {
+        rodsLog (LOG_DEBUG, "classifyPreloadAccess: failed to get iRODS path - %s", path);
+        return PRELOAD_ACCESS_REREAD;
+    }
+
+    LOCK(PreloadLock);
+
+    entry = (preloadHistoryEntry_t *)lookupFromHashTable(PreloadHistoryTable, iRODSPath);
+    if(entry != NULL && (entry->size != stbuf->st_size || entry->mtime != stbuf->st_mtime)) {
+        // the history is of another version
+        _deleteHistoryEntry(entry);
+        entry = NULL;
+    }
+
+    if(lookupFromHashTable(PreloadJobTable, iRODSPath) != NULL || _hasValidCache(iRODSPath, stbuf) == 0) {
+        pattern = PRELOAD_ACCESS_REREAD;
+    } else if(entry == NULL) {
+        pattern = PRELOAD_ACCESS_UNKNOWN;
+    } else if(now - entry->lastOpen <= PreloadConfig.reuseWindow) {
+        pattern = PRELOAD_ACCESS_REREAD;
+    } else {
+        pattern = entry->pattern;
+    }
+
+    if(pattern == PRELOAD_ACCESS_REREAD) {
+        PreloadStats.reusedOpens++;
+    } else {
+        PreloadStats.streamedOpens++;
+    }
+
+    if(entry != NULL) {
+        opens = entry->opens;
+    }
+    entry = _putHistoryEntry(iRODSPath, stbuf->st_size, stbuf->st_mtime, now, opens + 1,
+        entry != NULL ? entry->pattern : PRELOAD_ACCESS_UNKNOWN);
+    if(entry != NULL) {
+        _appendHistory(entry);
+    }
+
+    UNLOCK(PreloadLock);
+    return pattern;
+}
+
+/* keep how path was read in the open that is closed now */
+int
+recordPreloadAccess (const char *path, int pattern) {
+    int status;
+    char iRODSPath[MAX_NAME_LEN];
+    preloadHistoryEntry_t *entry;
+
+    if(PreloadConfig.classify == 0) {
+        return (0);
+    }
+
+    status = _getiRODSPath(path, iRODSPath);
+    if(status < 0) {
+        rodsLog (LOG_DEBUG, "recordPreloadAccess: failed to get iRODS path - %s", path);
+        return status;
+    }
+
+    LOCK(PreloadLock);
+
+    entry = (preloadHistoryEntry_t *)lookupFromHashTable(PreloadHistoryTable, iRODSPath);
+    if(entry == NULL || entry->pattern == pattern) {
+        UNLOCK(PreloadLock);
+        return (0);
+    }
+
+    entry->pattern = pattern;
+    status = _appendHistory(entry);
+
+    UNLOCK(PreloadLock);
+    return status;
+}
+
 /**************************************************************************
  * private functions
  **************************************************************************/
-static void *_preloadThread(void *arg) {
+static void *_preloadWorker(void *arg) {
     int status;
-    preloadThreadData_t *threadData = (preloadThreadData_t *)arg;
-    preloadThreadInfo_t *threadInfo = NULL;
+    preloadWorker_t *worker = (preloadWorker_t *)arg;
+    preloadJob_t *job = NULL;
+    struct timeval startTime;
+    struct timeval endTime;
+
+    LOCK(PreloadLock);
+    while(PreloadRunning) {
+        job = _dequeueJob();
+        if(job == NULL) {
+            _waitForJob(PRELOAD_CONN_IDLE_TIMEOUT);
+
+            if(worker->conn != NULL && time(NULL) - worker->lastUsed >= PRELOAD_CONN_IDLE_TIMEOUT) {
+                // do not hold an agent on the server for nothing
+                rcComm_t *conn = worker->conn;
+                worker->conn = NULL;
+                UNLOCK(PreloadLock);
+                rodsLog (LOG_DEBUG, "_preloadWorker: closing idle connection");
+                rcDisconnect(conn);
+                LOCK(PreloadLock);
+            }
+            continue;
+        }
+
+        job->running = 1;
+        PreloadStats.running++;
+        UNLOCK(PreloadLock);
+
+        rodsLog (LOG_DEBUG, "_preloadWorker: preload - %s", job->path);
+
+        startTime = getCurrentTime();
+        status = _download(job->path, &job->stbuf, &worker->conn);
+        endTime = getCurrentTime();
+        if(status != 0) {
+            rodsLog (LOG_DEBUG, "_preloadWorker: download error - %d", status);
+        }
+
+        // downloading is done
+        LOCK(PreloadLock);
+        worker->lastUsed = time(NULL);
+        PreloadStats.running--;
+        PreloadStats.downloadTime += (endTime.tv_sec - startTime.tv_sec) + (endTime.tv_usec - startTime.tv_usec) / 1000000.0;
+        if(status == 0) {
+            PreloadStats.completed++;
+            PreloadStats.downloadedBytes += job->stbuf.st_size;
+        } else {
+            PreloadStats.failed++;
+        }
 
-    if(threadData == NULL) {
-        rodsLog (LOG_DEBUG, "_preloadThread: given thread argument is null");
-        pthread_exit(NULL);
+        rodsLog (LOG_DEBUG, "_preloadWorker: job finished - %s", job->path);
+        deleteFromHashTable(PreloadJobTable, job->path);
+        _freeJob(job);
     }
+    UNLOCK(PreloadLock);
 
-    threadInfo = threadData->threadInfo;
+    return NULL;
+}
 
-    rodsLog (LOG_DEBUG, "_preloadThread: preload - %s", threadData->path);
-    
-    status = _download(threadData->path, &threadData->stbuf);
-    if(status != 0) {
-        rodsLog (LOG_DEBUG, "_preloadThread: download error - %d", status);
+/* precond: lock PreloadLock */
+static int
+_enqueueJob(const char *path, struct stat *stbuf, int priority) {
+    preloadJob_t *job = NULL;
+    int p;
+
+    if(_queuedJobs() >= PreloadConfig.maxQueue) {
+        // make room by pushing out the newest job that is less urgent
+        for(p=NUM_PRELOAD_PRIORITIES-1;p>priority;p--) {
+            if(PreloadJobQueue[p]->tail != NULL) {
+                job = (preloadJob_t *)PreloadJobQueue[p]->tail->value;
+                break;
+            }
+        }
+
+        if(job == NULL) {
+            rodsLog (LOG_DEBUG, "_enqueueJob: preload queue is full, dropping - %s", path);
+            PreloadStats.dropped++;
+            return -EAGAIN;
+        }
+
+        rodsLog (LOG_DEBUG, "_enqueueJob: preload queue is full, dropping - %s", job->path);
+        listRemoveNoRegion2(PreloadJobQueue[job->priority], job);
+        deleteFromHashTable(PreloadJobTable, job->path);
+        PreloadStats.dropped++;
+        _freeJob(job);
     }
 
-    // downloading is done
-    LOCK(PreloadLock);
+    job = (preloadJob_t *)malloc(sizeof(preloadJob_t));
+    if(job == NULL) {
+        return (SYS_MALLOC_ERR);
+    }
+    job->path = strdup(path);
+    memcpy(&job->stbuf, stbuf, sizeof(struct stat));
+    job->priority = priority;
+    job->running = 0;
+    PreloadPendingSize += stbuf->st_size;
 
-    // change thread status
-    LOCK_STRUCT(*threadInfo);
-    threadInfo->running = PRELOAD_THREAD_IDLE;
-    UNLOCK_STRUCT(*threadInfo);
+    insertIntoHashTable(PreloadJobTable, job->path, job);
+    listAppendNoRegion(PreloadJobQueue[priority], job);
+    _notifyWorkers(0);
+    return (0);
+}
+
+/* precond: lock PreloadLock */
+static preloadJob_t *
+_dequeueJob() {
+    preloadJob_t *job;
+    int p;
+
+    for(p=0;p<NUM_PRELOAD_PRIORITIES;p++) {
+        if(PreloadJobQueue[p]->head != NULL) {
+            job = (preloadJob_t *)PreloadJobQueue[p]->head->value;
+            listRemoveNoRegion(PreloadJobQueue[p], PreloadJobQueue[p]->head);
+            return job;
+        }
+    }
+    return NULL;
+}
+
+/* precond: lock PreloadLock */
+static void
+_freeJob(preloadJob_t *job) {
+    PreloadPendingSize -= job->stbuf.st_size;
+    if(job->path != NULL) {
+        free(job->path);
+        job->path = NULL;
+    }
+    free(job);
+}
+
+/* precond: lock PreloadLock */
+static int
+_queuedJobs() {
+    int p;
+    int count = 0;
+
+    for(p=0;p<NUM_PRELOAD_PRIORITIES;p++) {
+        count += PreloadJobQueue[p]->size;
+    }
+    return count;
+}
+
+/* precond: lock PreloadLock, returns locked */
+static void
+_waitForJob(int sleepTime) {
+#ifdef USE_BOOST
+    boost::system_time const tt = boost::get_system_time() + boost::posix_time::seconds(sleepTime);
+    boost::unique_lock<boost::mutex> boost_lock(*PreloadLock, boost::adopt_lock);
+    PreloadCond.timed_wait(boost_lock, tt);
+    boost_lock.release();
+#else
+    struct timespec timeout;
+    bzero (&timeout, sizeof (timeout));
+    timeout.tv_sec = time (0) + sleepTime;
+    pthread_cond_timedwait (&PreloadCond, &PreloadLock, &timeout);
+#endif
+}
 
-    // release threadData
-    rodsLog (LOG_DEBUG, "_preloadThread: thread finished - %s", threadData->path);
-    if(threadData->path != NULL) {
-        free(threadData->path);
-        threadData->path = NULL;
+/* precond: lock PreloadLock */
+static void
+_notifyWorkers(int all) {
+#ifdef USE_BOOST
+    if(all) {
+        PreloadCond.notify_all();
+    } else {
+        PreloadCond.notify_one();
+    }
+#else
+    if(all) {
+        pthread_cond_broadcast(&PreloadCond);
+    } else {
+        pthread_cond_signal(&PreloadCond);
     }
+#endif
+}
 
-    free(threadData);
+static int
+_connect(rcComm_t **conn) {
+    int status;
+    rErrMsg_t errMsg;
 
-    // remove from hash table
-    removeFromConcurrentList2(PreloadThreadList, threadInfo);
-    deleteFromHashTable(PreloadThreadTable, threadInfo->path);
+    // Connect
+    *conn = rcConnect (PreloadRodsEnv->rodsHost, PreloadRodsEnv->rodsPort, PreloadRodsEnv->rodsUserName, PreloadRodsEnv->rodsZone, RECONN_TIMEOUT, &errMsg);
+    if (*conn == NULL) {
+        rodsLog (LOG_DEBUG, "_connect: error occurred while connecting to irods");
+        return -EPIPE;
+    }
 
-    if(threadInfo != NULL) {
-        if(threadInfo->path != NULL) {
-            free(threadInfo->path);
-            threadInfo->path = NULL;
+    // Login
+    if (strcmp (PreloadRodsEnv->rodsUserName, PUBLIC_USER_NAME) != 0) { 
+        status = clientLogin(*conn);
+        if (status != 0) {
+            rodsLog (LOG_DEBUG, "_connect: ClientLogin error : %d", status);
+            rcDisconnect(*conn);
+            *conn = NULL;
+            return status;
         }
-        free(threadInfo);
     }
 
+    LOCK(PreloadLock);
+    PreloadStats.connects++;
     UNLOCK(PreloadLock);
-    pthread_exit(NULL);
+    return (0);
 }
 
 static int
-_download(const char *path, struct stat *stbufIn) {
+_download(const char *path, struct stat *stbufIn, rcComm_t **conn) {
     int status;
-    rcComm_t *conn;
     rodsPathInp_t rodsPathInp;
-    rErrMsg_t errMsg;
     char preloadCachePath[MAX_NAME_LEN];
     char preloadCacheWorkPath[MAX_NAME_LEN];
 
@@ -621,19 +1038,10 @@ _download(const char *path, struct stat *stbufIn) {
         return status;
     }
 
-    // Connect
-    conn = rcConnect (PreloadRodsEnv->rodsHost, PreloadRodsEnv->rodsPort, PreloadRodsEnv->rodsUserName, PreloadRodsEnv->rodsZone, RECONN_TIMEOUT, &errMsg);
-    if (conn == NULL) {
-        rodsLog (LOG_DEBUG, "_download: error occurred while connecting to irods");
-        return -EPIPE;
-    }
-
-    // Login
-    if (strcmp (PreloadRodsEnv->rodsUserName, PUBLIC_USER_NAME) != 0) { 
-        status = clientLogin(conn);
-        if (status != 0) {
-            rodsLog (LOG_DEBUG, "_download: ClientLogin error : %d", status);
-            rcDisconnect(conn);
+    // reuse the worker's connection
+    if (*conn == NULL) {
+        status = _connect(conn);
+        if (status < 0) {
             return status;
         }
     }
@@ -643,22 +1051,33 @@ _download(const char *path, struct stat *stbufIn) {
 
     // Preload
     rodsLog (LOG_DEBUG, "_download: download %s", path);
-    status = getUtil (&conn, PreloadRodsEnv, PreloadRodsArgs, &rodsPathInp);
+#ifdef ENABLE_RANGE_FETCH
+    if(isRangeFetchable(stbufIn->st_size) == 0) {
+        // large objects come in parallel ranges over connections of their own
+        status = _downloadRanges(path, stbufIn, preloadCacheWorkPath);
+    } else
+#endif
+    status = getUtil (conn, PreloadRodsEnv, PreloadRodsArgs, &rodsPathInp);
     rodsLog (LOG_DEBUG, "_download: complete downloading %s", path);
 
-    // Disconnect 
-    rcDisconnect(conn);
-
     if(status < 0) {
+        // the connection may be broken, start over with the next job
         rodsLog (LOG_DEBUG, "_download: getUtil error : %d", status);
+        if (*conn != NULL) {
+            rcDisconnect(*conn);
+            *conn = NULL;
+        }
         return status;
     }
 
     // be careful when using Lock
     LOCK(PreloadLock);
+    // index first, a crash leaves a stale entry rather than an untracked file
+    _indexAdd(path, stbufIn->st_size);
     status = _completeDownload(preloadCacheWorkPath, preloadCachePath, stbufIn);
     if(status < 0) {
         rodsLog (LOG_DEBUG, "_download: _completeDownload error : %d", status);
+        _indexRemove(path);
         UNLOCK(PreloadLock);
         return status;
     }
@@ -667,21 +1086,67 @@ _download(const char *path, struct stat *stbufIn) {
     return 0;
 }
 
+#ifdef ENABLE_RANGE_FETCH
+/* fetch the object in ranges into a sparse work file, as getUtil would have */
 static int
-_completeDownload(const char *workPath, const char *cachePath, struct stat *stbuf) {
+_downloadRanges(const char *path, struct stat *stbuf, const char *workPath) {
     int status;
-    struct utimbuf amtime;
+    int fd;
+    rodsLong_t fetched;
+    char iRODSPath[MAX_NAME_LEN];
 
-    if (workPath == NULL || cachePath == NULL || stbuf == NULL) {
-        rodsLog (LOG_DEBUG, "_completeDownload: input workPath or cachePath or stbuf is NULL");
-        return (SYS_INTERNAL_NULL_INPUT_ERR);
+    status = _getiRODSPath(path, iRODSPath);
+    if(status < 0) {
+        rodsLog (LOG_DEBUG, "_downloadRanges: failed to get iRODS path - %s", path);
+        return status;
     }
 
-    //amtime.actime = stbuf->st_atime;
-    amtime.actime = convTime(getCurrentTime());
-    amtime.modtime = stbuf->st_mtime;
+    fd = open(workPath, O_WRONLY | O_CREAT | O_TRUNC, 0600);
+    if(fd < 0) {
+        status = errno ? (-1 * errno) : -1;
+        rodsLog (LOG_DEBUG, "_downloadRanges: failed to create %s, status = %d", workPath, status);
+        return status;
+    }
 
-    // set last access time and modified time the same as the original file
+    // ranges land out of order, leave the holes sparse
+    if(ftruncate(fd, stbuf->st_size) < 0) {
+        status = errno ? (-1 * errno) : -1;
+        close(fd);
+        unlink(workPath);
+        return status;
+    }
+
+    fetched = rangeFetch(iRODSPath, 0, stbuf->st_size, fd);
+    close(fd);
+
+    if(fetched < 0) {
+        unlink(workPath);
+        return (int)fetched;
+    }
+    if(fetched != stbuf->st_size) {
+        rodsLog (LOG_DEBUG, "_downloadRanges: %s ended at %lld of %lld", path, fetched, (rodsLong_t)stbuf->st_size);
+        unlink(workPath);
+        return SYS_COPY_LEN_ERR;
+    }
+    return 0;
+}
+#endif
+
+static int
+_completeDownload(const char *workPath, const char *cachePath, struct stat *stbuf) {
+    int status;
+    struct utimbuf amtime;
+
+    if (workPath == NULL || cachePath == NULL || stbuf == NULL) {
+        rodsLog (LOG_DEBUG, "_completeDownload: input workPath or cachePath or stbuf is NULL");
+        return (SYS_INTERNAL_NULL_INPUT_ERR);
+    }
+
+    //amtime.actime = stbuf->st_atime;
+    amtime.actime = convTime(getCurrentTime());
+    amtime.modtime = stbuf->st_mtime;
+
+    // set last access time and modified time the same as the original file
     status = utime(workPath, &amtime);
     if(status < 0) {
         rodsLog (LOG_DEBUG, "_completeDownload: utime error : %d", status);
@@ -774,93 +1239,23 @@ _invalidateCache(const char *path) {
     if (isDirectory(cachePath) == 0) {
         // directory
         status = removeDirRecursive(cachePath);
+        _indexRemoveDir(path);
     } else {
         // file
         // remove incomplete preload cache if exists
         unlink(cacheWorkPath);
         status = unlink(cachePath);
+        _indexRemove(path);
     }
 
     return status;
 }
 
-static int
-_findOldestCache(const char *path, char *oldCachePath, struct stat *oldStatbuf) {
-    int status;    
-    DIR *dir = NULL;
-    char filepath[MAX_NAME_LEN];
-    char tempPath[MAX_NAME_LEN];
-    struct stat tempStatBuf;
-    char oldestCachePath[MAX_NAME_LEN];
-    struct stat oldestStatBuf;
-    struct dirent *entry;
-    struct stat statbuf;
-
-    memset(oldestCachePath, 0, MAX_NAME_LEN);
-    memset(&oldestStatBuf, 0, sizeof(struct stat));
-
-    dir = opendir(path);
-    if (dir != NULL) {
-        while ((entry = readdir(dir)) != NULL) {
-            if (!strcmp(entry->d_name, ".") || !strcmp(entry->d_name, "..")) {
-                continue;
-            }
-
-            snprintf(filepath, MAX_NAME_LEN, "%s/%s", path, entry->d_name);
-            
-            if (!stat(filepath, &statbuf)) {
-                // has entry
-                if (S_ISDIR(statbuf.st_mode)) {
-                    // directory
-                    status = _findOldestCache(filepath, tempPath, &tempStatBuf);
-                    if (status == 0) {
-                        if (strlen(oldestCachePath) == 0) {
-                            // just set
-                            rstrcpy (oldestCachePath, tempPath, MAX_NAME_LEN);
-                            memcpy (&oldestStatBuf, &tempStatBuf, sizeof(struct stat));
-                        } else {
-                            // compare
-                            if(oldestStatBuf.st_atime > tempStatBuf.st_atime) {
-                                rstrcpy (oldestCachePath, tempPath, MAX_NAME_LEN);
-                                memcpy (&oldestStatBuf, &tempStatBuf, sizeof(struct stat));                                
-                            }
-                        }           
-                    }
-                } else {
-                    // file
-                    if (strlen(oldestCachePath) == 0) {
-                        // just set
-                        rstrcpy (oldestCachePath, filepath, MAX_NAME_LEN);
-                        memcpy (&oldestStatBuf, &statbuf, sizeof(struct stat));
-                    } else {
-                        // compare
-                        if(oldestStatBuf.st_atime > statbuf.st_atime) {
-                            rstrcpy (oldestCachePath, filepath, MAX_NAME_LEN);
-                            memcpy (&oldestStatBuf, &statbuf, sizeof(struct stat));                                
-                        }
-                    }
-                }
-            }
-        }
-        closedir(dir);
-    }
-
-    if (strlen(oldestCachePath) == 0) {
-        return -1;
-    }
-
-    rstrcpy (oldCachePath, oldestCachePath, MAX_NAME_LEN);
-    memcpy (oldStatbuf, &oldestStatBuf, sizeof(struct stat));
-
-    return (0);
-}
-
+/* precond: lock PreloadLock */
 static int
 _evictOldCache(off_t sizeNeeded) {
     int status;
     char oldCachePath[MAX_NAME_LEN];
-    struct stat statbuf;
-    off_t cacheSize = 0;
     off_t removedCacheSize = 0;
 
     if(sizeNeeded <= 0) {
@@ -868,26 +1263,31 @@ _evictOldCache(off_t sizeNeeded) {
     }
 
     while(sizeNeeded > removedCacheSize) {
-        status = _findOldestCache(PreloadConfig.cachePath, oldCachePath, &statbuf);
-        if(status < 0) {
-            rodsLog (LOG_DEBUG, "_evictOldCache: findOldestCache failed");
-            return status;
+        preloadCacheEntry_t *oldest;
+
+        if(PreloadCacheHeapSize == 0) {
+            rodsLog (LOG_DEBUG, "_evictOldCache: nothing left to evict");
+            return -1;
         }
 
-        if(statbuf.st_size > 0) {
-            cacheSize = statbuf.st_size;
-        } else {
-            cacheSize = 0;
+        oldest = PreloadCacheHeap[0];
+        if((status = _getCachePath(oldest->path, oldCachePath)) < 0) {
+            return status;
         }
-    
+
         // remove
         status = unlink(oldCachePath);
-        if(status < 0) {
+        if(status < 0 && errno != ENOENT) {
             rodsLog (LOG_DEBUG, "_evictOldCache: unlink failed - %s", oldCachePath);
             return status;
         }
 
-        removedCacheSize += cacheSize;
+        // a missing file was a stale entry, it frees nothing on disk
+        if(status == 0) {
+            removedCacheSize += oldest->size;
+        }
+        PreloadStats.evictions++;
+        _indexRemove(oldest->path);
     }
     
     return (0);
@@ -950,6 +1350,9 @@ _renameCache(const char *fromPath, const char *toPath) {
 
     rodsLog (LOG_DEBUG, "_renameCache (local): %s -> %s", fromCachePath, toCachePath);
     status = rename(fromCachePath, toCachePath);
+    if (status == 0) {
+        _indexRename(fromPath, toPath);
+    }
 
     return status;
 }
@@ -965,11 +1368,65 @@ _truncateCache(const char *path, off_t size) {
         return status;
     }
 
+    // readers of a mapped file would fault past the new end,
+    // drop the cache instead. the mapping keeps the old file alive
+    if (_isFileHandleMapped(path)) {
+        _closeFileHandle(path);
+        return _invalidateCache(path);
+    }
+
     status = truncate(cachePath, size);
+    if (status == 0) {
+        _indexSetSize(path, size);
+    }
 
     return status;
 }
 
+/* drops the reference of the table */
+static int
+_closeFileHandle(const char *path) {
+    preloadFileHandleInfo_t *preloadFileHandleInfo;
+
+    LOCK(PreloadFileHandleLock);
+    preloadFileHandleInfo = (preloadFileHandleInfo_t *)deleteFromHashTable(PreloadFileHandleTable, (char *)path);
+    if(preloadFileHandleInfo == NULL) {
+        UNLOCK(PreloadFileHandleLock);
+        return 0;
+    }
+    UNLOCK(PreloadFileHandleLock);
+
+    rodsLog (LOG_DEBUG, "_closeFileHandle: close preloaded cache handle - %s", path);
+    return releasePreloadedFile(preloadFileHandleInfo);
+}
+
+static int
+_isFileHandleMapped(const char *path) {
+    preloadFileHandleInfo_t *preloadFileHandleInfo;
+    int mapped = 0;
+
+    LOCK(PreloadFileHandleLock);
+    preloadFileHandleInfo = (preloadFileHandleInfo_t *)lookupFromHashTable(PreloadFileHandleTable, (char *)path);
+    if(preloadFileHandleInfo != NULL && preloadFileHandleInfo->map != NULL) {
+        mapped = 1;
+    }
+    UNLOCK(PreloadFileHandleLock);
+
+    return mapped;
+}
+
+static void
+_freeFileHandle(preloadFileHandleInfo_t *preloadFileHandleInfo) {
+    if(preloadFileHandleInfo->map != NULL) {
+        munmap(preloadFileHandleInfo->map, preloadFileHandleInfo->mapSize);
+    }
+    if(preloadFileHandleInfo->handle >= 0) {
+        close(preloadFileHandleInfo->handle);
+    }
+    free(preloadFileHandleInfo->path);
+    free(preloadFileHandleInfo);
+}
+
 static int
 _removeAllCaches() {
     int status;
@@ -978,6 +1435,9 @@ _removeAllCaches() {
         return status;
     }
 
+    // the journal went with the rest
+    _clearCacheIndex();
+
     return 0;
 }
 
@@ -1054,3 +1514,646 @@ static int
 _getiRODSPath(const char *path, char *iRODSPath) {
     return getiRODSPath(path, iRODSPath, PreloadRodsEnv->rodsHome, PreloadRodsEnv->rodsCwd);
 }
+
+/* precond: lock PreloadLock.
+ * replays the journal, or walks the cache dir once if there is none */
+static int
+_initCacheIndex() {
+    int status;
+
+    PreloadCacheTable = newHashTable(NUM_PRELOAD_CACHE_HASH_SLOT);
+    PreloadHistoryTable = newHashTable(NUM_PRELOAD_CACHE_HASH_SLOT);
+    PreloadCacheHeapSlots = 1024;
+    PreloadCacheHeap = (preloadCacheEntry_t **)malloc(sizeof(preloadCacheEntry_t *) * PreloadCacheHeapSlots);
+    PreloadCacheHeapSize = 0;
+    PreloadCacheSize = 0;
+    PreloadPendingSize = 0;
+
+    status = _loadJournal();
+    if(status < 0) {
+        rodsLog (LOG_DEBUG, "_initCacheIndex: no usable journal, scanning %s", PreloadConfig.cachePath);
+        _clearCacheIndex();
+        _clearHistory();
+        _scanCacheDir(PreloadConfig.cachePath);
+    }
+
+    rodsLog (LOG_DEBUG, "_initCacheIndex: %d files, %lld bytes, history of %d files", PreloadCacheHeapSize, PreloadCacheSize, PreloadHistoryCount);
+
+    // start with a compact journal
+    return _writeJournal();
+}
+
+static void
+_uninitCacheIndex() {
+    if(PreloadCacheTable == NULL) {
+        return;
+    }
+
+    _writeJournal();
+    if(PreloadJournalFd >= 0) {
+        close(PreloadJournalFd);
+        PreloadJournalFd = -1;
+    }
+
+    while(PreloadCacheHeapSize > 0) {
+        _deleteIndexEntry(PreloadCacheHeap[0]);
+    }
+    free(PreloadCacheHeap);
+    PreloadCacheHeap = NULL;
+    PreloadCacheHeapSlots = 0;
+    deleteHashTable(PreloadCacheTable, nop);
+    PreloadCacheTable = NULL;
+
+    _clearHistory();
+    deleteHashTable(PreloadHistoryTable, nop);
+    PreloadHistoryTable = NULL;
+}
+
+/* precond: lock PreloadLock */
+static void
+_clearCacheIndex() {
+    if(PreloadCacheTable == NULL) {
+        return;
+    }
+
+    while(PreloadCacheHeapSize > 0) {
+        _deleteIndexEntry(PreloadCacheHeap[0]);
+    }
+    PreloadCacheSize = 0;
+
+    if(PreloadJournalFd >= 0) {
+        _writeJournal();
+    }
+}
+
+/* precond: lock PreloadLock. memory only, no journal record */
+static preloadCacheEntry_t *
+_putIndexEntry(const char *path, rodsLong_t size, time_t lastAccess) {
+    preloadCacheEntry_t *entry;
+
+    entry = (preloadCacheEntry_t *)lookupFromHashTable(PreloadCacheTable, (char *)path);
+    if(entry != NULL) {
+        PreloadCacheSize += size - entry->size;
+        entry->size = size;
+        entry->lastAccess = lastAccess;
+        _heapUp(entry->heapIndex);
+        _heapDown(entry->heapIndex);
+        return entry;
+    }
+
+    if(PreloadCacheHeapSize == PreloadCacheHeapSlots) {
+        preloadCacheEntry_t **heap = (preloadCacheEntry_t **)realloc(PreloadCacheHeap, sizeof(preloadCacheEntry_t *) * PreloadCacheHeapSlots * 2);
+        if(heap == NULL) {
+            return NULL;
+        }
+        PreloadCacheHeap = heap;
+        PreloadCacheHeapSlots *= 2;
+    }
+
+    entry = (preloadCacheEntry_t *)malloc(sizeof(preloadCacheEntry_t));
+    if(entry == NULL) {
+        return NULL;
+    }
+    entry->path = strdup(path);
+    entry->size = size;
+    entry->lastAccess = lastAccess;
+    entry->heapIndex = PreloadCacheHeapSize;
+
+    insertIntoHashTable(PreloadCacheTable, entry->path, entry);
+    PreloadCacheHeap[PreloadCacheHeapSize++] = entry;
+    _heapUp(entry->heapIndex);
+    PreloadCacheSize += size;
+    return entry;
+}
+
+/* precond: lock PreloadLock. memory only, no journal record */
+static void
+_deleteIndexEntry(preloadCacheEntry_t *entry) {
+    int i = entry->heapIndex;
+
+    deleteFromHashTable(PreloadCacheTable, entry->path);
+    PreloadCacheSize -= entry->size;
+
+    PreloadCacheHeapSize--;
+    if(i != PreloadCacheHeapSize) {
+        _heapSwap(i, PreloadCacheHeapSize);
+        _heapUp(i);
+        _heapDown(i);
+    }
+
+    free(entry->path);
+    free(entry);
+}
+
+/* precond: lock PreloadLock */
+static int
+_indexAdd(const char *path, rodsLong_t size) {
+    time_t now = time(NULL);
+
+    if(PreloadCacheTable == NULL) {
+        return 0;
+    }
+
+    if(_putIndexEntry(path, size, now) == NULL) {
+        return (SYS_MALLOC_ERR);
+    }
+    return _appendJournal(PRELOAD_JOURNAL_ADD, path, size, now);
+}
+
+/* precond: lock PreloadLock */
+static int
+_indexRemove(const char *path) {
+    preloadCacheEntry_t *entry;
+
+    if(PreloadCacheTable == NULL) {
+        return 0;
+    }
+
+    entry = (preloadCacheEntry_t *)lookupFromHashTable(PreloadCacheTable, (char *)path);
+    if(entry == NULL) {
+        return 0;
+    }
+
+    _deleteIndexEntry(entry);
+    return _appendJournal(PRELOAD_JOURNAL_REMOVE, path, 0, 0);
+}
+
+/* precond: lock PreloadLock.
+ * linear in the number of entries, only used for collections */
+static int
+_indexRemoveDir(const char *dirPath) {
+    int i;
+    int dirPathLen = strlen(dirPath);
+
+    if(PreloadCacheTable == NULL) {
+        return 0;
+    }
+
+    i = 0;
+    while(i < PreloadCacheHeapSize) {
+        preloadCacheEntry_t *entry = PreloadCacheHeap[i];
+        if(strncmp(entry->path, dirPath, dirPathLen) == 0 && entry->path[dirPathLen] == '/') {
+            // the heap is reordered, look at the same slot again
+            _indexRemove(entry->path);
+            continue;
+        }
+        i++;
+    }
+    return 0;
+}
+
+/* precond: lock PreloadLock.
+ * renames the entry of a file or the entries under a collection */
+static int
+_indexRename(const char *fromPath, const char *toPath) {
+    preloadCacheEntry_t *entry;
+    List *renamed;
+    ListNode *node;
+    char newPath[MAX_NAME_LEN];
+    int fromPathLen = strlen(fromPath);
+    int i;
+
+    if(PreloadCacheTable == NULL) {
+        return 0;
+    }
+
+    entry = (preloadCacheEntry_t *)lookupFromHashTable(PreloadCacheTable, (char *)fromPath);
+    if(entry != NULL) {
+        rodsLong_t size = entry->size;
+        _indexRemove(fromPath);
+        return _indexAdd(toPath, size);
+    }
+
+    // collect first, renaming reorders the heap
+    renamed = newListNoRegion();
+    for(i=0;i<PreloadCacheHeapSize;i++) {
+        entry = PreloadCacheHeap[i];
+        if(strncmp(entry->path, fromPath, fromPathLen) == 0 && entry->path[fromPathLen] == '/') {
+            listAppendNoRegion(renamed, entry);
+        }
+    }
+
+    for(node = renamed->head; node != NULL; node = node->next) {
+        rodsLong_t size;
+        time_t lastAccess;
+
+        entry = (preloadCacheEntry_t *)node->value;
+        snprintf(newPath, MAX_NAME_LEN, "%s%s", toPath, entry->path + fromPathLen);
+        size = entry->size;
+        lastAccess = entry->lastAccess;
+        _indexRemove(entry->path);
+        _putIndexEntry(newPath, size, lastAccess);
+        _appendJournal(PRELOAD_JOURNAL_ADD, newPath, size, lastAccess);
+    }
+    deleteListNoRegion(renamed);
+    return 0;
+}
+
+/* precond: lock PreloadLock */
+static int
+_indexSetSize(const char *path, rodsLong_t size) {
+    preloadCacheEntry_t *entry;
+
+    if(PreloadCacheTable == NULL) {
+        return 0;
+    }
+
+    entry = (preloadCacheEntry_t *)lookupFromHashTable(PreloadCacheTable, (char *)path);
+    if(entry == NULL) {
+        return 0;
+    }
+
+    _putIndexEntry(path, size, entry->lastAccess);
+    return _appendJournal(PRELOAD_JOURNAL_ADD, path, size, entry->lastAccess);
+}
+
+/* precond: lock PreloadLock.
+ * picks up a cache file the index missed */
+static int
+_indexTouch(const char *path) {
+    preloadCacheEntry_t *entry;
+    char cachePath[MAX_NAME_LEN];
+    struct stat statbuf;
+    time_t now = time(NULL);
+
+    if(PreloadCacheTable == NULL) {
+        return 0;
+    }
+
+    entry = (preloadCacheEntry_t *)lookupFromHashTable(PreloadCacheTable, (char *)path);
+    if(entry == NULL) {
+        if(_getCachePath(path, cachePath) < 0 || stat(cachePath, &statbuf) < 0) {
+            return 0;
+        }
+        return _indexAdd(path, statbuf.st_size);
+    }
+
+    // one access record per second is plenty for LRU
+    if(entry->lastAccess == now) {
+        return 0;
+    }
+
+    entry->lastAccess = now;
+    _heapDown(entry->heapIndex);
+    return _appendJournal(PRELOAD_JOURNAL_ACCESS, path, 0, now);
+}
+
+static void
+_heapSwap(int i, int j) {
+    preloadCacheEntry_t *tmp = PreloadCacheHeap[i];
+    PreloadCacheHeap[i] = PreloadCacheHeap[j];
+    PreloadCacheHeap[j] = tmp;
+    PreloadCacheHeap[i]->heapIndex = i;
+    PreloadCacheHeap[j]->heapIndex = j;
+}
+
+static void
+_heapUp(int i) {
+    while(i > 0) {
+        int parent = (i - 1) / 2;
+        if(PreloadCacheHeap[parent]->lastAccess <= PreloadCacheHeap[i]->lastAccess) {
+            break;
+        }
+        _heapSwap(i, parent);
+        i = parent;
+    }
+}
+
+static void
+_heapDown(int i) {
+    while(1) {
+        int smallest = i;
+        int left = 2 * i + 1;
+        int right = 2 * i + 2;
+
+        if(left < PreloadCacheHeapSize && PreloadCacheHeap[left]->lastAccess < PreloadCacheHeap[smallest]->lastAccess) {
+            smallest = left;
+        }
+        if(right < PreloadCacheHeapSize && PreloadCacheHeap[right]->lastAccess < PreloadCacheHeap[smallest]->lastAccess) {
+            smallest = right;
+        }
+        if(smallest == i) {
+            break;
+        }
+        _heapSwap(i, smallest);
+        i = smallest;
+    }
+}
+
+/* precond: lock PreloadLock */
+static int
+_scanCacheDir(const char *dirPath) {
+    DIR *dir = opendir(dirPath);
+    char filepath[MAX_NAME_LEN];
+    struct dirent *entry;
+    struct stat statbuf;
+    int filenameLen;
+    int extLen = strlen(PRELOAD_FILES_IN_DOWNLOADING_EXT);
+    int cachePathLen = strlen(PreloadConfig.cachePath);
+
+    if (dir == NULL) {
+        return 0;
+    }
+
+    while ((entry = readdir(dir)) != NULL) {
+        if (!strcmp(entry->d_name, ".") || !strcmp(entry->d_name, "..")) {
+            continue;
+        }
+
+        snprintf(filepath, MAX_NAME_LEN, "%s/%s", dirPath, entry->d_name);
+        if (stat(filepath, &statbuf) < 0) {
+            continue;
+        }
+
+        if (S_ISDIR(statbuf.st_mode)) {
+            _scanCacheDir(filepath);
+            continue;
+        }
+
+        filenameLen = strlen(entry->d_name);
+        if (filenameLen > extLen && !strcmp(entry->d_name + filenameLen - extLen, PRELOAD_FILES_IN_DOWNLOADING_EXT)) {
+            continue;
+        }
+        if (!strcmp(dirPath, PreloadConfig.cachePath) && !strcmp(entry->d_name, PRELOAD_JOURNAL_FILE)) {
+            continue;
+        }
+
+        // <cachePath><iRODSPath>
+        _putIndexEntry(filepath + cachePathLen, statbuf.st_size, statbuf.st_atime);
+    }
+    closedir(dir);
+
+    return 0;
+}
+
+static int
+_getJournalPath(char *journalPath) {
+    snprintf(journalPath, MAX_NAME_LEN, "%s/%s", PreloadConfig.cachePath, PRELOAD_JOURNAL_FILE);
+    return 0;
+}
+
+/* precond: lock PreloadLock */
+static int
+_loadJournal() {
+    char journalPath[MAX_NAME_LEN];
+    char path[MAX_NAME_LEN];
+    preloadJournalRecord_t record;
+    unsigned int magic;
+    FILE *journal;
+    int records = 0;
+
+    _getJournalPath(journalPath);
+    journal = fopen(journalPath, "r");
+    if(journal == NULL) {
+        return -1;
+    }
+
+    if(fread(&magic, sizeof(magic), 1, journal) != 1 || magic != PRELOAD_JOURNAL_MAGIC) {
+        fclose(journal);
+        return -1;
+    }
+
+    // a torn record at the end is ignored
+    while(fread(&record, sizeof(preloadJournalRecord_t), 1, journal) == 1) {
+        if(record.pathLen <= 0 || record.pathLen >= MAX_NAME_LEN) {
+            fclose(journal);
+            return -1;
+        }
+        if(fread(path, record.pathLen, 1, journal) != 1) {
+            break;
+        }
+        path[record.pathLen] = '\0';
+
+        if(record.type == PRELOAD_JOURNAL_ADD) {
+            _putIndexEntry(path, record.size, (time_t)record.lastAccess);
+        } else if(record.type == PRELOAD_JOURNAL_HISTORY) {
+            _putHistoryEntry(path, record.size, (time_t)record.mtime, (time_t)record.lastAccess, record.opens, record.pattern);
+        } else if(record.type == PRELOAD_JOURNAL_REMOVE || record.type == PRELOAD_JOURNAL_ACCESS) {
+            preloadCacheEntry_t *entry = (preloadCacheEntry_t *)lookupFromHashTable(PreloadCacheTable, path);
+            if(entry != NULL) {
+                if(record.type == PRELOAD_JOURNAL_REMOVE) {
+                    _deleteIndexEntry(entry);
+                } else {
+                    _putIndexEntry(path, entry->size, (time_t)record.lastAccess);
+                }
+            }
+        } else {
+            fclose(journal);
+            return -1;
+        }
+        records++;
+    }
+
+    fclose(journal);
+    rodsLog (LOG_DEBUG, "_loadJournal: replayed %d records", records);
+    return 0;
+}
+
+/* precond: lock PreloadLock.
+ * replaces the journal with one ADD record per entry and one HISTORY
+ * record per history entry, least recently opened first */
+static int
+_writeJournal() {
+    char journalPath[MAX_NAME_LEN];
+    char tmpPath[MAX_NAME_LEN];
+    unsigned int magic = PRELOAD_JOURNAL_MAGIC;
+    preloadHistoryEntry_t *history;
+    FILE *journal;
+    int i;
+
+    _getJournalPath(journalPath);
+    snprintf(tmpPath, MAX_NAME_LEN, "%s%s", journalPath, PRELOAD_FILES_IN_DOWNLOADING_EXT);
+
+    journal = fopen(tmpPath, "w");
+    if(journal == NULL) {
+        rodsLog (LOG_ERROR, "_writeJournal: cannot create %s, errno = %d", tmpPath, errno);
+        return -1;
+    }
+
+    fwrite(&magic, sizeof(magic), 1, journal);
+    for(i=0;i<PreloadCacheHeapSize;i++) {
+        preloadCacheEntry_t *entry = PreloadCacheHeap[i];
+        preloadJournalRecord_t record;
+
+        memset(&record, 0, sizeof(preloadJournalRecord_t));
+        record.type = PRELOAD_JOURNAL_ADD;
+        record.pathLen = strlen(entry->path);
+        record.size = entry->size;
+        record.lastAccess = entry->lastAccess;
+        fwrite(&record, sizeof(preloadJournalRecord_t), 1, journal);
+        fwrite(entry->path, record.pathLen, 1, journal);
+    }
+    for(history = PreloadHistoryTail; history != NULL; history = history->lruPrev) {
+        preloadJournalRecord_t record;
+
+        memset(&record, 0, sizeof(preloadJournalRecord_t));
+        record.type = PRELOAD_JOURNAL_HISTORY;
+        record.pathLen = strlen(history->path);
+        record.size = history->size;
+        record.lastAccess = history->lastOpen;
+        record.mtime = history->mtime;
+        record.opens = history->opens;
+        record.pattern = history->pattern;
+        fwrite(&record, sizeof(preloadJournalRecord_t), 1, journal);
+        fwrite(history->path, record.pathLen, 1, journal);
+    }
+
+    if(fflush(journal) != 0 || fsync(fileno(journal)) < 0) {
+        rodsLog (LOG_ERROR, "_writeJournal: cannot write %s, errno = %d", tmpPath, errno);
+        fclose(journal);
+        unlink(tmpPath);
+        return -1;
+    }
+    fclose(journal);
+
+    if(rename(tmpPath, journalPath) < 0) {
+        rodsLog (LOG_ERROR, "_writeJournal: cannot rename %s, errno = %d", tmpPath, errno);
+        unlink(tmpPath);
+        return -1;
+    }
+
+    if(PreloadJournalFd >= 0) {
+        close(PreloadJournalFd);
+    }
+    PreloadJournalFd = open(journalPath, O_WRONLY | O_APPEND);
+    PreloadJournalRecords = PreloadCacheHeapSize + PreloadHistoryCount;
+    return 0;
+}
+
+/* precond: lock PreloadLock */
+static int
+_appendJournal(int type, const char *path, rodsLong_t size, time_t lastAccess) {
+    preloadJournalRecord_t record;
+
+    memset(&record, 0, sizeof(preloadJournalRecord_t));
+    record.type = type;
+    record.pathLen = strlen(path);
+    record.size = size;
+    record.lastAccess = lastAccess;
+    return _appendRecord(&record, path);
+}
+
+/* precond: lock PreloadLock */
+static int
+_appendRecord(preloadJournalRecord_t *record, const char *path) {
+    char buf[sizeof(preloadJournalRecord_t) + MAX_NAME_LEN];
+    int len;
+
+    if(PreloadJournalFd < 0) {
+        return 0;
+    }
+
+    // mostly dead records, start over
+    if(PreloadJournalRecords > PRELOAD_JOURNAL_COMPACT_MIN && PreloadJournalRecords > 2 * (PreloadCacheHeapSize + PreloadHistoryCount)) {
+        return _writeJournal();
+    }
+
+    // one write per record so a crash tears at most the last one
+    memcpy(buf, record, sizeof(preloadJournalRecord_t));
+    memcpy(buf + sizeof(preloadJournalRecord_t), path, record->pathLen);
+    len = sizeof(preloadJournalRecord_t) + record->pathLen;
+    if(write(PreloadJournalFd, buf, len) != len) {
+        rodsLog (LOG_ERROR, "_appendRecord: write error, errno = %d", errno);
+        return -1;
+    }
+
+    PreloadJournalRecords++;
+    return 0;
+}
+
+/* precond: lock PreloadLock. memory only, no journal record.
+ * the entry becomes the most recently opened */
+static preloadHistoryEntry_t *
+_putHistoryEntry(const char *path, rodsLong_t size, time_t mtime, time_t lastOpen, int opens, int pattern) {
+    preloadHistoryEntry_t *entry;
+
+    entry = (preloadHistoryEntry_t *)lookupFromHashTable(PreloadHistoryTable, (char *)path);
+    if(entry != NULL) {
+        // unlink, it goes to the head again
+        if(entry->lruPrev != NULL) {
+            entry->lruPrev->lruNext = entry->lruNext;
+        } else {
+            PreloadHistoryHead = entry->lruNext;
+        }
+        if(entry->lruNext != NULL) {
+            entry->lruNext->lruPrev = entry->lruPrev;
+        } else {
+            PreloadHistoryTail = entry->lruPrev;
+        }
+    } else {
+        if(PreloadHistoryCount >= PRELOAD_HISTORY_MAX_ENTRIES) {
+            _deleteHistoryEntry(PreloadHistoryTail);
+        }
+
+        entry = (preloadHistoryEntry_t *)calloc(1, sizeof(preloadHistoryEntry_t));
+        if(entry == NULL) {
+            return NULL;
+        }
+        entry->path = strdup(path);
+        insertIntoHashTable(PreloadHistoryTable, entry->path, entry);
+        PreloadHistoryCount++;
+    }
+
+    entry->size = size;
+    entry->mtime = mtime;
+    entry->lastOpen = lastOpen;
+    entry->opens = opens;
+    entry->pattern = pattern;
+
+    entry->lruPrev = NULL;
+    entry->lruNext = PreloadHistoryHead;
+    if(PreloadHistoryHead != NULL) {
+        PreloadHistoryHead->lruPrev = entry;
+    }
+    PreloadHistoryHead = entry;
+    if(PreloadHistoryTail == NULL) {
+        PreloadHistoryTail = entry;
+    }
+    return entry;
+}
+
+/* precond: lock PreloadLock. memory only, no journal record.
+ * a dropped history is forgotten at the next compaction */
+static void
+_deleteHistoryEntry(preloadHistoryEntry_t *entry) {
+    deleteFromHashTable(PreloadHistoryTable, entry->path);
+
+    if(entry->lruPrev != NULL) {
+        entry->lruPrev->lruNext = entry->lruNext;
+    } else {
+        PreloadHistoryHead = entry->lruNext;
+    }
+    if(entry->lruNext != NULL) {
+        entry->lruNext->lruPrev = entry->lruPrev;
+    } else {
+        PreloadHistoryTail = entry->lruPrev;
+    }
+    PreloadHistoryCount--;
+
+    free(entry->path);
+    free(entry);
+}
+
+/* precond: lock PreloadLock */
+static void
+_clearHistory() {
+    while(PreloadHistoryHead != NULL) {
+        _deleteHistoryEntry(PreloadHistoryHead);
+    }
+}
+
+/* precond: lock PreloadLock */
+static int
+_appendHistory(preloadHistoryEntry_t *entry) {
+    preloadJournalRecord_t record;
+
+    memset(&record, 0, sizeof(preloadJournalRecord_t));
+    record.type = PRELOAD_JOURNAL_HISTORY;
+    record.pathLen = strlen(entry->path);
+    record.size = entry->size;
+    record.lastAccess = entry->lastOpen;
+    record.mtime = entry->mtime;
+    record.opens = entry->opens;
+    record.pattern = entry->pattern;
+    return _appendRecord(&record, entry->path);
+}
@@ -0,0 +1,416 @@
+/*** For more information please refer to files in the COPYRIGHT directory ***/
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <errno.h>
+#include <time.h>
+#include <assert.h>
+#include <pthread.h>
+#include "irodsFs.h"
+#include "iFuseLib.h"
+#include "iFuseOper.h"
+#include "iFuseLib.RangeFetch.h"
+#include "iFuseLib.Lock.h"
+
+/**************************************************************************
+ * global variables
+ **************************************************************************/
+static rangeFetchConfig_t RangeFetchConfig;
+static rangeFetchStats_t RangeFetchStats;
+static rodsEnv *RangeFetchRodsEnv;
+
+/* protects RangeFetchIdleConns and RangeFetchStats.
+ * streams keep their own connections, apart from the ones fuse operations use */
+static pthread_mutex_t RangeFetchLock;
+static rcComm_t *RangeFetchIdleConns[RANGE_FETCH_MAX_STREAMS];
+static int RangeFetchNumIdleConns = 0;
+
+/**************************************************************************
+ * function definitions
+ **************************************************************************/
+static void *_fetchStream(void *arg);
+static rodsLong_t _fetchRange(rangeFetchJob_t *job, rcComm_t **conn, int *l1descInx, char *buf, rodsLong_t offset, rodsLong_t length);
+static int _openRange(rangeFetchJob_t *job, rcComm_t **conn, int *l1descInx, rodsLong_t offset);
+static int _getConn(rcComm_t **conn);
+static void _putConn(rcComm_t *conn);
+static void _dropConn(rcComm_t **conn, int *l1descInx);
+
+/**************************************************************************
+ * public functions
+ **************************************************************************/
+int
+initRangeFetch (rangeFetchConfig_t *rangeFetchConfig, rodsEnv *myRodsEnv) {
+    rodsLog (LOG_DEBUG, "initRangeFetch: MyRangeFetchConfig.rangeFetch = %d", rangeFetchConfig->rangeFetch);
+    rodsLog (LOG_DEBUG, "initRangeFetch: MyRangeFetchConfig.rangeSize = %lld", rangeFetchConfig->rangeSize);
+    rodsLog (LOG_DEBUG, "initRangeFetch: MyRangeFetchConfig.numStreams = %d", rangeFetchConfig->numStreams);
+    rodsLog (LOG_DEBUG, "initRangeFetch: MyRangeFetchConfig.minSize = %lld", rangeFetchConfig->minSize);
+
+    // copy given configuration
+    memcpy(&RangeFetchConfig, rangeFetchConfig, sizeof(rangeFetchConfig_t));
+    bzero(&RangeFetchStats, sizeof(rangeFetchStats_t));
+    RangeFetchRodsEnv = myRodsEnv;
+
+    if(RangeFetchConfig.rangeFetch == 0) {
+        return (0);
+    }
+
+    // init lock
+    pthread_mutex_init(&RangeFetchLock, NULL);
+    RangeFetchNumIdleConns = 0;
+    return (0);
+}
+
+int
+uninitRangeFetch (rangeFetchConfig_t *rangeFetchConfig) {
+    rangeFetchStats_t stats;
+
+    if(RangeFetchConfig.rangeFetch == 0) {
+        return (0);
+    }
+
+    // all fetches are done by now
+    pthread_mutex_lock(&RangeFetchLock);
+    while(RangeFetchNumIdleConns > 0) {
+        rcDisconnect(RangeFetchIdleConns[--RangeFetchNumIdleConns]);
+    }
+    pthread_mutex_unlock(&RangeFetchLock);
+
+    getRangeFetchStats(&stats);
+    rodsLog (LOG_NOTICE, "range fetch: %lld fetches in %lld ranges (%lld bytes), %lld ranges retried, %lld fetches failed, %lld connects",
+        stats.fetches, stats.ranges, stats.fetchedBytes, stats.retries, stats.failed, stats.connects);
+
+    pthread_mutex_destroy(&RangeFetchLock);
+    return (0);
+}
+
+int
+isRangeFetchEnabled () {
+    // check whether range fetch is enabled
+    if(RangeFetchConfig.rangeFetch == 0) {
+        return -1;
+    }
+    return 0;
+}
+
+/* whether size bytes are worth splitting over parallel streams */
+int
+isRangeFetchable (rodsLong_t size) {
+    if(RangeFetchConfig.rangeFetch == 0 || size < RangeFetchConfig.minSize) {
+        return -1;
+    }
+    return 0;
+}
+
+/*
+ * fetch length bytes of objPath from offset on into fd, at the same offsets.
+ * the length is split into ranges that several streams, each on its own
+ * connection, take in turn and write with pwrite, so fd may be a sparse
+ * file. a range failing is resumed where it stopped on a new connection,
+ * up to maxRetries times. returns bytes fetched, fewer than length if the
+ * object ends before, or an error.
+ */
+rodsLong_t
+rangeFetch (const char *objPath, rodsLong_t offset, rodsLong_t length, int fd) {
+    rangeFetchJob_t job;
+    pthread_t streams[RANGE_FETCH_MAX_STREAMS];
+    int numStreams;
+    int numStarted = 0;
+    rodsLong_t numRanges;
+    int i;
+
+    if(objPath == NULL || fd < 0 || length <= 0) {
+        return 0;
+    }
+
+    bzero(&job, sizeof(rangeFetchJob_t));
+    job.objPath = objPath;
+    job.fd = fd;
+    job.nextRange = offset;
+    job.end = offset + length;
+    job.eof = job.end;
+    pthread_mutex_init(&job.lock, NULL);
+
+    numRanges = (length + RangeFetchConfig.rangeSize - 1) / RangeFetchConfig.rangeSize;
+    numStreams = RangeFetchConfig.numStreams;
+    if(numStreams > numRanges) {
+        numStreams = numRanges;
+    }
+
+    // the calling thread is one of the streams
+    for(i = 1; i < numStreams; i++) {
+        if(pthread_create(&streams[numStarted], NULL, _fetchStream, &job) != 0) {
+            rodsLog (LOG_ERROR, "rangeFetch: pthread_create failure, fetching %s in %d streams", objPath, numStarted + 1);
+            break;
+        }
+        numStarted++;
+    }
+    _fetchStream(&job);
+    for(i = 0; i < numStarted; i++) {
+        pthread_join(streams[i], NULL);
+    }
+
+    pthread_mutex_destroy(&job.lock);
+
+    pthread_mutex_lock(&RangeFetchLock);
+    RangeFetchStats.fetches++;
+    RangeFetchStats.ranges += numRanges;
+    if(job.status < 0) {
+        RangeFetchStats.failed++;
+    }
+    pthread_mutex_unlock(&RangeFetchLock);
+
+    if(job.status < 0) {
+        rodsLogError (LOG_ERROR, job.status, "rangeFetch: fetch of %s error", objPath);
+        return job.status;
+    }
+    return job.eof - offset;
+}
+
+int
+getRangeFetchStats (rangeFetchStats_t *stats) {
+    if(stats == NULL) {
+        return SYS_INTERNAL_NULL_INPUT_ERR;
+    }
+
+    if(RangeFetchConfig.rangeFetch == 0) {
+        bzero(stats, sizeof(rangeFetchStats_t));
+        return (0);
+    }
+
+    pthread_mutex_lock(&RangeFetchLock);
+    memcpy(stats, &RangeFetchStats, sizeof(rangeFetchStats_t));
+    pthread_mutex_unlock(&RangeFetchLock);
+    return (0);
+}
+
+/**************************************************************************
+ * private functions
+ **************************************************************************/
+/* take ranges of the job until there are none left or a stream failed.
+ * the opened handle is kept for the next range of the same stream */
+static void *
+_fetchStream(void *arg) {
+    rangeFetchJob_t *job = (rangeFetchJob_t *)arg;
+    rcComm_t *conn = NULL;
+    int l1descInx = -1;
+    char *buf;
+    rodsLong_t rangeOffset;
+    rodsLong_t rangeLength;
+    rodsLong_t status;
+
+    buf = (char *)malloc(RANGE_FETCH_READ_SIZE);
+    if(buf == NULL) {
+        pthread_mutex_lock(&job->lock);
+        if(job->status == 0) {
+            job->status = SYS_MALLOC_ERR;
+        }
+        pthread_mutex_unlock(&job->lock);
+        return NULL;
+    }
+
+    while(1) {
+        pthread_mutex_lock(&job->lock);
+        if(job->status < 0 || job->nextRange >= job->eof) {
+            pthread_mutex_unlock(&job->lock);
+            break;
+        }
+        rangeOffset = job->nextRange;
+        rangeLength = RangeFetchConfig.rangeSize;
+        if(rangeOffset + rangeLength > job->end) {
+            rangeLength = job->end - rangeOffset;
+        }
+        job->nextRange += rangeLength;
+        pthread_mutex_unlock(&job->lock);
+
+        status = _fetchRange(job, &conn, &l1descInx, buf, rangeOffset, rangeLength);
+
+        pthread_mutex_lock(&job->lock);
+        if(status < 0) {
+            if(job->status == 0) {
+                job->status = (int)status;
+            }
+        } else if(status < rangeLength && rangeOffset + status < job->eof) {
+            // the object is shorter than it was when stat'ed
+            job->eof = rangeOffset + status;
+        }
+        pthread_mutex_unlock(&job->lock);
+    }
+
+    free(buf);
+    if(conn != NULL) {
+        if(l1descInx >= 0) {
+            closeIrodsFd(conn, l1descInx);
+        }
+        _putConn(conn);
+    }
+    return NULL;
+}
+
+/* returns bytes written to the job's file, fewer than length at the end of
+ * the object, or an error */
+static rodsLong_t
+_fetchRange(rangeFetchJob_t *job, rcComm_t **conn, int *l1descInx, char *buf, rodsLong_t offset, rodsLong_t length) {
+    openedDataObjInp_t dataObjReadInp;
+    bytesBuf_t dataObjReadOutBBuf;
+    rodsLong_t done = 0;
+    int retries = 0;
+    int status;
+
+    status = _openRange(job, conn, l1descInx, offset);
+    while(done < length) {
+        if(status >= 0) {
+            int len = length - done > RANGE_FETCH_READ_SIZE ? RANGE_FETCH_READ_SIZE : (int)(length - done);
+
+            bzero(&dataObjReadInp, sizeof(dataObjReadInp));
+            dataObjReadInp.l1descInx = *l1descInx;
+            dataObjReadInp.len = len;
+            dataObjReadOutBBuf.buf = buf;
+            dataObjReadOutBBuf.len = len;
+
+            status = rcDataObjRead(*conn, &dataObjReadInp, &dataObjReadOutBBuf);
+            if(status == 0) {
+                break;
+            }
+            if(status > 0) {
+                int written = 0;
+                while(written < status) {
+                    ssize_t n = pwrite(job->fd, buf + written, status - written, offset + done + written);
+                    if(n < 0) {
+                        // a local error, another connection does not help
+                        status = errno ? (-1 * errno) : -1;
+                        rodsLog (LOG_ERROR, "_fetchRange: pwrite of %s error, status = %d", job->objPath, status);
+                        return status;
+                    }
+                    written += n;
+                }
+                done += status;
+
+                pthread_mutex_lock(&RangeFetchLock);
+                RangeFetchStats.fetchedBytes += status;
+                pthread_mutex_unlock(&RangeFetchLock);
+                continue;
+            }
+        }
+
+        // the connection may be broken, resume the range on a new one
+        if(retries >= RangeFetchConfig.maxRetries) {
+            rodsLogError (LOG_ERROR, status, "_fetchRange: giving up range %lld of %s", offset, job->objPath);
+            return status;
+        }
+        retries++;
+        rodsLogError (LOG_DEBUG, status, "_fetchRange: retrying range %lld of %s from %lld", offset, job->objPath, offset + done);
+
+        pthread_mutex_lock(&RangeFetchLock);
+        RangeFetchStats.retries++;
+        pthread_mutex_unlock(&RangeFetchLock);
+
+        _dropConn(conn, l1descInx);
+        status = _openRange(job, conn, l1descInx, offset + done);
+    }
+    return done;
+}
+
+/* position the stream's handle at offset, connecting and opening as needed */
+static int
+_openRange(rangeFetchJob_t *job, rcComm_t **conn, int *l1descInx, rodsLong_t offset) {
+    dataObjInp_t dataObjInp;
+    openedDataObjInp_t dataObjLseekInp;
+    fileLseekOut_t *dataObjLseekOut = NULL;
+    int status;
+
+    if(*conn == NULL) {
+        status = _getConn(conn);
+        if(status < 0) {
+            return status;
+        }
+    }
+
+    if(*l1descInx < 0) {
+        bzero(&dataObjInp, sizeof(dataObjInp));
+        rstrcpy(dataObjInp.objPath, (char *)job->objPath, MAX_NAME_LEN);
+        dataObjInp.openFlags = O_RDONLY;
+
+        status = rcDataObjOpen(*conn, &dataObjInp);
+        if(status < 0) {
+            rodsLogError (LOG_DEBUG, status, "_openRange: rcDataObjOpen of %s error", job->objPath);
+            return status;
+        }
+        *l1descInx = status;
+    }
+
+    bzero(&dataObjLseekInp, sizeof(dataObjLseekInp));
+    dataObjLseekInp.l1descInx = *l1descInx;
+    dataObjLseekInp.offset = offset;
+    dataObjLseekInp.whence = SEEK_SET;
+
+    status = rcDataObjLseek(*conn, &dataObjLseekInp, &dataObjLseekOut);
+    if(dataObjLseekOut != NULL) {
+        free(dataObjLseekOut);
+    }
+    if(status < 0) {
+        rodsLogError (LOG_DEBUG, status, "_openRange: rcDataObjLseek of %s error", job->objPath);
+        return status;
+    }
+    return 0;
+}
+
+static int
+_getConn(rcComm_t **conn) {
+    int status;
+    rErrMsg_t errMsg;
+
+    pthread_mutex_lock(&RangeFetchLock);
+    if(RangeFetchNumIdleConns > 0) {
+        *conn = RangeFetchIdleConns[--RangeFetchNumIdleConns];
+        pthread_mutex_unlock(&RangeFetchLock);
+        return (0);
+    }
+    pthread_mutex_unlock(&RangeFetchLock);
+
+    // Connect
+    *conn = rcConnect (RangeFetchRodsEnv->rodsHost, RangeFetchRodsEnv->rodsPort, RangeFetchRodsEnv->rodsUserName, RangeFetchRodsEnv->rodsZone, RECONN_TIMEOUT, &errMsg);
+    if (*conn == NULL) {
+        rodsLog (LOG_DEBUG, "_getConn: error occurred while connecting to irods");
+        return -EPIPE;
+    }
+
+    // Login
+    if (strcmp (RangeFetchRodsEnv->rodsUserName, PUBLIC_USER_NAME) != 0) {
+        status = clientLogin(*conn);
+        if (status != 0) {
+            rodsLog (LOG_DEBUG, "_getConn: ClientLogin error : %d", status);
+            rcDisconnect(*conn);
+            *conn = NULL;
+            return status;
+        }
+    }
+
+    pthread_mutex_lock(&RangeFetchLock);
+    RangeFetchStats.connects++;
+    pthread_mutex_unlock(&RangeFetchLock);
+    return (0);
+}
+
+/* keep the connection for later fetches, up to the most streams ever needed */
+static void
+_putConn(rcComm_t *conn) {
+    pthread_mutex_lock(&RangeFetchLock);
+    if(RangeFetchNumIdleConns < RANGE_FETCH_MAX_STREAMS && RangeFetchNumIdleConns < RangeFetchConfig.numStreams) {
+        RangeFetchIdleConns[RangeFetchNumIdleConns++] = conn;
+        conn = NULL;
+    }
+    pthread_mutex_unlock(&RangeFetchLock);
+
+    if(conn != NULL) {
+        rcDisconnect(conn);
+    }
+}
+
+static void
+_dropConn(rcComm_t **conn, int *l1descInx) {
+    if(*conn != NULL) {
+        rcDisconnect(*conn);
+        *conn = NULL;
+    }
+    *l1descInx = -1;
+}
@@ -0,0 +1,693 @@
+/*** For more information please refer to files in the COPYRIGHT directory ***/
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <errno.h>
+#include <time.h>
+#include <assert.h>
+#include <pthread.h>
+#include "irodsFs.h"
+#include "iFuseLib.h"
+#include "iFuseOper.h"
+#include "list.h"
+#include "iFuseLib.Readahead.h"
+#include "iFuseLib.Lock.h"
+
+/**************************************************************************
+ * global variables
+ **************************************************************************/
+static readaheadConfig_t ReadaheadConfig;
+static readaheadStats_t ReadaheadStats;
+
+/* protects ReadaheadJobQueue, ReadaheadRunning and ReadaheadStats.
+ * lock order: readahead_t lock first, then ReadaheadLock */
+static pthread_mutex_t ReadaheadLock;
+static pthread_cond_t ReadaheadCond;
+static List *ReadaheadJobQueue;
+static int ReadaheadRunning = 0;
+static pthread_t *ReadaheadWorkers = NULL;
+static int ReadaheadNumWorkers = 0;
+
+/**************************************************************************
+ * function definitions
+ **************************************************************************/
+static void *_readaheadWorker(void *arg);
+static int _fetchBlock(const char *objPath, readaheadBlock_t *block, readaheadHandle_t **handle);
+static int _openHandle(const char *objPath, readaheadHandle_t **handle);
+static void _closeHandle(readaheadHandle_t *handle);
+static void _closeHandles(readaheadHandle_t *handles);
+static rodsLong_t _alignOffset(rodsLong_t offset);
+static readaheadBlock_t *_findBlock(readahead_t *readahead, rodsLong_t offset);
+static void _insertBlock(readahead_t *readahead, readaheadBlock_t *block);
+static void _unlinkBlock(readahead_t *readahead, readaheadBlock_t *block);
+static void _freeBlock(readaheadBlock_t *block, int used);
+static void _discardBlock(readahead_t *readahead, readaheadBlock_t *block);
+static void _discardAllBlocks(readahead_t *readahead);
+static void _releaseConsumedBlocks(readahead_t *readahead);
+static int _scheduleBlocks(readahead_t *readahead);
+static void _freeReadahead(readahead_t *readahead);
+
+/**************************************************************************
+ * public functions
+ **************************************************************************/
+int
+initReadahead (readaheadConfig_t *readaheadConfig) {
+    int i;
+    int status;
+
+    rodsLog (LOG_DEBUG, "initReadahead: MyReadaheadConfig.readahead = %d", readaheadConfig->readahead);
+    rodsLog (LOG_DEBUG, "initReadahead: MyReadaheadConfig.blockSize = %lld", readaheadConfig->blockSize);
+    rodsLog (LOG_DEBUG, "initReadahead: MyReadaheadConfig.maxWindow = %d", readaheadConfig->maxWindow);
+
+    // copy given configuration
+    memcpy(&ReadaheadConfig, readaheadConfig, sizeof(readaheadConfig_t));
+    bzero(&ReadaheadStats, sizeof(readaheadStats_t));
+
+    if(ReadaheadConfig.readahead == 0) {
+        return (0);
+    }
+
+    // init job queue
+    ReadaheadJobQueue = newListNoRegion();
+
+    // init lock
+    pthread_mutex_init(&ReadaheadLock, NULL);
+    pthread_cond_init(&ReadaheadCond, NULL);
+
+    // start workers
+    ReadaheadRunning = 1;
+    ReadaheadWorkers = (pthread_t *)malloc(sizeof(pthread_t) * ReadaheadConfig.numWorkers);
+    for(i=0;i<ReadaheadConfig.numWorkers;i++) {
+        status = pthread_create(&ReadaheadWorkers[i], NULL, _readaheadWorker, NULL);
+        if(status != 0) {
+            rodsLog (LOG_ERROR, "initReadahead: pthread_create failure, status = %d", status);
+            break;
+        }
+        ReadaheadNumWorkers++;
+    }
+
+    if(ReadaheadNumWorkers == 0) {
+        // cannot prefetch without workers
+        ReadaheadConfig.readahead = 0;
+    }
+    return (0);
+}
+
+int
+uninitReadahead (readaheadConfig_t *readaheadConfig) {
+    int i;
+    readaheadStats_t stats;
+
+    if(ReadaheadWorkers == NULL) {
+        return (0);
+    }
+
+    // workers drain the queue before they exit
+    pthread_mutex_lock(&ReadaheadLock);
+    ReadaheadRunning = 0;
+    pthread_cond_broadcast(&ReadaheadCond);
+    pthread_mutex_unlock(&ReadaheadLock);
+
+    for(i=0;i<ReadaheadNumWorkers;i++) {
+        pthread_join(ReadaheadWorkers[i], NULL);
+    }
+    free(ReadaheadWorkers);
+    ReadaheadWorkers = NULL;
+    ReadaheadNumWorkers = 0;
+
+    getReadaheadStats(&stats);
+    rodsLog (LOG_NOTICE, "readahead: %lld hits, %lld misses, %lld stalls, %lld bytes prefetched, %lld bytes wasted",
+        stats.hits, stats.misses, stats.stalls, stats.prefetchedBytes, stats.wastedBytes);
+
+    deleteListNoRegion(ReadaheadJobQueue);
+    pthread_cond_destroy(&ReadaheadCond);
+    pthread_mutex_destroy(&ReadaheadLock);
+    return (0);
+}
+
+int
+isReadaheadEnabled () {
+    // check whether readahead is enabled
+    if(ReadaheadConfig.readahead == 0) {
+        return -1;
+    }
+    return 0;
+}
+
+readahead_t *
+openReadahead (const char *objPath, rodsLong_t fileSize) {
+    readahead_t *readahead;
+
+    if(objPath == NULL || fileSize <= 0) {
+        return NULL;
+    }
+
+    readahead = (readahead_t *)malloc(sizeof(readahead_t));
+    if(readahead == NULL) {
+        return NULL;
+    }
+
+    bzero(readahead, sizeof(readahead_t));
+    readahead->objPath = strdup(objPath);
+    readahead->fileSize = fileSize;
+    readahead->window = READAHEAD_INIT_WINDOW;
+    readahead->refCount = 1;
+    pthread_mutex_init(&readahead->lock, NULL);
+    pthread_cond_init(&readahead->cond, NULL);
+    return readahead;
+}
+
+/*
+ * serve a read from prefetched blocks and schedule more blocks if the
+ * descriptor is read sequentially. returns the number of bytes copied from
+ * offset on, the caller reads the rest from the server.
+ */
+int
+readReadahead (readahead_t *readahead, char *buf, size_t size, off_t offset) {
+    rodsLong_t blockSize = ReadaheadConfig.blockSize;
+    rodsLong_t readEnd = offset + size;
+    size_t served = 0;
+    int stalled = 0;
+
+    if(readahead == NULL) {
+        return 0;
+    }
+
+    pthread_mutex_lock(&readahead->lock);
+
+    // fuse may deliver neighbouring reads slightly out of order
+    if(offset >= readahead->lastOffset - blockSize && offset <= readahead->lastOffset + blockSize) {
+        readahead->seqCount++;
+        if(readEnd > readahead->lastOffset) {
+            readahead->lastOffset = readEnd;
+        }
+    } else {
+        // random access, drop everything prefetched so far
+        rodsLog (LOG_DEBUG, "readReadahead: random access on %s at %lld", readahead->objPath, (rodsLong_t)offset);
+        _discardAllBlocks(readahead);
+        readahead->seqCount = 0;
+        readahead->window = READAHEAD_INIT_WINDOW;
+        readahead->lastOffset = readEnd;
+        readahead->nextOffset = 0;
+    }
+
+    while(served < size && offset + (rodsLong_t)served < readahead->fileSize) {
+        rodsLong_t cur = offset + served;
+        readaheadBlock_t *block = _findBlock(readahead, cur);
+        rodsLong_t len;
+
+        if(block == NULL) {
+            break;
+        }
+
+        if(block->state == READAHEAD_BLOCK_PENDING) {
+            // no worker got to it yet, reading it directly is faster than waiting
+            _discardBlock(readahead, block);
+            break;
+        }
+
+        if(block->state == READAHEAD_BLOCK_INFLIGHT) {
+            stalled = 1;
+            pthread_cond_wait(&readahead->cond, &readahead->lock);
+            continue;
+        }
+
+        if(block->state == READAHEAD_BLOCK_FAILED) {
+            _discardBlock(readahead, block);
+            break;
+        }
+
+        len = block->offset + block->len - cur;
+        if(len <= 0) {
+            // short block, the file shrank
+            break;
+        }
+        if(len > (rodsLong_t)(size - served)) {
+            len = size - served;
+        }
+        memcpy(buf + served, block->buf + (cur - block->offset), len);
+        served += len;
+    }
+
+    _releaseConsumedBlocks(readahead);
+
+    pthread_mutex_lock(&ReadaheadLock);
+    if(served > 0 && (served == size || offset + (rodsLong_t)served >= readahead->fileSize)) {
+        ReadaheadStats.hits++;
+    } else {
+        ReadaheadStats.misses++;
+    }
+    if(stalled) {
+        ReadaheadStats.stalls++;
+    }
+    pthread_mutex_unlock(&ReadaheadLock);
+
+    // the reader caught up with the workers, keep more blocks in flight
+    if(stalled && readahead->window < ReadaheadConfig.maxWindow) {
+        readahead->window *= 2;
+        if(readahead->window > ReadaheadConfig.maxWindow) {
+            readahead->window = ReadaheadConfig.maxWindow;
+        }
+    }
+
+    if(readahead->seqCount >= READAHEAD_SEQ_THRESHOLD) {
+        _scheduleBlocks(readahead);
+    }
+
+    pthread_mutex_unlock(&readahead->lock);
+    return served;
+}
+
+int
+closeReadahead (readahead_t *readahead) {
+    readaheadHandle_t *handles;
+    int refCount;
+
+    if(readahead == NULL) {
+        return 0;
+    }
+
+    pthread_mutex_lock(&readahead->lock);
+    readahead->closed = 1;
+    _discardAllBlocks(readahead);
+    handles = readahead->handles;
+    readahead->handles = NULL;
+    refCount = --readahead->refCount;
+    pthread_mutex_unlock(&readahead->lock);
+
+    // workers close the handles they still use
+    _closeHandles(handles);
+
+    // queued blocks keep it alive until workers are done with them
+    if(refCount == 0) {
+        _freeReadahead(readahead);
+    }
+    return 0;
+}
+
+int
+getReadaheadStats (readaheadStats_t *stats) {
+    if(stats == NULL) {
+        return SYS_INTERNAL_NULL_INPUT_ERR;
+    }
+
+    if(ReadaheadWorkers == NULL) {
+        memcpy(stats, &ReadaheadStats, sizeof(readaheadStats_t));
+        return 0;
+    }
+
+    pthread_mutex_lock(&ReadaheadLock);
+    memcpy(stats, &ReadaheadStats, sizeof(readaheadStats_t));
+    pthread_mutex_unlock(&ReadaheadLock);
+    return 0;
+}
+
+/**************************************************************************
+ * private functions
+ **************************************************************************/
+static void *
+_readaheadWorker(void *arg) {
+    while(1) {
+        readaheadBlock_t *block;
+        readahead_t *readahead;
+        readaheadHandle_t *handle;
+        int refCount;
+        int status;
+
+        pthread_mutex_lock(&ReadaheadLock);
+        while(ReadaheadJobQueue->head == NULL && ReadaheadRunning) {
+            pthread_cond_wait(&ReadaheadCond, &ReadaheadLock);
+        }
+        if(ReadaheadJobQueue->head == NULL) {
+            pthread_mutex_unlock(&ReadaheadLock);
+            break;
+        }
+        block = (readaheadBlock_t *)ReadaheadJobQueue->head->value;
+        listRemoveNoRegion(ReadaheadJobQueue, ReadaheadJobQueue->head);
+        pthread_mutex_unlock(&ReadaheadLock);
+
+        readahead = block->readahead;
+
+        pthread_mutex_lock(&readahead->lock);
+        if(block->discarded) {
+            // already unlinked from the readahead
+            _freeBlock(block, 0);
+        } else {
+            block->state = READAHEAD_BLOCK_INFLIGHT;
+            handle = readahead->handles;
+            if(handle != NULL) {
+                readahead->handles = handle->next;
+            }
+            pthread_mutex_unlock(&readahead->lock);
+
+            // objPath does not change while we hold a reference
+            status = _fetchBlock(readahead->objPath, block, &handle);
+
+            pthread_mutex_lock(&readahead->lock);
+            if(handle != NULL && !readahead->closed) {
+                handle->next = readahead->handles;
+                readahead->handles = handle;
+                handle = NULL;
+            }
+            pthread_mutex_lock(&ReadaheadLock);
+            ReadaheadStats.inflightBytes -= block->size;
+            if(status >= 0) {
+                ReadaheadStats.prefetchedBytes += block->len;
+            }
+            pthread_mutex_unlock(&ReadaheadLock);
+
+            block->state = status >= 0 ? READAHEAD_BLOCK_READY : READAHEAD_BLOCK_FAILED;
+            if(block->discarded) {
+                _freeBlock(block, 0);
+            }
+            pthread_cond_broadcast(&readahead->cond);
+        }
+        refCount = --readahead->refCount;
+        pthread_mutex_unlock(&readahead->lock);
+
+        if(handle != NULL) {
+            // the readahead was closed meanwhile
+            _closeHandle(handle);
+        }
+
+        if(refCount == 0) {
+            _freeReadahead(readahead);
+        }
+    }
+    return NULL;
+}
+
+/* read one block with *handle, or a handle opened on a spare pooled
+ * connection if there is none. the descriptor's l1descInx is only valid on
+ * the connection that opened it. *handle is kept open for the next block,
+ * or closed and NULL on an error */
+static int
+_fetchBlock(const char *objPath, readaheadBlock_t *block, readaheadHandle_t **handle) {
+    int status;
+    iFuseConn_t *iFuseConn;
+    openedDataObjInp_t dataObjLseekInp;
+    openedDataObjInp_t dataObjReadInp;
+    fileLseekOut_t *dataObjLseekOut = NULL;
+    bytesBuf_t dataObjReadOutBBuf;
+
+    if(*handle == NULL) {
+        status = _openHandle(objPath, handle);
+        if(status < 0) {
+            return status;
+        }
+    }
+
+    iFuseConn = (*handle)->iFuseConn;
+    status = useHeldIFuseConn(iFuseConn);
+    if(status < 0) {
+        rodsLog (LOG_DEBUG, "_fetchBlock: conn of the handle of %s is lost", objPath);
+        _closeHandle(*handle);
+        *handle = NULL;
+        return status;
+    }
+
+    bzero(&dataObjLseekInp, sizeof(dataObjLseekInp));
+    dataObjLseekInp.l1descInx = (*handle)->l1descInx;
+    dataObjLseekInp.offset = block->offset;
+    dataObjLseekInp.whence = SEEK_SET;
+
+    status = rcDataObjLseek(iFuseConn->conn, &dataObjLseekInp, &dataObjLseekOut);
+    if(dataObjLseekOut != NULL) {
+        free(dataObjLseekOut);
+    }
+    if(status < 0) {
+        rodsLogError (LOG_ERROR, status, "_fetchBlock: rcDataObjLseek of %s error", objPath);
+        unuseIFuseConn(iFuseConn);
+        _closeHandle(*handle);
+        *handle = NULL;
+        return status;
+    }
+
+    block->len = 0;
+    while(block->len < block->size) {
+        bzero(&dataObjReadInp, sizeof(dataObjReadInp));
+        dataObjReadInp.l1descInx = (*handle)->l1descInx;
+        dataObjReadInp.len = block->size - block->len;
+        dataObjReadOutBBuf.buf = block->buf + block->len;
+        dataObjReadOutBBuf.len = block->size - block->len;
+
+        status = rcDataObjRead(iFuseConn->conn, &dataObjReadInp, &dataObjReadOutBBuf);
+        if(status <= 0) {
+            break;
+        }
+        block->len += status;
+    }
+
+    unuseIFuseConn(iFuseConn);
+
+    if(status < 0) {
+        rodsLogError (LOG_ERROR, status, "_fetchBlock: rcDataObjRead of %s error", objPath);
+        _closeHandle(*handle);
+        *handle = NULL;
+        return status;
+    }
+    return 0;
+}
+
+/* open objPath on a spare pooled connection, never waits for one */
+static int
+_openHandle(const char *objPath, readaheadHandle_t **handle) {
+    int fd;
+    int status;
+    iFuseConn_t *iFuseConn = NULL;
+    dataObjInp_t dataObjInp;
+
+    *handle = (readaheadHandle_t *)malloc(sizeof(readaheadHandle_t));
+    if(*handle == NULL) {
+        return SYS_MALLOC_ERR;
+    }
+
+    status = getAndUseSpareIFuseConn(&iFuseConn);
+    if(status < 0) {
+        rodsLog (LOG_DEBUG, "_openHandle: no spare connection for %s", objPath);
+        free(*handle);
+        *handle = NULL;
+        return status;
+    }
+
+    bzero(&dataObjInp, sizeof(dataObjInp));
+    rstrcpy(dataObjInp.objPath, (char *)objPath, MAX_NAME_LEN);
+    dataObjInp.openFlags = O_RDONLY;
+
+    RECONNECT_IF_NECESSARY(fd, iFuseConn, rcDataObjOpen(iFuseConn->conn, &dataObjInp));
+    if(fd < 0) {
+        rodsLogError (LOG_ERROR, fd, "_openHandle: rcDataObjOpen of %s error", objPath);
+        unuseIFuseConn(iFuseConn);
+        free(*handle);
+        *handle = NULL;
+        return fd;
+    }
+
+    holdIFuseConn(iFuseConn);
+    unuseIFuseConn(iFuseConn);
+
+    (*handle)->iFuseConn = iFuseConn;
+    (*handle)->l1descInx = fd;
+    (*handle)->next = NULL;
+    return 0;
+}
+
+static void
+_closeHandle(readaheadHandle_t *handle) {
+    if(useHeldIFuseConn(handle->iFuseConn) >= 0) {
+        closeIrodsFd(handle->iFuseConn->conn, handle->l1descInx);
+        unuseIFuseConn(handle->iFuseConn);
+    }
+    unholdIFuseConn(handle->iFuseConn);
+    free(handle);
+}
+
+static void
+_closeHandles(readaheadHandle_t *handles) {
+    readaheadHandle_t *next;
+
+    while(handles != NULL) {
+        next = handles->next;
+        _closeHandle(handles);
+        handles = next;
+    }
+}
+
+static rodsLong_t
+_alignOffset(rodsLong_t offset) {
+    return offset - (offset % ReadaheadConfig.blockSize);
+}
+
+/* precond: lock readahead */
+static readaheadBlock_t *
+_findBlock(readahead_t *readahead, rodsLong_t offset) {
+    readaheadBlock_t *block = readahead->blocks;
+
+    while(block != NULL && block->offset <= offset) {
+        if(offset < block->offset + block->size) {
+            return block;
+        }
+        block = block->next;
+    }
+    return NULL;
+}
+
+/* precond: lock readahead */
+static void
+_insertBlock(readahead_t *readahead, readaheadBlock_t *block) {
+    readaheadBlock_t **prev = &readahead->blocks;
+
+    while(*prev != NULL && (*prev)->offset < block->offset) {
+        prev = &(*prev)->next;
+    }
+    block->next = *prev;
+    *prev = block;
+}
+
+/* precond: lock readahead */
+static void
+_unlinkBlock(readahead_t *readahead, readaheadBlock_t *block) {
+    readaheadBlock_t **prev = &readahead->blocks;
+
+    while(*prev != NULL) {
+        if(*prev == block) {
+            *prev = block->next;
+            block->next = NULL;
+            return;
+        }
+        prev = &(*prev)->next;
+    }
+}
+
+static void
+_freeBlock(readaheadBlock_t *block, int used) {
+    pthread_mutex_lock(&ReadaheadLock);
+    if(block->state == READAHEAD_BLOCK_PENDING) {
+        // never fetched
+        ReadaheadStats.inflightBytes -= block->size;
+    } else if(block->state == READAHEAD_BLOCK_READY && !used) {
+        ReadaheadStats.wastedBytes += block->len;
+    }
+    ReadaheadStats.bufferedBytes -= block->size;
+    pthread_mutex_unlock(&ReadaheadLock);
+
+    free(block->buf);
+    free(block);
+}
+
+/* precond: lock readahead.
+ * blocks a worker still refers to are only marked, the worker frees them */
+static void
+_discardBlock(readahead_t *readahead, readaheadBlock_t *block) {
+    _unlinkBlock(readahead, block);
+    if(block->state == READAHEAD_BLOCK_PENDING || block->state == READAHEAD_BLOCK_INFLIGHT) {
+        block->discarded = 1;
+    } else {
+        _freeBlock(block, 0);
+    }
+}
+
+/* precond: lock readahead */
+static void
+_discardAllBlocks(readahead_t *readahead) {
+    while(readahead->blocks != NULL) {
+        _discardBlock(readahead, readahead->blocks);
+    }
+}
+
+/* precond: lock readahead.
+ * keep one block behind the reader for reads that arrive out of order */
+static void
+_releaseConsumedBlocks(readahead_t *readahead) {
+    readaheadBlock_t *block;
+
+    while((block = readahead->blocks) != NULL) {
+        if(block->state != READAHEAD_BLOCK_READY && block->state != READAHEAD_BLOCK_FAILED) {
+            break;
+        }
+        if(block->offset + block->size > readahead->lastOffset - ReadaheadConfig.blockSize) {
+            break;
+        }
+        _unlinkBlock(readahead, block);
+        _freeBlock(block, 1);
+    }
+}
+
+/* precond: lock readahead */
+static int
+_scheduleBlocks(readahead_t *readahead) {
+    rodsLong_t blockSize = ReadaheadConfig.blockSize;
+    rodsLong_t start = _alignOffset(readahead->lastOffset);
+    rodsLong_t limit = start + readahead->window * blockSize;
+    int scheduled = 0;
+
+    if(readahead->closed) {
+        return 0;
+    }
+
+    if(limit > readahead->fileSize) {
+        limit = readahead->fileSize;
+    }
+    if(readahead->nextOffset < start) {
+        readahead->nextOffset = start;
+    }
+
+    while(readahead->nextOffset < limit) {
+        readaheadBlock_t *block;
+        rodsLong_t size = blockSize;
+
+        if(_findBlock(readahead, readahead->nextOffset) != NULL) {
+            readahead->nextOffset += blockSize;
+            continue;
+        }
+
+        if(readahead->nextOffset + size > readahead->fileSize) {
+            size = readahead->fileSize - readahead->nextOffset;
+        }
+
+        pthread_mutex_lock(&ReadaheadLock);
+        if(ReadaheadStats.bufferedBytes + size > ReadaheadConfig.maxMemory) {
+            pthread_mutex_unlock(&ReadaheadLock);
+            break;
+        }
+        ReadaheadStats.bufferedBytes += size;
+        ReadaheadStats.inflightBytes += size;
+        pthread_mutex_unlock(&ReadaheadLock);
+
+        block = (readaheadBlock_t *)malloc(sizeof(readaheadBlock_t));
+        bzero(block, sizeof(readaheadBlock_t));
+        block->offset = readahead->nextOffset;
+        block->size = size;
+        block->state = READAHEAD_BLOCK_PENDING;
+        block->buf = (char *)malloc(size);
+        block->readahead = readahead;
+        if(block->buf == NULL) {
+            free(block);
+            pthread_mutex_lock(&ReadaheadLock);
+            ReadaheadStats.bufferedBytes -= size;
+            ReadaheadStats.inflightBytes -= size;
+            pthread_mutex_unlock(&ReadaheadLock);
+            break;
+        }
+
+        _insertBlock(readahead, block);
+        readahead->refCount++;
+
+        pthread_mutex_lock(&ReadaheadLock);
+        listAppendNoRegion(ReadaheadJobQueue, block);
+        pthread_cond_signal(&ReadaheadCond);
+        pthread_mutex_unlock(&ReadaheadLock);
+
+        readahead->nextOffset += blockSize;
+        scheduled++;
+    }
+    return scheduled;
+}
+
+static void
+_freeReadahead(readahead_t *readahead) {
+    pthread_cond_destroy(&readahead->cond);
+    pthread_mutex_destroy(&readahead->lock);
+    free(readahead->objPath);
+    free(readahead);
+}
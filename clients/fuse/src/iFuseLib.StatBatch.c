@@ -0,0 +1,481 @@
+/*** For more information please refer to files in the COPYRIGHT directory ***/
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <errno.h>
+#include <time.h>
+#include <sys/time.h>
+#include <assert.h>
+#include <pthread.h>
+#include "irodsFs.h"
+#include "iFuseLib.h"
+#include "iFuseOper.h"
+#include "hashtable.h"
+#include "iFuseLib.StatBatch.h"
+#include "iFuseLib.Lock.h"
+
+/**************************************************************************
+ * global variables
+ **************************************************************************/
+static statBatchConfig_t StatBatchConfig;
+static statBatchStats_t StatBatchStats;
+static rodsEnv *StatBatchRodsEnv;
+
+/* protects StatBatchTable, the batches and StatBatchStats */
+static pthread_mutex_t StatBatchLock;
+static Hashtable *StatBatchTable;       /* batches taking misses, by collection */
+
+/**************************************************************************
+ * function definitions
+ **************************************************************************/
+static void _closeBatch(statBatch_t *batch);
+static void _releaseBatch(statBatch_t *batch);
+static void _resolveBatch(statBatch_t *batch);
+static int _queryDataObjs(iFuseConn_t *iFuseConn, statBatch_t *batch, char *irodsCollPath);
+static int _queryColls(iFuseConn_t *iFuseConn, statBatch_t *batch, char *irodsCollPath, int *isNormalColl);
+static int _setResult(statBatch_t *batch, const char *name, struct stat *stbuf);
+static void _getChildPath(statBatch_t *batch, const char *name, char *childPath);
+
+/**************************************************************************
+ * public functions
+ **************************************************************************/
+int
+initStatBatch (statBatchConfig_t *statBatchConfig, rodsEnv *myRodsEnv) {
+    rodsLog (LOG_DEBUG, "initStatBatch: MyStatBatchConfig.statBatch = %d", statBatchConfig->statBatch);
+    rodsLog (LOG_DEBUG, "initStatBatch: MyStatBatchConfig.window = %d", statBatchConfig->window);
+
+    // copy given configuration
+    memcpy(&StatBatchConfig, statBatchConfig, sizeof(statBatchConfig_t));
+    bzero(&StatBatchStats, sizeof(statBatchStats_t));
+    StatBatchRodsEnv = myRodsEnv;
+
+    if(StatBatchConfig.statBatch == 0) {
+        return (0);
+    }
+
+    // init lock
+    pthread_mutex_init(&StatBatchLock, NULL);
+    StatBatchTable = newHashTable(NUM_STAT_BATCH_HASH_SLOT);
+    return (0);
+}
+
+int
+uninitStatBatch (statBatchConfig_t *statBatchConfig) {
+    statBatchStats_t stats;
+
+    if(StatBatchConfig.statBatch == 0) {
+        return (0);
+    }
+
+    getStatBatchStats(&stats);
+    rodsLog (LOG_NOTICE, "stat batch: %lld paths in %lld batches, %lld queries, %lld paths stat'ed one by one",
+        stats.batchedPaths, stats.batches, stats.queries, stats.fallbacks);
+
+    // no getattr is running any more, the table is empty
+    pthread_mutex_lock(&StatBatchLock);
+    deleteHashTable(StatBatchTable, nop);
+    StatBatchTable = NULL;
+    pthread_mutex_unlock(&StatBatchLock);
+
+    pthread_mutex_destroy(&StatBatchLock);
+    return (0);
+}
+
+int
+isStatBatchEnabled () {
+    // check whether stat batching is enabled
+    if(StatBatchConfig.statBatch == 0) {
+        return -1;
+    }
+    return 0;
+}
+
+/*
+ * stat path together with the other misses in its collection that come
+ * within the window. the first miss of a collection waits the window out,
+ * or until the batch is full, and resolves the batch with one query for
+ * data objects and one for collections while the others wait.
+ * returns as _irodsGetattr, or STAT_BATCH_NOT_BATCHED for paths the caller
+ * has to stat itself.
+ */
+int
+statInBatch (const char *path, struct stat *stbuf) {
+    char collPath[MAX_NAME_LEN];
+    const char *name;
+    statBatch_t *batch;
+    statBatchWaiter_t *waiter;
+    int nameLen;
+    int leader = 0;
+    int status;
+
+    name = strrchr(path, '/');
+    if(name == NULL || name[1] == '\0') {
+        // the root
+        return STAT_BATCH_NOT_BATCHED;
+    }
+    name++;
+    nameLen = strlen(name);
+
+    // a quote would end the name in the in clause
+    if(strchr(name, '\'') != NULL || nameLen + 4 > STAT_BATCH_MAX_COND_LEN / 2) {
+        return STAT_BATCH_NOT_BATCHED;
+    }
+
+    if(name - 1 == path) {
+        strcpy(collPath, "/");
+    } else {
+        rstrcpy(collPath, (char *) path, name - path);
+    }
+
+    waiter = (statBatchWaiter_t *)calloc(1, sizeof(statBatchWaiter_t));
+    if(waiter == NULL) {
+        return STAT_BATCH_NOT_BATCHED;
+    }
+    waiter->name = strdup(name);
+    waiter->status = -ENOENT;
+
+    pthread_mutex_lock(&StatBatchLock);
+
+    batch = (statBatch_t *)lookupFromHashTable(StatBatchTable, collPath);
+    if(batch == NULL) {
+        batch = (statBatch_t *)calloc(1, sizeof(statBatch_t));
+        if(batch == NULL) {
+            pthread_mutex_unlock(&StatBatchLock);
+            free(waiter->name);
+            free(waiter);
+            return STAT_BATCH_NOT_BATCHED;
+        }
+        batch->collPath = strdup(collPath);
+        pthread_cond_init(&batch->cond, NULL);
+        insertIntoHashTable(StatBatchTable, collPath, batch);
+        leader = 1;
+    }
+
+    waiter->next = batch->waiters;
+    batch->waiters = waiter;
+    batch->numWaiters++;
+    batch->refCount++;
+    batch->condLen += nameLen + 4;  /* 'name', */
+
+    if(batch->numWaiters >= STAT_BATCH_MAX_NAMES || batch->condLen >= STAT_BATCH_MAX_COND_LEN) {
+        // full, the leader need not wait any longer
+        _closeBatch(batch);
+        pthread_cond_broadcast(&batch->cond);
+    }
+
+    if(leader) {
+        struct timeval now;
+        struct timespec deadline;
+
+        gettimeofday(&now, NULL);
+        deadline.tv_sec = now.tv_sec + (now.tv_usec + StatBatchConfig.window) / 1000000;
+        deadline.tv_nsec = ((now.tv_usec + StatBatchConfig.window) % 1000000) * 1000;
+
+        while(!batch->closed) {
+            if(pthread_cond_timedwait(&batch->cond, &StatBatchLock, &deadline) == ETIMEDOUT) {
+                break;
+            }
+        }
+        _closeBatch(batch);
+        pthread_mutex_unlock(&StatBatchLock);
+
+        _resolveBatch(batch);
+
+        pthread_mutex_lock(&StatBatchLock);
+        batch->done = 1;
+        pthread_cond_broadcast(&batch->cond);
+    } else {
+        while(!batch->done) {
+            pthread_cond_wait(&batch->cond, &StatBatchLock);
+        }
+    }
+
+    *stbuf = waiter->stbuf;
+    status = waiter->status;
+    _releaseBatch(batch);
+    pthread_mutex_unlock(&StatBatchLock);
+    return status;
+}
+
+int
+getStatBatchStats (statBatchStats_t *stats) {
+    if(stats == NULL) {
+        return SYS_INTERNAL_NULL_INPUT_ERR;
+    }
+
+    if(StatBatchConfig.statBatch == 0) {
+        bzero(stats, sizeof(statBatchStats_t));
+        return (0);
+    }
+
+    pthread_mutex_lock(&StatBatchLock);
+    memcpy(stats, &StatBatchStats, sizeof(statBatchStats_t));
+    pthread_mutex_unlock(&StatBatchLock);
+    return (0);
+}
+
+/**************************************************************************
+ * private functions
+ **************************************************************************/
+/* precond: lock StatBatchLock.
+ * later misses of the collection start another batch */
+static void
+_closeBatch(statBatch_t *batch) {
+    if(!batch->closed) {
+        deleteFromHashTable(StatBatchTable, batch->collPath);
+        batch->closed = 1;
+    }
+}
+
+/* precond: lock StatBatchLock.
+ * the last waiter to take its result frees the batch */
+static void
+_releaseBatch(statBatch_t *batch) {
+    statBatchWaiter_t *waiter;
+
+    batch->refCount--;
+    if(batch->refCount > 0) {
+        return;
+    }
+
+    while(batch->waiters != NULL) {
+        waiter = batch->waiters;
+        batch->waiters = waiter->next;
+        free(waiter->name);
+        free(waiter);
+    }
+    pthread_cond_destroy(&batch->cond);
+    free(batch->collPath);
+    free(batch);
+}
+
+/* fill in the results of the waiters, the batch is closed so they are not
+ * touched by anyone else */
+static void
+_resolveBatch(statBatch_t *batch) {
+    iFuseConn_t *iFuseConn;
+    statBatchWaiter_t *waiter;
+    char irodsCollPath[MAX_NAME_LEN];
+    char childPath[MAX_NAME_LEN];
+    int isNormalColl = 0;
+    int queries = 0;
+    int fallbacks = 0;
+    int status;
+
+    // not through the path cache, which would be left a placeholder of
+    // the collection without its stat
+    status = getAndUseIFuseConn(&iFuseConn);
+    if(status < 0) {
+        rodsLogError (LOG_ERROR, status, "_resolveBatch: cannot get connection for %s", batch->collPath);
+        for(waiter = batch->waiters; waiter != NULL; waiter = waiter->next) {
+            /* use ENOTDIR for this type of error */
+            waiter->status = -ENOTDIR;
+        }
+        return;
+    }
+
+    if(batch->numWaiters > 1) {
+        status = parseRodsPathStr(batch->collPath + 1, StatBatchRodsEnv, irodsCollPath);
+        if(status >= 0) {
+            // found waiters get status 0, the others keep -ENOENT
+            status = _queryDataObjs(iFuseConn, batch, irodsCollPath);
+            queries++;
+        }
+        if(status >= 0) {
+            status = _queryColls(iFuseConn, batch, irodsCollPath, &isNormalColl);
+            queries++;
+        }
+        if(status < 0) {
+            rodsLogError (LOG_DEBUG, status, "_resolveBatch: query of %s error", irodsCollPath);
+            isNormalColl = 0;
+        }
+    }
+
+    // everything in a registered collection is in the catalog. entries of
+    // special collections, and all if a query failed, are stat'ed one by one
+    for(waiter = batch->waiters; waiter != NULL; waiter = waiter->next) {
+        if(waiter->status == 0 || (isNormalColl && status >= 0)) {
+            continue;
+        }
+        _getChildPath(batch, waiter->name, childPath);
+        waiter->status = _irodsGetattr(iFuseConn, childPath, &waiter->stbuf);
+        fallbacks++;
+    }
+
+    unuseIFuseConn(iFuseConn);
+
+    pthread_mutex_lock(&StatBatchLock);
+    if(batch->numWaiters > 1) {
+        StatBatchStats.batches++;
+        StatBatchStats.batchedPaths += batch->numWaiters;
+        StatBatchStats.fallbacks += fallbacks;
+    }
+    StatBatchStats.queries += queries;
+    pthread_mutex_unlock(&StatBatchLock);
+}
+
+/* names in the batch that are data objects of irodsCollPath */
+static int
+_queryDataObjs(iFuseConn_t *iFuseConn, statBatch_t *batch, char *irodsCollPath) {
+    genQueryInp_t genQueryInp;
+    genQueryOut_t *genQueryOut = NULL;
+    statBatchWaiter_t *waiter;
+    char condStr[MAX_NAME_LEN];
+    char *inStr;
+    int inLen = 0;
+    int status;
+    int i;
+
+    inStr = (char *)malloc(batch->condLen + 8);
+    if(inStr == NULL) {
+        return SYS_MALLOC_ERR;
+    }
+    inLen += sprintf(inStr, "in (");
+    for(waiter = batch->waiters; waiter != NULL; waiter = waiter->next) {
+        inLen += sprintf(inStr + inLen, "%s'%s'", waiter == batch->waiters ? "" : ",", waiter->name);
+    }
+    sprintf(inStr + inLen, ")");
+
+    memset(&genQueryInp, 0, sizeof(genQueryInp));
+    addInxIval(&genQueryInp.selectInp, COL_DATA_NAME, 1);
+    addInxIval(&genQueryInp.selectInp, COL_DATA_SIZE, 1);
+    addInxIval(&genQueryInp.selectInp, COL_DATA_MODE, 1);
+    addInxIval(&genQueryInp.selectInp, COL_D_CREATE_TIME, 1);
+    addInxIval(&genQueryInp.selectInp, COL_D_MODIFY_TIME, 1);
+    snprintf(condStr, MAX_NAME_LEN, "='%s'", irodsCollPath);
+    addInxVal(&genQueryInp.sqlCondInp, COL_COLL_NAME, condStr);
+    addInxVal(&genQueryInp.sqlCondInp, COL_DATA_NAME, inStr);
+    genQueryInp.maxRows = MAX_SQL_ROWS;
+    free(inStr);
+
+    RECONNECT_IF_NECESSARY(status, iFuseConn, rcGenQuery(iFuseConn->conn, &genQueryInp, &genQueryOut));
+    while(status >= 0 && genQueryOut != NULL) {
+        for(i = 0; i < genQueryOut->rowCnt; i++) {
+            struct stat stbuf;
+            char *name = genQueryOut->sqlResult[0].value + i * genQueryOut->sqlResult[0].len;
+            char *size = genQueryOut->sqlResult[1].value + i * genQueryOut->sqlResult[1].len;
+            char *mode = genQueryOut->sqlResult[2].value + i * genQueryOut->sqlResult[2].len;
+            char *createTime = genQueryOut->sqlResult[3].value + i * genQueryOut->sqlResult[3].len;
+            char *modifyTime = genQueryOut->sqlResult[4].value + i * genQueryOut->sqlResult[4].len;
+
+            // one row per replica, the latest modified one is what rcObjStat tells
+            memset(&stbuf, 0, sizeof(struct stat));
+            fillFileStat(&stbuf, atoi(mode), strtoll(size, 0, 0), atoi(createTime), atoi(modifyTime), atoi(modifyTime));
+            _setResult(batch, name, &stbuf);
+        }
+
+        if(genQueryOut->continueInx <= 0) {
+            break;
+        }
+        genQueryInp.continueInx = genQueryOut->continueInx;
+        freeGenQueryOut(&genQueryOut);
+        status = rcGenQuery(iFuseConn->conn, &genQueryInp, &genQueryOut);
+    }
+
+    freeGenQueryOut(&genQueryOut);
+    clearGenQueryInp(&genQueryInp);
+
+    if(status == CAT_NO_ROWS_FOUND) {
+        return 0;
+    }
+    return status;
+}
+
+/* names in the batch that are sub-collections of irodsCollPath, and whether
+ * irodsCollPath itself is a registered, not special, collection */
+static int
+_queryColls(iFuseConn_t *iFuseConn, statBatch_t *batch, char *irodsCollPath, int *isNormalColl) {
+    genQueryInp_t genQueryInp;
+    genQueryOut_t *genQueryOut = NULL;
+    statBatchWaiter_t *waiter;
+    char *inStr;
+    int collPathLen = strlen(irodsCollPath);
+    int inLen = 0;
+    int status;
+    int i;
+
+    *isNormalColl = 0;
+
+    // the full path of each name, and the collection itself
+    inStr = (char *)malloc(batch->condLen + (batch->numWaiters + 1) * (collPathLen + 2) + 8);
+    if(inStr == NULL) {
+        return SYS_MALLOC_ERR;
+    }
+    inLen += sprintf(inStr, "in ('%s'", irodsCollPath);
+    for(waiter = batch->waiters; waiter != NULL; waiter = waiter->next) {
+        inLen += sprintf(inStr + inLen, ",'%s%s%s'", irodsCollPath, collPathLen > 1 ? "/" : "", waiter->name);
+    }
+    sprintf(inStr + inLen, ")");
+
+    memset(&genQueryInp, 0, sizeof(genQueryInp));
+    addInxIval(&genQueryInp.selectInp, COL_COLL_NAME, 1);
+    addInxIval(&genQueryInp.selectInp, COL_COLL_CREATE_TIME, 1);
+    addInxIval(&genQueryInp.selectInp, COL_COLL_MODIFY_TIME, 1);
+    addInxIval(&genQueryInp.selectInp, COL_COLL_TYPE, 1);
+    addInxVal(&genQueryInp.sqlCondInp, COL_COLL_NAME, inStr);
+    genQueryInp.maxRows = MAX_SQL_ROWS;
+    free(inStr);
+
+    RECONNECT_IF_NECESSARY(status, iFuseConn, rcGenQuery(iFuseConn->conn, &genQueryInp, &genQueryOut));
+    while(status >= 0 && genQueryOut != NULL) {
+        for(i = 0; i < genQueryOut->rowCnt; i++) {
+            struct stat stbuf;
+            char *collName = genQueryOut->sqlResult[0].value + i * genQueryOut->sqlResult[0].len;
+            char *createTime = genQueryOut->sqlResult[1].value + i * genQueryOut->sqlResult[1].len;
+            char *modifyTime = genQueryOut->sqlResult[2].value + i * genQueryOut->sqlResult[2].len;
+            char *collType = genQueryOut->sqlResult[3].value + i * genQueryOut->sqlResult[3].len;
+
+            if(strcmp(collName, irodsCollPath) == 0) {
+                *isNormalColl = collType[0] == '\0';
+                continue;
+            }
+
+            memset(&stbuf, 0, sizeof(struct stat));
+            fillDirStat(&stbuf, atoi(createTime), atoi(modifyTime), atoi(modifyTime));
+            _setResult(batch, collName + collPathLen + (collPathLen > 1 ? 1 : 0), &stbuf);
+        }
+
+        if(genQueryOut->continueInx <= 0) {
+            break;
+        }
+        genQueryInp.continueInx = genQueryOut->continueInx;
+        freeGenQueryOut(&genQueryOut);
+        status = rcGenQuery(iFuseConn->conn, &genQueryInp, &genQueryOut);
+    }
+
+    freeGenQueryOut(&genQueryOut);
+    clearGenQueryInp(&genQueryInp);
+
+    if(status == CAT_NO_ROWS_FOUND) {
+        return 0;
+    }
+    return status;
+}
+
+/* give stbuf to the waiters of name. of several replicas the latest wins */
+static int
+_setResult(statBatch_t *batch, const char *name, struct stat *stbuf) {
+    statBatchWaiter_t *waiter;
+    int found = 0;
+
+    for(waiter = batch->waiters; waiter != NULL; waiter = waiter->next) {
+        if(strcmp(waiter->name, name) != 0) {
+            continue;
+        }
+        if(waiter->status != 0 || stbuf->st_mtime > waiter->stbuf.st_mtime) {
+            waiter->stbuf = *stbuf;
+            waiter->status = 0;
+        }
+        found++;
+    }
+    return found;
+}
+
+static void
+_getChildPath(statBatch_t *batch, const char *name, char *childPath) {
+    if(strcmp(batch->collPath, "/") == 0) {
+        snprintf(childPath, MAX_NAME_LEN, "/%s", name);
+    } else {
+        snprintf(childPath, MAX_NAME_LEN, "%s/%s", batch->collPath, name);
+    }
+}
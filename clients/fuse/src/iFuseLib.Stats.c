@@ -0,0 +1,1003 @@
+/*** For more information please refer to files in the COPYRIGHT directory ***/
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <errno.h>
+#include <time.h>
+#include <assert.h>
+#include <pthread.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <stdint.h>
+#include <sys/time.h>
+#include "irodsFs.h"
+#include "iFuseLib.h"
+#include "rcGlobalExtern.h"
+#include "iFuseLib.Stats.h"
+
+/**************************************************************************
+ * global variables
+ **************************************************************************/
+typedef struct StatsName {
+    int number;
+    const char *name;
+} statsName_t;
+
+/* the snapshot of an open stats file, kept in fi->fh */
+typedef struct StatsSnapshot {
+    char *buf;
+    size_t len;
+} statsSnapshot_t;
+
+static const char *StatsOpNames[NUM_STATS_OPS] = {
+    "getattr", "readlink", "readdir", "mknod", "mkdir", "symlink", "unlink",
+    "rmdir", "rename", "link", "chmod", "chown", "truncate", "utimens",
+    "open", "read", "write", "statfs", "release", "fsync", "flush"
+};
+
+static statsName_t StatsApiNames[] = {
+    {DATA_OBJ_CREATE_AN, "DATA_OBJ_CREATE_AN"},
+    {DATA_OBJ_OPEN_AN, "DATA_OBJ_OPEN_AN"},
+    {DATA_OBJ_READ_AN, "DATA_OBJ_READ_AN"},
+    {DATA_OBJ_WRITE_AN, "DATA_OBJ_WRITE_AN"},
+    {DATA_OBJ_CLOSE_AN, "DATA_OBJ_CLOSE_AN"},
+    {DATA_OBJ_LSEEK_AN, "DATA_OBJ_LSEEK_AN"},
+    {DATA_OBJ_PUT_AN, "DATA_OBJ_PUT_AN"},
+    {DATA_OBJ_GET_AN, "DATA_OBJ_GET_AN"},
+    {DATA_OBJ_UNLINK_AN, "DATA_OBJ_UNLINK_AN"},
+    {DATA_OBJ_RENAME_AN, "DATA_OBJ_RENAME_AN"},
+    {DATA_OBJ_TRUNCATE_AN, "DATA_OBJ_TRUNCATE_AN"},
+    {OBJ_STAT_AN, "OBJ_STAT_AN"},
+    {GEN_QUERY_AN, "GEN_QUERY_AN"},
+    {COLL_CREATE_AN, "COLL_CREATE_AN"},
+    {RM_COLL_AN, "RM_COLL_AN"},
+    {OPEN_COLLECTION_AN, "OPEN_COLLECTION_AN"},
+    {READ_COLLECTION_AN, "READ_COLLECTION_AN"},
+    {CLOSE_COLLECTION_AN, "CLOSE_COLLECTION_AN"},
+    {QUERY_SPEC_COLL_AN, "QUERY_SPEC_COLL_AN"},
+    {MOD_DATA_OBJ_META_AN, "MOD_DATA_OBJ_META_AN"},
+    {GET_HOST_FOR_GET_AN, "GET_HOST_FOR_GET_AN"},
+    {GET_HOST_FOR_PUT_AN, "GET_HOST_FOR_PUT_AN"},
+    {GET_MISC_SVR_INFO_AN, "GET_MISC_SVR_INFO_AN"},
+    {AUTH_REQUEST_AN, "AUTH_REQUEST_AN"},
+    {AUTH_RESPONSE_AN, "AUTH_RESPONSE_AN"},
+    {0, NULL}
+};
+
+static statsConfig_t StatsConfig;
+static int StatsRunning = 0;
+static struct timespec StatsStartTime;
+
+static struct fuse_operations StatsNextOper;
+
+/* api number of every slot, filled in order. slots are only added under
+ * StatsLock and NumStatsApis is raised after the slot is written, so
+ * writers look up slots without locking */
+static int StatsApis[MAX_STATS_APIS];
+static volatile int NumStatsApis = 0;
+
+/* protects the thread list, the retired counters and the api slots */
+static pthread_mutex_t StatsLock;
+static pthread_key_t StatsKey;
+static threadStats_t *StatsThreads = NULL;
+static threadStats_t StatsRetired;     /* counters of exited threads */
+
+/* periodic dump */
+static pthread_t StatsDumpThread;
+static pthread_mutex_t StatsDumpLock;
+static pthread_cond_t StatsDumpCond;
+static int StatsDumpRunning = 0;
+
+/**************************************************************************
+ * function definitions
+ **************************************************************************/
+static threadStats_t *_getThreadStats();
+static void _releaseThreadStats(void *arg);
+static void _mergeStatsHist(statsHist_t *to, statsHist_t *from);
+static void _addStatsHist(statsHist_t *hist, rodsLong_t elapsedUsec, int status, rodsLong_t bytes);
+static int _getStatsHistBucket(rodsLong_t usec);
+static rodsLong_t _getStatsHistPercentile(statsHist_t *hist, double percentile);
+static int _getStatsApiSlot(int apiNumber);
+static const char *_getStatsApiName(int apiNumber, char *buf, size_t bufLen);
+static int _appendStats(char **buf, size_t *len, size_t *size, const char *name, statsHist_t *hist);
+static void _recordStatsApi(int apiNumber, int status, rodsLong_t elapsedUsec, int inBsLen, int outBsLen);
+static rodsLong_t _getStatsUsec(struct timespec *start);
+static int _dumpStats();
+static void *_statsDumpThread(void *arg);
+
+static int _isStatsPath(const char *path);
+static int _statsGetattr(const char *path, struct stat *stbuf);
+static int _statsReadlink(const char *path, char *buf, size_t size);
+static int _statsReaddir(const char *path, void *buf, fuse_fill_dir_t filler, off_t offset, struct fuse_file_info *fi);
+static int _statsMknod(const char *path, mode_t mode, dev_t rdev);
+static int _statsMkdir(const char *path, mode_t mode);
+static int _statsSymlink(const char *from, const char *to);
+static int _statsUnlink(const char *path);
+static int _statsRmdir(const char *path);
+static int _statsRename(const char *from, const char *to);
+static int _statsLink(const char *from, const char *to);
+static int _statsChmod(const char *path, mode_t mode);
+static int _statsChown(const char *path, uid_t uid, gid_t gid);
+static int _statsTruncate(const char *path, off_t size);
+static int _statsUtimens(const char *path, const struct timespec ts[]);
+static int _statsOpen(const char *path, struct fuse_file_info *fi);
+static int _statsRead(const char *path, char *buf, size_t size, off_t offset, struct fuse_file_info *fi);
+static int _statsWrite(const char *path, const char *buf, size_t size, off_t offset, struct fuse_file_info *fi);
+static int _statsStatfs(const char *path, struct statvfs *stbuf);
+static int _statsRelease(const char *path, struct fuse_file_info *fi);
+static int _statsFsync(const char *path, int isdatasync, struct fuse_file_info *fi);
+static int _statsFlush(const char *path, struct fuse_file_info *fi);
+
+/**************************************************************************
+ * public functions
+ **************************************************************************/
+int
+initStats (statsConfig_t *statsConfig) {
+    int status;
+
+    if (statsConfig == NULL) {
+        return SYS_INTERNAL_NULL_INPUT_ERR;
+    }
+
+    bzero(&StatsConfig, sizeof(statsConfig_t));
+    StatsConfig.dumpPath = statsConfig->dumpPath;
+    StatsConfig.dumpInterval = statsConfig->dumpInterval;
+    if (StatsConfig.dumpInterval <= 0) {
+        StatsConfig.dumpInterval = STATS_DEFAULT_DUMP_INTERVAL;
+    }
+
+    rodsLog (LOG_DEBUG, "initStats: dumpPath = %s", StatsConfig.dumpPath != NULL ? StatsConfig.dumpPath : "");
+    rodsLog (LOG_DEBUG, "initStats: dumpInterval = %d", StatsConfig.dumpInterval);
+
+    pthread_mutex_init(&StatsLock, NULL);
+    pthread_key_create(&StatsKey, _releaseThreadStats);
+    bzero(&StatsRetired, sizeof(threadStats_t));
+    StatsThreads = NULL;
+    NumStatsApis = 0;
+    clock_gettime(CLOCK_MONOTONIC, &StatsStartTime);
+
+    StatsRunning = 1;
+    gProcApiRequestCB = _recordStatsApi;
+
+    if (StatsConfig.dumpPath != NULL) {
+        pthread_mutex_init(&StatsDumpLock, NULL);
+        pthread_cond_init(&StatsDumpCond, NULL);
+        StatsDumpRunning = 1;
+        status = pthread_create(&StatsDumpThread, NULL, _statsDumpThread, NULL);
+        if (status != 0) {
+            rodsLog (LOG_ERROR, "initStats: failed to create a dump thread, status = %d", status);
+            StatsDumpRunning = 0;
+            pthread_cond_destroy(&StatsDumpCond);
+            pthread_mutex_destroy(&StatsDumpLock);
+        }
+    }
+    return 0;
+}
+
+int
+uninitStats (statsConfig_t *statsConfig) {
+    threadStats_t *threadStats;
+
+    if (!StatsRunning) {
+        return 0;
+    }
+
+    if (StatsDumpRunning) {
+        pthread_mutex_lock(&StatsDumpLock);
+        StatsDumpRunning = 0;
+        pthread_cond_signal(&StatsDumpCond);
+        pthread_mutex_unlock(&StatsDumpLock);
+        pthread_join(StatsDumpThread, NULL);
+        pthread_cond_destroy(&StatsDumpCond);
+        pthread_mutex_destroy(&StatsDumpLock);
+    }
+
+    if (StatsConfig.dumpPath != NULL) {
+        // last numbers of the mount
+        _dumpStats();
+    }
+
+    gProcApiRequestCB = NULL;
+    StatsRunning = 0;
+
+    // threads still running leave their counters behind
+    pthread_mutex_lock(&StatsLock);
+    while (StatsThreads != NULL) {
+        threadStats = StatsThreads;
+        StatsThreads = threadStats->next;
+        free(threadStats);
+    }
+    pthread_mutex_unlock(&StatsLock);
+
+    pthread_key_delete(StatsKey);
+    pthread_mutex_destroy(&StatsLock);
+    return 0;
+}
+
+int
+isStatsEnabled () {
+    if (!StatsRunning) {
+        return -1;
+    }
+    return 0;
+}
+
+/*
+ * replace every operation of oper by one that times it and serves the
+ * stats file. the original operations are called from the replacements.
+ * counting starts with initStats.
+ */
+int
+wrapStatsOperations (struct fuse_operations *oper) {
+    if (oper == NULL) {
+        return SYS_INTERNAL_NULL_INPUT_ERR;
+    }
+
+    memcpy(&StatsNextOper, oper, sizeof(struct fuse_operations));
+
+    oper->getattr = _statsGetattr;
+    oper->readlink = _statsReadlink;
+    oper->readdir = _statsReaddir;
+    oper->mknod = _statsMknod;
+    oper->mkdir = _statsMkdir;
+    oper->symlink = _statsSymlink;
+    oper->unlink = _statsUnlink;
+    oper->rmdir = _statsRmdir;
+    oper->rename = _statsRename;
+    oper->link = _statsLink;
+    oper->chmod = _statsChmod;
+    oper->chown = _statsChown;
+    oper->truncate = _statsTruncate;
+    oper->utimens = _statsUtimens;
+    oper->open = _statsOpen;
+    oper->read = _statsRead;
+    oper->write = _statsWrite;
+    oper->statfs = _statsStatfs;
+    oper->release = _statsRelease;
+    oper->fsync = _statsFsync;
+    oper->flush = _statsFlush;
+    return 0;
+}
+
+void
+recordStatsOp (statsOp_t op, rodsLong_t elapsedUsec, int status, rodsLong_t bytes) {
+    threadStats_t *threadStats;
+
+    if (!StatsRunning || op < 0 || op >= NUM_STATS_OPS) {
+        return;
+    }
+
+    threadStats = _getThreadStats();
+    if (threadStats == NULL) {
+        return;
+    }
+    _addStatsHist(&threadStats->ops[op], elapsedUsec, status, bytes);
+}
+
+/* the stats as text, *outBuf is malloc'ed and freed by the caller */
+int
+formatStats (char **outBuf, size_t *outLen) {
+    statsHist_t *ops;
+    statsHist_t *apis;
+    threadStats_t *threadStats;
+    sockCommStats_t sockStats;
+    char *buf = NULL;
+    size_t len = 0;
+    size_t size = 0;
+    char line[MAX_NAME_LEN];
+    char apiName[NAME_LEN];
+    int numApis;
+    int i;
+
+    if (outBuf == NULL || outLen == NULL) {
+        return SYS_INTERNAL_NULL_INPUT_ERR;
+    }
+
+    if (!StatsRunning) {
+        return SYS_INTERNAL_NULL_INPUT_ERR;
+    }
+
+    ops = (statsHist_t *)calloc(NUM_STATS_OPS, sizeof(statsHist_t));
+    apis = (statsHist_t *)calloc(MAX_STATS_APIS, sizeof(statsHist_t));
+    if (ops == NULL || apis == NULL) {
+        free(ops);
+        free(apis);
+        return SYS_MALLOC_ERR;
+    }
+
+    // add up the counters of all threads. they keep counting meanwhile,
+    // a line may be off by the requests done while it was read
+    pthread_mutex_lock(&StatsLock);
+    numApis = NumStatsApis;
+    for (i = 0; i < NUM_STATS_OPS; i++) {
+        _mergeStatsHist(&ops[i], &StatsRetired.ops[i]);
+    }
+    for (i = 0; i < numApis; i++) {
+        _mergeStatsHist(&apis[i], &StatsRetired.apis[i]);
+    }
+    for (threadStats = StatsThreads; threadStats != NULL; threadStats = threadStats->next) {
+        for (i = 0; i < NUM_STATS_OPS; i++) {
+            _mergeStatsHist(&ops[i], &threadStats->ops[i]);
+        }
+        for (i = 0; i < numApis; i++) {
+            _mergeStatsHist(&apis[i], &threadStats->apis[i]);
+        }
+    }
+    pthread_mutex_unlock(&StatsLock);
+
+    snprintf(line, MAX_NAME_LEN, "# irodsFs stats, uptime %lld sec, times in usec\n",
+        _getStatsUsec(&StatsStartTime) / 1000000);
+    _appendStats(&buf, &len, &size, line, NULL);
+    snprintf(line, MAX_NAME_LEN, "%-24s %10s %8s %14s %8s %8s %8s %8s %8s %10s\n",
+        "# op", "count", "errors", "bytes", "avg", "p50", "p90", "p99", "p99.9", "max");
+    _appendStats(&buf, &len, &size, line, NULL);
+    for (i = 0; i < NUM_STATS_OPS; i++) {
+        _appendStats(&buf, &len, &size, StatsOpNames[i], &ops[i]);
+    }
+
+    snprintf(line, MAX_NAME_LEN, "%-24s %10s %8s %14s %8s %8s %8s %8s %8s %10s\n",
+        "# rpc", "count", "errors", "bytes", "avg", "p50", "p90", "p99", "p99.9", "max");
+    _appendStats(&buf, &len, &size, line, NULL);
+    for (i = 0; i < numApis; i++) {
+        _appendStats(&buf, &len, &size, _getStatsApiName(StatsApis[i], apiName, NAME_LEN), &apis[i]);
+    }
+
+    // the msg layer counters are process wide and count from the start.
+    // syscalls and bufs per msg tell how well the rpcs are batched
+    getSockCommStats(&sockStats);
+    snprintf(line, MAX_NAME_LEN, "%-24s %10s %10s %10s %10s %10s %10s\n",
+        "# sock", "sent", "read", "writes", "reads", "allocs", "reuses");
+    _appendStats(&buf, &len, &size, line, NULL);
+    snprintf(line, MAX_NAME_LEN, "%-24s %10lld %10lld %10lld %10lld %10lld %10lld\n",
+        "msgs", sockStats.msgSent, sockStats.msgRead, sockStats.writeCalls,
+        sockStats.readCalls, sockStats.bufAlloc, sockStats.bufReuse);
+    _appendStats(&buf, &len, &size, line, NULL);
+    if (sockStats.msgSent > 0 && sockStats.msgRead > 0) {
+        snprintf(line, MAX_NAME_LEN, "%-24s %10s %10s %10.2f %10.2f %10.2f %10.2f\n",
+            "per msg", "", "",
+            (double)sockStats.writeCalls / sockStats.msgSent,
+            (double)sockStats.readCalls / sockStats.msgRead,
+            (double)sockStats.bufAlloc / sockStats.msgRead,
+            (double)sockStats.bufReuse / sockStats.msgRead);
+        _appendStats(&buf, &len, &size, line, NULL);
+    }
+
+    free(ops);
+    free(apis);
+
+    if (buf == NULL) {
+        return SYS_MALLOC_ERR;
+    }
+
+    *outBuf = buf;
+    *outLen = len;
+    return 0;
+}
+
+/**************************************************************************
+ * private functions
+ **************************************************************************/
+/* the counters of the calling thread, made on first use */
+static threadStats_t *
+_getThreadStats() {
+    threadStats_t *threadStats;
+
+    threadStats = (threadStats_t *)pthread_getspecific(StatsKey);
+    if (threadStats != NULL) {
+        return threadStats;
+    }
+
+    threadStats = (threadStats_t *)calloc(1, sizeof(threadStats_t));
+    if (threadStats == NULL) {
+        return NULL;
+    }
+
+    pthread_mutex_lock(&StatsLock);
+    threadStats->next = StatsThreads;
+    if (StatsThreads != NULL) {
+        StatsThreads->prev = threadStats;
+    }
+    StatsThreads = threadStats;
+    pthread_mutex_unlock(&StatsLock);
+
+    pthread_setspecific(StatsKey, threadStats);
+    return threadStats;
+}
+
+/* runs when a thread exits, fuse starts and stops its workers on demand */
+static void
+_releaseThreadStats(void *arg) {
+    threadStats_t *threadStats = (threadStats_t *)arg;
+    int i;
+
+    if (threadStats == NULL) {
+        return;
+    }
+
+    pthread_mutex_lock(&StatsLock);
+    for (i = 0; i < NUM_STATS_OPS; i++) {
+        _mergeStatsHist(&StatsRetired.ops[i], &threadStats->ops[i]);
+    }
+    for (i = 0; i < NumStatsApis; i++) {
+        _mergeStatsHist(&StatsRetired.apis[i], &threadStats->apis[i]);
+    }
+
+    if (threadStats->prev != NULL) {
+        threadStats->prev->next = threadStats->next;
+    } else {
+        StatsThreads = threadStats->next;
+    }
+    if (threadStats->next != NULL) {
+        threadStats->next->prev = threadStats->prev;
+    }
+    pthread_mutex_unlock(&StatsLock);
+
+    free(threadStats);
+}
+
+static void
+_mergeStatsHist(statsHist_t *to, statsHist_t *from) {
+    int i;
+
+    if (from->count == 0) {
+        return;
+    }
+
+    to->count += from->count;
+    to->errors += from->errors;
+    to->bytes += from->bytes;
+    to->totalUsec += from->totalUsec;
+    if (from->maxUsec > to->maxUsec) {
+        to->maxUsec = from->maxUsec;
+    }
+    for (i = 0; i < NUM_STATS_HIST_BUCKETS; i++) {
+        to->buckets[i] += from->buckets[i];
+    }
+}
+
+/* only the owning thread writes hist */
+static void
+_addStatsHist(statsHist_t *hist, rodsLong_t elapsedUsec, int status, rodsLong_t bytes) {
+    hist->buckets[_getStatsHistBucket(elapsedUsec)]++;
+    hist->totalUsec += elapsedUsec;
+    if (elapsedUsec > hist->maxUsec) {
+        hist->maxUsec = elapsedUsec;
+    }
+    if (status < 0) {
+        hist->errors++;
+    } else if (bytes > 0) {
+        hist->bytes += bytes;
+    }
+    hist->count++;
+}
+
+static int
+_getStatsHistBucket(rodsLong_t usec) {
+    int exp;
+    int bucket;
+
+    if (usec < STATS_HIST_SUB_BUCKETS) {
+        return usec < 0 ? 0 : (int) usec;
+    }
+
+    // position of the highest bit, then the next bits select the sub bucket
+    exp = STATS_HIST_SUB_BUCKET_BITS;
+    while (exp < STATS_HIST_MAX_EXP && (usec >> (exp + 1)) != 0) {
+        exp++;
+    }
+    if (exp >= STATS_HIST_MAX_EXP) {
+        return NUM_STATS_HIST_BUCKETS - 1;
+    }
+
+    bucket = (exp - STATS_HIST_SUB_BUCKET_BITS + 1) * STATS_HIST_SUB_BUCKETS +
+        (int) ((usec >> (exp - STATS_HIST_SUB_BUCKET_BITS)) & (STATS_HIST_SUB_BUCKETS - 1));
+    return bucket;
+}
+
+/* the upper bound of the bucket the percentile falls in, at most the max */
+static rodsLong_t
+_getStatsHistPercentile(statsHist_t *hist, double percentile) {
+    rodsLong_t rank;
+    rodsLong_t seen = 0;
+    rodsLong_t upper;
+    int group;
+    int sub;
+    int i;
+
+    if (hist->count == 0) {
+        return 0;
+    }
+
+    rank = (rodsLong_t) (hist->count * percentile / 100.0);
+    if (rank >= hist->count) {
+        rank = hist->count - 1;
+    }
+
+    for (i = 0; i < NUM_STATS_HIST_BUCKETS; i++) {
+        seen += hist->buckets[i];
+        if (seen > rank) {
+            break;
+        }
+    }
+
+    if (i < STATS_HIST_SUB_BUCKETS) {
+        upper = i;
+    } else if (i >= NUM_STATS_HIST_BUCKETS) {
+        upper = hist->maxUsec;
+    } else {
+        group = i / STATS_HIST_SUB_BUCKETS - 1;
+        sub = i % STATS_HIST_SUB_BUCKETS;
+        upper = (((rodsLong_t) STATS_HIST_SUB_BUCKETS + sub + 1) << group) - 1;
+    }
+
+    if (upper > hist->maxUsec) {
+        upper = hist->maxUsec;
+    }
+    return upper;
+}
+
+/* the slot of apiNumber, added if new. the last slot counts the numbers
+ * that did not get one */
+static int
+_getStatsApiSlot(int apiNumber) {
+    int numApis = NumStatsApis;
+    int i;
+
+    for (i = 0; i < numApis; i++) {
+        if (StatsApis[i] == apiNumber) {
+            return i;
+        }
+    }
+
+    pthread_mutex_lock(&StatsLock);
+    for (i = numApis; i < NumStatsApis; i++) {
+        if (StatsApis[i] == apiNumber) {
+            pthread_mutex_unlock(&StatsLock);
+            return i;
+        }
+    }
+
+    if (NumStatsApis < MAX_STATS_APIS - 1) {
+        i = NumStatsApis;
+        StatsApis[i] = apiNumber;
+    } else {
+        i = MAX_STATS_APIS - 1;
+        StatsApis[i] = -1;
+    }
+    // the slot must be visible before it is counted in
+    __sync_synchronize();
+    if (i >= NumStatsApis) {
+        NumStatsApis = i + 1;
+    }
+    pthread_mutex_unlock(&StatsLock);
+    return i;
+}
+
+static const char *
+_getStatsApiName(int apiNumber, char *buf, size_t bufLen) {
+    int i;
+
+    if (apiNumber < 0) {
+        return "other";
+    }
+
+    for (i = 0; StatsApiNames[i].name != NULL; i++) {
+        if (StatsApiNames[i].number == apiNumber) {
+            return StatsApiNames[i].name;
+        }
+    }
+
+    snprintf(buf, bufLen, "API_%d", apiNumber);
+    return buf;
+}
+
+/* append a line of hist, or name as is when hist is NULL */
+static int
+_appendStats(char **buf, size_t *len, size_t *size, const char *name, statsHist_t *hist) {
+    char line[MAX_NAME_LEN];
+    size_t lineLen;
+    char *newBuf;
+
+    if (hist == NULL) {
+        rstrcpy(line, (char *) name, MAX_NAME_LEN);
+    } else {
+        snprintf(line, MAX_NAME_LEN, "%-24s %10lld %8lld %14lld %8lld %8lld %8lld %8lld %8lld %10lld\n",
+            name, hist->count, hist->errors, hist->bytes,
+            hist->count > 0 ? hist->totalUsec / hist->count : 0,
+            _getStatsHistPercentile(hist, 50.0),
+            _getStatsHistPercentile(hist, 90.0),
+            _getStatsHistPercentile(hist, 99.0),
+            _getStatsHistPercentile(hist, 99.9),
+            hist->maxUsec);
+    }
+
+    lineLen = strlen(line);
+    if (*len + lineLen + 1 > *size) {
+        newBuf = (char *)realloc(*buf, *size + MAX_NAME_LEN * 8);
+        if (newBuf == NULL) {
+            return SYS_MALLOC_ERR;
+        }
+        *buf = newBuf;
+        *size += MAX_NAME_LEN * 8;
+    }
+
+    memcpy(*buf + *len, line, lineLen + 1);
+    *len += lineLen;
+    return 0;
+}
+
+/* gProcApiRequestCB, called in the thread that made the request */
+static void
+_recordStatsApi(int apiNumber, int status, rodsLong_t elapsedUsec, int inBsLen, int outBsLen) {
+    threadStats_t *threadStats;
+
+    if (!StatsRunning) {
+        return;
+    }
+
+    threadStats = _getThreadStats();
+    if (threadStats == NULL) {
+        return;
+    }
+    _addStatsHist(&threadStats->apis[_getStatsApiSlot(apiNumber)], elapsedUsec, status,
+        (rodsLong_t) inBsLen + outBsLen);
+}
+
+static rodsLong_t
+_getStatsUsec(struct timespec *start) {
+    struct timespec now;
+
+    clock_gettime(CLOCK_MONOTONIC, &now);
+    return (rodsLong_t) (now.tv_sec - start->tv_sec) * 1000000 +
+        (now.tv_nsec - start->tv_nsec) / 1000;
+}
+
+/* write the stats to a temporary file first, readers never see half of it */
+static int
+_dumpStats() {
+    char tmpPath[MAX_NAME_LEN];
+    char *buf = NULL;
+    size_t len = 0;
+    FILE *fp;
+    int status;
+
+    status = formatStats(&buf, &len);
+    if (status < 0) {
+        return status;
+    }
+
+    snprintf(tmpPath, MAX_NAME_LEN, "%s.tmp", StatsConfig.dumpPath);
+    fp = fopen(tmpPath, "w");
+    if (fp == NULL) {
+        rodsLog (LOG_ERROR, "_dumpStats: failed to open %s, errno = %d", tmpPath, errno);
+        free(buf);
+        return UNIX_FILE_OPEN_ERR - errno;
+    }
+
+    if (fwrite(buf, 1, len, fp) != len) {
+        status = UNIX_FILE_WRITE_ERR - errno;
+    }
+    if (fclose(fp) != 0 && status == 0) {
+        status = UNIX_FILE_WRITE_ERR - errno;
+    }
+    free(buf);
+
+    if (status < 0) {
+        rodsLog (LOG_ERROR, "_dumpStats: failed to write %s, status = %d", tmpPath, status);
+        unlink(tmpPath);
+        return status;
+    }
+
+    if (rename(tmpPath, StatsConfig.dumpPath) != 0) {
+        rodsLog (LOG_ERROR, "_dumpStats: failed to rename %s, errno = %d", tmpPath, errno);
+        unlink(tmpPath);
+        return UNIX_FILE_RENAME_ERR - errno;
+    }
+    return 0;
+}
+
+static void *
+_statsDumpThread(void *arg) {
+    struct timeval now;
+    struct timespec timeout;
+
+    pthread_mutex_lock(&StatsDumpLock);
+    while (StatsDumpRunning) {
+        gettimeofday(&now, NULL);
+        timeout.tv_sec = now.tv_sec + StatsConfig.dumpInterval;
+        timeout.tv_nsec = now.tv_usec * 1000;
+        pthread_cond_timedwait(&StatsDumpCond, &StatsDumpLock, &timeout);
+        if (!StatsDumpRunning) {
+            break;
+        }
+
+        pthread_mutex_unlock(&StatsDumpLock);
+        _dumpStats();
+        pthread_mutex_lock(&StatsDumpLock);
+    }
+    pthread_mutex_unlock(&StatsDumpLock);
+    return NULL;
+}
+
+/*
+ * fuse operations. STATS_DIR_PATH and STATS_FILE_PATH are served here and
+ * never reach iRODS, everything else is timed and passed on.
+ */
+#define STATS_TIMED(op, call, bytesOf) \
+    struct timespec start; \
+    int status; \
+    clock_gettime(CLOCK_MONOTONIC, &start); \
+    status = call; \
+    recordStatsOp(op, _getStatsUsec(&start), status, bytesOf); \
+    return status;
+
+/* 1 for the stats file, 2 for its directory, 0 otherwise */
+static int
+_isStatsPath(const char *path) {
+    if (path == NULL) {
+        return 0;
+    }
+    if (strcmp(path, STATS_FILE_PATH) == 0) {
+        return 1;
+    }
+    if (strcmp(path, STATS_DIR_PATH) == 0) {
+        return 2;
+    }
+    return 0;
+}
+
+static int
+_statsGetattr(const char *path, struct stat *stbuf) {
+    int statsPath = _isStatsPath(path);
+
+    if (statsPath != 0) {
+        bzero(stbuf, sizeof(struct stat));
+        stbuf->st_uid = getuid();
+        stbuf->st_gid = getgid();
+        stbuf->st_mtime = stbuf->st_ctime = stbuf->st_atime = time(NULL);
+        if (statsPath == 2) {
+            stbuf->st_mode = S_IFDIR | 0555;
+            stbuf->st_nlink = 2;
+        } else {
+            // the size is only known once the file is read, see _statsOpen
+            stbuf->st_mode = S_IFREG | 0444;
+            stbuf->st_nlink = 1;
+        }
+        return 0;
+    }
+
+    STATS_TIMED(STATS_OP_GETATTR, StatsNextOper.getattr(path, stbuf), 0);
+}
+
+static int
+_statsReadlink(const char *path, char *buf, size_t size) {
+    if (_isStatsPath(path) != 0) {
+        return -EINVAL;
+    }
+
+    STATS_TIMED(STATS_OP_READLINK, StatsNextOper.readlink(path, buf, size), 0);
+}
+
+static int
+_statsReaddir(const char *path, void *buf, fuse_fill_dir_t filler, off_t offset, struct fuse_file_info *fi) {
+    struct timespec start;
+    int status;
+
+    if (_isStatsPath(path) == 2) {
+        filler(buf, ".", NULL, 0);
+        filler(buf, "..", NULL, 0);
+        filler(buf, STATS_FILE_PATH + strlen(STATS_DIR_PATH) + 1, NULL, 0);
+        return 0;
+    }
+    if (_isStatsPath(path) == 1) {
+        return -ENOTDIR;
+    }
+
+    clock_gettime(CLOCK_MONOTONIC, &start);
+    status = StatsNextOper.readdir(path, buf, filler, offset, fi);
+    recordStatsOp(STATS_OP_READDIR, _getStatsUsec(&start), status, 0);
+
+    if (status == 0 && strcmp(path, "/") == 0) {
+        filler(buf, STATS_DIR_PATH + 1, NULL, 0);
+    }
+    return status;
+}
+
+static int
+_statsMknod(const char *path, mode_t mode, dev_t rdev) {
+    if (_isStatsPath(path) != 0) {
+        return -EEXIST;
+    }
+
+    STATS_TIMED(STATS_OP_MKNOD, StatsNextOper.mknod(path, mode, rdev), 0);
+}
+
+static int
+_statsMkdir(const char *path, mode_t mode) {
+    if (_isStatsPath(path) != 0) {
+        return -EEXIST;
+    }
+
+    STATS_TIMED(STATS_OP_MKDIR, StatsNextOper.mkdir(path, mode), 0);
+}
+
+static int
+_statsSymlink(const char *from, const char *to) {
+    if (_isStatsPath(to) != 0) {
+        return -EEXIST;
+    }
+
+    STATS_TIMED(STATS_OP_SYMLINK, StatsNextOper.symlink(from, to), 0);
+}
+
+static int
+_statsUnlink(const char *path) {
+    if (_isStatsPath(path) != 0) {
+        return -EACCES;
+    }
+
+    STATS_TIMED(STATS_OP_UNLINK, StatsNextOper.unlink(path), 0);
+}
+
+static int
+_statsRmdir(const char *path) {
+    if (_isStatsPath(path) != 0) {
+        return -EACCES;
+    }
+
+    STATS_TIMED(STATS_OP_RMDIR, StatsNextOper.rmdir(path), 0);
+}
+
+static int
+_statsRename(const char *from, const char *to) {
+    if (_isStatsPath(from) != 0 || _isStatsPath(to) != 0) {
+        return -EACCES;
+    }
+
+    STATS_TIMED(STATS_OP_RENAME, StatsNextOper.rename(from, to), 0);
+}
+
+static int
+_statsLink(const char *from, const char *to) {
+    if (_isStatsPath(from) != 0 || _isStatsPath(to) != 0) {
+        return -EACCES;
+    }
+
+    STATS_TIMED(STATS_OP_LINK, StatsNextOper.link(from, to), 0);
+}
+
+static int
+_statsChmod(const char *path, mode_t mode) {
+    if (_isStatsPath(path) != 0) {
+        return -EACCES;
+    }
+
+    STATS_TIMED(STATS_OP_CHMOD, StatsNextOper.chmod(path, mode), 0);
+}
+
+static int
+_statsChown(const char *path, uid_t uid, gid_t gid) {
+    if (_isStatsPath(path) != 0) {
+        return -EACCES;
+    }
+
+    STATS_TIMED(STATS_OP_CHOWN, StatsNextOper.chown(path, uid, gid), 0);
+}
+
+static int
+_statsTruncate(const char *path, off_t size) {
+    if (_isStatsPath(path) != 0) {
+        return -EACCES;
+    }
+
+    STATS_TIMED(STATS_OP_TRUNCATE, StatsNextOper.truncate(path, size), 0);
+}
+
+static int
+_statsUtimens(const char *path, const struct timespec ts[]) {
+    if (_isStatsPath(path) != 0) {
+        return -EACCES;
+    }
+
+    STATS_TIMED(STATS_OP_UTIMENS, StatsNextOper.utimens(path, ts), 0);
+}
+
+/* the stats are taken when the file is opened and read from that copy */
+static int
+_statsOpen(const char *path, struct fuse_file_info *fi) {
+    statsSnapshot_t *snapshot;
+    int statsPath = _isStatsPath(path);
+
+    if (statsPath == 2) {
+        return -EISDIR;
+    }
+    if (statsPath == 1) {
+        if ((fi->flags & O_ACCMODE) != O_RDONLY) {
+            return -EACCES;
+        }
+
+        snapshot = (statsSnapshot_t *)calloc(1, sizeof(statsSnapshot_t));
+        if (snapshot == NULL) {
+            return -ENOMEM;
+        }
+        if (formatStats(&snapshot->buf, &snapshot->len) < 0) {
+            free(snapshot);
+            return -EIO;
+        }
+
+        fi->fh = (uint64_t) (uintptr_t) snapshot;
+        // getattr has no size, reads must not stop there
+        fi->direct_io = 1;
+        return 0;
+    }
+
+    STATS_TIMED(STATS_OP_OPEN, StatsNextOper.open(path, fi), 0);
+}
+
+static int
+_statsRead(const char *path, char *buf, size_t size, off_t offset, struct fuse_file_info *fi) {
+    statsSnapshot_t *snapshot;
+
+    if (_isStatsPath(path) == 1) {
+        snapshot = (statsSnapshot_t *) (uintptr_t) fi->fh;
+        if (snapshot == NULL || offset < 0 || (size_t) offset >= snapshot->len) {
+            return 0;
+        }
+        if (size > snapshot->len - offset) {
+            size = snapshot->len - offset;
+        }
+        memcpy(buf, snapshot->buf + offset, size);
+        return (int) size;
+    }
+
+    STATS_TIMED(STATS_OP_READ, StatsNextOper.read(path, buf, size, offset, fi), status);
+}
+
+static int
+_statsWrite(const char *path, const char *buf, size_t size, off_t offset, struct fuse_file_info *fi) {
+    if (_isStatsPath(path) != 0) {
+        return -EACCES;
+    }
+
+    STATS_TIMED(STATS_OP_WRITE, StatsNextOper.write(path, buf, size, offset, fi), status);
+}
+
+static int
+_statsStatfs(const char *path, struct statvfs *stbuf) {
+    STATS_TIMED(STATS_OP_STATFS, StatsNextOper.statfs(path, stbuf), 0);
+}
+
+static int
+_statsRelease(const char *path, struct fuse_file_info *fi) {
+    statsSnapshot_t *snapshot;
+
+    if (_isStatsPath(path) == 1) {
+        snapshot = (statsSnapshot_t *) (uintptr_t) fi->fh;
+        if (snapshot != NULL) {
+            free(snapshot->buf);
+            free(snapshot);
+        }
+        fi->fh = 0;
+        return 0;
+    }
+
+    STATS_TIMED(STATS_OP_RELEASE, StatsNextOper.release(path, fi), 0);
+}
+
+static int
+_statsFsync(const char *path, int isdatasync, struct fuse_file_info *fi) {
+    if (_isStatsPath(path) != 0) {
+        return 0;
+    }
+
+    STATS_TIMED(STATS_OP_FSYNC, StatsNextOper.fsync(path, isdatasync, fi), 0);
+}
+
+static int
+_statsFlush(const char *path, struct fuse_file_info *fi) {
+    if (_isStatsPath(path) != 0) {
+        return 0;
+    }
+
+    STATS_TIMED(STATS_OP_FLUSH, StatsNextOper.flush(path, fi), 0);
+}
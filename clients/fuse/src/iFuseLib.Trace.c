@@ -12,11 +12,16 @@
 #include "iFuseLib.Trace.h"
 
 struct log_context* LOGCTX = NULL;
+struct binlog_context* BINLOGCTX = NULL;
 
 
 #ifndef _TEST_TRACE
 int traced_irodsGetattr(const char *path, struct stat *stbuf) {
    
+   if( BINLOGCTX != NULL ) {
+      binlog_call( BINLOGCTX, TRACE_GETATTR, path, 0, 0, irodsGetattr( path, stbuf ) );
+   }
+   
    char path_hash[LOG_PATH_HASH_LEN];
    log_hash_path( LOGCTX, path, path_hash );    
    logmsg( LOGCTX, TRACE_GETATTR, "irodsGetattr(%s, %p)\n", path_hash, stbuf );
@@ -30,6 +35,10 @@ int traced_irodsGetattr(const char *path, struct stat *stbuf) {
 
 int traced_irodsReadlink(const char *path, char *buf, size_t size) {
    
+   if( BINLOGCTX != NULL ) {
+      binlog_call( BINLOGCTX, TRACE_READLINK, path, size, 0, irodsReadlink( path, buf, size ) );
+   }
+   
    char path_hash[LOG_PATH_HASH_LEN];
    log_hash_path( LOGCTX, path, path_hash );    
    logmsg( LOGCTX, TRACE_READLINK, "irodsReadlink(%s, %p, %zu)\n", path_hash, buf, size );
@@ -43,6 +52,10 @@ int traced_irodsReadlink(const char *path, char *buf, size_t size) {
 
 int traced_irodsMknod(const char *path, mode_t mode, dev_t rdev) {
    
+   if( BINLOGCTX != NULL ) {
+      binlog_call( BINLOGCTX, TRACE_MKNOD, path, 0, 0, irodsMknod( path, mode, rdev ) );
+   }
+   
    char path_hash[LOG_PATH_HASH_LEN];
    log_hash_path( LOGCTX, path, path_hash );
    logmsg( LOGCTX, TRACE_MKNOD, "irodsMknod(%s, %o, %lX)\n", path_hash, mode, rdev );
@@ -56,6 +69,10 @@ int traced_irodsMknod(const char *path, mode_t mode, dev_t rdev) {
 
 int traced_irodsMkdir(const char *path, mode_t mode) {
    
+   if( BINLOGCTX != NULL ) {
+      binlog_call( BINLOGCTX, TRACE_MKDIR, path, 0, 0, irodsMkdir( path, mode ) );
+   }
+   
    char path_hash[LOG_PATH_HASH_LEN];
    log_hash_path( LOGCTX, path, path_hash );    
    logmsg( LOGCTX, TRACE_MKDIR, "irodsMkdir(%s, %o)\n", path_hash, mode );
@@ -69,6 +86,10 @@ int traced_irodsMkdir(const char *path, mode_t mode) {
 
 int traced_irodsUnlink(const char *path) {
    
+   if( BINLOGCTX != NULL ) {
+      binlog_call( BINLOGCTX, TRACE_UNLINK, path, 0, 0, irodsUnlink( path ) );
+   }
+   
    char path_hash[LOG_PATH_HASH_LEN];
    log_hash_path( LOGCTX, path, path_hash );    
    logmsg( LOGCTX, TRACE_UNLINK, "irodsUnlink(%s)\n", path_hash );
@@ -82,6 +103,10 @@ int traced_irodsUnlink(const char *path) {
 
 int traced_irodsRmdir(const char *path) {
    
+   if( BINLOGCTX != NULL ) {
+      binlog_call( BINLOGCTX, TRACE_RMDIR, path, 0, 0, irodsRmdir( path ) );
+   }
+   
    char path_hash[LOG_PATH_HASH_LEN];
    log_hash_path( LOGCTX, path, path_hash );    
    logmsg( LOGCTX, TRACE_RMDIR, "irodsRmdir(%s)\n", path_hash );
@@ -95,6 +120,10 @@ int traced_irodsRmdir(const char *path) {
 
 int traced_irodsSymlink(const char *from, const char *to) {
    
+   if( BINLOGCTX != NULL ) {
+      binlog_call( BINLOGCTX, TRACE_SYMLINK, to, 0, 0, irodsSymlink( from, to ) );
+   }
+   
    char from_hash[LOG_PATH_HASH_LEN];
    char to_hash[LOG_PATH_HASH_LEN];
    
@@ -111,6 +140,10 @@ int traced_irodsSymlink(const char *from, const char *to) {
 }
 
 int traced_irodsRename(const char *from, const char *to) {
+   
+   if( BINLOGCTX != NULL ) {
+      binlog_call( BINLOGCTX, TRACE_RENAME, from, 0, 0, irodsRename( from, to ) );
+   }
 
    char from_hash[LOG_PATH_HASH_LEN];
    char to_hash[LOG_PATH_HASH_LEN];
@@ -128,6 +161,10 @@ int traced_irodsRename(const char *from, const char *to) {
 }
 
 int traced_irodsLink(const char *from, const char *to) {
+   
+   if( BINLOGCTX != NULL ) {
+      binlog_call( BINLOGCTX, TRACE_LINK, to, 0, 0, irodsLink( from, to ) );
+   }
 
    char from_hash[LOG_PATH_HASH_LEN];
    char to_hash[LOG_PATH_HASH_LEN];
@@ -146,6 +183,10 @@ int traced_irodsLink(const char *from, const char *to) {
 
 int traced_irodsChmod(const char *path, mode_t mode) {
    
+   if( BINLOGCTX != NULL ) {
+      binlog_call( BINLOGCTX, TRACE_CHMOD, path, 0, 0, irodsChmod( path, mode ) );
+   }
+   
    char path_hash[LOG_PATH_HASH_LEN];
    log_hash_path( LOGCTX, path, path_hash );    
    logmsg( LOGCTX, TRACE_CHMOD, "irodsChmod(%s, %o)\n", path_hash, mode );
@@ -159,6 +200,10 @@ int traced_irodsChmod(const char *path, mode_t mode) {
 
 int traced_irodsChown(const char *path, uid_t uid, gid_t gid) {
    
+   if( BINLOGCTX != NULL ) {
+      binlog_call( BINLOGCTX, TRACE_CHOWN, path, 0, 0, irodsChown( path, uid, gid ) );
+   }
+   
    char path_hash[LOG_PATH_HASH_LEN];
    log_hash_path( LOGCTX, path, path_hash );    
    logmsg( LOGCTX, TRACE_CHOWN, "irodsChown(%s, %d, %d)\n", path_hash, uid, gid);
@@ -172,6 +217,10 @@ int traced_irodsChown(const char *path, uid_t uid, gid_t gid) {
 
 int traced_irodsTruncate(const char *path, off_t size) {
    
+   if( BINLOGCTX != NULL ) {
+      binlog_call( BINLOGCTX, TRACE_TRUNCATE, path, size, 0, irodsTruncate( path, size ) );
+   }
+   
    char path_hash[LOG_PATH_HASH_LEN];
    log_hash_path( LOGCTX, path, path_hash );    
    logmsg( LOGCTX, TRACE_TRUNCATE, "irodsTruncate(%s, %zu)\n", path_hash, size);
@@ -185,6 +234,10 @@ int traced_irodsTruncate(const char *path, off_t size) {
 
 int traced_irodsFlush(const char *path, struct fuse_file_info *fi) {
    
+   if( BINLOGCTX != NULL ) {
+      binlog_call( BINLOGCTX, TRACE_FLUSH, path, 0, 0, irodsFlush( path, fi ) );
+   }
+   
    char path_hash[LOG_PATH_HASH_LEN];
    log_hash_path( LOGCTX, path, path_hash );    
    logmsg( LOGCTX, TRACE_FLUSH, "irodsFlush(%s, %p)\n", path_hash, fi);
@@ -198,6 +251,10 @@ int traced_irodsFlush(const char *path, struct fuse_file_info *fi) {
 
 int traced_irodsUtimens (const char *path, const struct timespec ts[]) {
    
+   if( BINLOGCTX != NULL ) {
+      binlog_call( BINLOGCTX, TRACE_UTIMENS, path, 0, 0, irodsUtimens( path, ts ) );
+   }
+   
    char path_hash[LOG_PATH_HASH_LEN];
    log_hash_path( LOGCTX, path, path_hash );    
    logmsg( LOGCTX, TRACE_UTIMENS, "irodsUtimens(%s, %ld, %ld, %ld, %ld)\n", path_hash, ts[0].tv_sec, ts[0].tv_nsec, ts[1].tv_sec, ts[1].tv_nsec );
@@ -211,6 +268,10 @@ int traced_irodsUtimens (const char *path, const struct timespec ts[]) {
 
 int traced_irodsOpen(const char *path, struct fuse_file_info *fi) {
    
+   if( BINLOGCTX != NULL ) {
+      binlog_call( BINLOGCTX, TRACE_OPEN, path, 0, fi->flags, irodsOpen( path, fi ) );
+   }
+   
    char path_hash[LOG_PATH_HASH_LEN];
    log_hash_path( LOGCTX, path, path_hash );    
    logmsg( LOGCTX, TRACE_OPEN, "irodsOpen(%s, %p, flags=%X)\n", path_hash, fi, fi->flags );
@@ -224,6 +285,10 @@ int traced_irodsOpen(const char *path, struct fuse_file_info *fi) {
 
 int traced_irodsRead(const char *path, char *buf, size_t size, off_t offset, struct fuse_file_info *fi) {
    
+   if( BINLOGCTX != NULL ) {
+      binlog_call( BINLOGCTX, TRACE_READ, path, size, offset, irodsRead( path, buf, size, offset, fi ) );
+   }
+   
    char path_hash[LOG_PATH_HASH_LEN];
    log_hash_path( LOGCTX, path, path_hash );    
    logmsg( LOGCTX, TRACE_READ, "irodsRead(%s, %p, %zu, %jd, %p)\n", path_hash, buf, size, offset, fi);
@@ -237,6 +302,10 @@ int traced_irodsRead(const char *path, char *buf, size_t size, off_t offset, str
 
 int traced_irodsWrite(const char *path, const char *buf, size_t size, off_t offset, struct fuse_file_info *fi) {
    
+   if( BINLOGCTX != NULL ) {
+      binlog_call( BINLOGCTX, TRACE_WRITE, path, size, offset, irodsWrite( path, buf, size, offset, fi ) );
+   }
+   
    char path_hash[LOG_PATH_HASH_LEN];
    log_hash_path( LOGCTX, path, path_hash );    
    logmsg( LOGCTX, TRACE_WRITE, "irodsWrite(%s, %p, %zu, %jd, %p)\n", path_hash, buf, size, offset, fi );
@@ -250,6 +319,10 @@ int traced_irodsWrite(const char *path, const char *buf, size_t size, off_t offs
 
 int traced_irodsStatfs(const char *path, struct statvfs *stbuf) {
    
+   if( BINLOGCTX != NULL ) {
+      binlog_call( BINLOGCTX, TRACE_STATFS, path, 0, 0, irodsStatfs( path, stbuf ) );
+   }
+   
    char path_hash[LOG_PATH_HASH_LEN];
    log_hash_path( LOGCTX, path, path_hash );    
    logmsg( LOGCTX, TRACE_STATFS, "irodsStatfs(%s, %p)\n", path_hash, stbuf );
@@ -263,6 +336,10 @@ int traced_irodsStatfs(const char *path, struct statvfs *stbuf) {
 
 int traced_irodsRelease(const char *path, struct fuse_file_info *fi) {
    
+   if( BINLOGCTX != NULL ) {
+      binlog_call( BINLOGCTX, TRACE_RELEASE, path, 0, 0, irodsRelease( path, fi ) );
+   }
+   
    char path_hash[LOG_PATH_HASH_LEN];
    log_hash_path( LOGCTX, path, path_hash );    
    logmsg( LOGCTX, TRACE_RELEASE, "irodsRelease(%s, %p)\n", path_hash, fi );
@@ -276,6 +353,10 @@ int traced_irodsRelease(const char *path, struct fuse_file_info *fi) {
 
 int traced_irodsFsync (const char *path, int isdatasync, struct fuse_file_info *fi) {
    
+   if( BINLOGCTX != NULL ) {
+      binlog_call( BINLOGCTX, TRACE_FSYNC, path, 0, isdatasync, irodsFsync( path, isdatasync, fi ) );
+   }
+   
    char path_hash[LOG_PATH_HASH_LEN];
    log_hash_path( LOGCTX, path, path_hash );    
    logmsg( LOGCTX, TRACE_FSYNC, "irodsFsync(%s, %d, %p)\n", path_hash, isdatasync, fi );
@@ -289,6 +370,10 @@ int traced_irodsFsync (const char *path, int isdatasync, struct fuse_file_info *
 
 int traced_irodsReaddir(const char *path, void *buf, fuse_fill_dir_t filler, off_t offset, struct fuse_file_info *fi) {
    
+   if( BINLOGCTX != NULL ) {
+      binlog_call( BINLOGCTX, TRACE_READDIR, path, 0, offset, irodsReaddir( path, buf, filler, offset, fi ) );
+   }
+   
    char path_hash[LOG_PATH_HASH_LEN];
    log_hash_path( LOGCTX, path, path_hash );    
    logmsg( LOGCTX, TRACE_READDIR, "irodsReaddir(%s, %p, %p, %jd, %p)\n", path_hash, buf, filler, offset, fi );
@@ -461,6 +546,11 @@ int trace_begin( struct log_context** ret ) {
    
    free( trace_status );
    
+   char* trace_format = strdup_or_default( getenv("IRODSFS_LOG_FORMAT"), "text" );
+   int binary = (strcasecmp(trace_format, "binary") == 0);
+   
+   free( trace_format );
+   
    // get the environment 
    char* http_host = NULL;
    char* log_path_salt = NULL;
@@ -473,6 +563,28 @@ int trace_begin( struct log_context** ret ) {
    
    trace_get_environment_variables( &http_host, &portnum, &sync_delay, &timeout, &max_lines, &methods, &log_path_salt, &log_dir );
    
+   if( binary ) {
+      
+      // fixed-size records in per-thread rings, written out by a drain thread started in trace_start_threads
+      char* max_records_str = strdup_or_default( getenv("IRODSFS_LOG_MAX_RECORDS"), "0" );
+      uint64_t max_records = strtoull( max_records_str, NULL, 10 );
+      
+      struct binlog_context* binctx = binlog_init( methods, max_records, log_path_salt, log_dir );
+      
+      free( max_records_str );
+      free( http_host );
+      free( log_path_salt );
+      free( log_dir );
+      
+      if( binctx == NULL ) {
+         fprintf(stderr, "FATAL: binlog_init failed\n");
+         return -1;
+      }
+      
+      BINLOGCTX = binctx;
+      return 0;
+   }
+   
    // set up logging 
    struct log_context* ctx = log_init( http_host, portnum, sync_delay, timeout, max_lines, methods, log_path_salt, log_dir );
    
@@ -516,10 +628,36 @@ int trace_begin( struct log_context** ret ) {
 }
 
 
+// start the threads that are not started by trace_begin.  these must start
+// after fuse_main has forked into the background
+int trace_start_threads( void ) {
+   
+   if( BINLOGCTX != NULL ) {
+      return binlog_start_threads( BINLOGCTX );
+   }
+   
+   return 0;
+}
+
+
 int trace_end( struct log_context** ctx ) {
    
    int rc = 0;
    
+   if( BINLOGCTX != NULL ) {
+      
+      // write out the last of the records
+      rc = binlog_stop_threads( BINLOGCTX );
+      if( rc != 0 ) {
+         fprintf(stderr, "WARN: binlog_stop_threads rc = %d\n", rc );
+      }
+      
+      binlog_free( BINLOGCTX );
+      BINLOGCTX = NULL;
+      
+      return rc;
+   }
+   
    if( ctx == NULL ) {
       // global shutdown 
       ctx = &LOGCTX;
@@ -587,6 +725,8 @@ int trace_read_arg( int argc, char** argv, int i ) {
       {"--trace-max-lines",  "IRODSFS_LOG_MAX_LINES"},
       {"--trace-methods",    "IRODSFS_LOG_METHODS"},
       {"--trace-log-dir",    "IRODSFS_LOG_DIR"},
+      {"--trace-format",     "IRODSFS_LOG_FORMAT"},
+      {"--trace-max-records", "IRODSFS_LOG_MAX_RECORDS"},
       {NULL, NULL}
    };
 
@@ -639,6 +779,13 @@ void trace_usage(void) {
 "                                  log server.  The default is " HTTP_LOG_MAX_LINES_STR,
 " ",
 " IRODSFS_LOG_DIR                  Directory in which to store log files.  The default is " LOG_PATH_DIR,
+" ",
+" IRODSFS_LOG_FORMAT               'text' for gzip'ed text logs sent to the log server (the default), or",
+"                                  'binary' for compact binary traces kept in IRODSFS_LOG_DIR.  Binary",
+"                                  traces cost far less per operation; read them with irodsFsTrace.",
+" ",
+" IRODSFS_LOG_MAX_RECORDS          The number of operations in a binary trace file before a new one is",
+"                                  started.  The default is " BINLOG_DEFAULT_MAX_RECORDS_STR,
 " "
 " IRODSFS_LOG_METHODS              Comma-separated list of which methods to log.  Valid options are "
 "                                  getattr, readlink, mknod, mkdir, unlink, rmdir, symlink, reaname, link,"
@@ -10,6 +10,15 @@
 #include "hashtable.h"
 #include "list.h"
 #include "iFuseLib.Lock.h"
+#ifdef ENABLE_READAHEAD
+#include "iFuseLib.Readahead.h"
+#endif
+#ifdef ENABLE_BLOCK_CACHE
+#include "iFuseLib.BlockCache.h"
+#endif
+#ifdef ENABLE_WRITE_BUFFER
+#include "iFuseLib.WriteBuffer.h"
+#endif
 
 fileCache_t *newFileCache(int iFd, char *objPath, char *localPath, char *cacheFilePath, time_t cachedTime, int mode, rodsLong_t fileSize, cacheState_t state) {
 	fileCache_t *fileCache = (fileCache_t *) malloc(sizeof(fileCache_t));
@@ -26,6 +35,10 @@ fileCache_t *newFileCache(int iFd, char *objPath, char *localPath, char *cacheFi
 	fileCache->state = state;
 	fileCache->status = 0;
 fileCache->offset = 0;
+    fileCache->openCount = 0;
+    fileCache->shared = 0;
+    fileCache->mtime = 0;
+    fileCache->iFuseConn = NULL;
     INIT_STRUCT_LOCK(*fileCache);
     return fileCache;
 }
@@ -42,19 +55,26 @@ pathCache_t *newPathCache (char *inPath, fileCache_t *fileCache, struct stat *st
     tmpPathCache->localPath = strdup (inPath);
     tmpPathCache->cachedTime = cachedTime;
     tmpPathCache->expired = 0;
+    tmpPathCache->hashValue = 0;
+    tmpPathCache->lruPrev = NULL;
+    tmpPathCache->lruNext = NULL;
+    tmpPathCache->pageCacheMtime = 0;
+    tmpPathCache->pageCacheSize = 0;
     REF_NO_LOCK(tmpPathCache->fileCache, fileCache);
     tmpPathCache->iFuseConn = NULL;
 	INIT_STRUCT_LOCK(*tmpPathCache);
     if (stbuf != NULL) {
     	tmpPathCache->stbuf = *stbuf;
+    	tmpPathCache->statValid = 1;
     }
     else {
     	bzero(&(tmpPathCache->stbuf), sizeof(struct stat));
+    	tmpPathCache->statValid = 0;
     }
     return tmpPathCache;
 }
 
-iFuseConn_t *newIFuseConn(int *status) {
+iFuseConn_t *newIFuseConn(struct IFuseConnPool *pool, int *status) {
     iFuseConn_t *tmpIFuseConn = (iFuseConn_t *) malloc (sizeof (iFuseConn_t));
     if (tmpIFuseConn == NULL) {
         *status = SYS_MALLOC_ERR;
@@ -64,6 +84,7 @@ iFuseConn_t *newIFuseConn(int *status) {
 
     INIT_STRUCT_LOCK(*tmpIFuseConn);
     INIT_LOCK(tmpIFuseConn->inuseLock);
+    tmpIFuseConn->pool = pool;
 
     *status = ifuseConnect (tmpIFuseConn, &MyRodsEnv);
 	/*rodsLog(LOG_ERROR, "[ NEW IFUSE CONN] %s:%d %p", __FILE__, __LINE__, tmpIFuseConn);*/
@@ -72,27 +93,27 @@ iFuseConn_t *newIFuseConn(int *status) {
 }
 /* precond: fileCache locked or single thread use */
 iFuseDesc_t *newIFuseDesc (char *objPath, char *localPath, fileCache_t *fileCache, int *status) {
-	iFuseDesc_t *desc;
-	LOCK_STRUCT(*IFuseDescFreeList);
-	/*
-	printf("******************************************************\n");
-	printf("num of desc slots free = %d\n", _listSize(IFuseDescFreeList));
-	printf("******************************************************\n"); */
-	if(_listSize(IFuseDescFreeList)!=0) {
-		ListNode *node = IFuseDescFreeList->list->head;
-		desc = (iFuseDesc_t *) node->value;
-		listRemoveNoRegion(IFuseDescFreeList->list, node);
-		UNLOCK_STRUCT(*IFuseDescFreeList);
+	iFuseDesc_t *desc = allocIFuseDesc();
+	if(desc != NULL) {
         REF_NO_LOCK(desc->fileCache, fileCache);
+        if(fileCache != NULL) {
+            fileCache->openCount++;
+        }
 		desc->objPath = strdup (objPath);
 		desc->localPath = strdup (localPath);
 		desc->offset = 0;
+		desc->readahead = NULL;
+		desc->blockCache = NULL;
+		desc->writeBuffer = NULL;
+		desc->nextReadOffset = 0;
+		desc->seqReads = 0;
+		desc->randomReads = 0;
+		desc->streaming = 0;
         INIT_STRUCT_LOCK(*desc);
         *status = 0;
         return desc;
     }
     else {
-		UNLOCK_STRUCT(*IFuseDescFreeList);
 		rodsLog (LOG_ERROR,
 		  "allocIFuseDesc: Out of iFuseDesc");
 		*status = SYS_OUT_OF_FILE_DESC;
@@ -102,6 +123,7 @@ iFuseDesc_t *newIFuseDesc (char *objPath, char *localPath, fileCache_t *fileCach
 }
 
 int _freeFileCache(fileCache_t *fileCache) {
+	setFileCacheConn(fileCache, NULL);
 	free(fileCache->fileCachePath);
 	free(fileCache->localPath);
 	free(fileCache->objPath);
@@ -116,6 +138,9 @@ int _freePathCache( pathCache_t *tmpPathCache ) {
     if(tmpPathCache->fileCache != NULL) {
     	UNREF(tmpPathCache->fileCache, FileCache);
     }
+    if(tmpPathCache->iFuseConn != NULL) {
+    	unrefIFuseConn(tmpPathCache->iFuseConn);
+    }
     FREE_STRUCT_LOCK(*tmpPathCache);
     free (tmpPathCache);
     return 0;
@@ -140,13 +165,28 @@ int _freeIFuseDesc( iFuseDesc_t *desc ) {
 
 	free (desc->localPath);
 
+#ifdef ENABLE_WRITE_BUFFER
+	/* flushed by ifuseClose, must go before the fileCache it writes to */
+	if (desc->writeBuffer != NULL) {
+		closeWriteBuffer (desc->writeBuffer);
+		desc->writeBuffer = NULL;
+	}
+#endif
+
 	UNREF(desc->fileCache, FileCache);
 
-	addToConcurrentList(IFuseDescFreeList, desc);
-	/*
-	printf("@@@@@@@@@@@@@@@@@@@@@@@@@@@@@@@@@@@@@@@@@@@@@@@@@@@@@@\n");
-	printf("num of desc slots free = %d\n", listSize(IFuseDescFreeList));
-	printf("@@@@@@@@@@@@@@@@@@@@@@@@@@@@@@@@@@@@@@@@@@@@@@@@@@@@@@\n");*/
+#ifdef ENABLE_READAHEAD
+	if (desc->readahead != NULL) {
+		closeReadahead (desc->readahead);
+		desc->readahead = NULL;
+	}
+#endif
+#ifdef ENABLE_BLOCK_CACHE
+	if (desc->blockCache != NULL) {
+		closeBlockCache (desc->blockCache);
+		desc->blockCache = NULL;
+	}
+#endif
 
 	return 0;
 
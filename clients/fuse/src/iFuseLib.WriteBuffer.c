@@ -0,0 +1,488 @@
+/*** For more information please refer to files in the COPYRIGHT directory ***/
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <errno.h>
+#include <time.h>
+#include <assert.h>
+#include <pthread.h>
+#include "irodsFs.h"
+#include "iFuseLib.h"
+#include "iFuseOper.h"
+#include "list.h"
+#include "iFuseLib.WriteBuffer.h"
+#include "iFuseLib.Lock.h"
+
+/**************************************************************************
+ * global variables
+ **************************************************************************/
+static writeBufferConfig_t WriteBufferConfig;
+static writeBufferStats_t WriteBufferStats;
+
+/* protects WriteBufferList, the refCount of buffers and WriteBufferStats.
+ * lock order: writeBuffer_t lock first, then WriteBufferLock */
+static pthread_mutex_t WriteBufferLock;
+static pthread_cond_t WriteBufferCond;
+static List *WriteBufferList;           /* opened buffers */
+static int WriteBufferRunning = 0;
+static pthread_t WriteBufferFlusher;
+static int WriteBufferHasFlusher = 0;
+
+/**************************************************************************
+ * function definitions
+ **************************************************************************/
+static void *_writeBufferFlusher(void *arg);
+static int _flushBuffer(writeBuffer_t *writeBuffer);
+static int _sendToServer(writeBuffer_t *writeBuffer, char *buf, rodsLong_t size, rodsLong_t offset);
+static int _takeError(writeBuffer_t *writeBuffer);
+static void _releaseBuffer(writeBuffer_t *writeBuffer);
+static void _freeBuffer(writeBuffer_t *writeBuffer);
+
+/**************************************************************************
+ * public functions
+ **************************************************************************/
+int
+initWriteBuffer (writeBufferConfig_t *writeBufferConfig) {
+    int status;
+
+    rodsLog (LOG_DEBUG, "initWriteBuffer: MyWriteBufferConfig.writeBuffer = %d", writeBufferConfig->writeBuffer);
+    rodsLog (LOG_DEBUG, "initWriteBuffer: MyWriteBufferConfig.bufferSize = %lld", writeBufferConfig->bufferSize);
+    rodsLog (LOG_DEBUG, "initWriteBuffer: MyWriteBufferConfig.flushInterval = %d", writeBufferConfig->flushInterval);
+
+    // copy given configuration
+    memcpy(&WriteBufferConfig, writeBufferConfig, sizeof(writeBufferConfig_t));
+    bzero(&WriteBufferStats, sizeof(writeBufferStats_t));
+
+    if(WriteBufferConfig.writeBuffer == 0) {
+        return (0);
+    }
+
+    WriteBufferList = newListNoRegion();
+
+    // init lock
+    pthread_mutex_init(&WriteBufferLock, NULL);
+    pthread_cond_init(&WriteBufferCond, NULL);
+
+    // start the flusher of idle buffers
+    WriteBufferRunning = 1;
+    status = pthread_create(&WriteBufferFlusher, NULL, _writeBufferFlusher, NULL);
+    if(status != 0) {
+        // buffers are still flushed when full or synced
+        rodsLog (LOG_ERROR, "initWriteBuffer: pthread_create failure, status = %d", status);
+    } else {
+        WriteBufferHasFlusher = 1;
+    }
+    return (0);
+}
+
+int
+uninitWriteBuffer (writeBufferConfig_t *writeBufferConfig) {
+    writeBufferStats_t stats;
+
+    if(WriteBufferConfig.writeBuffer == 0) {
+        return (0);
+    }
+
+    pthread_mutex_lock(&WriteBufferLock);
+    WriteBufferRunning = 0;
+    pthread_cond_broadcast(&WriteBufferCond);
+    pthread_mutex_unlock(&WriteBufferLock);
+
+    if(WriteBufferHasFlusher) {
+        pthread_join(WriteBufferFlusher, NULL);
+        WriteBufferHasFlusher = 0;
+    }
+
+    getWriteBufferStats(&stats);
+    rodsLog (LOG_NOTICE, "write buffer: %lld writes (%lld bytes) sent as %lld requests (%lld bytes), %.1f writes per request, %lld bypassed",
+        stats.writes, stats.writtenBytes, stats.requests, stats.sentBytes,
+        stats.requests > 0 ? (double)stats.writes / stats.requests : 0.0, stats.bypassed);
+    rodsLog (LOG_NOTICE, "write buffer flushes: %lld full, %lld seek, %lld time, %lld sync",
+        stats.sizeFlushes, stats.seekFlushes, stats.timeFlushes, stats.syncFlushes);
+
+    deleteListNoRegion(WriteBufferList);
+    pthread_cond_destroy(&WriteBufferCond);
+    pthread_mutex_destroy(&WriteBufferLock);
+    return (0);
+}
+
+int
+isWriteBufferEnabled () {
+    // check whether write buffer is enabled
+    if(WriteBufferConfig.writeBuffer == 0) {
+        return -1;
+    }
+    return 0;
+}
+
+writeBuffer_t *
+openWriteBuffer (const char *localPath, fileCache_t *fileCache) {
+    writeBuffer_t *writeBuffer;
+
+    if(localPath == NULL || fileCache == NULL) {
+        return NULL;
+    }
+
+    writeBuffer = (writeBuffer_t *)malloc(sizeof(writeBuffer_t));
+    if(writeBuffer == NULL) {
+        return NULL;
+    }
+
+    bzero(writeBuffer, sizeof(writeBuffer_t));
+    // allocated on the first write, many write opens never write
+    writeBuffer->localPath = strdup(localPath);
+    writeBuffer->fileCache = fileCache;
+    writeBuffer->refCount = 1;
+    pthread_mutex_init(&writeBuffer->lock, NULL);
+
+    pthread_mutex_lock(&WriteBufferLock);
+    listAppendNoRegion(WriteBufferList, writeBuffer);
+    pthread_mutex_unlock(&WriteBufferLock);
+    return writeBuffer;
+}
+
+/*
+ * buffer a write. returns size, or an error of this write or of an
+ * earlier background flush.
+ */
+int
+writeWriteBuffer (writeBuffer_t *writeBuffer, char *buf, size_t size, off_t offset) {
+    int status;
+    rodsLong_t start;
+    rodsLong_t end;
+
+    pthread_mutex_lock(&writeBuffer->lock);
+
+    if((status = _takeError(writeBuffer)) < 0) {
+        pthread_mutex_unlock(&writeBuffer->lock);
+        return status;
+    }
+
+    pthread_mutex_lock(&WriteBufferLock);
+    WriteBufferStats.writes++;
+    WriteBufferStats.writtenBytes += size;
+    pthread_mutex_unlock(&WriteBufferLock);
+
+    if((rodsLong_t)size >= WriteBufferConfig.bufferSize) {
+        // nothing to gain, keep the order and send it as is
+        status = _flushBuffer(writeBuffer);
+        if(status >= 0) {
+            status = _sendToServer(writeBuffer, buf, size, offset);
+        }
+        pthread_mutex_lock(&WriteBufferLock);
+        WriteBufferStats.bypassed++;
+        pthread_mutex_unlock(&WriteBufferLock);
+        pthread_mutex_unlock(&writeBuffer->lock);
+        return status < 0 ? status : (int)size;
+    }
+
+    if(writeBuffer->buf == NULL) {
+        writeBuffer->buf = (char *)malloc(WriteBufferConfig.bufferSize);
+        if(writeBuffer->buf == NULL) {
+            status = _sendToServer(writeBuffer, buf, size, offset);
+            pthread_mutex_unlock(&writeBuffer->lock);
+            return status < 0 ? status : (int)size;
+        }
+    }
+
+    if(writeBuffer->len > 0) {
+        // merge if the write touches the dirty range and the result fits
+        start = offset < writeBuffer->offset ? offset : writeBuffer->offset;
+        end = (rodsLong_t)(offset + size) > writeBuffer->offset + writeBuffer->len ? offset + size : writeBuffer->offset + writeBuffer->len;
+        if(offset > writeBuffer->offset + writeBuffer->len || (rodsLong_t)(offset + size) < writeBuffer->offset || end - start > WriteBufferConfig.bufferSize) {
+            status = _flushBuffer(writeBuffer);
+            pthread_mutex_lock(&WriteBufferLock);
+            WriteBufferStats.seekFlushes++;
+            pthread_mutex_unlock(&WriteBufferLock);
+            if(status < 0) {
+                pthread_mutex_unlock(&writeBuffer->lock);
+                return status;
+            }
+        } else if(start < writeBuffer->offset) {
+            // the write extends the range backward
+            memmove(writeBuffer->buf + (writeBuffer->offset - start), writeBuffer->buf, writeBuffer->len);
+            writeBuffer->len += writeBuffer->offset - start;
+            writeBuffer->offset = start;
+        }
+    }
+
+    if(writeBuffer->len == 0) {
+        writeBuffer->offset = offset;
+        writeBuffer->dirtySince = time(NULL);
+    }
+
+    // later data wins where writes overlap
+    memcpy(writeBuffer->buf + (offset - writeBuffer->offset), buf, size);
+    if((rodsLong_t)(offset + size) - writeBuffer->offset > writeBuffer->len) {
+        writeBuffer->len = offset + size - writeBuffer->offset;
+    }
+
+    // getattr on the open file reports the size including buffered data
+    LOCK_STRUCT(*writeBuffer->fileCache);
+    if(writeBuffer->fileCache->fileSize < (rodsLong_t)(offset + size)) {
+        writeBuffer->fileCache->fileSize = offset + size;
+    }
+    UNLOCK_STRUCT(*writeBuffer->fileCache);
+
+    if(writeBuffer->len >= WriteBufferConfig.bufferSize) {
+        status = _flushBuffer(writeBuffer);
+        pthread_mutex_lock(&WriteBufferLock);
+        WriteBufferStats.sizeFlushes++;
+        pthread_mutex_unlock(&WriteBufferLock);
+        if(status < 0) {
+            pthread_mutex_unlock(&writeBuffer->lock);
+            return status;
+        }
+    }
+
+    pthread_mutex_unlock(&writeBuffer->lock);
+    return (int)size;
+}
+
+/* send buffered data, returns an error of this or an earlier flush */
+int
+flushWriteBuffer (writeBuffer_t *writeBuffer) {
+    int status;
+
+    if(writeBuffer == NULL) {
+        return 0;
+    }
+
+    pthread_mutex_lock(&writeBuffer->lock);
+    if(writeBuffer->len > 0) {
+        pthread_mutex_lock(&WriteBufferLock);
+        WriteBufferStats.syncFlushes++;
+        pthread_mutex_unlock(&WriteBufferLock);
+    }
+    status = _flushBuffer(writeBuffer);
+    if(status >= 0) {
+        status = _takeError(writeBuffer);
+    }
+    pthread_mutex_unlock(&writeBuffer->lock);
+    return status;
+}
+
+/* flush the buffers of all descriptors of a file, before it is changed by path */
+int
+flushWriteBuffersForPath (const char *localPath) {
+    List *matched;
+    ListNode *node;
+    int status = 0;
+
+    if(WriteBufferConfig.writeBuffer == 0 || localPath == NULL) {
+        return 0;
+    }
+
+    matched = newListNoRegion();
+
+    pthread_mutex_lock(&WriteBufferLock);
+    for(node = WriteBufferList->head; node != NULL; node = node->next) {
+        writeBuffer_t *writeBuffer = (writeBuffer_t *)node->value;
+        if(strcmp(writeBuffer->localPath, localPath) == 0) {
+            writeBuffer->refCount++;
+            listAppendNoRegion(matched, writeBuffer);
+        }
+    }
+    pthread_mutex_unlock(&WriteBufferLock);
+
+    for(node = matched->head; node != NULL; node = node->next) {
+        writeBuffer_t *writeBuffer = (writeBuffer_t *)node->value;
+        int flushStatus;
+
+        pthread_mutex_lock(&writeBuffer->lock);
+        if(!writeBuffer->closed && writeBuffer->len > 0) {
+            pthread_mutex_lock(&WriteBufferLock);
+            WriteBufferStats.syncFlushes++;
+            pthread_mutex_unlock(&WriteBufferLock);
+
+            flushStatus = _flushBuffer(writeBuffer);
+            if(flushStatus < 0) {
+                // the owner of the descriptor hears about it too
+                writeBuffer->error = flushStatus;
+                status = flushStatus;
+            }
+        }
+        pthread_mutex_unlock(&writeBuffer->lock);
+        _releaseBuffer(writeBuffer);
+    }
+
+    deleteListNoRegion(matched);
+    return status;
+}
+
+/* the caller flushed the buffer already, what is left is dropped */
+int
+closeWriteBuffer (writeBuffer_t *writeBuffer) {
+    if(writeBuffer == NULL) {
+        return 0;
+    }
+
+    pthread_mutex_lock(&writeBuffer->lock);
+    if(writeBuffer->len > 0) {
+        rodsLog (LOG_ERROR, "closeWriteBuffer: dropping %lld unflushed bytes of %s", writeBuffer->len, writeBuffer->localPath);
+        writeBuffer->len = 0;
+    }
+    writeBuffer->closed = 1;
+    pthread_mutex_unlock(&writeBuffer->lock);
+
+    pthread_mutex_lock(&WriteBufferLock);
+    listRemoveNoRegion2(WriteBufferList, writeBuffer);
+    pthread_mutex_unlock(&WriteBufferLock);
+
+    _releaseBuffer(writeBuffer);
+    return 0;
+}
+
+int
+getWriteBufferStats (writeBufferStats_t *stats) {
+    if(stats == NULL) {
+        return SYS_INTERNAL_NULL_INPUT_ERR;
+    }
+
+    if(WriteBufferConfig.writeBuffer == 0) {
+        memcpy(stats, &WriteBufferStats, sizeof(writeBufferStats_t));
+        return 0;
+    }
+
+    pthread_mutex_lock(&WriteBufferLock);
+    memcpy(stats, &WriteBufferStats, sizeof(writeBufferStats_t));
+    pthread_mutex_unlock(&WriteBufferLock);
+    return 0;
+}
+
+/**************************************************************************
+ * private functions
+ **************************************************************************/
+static void *
+_writeBufferFlusher(void *arg) {
+    struct timespec timeout;
+    List *due;
+    ListNode *node;
+
+    due = newListNoRegion();
+
+    pthread_mutex_lock(&WriteBufferLock);
+    while(WriteBufferRunning) {
+        time_t now;
+
+        bzero(&timeout, sizeof(timeout));
+        timeout.tv_sec = time(0) + 1;
+        pthread_cond_timedwait(&WriteBufferCond, &WriteBufferLock, &timeout);
+        if(!WriteBufferRunning) {
+            break;
+        }
+
+        // dirtySince is read unlocked, a stale value only delays the flush
+        now = time(NULL);
+        for(node = WriteBufferList->head; node != NULL; node = node->next) {
+            writeBuffer_t *writeBuffer = (writeBuffer_t *)node->value;
+            if(writeBuffer->len > 0 && now - writeBuffer->dirtySince >= WriteBufferConfig.flushInterval) {
+                writeBuffer->refCount++;
+                listAppendNoRegion(due, writeBuffer);
+            }
+        }
+        pthread_mutex_unlock(&WriteBufferLock);
+
+        while(due->head != NULL) {
+            writeBuffer_t *writeBuffer = (writeBuffer_t *)due->head->value;
+            listRemoveNoRegion(due, due->head);
+
+            pthread_mutex_lock(&writeBuffer->lock);
+            if(!writeBuffer->closed && writeBuffer->len > 0 && now - writeBuffer->dirtySince >= WriteBufferConfig.flushInterval) {
+                int status;
+
+                pthread_mutex_lock(&WriteBufferLock);
+                WriteBufferStats.timeFlushes++;
+                pthread_mutex_unlock(&WriteBufferLock);
+
+                status = _flushBuffer(writeBuffer);
+                if(status < 0) {
+                    rodsLog (LOG_DEBUG, "_writeBufferFlusher: flush of %s failed, status = %d", writeBuffer->localPath, status);
+                    writeBuffer->error = status;
+                }
+            }
+            pthread_mutex_unlock(&writeBuffer->lock);
+            _releaseBuffer(writeBuffer);
+        }
+
+        pthread_mutex_lock(&WriteBufferLock);
+    }
+    pthread_mutex_unlock(&WriteBufferLock);
+
+    deleteListNoRegion(due);
+    return NULL;
+}
+
+/* precond: lock writeBuffer.
+ * the dirty range is dropped even if sending it fails, the error is returned */
+static int
+_flushBuffer(writeBuffer_t *writeBuffer) {
+    int status;
+
+    if(writeBuffer->len == 0) {
+        return 0;
+    }
+
+    status = _sendToServer(writeBuffer, writeBuffer->buf, writeBuffer->len, writeBuffer->offset);
+    writeBuffer->len = 0;
+    return status;
+}
+
+/* precond: lock writeBuffer */
+static int
+_sendToServer(writeBuffer_t *writeBuffer, char *buf, rodsLong_t size, rodsLong_t offset) {
+    rodsLong_t sent = 0;
+    rodsLong_t requests = 0;
+    int status = 0;
+
+    while(sent < size) {
+        status = ifuseFileCacheWrite(writeBuffer->fileCache, buf + sent, size - sent, offset + sent);
+        if(status <= 0) {
+            rodsLog (LOG_ERROR, "_sendToServer: write of %s at %lld failed, status = %d", writeBuffer->localPath, offset + sent, status);
+            if(status == 0) {
+                status = -EIO;
+            }
+            break;
+        }
+        sent += status;
+        requests++;
+    }
+
+    pthread_mutex_lock(&WriteBufferLock);
+    WriteBufferStats.requests += requests;
+    WriteBufferStats.sentBytes += sent;
+    pthread_mutex_unlock(&WriteBufferLock);
+
+    return status < 0 ? status : 0;
+}
+
+/* precond: lock writeBuffer */
+static int
+_takeError(writeBuffer_t *writeBuffer) {
+    int status = writeBuffer->error;
+    writeBuffer->error = 0;
+    return status;
+}
+
+static void
+_releaseBuffer(writeBuffer_t *writeBuffer) {
+    int refCount;
+
+    pthread_mutex_lock(&WriteBufferLock);
+    refCount = --writeBuffer->refCount;
+    pthread_mutex_unlock(&WriteBufferLock);
+
+    if(refCount == 0) {
+        _freeBuffer(writeBuffer);
+    }
+}
+
+static void
+_freeBuffer(writeBuffer_t *writeBuffer) {
+    pthread_mutex_destroy(&writeBuffer->lock);
+    if(writeBuffer->buf != NULL) {
+        free(writeBuffer->buf);
+    }
+    free(writeBuffer->localPath);
+    free(writeBuffer);
+}
@@ -209,7 +209,9 @@ dataObjCreateByFusePath( rcComm_t *conn, int mode,
 int
 renmeLocalPath( PathCacheTable *pctable, char *from, char *to, char *toIrodsPath ) {
     pathCache_t *fromPathCache = NULL;
-    pathCache_t *tmpPathCache = NULL;
+    fileCache_t *fileCache = NULL;
+    struct stat stbuf;
+    int statValid;
 
     /* do not check existing path here as path cache may be out of date */
     matchAndLockPathCache(pctable, from, &fromPathCache);
@@ -217,28 +219,26 @@ renmeLocalPath( PathCacheTable *pctable, char *from, char *to, char *toIrodsPath
     	return 0;
     }
 
-	LOCK(*pctable->PathCacheLock);
 	if(fromPathCache->fileCache != NULL) {
 		LOCK_STRUCT(*(fromPathCache->fileCache));
 		free(fromPathCache->fileCache->localPath);
 		fromPathCache->fileCache->localPath = strdup(to);
 		free(fromPathCache->fileCache->objPath);
 		fromPathCache->fileCache->objPath=strdup(toIrodsPath);
-
-		_pathReplace(pctable, (char *) to, fromPathCache->fileCache, &fromPathCache->stbuf, &tmpPathCache);
-
 		UNLOCK_STRUCT(*(fromPathCache->fileCache));
     }
-    else {
-        _pathReplace(pctable, (char *) to, NULL /* fromPathCache->fileCache */, &fromPathCache->stbuf, &tmpPathCache);
+	/* keep the file cache alive while the from entry is dropped */
+	REF(fileCache, fromPathCache->fileCache);
+	stbuf = fromPathCache->stbuf;
+	statValid = fromPathCache->statValid;
 
-	}
+	/* the cache shards must not be taken while an entry is locked */
+	UNLOCK_STRUCT(*fromPathCache);
 
-	/* need to unlock fileCache here since the following function call ness to lock fileCache */
-	_pathNotExist(pctable, (char *) from);
+	pathReplace(pctable, (char *) to, fileCache, statValid ? &stbuf : NULL, NULL);
+	pathNotExist(pctable, (char *) from);
 
-	UNLOCK_STRUCT(*fromPathCache);
-	UNLOCK(*pctable->PathCacheLock);
+	UNREF(fileCache, FileCache);
 	return 0;
 }
 
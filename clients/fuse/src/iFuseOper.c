@@ -10,6 +10,7 @@
 #include "iFuseOper.h"
 #include "miscUtil.h"
 #include "iFuseLib.h"
+#include "iFuseLib.DirCache.h"
 
 #ifdef ENABLE_PRELOAD
 #include "iFuseLib.Preload.h"
@@ -19,7 +20,32 @@
 #include "iFuseLib.LazyUpload.h"
 #endif
 
-PathCacheTable *pctable = initPathCache();
+#ifdef ENABLE_READAHEAD
+#include "iFuseLib.Readahead.h"
+#endif
+
+#ifdef ENABLE_BLOCK_CACHE
+#include "iFuseLib.BlockCache.h"
+#endif
+
+#ifdef ENABLE_WRITE_BUFFER
+#include "iFuseLib.WriteBuffer.h"
+#endif
+
+#ifdef ENABLE_STAT_BATCH
+#include "iFuseLib.StatBatch.h"
+#endif
+
+#ifdef ENABLE_META_STORE
+#include "iFuseLib.MetaStore.h"
+
+static int _lookupMetaStore (const char *path, struct stat *stbuf);
+static time_t _getCachedMtime (const char *path);
+static void _getParentPath (const char *path, char *parentPath);
+#endif
+
+/* created in main once the path cache options are parsed */
+PathCacheTable *pctable = NULL;
 
 int
 irodsGetattr( const char *path, struct stat *stbuf ) {
@@ -31,10 +57,10 @@ irodsGetattr( const char *path, struct stat *stbuf ) {
 
 #ifdef CACHE_FUSE_PATH
 
-    /*if (lookupPathNotExist( (char *) path) == 1) {
+    if (lookupPathNotExist(pctable, (char *) path) == 1) {
         rodsLog (LOG_DEBUG, "irodsGetattr: a match for non existing path %s", path);
         return -ENOENT;
-    }*/
+    }
 
     if (matchAndLockPathCache(pctable, (char *) path, &tmpPathCache) == 1) {
         rodsLog (LOG_DEBUG, "irodsGetattr: a match for path %s", path);
@@ -52,27 +78,71 @@ irodsGetattr( const char *path, struct stat *stbuf ) {
                     return 0;
                 }
             }
-            else {
+            else if (tmpPathCache->statValid) {
+                /* the size of an open file moves with its writes */
+                *stbuf = tmpPathCache->stbuf;
+                stbuf->st_size = tmpPathCache->fileCache->fileSize;
         		UNLOCK_STRUCT(*(tmpPathCache->fileCache));
                 UNLOCK_STRUCT(*tmpPathCache);
+                return 0;
         	}
+            else {
+        		UNLOCK_STRUCT(*(tmpPathCache->fileCache));
+                UNLOCK_STRUCT(*tmpPathCache);
+            }
         }
-        else {
+        else if (tmpPathCache->statValid) {
+            /* e.g. primed by irodsReaddir */
+            *stbuf = tmpPathCache->stbuf;
 	        UNLOCK_STRUCT(*tmpPathCache);
+            return 0;
 		}
+        else {
+            /* only keeps the conn of the path */
+	        UNLOCK_STRUCT(*tmpPathCache);
+        }
     }
 #endif
-    iFuseConn = getAndUseConnByPath( ( char * ) path, &status );
-    status = _irodsGetattr(iFuseConn, path, stbuf);
-    unuseIFuseConn(iFuseConn);
+#ifdef ENABLE_META_STORE
+    if (isMetaStoreEnabled() == 0 && _lookupMetaStore (path, stbuf) == 0) {
+        rodsLog (LOG_DEBUG, "irodsGetattr: a stored match for path %s", path);
+#ifdef CACHE_FUSE_PATH
+        pathExist(pctable, (char *) path, NULL, stbuf, &tmpPathCache);
+#endif
+        return 0;
+    }
+#endif
+#ifdef ENABLE_STAT_BATCH
+    /* misses of siblings at the same time go to the server together */
+    status = isStatBatchEnabled() == 0 ? statInBatch (path, stbuf) : STAT_BATCH_NOT_BATCHED;
+    if (status == STAT_BATCH_NOT_BATCHED)
+#endif
+    {
+        iFuseConn = getAndUseConnByPath( ( char * ) path, &status );
+        status = _irodsGetattr(iFuseConn, path, stbuf);
+        unuseIFuseConn(iFuseConn);
+    }
 #ifdef CACHE_FUSE_PATH
 	if (status == -ENOENT ) {
         pathNotExist(pctable, (char *) path);
-	} else {		
+	} else if (status == 0) {
 		/* don't set file cache */
 		pathExist(pctable, (char *) path, NULL, stbuf, &tmpPathCache);
 	}
 #endif
+#ifdef ENABLE_META_STORE
+    if (isMetaStoreEnabled() == 0) {
+        char parentPath[MAX_NAME_LEN];
+
+        if (status == 0) {
+            _getParentPath (path, parentPath);
+            putMetaStore (path, stbuf, _getCachedMtime (parentPath));
+        }
+        else if (status == -ENOENT) {
+            removeMetaStore (path);
+        }
+    }
+#endif
 
     return status;
 }
@@ -101,11 +171,19 @@ _irodsGetattr( iFuseConn_t *iFuseConn, const char *path, struct stat *stbuf ) {
             status = rcObjStat (iFuseConn->conn, &dataObjInp, &rodsObjStatOut);
         }
         if (status < 0) {
-            if (status != USER_FILE_DOES_NOT_EXIST) {
-                rodsLogError (LOG_ERROR, status,
-                        "irodsGetattr: rcObjStat of %s error", path);
+            if (status == USER_FILE_DOES_NOT_EXIST || status == CAT_NO_ROWS_FOUND) {
+                return -ENOENT;
             }
-            return -ENOENT;
+            rodsLogError (LOG_ERROR, status,
+                    "irodsGetattr: rcObjStat of %s error", path);
+            /* not ENOENT, the callers cache that as a missing path */
+            if (isReadMsgError (status)) {
+                return -ENOTCONN;
+            }
+            if (status == CAT_NO_ACCESS_PERMISSION) {
+                return -EACCES;
+            }
+            return -EIO;
         }
     }
 
@@ -206,9 +284,21 @@ irodsReaddir (const char *path, void *buf, fuse_fill_dir_t filler,
     collHandle_t collHandle;
     collEnt_t collEnt;
     int status;
+    dirCache_t *dirCache;
+    dirCacheEntry_t *entries = NULL;
+    int numEntries = 0;
+    int maxEntries = 0;
+    unsigned long generation;
+    int i;
 #ifdef CACHE_FUSE_PATH
-    struct stat stbuf;
-    pathCache_t *tmpPathCache;
+    /* one listing page, inserted into the path cache at once */
+    char *childPaths[MAX_SQL_ROWS];
+    struct stat childStbufs[MAX_SQL_ROWS];
+    int numChildren = 0;
+#ifdef ENABLE_META_STORE
+    /* entries are stored along with the mtime of the collection */
+    time_t collMtime = _getCachedMtime (path);
+#endif
 #endif
     /* don't know why we need this. the example have them */
     (void) offset;
@@ -220,6 +310,16 @@ irodsReaddir (const char *path, void *buf, fuse_fill_dir_t filler,
     filler(buf, ".", NULL, 0);
     filler(buf, "..", NULL, 0);
 
+    dirCache = lookupDirCache (path);
+    if (dirCache != NULL) {
+        rodsLog (LOG_DEBUG, "irodsReaddir: a match for %s", path);
+        for (i = 0; i < dirCache->numEntries; i++) {
+            filler (buf, dirCache->entries[i].name, &dirCache->entries[i].stbuf, 0);
+        }
+        releaseDirCache (dirCache);
+        return 0;
+    }
+
     status = parseRodsPathStr ((char *) (path + 1), &MyRodsEnv, collPath);
     if (status < 0) {
         rodsLogError (LOG_ERROR, status,
@@ -228,6 +328,8 @@ irodsReaddir (const char *path, void *buf, fuse_fill_dir_t filler,
         return -ENOTDIR;
     }
 
+    generation = getDirCacheGeneration ();
+
     iFuseConn = getAndUseConnByPath( ( char * ) path, &status );
     status = rclOpenCollection (iFuseConn->conn, collPath, 0, &collHandle);
 
@@ -248,53 +350,101 @@ irodsReaddir (const char *path, void *buf, fuse_fill_dir_t filler,
     while ((status = rclReadCollection (iFuseConn->conn, &collHandle, &collEnt))
       >= 0) {
     char myDir[MAX_NAME_LEN], mySubDir[MAX_NAME_LEN];
-#ifdef CACHE_FUSE_PATH
-    char childPath[MAX_NAME_LEN];
+    char *name;
+    struct stat stbuf;
 
     bzero (&stbuf, sizeof (struct stat));
-#endif
         if (collEnt.objType == DATA_OBJ_T) {
-            filler (buf, collEnt.dataName, NULL, 0);
-#ifdef CACHE_FUSE_PATH
-            if (strcmp (path, "/") == 0) {
-                snprintf (childPath, MAX_NAME_LEN, "/%s", collEnt.dataName);
-            }
-            else {
-                snprintf (childPath, MAX_NAME_LEN, "%s/%s",
-          path, collEnt.dataName);
-            }
-            if (lookupPathExist (pctable, (char *) childPath, &tmpPathCache) != 1) {
-                fillFileStat (&stbuf, collEnt.dataMode, collEnt.dataSize,
-              atoi (collEnt.createTime), atoi (collEnt.modifyTime),
-              atoi (collEnt.modifyTime));
-                pathExist (pctable, childPath, NULL, &stbuf, &tmpPathCache);
-            }
-#endif
+            name = collEnt.dataName;
+            fillFileStat (&stbuf, collEnt.dataMode, collEnt.dataSize,
+          atoi (collEnt.createTime), atoi (collEnt.modifyTime),
+          atoi (collEnt.modifyTime));
         }
         else if ( collEnt.objType == COLL_OBJ_T ) {
             splitPathByKey( collEnt.collName, myDir, mySubDir, '/' );
-	if(mySubDir[0] != '\0') {
-        filler (buf, mySubDir, NULL, 0);
-#ifdef CACHE_FUSE_PATH
-            if (strcmp (path, "/") == 0) {
-                snprintf (childPath, MAX_NAME_LEN, "/%s", mySubDir);
+            if(mySubDir[0] == '\0') {
+                continue;
+            }
+            name = mySubDir;
+            fillDirStat (&stbuf,
+          atoi (collEnt.createTime), atoi (collEnt.modifyTime),
+          atoi (collEnt.modifyTime));
+        }
+        else {
+            continue;
+        }
+
+        /* the stat spares the kernel a lookup of the type */
+        filler (buf, name, &stbuf, 0);
+
+        if (isDirCacheEnabled () == 0 && numEntries >= 0) {
+            if (numEntries == maxEntries) {
+                dirCacheEntry_t *moreEntries;
+                maxEntries = maxEntries == 0 ? MAX_SQL_ROWS : maxEntries * 2;
+                moreEntries = (dirCacheEntry_t *) realloc (entries, sizeof (dirCacheEntry_t) * maxEntries);
+                if (moreEntries == NULL) {
+                    /* list the rest without caching it */
+                    freeDirCacheEntries (entries, numEntries);
+                    entries = NULL;
+                    numEntries = -1;
                 }
                 else {
-            snprintf (childPath, MAX_NAME_LEN, "%s/%s", path, mySubDir);
+                    entries = moreEntries;
+                }
+            }
+            if (entries != NULL) {
+                entries[numEntries].name = strdup (name);
+                entries[numEntries].stbuf = stbuf;
+                numEntries++;
+            }
         }
-        if (lookupPathExist (pctable, (char *) childPath, &tmpPathCache) != 1) {
-            fillDirStat (&stbuf,
-              atoi (collEnt.createTime), atoi (collEnt.modifyTime),
-              atoi (collEnt.modifyTime));
-            pathExist (pctable, childPath, NULL, &stbuf, &tmpPathCache);
+#ifdef CACHE_FUSE_PATH
+        childPaths[numChildren] = (char *) malloc (MAX_NAME_LEN);
+        if (strcmp (path, "/") == 0) {
+            snprintf (childPaths[numChildren], MAX_NAME_LEN, "/%s", name);
         }
+        else {
+            snprintf (childPaths[numChildren], MAX_NAME_LEN, "%s/%s", path, name);
+        }
+        childStbufs[numChildren] = stbuf;
+        numChildren++;
+        if (numChildren == MAX_SQL_ROWS) {
+            pathExistBatch (pctable, childPaths, childStbufs, numChildren);
+#ifdef ENABLE_META_STORE
+            for (i = 0; i < numChildren && isMetaStoreEnabled() == 0; i++) {
+                putMetaStore (childPaths[i], &childStbufs[i], collMtime);
+            }
 #endif
-	}
+            for (i = 0; i < numChildren; i++) {
+                free (childPaths[i]);
+            }
+            numChildren = 0;
         }
+#endif
     }
     rclCloseCollection (&collHandle);
     unuseIFuseConn (iFuseConn);
 
+#ifdef CACHE_FUSE_PATH
+    pathExistBatch (pctable, childPaths, childStbufs, numChildren);
+#ifdef ENABLE_META_STORE
+    for (i = 0; i < numChildren && isMetaStoreEnabled() == 0; i++) {
+        putMetaStore (childPaths[i], &childStbufs[i], collMtime);
+    }
+#endif
+    for (i = 0; i < numChildren; i++) {
+        free (childPaths[i]);
+    }
+#endif
+
+    if (status == CAT_NO_ROWS_FOUND && numEntries >= 0) {
+        /* the listing is complete */
+        addDirCache (path, entries, numEntries, generation);
+    }
+    else if (numEntries > 0) {
+        freeDirCacheEntries (entries, numEntries);
+    }
+
     return 0;
 }
 
@@ -365,6 +515,7 @@ irodsMknod( const char *path, mode_t mode, dev_t ) {
     fileCache = addFileCache(localFd, objPath, (char *) path, cachePath, mode, 0, HAVE_NEWLY_CREATED_CACHE);
     stbuf.st_mode = mode;
     pathExist (pctable, (char *) path, fileCache, &stbuf, &tmpPathCache);
+    invalidateDirCacheOfParent (path);
 
     unuseIFuseConn (iFuseConn);
 
@@ -374,6 +525,12 @@ irodsMknod( const char *path, mode_t mode, dev_t ) {
         invalidatePreloadedFile(path);
     }
 #endif
+#ifdef ENABLE_BLOCK_CACHE
+    invalidateBlockCache(path);
+#endif
+#ifdef ENABLE_META_STORE
+    removeMetaStore (path);
+#endif
 #ifdef ENABLE_LAZY_UPLOAD
     // lazy upload starts
     if (isLazyUploadEnabled() == 0) {
@@ -421,6 +578,11 @@ irodsMkdir( const char *path, mode_t ) {
     if (status < 0) {
             rodsLogError (LOG_ERROR, status,
               "irodsMkdir: rcCollCreate of %s error", path);
+#ifdef CACHE_FUSE_PATH
+            /* the collection may exist anyway, e.g. created by someone else */
+            clearPathNotExist (pctable, (char *) path);
+#endif
+            invalidateDirCacheOfParent (path);
             return -ENOENT;
     }
 #ifdef CACHE_FUSE_PATH
@@ -434,6 +596,7 @@ irodsMkdir( const char *path, mode_t ) {
 #endif
         unuseIFuseConn (iFuseConn);
     }
+    invalidateDirCacheOfParent (path);
 
     return 0;
 }
@@ -496,6 +659,10 @@ irodsUnlink( const char *path ) {
     }
     }
     unuseIFuseConn (iFuseConn);
+    invalidateDirCacheOfParent (path);
+#ifdef ENABLE_META_STORE
+    removeMetaStore (path);
+#endif
 
     clearKeyVal (&dataObjInp.condInput);
 
@@ -505,6 +672,9 @@ irodsUnlink( const char *path ) {
         invalidatePreloadedFile(path);
     }
 #endif
+#ifdef ENABLE_BLOCK_CACHE
+    invalidateBlockCache(path);
+#endif
 
     return status;
 }
@@ -545,6 +715,11 @@ irodsRmdir( const char *path ) {
     }
 
     unuseIFuseConn (iFuseConn);
+    invalidateDirCacheOfParent (path);
+    invalidateDirCacheTree (path);
+#ifdef ENABLE_META_STORE
+    removeMetaStore (path);
+#endif
 
     clearKeyVal (&collInp.condInput);
 
@@ -586,6 +761,7 @@ irodsSymlink( const char *to, const char *from ) {
     rstrcpy (dataObjOpenInp.objPath, collPath, MAX_NAME_LEN);
     if(status != -ENOENT) {
         if (status < 0) {
+            unuseIFuseConn (iFuseConn);
             return status;
         }
         dataObjOpenInp.dataSize = 0;
@@ -605,6 +781,10 @@ irodsSymlink( const char *to, const char *from ) {
     dataObjOpenInp.createMode = S_IFLNK;
 
     status = rcDataObjOpen (iFuseConn->conn, &dataObjOpenInp);
+#ifdef CACHE_FUSE_PATH
+    clearPathNotExist (pctable, (char *) from);
+#endif
+    invalidateDirCacheOfParent (from);
 
     if (status < 0) {
         rodsLog (LOG_ERROR, "irodsSymlink: rcDataObjOpen of %s error. status = %d", collPath, status);
@@ -646,6 +826,13 @@ irodsRename( const char *from, const char *to ) {
 
     rodsLog (LOG_DEBUG, "irodsRename: %s to %s", from, to);
 
+#ifdef ENABLE_WRITE_BUFFER
+    // buffered writes go out before the object is changed by path
+    if (isWriteBufferEnabled() == 0) {
+        flushWriteBuffersForPath (from);
+    }
+#endif
+
 #ifdef ENABLE_LAZY_UPLOAD
     if (isLazyUploadEnabled() == 0) {
         if (isFileLazyUploading (from) >= 0) {
@@ -713,6 +900,11 @@ irodsRename( const char *from, const char *to ) {
         status = rcDataObjRename (iFuseConn->conn, &dataObjRenameInp);
     }
 
+#ifdef CACHE_FUSE_PATH
+    /* the destination exists now unless the rename failed, in which case
+     * its state is unknown */
+    clearPathNotExist (pctable, (char *) to);
+#endif
     if (status >= 0) {
 #ifdef CACHE_FUSE_PATH
         status = renmeLocalPath (pctable, (char *) from, (char *) to, (char *) toIrodsPath);
@@ -736,6 +928,22 @@ irodsRename( const char *from, const char *to ) {
         status = renamePreloadedFile (from, to);
     }
 #endif
+#ifdef ENABLE_BLOCK_CACHE
+    // cached blocks are keyed by path, drop both rather than moving them
+    invalidateBlockCache(from);
+    invalidateBlockCache(to);
+#endif
+#ifdef ENABLE_META_STORE
+    // a stored collection takes the entries under it along
+    removeMetaStore (from);
+    removeMetaStore (to);
+#endif
+
+    invalidateDirCacheOfParent (from);
+    invalidateDirCacheOfParent (to);
+    /* listings below a renamed collection are under the old path */
+    invalidateDirCacheTree (from);
+    invalidateDirCacheTree (to);
 
     unuseIFuseConn (iFuseConn);
     free(toIrodsPath);
@@ -761,6 +969,10 @@ irodsChmod( const char *path, mode_t mode ) {
 
     rodsLog (LOG_DEBUG, "irodsChmod: %s", path);
 
+#ifdef ENABLE_META_STORE
+    removeMetaStore (path);
+#endif
+
 #ifdef ENABLE_LAZY_UPLOAD
     if (isLazyUploadEnabled() == 0) {
         if (isFileLazyUploading (path) >= 0) {
@@ -861,6 +1073,17 @@ irodsTruncate( const char *path, off_t size ) {
 
     rodsLog (LOG_DEBUG, "irodsTruncate: %s", path);
 
+#ifdef ENABLE_META_STORE
+    removeMetaStore (path);
+#endif
+
+#ifdef ENABLE_WRITE_BUFFER
+    // buffered writes go out before the object is changed by path
+    if (isWriteBufferEnabled() == 0) {
+        flushWriteBuffersForPath (path);
+    }
+#endif
+
 #ifdef ENABLE_LAZY_UPLOAD
     if (isLazyUploadEnabled() == 0) {
         if (isFileLazyUploading (path) >= 0) {
@@ -893,6 +1116,9 @@ irodsTruncate( const char *path, off_t size ) {
                     if (isPreloadEnabled() == 0 && isPreloadedFile (path) >= 0) {
                         status = truncatePreloadedFile (path, size);
                     }
+#endif
+#ifdef ENABLE_BLOCK_CACHE
+                    invalidateBlockCache(path);
 #endif
                     return 0;
                 }
@@ -938,6 +1164,9 @@ irodsTruncate( const char *path, off_t size ) {
         status = truncatePreloadedFile (path, size);
     }
 #endif
+#ifdef ENABLE_BLOCK_CACHE
+    invalidateBlockCache(path);
+#endif
 
     return status;
 }
@@ -949,6 +1178,21 @@ irodsFlush( const char *path, struct fuse_file_info *fi ) {
     if (isLazyUploadEnabled() == 0 && isFileLazyUploading (path) >= 0) {
         syncLazyUploadBufferedFile (path, fi);
     }
+#endif
+#ifdef ENABLE_WRITE_BUFFER
+    if (isWriteBufferEnabled() == 0) {
+        int descInx = GET_IFUSE_DESC_INDEX(fi);
+        int status;
+
+        if (lockDesc (descInx) < 0) {
+            return -EBADF;
+        }
+        status = flushWriteBuffer (getIFuseDesc (descInx)->writeBuffer);
+        unlockDesc (descInx);
+        if (status < 0) {
+            return status;
+        }
+    }
 #endif
     return 0;
 }
@@ -963,6 +1207,7 @@ int
 irodsOpen( const char *path, struct fuse_file_info *fi ) {
     dataObjInp_t dataObjInp;
     int status;
+    int statStatus;         /* of the stat of the path on the server */
     int fd;
     iFuseConn_t *iFuseConn = NULL;
     iFuseDesc_t *desc = NULL;
@@ -971,6 +1216,9 @@ irodsOpen( const char *path, struct fuse_file_info *fi ) {
     char cachePath[MAX_NAME_LEN];
     char objPath[MAX_NAME_LEN];
     int flags = fi->flags;
+#ifdef ENABLE_PRELOAD
+    int accessPattern = PRELOAD_ACCESS_REREAD;
+#endif
 
     rodsLog (LOG_DEBUG, "irodsOpen: %s, flags = %d", path, fi->flags);
     rodsLog (LOG_DEBUG, "irodsOpen: %s, Read = %d", path, ((flags & O_ACCMODE) == O_RDONLY));
@@ -996,6 +1244,12 @@ irodsOpen( const char *path, struct fuse_file_info *fi ) {
         }
     }
 #endif
+#ifdef ENABLE_META_STORE
+    // the stored size and mtime will not hold after writes
+    if ((flags & O_ACCMODE) == O_WRONLY || (flags & O_ACCMODE) == O_RDWR) {
+        removeMetaStore (path);
+    }
+#endif
 
     matchAndLockPathCache(pctable, (char *) path, &tmpPathCache);
     if(tmpPathCache!= NULL) {
@@ -1019,7 +1273,7 @@ irodsOpen( const char *path, struct fuse_file_info *fi ) {
                 UNLOCK_STRUCT(*(tmpPathCache->fileCache));
                 UNLOCK_STRUCT(*tmpPathCache);
 
-#if defined(ENABLE_PRELOAD) || defined(ENABLE_LAZY_UPLOAD)
+#if defined(ENABLE_PRELOAD) || defined(ENABLE_LAZY_UPLOAD) || defined(ENABLE_BLOCK_CACHE)
                 if ((flags & O_ACCMODE) == O_WRONLY || (flags & O_ACCMODE) == O_RDWR) {
 #ifdef ENABLE_PRELOAD
                     if (isPreloadEnabled() == 0 && isPreloadedFile (path) >= 0) {
@@ -1027,6 +1281,9 @@ irodsOpen( const char *path, struct fuse_file_info *fi ) {
                         invalidatePreloadedFile(path);
                     }
 #endif
+#ifdef ENABLE_BLOCK_CACHE
+                    invalidateBlockCache(path);
+#endif
 #ifdef ENABLE_LAZY_UPLOAD
                     if ((flags & O_ACCMODE) == O_WRONLY) {
                         // lazy-upload
@@ -1038,9 +1295,15 @@ irodsOpen( const char *path, struct fuse_file_info *fi ) {
                 } else if ((flags & O_ACCMODE) == O_RDONLY && tmpPathCache->stbuf.st_size > MAX_READ_CACHE_SIZE) {
 #ifdef ENABLE_PRELOAD
                     if (isPreloadEnabled() == 0) {
+                        // files without reuse are streamed, not preloaded
+                        accessPattern = classifyPreloadAccess(path, &tmpPathCache->stbuf);
+                        desc->streaming = IS_STREAMED_ACCESS(accessPattern);
+                        if (accessPattern != PRELOAD_ACCESS_REREAD) {
+                            rodsLog (LOG_DEBUG, "irodsOpen: no reuse of %s, not preloaded", path);
+                        }
                         // preload irods file
                         // this may fail if background tasks are already running too many
-                        if (preloadFile(path, &tmpPathCache->stbuf) == 0) {
+                        else if (preloadFile(path, &tmpPathCache->stbuf, PRELOAD_PRIORITY_FOREGROUND) == 0) {
                             rodsLog (LOG_DEBUG, "irodsOpen: preload %s", path);
                         }
                     }
@@ -1075,8 +1338,9 @@ irodsOpen( const char *path, struct fuse_file_info *fi ) {
 
     /* do only O_RDONLY (0) */
     status = _irodsGetattr (iFuseConn, path, &stbuf);
+    statStatus = status;
 
-#if defined(ENABLE_PRELOAD) || defined(ENABLE_LAZY_UPLOAD)
+#if defined(ENABLE_PRELOAD) || defined(ENABLE_LAZY_UPLOAD) || defined(ENABLE_BLOCK_CACHE)
     if ((flags & O_ACCMODE) == O_WRONLY || (flags & O_ACCMODE) == O_RDWR) {
 #ifdef ENABLE_PRELOAD
         if (isPreloadEnabled() == 0 && isPreloadedFile (path) >= 0) {
@@ -1084,6 +1348,9 @@ irodsOpen( const char *path, struct fuse_file_info *fi ) {
             invalidatePreloadedFile(path);
         }
 #endif
+#ifdef ENABLE_BLOCK_CACHE
+        invalidateBlockCache(path);
+#endif
 #ifdef ENABLE_LAZY_UPLOAD
         if ((flags & O_ACCMODE) == O_WRONLY) {
             // lazy-upload
@@ -1095,9 +1362,14 @@ irodsOpen( const char *path, struct fuse_file_info *fi ) {
     } else if ((flags & O_ACCMODE) == O_RDONLY && stbuf.st_size > MAX_READ_CACHE_SIZE) {
 #ifdef ENABLE_PRELOAD
         if (isPreloadEnabled() == 0) {
+            // files without reuse are streamed, not preloaded
+            accessPattern = classifyPreloadAccess(path, &stbuf);
+            if (accessPattern != PRELOAD_ACCESS_REREAD) {
+                rodsLog (LOG_DEBUG, "irodsOpen: no reuse of %s, not preloaded", path);
+            }
             // preload irods file
             // this may fail if background tasks are already running too many
-            if (preloadFile(path, &stbuf) == 0) {
+            else if (preloadFile(path, &stbuf, PRELOAD_PRIORITY_FOREGROUND) == 0) {
                 rodsLog (LOG_DEBUG, "irodsOpen: preload %s", path);
             }
         }
@@ -1106,28 +1378,85 @@ irodsOpen( const char *path, struct fuse_file_info *fi ) {
 #endif
 
     if ((flags & (O_WRONLY | O_RDWR)) != 0 || status < 0 || stbuf.st_size > MAX_READ_CACHE_SIZE) {
-        fd = rcDataObjOpen (iFuseConn->conn, &dataObjInp);
-        unuseIFuseConn (iFuseConn);
+        /* size of the object if it is only read through this descriptor */
+        rodsLong_t readOnlySize = ((flags & O_ACCMODE) == O_RDONLY && status >= 0) ? stbuf.st_size : 0;
 
-        if (fd < 0) {
-            rodsLogError (LOG_ERROR, status, "irodsOpen: rcDataObjOpen of %s error, status = %d", path, fd);
-            return -ENOENT;
+        fileCache_t *fileCache = NULL;
+
+        if (readOnlySize > 0) {
+            /* use the handle another read only open of this version has */
+            fileCache = getAndLockSharedFileCache (objPath, &stbuf);
         }
 
-        fileCache_t *fileCache = addFileCache(fd, objPath, (char *) path, NULL, stbuf.st_mode, stbuf.st_size, NO_FILE_CACHE);
-        matchAndLockPathCache(pctable, (char *) path, &tmpPathCache);
-        if(tmpPathCache == NULL) {
-            pathExist(pctable, (char *) path, fileCache, &stbuf, NULL);
+        if (fileCache != NULL) {
+            unuseIFuseConn (iFuseConn);
+            rodsLog (LOG_DEBUG, "irodsOpen: share the open handle of %s", path);
+            desc = newIFuseDesc (objPath, (char *) path, fileCache, &status);
+            UNLOCK_STRUCT(*fileCache);
+            if (desc == NULL) {
+                rodsLogError (LOG_ERROR, status, "irodsOpen: allocIFuseDesc of %s error", path);
+                return -ENOENT;
+            }
         }
         else {
-            _addFileCacheForPath(tmpPathCache, fileCache);
-            UNLOCK_STRUCT(*tmpPathCache);
+            /* the descriptor is served by the server it is opened on */
+            if (redirectIFuseConn (&iFuseConn, (char *) path, &dataObjInp) < 0) {
+                rodsLog (LOG_ERROR, "irodsOpen: cannot get connection for %s", path);
+                return -ENOTDIR;
+            }
+
+            fd = rcDataObjOpen (iFuseConn->conn, &dataObjInp);
+
+            if (fd < 0) {
+                unuseIFuseConn (iFuseConn);
+                rodsLogError (LOG_ERROR, status, "irodsOpen: rcDataObjOpen of %s error, status = %d", path, fd);
+                return -ENOENT;
+            }
+
+            fileCache = addFileCache(fd, objPath, (char *) path, NULL, stbuf.st_mode, stbuf.st_size, NO_FILE_CACHE);
+            setFileCacheConn (fileCache, iFuseConn);
+            unuseIFuseConn (iFuseConn);
+            matchAndLockPathCache(pctable, (char *) path, &tmpPathCache);
+            if(tmpPathCache == NULL) {
+                pathExist(pctable, (char *) path, fileCache, statStatus >= 0 ? &stbuf : NULL, NULL);
+            }
+            else {
+                _addFileCacheForPath(tmpPathCache, fileCache);
+                if (statStatus >= 0) {
+                    _setPathCacheStat(tmpPathCache, &stbuf);
+                }
+                UNLOCK_STRUCT(*tmpPathCache);
+            }
+            LOCK_STRUCT(*fileCache);
+            desc = newIFuseDesc (objPath, (char *) path, fileCache, &status);
+            UNLOCK_STRUCT(*fileCache);
+            if (desc == NULL) {
+                rodsLogError (LOG_ERROR, status, "irodsOpen: allocIFuseDesc of %s error", path);
+                return -ENOENT;
+            }
+            if (readOnlySize > 0) {
+                shareFileCache (fileCache, &stbuf);
+            }
         }
-        desc = newIFuseDesc (objPath, (char *) path, fileCache, &status);
-        if (desc == NULL) {
-            rodsLogError (LOG_ERROR, status, "irodsOpen: allocIFuseDesc of %s error", path);
-            return -ENOENT;
+#ifdef ENABLE_READAHEAD
+        if (isReadaheadEnabled() == 0 && readOnlySize > 0) {
+            desc->readahead = openReadahead (objPath, readOnlySize);
+        }
+#endif
+#ifdef ENABLE_BLOCK_CACHE
+        if (isBlockCacheEnabled() == 0 && readOnlySize > 0) {
+            desc->blockCache = openBlockCache (path, &stbuf);
         }
+#endif
+#ifdef ENABLE_PRELOAD
+        // a stream would push the working set out of the block cache
+        desc->streaming = IS_STREAMED_ACCESS(accessPattern);
+#endif
+#ifdef ENABLE_WRITE_BUFFER
+        if (isWriteBufferEnabled() == 0 && (flags & (O_WRONLY | O_RDWR)) != 0) {
+            desc->writeBuffer = openWriteBuffer (path, fileCache);
+        }
+#endif
     }
     else {
         rodsLog (LOG_DEBUG, "irodsOpenWithReadCache: caching %s", path);
@@ -1155,15 +1484,23 @@ irodsOpen( const char *path, struct fuse_file_info *fi ) {
         }
         else {
             _addFileCacheForPath(tmpPathCache, fileCache);
+            _setPathCacheStat(tmpPathCache, &stbuf);
             UNLOCK_STRUCT(*tmpPathCache);
         }
+        LOCK_STRUCT(*fileCache);
         desc = newIFuseDesc(objPath, (char *) path,fileCache, &status);
+        UNLOCK_STRUCT(*fileCache);
         if (status < 0) {
             rodsLogError (LOG_ERROR, status, "irodsOpen: create descriptor of %s error", dataObjInp.objPath);
             return status;
         }
     }
 
+    if ((flags & O_ACCMODE) == O_RDONLY) {
+        /* the kernel drops the pages it has of the file unless told to keep them */
+        fi->keep_cache = keepPageCache (pctable, (char *) path, objPath, &stbuf);
+    }
+
     //fi->fh = desc->index;
     ALLOC_IFUSE_DESC_INDEX(fi);
     SET_IFUSE_DESC_INDEX(fi, desc->index);
@@ -1182,9 +1519,10 @@ irodsRead (const char *path, char *buf, size_t size, off_t offset,
     // check local cache
     rodsLog (LOG_DEBUG, "irodsRead: read %s, o:%ld, l:%ld\n", path, offset, size);
     if (isPreloadEnabled() == 0) {
-        descInx = openPreloadedFile (path);
-        if (descInx > 0) {
-            status = readPreloadedFile (descInx, buf, size, offset);
+        preloadFileHandleInfo_t *preloadFileHandleInfo = openPreloadedFile (path);
+        if (preloadFileHandleInfo != NULL) {
+            status = readPreloadedFile (preloadFileHandleInfo, buf, size, offset);
+            releasePreloadedFile (preloadFileHandleInfo);
             return status;
         }
     }
@@ -1199,7 +1537,7 @@ irodsRead (const char *path, char *buf, size_t size, off_t offset,
         return -EBADF;
     }
 
-    status = _ifuseRead (&IFuseDesc[descInx], buf, size, offset);
+    status = _ifuseRead (getIFuseDesc (descInx), buf, size, offset);
 
     return status;
 }
@@ -1228,7 +1566,7 @@ irodsWrite (const char *path, const char *buf, size_t size, off_t offset,
         return -EBADF;
     }
 
-    status = _ifuseWrite (&IFuseDesc[descInx], (char *)buf, size, offset);
+    status = _ifuseWrite (getIFuseDesc (descInx), (char *)buf, size, offset);
     unlockDesc (descInx);
 
     return status;
@@ -1270,8 +1608,8 @@ irodsRelease( const char *path, struct fuse_file_info *fi ) {
     rodsLog (LOG_DEBUG, "irodsRelease: %s", path);
 
 #ifdef ENABLE_PRELOAD
-    // check local cache
-    if (isPreloadEnabled() == 0 && isPreloadedFile (path) >= 0) {
+    // the cache may be gone while its handle is still opened
+    if (isPreloadEnabled() == 0) {
         closePreloadedFile (path);
     }
 #endif
@@ -1287,11 +1625,20 @@ irodsRelease( const char *path, struct fuse_file_info *fi ) {
 
     rodsLog (LOG_DEBUG, "irodsRelease - desc : %s - %d", path, descInx);
 
-    /* if (checkFuseDesc (descInx) < 0) {
+    if (checkFuseDesc (descInx) < 0) {
         return -EBADF;
-    } */
+    }
+
+#ifdef ENABLE_PRELOAD
+    if (isPreloadEnabled() == 0) {
+        iFuseDesc_t *desc = getIFuseDesc (descInx);
+        if (desc->seqReads + desc->randomReads > 0) {
+            recordPreloadAccess (path, IS_RANDOM_DESC_ACCESS(desc) ? PRELOAD_ACCESS_RANDOM : PRELOAD_ACCESS_SEQUENTIAL);
+        }
+    }
+#endif
 
-    status = ifuseClose (&IFuseDesc[descInx]);
+    status = ifuseClose (getIFuseDesc (descInx));
 
     if (status < 0) {
         if ((myError = getErrno (status)) > 0) {
@@ -1313,6 +1660,21 @@ irodsFsync( const char *path, int, struct fuse_file_info *fi ) {
     if (isLazyUploadEnabled() == 0 && isFileLazyUploading (path) >= 0) {
         syncLazyUploadBufferedFile (path, fi);
     }
+#endif
+#ifdef ENABLE_WRITE_BUFFER
+    if (isWriteBufferEnabled() == 0) {
+        int descInx = GET_IFUSE_DESC_INDEX(fi);
+        int status;
+
+        if (lockDesc (descInx) < 0) {
+            return -EBADF;
+        }
+        status = flushWriteBuffer (getIFuseDesc (descInx)->writeBuffer);
+        unlockDesc (descInx);
+        if (status < 0) {
+            return status;
+        }
+    }
 #endif
     return 0;
 }
@@ -1321,3 +1683,80 @@ irodsFsync( const char *path, int, struct fuse_file_info *fi ) {
 
     
 
+
+#ifdef ENABLE_META_STORE
+/* the stored stat of path if it is recent enough or, if it is older, its
+ * parent collection is unchanged on the server since. one stat of the
+ * collection vouches for all of its entries for a timeout */
+static int
+_lookupMetaStore (const char *path, struct stat *stbuf) {
+    iFuseConn_t *iFuseConn = NULL;
+    struct stat collStbuf;
+    char collPath[MAX_NAME_LEN];
+    time_t collMtime;
+    time_t mtime;
+    int status;
+
+    status = lookupMetaStore (path, stbuf, &collMtime);
+    if (status != 1) {
+        return status;
+    }
+
+    _getParentPath (path, collPath);
+    if (checkMetaStoreColl (collPath, &mtime) < 0) {
+        /* not through the path cache, which would be left a placeholder
+         * of the collection without its stat */
+        status = getAndUseIFuseConn (&iFuseConn);
+        if (status < 0) {
+            return -1;
+        }
+        status = _irodsGetattr (iFuseConn, collPath, &collStbuf);
+        unuseIFuseConn (iFuseConn);
+        if (status < 0) {
+            return -1;
+        }
+        mtime = collStbuf.st_mtime;
+        setMetaStoreColl (collPath, mtime);
+    }
+
+    if (mtime != collMtime) {
+        return -1;
+    }
+    refreshMetaStore (path);
+    return 0;
+}
+
+/* mtime of the path cached, 0 if it is not */
+static time_t
+_getCachedMtime (const char *path) {
+    pathCache_t *tmpPathCache;
+    time_t mtime = 0;
+
+    if (path[0] == '\0') {
+        return 0;
+    }
+    if (matchAndLockPathCache (pctable, (char *) path, &tmpPathCache) == 1) {
+        if (tmpPathCache->statValid) {
+            mtime = tmpPathCache->stbuf.st_mtime;
+        }
+        UNLOCK_STRUCT(*tmpPathCache);
+    }
+    return mtime;
+}
+
+/* empty for the root */
+static void
+_getParentPath (const char *path, char *parentPath) {
+    const char *lastSlash = strrchr (path, '/');
+
+    if (lastSlash == NULL || strcmp (path, "/") == 0) {
+        parentPath[0] = '\0';
+    }
+    else if (lastSlash == path) {
+        strcpy (parentPath, "/");
+    }
+    else {
+        rstrcpy (parentPath, (char *) path, lastSlash - path + 1);
+    }
+}
+#endif
@@ -14,6 +14,7 @@
 #include "irodsFs.h"
 #include "iFuseOper.h"
 #include "iFuseLib.h"
+#include "iFuseLib.DirCache.h"
 
 #ifdef ENABLE_PRELOAD
 #include "iFuseLib.Preload.h"
@@ -21,6 +22,27 @@
 #ifdef ENABLE_LAZY_UPLOAD
 #include "iFuseLib.LazyUpload.h"
 #endif
+#ifdef ENABLE_READAHEAD
+#include "iFuseLib.Readahead.h"
+#endif
+#ifdef ENABLE_BLOCK_CACHE
+#include "iFuseLib.BlockCache.h"
+#endif
+#ifdef ENABLE_WRITE_BUFFER
+#include "iFuseLib.WriteBuffer.h"
+#endif
+#ifdef ENABLE_RANGE_FETCH
+#include "iFuseLib.RangeFetch.h"
+#endif
+#ifdef ENABLE_META_STORE
+#include "iFuseLib.MetaStore.h"
+#endif
+#ifdef ENABLE_STAT_BATCH
+#include "iFuseLib.StatBatch.h"
+#endif
+#ifdef ENABLE_STATS
+#include "iFuseLib.Stats.h"
+#endif
 
 #ifdef ENABLE_TRACE
 #include "iFuseLib.Trace.h"
@@ -29,13 +51,44 @@
 /* some global variables */
 
 extern rodsEnv MyRodsEnv;
+extern PathCacheTable *pctable;
+pathCacheConfig_t MyPathCacheConfig;
+pageCacheConfig_t MyPageCacheConfig;
+dirCacheConfig_t MyDirCacheConfig;
+connPoolConfig_t MyConnPoolConfig;
 #ifdef ENABLE_PRELOAD
 preloadConfig_t MyPreloadConfig;
 #endif
 #ifdef ENABLE_LAZY_UPLOAD
 lazyUploadConfig_t MyLazyUploadConfig;
 #endif
+#ifdef ENABLE_READAHEAD
+readaheadConfig_t MyReadaheadConfig;
+#endif
+#ifdef ENABLE_BLOCK_CACHE
+blockCacheConfig_t MyBlockCacheConfig;
+#endif
+#ifdef ENABLE_WRITE_BUFFER
+writeBufferConfig_t MyWriteBufferConfig;
+#endif
+#ifdef ENABLE_RANGE_FETCH
+rangeFetchConfig_t MyRangeFetchConfig;
+#endif
+#ifdef ENABLE_META_STORE
+metaStoreConfig_t MyMetaStoreConfig;
+#endif
+#ifdef ENABLE_STAT_BATCH
+statBatchConfig_t MyStatBatchConfig;
+#endif
+#ifdef ENABLE_STATS
+statsConfig_t MyStatsConfig;
+#endif
 
+/* command line options, kept for the modules started in irodsFsInit */
+static rodsArguments_t MyRodsArgs;
+static int FsInitDone = 0;
+
+static void *irodsFsInit (struct fuse_conn_info *conn);
 
 #ifdef ENABLE_TRACE
 #ifdef  __cplusplus
@@ -64,6 +117,7 @@ static struct fuse_operations irodsOper =
   .release = traced_irodsRelease,
   .fsync = traced_irodsFsync,
   .flush = traced_irodsFlush,
+  .init = irodsFsInit,
 };
 #endif
 
@@ -95,6 +149,7 @@ static struct fuse_operations irodsOper =
   .release = irodsRelease,
   .fsync = irodsFsync,
   .flush = irodsFlush,
+  .init = irodsFsInit,
 };
 #endif
 
@@ -103,6 +158,9 @@ static struct fuse_operations irodsOper =
 int parseFuseSpecificCmdLineOpt(int argc, char **argv);
 int makeCleanCmdLineOpt (int argc, char **argv, int *argc2, char ***argv2);
 int releaseCmdLineOpt (int argc, char **argv);
+void logPathCacheStats ();
+void logDirCacheStats ();
+void logConnPoolStats ();
 
 void usage ();
 
@@ -141,6 +199,60 @@ static void usage(const char *progname)
 
 */
 
+/* 
+ * runs in the mounted daemon once fuse_main has forked into the background.
+ * modules that start worker threads are initialized here, threads started
+ * before fuse_main would not survive the fork.
+ */
+static void *
+irodsFsInit (struct fuse_conn_info *conn)
+{
+    // connect ahead of the first requests
+    startConnManager ();
+#ifdef ENABLE_TRACE
+    // start draining binary traces
+    trace_start_threads ();
+#endif
+#ifdef ENABLE_META_STORE
+    // the stored stats are loaded at the first lookup
+    initMetaStore (&MyMetaStoreConfig, &MyRodsEnv);
+#endif
+#ifdef ENABLE_STAT_BATCH
+    initStatBatch (&MyStatBatchConfig, &MyRodsEnv);
+#endif
+#ifdef ENABLE_RANGE_FETCH
+    // preload and block cache fetch through it
+    initRangeFetch (&MyRangeFetchConfig, &MyRodsEnv);
+#endif
+#ifdef ENABLE_PRELOAD
+    // initialize preload
+    initPreload (&MyPreloadConfig, &MyRodsEnv, &MyRodsArgs);
+#endif
+#ifdef ENABLE_LAZY_UPLOAD
+    // initialize Lazy Upload
+    initLazyUpload (&MyLazyUploadConfig, &MyRodsEnv, &MyRodsArgs);
+#endif    
+#ifdef ENABLE_READAHEAD
+    // initialize readahead
+    initReadahead (&MyReadaheadConfig);
+#endif
+#ifdef ENABLE_BLOCK_CACHE
+    // initialize block cache
+    initBlockCache (&MyBlockCacheConfig, &MyRodsEnv);
+#endif
+#ifdef ENABLE_WRITE_BUFFER
+    // initialize write buffer
+    initWriteBuffer (&MyWriteBufferConfig);
+#endif
+#ifdef ENABLE_STATS
+    // start counting and the periodic dump
+    initStats (&MyStatsConfig);
+#endif
+
+    FsInitDone = 1;
+    return NULL;
+}
+
 int 
 main (int argc, char **argv)
 {
@@ -168,6 +280,7 @@ irodsOper.statfs = traced_irodsStatfs;
 irodsOper.release = traced_irodsRelease;
 irodsOper.fsync = traced_irodsFsync;
 irodsOper.flush = traced_irodsFlush;
+irodsOper.init = irodsFsInit;
 
 #else
 irodsOper.getattr = irodsGetattr;
@@ -191,11 +304,11 @@ irodsOper.statfs = irodsStatfs;
 irodsOper.release = irodsRelease;
 irodsOper.fsync = irodsFsync;
 irodsOper.flush = irodsFlush;
+irodsOper.init = irodsFsInit;
 
 #endif  // ENABLE_TRACE
 
     int status;
-    rodsArguments_t myRodsArgs;
     char *optStr;
     
     int new_argc;
@@ -225,6 +338,7 @@ irodsOper.flush = irodsFlush;
     irodsOper.release = traced_irodsRelease;
     irodsOper.fsync = traced_irodsFsync;
     irodsOper.flush = traced_irodsFlush;
+    irodsOper.init = irodsFsInit;
 #else // no ENABLE_TRACE
     bzero (&irodsOper, sizeof (irodsOper));
     irodsOper.getattr = irodsGetattr;
@@ -248,6 +362,7 @@ irodsOper.flush = irodsFlush;
     irodsOper.release = irodsRelease;
     irodsOper.fsync = irodsFsync;
     irodsOper.flush = irodsFlush;
+    irodsOper.init = irodsFsInit;
 #endif // ENABLE_TRACE
 #endif
 
@@ -273,13 +388,22 @@ irodsOper.flush = irodsFlush;
 
     optStr = "hdo:";
 
-    status = parseCmdLineOpt (argc, argv, optStr, 0, &myRodsArgs);    
+    status = parseCmdLineOpt (argc, argv, optStr, 0, &MyRodsArgs);    
+
+    if (MyPageCacheConfig.attrTimeout >= 0) {
+        /* passed on to fuse_main, it is not an option of ours */
+        char timeoutOpt[MAX_NAME_LEN];
+        snprintf (timeoutOpt, MAX_NAME_LEN, "-oattr_timeout=%d,entry_timeout=%d",
+          MyPageCacheConfig.attrTimeout, MyPageCacheConfig.attrTimeout);
+        argv = (char **) realloc (argv, sizeof (char *) * (argc + 1));
+        argv[argc++] = strdup (timeoutOpt);
+    }
 
     if (status < 0) {
         printf("Use -h for help.\n");
         exit (1);
     }
-    if ( myRodsArgs.help == True ) {
+    if ( MyRodsArgs.help == True ) {
        usage();
        exit(0);
     }
@@ -292,19 +416,21 @@ irodsOper.flush = irodsFlush;
 	}
 #endif
 
-    initPathCache ();
+    setPathCacheConfig (&MyPathCacheConfig);
+    setPageCacheConfig (&MyPageCacheConfig);
+    pctable = initPathCache ();
+    setDirCacheConfig (&MyDirCacheConfig);
+    initDirCache ();
     initIFuseDesc ();
+    setConnPoolConfig (&MyConnPoolConfig);
     initConn();
     initFileCache();
 
-#ifdef ENABLE_PRELOAD
-    // initialize preload
-    initPreload (&MyPreloadConfig, &MyRodsEnv, &myRodsArgs);
+#ifdef ENABLE_STATS
+    // time every operation, on top of tracing
+    wrapStatsOperations (&irodsOper);
 #endif
-#ifdef ENABLE_LAZY_UPLOAD
-    // initialize Lazy Upload
-    initLazyUpload (&MyLazyUploadConfig, &MyRodsEnv, &myRodsArgs);
-#endif    
+
 #ifdef ENABLE_TRACE
 
     // start tracing
@@ -326,29 +452,85 @@ irodsOper.flush = irodsFlush;
     /* release the preload command line options */
     releaseCmdLineOpt (argc, argv);
 
+    if (FsInitDone) {
 #ifdef ENABLE_PRELOAD
-    // wait preload jobs
-    waitPreloadJobs();
+        // wait preload jobs
+        waitPreloadJobs();
 #endif
 
 #ifdef ENABLE_PRELOAD
-    // uninitialize preload
-    uninitPreload (&MyPreloadConfig);
-    if (MyPreloadConfig.cachePath != NULL) {
-        free(MyPreloadConfig.cachePath);
-    }
+        // uninitialize preload
+        uninitPreload (&MyPreloadConfig);
+        if (MyPreloadConfig.cachePath != NULL) {
+            free(MyPreloadConfig.cachePath);
+        }
 #endif
 
 #ifdef ENABLE_LAZY_UPLOAD
-    // uninitialize lazy upload
-    uninitLazyUpload (&MyLazyUploadConfig);
-    if (MyLazyUploadConfig.bufferPath!=NULL) {
-        free(MyLazyUploadConfig.bufferPath);
-    }
+        // uninitialize lazy upload
+        uninitLazyUpload (&MyLazyUploadConfig);
+        if (MyLazyUploadConfig.bufferPath!=NULL) {
+            free(MyLazyUploadConfig.bufferPath);
+        }
+#endif
+
+#ifdef ENABLE_READAHEAD
+        // stop readahead workers
+        uninitReadahead (&MyReadaheadConfig);
+#endif
+
+#ifdef ENABLE_BLOCK_CACHE
+        // uninitialize block cache
+        uninitBlockCache (&MyBlockCacheConfig);
+        if (MyBlockCacheConfig.cachePath != NULL) {
+            free(MyBlockCacheConfig.cachePath);
+        }
+#endif
+
+#ifdef ENABLE_WRITE_BUFFER
+        // stop the flusher, all descriptors are closed by now
+        uninitWriteBuffer (&MyWriteBufferConfig);
+#endif
+
+#ifdef ENABLE_RANGE_FETCH
+        // no fetch is running once preload and block cache are down
+        uninitRangeFetch (&MyRangeFetchConfig);
 #endif
 
+#ifdef ENABLE_STAT_BATCH
+        uninitStatBatch (&MyStatBatchConfig);
+#endif
+
+#ifdef ENABLE_META_STORE
+        uninitMetaStore (&MyMetaStoreConfig);
+        if (MyMetaStoreConfig.cachePath != NULL) {
+            free(MyMetaStoreConfig.cachePath);
+        }
+#endif
+    }
+
+    clearPageCacheConfig ();
+    if (MyPageCacheConfig.immutableColls != NULL) {
+        free(MyPageCacheConfig.immutableColls);
+    }
+
+    logPathCacheStats ();
+    logDirCacheStats ();
+    uninitDirCache ();
+
+    logConnPoolStats ();
     disconnectAll ();
 
+#ifdef ENABLE_STATS
+    // after disconnectAll, the connection manager makes requests till then
+    if (FsInitDone) {
+        uninitStats (&MyStatsConfig);
+        if (MyStatsConfig.dumpPath != NULL) {
+            free(MyStatsConfig.dumpPath);
+        }
+    }
+#endif
+
     if (status < 0) {
         exit (3);
     }
@@ -366,15 +548,227 @@ parseFuseSpecificCmdLineOpt (int argc, char **argv) {
 #ifdef ENABLE_LAZY_UPLOAD
     lazyUploadConfig_t* lazyUploadConfig = &MyLazyUploadConfig;
 #endif
+#ifdef ENABLE_READAHEAD
+    readaheadConfig_t* readaheadConfig = &MyReadaheadConfig;
+#endif
+#ifdef ENABLE_BLOCK_CACHE
+    blockCacheConfig_t* blockCacheConfig = &MyBlockCacheConfig;
+#endif
+#ifdef ENABLE_WRITE_BUFFER
+    writeBufferConfig_t* writeBufferConfig = &MyWriteBufferConfig;
+#endif
+#ifdef ENABLE_RANGE_FETCH
+    rangeFetchConfig_t* rangeFetchConfig = &MyRangeFetchConfig;
+#endif
+#ifdef ENABLE_META_STORE
+    metaStoreConfig_t* metaStoreConfig = &MyMetaStoreConfig;
+#endif
+#ifdef ENABLE_STAT_BATCH
+    statBatchConfig_t* statBatchConfig = &MyStatBatchConfig;
+#endif
+#ifdef ENABLE_STATS
+    statsConfig_t* statsConfig = &MyStatsConfig;
+#endif
+    pathCacheConfig_t* pathCacheConfig = &MyPathCacheConfig;
+    pageCacheConfig_t* pageCacheConfig = &MyPageCacheConfig;
+    dirCacheConfig_t* dirCacheConfig = &MyDirCacheConfig;
+    connPoolConfig_t* connPoolConfig = &MyConnPoolConfig;
 
+    /* 0 or negative values keep the defaults */
+    memset(&MyPathCacheConfig, 0, sizeof(pathCacheConfig_t));
+    MyPathCacheConfig.timeout = -1;
+    MyPathCacheConfig.nonExistTimeout = -1;
+    memset(&MyPageCacheConfig, 0, sizeof(pageCacheConfig_t));
+    MyPageCacheConfig.attrTimeout = -1;
+    memset(&MyDirCacheConfig, 0, sizeof(dirCacheConfig_t));
+    MyDirCacheConfig.timeout = -1;
+    memset(&MyConnPoolConfig, 0, sizeof(connPoolConfig_t));
+    MyConnPoolConfig.minConn = -1;
+    MyConnPoolConfig.checkInterval = -1;
 #ifdef ENABLE_PRELOAD
     memset(&MyPreloadConfig, 0, sizeof(preloadConfig_t));
 #endif
 #ifdef ENABLE_LAZY_UPLOAD
     memset(&MyLazyUploadConfig, 0, sizeof(lazyUploadConfig_t));
 #endif
+#ifdef ENABLE_READAHEAD
+    memset(&MyReadaheadConfig, 0, sizeof(readaheadConfig_t));
+#endif
+#ifdef ENABLE_BLOCK_CACHE
+    memset(&MyBlockCacheConfig, 0, sizeof(blockCacheConfig_t));
+#endif
+#ifdef ENABLE_WRITE_BUFFER
+    memset(&MyWriteBufferConfig, 0, sizeof(writeBufferConfig_t));
+#endif
+#ifdef ENABLE_RANGE_FETCH
+    memset(&MyRangeFetchConfig, 0, sizeof(rangeFetchConfig_t));
+    MyRangeFetchConfig.maxRetries = -1;
+#endif
+#ifdef ENABLE_META_STORE
+    memset(&MyMetaStoreConfig, 0, sizeof(metaStoreConfig_t));
+    MyMetaStoreConfig.timeout = -1;
+#endif
+#ifdef ENABLE_STAT_BATCH
+    memset(&MyStatBatchConfig, 0, sizeof(statBatchConfig_t));
+    MyStatBatchConfig.window = -1;
+#endif
+#ifdef ENABLE_STATS
+    memset(&MyStatsConfig, 0, sizeof(statsConfig_t));
+#endif
 
     for (i=0;i<argc;i++) {
+        if (strcmp("--pathcache-max-entries", argv[i])==0) {
+            argv[i]="-Z";
+            if (i + 2 < argc) {
+                if (*argv[i+1] == '-') {
+                    rodsLog (LOG_ERROR,
+                    "--pathcache-max-entries option takes a number argument");
+                    return USER_INPUT_OPTION_ERR;
+                }
+                pathCacheConfig->maxEntries=atoi(argv[i+1]);
+                argv[i+1]="-Z";
+            }
+        }
+        if (strcmp("--pathcache-timeout", argv[i])==0) {
+            argv[i]="-Z";
+            if (i + 2 < argc) {
+                if (*argv[i+1] == '-') {
+                    rodsLog (LOG_ERROR,
+                    "--pathcache-timeout option takes a time argument");
+                    return USER_INPUT_OPTION_ERR;
+                }
+                pathCacheConfig->timeout=atoi(argv[i+1]);
+                argv[i+1]="-Z";
+            }
+        }
+        if (strcmp("--pathcache-negative-timeout", argv[i])==0) {
+            argv[i]="-Z";
+            if (i + 2 < argc) {
+                if (*argv[i+1] == '-') {
+                    rodsLog (LOG_ERROR,
+                    "--pathcache-negative-timeout option takes a time argument");
+                    return USER_INPUT_OPTION_ERR;
+                }
+                pathCacheConfig->nonExistTimeout=atoi(argv[i+1]);
+                argv[i+1]="-Z";
+            }
+        }
+        if (strcmp("--pathcache-shards", argv[i])==0) {
+            argv[i]="-Z";
+            if (i + 2 < argc) {
+                if (*argv[i+1] == '-') {
+                    rodsLog (LOG_ERROR,
+                    "--pathcache-shards option takes a number argument");
+                    return USER_INPUT_OPTION_ERR;
+                }
+                pathCacheConfig->numShards=atoi(argv[i+1]);
+                argv[i+1]="-Z";
+            }
+        }
+        if (strcmp("--pagecache-check", argv[i])==0) {
+            pageCacheConfig->check=1;
+            argv[i]="-Z";
+        }
+        if (strcmp("--pagecache-immutable", argv[i])==0) {
+            argv[i]="-Z";
+            if (i + 2 < argc) {
+                if (*argv[i+1] == '-') {
+                    rodsLog (LOG_ERROR,
+                    "--pagecache-immutable option takes a collection list argument");
+                    return USER_INPUT_OPTION_ERR;
+                }
+                pageCacheConfig->immutableColls=strdup(argv[i+1]);
+                argv[i+1]="-Z";
+            }
+        }
+        if (strcmp("--pagecache-attr-timeout", argv[i])==0) {
+            argv[i]="-Z";
+            if (i + 2 < argc) {
+                if (*argv[i+1] == '-') {
+                    rodsLog (LOG_ERROR,
+                    "--pagecache-attr-timeout option takes a time argument");
+                    return USER_INPUT_OPTION_ERR;
+                }
+                pageCacheConfig->attrTimeout=atoi(argv[i+1]);
+                argv[i+1]="-Z";
+            }
+        }
+        if (strcmp("--dircache-timeout", argv[i])==0) {
+            argv[i]="-Z";
+            if (i + 2 < argc) {
+                if (*argv[i+1] == '-') {
+                    rodsLog (LOG_ERROR,
+                    "--dircache-timeout option takes a time argument");
+                    return USER_INPUT_OPTION_ERR;
+                }
+                dirCacheConfig->timeout=atoi(argv[i+1]);
+                argv[i+1]="-Z";
+            }
+        }
+        if (strcmp("--dircache-max-entries", argv[i])==0) {
+            argv[i]="-Z";
+            if (i + 2 < argc) {
+                if (*argv[i+1] == '-') {
+                    rodsLog (LOG_ERROR,
+                    "--dircache-max-entries option takes a number argument");
+                    return USER_INPUT_OPTION_ERR;
+                }
+                dirCacheConfig->maxEntries=atoi(argv[i+1]);
+                argv[i+1]="-Z";
+            }
+        }
+        if (strcmp("--connpool-max", argv[i])==0) {
+            argv[i]="-Z";
+            if (i + 2 < argc) {
+                if (*argv[i+1] == '-') {
+                    rodsLog (LOG_ERROR,
+                    "--connpool-max option takes a number argument");
+                    return USER_INPUT_OPTION_ERR;
+                }
+                connPoolConfig->maxConn=atoi(argv[i+1]);
+                argv[i+1]="-Z";
+            }
+        }
+        if (strcmp("--connpool-min", argv[i])==0) {
+            argv[i]="-Z";
+            if (i + 2 < argc) {
+                if (*argv[i+1] == '-') {
+                    rodsLog (LOG_ERROR,
+                    "--connpool-min option takes a number argument");
+                    return USER_INPUT_OPTION_ERR;
+                }
+                connPoolConfig->minConn=atoi(argv[i+1]);
+                argv[i+1]="-Z";
+            }
+        }
+        if (strcmp("--connpool-idle-timeout", argv[i])==0) {
+            argv[i]="-Z";
+            if (i + 2 < argc) {
+                if (*argv[i+1] == '-') {
+                    rodsLog (LOG_ERROR,
+                    "--connpool-idle-timeout option takes a time argument");
+                    return USER_INPUT_OPTION_ERR;
+                }
+                connPoolConfig->idleTimeout=atoi(argv[i+1]);
+                argv[i+1]="-Z";
+            }
+        }
+        if (strcmp("--connpool-check-interval", argv[i])==0) {
+            argv[i]="-Z";
+            if (i + 2 < argc) {
+                if (*argv[i+1] == '-') {
+                    rodsLog (LOG_ERROR,
+                    "--connpool-check-interval option takes a time argument");
+                    return USER_INPUT_OPTION_ERR;
+                }
+                connPoolConfig->checkInterval=atoi(argv[i+1]);
+                argv[i+1]="-Z";
+            }
+        }
+        if (strcmp("--connpool-redirect", argv[i])==0) {
+            connPoolConfig->redirect=True;
+            argv[i]="-Z";
+        }
 #ifdef ENABLE_PRELOAD
         if (strcmp("--preload", argv[i])==0) {
             preloadConfig->preload=True;
@@ -424,6 +818,64 @@ parseFuseSpecificCmdLineOpt (int argc, char **argv) {
                 argv[i+1]="-Z";
             }
         }
+        if (strcmp("--preload-workers", argv[i])==0) {
+            argv[i]="-Z";
+            if (i + 2 < argc) {
+                if (*argv[i+1] == '-') {
+                    rodsLog (LOG_ERROR,
+                    "--preload-workers option takes a number argument");
+                    return USER_INPUT_OPTION_ERR;
+                }
+                preloadConfig->preload=True;
+                preloadConfig->numWorkers=atoi(argv[i+1]);
+                argv[i+1]="-Z";
+            }
+        }
+        if (strcmp("--preload-queue-max", argv[i])==0) {
+            argv[i]="-Z";
+            if (i + 2 < argc) {
+                if (*argv[i+1] == '-') {
+                    rodsLog (LOG_ERROR,
+                    "--preload-queue-max option takes a number argument");
+                    return USER_INPUT_OPTION_ERR;
+                }
+                preloadConfig->preload=True;
+                preloadConfig->maxQueue=atoi(argv[i+1]);
+                argv[i+1]="-Z";
+            }
+        }
+        if (strcmp("--preload-mmap-max", argv[i])==0) {
+            argv[i]="-Z";
+            if (i + 2 < argc) {
+                if (*argv[i+1] == '-') {
+                    rodsLog (LOG_ERROR,
+                    "--preload-mmap-max option takes a size argument");
+                    return USER_INPUT_OPTION_ERR;
+                }
+                preloadConfig->preload=True;
+                preloadConfig->mmapMaxSize=strtoll(argv[i+1], 0, 0);
+                argv[i+1]="-Z";
+            }
+        }
+        if (strcmp("--preload-classify", argv[i])==0) {
+            preloadConfig->preload=True;
+            preloadConfig->classify=True;
+            argv[i]="-Z";
+        }
+        if (strcmp("--preload-reuse-window", argv[i])==0) {
+            argv[i]="-Z";
+            if (i + 2 < argc) {
+                if (*argv[i+1] == '-') {
+                    rodsLog (LOG_ERROR,
+                    "--preload-reuse-window option takes a time argument");
+                    return USER_INPUT_OPTION_ERR;
+                }
+                preloadConfig->preload=True;
+                preloadConfig->classify=True;
+                preloadConfig->reuseWindow=atoi(argv[i+1]);
+                argv[i+1]="-Z";
+            }
+        }
 #endif
 #ifdef ENABLE_LAZY_UPLOAD
         if (strcmp("--lazyupload", argv[i])==0) {
@@ -443,16 +895,335 @@ parseFuseSpecificCmdLineOpt (int argc, char **argv) {
                 argv[i+1]="-Z";
             }
         }
-#endif
-#ifdef ENABLE_TRACE
-
-        int rc = trace_read_arg( argc, argv, i );
-        if( rc != 0 ) {
-           return rc;
+        if (strcmp("--lazyupload-workers", argv[i])==0) {
+            argv[i]="-Z";
+            if (i + 2 < argc) {
+                if (*argv[i+1] == '-') {
+                    rodsLog (LOG_ERROR,
+                    "--lazyupload-workers option takes a number argument");
+                    return USER_INPUT_OPTION_ERR;
+                }
+                lazyUploadConfig->lazyUpload=True;
+                lazyUploadConfig->numWorkers=atoi(argv[i+1]);
+                argv[i+1]="-Z";
+            }
         }
-#endif
-    }
-
+        if (strcmp("--lazyupload-chunk-size", argv[i])==0) {
+            argv[i]="-Z";
+            if (i + 2 < argc) {
+                if (*argv[i+1] == '-') {
+                    rodsLog (LOG_ERROR,
+                    "--lazyupload-chunk-size option takes a size argument");
+                    return USER_INPUT_OPTION_ERR;
+                }
+                lazyUploadConfig->lazyUpload=True;
+                lazyUploadConfig->chunkSize=strtoll(argv[i+1], 0, 0);
+                argv[i+1]="-Z";
+            }
+        }
+#endif
+#ifdef ENABLE_READAHEAD
+        if (strcmp("--readahead", argv[i])==0) {
+            readaheadConfig->readahead=True;
+            argv[i]="-Z";
+        }
+        if (strcmp("--readahead-block-size", argv[i])==0) {
+            argv[i]="-Z";
+            if (i + 2 < argc) {
+                if (*argv[i+1] == '-') {
+                    rodsLog (LOG_ERROR,
+                    "--readahead-block-size option takes a size argument");
+                    return USER_INPUT_OPTION_ERR;
+                }
+                readaheadConfig->readahead=True;
+                readaheadConfig->blockSize=strtoll(argv[i+1], 0, 0);
+                argv[i+1]="-Z";
+            }
+        }
+        if (strcmp("--readahead-max-window", argv[i])==0) {
+            argv[i]="-Z";
+            if (i + 2 < argc) {
+                if (*argv[i+1] == '-') {
+                    rodsLog (LOG_ERROR,
+                    "--readahead-max-window option takes a number argument");
+                    return USER_INPUT_OPTION_ERR;
+                }
+                readaheadConfig->readahead=True;
+                readaheadConfig->maxWindow=atoi(argv[i+1]);
+                argv[i+1]="-Z";
+            }
+        }
+        if (strcmp("--readahead-workers", argv[i])==0) {
+            argv[i]="-Z";
+            if (i + 2 < argc) {
+                if (*argv[i+1] == '-') {
+                    rodsLog (LOG_ERROR,
+                    "--readahead-workers option takes a number argument");
+                    return USER_INPUT_OPTION_ERR;
+                }
+                readaheadConfig->readahead=True;
+                readaheadConfig->numWorkers=atoi(argv[i+1]);
+                argv[i+1]="-Z";
+            }
+        }
+        if (strcmp("--readahead-max-memory", argv[i])==0) {
+            argv[i]="-Z";
+            if (i + 2 < argc) {
+                if (*argv[i+1] == '-') {
+                    rodsLog (LOG_ERROR,
+                    "--readahead-max-memory option takes a size argument");
+                    return USER_INPUT_OPTION_ERR;
+                }
+                readaheadConfig->readahead=True;
+                readaheadConfig->maxMemory=strtoll(argv[i+1], 0, 0);
+                argv[i+1]="-Z";
+            }
+        }
+#endif
+#ifdef ENABLE_BLOCK_CACHE
+        if (strcmp("--blockcache", argv[i])==0) {
+            blockCacheConfig->blockCache=True;
+            argv[i]="-Z";
+        }
+        if (strcmp("--blockcache-clear-cache", argv[i])==0) {
+            blockCacheConfig->blockCache=True;
+            blockCacheConfig->clearCache=True;
+            argv[i]="-Z";
+        }
+        if (strcmp("--blockcache-dir", argv[i])==0) {
+            argv[i]="-Z";
+            if (i + 2 < argc) {
+                if (*argv[i+1] == '-') {
+                    rodsLog (LOG_ERROR,
+                    "--blockcache-dir option takes a directory argument");
+                    return USER_INPUT_OPTION_ERR;
+                }
+                blockCacheConfig->blockCache=True;
+                blockCacheConfig->cachePath=strdup(argv[i+1]);
+                argv[i+1]="-Z";
+            }
+        }
+        if (strcmp("--blockcache-block-size", argv[i])==0) {
+            argv[i]="-Z";
+            if (i + 2 < argc) {
+                if (*argv[i+1] == '-') {
+                    rodsLog (LOG_ERROR,
+                    "--blockcache-block-size option takes a size argument");
+                    return USER_INPUT_OPTION_ERR;
+                }
+                blockCacheConfig->blockCache=True;
+                blockCacheConfig->blockSize=strtoll(argv[i+1], 0, 0);
+                argv[i+1]="-Z";
+            }
+        }
+        if (strcmp("--blockcache-max", argv[i])==0) {
+            argv[i]="-Z";
+            if (i + 2 < argc) {
+                if (*argv[i+1] == '-') {
+                    rodsLog (LOG_ERROR,
+                    "--blockcache-max option takes a size argument");
+                    return USER_INPUT_OPTION_ERR;
+                }
+                blockCacheConfig->blockCache=True;
+                blockCacheConfig->cacheMaxSize=strtoll(argv[i+1], 0, 0);
+                argv[i+1]="-Z";
+            }
+        }
+#endif
+#ifdef ENABLE_WRITE_BUFFER
+        if (strcmp("--writebuffer", argv[i])==0) {
+            writeBufferConfig->writeBuffer=True;
+            argv[i]="-Z";
+        }
+        if (strcmp("--writebuffer-size", argv[i])==0) {
+            argv[i]="-Z";
+            if (i + 2 < argc) {
+                if (*argv[i+1] == '-') {
+                    rodsLog (LOG_ERROR,
+                    "--writebuffer-size option takes a size argument");
+                    return USER_INPUT_OPTION_ERR;
+                }
+                writeBufferConfig->writeBuffer=True;
+                writeBufferConfig->bufferSize=strtoll(argv[i+1], 0, 0);
+                argv[i+1]="-Z";
+            }
+        }
+        if (strcmp("--writebuffer-flush-interval", argv[i])==0) {
+            argv[i]="-Z";
+            if (i + 2 < argc) {
+                if (*argv[i+1] == '-') {
+                    rodsLog (LOG_ERROR,
+                    "--writebuffer-flush-interval option takes a number argument");
+                    return USER_INPUT_OPTION_ERR;
+                }
+                writeBufferConfig->writeBuffer=True;
+                writeBufferConfig->flushInterval=atoi(argv[i+1]);
+                argv[i+1]="-Z";
+            }
+        }
+#endif
+#ifdef ENABLE_RANGE_FETCH
+        if (strcmp("--rangefetch", argv[i])==0) {
+            rangeFetchConfig->rangeFetch=True;
+            argv[i]="-Z";
+        }
+        if (strcmp("--rangefetch-range-size", argv[i])==0) {
+            argv[i]="-Z";
+            if (i + 2 < argc) {
+                if (*argv[i+1] == '-') {
+                    rodsLog (LOG_ERROR,
+                    "--rangefetch-range-size option takes a size argument");
+                    return USER_INPUT_OPTION_ERR;
+                }
+                rangeFetchConfig->rangeFetch=True;
+                rangeFetchConfig->rangeSize=strtoll(argv[i+1], 0, 0);
+                argv[i+1]="-Z";
+            }
+        }
+        if (strcmp("--rangefetch-streams", argv[i])==0) {
+            argv[i]="-Z";
+            if (i + 2 < argc) {
+                if (*argv[i+1] == '-') {
+                    rodsLog (LOG_ERROR,
+                    "--rangefetch-streams option takes a number argument");
+                    return USER_INPUT_OPTION_ERR;
+                }
+                rangeFetchConfig->rangeFetch=True;
+                rangeFetchConfig->numStreams=atoi(argv[i+1]);
+                argv[i+1]="-Z";
+            }
+        }
+        if (strcmp("--rangefetch-min-size", argv[i])==0) {
+            argv[i]="-Z";
+            if (i + 2 < argc) {
+                if (*argv[i+1] == '-') {
+                    rodsLog (LOG_ERROR,
+                    "--rangefetch-min-size option takes a size argument");
+                    return USER_INPUT_OPTION_ERR;
+                }
+                rangeFetchConfig->rangeFetch=True;
+                rangeFetchConfig->minSize=strtoll(argv[i+1], 0, 0);
+                argv[i+1]="-Z";
+            }
+        }
+        if (strcmp("--rangefetch-retries", argv[i])==0) {
+            argv[i]="-Z";
+            if (i + 2 < argc) {
+                if (*argv[i+1] == '-') {
+                    rodsLog (LOG_ERROR,
+                    "--rangefetch-retries option takes a number argument");
+                    return USER_INPUT_OPTION_ERR;
+                }
+                rangeFetchConfig->rangeFetch=True;
+                rangeFetchConfig->maxRetries=atoi(argv[i+1]);
+                argv[i+1]="-Z";
+            }
+        }
+#endif
+#ifdef ENABLE_META_STORE
+        if (strcmp("--metastore", argv[i])==0) {
+            metaStoreConfig->metaStore=True;
+            argv[i]="-Z";
+        }
+        if (strcmp("--metastore-dir", argv[i])==0) {
+            argv[i]="-Z";
+            if (i + 2 < argc) {
+                if (*argv[i+1] == '-') {
+                    rodsLog (LOG_ERROR,
+                    "--metastore-dir option takes a directory argument");
+                    return USER_INPUT_OPTION_ERR;
+                }
+                metaStoreConfig->metaStore=True;
+                metaStoreConfig->cachePath=strdup(argv[i+1]);
+                argv[i+1]="-Z";
+            }
+        }
+        if (strcmp("--metastore-timeout", argv[i])==0) {
+            argv[i]="-Z";
+            if (i + 2 < argc) {
+                if (*argv[i+1] == '-') {
+                    rodsLog (LOG_ERROR,
+                    "--metastore-timeout option takes a number argument");
+                    return USER_INPUT_OPTION_ERR;
+                }
+                metaStoreConfig->metaStore=True;
+                metaStoreConfig->timeout=atoi(argv[i+1]);
+                argv[i+1]="-Z";
+            }
+        }
+        if (strcmp("--metastore-coll-check", argv[i])==0) {
+            metaStoreConfig->metaStore=True;
+            metaStoreConfig->collCheck=True;
+            argv[i]="-Z";
+        }
+        if (strcmp("--metastore-max-size", argv[i])==0) {
+            argv[i]="-Z";
+            if (i + 2 < argc) {
+                if (*argv[i+1] == '-') {
+                    rodsLog (LOG_ERROR,
+                    "--metastore-max-size option takes a size argument");
+                    return USER_INPUT_OPTION_ERR;
+                }
+                metaStoreConfig->metaStore=True;
+                metaStoreConfig->maxSize=strtoll(argv[i+1], 0, 0);
+                argv[i+1]="-Z";
+            }
+        }
+#endif
+#ifdef ENABLE_STAT_BATCH
+        if (strcmp("--statbatch", argv[i])==0) {
+            statBatchConfig->statBatch=True;
+            argv[i]="-Z";
+        }
+        if (strcmp("--statbatch-window", argv[i])==0) {
+            argv[i]="-Z";
+            if (i + 2 < argc) {
+                if (*argv[i+1] == '-') {
+                    rodsLog (LOG_ERROR,
+                    "--statbatch-window option takes a number argument");
+                    return USER_INPUT_OPTION_ERR;
+                }
+                statBatchConfig->statBatch=True;
+                statBatchConfig->window=atoi(argv[i+1]);
+                argv[i+1]="-Z";
+            }
+        }
+#endif
+#ifdef ENABLE_STATS
+        if (strcmp("--stats-dump", argv[i])==0) {
+            argv[i]="-Z";
+            if (i + 2 < argc) {
+                if (*argv[i+1] == '-') {
+                    rodsLog (LOG_ERROR,
+                    "--stats-dump option takes a file path argument");
+                    return USER_INPUT_OPTION_ERR;
+                }
+                statsConfig->dumpPath=strdup(argv[i+1]);
+                argv[i+1]="-Z";
+            }
+        }
+        if (strcmp("--stats-dump-interval", argv[i])==0) {
+            argv[i]="-Z";
+            if (i + 2 < argc) {
+                if (*argv[i+1] == '-') {
+                    rodsLog (LOG_ERROR,
+                    "--stats-dump-interval option takes a number argument");
+                    return USER_INPUT_OPTION_ERR;
+                }
+                statsConfig->dumpInterval=atoi(argv[i+1]);
+                argv[i+1]="-Z";
+            }
+        }
+#endif
+#ifdef ENABLE_TRACE
+
+        int rc = trace_read_arg( argc, argv, i );
+        if( rc != 0 ) {
+           return rc;
+        }
+#endif
+    }
+
     // set default
 #ifdef ENABLE_PRELOAD
     if(preloadConfig->cachePath == NULL) {
@@ -465,12 +1236,111 @@ parseFuseSpecificCmdLineOpt (int argc, char **argv) {
         rodsLog (LOG_DEBUG, "parseFuseSpecificCmdLineOpt: uses default min size %lld - (given %lld)", MAX_READ_CACHE_SIZE, preloadConfig->preloadMinSize);
         preloadConfig->preloadMinSize = MAX_READ_CACHE_SIZE;
     }
+
+    if(preloadConfig->numWorkers <= 0) {
+        preloadConfig->numWorkers = PRELOAD_DEFAULT_NUM_WORKERS;
+    }
+
+    if(preloadConfig->maxQueue <= 0) {
+        preloadConfig->maxQueue = PRELOAD_DEFAULT_MAX_QUEUE;
+    }
+
+    if(preloadConfig->reuseWindow <= 0) {
+        preloadConfig->reuseWindow = PRELOAD_DEFAULT_REUSE_WINDOW;
+    }
 #endif
 #ifdef ENABLE_LAZY_UPLOAD
     if(lazyUploadConfig->bufferPath == NULL) {
         rodsLog (LOG_DEBUG, "parseFuseSpecificCmdLineOpt: uses default lazy-upload buffer dir - %s", FUSE_LAZY_UPLOAD_BUFFER_DIR);
         lazyUploadConfig->bufferPath=strdup(FUSE_LAZY_UPLOAD_BUFFER_DIR);
     }
+
+    if(lazyUploadConfig->numWorkers <= 0) {
+        lazyUploadConfig->numWorkers = LAZY_UPLOAD_DEFAULT_NUM_WORKERS;
+    }
+
+    if(lazyUploadConfig->chunkSize <= 0) {
+        lazyUploadConfig->chunkSize = LAZY_UPLOAD_DEFAULT_CHUNK_SIZE;
+    }
+#endif
+#ifdef ENABLE_READAHEAD
+    if(readaheadConfig->blockSize <= 0) {
+        readaheadConfig->blockSize = READAHEAD_DEFAULT_BLOCK_SIZE;
+    }
+    if(readaheadConfig->maxWindow <= 0) {
+        readaheadConfig->maxWindow = READAHEAD_DEFAULT_MAX_WINDOW;
+    }
+    if(readaheadConfig->maxWindow < READAHEAD_INIT_WINDOW) {
+        readaheadConfig->maxWindow = READAHEAD_INIT_WINDOW;
+    }
+    if(readaheadConfig->numWorkers <= 0) {
+        readaheadConfig->numWorkers = READAHEAD_DEFAULT_NUM_WORKERS;
+    }
+    if(readaheadConfig->maxMemory <= 0) {
+        readaheadConfig->maxMemory = READAHEAD_DEFAULT_MAX_MEMORY;
+    }
+#endif
+#ifdef ENABLE_BLOCK_CACHE
+    if(blockCacheConfig->cachePath == NULL) {
+        rodsLog (LOG_DEBUG, "parseFuseSpecificCmdLineOpt: uses default block cache dir - %s", FUSE_BLOCK_CACHE_DIR);
+        blockCacheConfig->cachePath=strdup(FUSE_BLOCK_CACHE_DIR);
+    }
+    if(blockCacheConfig->blockSize <= 0) {
+        blockCacheConfig->blockSize = BLOCK_CACHE_DEFAULT_BLOCK_SIZE;
+    }
+#endif
+#ifdef ENABLE_WRITE_BUFFER
+    if(writeBufferConfig->bufferSize <= 0) {
+        writeBufferConfig->bufferSize = WRITE_BUFFER_DEFAULT_SIZE;
+    }
+    if(writeBufferConfig->bufferSize > WRITE_BUFFER_MAX_SIZE) {
+        // a flush is sent as one write request
+        rodsLog (LOG_DEBUG, "parseFuseSpecificCmdLineOpt: uses max write buffer size %d - (given %lld)", WRITE_BUFFER_MAX_SIZE, writeBufferConfig->bufferSize);
+        writeBufferConfig->bufferSize = WRITE_BUFFER_MAX_SIZE;
+    }
+    if(writeBufferConfig->flushInterval <= 0) {
+        writeBufferConfig->flushInterval = WRITE_BUFFER_DEFAULT_FLUSH_INTERVAL;
+    }
+#endif
+#ifdef ENABLE_RANGE_FETCH
+    if(rangeFetchConfig->rangeSize <= 0) {
+        rangeFetchConfig->rangeSize = RANGE_FETCH_DEFAULT_RANGE_SIZE;
+    }
+    if(rangeFetchConfig->numStreams <= 0) {
+        rangeFetchConfig->numStreams = RANGE_FETCH_DEFAULT_NUM_STREAMS;
+    }
+    if(rangeFetchConfig->numStreams > RANGE_FETCH_MAX_STREAMS) {
+        rodsLog (LOG_DEBUG, "parseFuseSpecificCmdLineOpt: uses max range fetch streams %d - (given %d)", RANGE_FETCH_MAX_STREAMS, rangeFetchConfig->numStreams);
+        rangeFetchConfig->numStreams = RANGE_FETCH_MAX_STREAMS;
+    }
+    if(rangeFetchConfig->minSize <= 0) {
+        rangeFetchConfig->minSize = RANGE_FETCH_DEFAULT_MIN_SIZE;
+    }
+    if(rangeFetchConfig->maxRetries < 0) {
+        rangeFetchConfig->maxRetries = RANGE_FETCH_DEFAULT_MAX_RETRIES;
+    }
+#endif
+#ifdef ENABLE_META_STORE
+    if(metaStoreConfig->cachePath == NULL) {
+        rodsLog (LOG_DEBUG, "parseFuseSpecificCmdLineOpt: uses default metadata store dir - %s", FUSE_META_STORE_DIR);
+        metaStoreConfig->cachePath=strdup(FUSE_META_STORE_DIR);
+    }
+    if(metaStoreConfig->timeout < 0) {
+        metaStoreConfig->timeout = META_STORE_DEFAULT_TIMEOUT;
+    }
+    if(metaStoreConfig->maxSize <= 0) {
+        metaStoreConfig->maxSize = META_STORE_DEFAULT_MAX_SIZE;
+    }
+#endif
+#ifdef ENABLE_STAT_BATCH
+    if(statBatchConfig->window < 0) {
+        statBatchConfig->window = STAT_BATCH_DEFAULT_WINDOW;
+    }
+#endif
+#ifdef ENABLE_STATS
+    if(statsConfig->dumpInterval <= 0) {
+        statsConfig->dumpInterval = STATS_DEFAULT_DUMP_INTERVAL;
+    }
 #endif
 
     return(0);
@@ -526,6 +1396,42 @@ releaseCmdLineOpt (int argc, char **argv) {
     return(0);
 }
 
+void
+logPathCacheStats () {
+    pathCacheStats_t stats;
+
+    if (getPathCacheStats (pctable, &stats) < 0) {
+        return;
+    }
+
+    rodsLog (LOG_NOTICE, "path cache: %lld entries, %lld non-existing entries, %lld hits, %lld non-existing hits, %lld misses, %lld evictions, %lld expirations",
+        stats.entries, stats.nonExistEntries, stats.hits, stats.nonExistHits, stats.misses, stats.evictions, stats.expirations);
+}
+
+void
+logDirCacheStats () {
+    dirCacheStats_t stats;
+
+    if (getDirCacheStats (&stats) < 0) {
+        return;
+    }
+
+    rodsLog (LOG_NOTICE, "directory cache: %lld listings, %lld entries, %lld hits, %lld misses, %lld evictions, %lld expirations, %lld invalidations",
+        stats.listings, stats.entries, stats.hits, stats.misses, stats.evictions, stats.expirations, stats.invalidations);
+}
+
+void
+logConnPoolStats () {
+    connPoolStats_t stats;
+
+    if (getConnPoolStats (&stats) < 0) {
+        return;
+    }
+
+    rodsLog (LOG_NOTICE, "connection pool: %lld hosts, %lld connections, %lld created, %lld prewarmed, %lld reused, %lld waits, %lld handoffs, %lld checks, %lld check failures, %lld reaped, %lld redirects",
+        stats.hosts, stats.connections, stats.created, stats.prewarmed, stats.reused, stats.waits, stats.handoffs, stats.checks, stats.checkFailures, stats.reaped, stats.redirects);
+}
+
 void
 usage() {
    char *msgs[]={
@@ -535,6 +1441,28 @@ usage() {
 " -h  this help",
 " -d  FUSE debug mode",
 " -o  opt,[opt...]  FUSE mount options",
+" ",
+"Extended Options for Path Cache",
+" --pathcache-max-entries  specify max number of cached paths (default 100000)",
+" --pathcache-timeout      specify seconds before a cached path expires (default 600, 0 for never)",
+" --pathcache-negative-timeout  specify seconds a non-existing path is remembered (default 5, 0 to disable)",
+" --pathcache-shards       specify number of independently locked cache shards (default 16)",
+" --dircache-timeout       specify seconds a directory listing is reused (default 60, 0 to disable)",
+" --dircache-max-entries   specify max number of names in cached listings (default 200000)",
+" ",
+"Extended Options for Page Cache",
+" --pagecache-check        keep the kernel's cached pages of a file at open if its mtime and size",
+"                          on the server are the same as at its last open",
+" --pagecache-immutable    specify colon separated collections whose files never change,",
+"                          their cached pages are always kept",
+" --pagecache-attr-timeout specify seconds the kernel caches attributes and lookups (default 1)",
+" ",
+"Extended Options for Connection Pool",
+" --connpool-max           specify max number of connections per server host (default 10)",
+" --connpool-min           specify number of connections kept to the iRODS host (default 1)",
+" --connpool-idle-timeout  specify seconds an unneeded idle connection is kept (default 120)",
+" --connpool-check-interval  specify seconds between checks of idle connections (default 60, 0 to disable)",
+" --connpool-redirect      open data objects on the resource server holding them",
 
 #ifdef ENABLE_PRELOAD
 " ",
@@ -544,12 +1472,77 @@ usage() {
 " --preload-cache-dir      specify preload cache directory",
 " --preload-cache-max      specify preload cache max limit (in bytes)", 
 " --preload-file-min       specify minimum file size that will be preloaded (in bytes)",
+" --preload-workers        specify number of preload threads (default 4)",
+" --preload-queue-max      specify max number of files waiting to be preloaded (default 1024)",
+" --preload-mmap-max       serve preloaded files up to this size from mmap (in bytes, default 0: never)",
+" --preload-classify       preload only files opened again, stream the others past the caches",
+" --preload-reuse-window   specify sec within which a reopen counts as reuse (default 86400)",
 #endif
 #ifdef ENABLE_LAZY_UPLOAD
 " ",
 "Extended Options for LazyUpload",
 " --lazyupload             use lazy-upload",
 " --lazyupload-buffer-dir  specify lazy-upload buffer directory",
+" --lazyupload-workers     specify number of threads streaming buffered data (default 4)",
+" --lazyupload-chunk-size  specify size of a streamed chunk (in bytes, default 8MB)",
+#endif
+#ifdef ENABLE_READAHEAD
+" ",
+"Extended Options for Readahead",
+" --readahead              prefetch sequentially read files in the background",
+" --readahead-block-size   specify prefetch block size (in bytes)",
+" --readahead-max-window   specify max number of blocks prefetched per open file",
+" --readahead-workers      specify number of prefetch threads",
+" --readahead-max-memory   specify max memory for prefetched blocks (in bytes)",
+#endif
+#ifdef ENABLE_BLOCK_CACHE
+" ",
+"Extended Options for Block Cache",
+" --blockcache             cache the parts of large files that are read, in blocks",
+" --blockcache-clear-cache clear block caches",
+" --blockcache-dir         specify block cache directory",
+" --blockcache-block-size  specify block size (in bytes, default 4mb)",
+" --blockcache-max         specify block cache max limit (in bytes)",
+#endif
+#ifdef ENABLE_WRITE_BUFFER
+" ",
+"Extended Options for WriteBuffer",
+" --writebuffer            coalesce small writes into large write requests",
+" --writebuffer-size       specify write buffer size per open file (in bytes, default 8mb, max 32mb)",
+" --writebuffer-flush-interval  specify seconds buffered data may wait before it is sent (default 5)",
+#endif
+#ifdef ENABLE_RANGE_FETCH
+" ",
+"Extended Options for Range Fetch",
+" --rangefetch             fetch large files for preload and block cache in parallel ranges",
+" --rangefetch-range-size  specify range size (in bytes, default 16mb)",
+" --rangefetch-streams     specify concurrent streams per file (default 4, max 32)",
+" --rangefetch-min-size    specify size from which files are fetched in ranges (in bytes, default 64mb)",
+" --rangefetch-retries     specify times a failed range is resumed on a new connection (default 3)",
+#endif
+#ifdef ENABLE_META_STORE
+" ",
+"Extended Options for Metadata Store",
+" --metastore              keep the stats of paths on disk, so a new mount starts with them",
+" --metastore-dir          specify metadata store directory",
+" --metastore-timeout      specify seconds a stored stat is trusted (default 3600, 0 means forever)",
+" --metastore-coll-check   trust older stats while their collection's mtime is unchanged,",
+"                          one stat of the collection per timeout checks all of its entries",
+"                          (objects rewritten in place are not noticed)",
+" --metastore-max-size     specify metadata store max size (in bytes, default 256mb)",
+#endif
+#ifdef ENABLE_STAT_BATCH
+" ",
+"Extended Options for Stat Batch",
+" --statbatch              stat paths missing from the cache in the same collection together",
+" --statbatch-window       specify usec the first miss in a collection waits for others (default 1000)",
+#endif
+#ifdef ENABLE_STATS
+" ",
+"Extended Options for Stats",
+" operation and request latencies can be read from /.irodsfs/stats in the mount",
+" --stats-dump             specify a file the stats are written to periodically",
+" --stats-dump-interval    specify seconds between stats dumps (default 60)",
 #endif
 #ifdef ENABLE_TRACE
 " ",
@@ -560,6 +1553,8 @@ usage() {
 " --trace-port PORTNUM     Connect to the trace host on port PORTNUM",
 " --trace-timeout SECONDS  Number of seconds to wait before giving up connecting to the trace host",
 " --trace-sync-delay SECONDS   Number of seconds between sending trace snapshots",
+" --trace-format [text|binary] Write gzip'ed text logs or compact binary traces",
+" --trace-max-records COUNT    Number of operations per binary trace file",
 #endif
 ""};
     int i;
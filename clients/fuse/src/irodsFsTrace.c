@@ -0,0 +1,287 @@
+/* irodsFsTrace.c - decode and summarize the binary traces of irodsFs
+ * (--trace-format binary). it reads the trace files offline and needs
+ * neither a mount nor a connection.
+ */
+
+#include <errno.h>
+#include <inttypes.h>
+
+#include "iFuseLib.BinLog.h"
+
+// the TRACE_* methods, by bit number
+static char const* trace_op_names[] = {
+   "getattr", "readlink", "mknod", "mkdir", "unlink", "rmdir", "symlink",
+   "rename", "link", "chmod", "chown", "truncate", "flush", "utimens",
+   "open", "read", "write", "statfs", "release", "fsync", "readdir"
+};
+
+#define TRACE_NUM_OPS (sizeof(trace_op_names) / sizeof(trace_op_names[0]))
+#define TRACE_OP_READ   15
+#define TRACE_OP_WRITE  16
+
+struct trace_op_summary {
+   uint64_t count;
+   uint64_t errors;
+   uint64_t bytes;
+   uint64_t total_us;
+   uint32_t* durations;
+   uint64_t durations_len;
+   uint64_t durations_size;
+};
+
+struct trace_summary {
+   struct trace_op_summary ops[TRACE_NUM_OPS + 1];     // the last one takes unknown ops
+   uint64_t records;
+   uint64_t dropped;
+   uint64_t first_ns;
+   uint64_t last_ns;
+};
+
+static char const* trace_op_name( uint8_t op ) {
+   if( op < TRACE_NUM_OPS ) {
+      return trace_op_names[op];
+   }
+   return "unknown";
+}
+
+static int trace_summary_add( struct trace_summary* summary, uint64_t realtime_ns, uint32_t duration_us, uint8_t op, int32_t rc ) {
+
+   struct trace_op_summary* op_summary = &summary->ops[ op < TRACE_NUM_OPS ? op : TRACE_NUM_OPS ];
+
+   if( op_summary->durations_len == op_summary->durations_size ) {
+
+      uint64_t new_size = op_summary->durations_size > 0 ? op_summary->durations_size * 2 : 1024;
+      uint32_t* new_durations = (uint32_t*)realloc( op_summary->durations, new_size * sizeof(uint32_t) );
+      if( new_durations == NULL ) {
+         return -ENOMEM;
+      }
+
+      op_summary->durations = new_durations;
+      op_summary->durations_size = new_size;
+   }
+
+   op_summary->durations[ op_summary->durations_len++ ] = duration_us;
+   op_summary->count++;
+   op_summary->total_us += duration_us;
+
+   if( rc < 0 ) {
+      op_summary->errors++;
+   }
+   else if( op == TRACE_OP_READ || op == TRACE_OP_WRITE ) {
+      // rc is the number of bytes moved
+      op_summary->bytes += rc;
+   }
+
+   if( summary->records == 0 || realtime_ns < summary->first_ns ) {
+      summary->first_ns = realtime_ns;
+   }
+   if( realtime_ns > summary->last_ns ) {
+      summary->last_ns = realtime_ns;
+   }
+   summary->records++;
+
+   return 0;
+}
+
+static int trace_compare_u32( void const* a, void const* b ) {
+   uint32_t x = *(uint32_t const*)a;
+   uint32_t y = *(uint32_t const*)b;
+   return x < y ? -1 : (x > y ? 1 : 0);
+}
+
+static uint32_t trace_percentile( struct trace_op_summary* op_summary, double percentile ) {
+
+   if( op_summary->durations_len == 0 ) {
+      return 0;
+   }
+
+   uint64_t rank = (uint64_t)(op_summary->durations_len * percentile / 100.0);
+   if( rank >= op_summary->durations_len ) {
+      rank = op_summary->durations_len - 1;
+   }
+
+   return op_summary->durations[rank];
+}
+
+static void trace_summary_print( struct trace_summary* summary ) {
+
+   printf("# %" PRIu64 " operations over %.3f sec, %" PRIu64 " dropped, times in usec\n",
+          summary->records, summary->records > 0 ? (summary->last_ns - summary->first_ns) / 1e9 : 0.0, summary->dropped );
+   printf("%-10s %12s %10s %16s %10s %10s %10s %10s %10s\n", "# op", "count", "errors", "bytes", "avg", "p50", "p90", "p99", "max" );
+
+   for( unsigned int i = 0; i <= TRACE_NUM_OPS; i++ ) {
+
+      struct trace_op_summary* op_summary = &summary->ops[i];
+      if( op_summary->count == 0 ) {
+         continue;
+      }
+
+      qsort( op_summary->durations, op_summary->durations_len, sizeof(uint32_t), trace_compare_u32 );
+
+      printf("%-10s %12" PRIu64 " %10" PRIu64 " %16" PRIu64 " %10" PRIu64 " %10u %10u %10u %10u\n",
+             i < TRACE_NUM_OPS ? trace_op_names[i] : "unknown",
+             op_summary->count, op_summary->errors, op_summary->bytes,
+             op_summary->total_us / op_summary->count,
+             trace_percentile( op_summary, 50.0 ),
+             trace_percentile( op_summary, 90.0 ),
+             trace_percentile( op_summary, 99.0 ),
+             op_summary->durations[ op_summary->durations_len - 1 ] );
+
+      free( op_summary->durations );
+      op_summary->durations = NULL;
+   }
+}
+
+// read one trace file, printing its records or adding them to summary
+static int trace_read_file( char const* path, struct trace_summary* summary ) {
+
+   struct binlog_file_header header;
+   struct binlog_block_header block;
+   int rc = 0;
+
+   FILE* f = fopen( path, "r" );
+   if( f == NULL ) {
+      rc = -errno;
+      fprintf(stderr, "failed to open %s, errno = %d\n", path, rc );
+      return rc;
+   }
+
+   if( fread( &header, sizeof(header), 1, f ) != 1 ||
+       memcmp( header.magic, BINLOG_MAGIC, sizeof(header.magic) ) != 0 ) {
+
+      fprintf(stderr, "%s is not a binary trace\n", path );
+      fclose( f );
+      return -EINVAL;
+   }
+
+   if( header.version != BINLOG_VERSION || header.record_size != sizeof(struct binlog_record) ) {
+
+      fprintf(stderr, "%s: unsupported version %u or record size %u\n", path, header.version, header.record_size );
+      fclose( f );
+      return -EINVAL;
+   }
+
+   uint64_t* start_ns = (uint64_t*)malloc( BINLOG_BLOCK_RECORDS * sizeof(uint64_t) );
+   uint32_t* duration_us = (uint32_t*)malloc( BINLOG_BLOCK_RECORDS * sizeof(uint32_t) );
+   uint8_t* op = (uint8_t*)malloc( BINLOG_BLOCK_RECORDS * sizeof(uint8_t) );
+   uint32_t* tid = (uint32_t*)malloc( BINLOG_BLOCK_RECORDS * sizeof(uint32_t) );
+   int32_t* op_rc = (int32_t*)malloc( BINLOG_BLOCK_RECORDS * sizeof(int32_t) );
+   uint64_t* path_hash = (uint64_t*)malloc( BINLOG_BLOCK_RECORDS * sizeof(uint64_t) );
+   uint64_t* size = (uint64_t*)malloc( BINLOG_BLOCK_RECORDS * sizeof(uint64_t) );
+   int64_t* offset = (int64_t*)malloc( BINLOG_BLOCK_RECORDS * sizeof(int64_t) );
+
+   if( start_ns == NULL || duration_us == NULL || op == NULL || tid == NULL ||
+       op_rc == NULL || path_hash == NULL || size == NULL || offset == NULL ) {
+      rc = -ENOMEM;
+   }
+
+   while( rc == 0 && fread( &block, sizeof(block), 1, f ) == 1 ) {
+
+      uint32_t n = block.num_records;
+
+      if( block.magic != BINLOG_BLOCK_MAGIC || n > BINLOG_BLOCK_RECORDS ) {
+         fprintf(stderr, "%s: corrupt block\n", path );
+         rc = -EINVAL;
+         break;
+      }
+
+      if( fread( start_ns, sizeof(uint64_t), n, f ) != n ||
+          fread( duration_us, sizeof(uint32_t), n, f ) != n ||
+          fread( op, sizeof(uint8_t), n, f ) != n ||
+          fread( tid, sizeof(uint32_t), n, f ) != n ||
+          fread( op_rc, sizeof(int32_t), n, f ) != n ||
+          fread( path_hash, sizeof(uint64_t), n, f ) != n ||
+          fread( size, sizeof(uint64_t), n, f ) != n ||
+          fread( offset, sizeof(int64_t), n, f ) != n ) {
+
+         // the last block of a file still being written
+         fprintf(stderr, "%s: truncated block\n", path );
+         break;
+      }
+
+      if( summary != NULL ) {
+         summary->dropped += block.dropped;
+      }
+      else if( block.dropped > 0 ) {
+         printf("# %" PRIu64 " dropped\n", block.dropped );
+      }
+
+      for( uint32_t i = 0; i < n && rc == 0; i++ ) {
+
+         uint64_t realtime_ns = header.start_realtime_ns + (start_ns[i] - header.start_monotonic_ns);
+
+         if( summary != NULL ) {
+            rc = trace_summary_add( summary, realtime_ns, duration_us[i], op[i], op_rc[i] );
+         }
+         else {
+            printf("%" PRIu64 ".%09" PRIu64 " %u %s %016" PRIx64 " %" PRIu64 " %" PRId64 " %d %u\n",
+                   realtime_ns / UINT64_C(1000000000), realtime_ns % UINT64_C(1000000000), tid[i], trace_op_name(op[i]),
+                   path_hash[i], size[i], offset[i], op_rc[i], duration_us[i] );
+         }
+      }
+   }
+
+   free( start_ns );
+   free( duration_us );
+   free( op );
+   free( tid );
+   free( op_rc );
+   free( path_hash );
+   free( size );
+   free( offset );
+
+   fclose( f );
+   return rc;
+}
+
+static void usage( char const* progname ) {
+   fprintf(stderr,
+"Usage: %s [-s] trace_file ...\n"
+"Decode the binary traces written by irodsFs --trace-format binary.\n"
+"By default every operation is printed as\n"
+"  time tid op path_hash size offset rc duration_usec\n"
+"Options:\n"
+" -s  print a summary of the operations instead\n"
+" -h  this help\n", progname );
+}
+
+int main( int argc, char** argv ) {
+
+   struct trace_summary* summary = NULL;
+   int c;
+   int rc = 0;
+
+   while( (c = getopt( argc, argv, "sh" )) != -1 ) {
+      switch( c ) {
+         case 's':
+            if( summary == NULL ) {
+               summary = (struct trace_summary*)calloc( sizeof(struct trace_summary), 1 );
+            }
+            break;
+         case 'h':
+            usage( argv[0] );
+            return 0;
+         default:
+            usage( argv[0] );
+            return 1;
+      }
+   }
+
+   if( optind >= argc ) {
+      usage( argv[0] );
+      return 1;
+   }
+
+   for( int i = optind; i < argc; i++ ) {
+      if( trace_read_file( argv[i], summary ) != 0 ) {
+         rc = 2;
+      }
+   }
+
+   if( summary != NULL ) {
+      trace_summary_print( summary );
+      free( summary );
+   }
+
+   return rc;
+}
@@ -0,0 +1,339 @@
+#!/usr/bin/python
+#
+# Performance benchmark of the FUSE client, fio style.
+#
+# Runs sequential/random read/write, a metadata storm, a large readdir and
+# many small files in a directory, prints the results as JSON and compares
+# them with a baseline run. A regression beyond the tolerance fails the run
+# with exit code 1.
+#
+# The directory is either an irodsFs mount made by this script (--mount)
+# against the server in the iRODS environment, e.g. a local one, or any
+# directory given with --dir. A local directory stands in for the server
+# to check the harness itself and to get the numbers of the kernel alone.
+#
+#   ./bench.py --mount /tmp/fmnt --fuse-opts "--preload" --json out.json
+#   ./bench.py --mount /tmp/fmnt --baseline out.json --tolerance 15
+#   ./bench.py --dir /tmp/local --workloads seq-write,seq-read
+#
+from __future__ import print_function
+import json
+import optparse
+import os
+import random
+import shutil
+import subprocess
+import sys
+import time
+
+WORKLOADS = ['seq-write', 'seq-read', 'rand-read', 'rand-write',
+             'meta-storm', 'readdir-large', 'small-files']
+
+# metrics compared with the baseline, by the direction that is better
+HIGHER_IS_BETTER = ('mb_per_sec', 'ops_per_sec', 'files_per_sec', 'entries_per_sec')
+LOWER_IS_BETTER = ('lat_p50_ms', 'lat_p99_ms', 'sec')
+
+
+def now():
+    return time.time()
+
+
+def percentile(values, p):
+    if not values:
+        return 0.0
+    values = sorted(values)
+    k = int(round((len(values) - 1) * p / 100.0))
+    return values[k]
+
+
+def latency_stats(lats):
+    return {'lat_p50_ms': round(percentile(lats, 50) * 1000, 3),
+            'lat_p99_ms': round(percentile(lats, 99) * 1000, 3)}
+
+
+def block_of(size):
+    # not compressible, so nothing in the way makes it cheap
+    return os.urandom(size)
+
+
+class Bench:
+    def __init__(self, workdir, opts):
+        self.workdir = workdir
+        self.opts = opts
+        self.size = opts.size * 1024 * 1024
+        self.block = opts.block * 1024
+        self.bigfile = os.path.join(workdir, 'bench.big')
+
+    def seq_write(self):
+        buf = block_of(self.block)
+        start = now()
+        fd = os.open(self.bigfile, os.O_WRONLY | os.O_CREAT | os.O_TRUNC, 0o644)
+        written = 0
+        while written < self.size:
+            written += os.write(fd, buf)
+        os.close(fd)
+        sec = now() - start
+        return {'mb_per_sec': round(written / sec / 1048576, 2), 'sec': round(sec, 3)}
+
+    def seq_read(self):
+        self._ensure_bigfile()
+        start = now()
+        fd = os.open(self.bigfile, os.O_RDONLY)
+        total = 0
+        while True:
+            data = os.read(fd, self.block)
+            if not data:
+                break
+            total += len(data)
+        os.close(fd)
+        sec = now() - start
+        return {'mb_per_sec': round(total / sec / 1048576, 2), 'sec': round(sec, 3)}
+
+    def rand_read(self):
+        self._ensure_bigfile()
+        rnd = random.Random(self.opts.seed)
+        blocks = max(1, self.size // self.block)
+        lats = []
+        fd = os.open(self.bigfile, os.O_RDONLY)
+        start = now()
+        for i in range(self.opts.ops):
+            t = now()
+            os.lseek(fd, rnd.randrange(blocks) * self.block, os.SEEK_SET)
+            os.read(fd, self.block)
+            lats.append(now() - t)
+        sec = now() - start
+        os.close(fd)
+        result = {'ops_per_sec': round(self.opts.ops / sec, 2), 'sec': round(sec, 3)}
+        result.update(latency_stats(lats))
+        return result
+
+    def rand_write(self):
+        self._ensure_bigfile()
+        rnd = random.Random(self.opts.seed)
+        blocks = max(1, self.size // self.block)
+        buf = block_of(self.block)
+        lats = []
+        fd = os.open(self.bigfile, os.O_WRONLY)
+        start = now()
+        for i in range(self.opts.ops):
+            t = now()
+            os.lseek(fd, rnd.randrange(blocks) * self.block, os.SEEK_SET)
+            os.write(fd, buf)
+            lats.append(now() - t)
+        os.close(fd)
+        sec = now() - start
+        result = {'ops_per_sec': round(self.opts.ops / sec, 2), 'sec': round(sec, 3)}
+        result.update(latency_stats(lats))
+        return result
+
+    def meta_storm(self):
+        d = self._fresh_dir('meta')
+        names = [os.path.join(d, 'm%06d' % i) for i in range(self.opts.files)]
+        result = {}
+        for phase in ('create', 'stat', 'unlink'):
+            lats = []
+            start = now()
+            for name in names:
+                t = now()
+                if phase == 'create':
+                    os.close(os.open(name, os.O_WRONLY | os.O_CREAT | os.O_TRUNC, 0o644))
+                elif phase == 'stat':
+                    os.stat(name)
+                else:
+                    os.unlink(name)
+                lats.append(now() - t)
+            sec = now() - start
+            result[phase] = {'ops_per_sec': round(len(names) / sec, 2)}
+            result[phase].update(latency_stats(lats))
+        os.rmdir(d)
+        return result
+
+    def readdir_large(self):
+        d = self._fresh_dir('readdir')
+        for i in range(self.opts.entries):
+            os.close(os.open(os.path.join(d, 'e%06d' % i), os.O_WRONLY | os.O_CREAT, 0o644))
+        result = {}
+        # the first listing is served by the server, the next ones may be cached
+        for run in ('cold', 'warm'):
+            start = now()
+            entries = os.listdir(d)
+            for name in entries:
+                os.lstat(os.path.join(d, name))
+            sec = now() - start
+            if len(entries) != self.opts.entries:
+                raise RuntimeError('readdir-large: %d entries listed, %d expected'
+                                   % (len(entries), self.opts.entries))
+            result[run] = {'entries_per_sec': round(len(entries) / sec, 2), 'sec': round(sec, 3)}
+        shutil.rmtree(d)
+        return result
+
+    def small_files(self):
+        d = self._fresh_dir('small')
+        buf = block_of(self.opts.small_size * 1024)
+        names = [os.path.join(d, 's%06d' % i) for i in range(self.opts.files)]
+        result = {}
+        start = now()
+        for name in names:
+            fd = os.open(name, os.O_WRONLY | os.O_CREAT | os.O_TRUNC, 0o644)
+            os.write(fd, buf)
+            os.close(fd)
+        sec = now() - start
+        result['write'] = {'files_per_sec': round(len(names) / sec, 2), 'sec': round(sec, 3)}
+        start = now()
+        for name in names:
+            fd = os.open(name, os.O_RDONLY)
+            data = os.read(fd, len(buf) + 1)
+            os.close(fd)
+            if len(data) != len(buf):
+                raise RuntimeError('small-files: %s has %d bytes, %d expected'
+                                   % (name, len(data), len(buf)))
+        sec = now() - start
+        result['read'] = {'files_per_sec': round(len(names) / sec, 2), 'sec': round(sec, 3)}
+        shutil.rmtree(d)
+        return result
+
+    def cleanup(self):
+        if os.path.exists(self.bigfile):
+            os.unlink(self.bigfile)
+
+    def _ensure_bigfile(self):
+        try:
+            if os.stat(self.bigfile).st_size >= self.size:
+                return
+        except OSError:
+            pass
+        self.seq_write()
+
+    def _fresh_dir(self, name):
+        d = os.path.join(self.workdir, 'bench.' + name)
+        if os.path.exists(d):
+            shutil.rmtree(d)
+        os.mkdir(d)
+        return d
+
+
+def flatten(results, prefix=''):
+    flat = {}
+    for key, value in results.items():
+        name = prefix + '.' + key if prefix else key
+        if isinstance(value, dict):
+            flat.update(flatten(value, name))
+        else:
+            flat[name] = value
+    return flat
+
+
+def compare(results, baseline, tolerance):
+    """returns the metrics worse than the baseline by more than tolerance percent"""
+    regressions = []
+    current = flatten(results)
+    base = flatten(baseline)
+    for name in sorted(current):
+        if name not in base or not base[name]:
+            continue
+        metric = name.split('.')[-1]
+        change = (current[name] - base[name]) * 100.0 / base[name]
+        if metric in HIGHER_IS_BETTER and change < -tolerance:
+            regressions.append((name, base[name], current[name], change))
+        elif metric in LOWER_IS_BETTER and change > tolerance:
+            regressions.append((name, base[name], current[name], change))
+    return regressions
+
+
+def mount(opts):
+    irodsfs = opts.irodsfs
+    if irodsfs is None:
+        irodsfs = os.path.join(os.environ.get('IRODS_HOME', '.'), 'clients/fuse/bin/irodsFs')
+    if not os.path.isdir(opts.mount):
+        os.makedirs(opts.mount)
+    cmd = [irodsfs, opts.mount] + opts.fuse_opts.split()
+    subprocess.check_call(cmd)
+    # irodsFs returns once it is daemonized, wait for the mount to show up
+    for i in range(100):
+        if os.path.ismount(opts.mount):
+            return
+        time.sleep(0.1)
+    raise RuntimeError('%s did not mount %s' % (irodsfs, opts.mount))
+
+
+def unmount(opts):
+    subprocess.call(['fusermount', '-u', opts.mount])
+
+
+def main():
+    parser = optparse.OptionParser(usage='%prog (--mount DIR | --dir DIR) [options]')
+    parser.add_option('--mount', help='mount irodsFs at this dir and run in it')
+    parser.add_option('--irodsfs', help='irodsFs binary (default $IRODS_HOME/clients/fuse/bin/irodsFs)')
+    parser.add_option('--fuse-opts', default='', help='options given to irodsFs, e.g. "--preload --lazyupload"')
+    parser.add_option('--dir', help='run in this dir, mounted already or a local stand-in')
+    parser.add_option('--workloads', default=','.join(WORKLOADS), help='comma separated, of ' + ','.join(WORKLOADS))
+    parser.add_option('--size', type='int', default=256, help='size of the big file in MB (default 256)')
+    parser.add_option('--block', type='int', default=128, help='block size of reads and writes in KB (default 128)')
+    parser.add_option('--ops', type='int', default=1000, help='random reads and writes (default 1000)')
+    parser.add_option('--files', type='int', default=1000, help='files of meta-storm and small-files (default 1000)')
+    parser.add_option('--small-size', type='int', default=4, help='size of small files in KB (default 4)')
+    parser.add_option('--entries', type='int', default=10000, help='entries of readdir-large (default 10000)')
+    parser.add_option('--seed', type='int', default=1, help='of random offsets')
+    parser.add_option('--json', help='write the results to this file')
+    parser.add_option('--baseline', help='compare with the results of an earlier run')
+    parser.add_option('--tolerance', type='float', default=10.0, help='percent a metric may be worse than the baseline (default 10)')
+    opts, args = parser.parse_args()
+
+    if (opts.mount is None) == (opts.dir is None):
+        parser.error('give one of --mount and --dir')
+    workloads = [w for w in opts.workloads.split(',') if w]
+    for w in workloads:
+        if w not in WORKLOADS:
+            parser.error('unknown workload ' + w)
+
+    if opts.mount is not None:
+        mount(opts)
+        workdir = opts.mount
+    else:
+        workdir = opts.dir
+
+    results = {}
+    bench = Bench(workdir, opts)
+    try:
+        for w in workloads:
+            print('running %s ...' % w, file=sys.stderr)
+            results[w] = getattr(bench, w.replace('-', '_'))()
+    finally:
+        bench.cleanup()
+        if opts.mount is not None:
+            unmount(opts)
+
+    report = {
+        'version': 1,
+        'time': int(time.time()),
+        'target': 'irodsFs ' + opts.fuse_opts if opts.mount is not None else workdir,
+        'params': {'size_mb': opts.size, 'block_kb': opts.block, 'ops': opts.ops, 'files': opts.files,
+                   'small_size_kb': opts.small_size, 'entries': opts.entries, 'seed': opts.seed},
+        'results': results,
+    }
+
+    status = 0
+    if opts.baseline:
+        with open(opts.baseline) as f:
+            baseline = json.load(f)
+        if baseline.get('params') != report['params']:
+            print('warning: baseline was run with other parameters', file=sys.stderr)
+        regressions = compare(results, baseline.get('results', {}), opts.tolerance)
+        report['baseline'] = opts.baseline
+        report['regressions'] = [{'metric': r[0], 'baseline': r[1], 'current': r[2], 'change_pct': round(r[3], 1)}
+                                 for r in regressions]
+        for r in regressions:
+            print('REGRESSION %s: %s -> %s (%+.1f%%)' % r, file=sys.stderr)
+        if regressions:
+            status = 1
+
+    text = json.dumps(report, indent=2, sort_keys=True)
+    print(text)
+    if opts.json:
+        with open(opts.json, 'w') as f:
+            f.write(text + '\n')
+    return status
+
+
+if __name__ == '__main__':
+    sys.exit(main())
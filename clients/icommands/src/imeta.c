@@ -25,8 +25,13 @@ rodsEnv myEnv;
 
 int lastCommandStatus=0;
 int printCount=0;
+int pipelineMode=0; /* AVU changes read from a pipe or file are sent
+		       without waiting for each reply */
 
 int usage(char *subOpt);
+void modAVUMetadataDone(rcComm_t *conn, int ticket, int status,
+			void *outStruct, void *cbArg);
+void reportModAVUMetadata(int status);
 
 /* 
  print the results of a general query.
@@ -1106,8 +1111,6 @@ modAVUMetadata(char *arg0, char *arg1, char *arg2, char *arg3,
 	       char *arg4, char *arg5, char *arg6, char *arg7, char *arg8) {
    modAVUMetadataInp_t modAVUMetadataInp;
    int status;
-   char *mySubName;
-   char *myName;
    char fullName[MAX_NAME_LEN];
 
    strncpy(fullName, cwd, MAX_NAME_LEN);
@@ -1139,8 +1142,48 @@ modAVUMetadata(char *arg0, char *arg1, char *arg2, char *arg3,
    modAVUMetadataInp.arg8 = arg8;
    modAVUMetadataInp.arg9 ="";
 
+   if (pipelineMode) {
+      /* the reply is reported by modAVUMetadataDone, in order */
+      status = submitAsyncApiRequest(Conn, MOD_AVU_METADATA_AN,
+				     &modAVUMetadataInp, modAVUMetadataDone,
+				     arg0);
+      if (status < 0) {
+	 lastCommandStatus = status;
+	 reportModAVUMetadata(status);
+	 return(status);
+      }
+      return(0);
+   }
+
    status = rcModAVUMetadata(Conn, &modAVUMetadataInp);
    lastCommandStatus = status;
+   reportModAVUMetadata(status);
+   return(status);
+}
+
+/*
+ Called with the reply of a pipelined modAVUMetadata
+ */
+void
+modAVUMetadataDone(rcComm_t *conn, int ticket, int status, void *outStruct,
+		   void *cbArg) {
+   char *arg0 = (char *)cbArg;
+
+   lastCommandStatus = status;
+   reportModAVUMetadata(status);
+   if (strcmp(arg0, "addw")==0 && status > 0) {
+      printf("AVU added to %d data-objects\n", status);
+      lastCommandStatus = 0;
+   }
+}
+
+/*
+ Log the error of a modAVUMetadata, if any
+ */
+void
+reportModAVUMetadata(int status) {
+   char *mySubName;
+   char *myName;
 
    if (status < 0 ) {
       if (Conn->rError) {
@@ -1158,7 +1201,6 @@ modAVUMetadata(char *arg0, char *arg1, char *arg2, char *arg3,
       rodsLog (LOG_ERROR, "rcModAVUMetadata failed with error %d %s %s",
 	       status, myName, mySubName);
    }
-   return(status);
 }
 
 /* 
@@ -1178,6 +1220,7 @@ getInput(char *cmdToken[], int maxTokens) {
    stat = fgets(ttybuf, BIG_STR, stdin);
    if (stat==0) {
       printf("\n");
+      drainAsyncApiRequests(Conn);
       rcDisconnect(Conn);
       if (lastCommandStatus != 0) exit(4);
       exit(0);
@@ -1621,6 +1664,8 @@ main(int argc, char **argv) {
 	 firstTime=0;
       }
       if (keepGoing) {
+         /* commands from a script need no reply to go on with the next */
+         if (!isatty(0)) pipelineMode=1;
          status = getInput(cmdToken, maxCmdTokens);
          if (status<0) {
            lastCommandStatus=status;
@@ -1629,6 +1674,8 @@ main(int argc, char **argv) {
       }
    }
 
+   drainAsyncApiRequests(Conn);
+
    printErrorStack(Conn->rError);
 
    rcDisconnect(Conn);
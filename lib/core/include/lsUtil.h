@@ -9,6 +9,18 @@
 #include "parseCommandLine.h"
 #include "rodsPath.h"
 
+/* the replies of the requests lsUtil pipelines for a path of the
+ * command line */
+typedef struct LsPrefetch {
+    int statDone;
+    int statStatus;
+    rodsObjStat_t *rodsObjStat;
+    int queryDone;
+    int queryStatus;
+    genQueryInp_t genQueryInp;
+    genQueryOut_t *genQueryOut;
+} lsPrefetch_t;
+
 #ifdef  __cplusplus
 extern "C" {
 #endif
@@ -26,6 +38,23 @@ int
 lsDataObjUtilLong (rcComm_t *conn, char *srcPath, rodsEnv *myRodsEnv,
 rodsArguments_t *rodsArgs, genQueryInp_t *genQueryInp);
 int
+setQueryInpForLsLong (char *srcPath, rodsArguments_t *rodsArgs,
+genQueryInp_t *genQueryInp);
+int
+procLsLongQueryOut (rcComm_t *conn, char *srcPath, rodsArguments_t *rodsArgs,
+int status, genQueryOut_t *genQueryOut);
+lsPrefetch_t *
+prefetchLsPaths (rcComm_t *conn, rodsArguments_t *rodsArgs,
+rodsPathInp_t *rodsPathInp);
+void
+lsObjStatDone (rcComm_t *conn, int ticket, int status, void *outStruct,
+void *cbArg);
+void
+lsGenQueryDone (rcComm_t *conn, int ticket, int status, void *outStruct,
+void *cbArg);
+int
+freeLsPrefetch (lsPrefetch_t *lsPrefetch, int numPrefetch);
+int
 printLsLong (rcComm_t *conn, rodsArguments_t *rodsArgs, 
 genQueryOut_t *genQueryOut);
 int
@@ -190,6 +190,9 @@ mkCollR (rcComm_t *conn, char *startColl, char *destColl);
 int
 getRodsObjType (rcComm_t *conn, rodsPath_t *rodsPath);
 int
+setRodsObjType (rodsPath_t *rodsPath, int status,
+rodsObjStat_t *rodsObjStatOut);
+int
 genAllInCollQCond (char *collection, char *collQCond);
 int
 queryCollInColl (queryHandle_t *queryHandle, char *collection,
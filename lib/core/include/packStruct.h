@@ -96,8 +96,45 @@ typedef struct packItem {
     struct packItem *parent;
     struct packItem *prev;
     struct packItem *next;
+    struct packOp *op;	/* compiled source of the item, NULL if parsed */
 } packItem_t;
 
+#define PACK_OP_CACHE_SLOTS	1024	/* buckets of the compiled PI cache */
+#define PACK_OP_CACHE_MAX	4096	/* more PIs are parsed each time */
+
+/* an item of a compiled pack instruction. name is the bare item name,
+ * the array and hint dimensions of it are taken apart at compile time.
+ * a dimension given by name is resolved per use, dim is -1 if the
+ * dimensions could not be compiled and are parsed from name per use */
+typedef struct packOp {
+    packTypeInx_t typeInx;
+    int pointerType;
+    char *name;
+    char strValue[NAME_LEN];	/* for the ? dependent type */
+    int dim;
+    int dimSize[MAX_PACK_DIM];
+    char *dimName[MAX_PACK_DIM];	/* NULL if dimSize is a number */
+    int hintDim;
+    int hintDimSize[MAX_PACK_DIM];
+    char *hintDimName[MAX_PACK_DIM];
+} packOp_t;
+
+/* a pack instruction compiled once, never changed or freed after */
+typedef struct packOpList {
+    char *packInstruct;
+    unsigned int hash;
+    int numOps;
+    packOp_t *ops;
+    struct packOpList *next;	/* in the same cache bucket */
+} packOpList_t;
+
+/* an index of a name table, built at the first lookup */
+typedef struct {
+    int numSlots;	/* a power of 2 */
+    char **names;
+    void **values;
+} packNameIndex_t;
+
 typedef struct {
     int numBuf;
     bytesBuf_t *bBufArray;	/* pointer to an array of bytesBuf_t */
@@ -109,6 +146,15 @@ typedef struct {
     bytesBufArray_t nopackBufArray;	/* bBuf for non packed buffer */
 } packedOutput_t;
 
+/* the generated NATIVE_PROT routines of a struct, see packCodec.c */
+typedef struct {
+    char *name;		/* of the pack instruction */
+    int (*pack) (void *inStruct, packedOutput_t *packedOutput, int packFlag);
+    int (*unpack) (void *inPackedStr, packedOutput_t *unpackedOutput);
+} packCodec_t;
+
+extern packCodec_t PackCodecTable[];
+
 int 
 packStruct (void *inStruct, bytesBuf_t **packedResult, char *packInstName,
 packInstructArray_t *myPackTable, int packFlag, irodsProt_t irodsProt);
@@ -119,6 +165,22 @@ packInstructArray_t *myPackTable, irodsProt_t irodsProt);
 int
 parsePackInstruct (char *packInstruct, packItem_t **packItemHead);
 int
+parsePackInstructText (char *packInstruct, packItem_t **packItemHead);
+int
+getCompiledPackInstruct (char *packInstruct, packOpList_t **opList);
+int
+compilePackInstruct (char *packInstruct, packOpList_t **opList);
+int
+compilePackDims (packOp_t *myOp, char *name);
+int
+instantiatePackOps (packOpList_t *opList, packItem_t **packItemHead);
+int
+resolveCompiledDims (packItem_t *myPackedItem, packInstructArray_t *myPackTable);
+int
+enablePackInstructCache (int flag);
+void
+freePackItemName (packItem_t *myPackedItem);
+int
 copyStrFromPiBuf (char **inBuf, char *outBuf, int dependentFlag);
 int
 packTypeLookup (char *typeName);
@@ -302,6 +364,31 @@ packNopackPointer (void **inPtr, packedOutput_t *packedOutput, int len,
 packItem_t *myPackedItem, irodsProt_t irodsProt);
 int
 ovStrcpy (char *outStr, char *inStr);
+packCodec_t *
+matchPackCodec (char *packInstName, packInstructArray_t *myPackTable,
+irodsProt_t irodsProt);
+int
+enablePackCodec (int flag);
+int
+codecPackInt (void **inPtr, packedOutput_t *packedOutput, int numElement);
+int
+codecPackInt16 (void **inPtr, packedOutput_t *packedOutput, int numElement);
+int
+codecPackDouble (void **inPtr, packedOutput_t *packedOutput, int numElement);
+int
+codecUnpackInt (void **inPtr, packedOutput_t *unpackedOutput, int numElement);
+int
+codecUnpackInt16 (void **inPtr, packedOutput_t *unpackedOutput, 
+int numElement);
+int
+codecUnpackDouble (void **inPtr, packedOutput_t *unpackedOutput, 
+int numElement);
+int
+codecUnpackNullString (void **inPtr, packedOutput_t *unpackedOutput);
+int
+codecPtrArrayLen (int numPointer);
+int
+codecAllocLenForStr (void *inPtr, int numStr, int maxStrLen);
 #ifdef  __cplusplus
 }
 #endif
@@ -0,0 +1,75 @@
+/*** Copyright (c), The Regents of the University of California            ***
+ *** For more information please refer to files in the COPYRIGHT directory ***/
+
+/* procApiAsync.h - header file for procApiAsync.c
+ */
+
+
+
+#ifndef PROC_API_ASYNC_H
+#define PROC_API_ASYNC_H
+
+#include "rods.h"
+#include "apiHandler.h"
+
+#define ASYNC_API_DEF_WINDOW	32	/* requests sent and not replied */
+#define ASYNC_API_MAX_WINDOW	256
+
+/* called with the reply of a request in the order the requests were
+ * submitted. outStruct is owned by the callback from then on and
+ * conn->rError holds the error stack of the reply during the call */
+typedef void (*asyncApiCallback)(rcComm_t *conn, int ticket, int status,
+void *outStruct, void *cbArg);
+
+typedef struct AsyncApiReq {
+    int ticket;
+    int apiInx;
+    int apiNumber;
+    struct timeval startTime;
+    asyncApiCallback callback;
+    void *cbArg;
+    int status;			/* of the reply */
+    void *outStruct;
+    struct AsyncApiReq *next;
+} asyncApiReq_t;
+
+/* the requests of a rcComm_t sent back to back without waiting for the
+ * replies. Used by one thread at a time, as the connection itself */
+typedef struct AsyncApiQueue {
+    int window;
+    int nextTicket;
+    int numOutstanding;
+    int status;			/* < 0 once the replies can not be read */
+    asyncApiReq_t *sentHead;	/* in the order of the replies to come */
+    asyncApiReq_t *sentTail;
+    asyncApiReq_t *doneHead;	/* replied, with no callback and not taken */
+    asyncApiReq_t *doneTail;
+} asyncApiQueue_t;
+
+#ifdef  __cplusplus
+extern "C" {
+#endif
+
+int
+submitAsyncApiRequest (rcComm_t *conn, int apiNumber, void *inputStruct,
+asyncApiCallback callback, void *cbArg);
+int
+pollAsyncApiRequest (rcComm_t *conn, int ticket, int *apiStatus,
+void **outStruct);
+int
+waitAsyncApiRequest (rcComm_t *conn, int ticket, int *apiStatus,
+void **outStruct);
+int
+drainAsyncApiRequests (rcComm_t *conn);
+int
+getNumAsyncApiRequests (rcComm_t *conn);
+int
+setAsyncApiWindow (rcComm_t *conn, int window);
+int
+freeAsyncApiQueue (rcComm_t *conn);
+
+#ifdef  __cplusplus
+}
+#endif
+
+#endif	/* PROC_API_ASYNC_H */
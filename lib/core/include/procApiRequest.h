@@ -11,15 +11,25 @@
 
 #include "rods.h"
 #include "apiHandler.h"
+#include "procApiAsync.h"
 
 #ifdef  __cplusplus
 extern "C" {
 #endif
 
+/* called by procApiRequest when a request is done if set, with the time
+ * the request took in micro seconds and the input and output byte stream
+ * lengths. used by clients to keep statistics of their requests */
+typedef void (*procApiRequestCallback)(int apiNumber, int status,
+rodsLong_t elapsedUsec, int inBsLen, int outBsLen);
+
 int
 procApiRequest (rcComm_t *conn, int apiNumber, void *inputStruct,
 bytesBuf_t *inputBsBBuf, void **outStruct, bytesBuf_t *outBsBBuf);
 
+void
+callProcApiRequestCB (int apiNumber, int status, struct timeval *startTime,
+bytesBuf_t *inputBsBBuf, bytesBuf_t *outBsBBuf);
 int
 sendApiRequest (rcComm_t *conn, int apiInx, void *inputStruct,
 bytesBuf_t *inputBsBBuf);
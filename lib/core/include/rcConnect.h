@@ -137,6 +137,8 @@ typedef struct {
     SSL_CTX *ssl_ctx;
     SSL *ssl;
 #endif
+    struct AsyncApiQueue *asyncApi;	/* pipelined requests, procApiAsync.c */
+    struct MsgBufPool *msgBufPool;	/* reply bufs, sockComm.c */
 } rcComm_t;
 
 typedef struct {
@@ -197,6 +199,7 @@ typedef struct {
     int ssl_do_accept;
     int ssl_do_shutdown;
 #endif
+    struct MsgBufPool *msgBufPool;	/* request bufs, sockComm.c */
 } rsComm_t;
 
 void rcPipSigHandler ();
@@ -13,6 +13,7 @@
 #include "rodsGenQuery.h" 
 #include "rodsGeneralUpdate.h" 
 #include "irodsGuiProgressCallback.h"
+#include "procApiRequest.h"
 
 int ProcessType = CLIENT_PT;
 
@@ -244,6 +245,7 @@ extern "C" {
 #endif
 
 irodsGuiProgressCallbak gGuiProgressCB = NULL;
+procApiRequestCallback gProcApiRequestCB = NULL;
 
 #ifdef  __cplusplus
 }
@@ -11,6 +11,7 @@
 #include "objInfo.h"
 #include "msParam.h"
 #include "irodsGuiProgressCallback.h"
+#include "procApiRequest.h"
 
 extern packConstantArray_t PackConstantTable[];
 extern packInstructArray_t RodsPackTable[];
@@ -44,6 +45,7 @@ extern "C" {
 #endif
 
 extern irodsGuiProgressCallbak gGuiProgressCB;
+extern procApiRequestCallback gProcApiRequestCB;
 
 #ifdef  __cplusplus
 }
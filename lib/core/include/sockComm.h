@@ -9,6 +9,9 @@
 #include "rodsDef.h"
 #include "rcConnect.h"
 #include "rodsPackInstruct.h"
+#ifndef _WIN32
+#include <sys/uio.h>
+#endif
 
 #define MAX_LISTEN_QUE	50
 #define SOCK_WINDOW_SIZE	(1*1024*1024)   /* sock window size = 1 Mb */
@@ -49,6 +52,30 @@
 #define CLOSE_SOCK       close
 #endif
 
+/* definition for the msgBufPool_t */
+#define MSG_BUF_POOL_SIZE	4	/* max free bufs kept by a connection */
+#define MIN_MSG_BUF_LEN		1024	/* pooled bufs are powers of 2 long */
+#define MAX_MSG_BUF_LEN		(256*1024)	/* larger bufs are not pooled */
+
+/* reusable bufs of a connection for the msg and error parts read by
+ * readMsgBodyWithPool. Used by one thread at a time, as the connection */
+typedef struct MsgBufPool {
+    int numBuf;
+    void *buf[MSG_BUF_POOL_SIZE];
+    int bufLen[MSG_BUF_POOL_SIZE];
+} msgBufPool_t;
+
+/* process wide counters of the msg layer. The syscalls per msg sent or
+ * read tell how well the msgs are batched */
+typedef struct SockCommStats {
+    rodsLong_t msgSent;		/* sendRodsMsg */
+    rodsLong_t msgRead;		/* readMsgBody */
+    rodsLong_t writeCalls;	/* write and writev on sockets */
+    rodsLong_t readCalls;	/* read and select on sockets */
+    rodsLong_t bufAlloc;	/* msg and error bufs malloc'ed */
+    rodsLong_t bufReuse;	/* msg and error bufs taken from a pool */
+} sockCommStats_t;
+
 #ifdef  __cplusplus
 extern "C" {
 #endif
@@ -62,6 +89,9 @@ int myRead (int sock, void *buf, int len, irodsDescType_t irodsDescType,
 int *bytesRead, struct timeval *tv);
 int myWrite (int sock, void *buf, int len, irodsDescType_t irodsDescType,
 int *bytesWritten);
+#ifndef _WIN32
+int myWritev (int sock, struct iovec *iov, int iovcnt, int *bytesWritten);
+#endif
 int connectToRhost (rcComm_t *conn, int connectCnt, int reconnFlag);
 int connectToRhostWithRaddr (struct sockaddr_in *remoteAddr, int windowSize,
 int timeoutFlag);
@@ -82,6 +112,22 @@ readMsgBody (int sock, msgHeader_t *myHeader, bytesBuf_t *inputStructBBuf,
 bytesBuf_t *bsBBuf, bytesBuf_t *errorBBuf, irodsProt_t irodsProt,
 struct timeval *tv);
 int
+readMsgBodyWithPool (int sock, msgHeader_t *myHeader,
+bytesBuf_t *inputStructBBuf, bytesBuf_t *bsBBuf, bytesBuf_t *errorBBuf,
+irodsProt_t irodsProt, struct timeval *tv, msgBufPool_t *msgBufPool);
+msgBufPool_t *
+allocMsgBufPool ();
+int
+freeMsgBufPool (msgBufPool_t *msgBufPool);
+void *
+getMsgBuf (msgBufPool_t *msgBufPool, int len);
+int
+releaseMsgBuf (msgBufPool_t *msgBufPool, bytesBuf_t *myBBuf);
+int
+getSockCommStats (sockCommStats_t *sockCommStats);
+int
+resetSockCommStats ();
+int
 connectToRhostPortal (char *rodsHost, int rodsPort, int cookie,
 int windowSize);
 int
@@ -0,0 +1,54 @@
+/*** Copyright (c), The Regents of the University of California            ***
+ *** For more information please refer to files in the COPYRIGHT directory ***/
+
+/* xmlScan.h - header file for xmlScan.c
+ */
+
+
+
+#ifndef XML_SCAN_H
+#define XML_SCAN_H
+
+#include "rodsDef.h"
+
+/* definition for the instruction set used by the scanners */
+#define XML_SCAN_SCALAR	0	/* byte by byte */
+#define XML_SCAN_SSE42	1	/* 16 bytes at a time */
+#define XML_SCAN_AVX2	2	/* 32 bytes at a time */
+
+#if defined(__GNUC__) && (defined(__x86_64__) || defined(__i386__)) && \
+  !defined(XML_SCAN_NO_SIMD)
+#define XML_SCAN_SIMD	1
+#endif
+
+#define MAX_XML_SCAN_CHAR	16	/* max chars in a xmlCharSet_t */
+
+/* a set of chars to scan for. ch is padded with 0 to 16 bytes for the
+ * SSE4.2 string compare */
+typedef struct XmlCharSet {
+    int numChar;
+    char ch[MAX_XML_SCAN_CHAR];
+    char chVec[MAX_XML_SCAN_CHAR][32];	/* each char 32 times for AVX2 */
+    unsigned char member[256];	/* for the scalar scan */
+} xmlCharSet_t;
+
+#ifdef  __cplusplus
+extern "C" {
+#endif
+
+int
+scanXmlEscChar (char *inStr, int len);
+int
+scanXmlEntity (char *inStr, int len);
+int
+scanXmlTagStart (char *inStr);
+int
+setXmlScanIsa (int isa);
+int
+getXmlScanIsa ();
+
+#ifdef  __cplusplus
+}
+#endif
+
+#endif	/* XML_SCAN_H */
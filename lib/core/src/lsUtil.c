@@ -14,6 +14,7 @@ rodsPathInp_t *rodsPathInp)
     int status; 
     int savedStatus = 0;
     genQueryInp_t genQueryInp;
+    lsPrefetch_t *lsPrefetch = NULL;
 
 
     if (rodsPathInp == NULL) {
@@ -32,11 +33,26 @@ rodsPathInp_t *rodsPathInp)
 
     initCondForLs (myRodsEnv, myRodsArgs, &genQueryInp);
 
+    /* the stat and the long listing query of each of many paths are
+     * pipelined instead of a round trip each */
+    if (rodsPathInp->numSrc > 1) {
+	lsPrefetch = prefetchLsPaths (conn, myRodsArgs, rodsPathInp);
+    }
+
     for (i = 0; i < rodsPathInp->numSrc; i++) {
 	rstrcpy(zoneHint, rodsPathInp->srcPath[i].inPath, MAX_NAME_LEN);
 	if (rodsPathInp->srcPath[i].objType == UNKNOWN_OBJ_T || 
 	  rodsPathInp->srcPath[i].objState == UNKNOWN_ST) {
-	    status = getRodsObjType (conn, &rodsPathInp->srcPath[i]);
+	    if (lsPrefetch != NULL && lsPrefetch[i].statDone) {
+		status = setRodsObjType (&rodsPathInp->srcPath[i],
+		  lsPrefetch[i].statStatus, lsPrefetch[i].rodsObjStat);
+		if (lsPrefetch[i].statStatus >= 0) {
+		    /* the path has it now */
+		    lsPrefetch[i].rodsObjStat = NULL;
+		}
+	    } else {
+	        status = getRodsObjType (conn, &rodsPathInp->srcPath[i]);
+	    }
 	    if (rodsPathInp->srcPath[i].objState == NOT_EXIST_ST) {
                 if (status == NOT_EXIST_ST) {
                     rodsLog (LOG_ERROR,
@@ -48,7 +64,12 @@ rodsPathInp_t *rodsPathInp)
 	    }
 	}
 
-	if (rodsPathInp->srcPath[i].objType == DATA_OBJ_T) {
+	if (rodsPathInp->srcPath[i].objType == DATA_OBJ_T &&
+	  lsPrefetch != NULL && lsPrefetch[i].queryDone) {
+	    procLsLongQueryOut (conn, rodsPathInp->srcPath[i].outPath,
+	      myRodsArgs, lsPrefetch[i].queryStatus, lsPrefetch[i].genQueryOut);
+	    status = 0;
+	} else if (rodsPathInp->srcPath[i].objType == DATA_OBJ_T) {
 	    status = lsDataObjUtil (conn, &rodsPathInp->srcPath[i], 
 	     myRodsEnv, myRodsArgs, &genQueryInp);
 	} else if (rodsPathInp->srcPath[i].objType ==  COLL_OBJ_T) {
@@ -59,6 +80,7 @@ rodsPathInp_t *rodsPathInp)
 	    rodsLog (LOG_ERROR,
 	     "lsUtil: invalid ls objType %d for %s", 
 	     rodsPathInp->srcPath[i].objType, rodsPathInp->srcPath[i].outPath);
+	    freeLsPrefetch (lsPrefetch, rodsPathInp->numSrc);
 	    return (USER_INPUT_PATH_ERR);
 	}
 	/* XXXX may need to return a global status */
@@ -70,6 +92,8 @@ rodsPathInp_t *rodsPathInp)
 	    savedStatus = status;
 	} 
     }
+    freeLsPrefetch (lsPrefetch, rodsPathInp->numSrc);
+
     if (savedStatus < 0) {
         return (savedStatus);
     } else if (status == CAT_NO_ROWS_FOUND || 
@@ -80,6 +104,119 @@ rodsPathInp_t *rodsPathInp)
     }
 }
 
+/* prefetchLsPaths - stat the paths of rodsPathInp of unknown type and,
+ * for a long listing, query the data objects among them, with the
+ * requests of each step pipelined on conn. Returns the replies by path,
+ * to be freed with freeLsPrefetch. A path with no reply is done one by
+ * one by lsUtil as before */
+lsPrefetch_t *
+prefetchLsPaths (rcComm_t *conn, rodsArguments_t *rodsArgs,
+rodsPathInp_t *rodsPathInp)
+{
+    lsPrefetch_t *lsPrefetch;
+    rodsPath_t *srcPath;
+    dataObjInp_t dataObjInp;
+    int status;
+    int i;
+
+    lsPrefetch = (lsPrefetch_t *) calloc (rodsPathInp->numSrc,
+      sizeof (lsPrefetch_t));
+    if (lsPrefetch == NULL) {
+	return (NULL);
+    }
+
+    for (i = 0; i < rodsPathInp->numSrc; i++) {
+	srcPath = &rodsPathInp->srcPath[i];
+	if (srcPath->objType != UNKNOWN_OBJ_T && 
+	  srcPath->objState != UNKNOWN_ST) {
+	    continue;
+	}
+	memset (&dataObjInp, 0, sizeof (dataObjInp));
+	rstrcpy (dataObjInp.objPath, srcPath->outPath, MAX_NAME_LEN);
+	status = submitAsyncApiRequest (conn, OBJ_STAT_AN, &dataObjInp,
+	  lsObjStatDone, &lsPrefetch[i]);
+	if (status < 0) {
+	    break;
+	}
+    }
+    drainAsyncApiRequests (conn);
+
+    if (rodsArgs->longOption != True) {
+	return (lsPrefetch);
+    }
+
+    for (i = 0; i < rodsPathInp->numSrc; i++) {
+	srcPath = &rodsPathInp->srcPath[i];
+	/* data objects that lsDataObjUtil would list with 
+	 * lsDataObjUtilLong on their own path */
+	if (lsPrefetch[i].statDone == 0 || lsPrefetch[i].statStatus < 0 ||
+	  lsPrefetch[i].rodsObjStat == NULL ||
+	  lsPrefetch[i].rodsObjStat->objType != DATA_OBJ_T ||
+	  lsPrefetch[i].rodsObjStat->specColl != NULL ||
+	  srcPath->objType == COLL_OBJ_T) {
+	    continue;
+	}
+	status = setQueryInpForLsLong (srcPath->outPath, rodsArgs,
+	  &lsPrefetch[i].genQueryInp);
+	if (status < 0) {
+	    continue;
+	}
+	status = submitAsyncApiRequest (conn, GEN_QUERY_AN, 
+	  &lsPrefetch[i].genQueryInp, lsGenQueryDone, &lsPrefetch[i]);
+	if (status < 0) {
+	    break;
+	}
+    }
+    drainAsyncApiRequests (conn);
+
+    return (lsPrefetch);
+}
+
+void
+lsObjStatDone (rcComm_t *conn, int ticket, int status, void *outStruct,
+void *cbArg)
+{
+    lsPrefetch_t *lsPrefetch = (lsPrefetch_t *) cbArg;
+
+    lsPrefetch->statDone = 1;
+    lsPrefetch->statStatus = status;
+    lsPrefetch->rodsObjStat = (rodsObjStat_t *) outStruct;
+}
+
+void
+lsGenQueryDone (rcComm_t *conn, int ticket, int status, void *outStruct,
+void *cbArg)
+{
+    lsPrefetch_t *lsPrefetch = (lsPrefetch_t *) cbArg;
+
+    lsPrefetch->queryDone = 1;
+    lsPrefetch->queryStatus = status;
+    lsPrefetch->genQueryOut = (genQueryOut_t *) outStruct;
+}
+
+int
+freeLsPrefetch (lsPrefetch_t *lsPrefetch, int numPrefetch)
+{
+    int i;
+
+    if (lsPrefetch == NULL) {
+	return (0);
+    }
+
+    for (i = 0; i < numPrefetch; i++) {
+	if (lsPrefetch[i].rodsObjStat != NULL) {
+	    freeRodsObjStat (lsPrefetch[i].rodsObjStat);
+	}
+	clearGenQueryInp (&lsPrefetch[i].genQueryInp);
+	if (lsPrefetch[i].genQueryOut != NULL) {
+	    freeGenQueryOut (&lsPrefetch[i].genQueryOut);
+	}
+    }
+    free (lsPrefetch);
+
+    return (0);
+}
+
 int
 lsDataObjUtil (rcComm_t *conn, rodsPath_t *srcPath, 
 rodsEnv *myRodsEnv, rodsArguments_t *rodsArgs, 
@@ -139,6 +276,25 @@ rodsArguments_t *rodsArgs, genQueryInp_t *genQueryInp)
 {
     int status;
     genQueryOut_t *genQueryOut = NULL;
+
+    status = setQueryInpForLsLong (srcPath, rodsArgs, genQueryInp);
+    if (status < 0) {
+	return (status);
+    }
+
+    status =  rcGenQuery (conn, genQueryInp, &genQueryOut);
+
+    return (procLsLongQueryOut (conn, srcPath, rodsArgs, status,
+      genQueryOut));
+}
+
+/* setQueryInpForLsLong - add the selects and conditions of the long
+ * listing of the data object srcPath to genQueryInp */
+int
+setQueryInpForLsLong (char *srcPath, rodsArguments_t *rodsArgs,
+genQueryInp_t *genQueryInp)
+{
+    int status;
     char myColl[MAX_NAME_LEN], myData[MAX_NAME_LEN];
     char condStr[MAX_NAME_LEN];
     int queryFlags;
@@ -163,8 +319,15 @@ rodsArguments_t *rodsArgs, genQueryInp_t *genQueryInp)
     snprintf (condStr, MAX_NAME_LEN, "='%s'", myData);
     addInxVal (&genQueryInp->sqlCondInp, COL_DATA_NAME, condStr);
 
-    status =  rcGenQuery (conn, genQueryInp, &genQueryOut);
+    return (0);
+}
 
+/* procLsLongQueryOut - print the long listing of the data object srcPath
+ * from the status and output of its query */
+int
+procLsLongQueryOut (rcComm_t *conn, char *srcPath, rodsArguments_t *rodsArgs,
+int status, genQueryOut_t *genQueryOut)
+{
     if (status < 0) {
 	if (status == CAT_NO_ROWS_FOUND) {
 	    rodsLog (LOG_ERROR, "%s does not exist or user lacks access permission",
@@ -210,6 +210,20 @@ getRodsObjType (rcComm_t *conn, rodsPath_t *rodsPath)
     rstrcpy (dataObjInp.objPath, rodsPath->outPath, MAX_NAME_LEN);
     status = rcObjStat (conn, &dataObjInp, &rodsObjStatOut);
 
+    return (setRodsObjType (rodsPath, status, rodsObjStatOut));
+}
+
+/* setRodsObjType - set the type and state of rodsPath from the status and
+ * output of its rcObjStat, for callers that stat several paths at once.
+ * rodsPath takes rodsObjStatOut */
+int
+setRodsObjType (rodsPath_t *rodsPath, int status,
+rodsObjStat_t *rodsObjStatOut)
+{
+    if (rodsPath == NULL) {
+	return (USER__NULL_INPUT_ERR);
+    }
+
     if (status < 0) {
         rodsPath->objState = NOT_EXIST_ST;
 	if (status == OBJ_PATH_DOES_NOT_EXIST || 
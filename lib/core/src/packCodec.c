@@ -0,0 +1,1732 @@
+/*** Copyright (c), The Regents of the University of California            ***
+ *** For more information please refer to files in the COPYRIGHT directory ***/
+
+/* packCodec.c - NATIVE_PROT pack and unpack routines of the most used
+ * structs, called by packStruct and unpackStruct instead of interpreting
+ * the pack instruction.
+ *
+ * Generated by scripts/perl/genPackCodec.pl from rodsPackInstruct.h.
+ * Do not edit, edit the pack instruction or the script.
+ */
+
+#include "packStruct.h"
+#include "rodsLog.h"
+#include "rcGlobalExtern.h"
+#include "rcMisc.h"
+#include "rodsGenQuery.h"
+#include "apiHeaderAll.h"
+
+/* the alignment of items in a C struct as alignInt, alignDouble and
+ * ialignAddr do it */
+#define CODEC_ALIGN(ptr, boundary) \
+  ((void *) (((size_t) (ptr) + (boundary) - 1) & ~((size_t) (boundary) - 1)))
+
+#if defined(osx_platform) || (defined(solaris_platform) && defined(i86_hardware))
+#define CODEC_ALIGN_DOUBLE	4	/* osx does not align */
+#elif (defined(linux_platform) || defined(windows_platform)) && !defined(ADDR_64BITS)
+#define CODEC_ALIGN_DOUBLE	4
+#else
+#define CODEC_ALIGN_DOUBLE	8
+#endif
+
+#ifdef ADDR_64BITS
+#define CODEC_ALIGN_POINTER	8
+#else
+#define CODEC_ALIGN_POINTER	4
+#endif
+
+/* solaris on sparc aligns a struct with a double to 64 bit, which is
+ * left to the interpreter */
+#if !defined(solaris_platform) || defined(i86_hardware)
+
+static int
+packCodecDataObjInp (void *inStruct, packedOutput_t *packedOutput,
+int packFlag)
+{
+    int intValue3;
+    int j11;
+    int j7;
+    int numPointer10;
+    int numPointer6;
+    int status;
+    void *elemPtr2;
+    void *elemPtr5;
+    void *elemPtr9;
+    void *inPtr = inStruct;
+    void *pointer1;
+    void *pointer4;
+    void *pointer8;
+
+    /* str objPath[MAX_NAME_LEN] */
+    status = packNatString (&inPtr, packedOutput, MAX_NAME_LEN, NULL);
+    if (status < 0) {
+	rodsLog (LOG_ERROR,
+	  "packCodec: strlen of objPath > dim size %d, content: %s", MAX_NAME_LEN, (char *) inPtr);
+	return (status);
+    }
+    /* int createMode */
+    inPtr = CODEC_ALIGN (inPtr, 4);
+    codecPackInt (&inPtr, packedOutput, 1);
+    /* int openFlags */
+    inPtr = CODEC_ALIGN (inPtr, 4);
+    codecPackInt (&inPtr, packedOutput, 1);
+    /* double offset */
+    inPtr = CODEC_ALIGN (inPtr, CODEC_ALIGN_DOUBLE);
+    codecPackDouble (&inPtr, packedOutput, 1);
+    /* double dataSize */
+    inPtr = CODEC_ALIGN (inPtr, CODEC_ALIGN_DOUBLE);
+    codecPackDouble (&inPtr, packedOutput, 1);
+    /* int numThreads */
+    inPtr = CODEC_ALIGN (inPtr, 4);
+    codecPackInt (&inPtr, packedOutput, 1);
+    /* int oprType */
+    inPtr = CODEC_ALIGN (inPtr, 4);
+    codecPackInt (&inPtr, packedOutput, 1);
+    /* struct *SpecColl_PI */
+    inPtr = CODEC_ALIGN (inPtr, CODEC_ALIGN_POINTER);
+    pointer1 = *(void **) inPtr;
+    inPtr = (char *) inPtr + sizeof (void *);
+    if (pointer1 == NULL) {
+	packNullString (packedOutput);
+    } else {
+	elemPtr2 = pointer1;
+	/* int collClass */
+	elemPtr2 = CODEC_ALIGN (elemPtr2, 4);
+	codecPackInt (&elemPtr2, packedOutput, 1);
+	/* int type */
+	elemPtr2 = CODEC_ALIGN (elemPtr2, 4);
+	codecPackInt (&elemPtr2, packedOutput, 1);
+	/* str collection[MAX_NAME_LEN] */
+	status = packNatString (&elemPtr2, packedOutput, MAX_NAME_LEN, NULL);
+	if (status < 0) {
+	    rodsLog (LOG_ERROR,
+	      "packCodec: strlen of collection > dim size %d, content: %s", MAX_NAME_LEN, (char *) elemPtr2);
+	    return (status);
+	}
+	/* str objPath[MAX_NAME_LEN] */
+	status = packNatString (&elemPtr2, packedOutput, MAX_NAME_LEN, NULL);
+	if (status < 0) {
+	    rodsLog (LOG_ERROR,
+	      "packCodec: strlen of objPath > dim size %d, content: %s", MAX_NAME_LEN, (char *) elemPtr2);
+	    return (status);
+	}
+	/* str resource[NAME_LEN] */
+	status = packNatString (&elemPtr2, packedOutput, NAME_LEN, NULL);
+	if (status < 0) {
+	    rodsLog (LOG_ERROR,
+	      "packCodec: strlen of resource > dim size %d, content: %s", NAME_LEN, (char *) elemPtr2);
+	    return (status);
+	}
+	/* str phyPath[MAX_NAME_LEN] */
+	status = packNatString (&elemPtr2, packedOutput, MAX_NAME_LEN, NULL);
+	if (status < 0) {
+	    rodsLog (LOG_ERROR,
+	      "packCodec: strlen of phyPath > dim size %d, content: %s", MAX_NAME_LEN, (char *) elemPtr2);
+	    return (status);
+	}
+	/* str cacheDir[MAX_NAME_LEN] */
+	status = packNatString (&elemPtr2, packedOutput, MAX_NAME_LEN, NULL);
+	if (status < 0) {
+	    rodsLog (LOG_ERROR,
+	      "packCodec: strlen of cacheDir > dim size %d, content: %s", MAX_NAME_LEN, (char *) elemPtr2);
+	    return (status);
+	}
+	/* int cacheDirty */
+	elemPtr2 = CODEC_ALIGN (elemPtr2, 4);
+	codecPackInt (&elemPtr2, packedOutput, 1);
+	/* int replNum */
+	elemPtr2 = CODEC_ALIGN (elemPtr2, 4);
+	codecPackInt (&elemPtr2, packedOutput, 1);
+	if (packFlag & FREE_POINTER) {
+	    free (pointer1);
+	}
+    }
+    /* struct KeyValPair_PI */
+    /* int ssLen */
+    inPtr = CODEC_ALIGN (inPtr, 4);
+    intValue3 = codecPackInt (&inPtr, packedOutput, 1);
+    /* str *keyWord[ssLen] */
+    inPtr = CODEC_ALIGN (inPtr, CODEC_ALIGN_POINTER);
+    pointer4 = *(void **) inPtr;
+    inPtr = (char *) inPtr + sizeof (void *);
+    if (pointer4 == NULL) {
+	packNullString (packedOutput);
+    } else {
+	numPointer6 = intValue3;
+	for (j7 = 0; j7 < numPointer6; j7++) {
+	    elemPtr5 = ((void **) pointer4)[j7];
+	    status = packNatString (&elemPtr5, packedOutput, -1, NULL);
+	    if (status < 0) {
+		rodsLog (LOG_ERROR,
+		  "packCodec: strlen of keyWord > dim size, content: %s", (char *) elemPtr5);
+		return (status);
+	    }
+	    if (packFlag & FREE_POINTER) {
+		free (((void **) pointer4)[j7]);
+	    }
+	}
+	if ((packFlag & FREE_POINTER) && numPointer6 > 0) {
+	    /* Array of pointers */
+	    free (pointer4);
+	}
+    }
+    /* str *svalue[ssLen] */
+    inPtr = CODEC_ALIGN (inPtr, CODEC_ALIGN_POINTER);
+    pointer8 = *(void **) inPtr;
+    inPtr = (char *) inPtr + sizeof (void *);
+    if (pointer8 == NULL) {
+	packNullString (packedOutput);
+    } else {
+	numPointer10 = intValue3;
+	for (j11 = 0; j11 < numPointer10; j11++) {
+	    elemPtr9 = ((void **) pointer8)[j11];
+	    status = packNatString (&elemPtr9, packedOutput, -1, NULL);
+	    if (status < 0) {
+		rodsLog (LOG_ERROR,
+		  "packCodec: strlen of svalue > dim size, content: %s", (char *) elemPtr9);
+		return (status);
+	    }
+	    if (packFlag & FREE_POINTER) {
+		free (((void **) pointer8)[j11]);
+	    }
+	}
+	if ((packFlag & FREE_POINTER) && numPointer10 > 0) {
+	    /* Array of pointers */
+	    free (pointer8);
+	}
+    }
+
+    return (0);
+}
+
+static int
+unpackCodecDataObjInp (void *inPackedStr, packedOutput_t *unpackedOutput)
+{
+    char *outStr;
+    int allocLen11;
+    int allocLen6;
+    int intValue3;
+    int j13;
+    int j8;
+    int numPointer4;
+    int numPointer9;
+    int status;
+    packedOutput_t subOutput1;
+    void *inPtr = inPackedStr;
+    void *outPtr12;
+    void *outPtr2;
+    void *outPtr7;
+    void **pointerArray10;
+    void **pointerArray5;
+
+    /* str objPath[MAX_NAME_LEN] */
+    status = unpackNatString (&inPtr, unpackedOutput, MAX_NAME_LEN, &outStr);
+    if (status < 0) {
+	rodsLog (LOG_ERROR,
+	  "unpackCodec: strlen of objPath > dim size, content: %s", (char *) inPtr);
+	return (status);
+    }
+    /* int createMode */
+    codecUnpackInt (&inPtr, unpackedOutput, 1);
+    /* int openFlags */
+    codecUnpackInt (&inPtr, unpackedOutput, 1);
+    /* double offset */
+    codecUnpackDouble (&inPtr, unpackedOutput, 1);
+    /* double dataSize */
+    codecUnpackDouble (&inPtr, unpackedOutput, 1);
+    /* int numThreads */
+    codecUnpackInt (&inPtr, unpackedOutput, 1);
+    /* int oprType */
+    codecUnpackInt (&inPtr, unpackedOutput, 1);
+    /* struct *SpecColl_PI */
+    if (codecUnpackNullString (&inPtr, unpackedOutput) > 0) {
+	outPtr2 = malloc (1 * SUB_STRUCT_ALLOC_SZ);
+	initPackedOutputWithBuf (&subOutput1, outPtr2, 1 * SUB_STRUCT_ALLOC_SZ);
+	/* int collClass */
+	codecUnpackInt (&inPtr, &subOutput1, 1);
+	/* int type */
+	codecUnpackInt (&inPtr, &subOutput1, 1);
+	/* str collection[MAX_NAME_LEN] */
+	status = unpackNatString (&inPtr, &subOutput1, MAX_NAME_LEN, &outStr);
+	if (status < 0) {
+	    rodsLog (LOG_ERROR,
+	      "unpackCodec: strlen of collection > dim size, content: %s", (char *) inPtr);
+	    return (status);
+	}
+	/* str objPath[MAX_NAME_LEN] */
+	status = unpackNatString (&inPtr, &subOutput1, MAX_NAME_LEN, &outStr);
+	if (status < 0) {
+	    rodsLog (LOG_ERROR,
+	      "unpackCodec: strlen of objPath > dim size, content: %s", (char *) inPtr);
+	    return (status);
+	}
+	/* str resource[NAME_LEN] */
+	status = unpackNatString (&inPtr, &subOutput1, NAME_LEN, &outStr);
+	if (status < 0) {
+	    rodsLog (LOG_ERROR,
+	      "unpackCodec: strlen of resource > dim size, content: %s", (char *) inPtr);
+	    return (status);
+	}
+	/* str phyPath[MAX_NAME_LEN] */
+	status = unpackNatString (&inPtr, &subOutput1, MAX_NAME_LEN, &outStr);
+	if (status < 0) {
+	    rodsLog (LOG_ERROR,
+	      "unpackCodec: strlen of phyPath > dim size, content: %s", (char *) inPtr);
+	    return (status);
+	}
+	/* str cacheDir[MAX_NAME_LEN] */
+	status = unpackNatString (&inPtr, &subOutput1, MAX_NAME_LEN, &outStr);
+	if (status < 0) {
+	    rodsLog (LOG_ERROR,
+	      "unpackCodec: strlen of cacheDir > dim size, content: %s", (char *) inPtr);
+	    return (status);
+	}
+	/* int cacheDirty */
+	codecUnpackInt (&inPtr, &subOutput1, 1);
+	/* int replNum */
+	codecUnpackInt (&inPtr, &subOutput1, 1);
+	addPointerToPackedOut (unpackedOutput, 1 * SUB_STRUCT_ALLOC_SZ,
+	  subOutput1.bBuf->buf);
+	free (subOutput1.bBuf);
+    }
+    /* struct KeyValPair_PI */
+    /* int ssLen */
+    intValue3 = codecUnpackInt (&inPtr, unpackedOutput, 1);
+    /* str *keyWord[ssLen] */
+    if (codecUnpackNullString (&inPtr, unpackedOutput) > 0) {
+	numPointer4 = intValue3;
+	if (numPointer4 <= 0) {
+	    /* a null pointer */
+	    addPointerToPackedOut (unpackedOutput, 0, NULL);
+	} else {
+	    pointerArray5 = (void **) addPointerToPackedOut (unpackedOutput,
+	      codecPtrArrayLen (numPointer4) * sizeof (void *), NULL);
+	    for (j8 = 0; j8 < numPointer4; j8++) {
+		allocLen6 = codecAllocLenForStr (inPtr, 1, -1);
+		if (allocLen6 < 0) {
+		    rodsLog (LOG_ERROR,
+		      "unpackCodec: maxStrLen < 0 with numStr > 1 for keyWord");
+		    return (allocLen6);
+		}
+		outPtr7 = pointerArray5[j8] = malloc (allocLen6);
+		status = unpackNatStringToOutPtr (&inPtr, &outPtr7, -1);
+		if (status < 0) {
+		    return (status);
+		}
+	    }
+	}
+    }
+    /* str *svalue[ssLen] */
+    if (codecUnpackNullString (&inPtr, unpackedOutput) > 0) {
+	numPointer9 = intValue3;
+	if (numPointer9 <= 0) {
+	    /* a null pointer */
+	    addPointerToPackedOut (unpackedOutput, 0, NULL);
+	} else {
+	    pointerArray10 = (void **) addPointerToPackedOut (unpackedOutput,
+	      codecPtrArrayLen (numPointer9) * sizeof (void *), NULL);
+	    for (j13 = 0; j13 < numPointer9; j13++) {
+		allocLen11 = codecAllocLenForStr (inPtr, 1, -1);
+		if (allocLen11 < 0) {
+		    rodsLog (LOG_ERROR,
+		      "unpackCodec: maxStrLen < 0 with numStr > 1 for svalue");
+		    return (allocLen11);
+		}
+		outPtr12 = pointerArray10[j13] = malloc (allocLen11);
+		status = unpackNatStringToOutPtr (&inPtr, &outPtr12, -1);
+		if (status < 0) {
+		    return (status);
+		}
+	    }
+	}
+    }
+
+    return (0);
+}
+
+static int
+packCodecOpenedDataObjInp (void *inStruct, packedOutput_t *packedOutput,
+int packFlag)
+{
+    int intValue1;
+    int j5;
+    int j9;
+    int numPointer4;
+    int numPointer8;
+    int status;
+    void *elemPtr3;
+    void *elemPtr7;
+    void *inPtr = inStruct;
+    void *pointer2;
+    void *pointer6;
+
+    /* int l1descInx */
+    inPtr = CODEC_ALIGN (inPtr, 4);
+    codecPackInt (&inPtr, packedOutput, 1);
+    /* int len */
+    inPtr = CODEC_ALIGN (inPtr, 4);
+    codecPackInt (&inPtr, packedOutput, 1);
+    /* int whence */
+    inPtr = CODEC_ALIGN (inPtr, 4);
+    codecPackInt (&inPtr, packedOutput, 1);
+    /* int oprType */
+    inPtr = CODEC_ALIGN (inPtr, 4);
+    codecPackInt (&inPtr, packedOutput, 1);
+    /* double offset */
+    inPtr = CODEC_ALIGN (inPtr, CODEC_ALIGN_DOUBLE);
+    codecPackDouble (&inPtr, packedOutput, 1);
+    /* double bytesWritten */
+    inPtr = CODEC_ALIGN (inPtr, CODEC_ALIGN_DOUBLE);
+    codecPackDouble (&inPtr, packedOutput, 1);
+    /* struct KeyValPair_PI */
+    /* int ssLen */
+    inPtr = CODEC_ALIGN (inPtr, 4);
+    intValue1 = codecPackInt (&inPtr, packedOutput, 1);
+    /* str *keyWord[ssLen] */
+    inPtr = CODEC_ALIGN (inPtr, CODEC_ALIGN_POINTER);
+    pointer2 = *(void **) inPtr;
+    inPtr = (char *) inPtr + sizeof (void *);
+    if (pointer2 == NULL) {
+	packNullString (packedOutput);
+    } else {
+	numPointer4 = intValue1;
+	for (j5 = 0; j5 < numPointer4; j5++) {
+	    elemPtr3 = ((void **) pointer2)[j5];
+	    status = packNatString (&elemPtr3, packedOutput, -1, NULL);
+	    if (status < 0) {
+		rodsLog (LOG_ERROR,
+		  "packCodec: strlen of keyWord > dim size, content: %s", (char *) elemPtr3);
+		return (status);
+	    }
+	    if (packFlag & FREE_POINTER) {
+		free (((void **) pointer2)[j5]);
+	    }
+	}
+	if ((packFlag & FREE_POINTER) && numPointer4 > 0) {
+	    /* Array of pointers */
+	    free (pointer2);
+	}
+    }
+    /* str *svalue[ssLen] */
+    inPtr = CODEC_ALIGN (inPtr, CODEC_ALIGN_POINTER);
+    pointer6 = *(void **) inPtr;
+    inPtr = (char *) inPtr + sizeof (void *);
+    if (pointer6 == NULL) {
+	packNullString (packedOutput);
+    } else {
+	numPointer8 = intValue1;
+	for (j9 = 0; j9 < numPointer8; j9++) {
+	    elemPtr7 = ((void **) pointer6)[j9];
+	    status = packNatString (&elemPtr7, packedOutput, -1, NULL);
+	    if (status < 0) {
+		rodsLog (LOG_ERROR,
+		  "packCodec: strlen of svalue > dim size, content: %s", (char *) elemPtr7);
+		return (status);
+	    }
+	    if (packFlag & FREE_POINTER) {
+		free (((void **) pointer6)[j9]);
+	    }
+	}
+	if ((packFlag & FREE_POINTER) && numPointer8 > 0) {
+	    /* Array of pointers */
+	    free (pointer6);
+	}
+    }
+
+    return (0);
+}
+
+static int
+unpackCodecOpenedDataObjInp (void *inPackedStr, packedOutput_t *unpackedOutput)
+{
+    int allocLen4;
+    int allocLen9;
+    int intValue1;
+    int j11;
+    int j6;
+    int numPointer2;
+    int numPointer7;
+    int status;
+    void *inPtr = inPackedStr;
+    void *outPtr10;
+    void *outPtr5;
+    void **pointerArray3;
+    void **pointerArray8;
+
+    /* int l1descInx */
+    codecUnpackInt (&inPtr, unpackedOutput, 1);
+    /* int len */
+    codecUnpackInt (&inPtr, unpackedOutput, 1);
+    /* int whence */
+    codecUnpackInt (&inPtr, unpackedOutput, 1);
+    /* int oprType */
+    codecUnpackInt (&inPtr, unpackedOutput, 1);
+    /* double offset */
+    codecUnpackDouble (&inPtr, unpackedOutput, 1);
+    /* double bytesWritten */
+    codecUnpackDouble (&inPtr, unpackedOutput, 1);
+    /* struct KeyValPair_PI */
+    /* int ssLen */
+    intValue1 = codecUnpackInt (&inPtr, unpackedOutput, 1);
+    /* str *keyWord[ssLen] */
+    if (codecUnpackNullString (&inPtr, unpackedOutput) > 0) {
+	numPointer2 = intValue1;
+	if (numPointer2 <= 0) {
+	    /* a null pointer */
+	    addPointerToPackedOut (unpackedOutput, 0, NULL);
+	} else {
+	    pointerArray3 = (void **) addPointerToPackedOut (unpackedOutput,
+	      codecPtrArrayLen (numPointer2) * sizeof (void *), NULL);
+	    for (j6 = 0; j6 < numPointer2; j6++) {
+		allocLen4 = codecAllocLenForStr (inPtr, 1, -1);
+		if (allocLen4 < 0) {
+		    rodsLog (LOG_ERROR,
+		      "unpackCodec: maxStrLen < 0 with numStr > 1 for keyWord");
+		    return (allocLen4);
+		}
+		outPtr5 = pointerArray3[j6] = malloc (allocLen4);
+		status = unpackNatStringToOutPtr (&inPtr, &outPtr5, -1);
+		if (status < 0) {
+		    return (status);
+		}
+	    }
+	}
+    }
+    /* str *svalue[ssLen] */
+    if (codecUnpackNullString (&inPtr, unpackedOutput) > 0) {
+	numPointer7 = intValue1;
+	if (numPointer7 <= 0) {
+	    /* a null pointer */
+	    addPointerToPackedOut (unpackedOutput, 0, NULL);
+	} else {
+	    pointerArray8 = (void **) addPointerToPackedOut (unpackedOutput,
+	      codecPtrArrayLen (numPointer7) * sizeof (void *), NULL);
+	    for (j11 = 0; j11 < numPointer7; j11++) {
+		allocLen9 = codecAllocLenForStr (inPtr, 1, -1);
+		if (allocLen9 < 0) {
+		    rodsLog (LOG_ERROR,
+		      "unpackCodec: maxStrLen < 0 with numStr > 1 for svalue");
+		    return (allocLen9);
+		}
+		outPtr10 = pointerArray8[j11] = malloc (allocLen9);
+		status = unpackNatStringToOutPtr (&inPtr, &outPtr10, -1);
+		if (status < 0) {
+		    return (status);
+		}
+	    }
+	}
+    }
+
+    return (0);
+}
+
+static int
+packCodecGenQueryInp (void *inStruct, packedOutput_t *packedOutput,
+int packFlag)
+{
+    int intValue1;
+    int intValue10;
+    int intValue17;
+    int j24;
+    int j5;
+    int j9;
+    int numElement13;
+    int numElement16;
+    int numElement20;
+    int numPointer23;
+    int numPointer4;
+    int numPointer8;
+    int status;
+    void *elemPtr12;
+    void *elemPtr15;
+    void *elemPtr19;
+    void *elemPtr22;
+    void *elemPtr3;
+    void *elemPtr7;
+    void *inPtr = inStruct;
+    void *pointer11;
+    void *pointer14;
+    void *pointer18;
+    void *pointer2;
+    void *pointer21;
+    void *pointer6;
+
+    /* int maxRows */
+    inPtr = CODEC_ALIGN (inPtr, 4);
+    codecPackInt (&inPtr, packedOutput, 1);
+    /* int continueInx */
+    inPtr = CODEC_ALIGN (inPtr, 4);
+    codecPackInt (&inPtr, packedOutput, 1);
+    /* int partialStartIndex */
+    inPtr = CODEC_ALIGN (inPtr, 4);
+    codecPackInt (&inPtr, packedOutput, 1);
+    /* int options */
+    inPtr = CODEC_ALIGN (inPtr, 4);
+    codecPackInt (&inPtr, packedOutput, 1);
+    /* struct KeyValPair_PI */
+    /* int ssLen */
+    inPtr = CODEC_ALIGN (inPtr, 4);
+    intValue1 = codecPackInt (&inPtr, packedOutput, 1);
+    /* str *keyWord[ssLen] */
+    inPtr = CODEC_ALIGN (inPtr, CODEC_ALIGN_POINTER);
+    pointer2 = *(void **) inPtr;
+    inPtr = (char *) inPtr + sizeof (void *);
+    if (pointer2 == NULL) {
+	packNullString (packedOutput);
+    } else {
+	numPointer4 = intValue1;
+	for (j5 = 0; j5 < numPointer4; j5++) {
+	    elemPtr3 = ((void **) pointer2)[j5];
+	    status = packNatString (&elemPtr3, packedOutput, -1, NULL);
+	    if (status < 0) {
+		rodsLog (LOG_ERROR,
+		  "packCodec: strlen of keyWord > dim size, content: %s", (char *) elemPtr3);
+		return (status);
+	    }
+	    if (packFlag & FREE_POINTER) {
+		free (((void **) pointer2)[j5]);
+	    }
+	}
+	if ((packFlag & FREE_POINTER) && numPointer4 > 0) {
+	    /* Array of pointers */
+	    free (pointer2);
+	}
+    }
+    /* str *svalue[ssLen] */
+    inPtr = CODEC_ALIGN (inPtr, CODEC_ALIGN_POINTER);
+    pointer6 = *(void **) inPtr;
+    inPtr = (char *) inPtr + sizeof (void *);
+    if (pointer6 == NULL) {
+	packNullString (packedOutput);
+    } else {
+	numPointer8 = intValue1;
+	for (j9 = 0; j9 < numPointer8; j9++) {
+	    elemPtr7 = ((void **) pointer6)[j9];
+	    status = packNatString (&elemPtr7, packedOutput, -1, NULL);
+	    if (status < 0) {
+		rodsLog (LOG_ERROR,
+		  "packCodec: strlen of svalue > dim size, content: %s", (char *) elemPtr7);
+		return (status);
+	    }
+	    if (packFlag & FREE_POINTER) {
+		free (((void **) pointer6)[j9]);
+	    }
+	}
+	if ((packFlag & FREE_POINTER) && numPointer8 > 0) {
+	    /* Array of pointers */
+	    free (pointer6);
+	}
+    }
+    /* struct InxIvalPair_PI */
+    /* int iiLen */
+    inPtr = CODEC_ALIGN (inPtr, 4);
+    intValue10 = codecPackInt (&inPtr, packedOutput, 1);
+    /* int *inx(iiLen) */
+    inPtr = CODEC_ALIGN (inPtr, CODEC_ALIGN_POINTER);
+    pointer11 = *(void **) inPtr;
+    inPtr = (char *) inPtr + sizeof (void *);
+    if (pointer11 == NULL) {
+	packNullString (packedOutput);
+    } else {
+	numElement13 = intValue10;
+	elemPtr12 = pointer11;
+	codecPackInt (&elemPtr12, packedOutput, numElement13);
+	if (packFlag & FREE_POINTER) {
+	    free (pointer11);
+	}
+    }
+    /* int *ivalue(iiLen) */
+    inPtr = CODEC_ALIGN (inPtr, CODEC_ALIGN_POINTER);
+    pointer14 = *(void **) inPtr;
+    inPtr = (char *) inPtr + sizeof (void *);
+    if (pointer14 == NULL) {
+	packNullString (packedOutput);
+    } else {
+	numElement16 = intValue10;
+	elemPtr15 = pointer14;
+	codecPackInt (&elemPtr15, packedOutput, numElement16);
+	if (packFlag & FREE_POINTER) {
+	    free (pointer14);
+	}
+    }
+    /* struct InxValPair_PI */
+    /* int isLen */
+    inPtr = CODEC_ALIGN (inPtr, 4);
+    intValue17 = codecPackInt (&inPtr, packedOutput, 1);
+    /* int *inx(isLen) */
+    inPtr = CODEC_ALIGN (inPtr, CODEC_ALIGN_POINTER);
+    pointer18 = *(void **) inPtr;
+    inPtr = (char *) inPtr + sizeof (void *);
+    if (pointer18 == NULL) {
+	packNullString (packedOutput);
+    } else {
+	numElement20 = intValue17;
+	elemPtr19 = pointer18;
+	codecPackInt (&elemPtr19, packedOutput, numElement20);
+	if (packFlag & FREE_POINTER) {
+	    free (pointer18);
+	}
+    }
+    /* str *svalue[isLen] */
+    inPtr = CODEC_ALIGN (inPtr, CODEC_ALIGN_POINTER);
+    pointer21 = *(void **) inPtr;
+    inPtr = (char *) inPtr + sizeof (void *);
+    if (pointer21 == NULL) {
+	packNullString (packedOutput);
+    } else {
+	numPointer23 = intValue17;
+	for (j24 = 0; j24 < numPointer23; j24++) {
+	    elemPtr22 = ((void **) pointer21)[j24];
+	    status = packNatString (&elemPtr22, packedOutput, -1, NULL);
+	    if (status < 0) {
+		rodsLog (LOG_ERROR,
+		  "packCodec: strlen of svalue > dim size, content: %s", (char *) elemPtr22);
+		return (status);
+	    }
+	    if (packFlag & FREE_POINTER) {
+		free (((void **) pointer21)[j24]);
+	    }
+	}
+	if ((packFlag & FREE_POINTER) && numPointer23 > 0) {
+	    /* Array of pointers */
+	    free (pointer21);
+	}
+    }
+
+    return (0);
+}
+
+static int
+unpackCodecGenQueryInp (void *inPackedStr, packedOutput_t *unpackedOutput)
+{
+    int allocLen22;
+    int allocLen4;
+    int allocLen9;
+    int intValue1;
+    int intValue12;
+    int intValue17;
+    int j11;
+    int j24;
+    int j6;
+    int numElement13;
+    int numElement15;
+    int numElement18;
+    int numPointer2;
+    int numPointer20;
+    int numPointer7;
+    int status;
+    void *inPtr = inPackedStr;
+    void *outPtr10;
+    void *outPtr14;
+    void *outPtr16;
+    void *outPtr19;
+    void *outPtr23;
+    void *outPtr5;
+    void **pointerArray21;
+    void **pointerArray3;
+    void **pointerArray8;
+
+    /* int maxRows */
+    codecUnpackInt (&inPtr, unpackedOutput, 1);
+    /* int continueInx */
+    codecUnpackInt (&inPtr, unpackedOutput, 1);
+    /* int partialStartIndex */
+    codecUnpackInt (&inPtr, unpackedOutput, 1);
+    /* int options */
+    codecUnpackInt (&inPtr, unpackedOutput, 1);
+    /* struct KeyValPair_PI */
+    /* int ssLen */
+    intValue1 = codecUnpackInt (&inPtr, unpackedOutput, 1);
+    /* str *keyWord[ssLen] */
+    if (codecUnpackNullString (&inPtr, unpackedOutput) > 0) {
+	numPointer2 = intValue1;
+	if (numPointer2 <= 0) {
+	    /* a null pointer */
+	    addPointerToPackedOut (unpackedOutput, 0, NULL);
+	} else {
+	    pointerArray3 = (void **) addPointerToPackedOut (unpackedOutput,
+	      codecPtrArrayLen (numPointer2) * sizeof (void *), NULL);
+	    for (j6 = 0; j6 < numPointer2; j6++) {
+		allocLen4 = codecAllocLenForStr (inPtr, 1, -1);
+		if (allocLen4 < 0) {
+		    rodsLog (LOG_ERROR,
+		      "unpackCodec: maxStrLen < 0 with numStr > 1 for keyWord");
+		    return (allocLen4);
+		}
+		outPtr5 = pointerArray3[j6] = malloc (allocLen4);
+		status = unpackNatStringToOutPtr (&inPtr, &outPtr5, -1);
+		if (status < 0) {
+		    return (status);
+		}
+	    }
+	}
+    }
+    /* str *svalue[ssLen] */
+    if (codecUnpackNullString (&inPtr, unpackedOutput) > 0) {
+	numPointer7 = intValue1;
+	if (numPointer7 <= 0) {
+	    /* a null pointer */
+	    addPointerToPackedOut (unpackedOutput, 0, NULL);
+	} else {
+	    pointerArray8 = (void **) addPointerToPackedOut (unpackedOutput,
+	      codecPtrArrayLen (numPointer7) * sizeof (void *), NULL);
+	    for (j11 = 0; j11 < numPointer7; j11++) {
+		allocLen9 = codecAllocLenForStr (inPtr, 1, -1);
+		if (allocLen9 < 0) {
+		    rodsLog (LOG_ERROR,
+		      "unpackCodec: maxStrLen < 0 with numStr > 1 for svalue");
+		    return (allocLen9);
+		}
+		outPtr10 = pointerArray8[j11] = malloc (allocLen9);
+		status = unpackNatStringToOutPtr (&inPtr, &outPtr10, -1);
+		if (status < 0) {
+		    return (status);
+		}
+	    }
+	}
+    }
+    /* struct InxIvalPair_PI */
+    /* int iiLen */
+    intValue12 = codecUnpackInt (&inPtr, unpackedOutput, 1);
+    /* int *inx(iiLen) */
+    if (codecUnpackNullString (&inPtr, unpackedOutput) > 0) {
+	numElement13 = intValue12;
+	if (numElement13 <= 0) {
+	    /* a null pointer */
+	    addPointerToPackedOut (unpackedOutput, 0, NULL);
+	} else {
+	    outPtr14 = addPointerToPackedOut (unpackedOutput, numElement13 * 4, NULL);
+	    unpackNatIntToOutPtr (&inPtr, &outPtr14, numElement13);
+	}
+    }
+    /* int *ivalue(iiLen) */
+    if (codecUnpackNullString (&inPtr, unpackedOutput) > 0) {
+	numElement15 = intValue12;
+	if (numElement15 <= 0) {
+	    /* a null pointer */
+	    addPointerToPackedOut (unpackedOutput, 0, NULL);
+	} else {
+	    outPtr16 = addPointerToPackedOut (unpackedOutput, numElement15 * 4, NULL);
+	    unpackNatIntToOutPtr (&inPtr, &outPtr16, numElement15);
+	}
+    }
+    /* struct InxValPair_PI */
+    /* int isLen */
+    intValue17 = codecUnpackInt (&inPtr, unpackedOutput, 1);
+    /* int *inx(isLen) */
+    if (codecUnpackNullString (&inPtr, unpackedOutput) > 0) {
+	numElement18 = intValue17;
+	if (numElement18 <= 0) {
+	    /* a null pointer */
+	    addPointerToPackedOut (unpackedOutput, 0, NULL);
+	} else {
+	    outPtr19 = addPointerToPackedOut (unpackedOutput, numElement18 * 4, NULL);
+	    unpackNatIntToOutPtr (&inPtr, &outPtr19, numElement18);
+	}
+    }
+    /* str *svalue[isLen] */
+    if (codecUnpackNullString (&inPtr, unpackedOutput) > 0) {
+	numPointer20 = intValue17;
+	if (numPointer20 <= 0) {
+	    /* a null pointer */
+	    addPointerToPackedOut (unpackedOutput, 0, NULL);
+	} else {
+	    pointerArray21 = (void **) addPointerToPackedOut (unpackedOutput,
+	      codecPtrArrayLen (numPointer20) * sizeof (void *), NULL);
+	    for (j24 = 0; j24 < numPointer20; j24++) {
+		allocLen22 = codecAllocLenForStr (inPtr, 1, -1);
+		if (allocLen22 < 0) {
+		    rodsLog (LOG_ERROR,
+		      "unpackCodec: maxStrLen < 0 with numStr > 1 for svalue");
+		    return (allocLen22);
+		}
+		outPtr23 = pointerArray21[j24] = malloc (allocLen22);
+		status = unpackNatStringToOutPtr (&inPtr, &outPtr23, -1);
+		if (status < 0) {
+		    return (status);
+		}
+	    }
+	}
+    }
+
+    return (0);
+}
+
+static int
+packCodecGenQueryOut (void *inStruct, packedOutput_t *packedOutput,
+int packFlag)
+{
+    int i2;
+    int i9;
+    int intValue1;
+    int intValue3;
+    int maxStrLen7;
+    int numElement6;
+    int numStr8;
+    int status;
+    void *elemPtr5;
+    void *inPtr = inStruct;
+    void *pointer4;
+
+    /* int rowCnt */
+    inPtr = CODEC_ALIGN (inPtr, 4);
+    intValue1 = codecPackInt (&inPtr, packedOutput, 1);
+    /* int attriCnt */
+    inPtr = CODEC_ALIGN (inPtr, 4);
+    codecPackInt (&inPtr, packedOutput, 1);
+    /* int continueInx */
+    inPtr = CODEC_ALIGN (inPtr, 4);
+    codecPackInt (&inPtr, packedOutput, 1);
+    /* int totalRowCount */
+    inPtr = CODEC_ALIGN (inPtr, 4);
+    codecPackInt (&inPtr, packedOutput, 1);
+    /* struct SqlResult_PI[MAX_SQL_ATTR] */
+    for (i2 = 0; i2 < MAX_SQL_ATTR; i2++) {
+	/* int attriInx */
+	inPtr = CODEC_ALIGN (inPtr, 4);
+	codecPackInt (&inPtr, packedOutput, 1);
+	/* int reslen */
+	inPtr = CODEC_ALIGN (inPtr, 4);
+	intValue3 = codecPackInt (&inPtr, packedOutput, 1);
+	/* str *value(rowCnt)(reslen) */
+	inPtr = CODEC_ALIGN (inPtr, CODEC_ALIGN_POINTER);
+	pointer4 = *(void **) inPtr;
+	inPtr = (char *) inPtr + sizeof (void *);
+	if (pointer4 == NULL) {
+	    packNullString (packedOutput);
+	} else {
+	    numElement6 = (intValue1) * (intValue3);
+	    maxStrLen7 = intValue3;
+	    if (numElement6 > 0 && maxStrLen7 > 0) {
+		numStr8 = numElement6 / maxStrLen7;
+		elemPtr5 = pointer4;
+		for (i9 = 0; i9 < numStr8; i9++) {
+		    status = packNatString (&elemPtr5, packedOutput, maxStrLen7, NULL);
+		    if (status < 0) {
+			rodsLog (LOG_ERROR,
+			  "packCodec: strlen of value > dim size, content: %s", (char *) elemPtr5);
+			return (status);
+		    }
+		}
+		if (packFlag & FREE_POINTER) {
+		    free (pointer4);
+		}
+	    }
+	}
+    }
+
+    return (0);
+}
+
+static int
+unpackCodecGenQueryOut (void *inPackedStr, packedOutput_t *unpackedOutput)
+{
+    int allocLen5;
+    int i2;
+    int i9;
+    int intValue1;
+    int intValue3;
+    int maxStrLen7;
+    int numElement4;
+    int numStr8;
+    int status;
+    void *inPtr = inPackedStr;
+    void *outPtr6;
+
+    /* int rowCnt */
+    intValue1 = codecUnpackInt (&inPtr, unpackedOutput, 1);
+    /* int attriCnt */
+    codecUnpackInt (&inPtr, unpackedOutput, 1);
+    /* int continueInx */
+    codecUnpackInt (&inPtr, unpackedOutput, 1);
+    /* int totalRowCount */
+    codecUnpackInt (&inPtr, unpackedOutput, 1);
+    /* struct SqlResult_PI[MAX_SQL_ATTR] */
+    for (i2 = 0; i2 < MAX_SQL_ATTR; i2++) {
+	/* int attriInx */
+	codecUnpackInt (&inPtr, unpackedOutput, 1);
+	/* int reslen */
+	intValue3 = codecUnpackInt (&inPtr, unpackedOutput, 1);
+	/* str *value(rowCnt)(reslen) */
+	if (codecUnpackNullString (&inPtr, unpackedOutput) > 0) {
+	    numElement4 = (intValue1) * (intValue3);
+	    if (numElement4 <= 0) {
+		/* a null pointer */
+		addPointerToPackedOut (unpackedOutput, 0, NULL);
+	    } else {
+		maxStrLen7 = intValue3;
+		numStr8 = maxStrLen7 <= 0 ? 0 : numElement4 / maxStrLen7;
+		if (maxStrLen7 == 0) {
+		    addPointerToPackedOut (unpackedOutput, 0, NULL);
+		} else {
+		    allocLen5 = codecAllocLenForStr (inPtr, numStr8, maxStrLen7);
+		    if (allocLen5 < 0) {
+			rodsLog (LOG_ERROR,
+			  "unpackCodec: maxStrLen < 0 with numStr > 1 for value");
+			return (allocLen5);
+		    }
+		    outPtr6 = addPointerToPackedOut (unpackedOutput, allocLen5, NULL);
+		    for (i9 = 0; i9 < numStr8; i9++) {
+			status = unpackNatStringToOutPtr (&inPtr, &outPtr6, maxStrLen7);
+			if (status < 0) {
+			    return (status);
+			}
+		    }
+		}
+	    }
+	}
+    }
+
+    return (0);
+}
+
+static int
+packCodecRodsObjStat (void *inStruct, packedOutput_t *packedOutput,
+int packFlag)
+{
+    int status;
+    void *elemPtr2;
+    void *inPtr = inStruct;
+    void *pointer1;
+
+    /* double objSize */
+    inPtr = CODEC_ALIGN (inPtr, CODEC_ALIGN_DOUBLE);
+    codecPackDouble (&inPtr, packedOutput, 1);
+    /* int objType */
+    inPtr = CODEC_ALIGN (inPtr, 4);
+    codecPackInt (&inPtr, packedOutput, 1);
+    /* int dataMode */
+    inPtr = CODEC_ALIGN (inPtr, 4);
+    codecPackInt (&inPtr, packedOutput, 1);
+    /* str dataId[NAME_LEN] */
+    status = packNatString (&inPtr, packedOutput, NAME_LEN, NULL);
+    if (status < 0) {
+	rodsLog (LOG_ERROR,
+	  "packCodec: strlen of dataId > dim size %d, content: %s", NAME_LEN, (char *) inPtr);
+	return (status);
+    }
+    /* str chksum[CHKSUM_LEN] */
+    status = packNatString (&inPtr, packedOutput, CHKSUM_LEN, NULL);
+    if (status < 0) {
+	rodsLog (LOG_ERROR,
+	  "packCodec: strlen of chksum > dim size %d, content: %s", CHKSUM_LEN, (char *) inPtr);
+	return (status);
+    }
+    /* str ownerName[NAME_LEN] */
+    status = packNatString (&inPtr, packedOutput, NAME_LEN, NULL);
+    if (status < 0) {
+	rodsLog (LOG_ERROR,
+	  "packCodec: strlen of ownerName > dim size %d, content: %s", NAME_LEN, (char *) inPtr);
+	return (status);
+    }
+    /* str ownerZone[NAME_LEN] */
+    status = packNatString (&inPtr, packedOutput, NAME_LEN, NULL);
+    if (status < 0) {
+	rodsLog (LOG_ERROR,
+	  "packCodec: strlen of ownerZone > dim size %d, content: %s", NAME_LEN, (char *) inPtr);
+	return (status);
+    }
+    /* str createTime[TIME_LEN] */
+    status = packNatString (&inPtr, packedOutput, TIME_LEN, NULL);
+    if (status < 0) {
+	rodsLog (LOG_ERROR,
+	  "packCodec: strlen of createTime > dim size %d, content: %s", TIME_LEN, (char *) inPtr);
+	return (status);
+    }
+    /* str modifyTime[TIME_LEN] */
+    status = packNatString (&inPtr, packedOutput, TIME_LEN, NULL);
+    if (status < 0) {
+	rodsLog (LOG_ERROR,
+	  "packCodec: strlen of modifyTime > dim size %d, content: %s", TIME_LEN, (char *) inPtr);
+	return (status);
+    }
+    /* struct *SpecColl_PI */
+    inPtr = CODEC_ALIGN (inPtr, CODEC_ALIGN_POINTER);
+    pointer1 = *(void **) inPtr;
+    inPtr = (char *) inPtr + sizeof (void *);
+    if (pointer1 == NULL) {
+	packNullString (packedOutput);
+    } else {
+	elemPtr2 = pointer1;
+	/* int collClass */
+	elemPtr2 = CODEC_ALIGN (elemPtr2, 4);
+	codecPackInt (&elemPtr2, packedOutput, 1);
+	/* int type */
+	elemPtr2 = CODEC_ALIGN (elemPtr2, 4);
+	codecPackInt (&elemPtr2, packedOutput, 1);
+	/* str collection[MAX_NAME_LEN] */
+	status = packNatString (&elemPtr2, packedOutput, MAX_NAME_LEN, NULL);
+	if (status < 0) {
+	    rodsLog (LOG_ERROR,
+	      "packCodec: strlen of collection > dim size %d, content: %s", MAX_NAME_LEN, (char *) elemPtr2);
+	    return (status);
+	}
+	/* str objPath[MAX_NAME_LEN] */
+	status = packNatString (&elemPtr2, packedOutput, MAX_NAME_LEN, NULL);
+	if (status < 0) {
+	    rodsLog (LOG_ERROR,
+	      "packCodec: strlen of objPath > dim size %d, content: %s", MAX_NAME_LEN, (char *) elemPtr2);
+	    return (status);
+	}
+	/* str resource[NAME_LEN] */
+	status = packNatString (&elemPtr2, packedOutput, NAME_LEN, NULL);
+	if (status < 0) {
+	    rodsLog (LOG_ERROR,
+	      "packCodec: strlen of resource > dim size %d, content: %s", NAME_LEN, (char *) elemPtr2);
+	    return (status);
+	}
+	/* str phyPath[MAX_NAME_LEN] */
+	status = packNatString (&elemPtr2, packedOutput, MAX_NAME_LEN, NULL);
+	if (status < 0) {
+	    rodsLog (LOG_ERROR,
+	      "packCodec: strlen of phyPath > dim size %d, content: %s", MAX_NAME_LEN, (char *) elemPtr2);
+	    return (status);
+	}
+	/* str cacheDir[MAX_NAME_LEN] */
+	status = packNatString (&elemPtr2, packedOutput, MAX_NAME_LEN, NULL);
+	if (status < 0) {
+	    rodsLog (LOG_ERROR,
+	      "packCodec: strlen of cacheDir > dim size %d, content: %s", MAX_NAME_LEN, (char *) elemPtr2);
+	    return (status);
+	}
+	/* int cacheDirty */
+	elemPtr2 = CODEC_ALIGN (elemPtr2, 4);
+	codecPackInt (&elemPtr2, packedOutput, 1);
+	/* int replNum */
+	elemPtr2 = CODEC_ALIGN (elemPtr2, 4);
+	codecPackInt (&elemPtr2, packedOutput, 1);
+	if (packFlag & FREE_POINTER) {
+	    free (pointer1);
+	}
+    }
+
+    return (0);
+}
+
+static int
+unpackCodecRodsObjStat (void *inPackedStr, packedOutput_t *unpackedOutput)
+{
+    char *outStr;
+    int status;
+    packedOutput_t subOutput1;
+    void *inPtr = inPackedStr;
+    void *outPtr2;
+
+    /* double objSize */
+    codecUnpackDouble (&inPtr, unpackedOutput, 1);
+    /* int objType */
+    codecUnpackInt (&inPtr, unpackedOutput, 1);
+    /* int dataMode */
+    codecUnpackInt (&inPtr, unpackedOutput, 1);
+    /* str dataId[NAME_LEN] */
+    status = unpackNatString (&inPtr, unpackedOutput, NAME_LEN, &outStr);
+    if (status < 0) {
+	rodsLog (LOG_ERROR,
+	  "unpackCodec: strlen of dataId > dim size, content: %s", (char *) inPtr);
+	return (status);
+    }
+    /* str chksum[CHKSUM_LEN] */
+    status = unpackNatString (&inPtr, unpackedOutput, CHKSUM_LEN, &outStr);
+    if (status < 0) {
+	rodsLog (LOG_ERROR,
+	  "unpackCodec: strlen of chksum > dim size, content: %s", (char *) inPtr);
+	return (status);
+    }
+    /* str ownerName[NAME_LEN] */
+    status = unpackNatString (&inPtr, unpackedOutput, NAME_LEN, &outStr);
+    if (status < 0) {
+	rodsLog (LOG_ERROR,
+	  "unpackCodec: strlen of ownerName > dim size, content: %s", (char *) inPtr);
+	return (status);
+    }
+    /* str ownerZone[NAME_LEN] */
+    status = unpackNatString (&inPtr, unpackedOutput, NAME_LEN, &outStr);
+    if (status < 0) {
+	rodsLog (LOG_ERROR,
+	  "unpackCodec: strlen of ownerZone > dim size, content: %s", (char *) inPtr);
+	return (status);
+    }
+    /* str createTime[TIME_LEN] */
+    status = unpackNatString (&inPtr, unpackedOutput, TIME_LEN, &outStr);
+    if (status < 0) {
+	rodsLog (LOG_ERROR,
+	  "unpackCodec: strlen of createTime > dim size, content: %s", (char *) inPtr);
+	return (status);
+    }
+    /* str modifyTime[TIME_LEN] */
+    status = unpackNatString (&inPtr, unpackedOutput, TIME_LEN, &outStr);
+    if (status < 0) {
+	rodsLog (LOG_ERROR,
+	  "unpackCodec: strlen of modifyTime > dim size, content: %s", (char *) inPtr);
+	return (status);
+    }
+    /* struct *SpecColl_PI */
+    if (codecUnpackNullString (&inPtr, unpackedOutput) > 0) {
+	outPtr2 = malloc (1 * SUB_STRUCT_ALLOC_SZ);
+	initPackedOutputWithBuf (&subOutput1, outPtr2, 1 * SUB_STRUCT_ALLOC_SZ);
+	/* int collClass */
+	codecUnpackInt (&inPtr, &subOutput1, 1);
+	/* int type */
+	codecUnpackInt (&inPtr, &subOutput1, 1);
+	/* str collection[MAX_NAME_LEN] */
+	status = unpackNatString (&inPtr, &subOutput1, MAX_NAME_LEN, &outStr);
+	if (status < 0) {
+	    rodsLog (LOG_ERROR,
+	      "unpackCodec: strlen of collection > dim size, content: %s", (char *) inPtr);
+	    return (status);
+	}
+	/* str objPath[MAX_NAME_LEN] */
+	status = unpackNatString (&inPtr, &subOutput1, MAX_NAME_LEN, &outStr);
+	if (status < 0) {
+	    rodsLog (LOG_ERROR,
+	      "unpackCodec: strlen of objPath > dim size, content: %s", (char *) inPtr);
+	    return (status);
+	}
+	/* str resource[NAME_LEN] */
+	status = unpackNatString (&inPtr, &subOutput1, NAME_LEN, &outStr);
+	if (status < 0) {
+	    rodsLog (LOG_ERROR,
+	      "unpackCodec: strlen of resource > dim size, content: %s", (char *) inPtr);
+	    return (status);
+	}
+	/* str phyPath[MAX_NAME_LEN] */
+	status = unpackNatString (&inPtr, &subOutput1, MAX_NAME_LEN, &outStr);
+	if (status < 0) {
+	    rodsLog (LOG_ERROR,
+	      "unpackCodec: strlen of phyPath > dim size, content: %s", (char *) inPtr);
+	    return (status);
+	}
+	/* str cacheDir[MAX_NAME_LEN] */
+	status = unpackNatString (&inPtr, &subOutput1, MAX_NAME_LEN, &outStr);
+	if (status < 0) {
+	    rodsLog (LOG_ERROR,
+	      "unpackCodec: strlen of cacheDir > dim size, content: %s", (char *) inPtr);
+	    return (status);
+	}
+	/* int cacheDirty */
+	codecUnpackInt (&inPtr, &subOutput1, 1);
+	/* int replNum */
+	codecUnpackInt (&inPtr, &subOutput1, 1);
+	addPointerToPackedOut (unpackedOutput, 1 * SUB_STRUCT_ALLOC_SZ,
+	  subOutput1.bBuf->buf);
+	free (subOutput1.bBuf);
+    }
+
+    return (0);
+}
+
+static int
+packCodecCollEnt (void *inStruct, packedOutput_t *packedOutput,
+int packFlag)
+{
+    int status;
+    void *elemPtr10;
+    void *elemPtr12;
+    void *elemPtr14;
+    void *elemPtr16;
+    void *elemPtr18;
+    void *elemPtr2;
+    void *elemPtr20;
+    void *elemPtr22;
+    void *elemPtr4;
+    void *elemPtr6;
+    void *elemPtr8;
+    void *inPtr = inStruct;
+    void *pointer1;
+    void *pointer11;
+    void *pointer13;
+    void *pointer15;
+    void *pointer17;
+    void *pointer19;
+    void *pointer21;
+    void *pointer3;
+    void *pointer5;
+    void *pointer7;
+    void *pointer9;
+
+    /* int objType */
+    inPtr = CODEC_ALIGN (inPtr, 4);
+    codecPackInt (&inPtr, packedOutput, 1);
+    /* int replNum */
+    inPtr = CODEC_ALIGN (inPtr, 4);
+    codecPackInt (&inPtr, packedOutput, 1);
+    /* int replStatus */
+    inPtr = CODEC_ALIGN (inPtr, 4);
+    codecPackInt (&inPtr, packedOutput, 1);
+    /* int dataMode */
+    inPtr = CODEC_ALIGN (inPtr, 4);
+    codecPackInt (&inPtr, packedOutput, 1);
+    /* double dataSize */
+    inPtr = CODEC_ALIGN (inPtr, CODEC_ALIGN_DOUBLE);
+    codecPackDouble (&inPtr, packedOutput, 1);
+    /* str $collName */
+    inPtr = CODEC_ALIGN (inPtr, CODEC_ALIGN_POINTER);
+    pointer1 = *(void **) inPtr;
+    inPtr = (char *) inPtr + sizeof (void *);
+    if (pointer1 == NULL) {
+	packNullString (packedOutput);
+    } else {
+	elemPtr2 = pointer1;
+	status = packNatString (&elemPtr2, packedOutput, -1, NULL);
+	if (status < 0) {
+	    rodsLog (LOG_ERROR,
+	      "packCodec: strlen of collName > dim size, content: %s", (char *) elemPtr2);
+	    return (status);
+	}
+    }
+    /* str $dataName */
+    inPtr = CODEC_ALIGN (inPtr, CODEC_ALIGN_POINTER);
+    pointer3 = *(void **) inPtr;
+    inPtr = (char *) inPtr + sizeof (void *);
+    if (pointer3 == NULL) {
+	packNullString (packedOutput);
+    } else {
+	elemPtr4 = pointer3;
+	status = packNatString (&elemPtr4, packedOutput, -1, NULL);
+	if (status < 0) {
+	    rodsLog (LOG_ERROR,
+	      "packCodec: strlen of dataName > dim size, content: %s", (char *) elemPtr4);
+	    return (status);
+	}
+    }
+    /* str $dataId */
+    inPtr = CODEC_ALIGN (inPtr, CODEC_ALIGN_POINTER);
+    pointer5 = *(void **) inPtr;
+    inPtr = (char *) inPtr + sizeof (void *);
+    if (pointer5 == NULL) {
+	packNullString (packedOutput);
+    } else {
+	elemPtr6 = pointer5;
+	status = packNatString (&elemPtr6, packedOutput, -1, NULL);
+	if (status < 0) {
+	    rodsLog (LOG_ERROR,
+	      "packCodec: strlen of dataId > dim size, content: %s", (char *) elemPtr6);
+	    return (status);
+	}
+    }
+    /* str $createTime */
+    inPtr = CODEC_ALIGN (inPtr, CODEC_ALIGN_POINTER);
+    pointer7 = *(void **) inPtr;
+    inPtr = (char *) inPtr + sizeof (void *);
+    if (pointer7 == NULL) {
+	packNullString (packedOutput);
+    } else {
+	elemPtr8 = pointer7;
+	status = packNatString (&elemPtr8, packedOutput, -1, NULL);
+	if (status < 0) {
+	    rodsLog (LOG_ERROR,
+	      "packCodec: strlen of createTime > dim size, content: %s", (char *) elemPtr8);
+	    return (status);
+	}
+    }
+    /* str $modifyTime */
+    inPtr = CODEC_ALIGN (inPtr, CODEC_ALIGN_POINTER);
+    pointer9 = *(void **) inPtr;
+    inPtr = (char *) inPtr + sizeof (void *);
+    if (pointer9 == NULL) {
+	packNullString (packedOutput);
+    } else {
+	elemPtr10 = pointer9;
+	status = packNatString (&elemPtr10, packedOutput, -1, NULL);
+	if (status < 0) {
+	    rodsLog (LOG_ERROR,
+	      "packCodec: strlen of modifyTime > dim size, content: %s", (char *) elemPtr10);
+	    return (status);
+	}
+    }
+    /* str $chksum */
+    inPtr = CODEC_ALIGN (inPtr, CODEC_ALIGN_POINTER);
+    pointer11 = *(void **) inPtr;
+    inPtr = (char *) inPtr + sizeof (void *);
+    if (pointer11 == NULL) {
+	packNullString (packedOutput);
+    } else {
+	elemPtr12 = pointer11;
+	status = packNatString (&elemPtr12, packedOutput, -1, NULL);
+	if (status < 0) {
+	    rodsLog (LOG_ERROR,
+	      "packCodec: strlen of chksum > dim size, content: %s", (char *) elemPtr12);
+	    return (status);
+	}
+    }
+    /* str $resource */
+    inPtr = CODEC_ALIGN (inPtr, CODEC_ALIGN_POINTER);
+    pointer13 = *(void **) inPtr;
+    inPtr = (char *) inPtr + sizeof (void *);
+    if (pointer13 == NULL) {
+	packNullString (packedOutput);
+    } else {
+	elemPtr14 = pointer13;
+	status = packNatString (&elemPtr14, packedOutput, -1, NULL);
+	if (status < 0) {
+	    rodsLog (LOG_ERROR,
+	      "packCodec: strlen of resource > dim size, content: %s", (char *) elemPtr14);
+	    return (status);
+	}
+    }
+    /* str $rescGrp */
+    inPtr = CODEC_ALIGN (inPtr, CODEC_ALIGN_POINTER);
+    pointer15 = *(void **) inPtr;
+    inPtr = (char *) inPtr + sizeof (void *);
+    if (pointer15 == NULL) {
+	packNullString (packedOutput);
+    } else {
+	elemPtr16 = pointer15;
+	status = packNatString (&elemPtr16, packedOutput, -1, NULL);
+	if (status < 0) {
+	    rodsLog (LOG_ERROR,
+	      "packCodec: strlen of rescGrp > dim size, content: %s", (char *) elemPtr16);
+	    return (status);
+	}
+    }
+    /* str $phyPath */
+    inPtr = CODEC_ALIGN (inPtr, CODEC_ALIGN_POINTER);
+    pointer17 = *(void **) inPtr;
+    inPtr = (char *) inPtr + sizeof (void *);
+    if (pointer17 == NULL) {
+	packNullString (packedOutput);
+    } else {
+	elemPtr18 = pointer17;
+	status = packNatString (&elemPtr18, packedOutput, -1, NULL);
+	if (status < 0) {
+	    rodsLog (LOG_ERROR,
+	      "packCodec: strlen of phyPath > dim size, content: %s", (char *) elemPtr18);
+	    return (status);
+	}
+    }
+    /* str $ownerName */
+    inPtr = CODEC_ALIGN (inPtr, CODEC_ALIGN_POINTER);
+    pointer19 = *(void **) inPtr;
+    inPtr = (char *) inPtr + sizeof (void *);
+    if (pointer19 == NULL) {
+	packNullString (packedOutput);
+    } else {
+	elemPtr20 = pointer19;
+	status = packNatString (&elemPtr20, packedOutput, -1, NULL);
+	if (status < 0) {
+	    rodsLog (LOG_ERROR,
+	      "packCodec: strlen of ownerName > dim size, content: %s", (char *) elemPtr20);
+	    return (status);
+	}
+    }
+    /* str $dataType */
+    inPtr = CODEC_ALIGN (inPtr, CODEC_ALIGN_POINTER);
+    pointer21 = *(void **) inPtr;
+    inPtr = (char *) inPtr + sizeof (void *);
+    if (pointer21 == NULL) {
+	packNullString (packedOutput);
+    } else {
+	elemPtr22 = pointer21;
+	status = packNatString (&elemPtr22, packedOutput, -1, NULL);
+	if (status < 0) {
+	    rodsLog (LOG_ERROR,
+	      "packCodec: strlen of dataType > dim size, content: %s", (char *) elemPtr22);
+	    return (status);
+	}
+    }
+    /* struct SpecColl_PI */
+    /* int collClass */
+    inPtr = CODEC_ALIGN (inPtr, 4);
+    codecPackInt (&inPtr, packedOutput, 1);
+    /* int type */
+    inPtr = CODEC_ALIGN (inPtr, 4);
+    codecPackInt (&inPtr, packedOutput, 1);
+    /* str collection[MAX_NAME_LEN] */
+    status = packNatString (&inPtr, packedOutput, MAX_NAME_LEN, NULL);
+    if (status < 0) {
+	rodsLog (LOG_ERROR,
+	  "packCodec: strlen of collection > dim size %d, content: %s", MAX_NAME_LEN, (char *) inPtr);
+	return (status);
+    }
+    /* str objPath[MAX_NAME_LEN] */
+    status = packNatString (&inPtr, packedOutput, MAX_NAME_LEN, NULL);
+    if (status < 0) {
+	rodsLog (LOG_ERROR,
+	  "packCodec: strlen of objPath > dim size %d, content: %s", MAX_NAME_LEN, (char *) inPtr);
+	return (status);
+    }
+    /* str resource[NAME_LEN] */
+    status = packNatString (&inPtr, packedOutput, NAME_LEN, NULL);
+    if (status < 0) {
+	rodsLog (LOG_ERROR,
+	  "packCodec: strlen of resource > dim size %d, content: %s", NAME_LEN, (char *) inPtr);
+	return (status);
+    }
+    /* str phyPath[MAX_NAME_LEN] */
+    status = packNatString (&inPtr, packedOutput, MAX_NAME_LEN, NULL);
+    if (status < 0) {
+	rodsLog (LOG_ERROR,
+	  "packCodec: strlen of phyPath > dim size %d, content: %s", MAX_NAME_LEN, (char *) inPtr);
+	return (status);
+    }
+    /* str cacheDir[MAX_NAME_LEN] */
+    status = packNatString (&inPtr, packedOutput, MAX_NAME_LEN, NULL);
+    if (status < 0) {
+	rodsLog (LOG_ERROR,
+	  "packCodec: strlen of cacheDir > dim size %d, content: %s", MAX_NAME_LEN, (char *) inPtr);
+	return (status);
+    }
+    /* int cacheDirty */
+    inPtr = CODEC_ALIGN (inPtr, 4);
+    codecPackInt (&inPtr, packedOutput, 1);
+    /* int replNum */
+    inPtr = CODEC_ALIGN (inPtr, 4);
+    codecPackInt (&inPtr, packedOutput, 1);
+
+    return (0);
+}
+
+static int
+unpackCodecCollEnt (void *inPackedStr, packedOutput_t *unpackedOutput)
+{
+    char *outStr;
+    int allocLen1;
+    int allocLen11;
+    int allocLen13;
+    int allocLen15;
+    int allocLen17;
+    int allocLen19;
+    int allocLen21;
+    int allocLen3;
+    int allocLen5;
+    int allocLen7;
+    int allocLen9;
+    int status;
+    void *inPtr = inPackedStr;
+    void *outPtr10;
+    void *outPtr12;
+    void *outPtr14;
+    void *outPtr16;
+    void *outPtr18;
+    void *outPtr2;
+    void *outPtr20;
+    void *outPtr22;
+    void *outPtr4;
+    void *outPtr6;
+    void *outPtr8;
+
+    /* int objType */
+    codecUnpackInt (&inPtr, unpackedOutput, 1);
+    /* int replNum */
+    codecUnpackInt (&inPtr, unpackedOutput, 1);
+    /* int replStatus */
+    codecUnpackInt (&inPtr, unpackedOutput, 1);
+    /* int dataMode */
+    codecUnpackInt (&inPtr, unpackedOutput, 1);
+    /* double dataSize */
+    codecUnpackDouble (&inPtr, unpackedOutput, 1);
+    /* str $collName */
+    if (codecUnpackNullString (&inPtr, unpackedOutput) > 0) {
+	allocLen1 = codecAllocLenForStr (inPtr, 1, -1);
+	if (allocLen1 < 0) {
+	    rodsLog (LOG_ERROR,
+	      "unpackCodec: maxStrLen < 0 with numStr > 1 for collName");
+	    return (allocLen1);
+	}
+	outPtr2 = addPointerToPackedOut (unpackedOutput, allocLen1, NULL);
+	status = unpackNatStringToOutPtr (&inPtr, &outPtr2, -1);
+	if (status < 0) {
+	    return (status);
+	}
+    }
+    /* str $dataName */
+    if (codecUnpackNullString (&inPtr, unpackedOutput) > 0) {
+	allocLen3 = codecAllocLenForStr (inPtr, 1, -1);
+	if (allocLen3 < 0) {
+	    rodsLog (LOG_ERROR,
+	      "unpackCodec: maxStrLen < 0 with numStr > 1 for dataName");
+	    return (allocLen3);
+	}
+	outPtr4 = addPointerToPackedOut (unpackedOutput, allocLen3, NULL);
+	status = unpackNatStringToOutPtr (&inPtr, &outPtr4, -1);
+	if (status < 0) {
+	    return (status);
+	}
+    }
+    /* str $dataId */
+    if (codecUnpackNullString (&inPtr, unpackedOutput) > 0) {
+	allocLen5 = codecAllocLenForStr (inPtr, 1, -1);
+	if (allocLen5 < 0) {
+	    rodsLog (LOG_ERROR,
+	      "unpackCodec: maxStrLen < 0 with numStr > 1 for dataId");
+	    return (allocLen5);
+	}
+	outPtr6 = addPointerToPackedOut (unpackedOutput, allocLen5, NULL);
+	status = unpackNatStringToOutPtr (&inPtr, &outPtr6, -1);
+	if (status < 0) {
+	    return (status);
+	}
+    }
+    /* str $createTime */
+    if (codecUnpackNullString (&inPtr, unpackedOutput) > 0) {
+	allocLen7 = codecAllocLenForStr (inPtr, 1, -1);
+	if (allocLen7 < 0) {
+	    rodsLog (LOG_ERROR,
+	      "unpackCodec: maxStrLen < 0 with numStr > 1 for createTime");
+	    return (allocLen7);
+	}
+	outPtr8 = addPointerToPackedOut (unpackedOutput, allocLen7, NULL);
+	status = unpackNatStringToOutPtr (&inPtr, &outPtr8, -1);
+	if (status < 0) {
+	    return (status);
+	}
+    }
+    /* str $modifyTime */
+    if (codecUnpackNullString (&inPtr, unpackedOutput) > 0) {
+	allocLen9 = codecAllocLenForStr (inPtr, 1, -1);
+	if (allocLen9 < 0) {
+	    rodsLog (LOG_ERROR,
+	      "unpackCodec: maxStrLen < 0 with numStr > 1 for modifyTime");
+	    return (allocLen9);
+	}
+	outPtr10 = addPointerToPackedOut (unpackedOutput, allocLen9, NULL);
+	status = unpackNatStringToOutPtr (&inPtr, &outPtr10, -1);
+	if (status < 0) {
+	    return (status);
+	}
+    }
+    /* str $chksum */
+    if (codecUnpackNullString (&inPtr, unpackedOutput) > 0) {
+	allocLen11 = codecAllocLenForStr (inPtr, 1, -1);
+	if (allocLen11 < 0) {
+	    rodsLog (LOG_ERROR,
+	      "unpackCodec: maxStrLen < 0 with numStr > 1 for chksum");
+	    return (allocLen11);
+	}
+	outPtr12 = addPointerToPackedOut (unpackedOutput, allocLen11, NULL);
+	status = unpackNatStringToOutPtr (&inPtr, &outPtr12, -1);
+	if (status < 0) {
+	    return (status);
+	}
+    }
+    /* str $resource */
+    if (codecUnpackNullString (&inPtr, unpackedOutput) > 0) {
+	allocLen13 = codecAllocLenForStr (inPtr, 1, -1);
+	if (allocLen13 < 0) {
+	    rodsLog (LOG_ERROR,
+	      "unpackCodec: maxStrLen < 0 with numStr > 1 for resource");
+	    return (allocLen13);
+	}
+	outPtr14 = addPointerToPackedOut (unpackedOutput, allocLen13, NULL);
+	status = unpackNatStringToOutPtr (&inPtr, &outPtr14, -1);
+	if (status < 0) {
+	    return (status);
+	}
+    }
+    /* str $rescGrp */
+    if (codecUnpackNullString (&inPtr, unpackedOutput) > 0) {
+	allocLen15 = codecAllocLenForStr (inPtr, 1, -1);
+	if (allocLen15 < 0) {
+	    rodsLog (LOG_ERROR,
+	      "unpackCodec: maxStrLen < 0 with numStr > 1 for rescGrp");
+	    return (allocLen15);
+	}
+	outPtr16 = addPointerToPackedOut (unpackedOutput, allocLen15, NULL);
+	status = unpackNatStringToOutPtr (&inPtr, &outPtr16, -1);
+	if (status < 0) {
+	    return (status);
+	}
+    }
+    /* str $phyPath */
+    if (codecUnpackNullString (&inPtr, unpackedOutput) > 0) {
+	allocLen17 = codecAllocLenForStr (inPtr, 1, -1);
+	if (allocLen17 < 0) {
+	    rodsLog (LOG_ERROR,
+	      "unpackCodec: maxStrLen < 0 with numStr > 1 for phyPath");
+	    return (allocLen17);
+	}
+	outPtr18 = addPointerToPackedOut (unpackedOutput, allocLen17, NULL);
+	status = unpackNatStringToOutPtr (&inPtr, &outPtr18, -1);
+	if (status < 0) {
+	    return (status);
+	}
+    }
+    /* str $ownerName */
+    if (codecUnpackNullString (&inPtr, unpackedOutput) > 0) {
+	allocLen19 = codecAllocLenForStr (inPtr, 1, -1);
+	if (allocLen19 < 0) {
+	    rodsLog (LOG_ERROR,
+	      "unpackCodec: maxStrLen < 0 with numStr > 1 for ownerName");
+	    return (allocLen19);
+	}
+	outPtr20 = addPointerToPackedOut (unpackedOutput, allocLen19, NULL);
+	status = unpackNatStringToOutPtr (&inPtr, &outPtr20, -1);
+	if (status < 0) {
+	    return (status);
+	}
+    }
+    /* str $dataType */
+    if (codecUnpackNullString (&inPtr, unpackedOutput) > 0) {
+	allocLen21 = codecAllocLenForStr (inPtr, 1, -1);
+	if (allocLen21 < 0) {
+	    rodsLog (LOG_ERROR,
+	      "unpackCodec: maxStrLen < 0 with numStr > 1 for dataType");
+	    return (allocLen21);
+	}
+	outPtr22 = addPointerToPackedOut (unpackedOutput, allocLen21, NULL);
+	status = unpackNatStringToOutPtr (&inPtr, &outPtr22, -1);
+	if (status < 0) {
+	    return (status);
+	}
+    }
+    /* struct SpecColl_PI */
+    /* int collClass */
+    codecUnpackInt (&inPtr, unpackedOutput, 1);
+    /* int type */
+    codecUnpackInt (&inPtr, unpackedOutput, 1);
+    /* str collection[MAX_NAME_LEN] */
+    status = unpackNatString (&inPtr, unpackedOutput, MAX_NAME_LEN, &outStr);
+    if (status < 0) {
+	rodsLog (LOG_ERROR,
+	  "unpackCodec: strlen of collection > dim size, content: %s", (char *) inPtr);
+	return (status);
+    }
+    /* str objPath[MAX_NAME_LEN] */
+    status = unpackNatString (&inPtr, unpackedOutput, MAX_NAME_LEN, &outStr);
+    if (status < 0) {
+	rodsLog (LOG_ERROR,
+	  "unpackCodec: strlen of objPath > dim size, content: %s", (char *) inPtr);
+	return (status);
+    }
+    /* str resource[NAME_LEN] */
+    status = unpackNatString (&inPtr, unpackedOutput, NAME_LEN, &outStr);
+    if (status < 0) {
+	rodsLog (LOG_ERROR,
+	  "unpackCodec: strlen of resource > dim size, content: %s", (char *) inPtr);
+	return (status);
+    }
+    /* str phyPath[MAX_NAME_LEN] */
+    status = unpackNatString (&inPtr, unpackedOutput, MAX_NAME_LEN, &outStr);
+    if (status < 0) {
+	rodsLog (LOG_ERROR,
+	  "unpackCodec: strlen of phyPath > dim size, content: %s", (char *) inPtr);
+	return (status);
+    }
+    /* str cacheDir[MAX_NAME_LEN] */
+    status = unpackNatString (&inPtr, unpackedOutput, MAX_NAME_LEN, &outStr);
+    if (status < 0) {
+	rodsLog (LOG_ERROR,
+	  "unpackCodec: strlen of cacheDir > dim size, content: %s", (char *) inPtr);
+	return (status);
+    }
+    /* int cacheDirty */
+    codecUnpackInt (&inPtr, unpackedOutput, 1);
+    /* int replNum */
+    codecUnpackInt (&inPtr, unpackedOutput, 1);
+
+    return (0);
+}
+
+#endif	/* solaris on sparc */
+
+packCodec_t PackCodecTable[] = {
+#if !defined(solaris_platform) || defined(i86_hardware)
+    {"DataObjInp_PI", packCodecDataObjInp, unpackCodecDataObjInp},
+    {"OpenedDataObjInp_PI", packCodecOpenedDataObjInp, unpackCodecOpenedDataObjInp},
+    {"GenQueryInp_PI", packCodecGenQueryInp, unpackCodecGenQueryInp},
+    {"GenQueryOut_PI", packCodecGenQueryOut, unpackCodecGenQueryOut},
+    {"RodsObjStat_PI", packCodecRodsObjStat, unpackCodecRodsObjStat},
+    {"CollEnt_PI", packCodecCollEnt, unpackCodecCollEnt},
+#endif
+    {PACK_TABLE_END_PI, NULL, NULL},
+};
@@ -10,6 +10,27 @@
 #include "rcGlobalExtern.h"
 #include "base64.h"
 #include "rcMisc.h"
+#include "xmlScan.h"
+
+/* pack instructions compiled so far, by their text */
+static packOpList_t *PackOpCache[PACK_OP_CACHE_SLOTS];
+static int PackOpCacheCount = 0;
+static int PackOpCacheOn = 1;
+
+/* use the generated codecs of packCodec.c */
+static int PackCodecOn = 1;
+
+/* RodsPackTable and ApiPackTable by name, and PackConstantTable */
+static packNameIndex_t *PackInstructIndex = NULL;
+static packNameIndex_t *PackConstantIndex = NULL;
+
+static unsigned int hashPackStr (char *str);
+static packNameIndex_t *getPackInstructIndex ();
+static packNameIndex_t *getPackConstantIndex ();
+static int addToPackNameIndex (packNameIndex_t *myIndex, char *name,
+void *value);
+static int lookupPackNameIndex (packNameIndex_t *myIndex, char *name,
+void **value);
 
 int 
 packStruct (void *inStruct, bytesBuf_t **packedResult, char *packInstName,
@@ -18,6 +39,7 @@ packInstructArray_t *myPackTable, int packFlag, irodsProt_t irodsProt)
     int status;
     packItem_t rootPackedItem;
     packedOutput_t packedOutput;
+    packCodec_t *packCodec;
     void *inPtr;
 
     if (inStruct == NULL || packedResult == NULL || packInstName == NULL) {
@@ -30,6 +52,16 @@ packInstructArray_t *myPackTable, int packFlag, irodsProt_t irodsProt)
 
     initPackedOutput (&packedOutput, MAX_PACKED_OUT_ALLOC_SZ);
 
+    packCodec = matchPackCodec (packInstName, myPackTable, irodsProt);
+    if (packCodec != NULL) {
+	status = packCodec->pack (inStruct, &packedOutput, packFlag);
+	if (status < 0) {
+	    return (status);
+	}
+	*packedResult = packedOutput.bBuf;
+	return (0);
+    }
+
     inPtr = inStruct;
     memset (&rootPackedItem, 0, sizeof (rootPackedItem));
     rootPackedItem.name = packInstName;
@@ -60,6 +92,7 @@ packInstructArray_t *myPackTable, irodsProt_t irodsProt)
     int status;
     packItem_t rootPackedItem;
     packedOutput_t unpackedOutput;
+    packCodec_t *packCodec;
     void *inPtr;
 
     if (inPackedStr == NULL || outStruct == NULL || packInstName == NULL) {
@@ -72,11 +105,16 @@ packInstructArray_t *myPackTable, irodsProt_t irodsProt)
 
     initPackedOutput (&unpackedOutput, PACKED_OUT_ALLOC_SZ);
 
-    inPtr = inPackedStr;
-    memset (&rootPackedItem, 0, sizeof (rootPackedItem));
-    rootPackedItem.name = packInstName;
-    status = unpackChildStruct (&inPtr, &unpackedOutput, &rootPackedItem,
-      myPackTable, 1, irodsProt, NULL);
+    packCodec = matchPackCodec (packInstName, myPackTable, irodsProt);
+    if (packCodec != NULL) {
+	status = packCodec->unpack (inPackedStr, &unpackedOutput);
+    } else {
+        inPtr = inPackedStr;
+        memset (&rootPackedItem, 0, sizeof (rootPackedItem));
+        rootPackedItem.name = packInstName;
+        status = unpackChildStruct (&inPtr, &unpackedOutput, &rootPackedItem,
+          myPackTable, 1, irodsProt, NULL);
+    }
 
     if (status < 0) {
         return (status);
@@ -88,8 +126,30 @@ packInstructArray_t *myPackTable, irodsProt_t irodsProt)
     return (0);
 }
 
+/* parsePackInstruct - get the item list of a pack instruction. the PI
+ * is compiled at its first use, later uses only copy the compiled items */
 int
 parsePackInstruct (char *packInstruct, packItem_t **packItemHead)
+{
+    packOpList_t *opList = NULL;
+    int status;
+
+    if (PackOpCacheOn > 0) {
+	status = getCompiledPackInstruct (packInstruct, &opList);
+	if (status < 0) {
+	    return (status);
+	}
+	if (opList != NULL) {
+	    return (instantiatePackOps (opList, packItemHead));
+	}
+    }
+
+    /* the cache is full */
+    return (parsePackInstructText (packInstruct, packItemHead));
+}
+
+int
+parsePackInstructText (char *packInstruct, packItem_t **packItemHead)
 {
     char buf[MAX_PI_LEN];
     packItem_t *myPackItem = NULL;
@@ -230,6 +290,280 @@ parsePackInstruct (char *packInstruct, packItem_t **packItemHead)
     return (0);
 }
 
+/* getCompiledPackInstruct - look up the compiled packInstruct, compiling
+ * it if it is new. *opList is NULL if the cache is full or turned off.
+ * the cache is read without a lock, entries are only ever prepended to
+ * a bucket with a compare and swap */
+int
+getCompiledPackInstruct (char *packInstruct, packOpList_t **opList)
+{
+    packOpList_t *myOpList, *head, *tmpOpList;
+    unsigned int hash;
+    int status;
+
+    *opList = NULL;
+    if (PackOpCacheOn <= 0) {
+	return (0);
+    }
+
+    hash = hashPackStr (packInstruct);
+    head = PackOpCache[hash % PACK_OP_CACHE_SLOTS];
+    for (tmpOpList = head; tmpOpList != NULL; tmpOpList = tmpOpList->next) {
+	if (tmpOpList->hash == hash && 
+	  strcmp (tmpOpList->packInstruct, packInstruct) == 0) {
+	    *opList = tmpOpList;
+	    return (0);
+	}
+    }
+
+    if (PackOpCacheCount >= PACK_OP_CACHE_MAX) {
+	return (0);
+    }
+
+    status = compilePackInstruct (packInstruct, &myOpList);
+    if (status < 0) {
+	return (status);
+    }
+    myOpList->hash = hash;
+
+    while (1) {
+	myOpList->next = head;
+	if (__sync_bool_compare_and_swap (
+	  &PackOpCache[hash % PACK_OP_CACHE_SLOTS], head, myOpList)) {
+	    __sync_fetch_and_add (&PackOpCacheCount, 1);
+	    *opList = myOpList;
+	    return (0);
+	}
+	/* someone else got in first, maybe with the same PI */
+	head = PackOpCache[hash % PACK_OP_CACHE_SLOTS];
+	for (tmpOpList = head; tmpOpList != NULL; 
+	  tmpOpList = tmpOpList->next) {
+	    if (tmpOpList->hash == hash && 
+	      strcmp (tmpOpList->packInstruct, packInstruct) == 0) {
+		/* the list is dropped, it has not been seen by anyone.
+		 * the names it points to are leaked, this is rare */
+		free (myOpList->ops);
+		free (myOpList->packInstruct);
+		free (myOpList);
+		*opList = tmpOpList;
+		return (0);
+	    }
+	}
+    }
+}
+
+/* compilePackInstruct - parse packInstruct once into an op list */
+int
+compilePackInstruct (char *packInstruct, packOpList_t **opList)
+{
+    packItem_t *packItemHead = NULL;
+    packItem_t *tmpItem;
+    packOpList_t *myOpList;
+    packOp_t *myOp;
+    int status;
+    int numOps = 0;
+
+    status = parsePackInstructText (packInstruct, &packItemHead);
+    if (status < 0) {
+	freePackedItem (packItemHead);
+	return (status);
+    }
+
+    for (tmpItem = packItemHead; tmpItem != NULL; tmpItem = tmpItem->next) {
+	numOps++;
+    }
+
+    myOpList = (packOpList_t *) calloc (1, sizeof (packOpList_t));
+    if (myOpList == NULL) {
+	freePackedItem (packItemHead);
+	return (SYS_MALLOC_ERR);
+    }
+    myOpList->packInstruct = strdup (packInstruct);
+    myOpList->numOps = numOps;
+    if (numOps > 0) {
+        myOpList->ops = (packOp_t *) calloc (numOps, sizeof (packOp_t));
+    }
+
+    myOp = myOpList->ops;
+    for (tmpItem = packItemHead; tmpItem != NULL; tmpItem = tmpItem->next) {
+	myOp->typeInx = tmpItem->typeInx;
+	myOp->pointerType = tmpItem->pointerType;
+	rstrcpy (myOp->strValue, tmpItem->strValue, NAME_LEN);
+	if (tmpItem->typeInx == PACK_INT_DEPENDENT_TYPE) {
+	    /* the whole switch is in the name, resolveIntDepItem parses it */
+	    myOp->name = strdup (tmpItem->name);
+	} else {
+	    compilePackDims (myOp, tmpItem->name);
+	}
+	myOp++;
+    }
+
+    freePackedItem (packItemHead);
+    *opList = myOpList;
+    return (0);
+}
+
+/* compilePackDims - take name[dim]...(hint)... apart as resolveDepInArray
+ * does. a malformed name is kept whole with dim -1, so that the error is
+ * reported by resolveDepInArray when the item is used */
+int
+compilePackDims (packOp_t *myOp, char *name)
+{
+    char buf[MAX_PI_LEN];
+    char *inPtr = name;
+    char *bufPtr = buf;
+    int outLen = 0;
+    int gotOpenBrack = 0;
+    int gotOpenPraren = 0;
+    int nameLen = -1;
+    int c;
+
+    myOp->dim = myOp->hintDim = 0;
+
+    while ((c = *inPtr) != '\0') {
+	if (c == '[' || c == '(') {
+	    if (gotOpenBrack > 0 || gotOpenPraren > 0 || 
+	      (c == '(' && outLen > 0) ||
+	      (c == '[' && myOp->dim >= MAX_PACK_DIM) ||
+	      (c == '(' && myOp->hintDim >= MAX_PACK_DIM)) {
+		break;
+	    }
+	    if (nameLen < 0) {
+		nameLen = inPtr - name;
+	    }
+	    if (c == '[') {
+		gotOpenBrack = 1;
+	    } else {
+		gotOpenPraren = 1;
+	    }
+	} else if (c == ']' || c == ')') {
+	    int *mySize;
+	    char **myName;
+
+	    if (outLen <= 0 || (c == ']' && gotOpenBrack == 0) ||
+	      (c == ')' && gotOpenPraren == 0)) {
+		break;
+	    }
+	    *bufPtr = '\0';
+	    if (c == ']') {
+		mySize = &myOp->dimSize[myOp->dim];
+		myName = &myOp->dimName[myOp->dim];
+		myOp->dim++;
+	    } else {
+		mySize = &myOp->hintDimSize[myOp->hintDim];
+		myName = &myOp->hintDimName[myOp->hintDim];
+		myOp->hintDim++;
+	    }
+	    if (isAllDigit (buf)) {
+		*mySize = atoi (buf);
+	    } else {
+		/* may be an item or a constant, resolved per use */
+		*myName = strdup (buf);
+	    }
+	    bufPtr = buf;
+	    outLen = 0;
+	    gotOpenBrack = gotOpenPraren = 0;
+	} else if (gotOpenBrack > 0 || gotOpenPraren > 0) {
+	    if (outLen >= MAX_PI_LEN - 1) {
+		break;
+	    }
+	    *bufPtr = c;
+	    bufPtr ++;
+	    outLen ++;
+	}
+	inPtr ++;
+    }
+
+    if (c != '\0' || gotOpenBrack > 0 || gotOpenPraren > 0) {
+	int i;
+
+	for (i = 0; i < myOp->dim; i++) {
+	    free (myOp->dimName[i]);
+	    myOp->dimName[i] = NULL;
+	}
+	for (i = 0; i < myOp->hintDim; i++) {
+	    free (myOp->hintDimName[i]);
+	    myOp->hintDimName[i] = NULL;
+	}
+	myOp->dim = -1;
+	myOp->hintDim = 0;
+	myOp->name = strdup (name);
+	return (SYS_PACK_INSTRUCT_FORMAT_ERR);
+    }
+
+    if (nameLen < 0) {
+	myOp->name = strdup (name);
+    } else {
+	myOp->name = (char *) malloc (nameLen + 1);
+	strncpy (myOp->name, name, nameLen);
+	myOp->name[nameLen] = '\0';
+    }
+    return (0);
+}
+
+/* instantiatePackOps - make the item list of a compiled PI. the items
+ * share the names of the ops until a name is resolved to another one */
+int
+instantiatePackOps (packOpList_t *opList, packItem_t **packItemHead)
+{
+    packItem_t *myPackItem;
+    packItem_t *prevPackItem = NULL;
+    packOp_t *myOp;
+    int i;
+
+    for (i = 0; i < opList->numOps; i++) {
+	myOp = &opList->ops[i];
+	myPackItem = (packItem_t *) malloc (sizeof (packItem_t));
+	memset (myPackItem, 0, sizeof (packItem_t));
+	myPackItem->typeInx = myOp->typeInx;
+	myPackItem->pointerType = myOp->pointerType;
+	if (myOp->strValue[0] != '\0') {
+	    rstrcpy (myPackItem->strValue, myOp->strValue, NAME_LEN);
+	}
+	if (myOp->dim < 0) {
+	    /* resolveDepInArray cuts the name it parses */
+	    myPackItem->name = strdup (myOp->name);
+	} else {
+	    myPackItem->name = myOp->name;
+	    myPackItem->op = myOp;
+	}
+
+	if (prevPackItem != NULL) {
+	    prevPackItem->next = myPackItem;
+	    myPackItem->prev = prevPackItem;
+	} else {
+	    *packItemHead = myPackItem;
+	}
+	prevPackItem = myPackItem;
+    }
+    return (0);
+}
+
+/* enablePackInstructCache - turn the compiled PI cache on (flag > 0) or
+ * off. returns the previous setting */
+int
+enablePackInstructCache (int flag)
+{
+    int prevFlag = PackOpCacheOn;
+
+    PackOpCacheOn = flag;
+    return (prevFlag);
+}
+
+/* freePackItemName - free the name of an item unless it is shared with
+ * the compiled op it came from */
+void
+freePackItemName (packItem_t *myPackedItem)
+{
+    if (myPackedItem->name == NULL) {
+	return;
+    }
+    if (myPackedItem->op == NULL || myPackedItem->name != myPackedItem->op->name) {
+	free (myPackedItem->name);
+    }
+    myPackedItem->name = NULL;
+}
+
 /* copy the next string from the inBuf to putBuf and advance the inBuf pointer.
  * special char '*', ';' and '?' will be returned as a string.
  */
@@ -581,7 +915,7 @@ resolveIntDepItem (packItem_t *myPackedItem, packInstructArray_t *myPackTable)
     }
 
     /* reset the link and switch myPackedItem<->newType */
-    free (myPackedItem->name);
+    freePackItemName (myPackedItem);
     tmpPackedItem = newPackedItem;
     while (tmpPackedItem != NULL) {
         lastPackedItem = tmpPackedItem;
@@ -608,6 +942,8 @@ resolveIntInItem (char *name, packItem_t *myPackedItem,
 packInstructArray_t *myPackTable)
 {
     packItem_t *tmpPackedItem;
+    packNameIndex_t *myIndex;
+    void *value;
     int i;
 
     if (isAllDigit (name)) {
@@ -648,6 +984,14 @@ packInstructArray_t *myPackTable)
 
     /* Try the Rods Global table */
 
+    myIndex = getPackConstantIndex ();
+    if (myIndex != NULL) {
+	if (lookupPackNameIndex (myIndex, name, &value) >= 0) {
+	    return (((packConstantArray_t *) value)->value);
+	}
+	return (SYS_PACK_INSTRUCT_FORMAT_ERR);
+    }
+
     i = 0;
     while (strcmp (PackConstantTable[i].name, PACK_TABLE_END_PI) != 0) {
         /* not the end */
@@ -692,7 +1036,7 @@ resolveStrInItem (packItem_t *myPackedItem, packInstructArray_t *myPackTable)
     }
 
     myPackedItem->typeInx = PACK_STRUCT_TYPE;
-    free (myPackedItem->name);
+    freePackItemName (myPackedItem);
     myPackedItem->name = strdup (tmpPackedItem->strValue);
     if (aPointer > 0) {
 	myPackedItem->pointerType = 1;
@@ -704,6 +1048,8 @@ resolveStrInItem (packItem_t *myPackedItem, packInstructArray_t *myPackTable)
 void *
 matchPackInstruct (char *name, packInstructArray_t *myPackTable)
 {
+    packNameIndex_t *myIndex;
+    void *packInstruct;
     int i;
 
     if (myPackTable != NULL) {
@@ -717,7 +1063,18 @@ matchPackInstruct (char *name, packInstructArray_t *myPackTable)
 	}
     }
 
-    /* Try the Rods Global table */
+    /* Try the Rods Global table, then the API table */
+
+    myIndex = getPackInstructIndex ();
+    if (myIndex != NULL) {
+	if (lookupPackNameIndex (myIndex, name, &packInstruct) >= 0) {
+	    return (packInstruct);
+	}
+	rodsLog (LOG_ERROR, 
+	  "matchPackInstruct: Cannot resolve %s", 
+	  name);
+	return (NULL);
+    }
 
     i = 0;
     while (strcmp (RodsPackTable[i].name, PACK_TABLE_END_PI) != 0) {
@@ -757,6 +1114,10 @@ resolveDepInArray (packItem_t *myPackedItem, packInstructArray_t *myPackTable)
     int outLen = 0;
     int myDim;
 
+    if (myPackedItem->op != NULL && myPackedItem->name == myPackedItem->op->name) {
+	return (resolveCompiledDims (myPackedItem, myPackTable));
+    }
+
     myPackedItem->dim = myPackedItem->hintDim = 0;
     bufPtr = buf;
     inPtr = myPackedItem->name;
@@ -877,6 +1238,47 @@ resolveDepInArray (packItem_t *myPackedItem, packInstructArray_t *myPackTable)
     return (0);
 }
 
+/* resolveCompiledDims - the dimensions of an item made from a compiled op */
+int
+resolveCompiledDims (packItem_t *myPackedItem, packInstructArray_t *myPackTable)
+{
+    packOp_t *myOp = myPackedItem->op;
+    int i;
+
+    myPackedItem->dim = myOp->dim;
+    for (i = 0; i < myOp->dim; i++) {
+	if (myOp->dimName[i] == NULL) {
+	    myPackedItem->dimSize[i] = myOp->dimSize[i];
+	    continue;
+	}
+	myPackedItem->dimSize[i] = resolveIntInItem (myOp->dimName[i],
+	  myPackedItem, myPackTable);
+	if (myPackedItem->dimSize[i] < 0) {
+	    rodsLog (LOG_ERROR,
+	      "resolveDepInArray:resolveIntInItem error for %s, intName=%s",
+	      myPackedItem->name, myOp->dimName[i]);
+	    return (SYS_PACK_INSTRUCT_FORMAT_ERR);
+	}
+    }
+
+    myPackedItem->hintDim = myOp->hintDim;
+    for (i = 0; i < myOp->hintDim; i++) {
+	if (myOp->hintDimName[i] == NULL) {
+	    myPackedItem->hintDimSize[i] = myOp->hintDimSize[i];
+	    continue;
+	}
+	myPackedItem->hintDimSize[i] = resolveIntInItem (myOp->hintDimName[i],
+	  myPackedItem, myPackTable);
+	if (myPackedItem->hintDimSize[i] < 0) {
+	    rodsLog (LOG_ERROR,
+	      "resolveDepInArray: resolveIntInItem error for %s",
+	      myPackedItem->name);
+	    return (SYS_PACK_INSTRUCT_FORMAT_ERR);
+	}
+    }
+    return (0);
+}
+
 int
 packNonpointerItem (packItem_t *myPackedItem, void **inPtr, 
 packedOutput_t *packedOutput, packInstructArray_t *myPackTable, 
@@ -1467,155 +1869,139 @@ packItem_t *myPackedItem)
 int
 strToXmlStr (char *inStr, char **outXmlStr)
 {
-    char *tmpPtr;
     char *inPtr;
     char *outPtr;
+    const char *entity;
+    int inLen;
     int cpLen;
+    int entityLen;
 
     *outXmlStr = NULL;
     if (inStr == NULL) {
 	return (0);
     }
 
-    inPtr = tmpPtr = inStr;
+    inLen = strlen (inStr);
+    cpLen = scanXmlEscChar (inStr, inLen);
+    if (cpLen == inLen) {
+	/* no predeclared char. just use the inStr */
+	*outXmlStr = inStr;
+	return (inLen);
+    }
+
+    /* an entity is at most 6 chars */
+    *outXmlStr = outPtr = (char *) malloc (6 * inLen + 1);
+    inPtr = inStr;
 
     while (1) {
-	if (*tmpPtr == '&') {
-	    if (*outXmlStr == NULL) {
-		*outXmlStr = outPtr = (char*)malloc (5 * strlen (inPtr) + 6);
-	    }
-	    cpLen = tmpPtr - inPtr;
-	    strncpy (outPtr, inPtr, cpLen);
-	    outPtr += cpLen;
-	    /* strcat (outPtr, "&amp;"); */
-	    rstrcpy (outPtr, "&amp;", 6);
-	    outPtr += 5;
-	    inPtr += cpLen + 1;
-	} else if (*tmpPtr == '<') {
-            if (*outXmlStr == NULL) {
-                *outXmlStr = outPtr = (char*)malloc (5 * strlen (inPtr) + 6);
-            }
-            cpLen = tmpPtr - inPtr;
-            strncpy (outPtr, inPtr, cpLen);
-            outPtr += cpLen;
-            /* strcat (outPtr, "&lt;"); */
-            rstrcpy (outPtr, "&lt;", 5);
-            outPtr += 4;
-            inPtr += cpLen + 1;
-	} else if (*tmpPtr == '>') {
-            if (*outXmlStr == NULL) {
-                *outXmlStr = outPtr = (char*)malloc (5 * strlen (inPtr) + 6);
-            }
-            cpLen = tmpPtr - inPtr;
-            strncpy (outPtr, inPtr, cpLen);
-            outPtr += cpLen;
-	    rstrcpy (outPtr, "&gt;", 5);
-            /* strcat (outPtr, "&gt;"); */
-            outPtr += 4;
-            inPtr += cpLen + 1;
-	} else if (*tmpPtr == '"') {
-            if (*outXmlStr == NULL) {
-                *outXmlStr = outPtr = (char*)malloc (5 * strlen (inPtr) + 6);
-            }
-            cpLen = tmpPtr - inPtr;
-            strncpy (outPtr, inPtr, cpLen);
-            outPtr += cpLen;
-	    rstrcpy (outPtr, "&quot;", 7);
-            outPtr += 6;
-            inPtr += cpLen + 1;
-	} else if (*tmpPtr == '`') {
-            if (*outXmlStr == NULL) {
-                *outXmlStr = outPtr = (char*)malloc (5 * strlen (inPtr) + 6);
-            }
-            cpLen = tmpPtr - inPtr;
-            strncpy (outPtr, inPtr, cpLen);
-            outPtr += cpLen;
-            /* strcat (outPtr, "&apos;"); */
-            rstrcpy (outPtr, "&apos;", 7);
-            outPtr += 6;
-            inPtr += cpLen + 1;
-	} else if (*tmpPtr == '\0') {
+	/* copy up to the next predeclared char */
+	memcpy (outPtr, inPtr, cpLen);
+	outPtr += cpLen;
+	inPtr += cpLen;
+	inLen -= cpLen;
+	if (inLen == 0) {
 	    break;
 	}
-	tmpPtr++;
-    }
 
-    if (*outXmlStr != NULL) {
-	/* copy the remaining */
-	strcpy (outPtr, inPtr); 
-    } else {
-	/* no predeclared char. just use the inStr */
-	*outXmlStr = inStr;
+	switch (*inPtr) {
+	  case '&':
+	    entity = "&amp;";
+	    entityLen = 5;
+	    break;
+	  case '<':
+	    entity = "&lt;";
+	    entityLen = 4;
+	    break;
+	  case '>':
+	    entity = "&gt;";
+	    entityLen = 4;
+	    break;
+	  case '"':
+	    entity = "&quot;";
+	    entityLen = 6;
+	    break;
+	  default:	/* '`' */
+	    entity = "&apos;";
+	    entityLen = 6;
+	    break;
+	}
+	memcpy (outPtr, entity, entityLen);
+	outPtr += entityLen;
+	inPtr++;
+	inLen--;
+
+	cpLen = scanXmlEscChar (inPtr, inLen);
     }
+    *outPtr = '\0';
 
-    return (strlen (*outXmlStr));
+    return (outPtr - *outXmlStr);
 }
 
+/* xmlStrToStr - decode the entities of the myLen chars of inStr in place.
+ * inStr is not null terminated. The str ends at the first '\0' if there
+ * is one. Returns the length of the decoded str */
 int
 xmlStrToStr (char *inStr, int myLen)
 {
-    int savedChar;
-    char *tmpPtr;
     char *inPtr;
-    int len;
+    char *outPtr;
+    char *endPtr;
+    int cpLen;
  
     if (inStr == NULL || myLen == 0) {
 	return (0);
     }
 
-    /* put a null at the end of the str because it is not null terminated */
-    savedChar = inStr[myLen];
-    inStr[myLen] = '\0';
-
     /* do a quick scan for & */
-
-    if (strchr (inStr, '&') == NULL) {
-	inStr[myLen] = savedChar;
+    cpLen = scanXmlEntity (inStr, myLen);
+    if (cpLen == myLen || inStr[cpLen] == '\0') {
 	return (myLen);
     }
 
-    inPtr = inStr;
+    /* one pass. outPtr trails inPtr by the length the entities shrank */
+    inPtr = outPtr = inStr + cpLen;
+    endPtr = inStr + myLen;
 
     while (1) {
-	if ((tmpPtr = strchr (inPtr, '&')) == NULL) {
-	    break;
-	}
-
-        if (strncmp (tmpPtr, "&amp;", 5) == 0) {
-	    inPtr = tmpPtr;
-	    *inPtr = '&';
-	    inPtr ++;
-	    ovStrcpy (inPtr, tmpPtr + 5);
-        } else if (strncmp (tmpPtr, "&lt;", 4) == 0) {
-            inPtr = tmpPtr;
-            *inPtr = '<';
-            inPtr ++;
-            ovStrcpy (inPtr, tmpPtr + 4);
-        } else if (strncmp (tmpPtr, "&gt;", 4) == 0) {
-            inPtr = tmpPtr;
-            *inPtr = '>';
-            inPtr ++;
-            ovStrcpy (inPtr, tmpPtr + 4);
-        } else if (strncmp (tmpPtr, "&quot;", 6) == 0) {
-            inPtr = tmpPtr;
-            *inPtr = '"';
-            inPtr ++;
-            ovStrcpy (inPtr, tmpPtr + 6);
-        } else if (strncmp (tmpPtr, "&apos;", 6) == 0) {
-            inPtr = tmpPtr;
-            *inPtr = '`';
-            inPtr ++;
-            ovStrcpy (inPtr, tmpPtr + 6);
+	/* *inPtr is a '&' */
+        if (endPtr - inPtr >= 5 && strncmp (inPtr, "&amp;", 5) == 0) {
+	    *outPtr = '&';
+	    inPtr += 5;
+        } else if (endPtr - inPtr >= 4 && strncmp (inPtr, "&lt;", 4) == 0) {
+            *outPtr = '<';
+            inPtr += 4;
+        } else if (endPtr - inPtr >= 4 && strncmp (inPtr, "&gt;", 4) == 0) {
+            *outPtr = '>';
+            inPtr += 4;
+        } else if (endPtr - inPtr >= 6 && strncmp (inPtr, "&quot;", 6) == 0) {
+            *outPtr = '"';
+            inPtr += 6;
+        } else if (endPtr - inPtr >= 6 && strncmp (inPtr, "&apos;", 6) == 0) {
+            *outPtr = '`';
+            inPtr += 6;
         } else {
+	    /* not an entity. keep the rest of the str as is */
+	    while (inPtr < endPtr && *inPtr != '\0') {
+		*outPtr++ = *inPtr++;
+	    }
             break;
         }
+	outPtr++;
+
+	cpLen = scanXmlEntity (inPtr, endPtr - inPtr);
+	memmove (outPtr, inPtr, cpLen);
+	outPtr += cpLen;
+	inPtr += cpLen;
+	if (inPtr == endPtr || *inPtr == '\0') {
+	    break;
+	}
     }
 
-    len = strlen (inStr);
-    /* put the char back */
-    inStr[myLen] = savedChar;
+    if (outPtr < endPtr) {
+	*outPtr = '\0';
+    }
 
-    return (len);
+    return (outPtr - inStr);
 }
 
 int
@@ -1896,8 +2282,7 @@ freePackedItem (packItem_t *packItemHead)
 
     while (tmpItem != NULL) {
 	nextItem = tmpItem->next;
-	if (tmpItem->name != NULL)
-	    free (tmpItem->name);
+	freePackItemName (tmpItem);
 	free (tmpItem);
 	tmpItem = nextItem;
     }
@@ -3266,6 +3651,8 @@ parseXmlValue (void **inPtr, packItem_t *myPackedItem, int *endTagLen)
 {
     int status;
     int strLen = 0;
+    char *valuePtr, *tagPtr;
+    int nameLen;
 
     if (inPtr == NULL || *inPtr == NULL || myPackedItem == NULL) {
         return (0);
@@ -3279,6 +3666,22 @@ parseXmlValue (void **inPtr, packItem_t *myPackedItem, int *endTagLen)
         return (status);
     }
 
+    /* the '<' in a value are escaped. The first '<' should start the end
+     * tag, which saves searching for the whole end tag */
+    valuePtr = (char *) *inPtr;
+    strLen = scanXmlTagStart (valuePtr);
+    tagPtr = valuePtr + strLen;
+    nameLen = strlen (myPackedItem->name);
+    if (tagPtr[0] == '<' && tagPtr[1] == '/' &&
+      strncmp (tagPtr + 2, myPackedItem->name, nameLen) == 0 &&
+      tagPtr[nameLen + 2] == '>') {
+	*endTagLen = nameLen + 3;
+	if (tagPtr[nameLen + 3] == '\n') {
+	    (*endTagLen)++;
+	}
+	return (strLen);
+    }
+
     status = parseXmlTag (inPtr, myPackedItem, END_TAG_FL | LF_FL, &strLen);
     if (status >= 0) {
 	*endTagLen = status;
@@ -3331,7 +3734,8 @@ parseXmlTag (void **inPtr, packItem_t *myPackedItem, int flag, int *skipLen)
 	} 
     } else {
 	/* start tag */
-        if ((tmpPtr = strstr (inStrPtr, "<")) == NULL) {
+        tmpPtr = inStrPtr + scanXmlTagStart (inStrPtr);
+        if (*tmpPtr != '<') {
             return (SYS_PACK_INSTRUCT_FORMAT_ERR);
         }
         *skipLen = tmpPtr - inStrPtr;
@@ -3460,3 +3864,445 @@ ovStrcpy (char *outStr, char *inStr)
 
     return 0;
 }
+
+/* matchPackCodec - the generated codec of packInstName. NULL if the
+ * interpreter has to do it, i.e. for XML_PROT, for a struct without a
+ * codec and when myPackTable may redefine the struct */
+packCodec_t *
+matchPackCodec (char *packInstName, packInstructArray_t *myPackTable,
+irodsProt_t irodsProt)
+{
+    int i;
+
+    if (PackCodecOn <= 0 || irodsProt != NATIVE_PROT) {
+	return (NULL);
+    }
+    if (myPackTable != NULL && myPackTable != RodsPackTable) {
+	return (NULL);
+    }
+
+    for (i = 0; strcmp (PackCodecTable[i].name, PACK_TABLE_END_PI) != 0; 
+      i++) {
+	if (strcmp (PackCodecTable[i].name, packInstName) == 0) {
+	    return (&PackCodecTable[i]);
+	}
+    }
+    return (NULL);
+}
+
+/* enablePackCodec - use the generated codecs (flag > 0) or the
+ * interpreter only. returns the previous setting */
+int
+enablePackCodec (int flag)
+{
+    int prevFlag = PackCodecOn;
+
+    PackCodecOn = flag;
+    return (prevFlag);
+}
+
+/* The codec* routines below are the NATIVE_PROT parts of packInt,
+ * unpackInt etc. for the generated codecs. They write the output in
+ * place and do not need a packItem_t. */
+
+int
+codecPackInt (void **inPtr, packedOutput_t *packedOutput, int numElement)
+{
+    int *inIntPtr = (int *) *inPtr;
+    char *outPtr;
+    int intValue = 0;
+    int tmpInt;
+    int i;
+
+    if (numElement <= 0) {
+        return 0;
+    }
+
+    extendPackedOutput (packedOutput, sizeof (int) * numElement, 
+      (void **) &outPtr);
+    if (inIntPtr == NULL) {
+	/* a NULL pointer, fill the array with 0 */
+	memset (outPtr, 0, sizeof (int) * numElement);
+    } else {
+	intValue = *inIntPtr;
+	for (i = 0; i < numElement; i++) {
+	    tmpInt = htonl (inIntPtr[i]);
+	    memcpy (outPtr + i * sizeof (int), &tmpInt, sizeof (int));
+	}
+	*inPtr = inIntPtr + numElement;
+    }
+    packedOutput->bBuf->len += (sizeof (int) * numElement);
+
+    if (intValue < 0) {
+	/* prevent error exiting */
+	intValue = 0;
+    }
+    return (intValue);
+}
+
+int
+codecPackInt16 (void **inPtr, packedOutput_t *packedOutput, int numElement)
+{
+    short *inIntPtr = (short *) *inPtr;
+    char *outPtr;
+    short intValue = 0;
+    short tmpInt;
+    int i;
+
+    if (numElement <= 0) {
+        return 0;
+    }
+
+    extendPackedOutput (packedOutput, sizeof (short) * numElement, 
+      (void **) &outPtr);
+    if (inIntPtr == NULL) {
+	memset (outPtr, 0, sizeof (short) * numElement);
+    } else {
+	intValue = *inIntPtr;
+	for (i = 0; i < numElement; i++) {
+	    tmpInt = htons (inIntPtr[i]);
+	    memcpy (outPtr + i * sizeof (short), &tmpInt, sizeof (short));
+	}
+	*inPtr = inIntPtr + numElement;
+    }
+    packedOutput->bBuf->len += (sizeof (short) * numElement);
+
+    if (intValue < 0) {
+	intValue = 0;
+    }
+    return (intValue);
+}
+
+int
+codecPackDouble (void **inPtr, packedOutput_t *packedOutput, int numElement)
+{
+    rodsLong_t *inDoublePtr = (rodsLong_t *) *inPtr;
+    char *outPtr;
+    rodsLong_t tmpDouble;
+    int i;
+
+    if (numElement <= 0) {
+        return 0;
+    }
+
+    extendPackedOutput (packedOutput, sizeof (rodsLong_t) * numElement, 
+      (void **) &outPtr);
+    if (inDoublePtr == NULL) {
+	memset (outPtr, 0, sizeof (rodsLong_t) * numElement);
+    } else {
+	for (i = 0; i < numElement; i++) {
+	    myHtonll (inDoublePtr[i], &tmpDouble);
+	    memcpy (outPtr + i * sizeof (rodsLong_t), &tmpDouble, 
+	      sizeof (rodsLong_t));
+	}
+	*inPtr = inDoublePtr + numElement;
+    }
+    packedOutput->bBuf->len += (sizeof (rodsLong_t) * numElement);
+
+    return (0);
+}
+
+int
+codecUnpackInt (void **inPtr, packedOutput_t *unpackedOutput, int numElement)
+{
+    char *outPtr;
+    int *outIntPtr;
+    int tmpInt;
+    int intValue = 0;
+    int i;
+
+    if (numElement <= 0) {
+        return 0;
+    }
+
+    extendPackedOutput (unpackedOutput, sizeof (int) * (numElement + 1),
+      (void **) &outPtr);
+    outIntPtr = (int *) alignInt (outPtr);
+    if (*inPtr == NULL) {
+	memset (outIntPtr, 0, sizeof (int) * numElement);
+    } else {
+	for (i = 0; i < numElement; i++) {
+	    memcpy (&tmpInt, (char *) *inPtr + i * sizeof (int), sizeof (int));
+	    outIntPtr[i] = ntohl (tmpInt);
+	}
+	intValue = outIntPtr[0];
+	*inPtr = (char *) *inPtr + sizeof (int) * numElement;
+    }
+    unpackedOutput->bBuf->len = (int) ((char *) outIntPtr - 
+      (char *) unpackedOutput->bBuf->buf) + (sizeof (int) * numElement);
+
+    if (intValue < 0) {
+	/* prevent error exit */
+	intValue = 0;
+    }
+    return (intValue);
+}
+
+int
+codecUnpackInt16 (void **inPtr, packedOutput_t *unpackedOutput, 
+int numElement)
+{
+    char *outPtr;
+    short *outIntPtr;
+    short tmpInt;
+    short intValue = 0;
+    int i;
+
+    if (numElement <= 0) {
+        return 0;
+    }
+
+    extendPackedOutput (unpackedOutput, sizeof (short) * (numElement + 1),
+      (void **) &outPtr);
+    outIntPtr = (short *) alignInt16 (outPtr);
+    if (*inPtr == NULL) {
+	memset (outIntPtr, 0, sizeof (short) * numElement);
+    } else {
+	for (i = 0; i < numElement; i++) {
+	    memcpy (&tmpInt, (char *) *inPtr + i * sizeof (short), 
+	      sizeof (short));
+	    outIntPtr[i] = ntohs (tmpInt);
+	}
+	intValue = outIntPtr[0];
+	*inPtr = (char *) *inPtr + sizeof (short) * numElement;
+    }
+    unpackedOutput->bBuf->len = (int) ((char *) outIntPtr - 
+      (char *) unpackedOutput->bBuf->buf) + (sizeof (short) * numElement);
+
+    if (intValue < 0) {
+	intValue = 0;
+    }
+    return (intValue);
+}
+
+int
+codecUnpackDouble (void **inPtr, packedOutput_t *unpackedOutput, 
+int numElement)
+{
+    char *outPtr;
+    rodsLong_t *outDoublePtr;
+    rodsLong_t tmpDouble;
+    int i;
+
+    if (numElement <= 0) {
+        return 0;
+    }
+
+    extendPackedOutput (unpackedOutput, sizeof (rodsLong_t) * (numElement + 1),
+      (void **) &outPtr);
+#if defined(osx_platform) || (defined(solaris_platform) && defined(i86_hardware))
+    /* osx does not align */
+    outDoublePtr = (rodsLong_t *) alignInt (outPtr);
+#else
+    outDoublePtr = (rodsLong_t *) alignDouble (outPtr);
+#endif
+    if (*inPtr == NULL) {
+	memset (outDoublePtr, 0, sizeof (rodsLong_t) * numElement);
+    } else {
+	for (i = 0; i < numElement; i++) {
+	    memcpy (&tmpDouble, (char *) *inPtr + i * sizeof (rodsLong_t), 
+	      sizeof (rodsLong_t));
+	    myNtohll (tmpDouble, &outDoublePtr[i]);
+	}
+	*inPtr = (char *) *inPtr + sizeof (rodsLong_t) * numElement;
+    }
+    unpackedOutput->bBuf->len = (int) ((char *) outDoublePtr - 
+      (char *) unpackedOutput->bBuf->buf) + 
+      (sizeof (rodsLong_t) * numElement);
+
+    return (0);
+}
+
+/* codecUnpackNullString - the NATIVE_PROT part of unpackNullString. 
+ * returns 0 if a NULL pointer was packed and has been put in 
+ * unpackedOutput, 1 otherwise */
+int
+codecUnpackNullString (void **inPtr, packedOutput_t *unpackedOutput)
+{
+    if (*inPtr == NULL) {
+	addPointerToPackedOut (unpackedOutput, 0, NULL);
+	return (0);
+    }
+    if (strcmp ((char *) *inPtr, NULL_PTR_PACK_STR) == 0) {
+	addPointerToPackedOut (unpackedOutput, 0, NULL);
+	*inPtr = (char *) *inPtr + strlen (NULL_PTR_PACK_STR) + 1;
+	return (0);
+    }
+    return (1);
+}
+
+/* codecPtrArrayLen - the number of pointers allocated for an array of
+ * numPointer pointers, at PTR_ARRAY_MALLOC_LEN boundary */
+int
+codecPtrArrayLen (int numPointer)
+{
+    int myModu;
+
+    if ((myModu = numPointer % PTR_ARRAY_MALLOC_LEN) == 0) {
+	return (numPointer);
+    } else {
+	return (numPointer + PTR_ARRAY_MALLOC_LEN - myModu);
+    }
+}
+
+/* codecAllocLenForStr - getAllocLenForStr without a packItem_t */
+int
+codecAllocLenForStr (void *inPtr, int numStr, int maxStrLen)
+{
+    if (numStr <= 1) {
+        return (getStrLen (inPtr, maxStrLen));
+    } else if (maxStrLen < 0) {
+	return (SYS_PACK_INSTRUCT_FORMAT_ERR);
+    } else {
+        return (numStr * maxStrLen);
+    }
+}
+
+static unsigned int
+hashPackStr (char *str)
+{
+    unsigned int hash = 2166136261u;	/* fnv-1a */
+
+    while (*str != '\0') {
+	hash = (hash ^ (unsigned char) *str) * 16777619u;
+	str++;
+    }
+    return (hash);
+}
+
+/* getPackInstructIndex - RodsPackTable and ApiPackTable by name, with the
+ * first of a name winning as in the linear search. NULL if it cannot be
+ * built */
+static packNameIndex_t *
+getPackInstructIndex ()
+{
+    packNameIndex_t *myIndex;
+    int numNames = 0;
+    int i;
+
+    if (PackInstructIndex != NULL) {
+	return (PackInstructIndex);
+    }
+
+    for (i = 0; strcmp (RodsPackTable[i].name, PACK_TABLE_END_PI) != 0; i++) {
+	numNames++;
+    }
+    for (i = 0; strcmp (ApiPackTable[i].name, PACK_TABLE_END_PI) != 0; i++) {
+	numNames++;
+    }
+
+    myIndex = (packNameIndex_t *) calloc (1, sizeof (packNameIndex_t));
+    if (myIndex == NULL) {
+	return (NULL);
+    }
+    myIndex->numSlots = 64;
+    while (myIndex->numSlots < numNames * 2) {
+	myIndex->numSlots *= 2;
+    }
+    myIndex->names = (char **) calloc (myIndex->numSlots, sizeof (char *));
+    myIndex->values = (void **) calloc (myIndex->numSlots, sizeof (void *));
+    if (myIndex->names == NULL || myIndex->values == NULL) {
+	free (myIndex->names);
+	free (myIndex->values);
+	free (myIndex);
+	return (NULL);
+    }
+
+    for (i = 0; strcmp (RodsPackTable[i].name, PACK_TABLE_END_PI) != 0; i++) {
+	addToPackNameIndex (myIndex, RodsPackTable[i].name, 
+	  RodsPackTable[i].packInstruct);
+    }
+    for (i = 0; strcmp (ApiPackTable[i].name, PACK_TABLE_END_PI) != 0; i++) {
+	addToPackNameIndex (myIndex, ApiPackTable[i].name, 
+	  ApiPackTable[i].packInstruct);
+    }
+
+    /* another thread may have built one meanwhile */
+    if (!__sync_bool_compare_and_swap (&PackInstructIndex, NULL, myIndex)) {
+	free (myIndex->names);
+	free (myIndex->values);
+	free (myIndex);
+    }
+    return (PackInstructIndex);
+}
+
+/* getPackConstantIndex - PackConstantTable by name, the values are the
+ * table entries */
+static packNameIndex_t *
+getPackConstantIndex ()
+{
+    packNameIndex_t *myIndex;
+    int numNames = 0;
+    int i;
+
+    if (PackConstantIndex != NULL) {
+	return (PackConstantIndex);
+    }
+
+    for (i = 0; strcmp (PackConstantTable[i].name, PACK_TABLE_END_PI) != 0; 
+      i++) {
+	numNames++;
+    }
+
+    myIndex = (packNameIndex_t *) calloc (1, sizeof (packNameIndex_t));
+    if (myIndex == NULL) {
+	return (NULL);
+    }
+    myIndex->numSlots = 64;
+    while (myIndex->numSlots < numNames * 2) {
+	myIndex->numSlots *= 2;
+    }
+    myIndex->names = (char **) calloc (myIndex->numSlots, sizeof (char *));
+    myIndex->values = (void **) calloc (myIndex->numSlots, sizeof (void *));
+    if (myIndex->names == NULL || myIndex->values == NULL) {
+	free (myIndex->names);
+	free (myIndex->values);
+	free (myIndex);
+	return (NULL);
+    }
+
+    for (i = 0; strcmp (PackConstantTable[i].name, PACK_TABLE_END_PI) != 0; 
+      i++) {
+	addToPackNameIndex (myIndex, PackConstantTable[i].name, 
+	  &PackConstantTable[i]);
+    }
+
+    if (!__sync_bool_compare_and_swap (&PackConstantIndex, NULL, myIndex)) {
+	free (myIndex->names);
+	free (myIndex->values);
+	free (myIndex);
+    }
+    return (PackConstantIndex);
+}
+
+/* addToPackNameIndex - a name already in the index keeps its value */
+static int
+addToPackNameIndex (packNameIndex_t *myIndex, char *name, void *value)
+{
+    unsigned int slot = hashPackStr (name) & (myIndex->numSlots - 1);
+
+    while (myIndex->names[slot] != NULL) {
+	if (strcmp (myIndex->names[slot], name) == 0) {
+	    return (0);
+	}
+	slot = (slot + 1) & (myIndex->numSlots - 1);
+    }
+    myIndex->names[slot] = name;
+    myIndex->values[slot] = value;
+    return (0);
+}
+
+static int
+lookupPackNameIndex (packNameIndex_t *myIndex, char *name, void **value)
+{
+    unsigned int slot = hashPackStr (name) & (myIndex->numSlots - 1);
+
+    while (myIndex->names[slot] != NULL) {
+	if (strcmp (myIndex->names[slot], name) == 0) {
+	    *value = myIndex->values[slot];
+	    return (0);
+	}
+	slot = (slot + 1) & (myIndex->numSlots - 1);
+    }
+    return (-1);
+}
@@ -0,0 +1,515 @@
+/*** Copyright (c), The Regents of the University of California            ***
+ *** For more information please refer to files in the COPYRIGHT directory ***/
+
+/* procApiAsync.c - pipelined API requests on one connection.
+ *
+ * submitAsyncApiRequest sends a request without waiting for its reply, so
+ * a client can write many requests back to back on one rcComm_t and pay
+ * one round trip for all of them. The agent reads and serves the requests
+ * of a connection one at a time in the order they came in, so the replies
+ * come back in that order and are matched with the queue of the requests
+ * sent. A reply goes to the callback given at submit or, with no callback,
+ * is kept for pollAsyncApiRequest and waitAsyncApiRequest.
+ *
+ * At most window requests are sent and not replied. A submit beyond that
+ * reads the oldest reply first, which keeps the requests in flight within
+ * the socket buffers of both ends.
+ *
+ * Only requests with no byte stream and a single reply can be pipelined,
+ * e.g. rcObjStat, rcGenQuery and rcModAVUMetadata. procApiRequest reads
+ * the outstanding replies before it sends a request of its own and
+ * rcDisconnect does the same before disconnecting. A connection that can
+ * reconnect runs each submit synchronously, cliSwitchConnect does not know
+ * about the requests in flight.
+ */
+#ifndef windows_platform
+#include <sys/time.h>
+#endif
+#include <limits.h>
+#include "procApiRequest.h"
+#include "rcGlobalExtern.h"
+#include "rcMisc.h"
+
+static asyncApiQueue_t *
+getAsyncApiQueue (rcComm_t *conn);
+static int
+readAsyncApiReply (rcComm_t *conn);
+static int
+isAsyncApiReplyReady (rcComm_t *conn);
+static void
+finishAsyncApiReq (rcComm_t *conn, asyncApiReq_t *asyncApiReq);
+static int
+takeAsyncApiReq (asyncApiQueue_t *asyncApiQueue, int ticket, int *apiStatus,
+void **outStruct);
+static void
+freeAsyncApiOut (int apiInx, void *outStruct);
+
+/* submitAsyncApiRequest - send an API request without waiting for the
+ * reply. Returns the ticket (> 0) of the request or an error.
+ * The reply goes to callback if given, else it is taken with
+ * pollAsyncApiRequest or waitAsyncApiRequest.
+ */
+int
+submitAsyncApiRequest (rcComm_t *conn, int apiNumber, void *inputStruct,
+asyncApiCallback callback, void *cbArg)
+{
+    asyncApiQueue_t *asyncApiQueue;
+    asyncApiReq_t *asyncApiReq;
+    int apiInx;
+    int ticket;
+    int status;
+
+    if (conn == NULL) {
+	return (USER__NULL_INPUT_ERR);
+    }
+
+    if ((asyncApiQueue = getAsyncApiQueue (conn)) == NULL) {
+	return (SYS_MALLOC_ERR);
+    }
+    if (asyncApiQueue->status < 0) {
+	return (asyncApiQueue->status);
+    }
+
+    apiInx = apiTableLookup (apiNumber);
+    if (apiInx < 0) {
+        rodsLog (LOG_ERROR,
+          "submitAsyncApiRequest: apiTableLookup of apiNumber %d failed",
+	  apiNumber);
+        return (apiInx);
+    }
+    if (RcApiTable[apiInx].inBsFlag > 0 || RcApiTable[apiInx].outBsFlag > 0) {
+        rodsLog (LOG_ERROR,
+          "submitAsyncApiRequest: apiNumber %d has a byte stream", apiNumber);
+        return (USER_API_INPUT_ERR);
+    }
+
+    while (asyncApiQueue->numOutstanding >= asyncApiQueue->window) {
+	status = readAsyncApiReply (conn);
+	if (status < 0) {
+	    return (status);
+	}
+    }
+
+    asyncApiReq = (asyncApiReq_t *) calloc (1, sizeof (asyncApiReq_t));
+    if (asyncApiReq == NULL) {
+	return (SYS_MALLOC_ERR);
+    }
+    ticket = asyncApiReq->ticket = asyncApiQueue->nextTicket;
+    if (asyncApiQueue->nextTicket == INT_MAX) {
+	asyncApiQueue->nextTicket = 1;
+    } else {
+	asyncApiQueue->nextTicket++;
+    }
+    asyncApiReq->apiInx = apiInx;
+    asyncApiReq->apiNumber = apiNumber;
+    asyncApiReq->callback = callback;
+    asyncApiReq->cbArg = cbArg;
+    gettimeofday (&asyncApiReq->startTime, NULL);
+
+    if (conn->svrVersion != NULL && conn->svrVersion->reconnPort > 0) {
+	asyncApiReq->status = procApiRequest (conn, apiNumber, inputStruct,
+	  NULL, RcApiTable[apiInx].outPackInstruct != NULL ?
+	  &asyncApiReq->outStruct : NULL, NULL);
+	finishAsyncApiReq (conn, asyncApiReq);
+	return (ticket);
+    }
+
+    status = sendApiRequest (conn, apiInx, inputStruct, NULL);
+    if (status < 0) {
+        rodsLogError (LOG_DEBUG, status,
+          "submitAsyncApiRequest: sendApiRequest failed. status = %d", status);
+	callProcApiRequestCB (apiNumber, status, &asyncApiReq->startTime,
+	  NULL, NULL);
+	free (asyncApiReq);
+	return (status);
+    }
+    conn->apiInx = apiInx;
+
+    if (asyncApiQueue->sentTail == NULL) {
+	asyncApiQueue->sentHead = asyncApiReq;
+    } else {
+	asyncApiQueue->sentTail->next = asyncApiReq;
+    }
+    asyncApiQueue->sentTail = asyncApiReq;
+    asyncApiQueue->numOutstanding++;
+
+    return (ticket);
+}
+
+/* pollAsyncApiRequest - take the reply of ticket without blocking, reading
+ * the replies that are in already. Returns 1 with *apiStatus and *outStruct
+ * set if the reply is in, 0 if it is not yet and an error if there is no
+ * such ticket.
+ */
+int
+pollAsyncApiRequest (rcComm_t *conn, int ticket, int *apiStatus,
+void **outStruct)
+{
+    asyncApiQueue_t *asyncApiQueue;
+    int status;
+
+    if (conn == NULL || conn->asyncApi == NULL) {
+	return (USER__NULL_INPUT_ERR);
+    }
+    asyncApiQueue = conn->asyncApi;
+
+    while (asyncApiQueue->numOutstanding > 0 &&
+      isAsyncApiReplyReady (conn) > 0) {
+	status = readAsyncApiReply (conn);
+	if (status < 0) {
+	    break;
+	}
+    }
+
+    return (takeAsyncApiReq (asyncApiQueue, ticket, apiStatus, outStruct));
+}
+
+/* waitAsyncApiRequest - take the reply of ticket, reading replies until it
+ * is in. Returns 1 with *apiStatus and *outStruct set or an error.
+ */
+int
+waitAsyncApiRequest (rcComm_t *conn, int ticket, int *apiStatus,
+void **outStruct)
+{
+    asyncApiQueue_t *asyncApiQueue;
+    int status;
+
+    if (conn == NULL || conn->asyncApi == NULL) {
+	return (USER__NULL_INPUT_ERR);
+    }
+    asyncApiQueue = conn->asyncApi;
+
+    while (1) {
+	status = takeAsyncApiReq (asyncApiQueue, ticket, apiStatus, outStruct);
+	if (status != 0) {
+	    return (status);
+	}
+	status = readAsyncApiReply (conn);
+	if (status < 0) {
+	    return (takeAsyncApiReq (asyncApiQueue, ticket, apiStatus,
+	      outStruct));
+	}
+    }
+}
+
+/* drainAsyncApiRequests - read the replies of all the requests sent.
+ * Returns 0 or the error that stopped the replies from being read.
+ */
+int
+drainAsyncApiRequests (rcComm_t *conn)
+{
+    asyncApiQueue_t *asyncApiQueue;
+    int status;
+
+    if (conn == NULL || conn->asyncApi == NULL) {
+	return (0);
+    }
+    asyncApiQueue = conn->asyncApi;
+
+    while (asyncApiQueue->numOutstanding > 0) {
+	status = readAsyncApiReply (conn);
+	if (status < 0) {
+	    return (status);
+	}
+    }
+    return (0);
+}
+
+/* getNumAsyncApiRequests - the number of requests sent and not replied */
+int
+getNumAsyncApiRequests (rcComm_t *conn)
+{
+    if (conn == NULL || conn->asyncApi == NULL) {
+	return (0);
+    }
+    return (conn->asyncApi->numOutstanding);
+}
+
+/* setAsyncApiWindow - set the number of requests that can be sent and not
+ * replied, ASYNC_API_DEF_WINDOW by default. Returns the previous one.
+ */
+int
+setAsyncApiWindow (rcComm_t *conn, int window)
+{
+    asyncApiQueue_t *asyncApiQueue;
+    int prevWindow;
+
+    if (conn == NULL) {
+	return (USER__NULL_INPUT_ERR);
+    }
+    if ((asyncApiQueue = getAsyncApiQueue (conn)) == NULL) {
+	return (SYS_MALLOC_ERR);
+    }
+
+    if (window < 1) {
+	window = 1;
+    } else if (window > ASYNC_API_MAX_WINDOW) {
+	window = ASYNC_API_MAX_WINDOW;
+    }
+    prevWindow = asyncApiQueue->window;
+    asyncApiQueue->window = window;
+    return (prevWindow);
+}
+
+/* freeAsyncApiQueue - read the outstanding replies and free the queue of
+ * conn, with the replies not taken */
+int
+freeAsyncApiQueue (rcComm_t *conn)
+{
+    asyncApiQueue_t *asyncApiQueue;
+    asyncApiReq_t *asyncApiReq;
+    int status;
+
+    if (conn == NULL || conn->asyncApi == NULL) {
+	return (0);
+    }
+    asyncApiQueue = conn->asyncApi;
+
+    status = drainAsyncApiRequests (conn);
+
+    while ((asyncApiReq = asyncApiQueue->doneHead) != NULL) {
+	asyncApiQueue->doneHead = asyncApiReq->next;
+	freeAsyncApiOut (asyncApiReq->apiInx, asyncApiReq->outStruct);
+	free (asyncApiReq);
+    }
+    free (asyncApiQueue);
+    conn->asyncApi = NULL;
+
+    return (status);
+}
+
+static asyncApiQueue_t *
+getAsyncApiQueue (rcComm_t *conn)
+{
+    asyncApiQueue_t *asyncApiQueue;
+
+    if (conn->asyncApi != NULL) {
+	return (conn->asyncApi);
+    }
+
+    asyncApiQueue = (asyncApiQueue_t *) calloc (1, sizeof (asyncApiQueue_t));
+    if (asyncApiQueue == NULL) {
+	return (NULL);
+    }
+    asyncApiQueue->window = ASYNC_API_DEF_WINDOW;
+    asyncApiQueue->nextTicket = 1;
+    conn->asyncApi = asyncApiQueue;
+
+    return (asyncApiQueue);
+}
+
+/* readAsyncApiReply - read the reply of the oldest request sent. Once a
+ * reply can not be read, the ones after it can not be either and all the
+ * requests sent finish with the error */
+static int
+readAsyncApiReply (rcComm_t *conn)
+{
+    asyncApiQueue_t *asyncApiQueue = conn->asyncApi;
+    asyncApiReq_t *asyncApiReq;
+    msgHeader_t myHeader;
+    bytesBuf_t outStructBBuf, errorBBuf;
+    msgBufPool_t *msgBufPool = NULL;
+    int status;
+
+    if (asyncApiQueue->status < 0) {
+	return (asyncApiQueue->status);
+    }
+    if ((asyncApiReq = asyncApiQueue->sentHead) == NULL) {
+	return (0);
+    }
+
+    memset (&outStructBBuf, 0, sizeof (bytesBuf_t));
+    memset (&errorBBuf, 0, sizeof (bytesBuf_t));
+
+#ifdef USE_SSL
+    if (conn->ssl_on)
+        status = sslReadMsgHeader (conn->sock, &myHeader, NULL, conn->ssl);
+    else
+#endif
+        status = readMsgHeader (conn->sock, &myHeader, NULL);
+
+    if (status >= 0) {
+#ifdef USE_SSL
+        if (conn->ssl_on)
+            status = sslReadMsgBody (conn->sock, &myHeader, &outStructBBuf,
+              NULL, &errorBBuf, conn->irodsProt, NULL, conn->ssl);
+        else
+#endif
+        {
+            if (conn->msgBufPool == NULL)
+                conn->msgBufPool = allocMsgBufPool ();
+            msgBufPool = conn->msgBufPool;
+            status = readMsgBodyWithPool (conn->sock, &myHeader,
+              &outStructBBuf, NULL, &errorBBuf, conn->irodsProt, NULL,
+              msgBufPool);
+        }
+    }
+
+    if (status < 0) {
+        rodsLogError (LOG_ERROR, status,
+          "readAsyncApiReply: read of the reply of apiNumber %d failed, status = %d",
+	  asyncApiReq->apiNumber, status);
+	asyncApiQueue->status = status;
+	while ((asyncApiReq = asyncApiQueue->sentHead) != NULL) {
+	    asyncApiQueue->sentHead = asyncApiReq->next;
+	    asyncApiQueue->numOutstanding--;
+	    asyncApiReq->next = NULL;
+	    asyncApiReq->status = status;
+	    callProcApiRequestCB (asyncApiReq->apiNumber, status,
+	      &asyncApiReq->startTime, NULL, NULL);
+	    finishAsyncApiReq (conn, asyncApiReq);
+	}
+	asyncApiQueue->sentTail = NULL;
+	return (status);
+    }
+
+    asyncApiQueue->sentHead = asyncApiReq->next;
+    if (asyncApiQueue->sentHead == NULL) {
+	asyncApiQueue->sentTail = NULL;
+    }
+    asyncApiQueue->numOutstanding--;
+    asyncApiReq->next = NULL;
+
+    freeRError (conn->rError);
+    conn->rError = NULL;
+    if (strcmp (myHeader.type, RODS_API_REPLY_T) == 0) {
+	asyncApiReq->status = procApiReply (conn, asyncApiReq->apiInx,
+	  RcApiTable[asyncApiReq->apiInx].outPackInstruct != NULL ?
+	  &asyncApiReq->outStruct : NULL, NULL, &myHeader, &outStructBBuf,
+	  NULL, &errorBBuf);
+    } else {
+	asyncApiReq->status = status;
+    }
+    releaseMsgBuf (msgBufPool, &outStructBBuf);
+    releaseMsgBuf (msgBufPool, &errorBBuf);
+
+    if (asyncApiReq->status < 0) {
+        rodsLogError (LOG_DEBUG, asyncApiReq->status,
+          "readAsyncApiReply: apiNumber %d failed. status = %d",
+	  asyncApiReq->apiNumber, asyncApiReq->status);
+    }
+    callProcApiRequestCB (asyncApiReq->apiNumber, asyncApiReq->status,
+      &asyncApiReq->startTime, NULL, NULL);
+    finishAsyncApiReq (conn, asyncApiReq);
+
+    return (0);
+}
+
+/* isAsyncApiReplyReady - whether a reply can be read without waiting for
+ * the server. Returns 1 if so, 0 if not */
+static int
+isAsyncApiReplyReady (rcComm_t *conn)
+{
+    fd_set readSet;
+    struct timeval tv;
+
+#ifdef USE_SSL
+    if (conn->ssl_on && SSL_pending (conn->ssl) > 0) {
+	return (1);
+    }
+#endif
+    FD_ZERO (&readSet);
+    FD_SET (conn->sock, &readSet);
+    tv.tv_sec = 0;
+    tv.tv_usec = 0;
+    if (select (conn->sock + 1, &readSet, NULL, NULL, &tv) > 0) {
+	return (1);
+    }
+    return (0);
+}
+
+/* finishAsyncApiReq - hand a replied request to its callback or keep it
+ * to be taken */
+static void
+finishAsyncApiReq (rcComm_t *conn, asyncApiReq_t *asyncApiReq)
+{
+    asyncApiQueue_t *asyncApiQueue = conn->asyncApi;
+
+    if (asyncApiReq->callback != NULL) {
+	asyncApiReq->callback (conn, asyncApiReq->ticket, asyncApiReq->status,
+	  asyncApiReq->outStruct, asyncApiReq->cbArg);
+	free (asyncApiReq);
+	return;
+    }
+
+    if (asyncApiQueue->doneTail == NULL) {
+	asyncApiQueue->doneHead = asyncApiReq;
+    } else {
+	asyncApiQueue->doneTail->next = asyncApiReq;
+    }
+    asyncApiQueue->doneTail = asyncApiReq;
+}
+
+/* takeAsyncApiReq - returns 1 and frees the request if ticket is replied,
+ * 0 if it is sent and not replied, an error if it is neither */
+static int
+takeAsyncApiReq (asyncApiQueue_t *asyncApiQueue, int ticket, int *apiStatus,
+void **outStruct)
+{
+    asyncApiReq_t *asyncApiReq, *prevReq;
+
+    prevReq = NULL;
+    for (asyncApiReq = asyncApiQueue->doneHead; asyncApiReq != NULL;
+      asyncApiReq = asyncApiReq->next) {
+	if (asyncApiReq->ticket == ticket) {
+	    break;
+	}
+	prevReq = asyncApiReq;
+    }
+
+    if (asyncApiReq == NULL) {
+	for (asyncApiReq = asyncApiQueue->sentHead; asyncApiReq != NULL;
+	  asyncApiReq = asyncApiReq->next) {
+	    if (asyncApiReq->ticket == ticket) {
+		return (0);
+	    }
+	}
+	if (asyncApiQueue->status < 0) {
+	    return (asyncApiQueue->status);
+	}
+        rodsLog (LOG_ERROR,
+          "takeAsyncApiReq: no request of ticket %d", ticket);
+	return (SYS_INVALID_INPUT_PARAM);
+    }
+
+    if (prevReq == NULL) {
+	asyncApiQueue->doneHead = asyncApiReq->next;
+    } else {
+	prevReq->next = asyncApiReq->next;
+    }
+    if (asyncApiQueue->doneTail == asyncApiReq) {
+	asyncApiQueue->doneTail = prevReq;
+    }
+
+    if (apiStatus != NULL) {
+	*apiStatus = asyncApiReq->status;
+    }
+    if (outStruct != NULL) {
+	*outStruct = asyncApiReq->outStruct;
+    } else {
+	freeAsyncApiOut (asyncApiReq->apiInx, asyncApiReq->outStruct);
+    }
+    free (asyncApiReq);
+
+    return (1);
+}
+
+/* freeAsyncApiOut - free an output struct nobody took, with the pointers
+ * in it */
+static void
+freeAsyncApiOut (int apiInx, void *outStruct)
+{
+    bytesBuf_t *packedResult = NULL;
+
+    if (outStruct == NULL) {
+	return;
+    }
+
+    if (RcApiTable[apiInx].outPackInstruct != NULL) {
+	packStruct (outStruct, &packedResult,
+	  RcApiTable[apiInx].outPackInstruct, RodsPackTable, FREE_POINTER,
+	  NATIVE_PROT);
+	freeBBuf (packedResult);
+    }
+    free (outStruct);
+}
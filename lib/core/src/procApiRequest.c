@@ -3,6 +3,9 @@
 
 /* procApiRequest.c - process API request
  */
+#ifndef windows_platform
+#include <sys/time.h>
+#endif
 #include "procApiRequest.h"
 #include "rcGlobalExtern.h"
 #include "rcMisc.h"
@@ -38,11 +41,19 @@ bytesBuf_t *inputBsBBuf, void **outStruct, bytesBuf_t *outBsBBuf)
 {
     int status;
     int apiInx;
+    struct timeval startTime;
 
     if (conn == NULL) {
 	return (USER__NULL_INPUT_ERR);
     }
 
+    gettimeofday (&startTime, NULL);
+
+    /* the replies of pipelined requests come first */
+    if (getNumAsyncApiRequests (conn) > 0) {
+	drainAsyncApiRequests (conn);
+    }
+
     freeRError (conn->rError);
     conn->rError = NULL;
     
@@ -57,6 +68,8 @@ bytesBuf_t *inputBsBBuf, void **outStruct, bytesBuf_t *outBsBBuf)
     if (status < 0) {
         rodsLogError (LOG_DEBUG, status,
           "procApiRequest: sendApiRequest failed. status = %d", status);
+        callProcApiRequestCB (apiNumber, status, &startTime, inputBsBBuf,
+          NULL);
         return (status);
     }
 
@@ -68,9 +81,36 @@ bytesBuf_t *inputBsBBuf, void **outStruct, bytesBuf_t *outBsBBuf)
           "procApiRequest: readAndProcApiReply failed. status = %d", status);
     }
 
+    callProcApiRequestCB (apiNumber, status, &startTime, inputBsBBuf,
+      outBsBBuf);
     return (status);
 }
 
+/* callProcApiRequestCB - report a finished request to gProcApiRequestCB.
+ * startTime is the time the request was started at */
+void
+callProcApiRequestCB (int apiNumber, int status, struct timeval *startTime,
+bytesBuf_t *inputBsBBuf, bytesBuf_t *outBsBBuf)
+{
+    struct timeval endTime;
+    rodsLong_t elapsedUsec;
+
+    if (gProcApiRequestCB == NULL) {
+        return;
+    }
+
+    gettimeofday (&endTime, NULL);
+    elapsedUsec = (rodsLong_t) (endTime.tv_sec - startTime->tv_sec) * 1000000 +
+      (endTime.tv_usec - startTime->tv_usec);
+    if (elapsedUsec < 0) {
+        elapsedUsec = 0;
+    }
+
+    gProcApiRequestCB (apiNumber, status, elapsedUsec,
+      inputBsBBuf != NULL ? inputBsBBuf->len : 0,
+      outBsBBuf != NULL && status >= 0 ? outBsBBuf->len : 0);
+}
+
 int
 branchReadAndProcApiReply (rcComm_t *conn, int apiNumber,
 void **outStruct, bytesBuf_t *outBsBBuf)
@@ -213,6 +253,7 @@ bytesBuf_t *outBsBBuf)
     msgHeader_t myHeader;
     /* bytesBuf_t outStructBBuf, errorBBuf, myOutBsBBuf; */
     bytesBuf_t outStructBBuf, errorBBuf;
+    msgBufPool_t *msgBufPool = NULL;
 
 #ifndef windows_platform
     cliChkReconnAtReadStart (conn);
@@ -299,8 +340,13 @@ bytesBuf_t *outBsBBuf)
                               &errorBBuf, conn->irodsProt, NULL, conn->ssl);
     else
 #endif
-        status = readMsgBody (conn->sock, &myHeader, &outStructBBuf, outBsBBuf,
-                              &errorBBuf, conn->irodsProt, NULL);
+    {
+        if (conn->msgBufPool == NULL)
+            conn->msgBufPool = allocMsgBufPool ();
+        msgBufPool = conn->msgBufPool;
+        status = readMsgBodyWithPool (conn->sock, &myHeader, &outStructBBuf,
+          outBsBBuf, &errorBBuf, conn->irodsProt, NULL, msgBufPool);
+    }
     if (status < 0) {
         rodsLogError (LOG_ERROR, status,
           "readAndProcApiReply: readMsgBody error. status = %d", status);
@@ -319,9 +365,10 @@ bytesBuf_t *outBsBBuf)
 	 &myHeader, &outStructBBuf, NULL, &errorBBuf); 
     }
 
-    clearBBuf (&outStructBBuf);
+    /* msgBufPool is NULL and the bufs are freed on the ssl path */
+    releaseMsgBuf (msgBufPool, &outStructBBuf);
     /* clearBBuf (&myOutBsBBuf); */
-    clearBBuf (&errorBBuf);
+    releaseMsgBuf (msgBufPool, &errorBBuf);
 
     return (status);
 }
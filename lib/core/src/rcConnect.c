@@ -268,6 +268,9 @@ rcDisconnect (rcComm_t *conn)
 	return (0);
     }
 
+    /* let the pipelined requests finish */
+    freeAsyncApiQueue (conn);
+
     /* send disconnect msg to agent */
     status = sendRodsMsg (conn->sock, RODS_DISCONNECT_T, NULL, NULL, NULL, 0,
       conn->irodsProt);
@@ -329,6 +332,11 @@ cleanRcComm (rcComm_t *conn)
         return (0);
     }
 
+    freeAsyncApiQueue (conn);
+
+    freeMsgBufPool (conn->msgBufPool);
+    conn->msgBufPool = NULL;
+
     freeRError (conn->rError);
     conn->rError = NULL;
 
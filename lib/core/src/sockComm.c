@@ -24,6 +24,7 @@ MMRESULT win_connect_timer_id;
 #endif
 
 #ifndef _WIN32
+#include <limits.h>
 
 #include <setjmp.h>
 jmp_buf Jcenv;
@@ -39,6 +40,15 @@ connToutHandler (int sig)
 }
 #endif  /* _WIN32 */
 
+static sockCommStats_t SockCommStats;
+
+/* the counters are bumped by all the connection threads of a client */
+#define SOCK_COMM_STATS_ADD(counter, value) \
+    __sync_fetch_and_add (&SockCommStats.counter, (rodsLong_t) (value))
+
+static int
+getMsgBufLen (int len);
+
 #ifdef USE_BOOST_ASIO
 
 // =-=-=-=-=-=-=-
@@ -451,6 +461,8 @@ int *bytesRead, struct timeval *tv)
 #else
         if (tv != NULL) {
             status = select (sock + 1, &set, NULL, NULL, &timeout);
+            if (irodsDescType == SOCK_TYPE)
+                SOCK_COMM_STATS_ADD (readCalls, 1);
             if (status == 0) {
                 /* timedout */
                 if (len - toRead > 0) {
@@ -468,6 +480,8 @@ int *bytesRead, struct timeval *tv)
         }
         nbytes = read (sock, (void *) tmpPtr, toRead);
 #endif
+        if (irodsDescType == SOCK_TYPE)
+            SOCK_COMM_STATS_ADD (readCalls, 1);
         if (nbytes <= 0) {
             if (errno == EINTR) {
                 /* interrupted */
@@ -510,6 +524,8 @@ int *bytesWritten)
 #else
         nbytes = write (sock, (void *) tmpPtr, toWrite);
 #endif
+        if (irodsDescType == SOCK_TYPE)
+            SOCK_COMM_STATS_ADD (writeCalls, 1);
         if (nbytes <= 0) {
 	    if (errno == EINTR) {
 		/* interrupted */
@@ -527,6 +543,56 @@ int *bytesWritten)
     return (len - toWrite);
 }
 
+#ifndef _WIN32
+/* myWritev - write the iovcnt bufs of iov to a socket with as few writev
+ * calls as the kernel takes. iov is used up by partial writes. Returns
+ * the number of bytes written */
+int
+myWritev (int sock, struct iovec *iov, int iovcnt, int *bytesWritten)
+{
+    int nbytes;
+    int written = 0;
+
+    if (bytesWritten != NULL)
+        *bytesWritten = 0;
+
+    while (iovcnt > 0) {
+	if (iov->iov_len == 0) {
+	    iov++;
+	    iovcnt--;
+	    continue;
+	}
+        nbytes = writev (sock, iov, iovcnt > IOV_MAX ? IOV_MAX : iovcnt);
+        SOCK_COMM_STATS_ADD (writeCalls, 1);
+        if (nbytes <= 0) {
+	    if (errno == EINTR) {
+		/* interrupted */
+		errno = 0;
+		continue;
+	    } else {
+                break;
+	    }
+	}
+        written += nbytes;
+	if (bytesWritten != NULL)
+	    *bytesWritten += nbytes;
+	/* skip what went out */
+	while (nbytes > 0) {
+	    if ((size_t) nbytes >= iov->iov_len) {
+		nbytes -= iov->iov_len;
+		iov++;
+		iovcnt--;
+	    } else {
+		iov->iov_base = (char *) iov->iov_base + nbytes;
+		iov->iov_len -= nbytes;
+		nbytes = 0;
+	    }
+	}
+    }
+    return (written);
+}
+#endif	/* _WIN32 */
+
 int
 readVersion (int sock, version_t **myVersion)
 {
@@ -1160,7 +1226,16 @@ irodsProt_t irodsProt)
 {
     int status;
     msgHeader_t msgHeader;
+#ifndef _WIN32
+    bytesBuf_t *headerBBuf = NULL;
+    struct iovec iov[5];
+    int iovcnt;
+    int myLen;
+    int toWrite;
+    int nbytes;
+#else
     int bytesWritten;
+#endif
 
     memset (&msgHeader, 0, sizeof (msgHeader));
 
@@ -1186,6 +1261,76 @@ irodsProt_t irodsProt)
 
     msgHeader.intInfo = intInfo;
 
+    SOCK_COMM_STATS_ADD (msgSent, 1);
+
+#ifndef _WIN32
+    /* the header and all the parts go out with one writev. The msg, error
+     * and byte stream bufs are sent from where they are */
+
+    /* always use XML_PROT for the Header */
+    status = packStruct ((void *) &msgHeader, &headerBBuf,
+      "MsgHeader_PI", RodsPackTable, 0, XML_PROT);
+
+    if (status < 0) {
+        rodsLogError (LOG_ERROR, status,
+         "sendRodsMsg: packStruct error, status = %d", status);
+        return status;
+    }
+
+    if (getRodsLogLevel () >= LOG_DEBUG3) {
+        printf ("sending header: len = %d\n%s\n", headerBBuf->len, 
+	  (char *) headerBBuf->buf);
+    }
+
+    myLen = htonl (headerBBuf->len);
+    iov[0].iov_base = (void *) &myLen;
+    iov[0].iov_len = sizeof (myLen);
+    iov[1].iov_base = headerBBuf->buf;
+    iov[1].iov_len = headerBBuf->len;
+    iovcnt = 2;
+    toWrite = sizeof (myLen) + headerBBuf->len;
+
+    if (msgHeader.msgLen > 0) {
+        if (irodsProt == XML_PROT && getRodsLogLevel () >= LOG_DEBUG3) {
+            printf ("sending msg: \n%s\n", (char *) msgBBuf->buf);
+        }
+	iov[iovcnt].iov_base = msgBBuf->buf;
+	iov[iovcnt].iov_len = msgBBuf->len;
+	iovcnt++;
+	toWrite += msgBBuf->len;
+    }
+
+    if (msgHeader.errorLen > 0) {
+        if (irodsProt == XML_PROT && getRodsLogLevel () >= LOG_DEBUG3) {
+            printf ("sending error msg: \n%s\n", (char *) errorBBuf->buf);
+        }
+	iov[iovcnt].iov_base = errorBBuf->buf;
+	iov[iovcnt].iov_len = errorBBuf->len;
+	iovcnt++;
+	toWrite += errorBBuf->len;
+    }
+
+    if (msgHeader.bsLen > 0) {
+	iov[iovcnt].iov_base = byteStreamBBuf->buf;
+	iov[iovcnt].iov_len = byteStreamBBuf->len;
+	iovcnt++;
+	toWrite += byteStreamBBuf->len;
+    }
+
+    nbytes = myWritev (sock, iov, iovcnt, NULL);
+
+    freeBBuf (headerBBuf);
+
+    if (nbytes != toWrite) {
+	status = SYS_HEADER_WRITE_LEN_ERR - errno;
+        rodsLog (LOG_ERROR,
+         "sendRodsMsg: wrote %d bytes, expect %d, status = %d",
+         nbytes, toWrite, status);
+        return (status);
+    }
+
+    return (0);
+#else	/* _WIN32 */
     status = writeMsgHeader (sock, &msgHeader);
 
     if (status < 0)
@@ -1219,6 +1364,7 @@ irodsProt_t irodsProt)
     }
 
     return (0);
+#endif	/* _WIN32 */
 }
 
 int
@@ -1238,6 +1384,20 @@ int
 readMsgBody (int sock, msgHeader_t *myHeader, bytesBuf_t *inputStructBBuf, 
 bytesBuf_t *bsBBuf, bytesBuf_t *errorBBuf, irodsProt_t irodsProt,
 struct timeval *tv)
+{
+    return (readMsgBodyWithPool (sock, myHeader, inputStructBBuf, bsBBuf,
+      errorBBuf, irodsProt, tv, NULL));
+}
+
+/* readMsgBodyWithPool - readMsgBody with the inputStructBBuf and errorBBuf
+ * bufs taken from msgBufPool. The bufs are owned by the caller who may
+ * free them or give them back with releaseMsgBuf. A NULL msgBufPool
+ * mallocs new bufs as readMsgBody.
+ */
+int
+readMsgBodyWithPool (int sock, msgHeader_t *myHeader,
+bytesBuf_t *inputStructBBuf, bytesBuf_t *bsBBuf, bytesBuf_t *errorBBuf,
+irodsProt_t irodsProt, struct timeval *tv, msgBufPool_t *msgBufPool)
 {
     int nbytes;
     int bytesRead;
@@ -1269,7 +1429,7 @@ struct timeval *tv)
             return (SYS_READ_MSG_BODY_INPUT_ERR);
         }
 
-        inputStructBBuf->buf = malloc (myHeader->msgLen);
+        inputStructBBuf->buf = getMsgBuf (msgBufPool, myHeader->msgLen);
 
         nbytes = myRead (sock, inputStructBBuf->buf, myHeader->msgLen, 
 	  SOCK_TYPE, NULL, tv);
@@ -1293,7 +1453,7 @@ struct timeval *tv)
             return (SYS_READ_MSG_BODY_INPUT_ERR);
         }
 
-        errorBBuf->buf = malloc (myHeader->errorLen);
+        errorBBuf->buf = getMsgBuf (msgBufPool, myHeader->errorLen);
 
         nbytes = myRead (sock, errorBBuf->buf, myHeader->errorLen,
 	  SOCK_TYPE, NULL, tv);
@@ -1337,6 +1497,119 @@ struct timeval *tv)
 	bsBBuf->len = myHeader->bsLen;
     }
 
+    SOCK_COMM_STATS_ADD (msgRead, 1);
+
+    return (0);
+}
+
+msgBufPool_t *
+allocMsgBufPool ()
+{
+    return ((msgBufPool_t *) calloc (1, sizeof (msgBufPool_t)));
+}
+
+int
+freeMsgBufPool (msgBufPool_t *msgBufPool)
+{
+    int i;
+
+    if (msgBufPool == NULL)
+	return (0);
+
+    for (i = 0; i < msgBufPool->numBuf; i++) {
+	free (msgBufPool->buf[i]);
+    }
+    free (msgBufPool);
+
+    return (0);
+}
+
+/* getMsgBufLen - the size of a pooled buf for len bytes */
+static int
+getMsgBufLen (int len)
+{
+    int bufLen = MIN_MSG_BUF_LEN;
+
+    while (bufLen < len) {
+	bufLen <<= 1;
+    }
+    return (bufLen);
+}
+
+/* getMsgBuf - take the smallest free buf of msgBufPool holding len bytes or
+ * malloc a new one. The buf is a plain malloc'ed buf owned by the caller */
+void *
+getMsgBuf (msgBufPool_t *msgBufPool, int len)
+{
+    void *buf;
+    int i;
+    int bestInx = -1;
+
+    if (msgBufPool == NULL || len > MAX_MSG_BUF_LEN) {
+	SOCK_COMM_STATS_ADD (bufAlloc, 1);
+	return (malloc (len));
+    }
+
+    for (i = 0; i < msgBufPool->numBuf; i++) {
+	if (msgBufPool->bufLen[i] >= len && (bestInx < 0 ||
+	  msgBufPool->bufLen[i] < msgBufPool->bufLen[bestInx])) {
+	    bestInx = i;
+	}
+    }
+
+    if (bestInx < 0) {
+	SOCK_COMM_STATS_ADD (bufAlloc, 1);
+	return (malloc (getMsgBufLen (len)));
+    }
+
+    buf = msgBufPool->buf[bestInx];
+    msgBufPool->numBuf--;
+    msgBufPool->buf[bestInx] = msgBufPool->buf[msgBufPool->numBuf];
+    msgBufPool->bufLen[bestInx] = msgBufPool->bufLen[msgBufPool->numBuf];
+    SOCK_COMM_STATS_ADD (bufReuse, 1);
+
+    return (buf);
+}
+
+/* releaseMsgBuf - give the buf of myBBuf back to msgBufPool and clear
+ * myBBuf. The buf must come from getMsgBuf with the same pool and myBBuf->len
+ * no larger than asked for. It is freed if msgBufPool is NULL or full */
+int
+releaseMsgBuf (msgBufPool_t *msgBufPool, bytesBuf_t *myBBuf)
+{
+    if (myBBuf == NULL || myBBuf->buf == NULL)
+	return (0);
+
+    if (msgBufPool == NULL || msgBufPool->numBuf >= MSG_BUF_POOL_SIZE ||
+      myBBuf->len > MAX_MSG_BUF_LEN) {
+	free (myBBuf->buf);
+    } else {
+	/* the buf is at least the power of 2 it was picked or made for */
+	msgBufPool->buf[msgBufPool->numBuf] = myBBuf->buf;
+	msgBufPool->bufLen[msgBufPool->numBuf] = getMsgBufLen (myBBuf->len);
+	msgBufPool->numBuf++;
+    }
+    memset (myBBuf, 0, sizeof (bytesBuf_t));
+
+    return (0);
+}
+
+int
+getSockCommStats (sockCommStats_t *sockCommStats)
+{
+    if (sockCommStats == NULL)
+	return (USER__NULL_INPUT_ERR);
+
+    *sockCommStats = SockCommStats;
+
+    return (0);
+}
+
+int
+resetSockCommStats ()
+{
+    memset (&SockCommStats, 0, sizeof (SockCommStats));
+
     return (0);
 }
 
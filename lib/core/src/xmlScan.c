@@ -0,0 +1,377 @@
+/*** Copyright (c), The Regents of the University of California            ***
+ *** For more information please refer to files in the COPYRIGHT directory ***/
+
+/* xmlScan.c - scanners for the chars that matter to the XML_PROT packing,
+ * the chars to escape, the entities and the tags.
+ *
+ * The scans are done 32 bytes at a time with AVX2 or 16 bytes at a time
+ * with SSE4.2 when the cpu has them, byte by byte otherwise. The
+ * instruction set is picked on first use and can be lowered with
+ * setXmlScanIsa, e.g. to compare them.
+ */
+
+#include "xmlScan.h"
+
+#ifdef XML_SCAN_SIMD
+#include <stdint.h>
+#include <immintrin.h>
+#endif
+
+static int
+initXmlScan ();
+static int
+scanXmlSetScalar (char *inStr, int len, const xmlCharSet_t *charSet);
+static int
+scanXmlSetStrScalar (char *inStr, const xmlCharSet_t *charSet);
+#ifdef XML_SCAN_SIMD
+static int
+scanXmlSetSse42 (char *inStr, int len, const xmlCharSet_t *charSet);
+static int
+scanXmlSetStrSse42 (char *inStr, const xmlCharSet_t *charSet);
+static int
+scanXmlSetAvx2 (char *inStr, int len, const xmlCharSet_t *charSet);
+static int
+scanXmlSetStrAvx2 (char *inStr, const xmlCharSet_t *charSet);
+#endif
+
+static int XmlScanIsa = -1;		/* -1 - not initialized */
+static int XmlScanMaxIsa = XML_SCAN_SCALAR;	/* what the cpu can do */
+
+/* The char sets are constant, so threads may scan with them while
+ * another one is still picking the instruction set */
+
+#define XML_SCAN_X8(c)	c, c, c, c, c, c, c, c
+#define XML_SCAN_VEC(c)	\
+    { XML_SCAN_X8 (c), XML_SCAN_X8 (c), XML_SCAN_X8 (c), XML_SCAN_X8 (c) }
+
+/* the chars strToXmlStr turns into entities */
+static const xmlCharSet_t XmlEscCharSet = {
+    5,
+    {'&', '<', '>', '"', '`'},
+    {XML_SCAN_VEC ('&'), XML_SCAN_VEC ('<'), XML_SCAN_VEC ('>'),
+      XML_SCAN_VEC ('"'), XML_SCAN_VEC ('`')},
+    {0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0,
+     0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0,
+     0, 0, 1, 0, 0, 0, 1, 0, 0, 0, 0, 0, 0, 0, 0, 0,	/* " & */
+     0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 1, 0, 1, 0,	/* < > */
+     0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0,
+     0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0,
+     1}							/* ` */
+};
+/* the start of an entity and the end of the str for xmlStrToStr */
+static const xmlCharSet_t XmlEntityCharSet = {
+    2,
+    {'&', '\0'},
+    {XML_SCAN_VEC ('&'), XML_SCAN_VEC ('\0')},
+    {1, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0,	/* \0 */
+     0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0,
+     0, 0, 0, 0, 0, 0, 1}				/* & */
+};
+/* the end of a tag value. The '\0' ends the scan of a null terminated str */
+static const xmlCharSet_t XmlTagCharSet = {
+    2,
+    {'<', '\0'},
+    {XML_SCAN_VEC ('<'), XML_SCAN_VEC ('\0')},
+    {1, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0,	/* \0 */
+     0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0,
+     0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0,
+     0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 1}		/* < */
+};
+
+/* scanXmlEscChar - return the offset of the first char of inStr to be
+ * escaped for XML_PROT, one of & < > " `. Returns len if there is none */
+int
+scanXmlEscChar (char *inStr, int len)
+{
+    if (XmlScanIsa < 0)
+	initXmlScan ();
+
+#ifdef XML_SCAN_SIMD
+    if (XmlScanIsa == XML_SCAN_AVX2) {
+	return (scanXmlSetAvx2 (inStr, len, &XmlEscCharSet));
+    } else if (XmlScanIsa == XML_SCAN_SSE42) {
+	return (scanXmlSetSse42 (inStr, len, &XmlEscCharSet));
+    }
+#endif
+    return (scanXmlSetScalar (inStr, len, &XmlEscCharSet));
+}
+
+/* scanXmlEntity - return the offset of the first '&' or '\0' in the
+ * len bytes of inStr. Returns len if there is none */
+int
+scanXmlEntity (char *inStr, int len)
+{
+    if (XmlScanIsa < 0)
+	initXmlScan ();
+
+#ifdef XML_SCAN_SIMD
+    if (XmlScanIsa == XML_SCAN_AVX2) {
+	return (scanXmlSetAvx2 (inStr, len, &XmlEntityCharSet));
+    } else if (XmlScanIsa == XML_SCAN_SSE42) {
+	return (scanXmlSetSse42 (inStr, len, &XmlEntityCharSet));
+    }
+#endif
+    return (scanXmlSetScalar (inStr, len, &XmlEntityCharSet));
+}
+
+/* scanXmlTagStart - return the offset of the first '<' in the null
+ * terminated inStr, or of the '\0' if there is none */
+int
+scanXmlTagStart (char *inStr)
+{
+    if (XmlScanIsa < 0)
+	initXmlScan ();
+
+#ifdef XML_SCAN_SIMD
+    if (XmlScanIsa == XML_SCAN_AVX2) {
+	return (scanXmlSetStrAvx2 (inStr, &XmlTagCharSet));
+    } else if (XmlScanIsa == XML_SCAN_SSE42) {
+	return (scanXmlSetStrSse42 (inStr, &XmlTagCharSet));
+    }
+#endif
+    return (scanXmlSetStrScalar (inStr, &XmlTagCharSet));
+}
+
+/* setXmlScanIsa - use the instruction set isa, or the best one below it
+ * the cpu has. returns the previous setting */
+int
+setXmlScanIsa (int isa)
+{
+    int prevIsa;
+
+    if (XmlScanIsa < 0)
+	initXmlScan ();
+
+    prevIsa = XmlScanIsa;
+    if (isa > XmlScanMaxIsa) {
+	isa = XmlScanMaxIsa;
+    } else if (isa < XML_SCAN_SCALAR) {
+	isa = XML_SCAN_SCALAR;
+    }
+    XmlScanIsa = isa;
+
+    return (prevIsa);
+}
+
+int
+getXmlScanIsa ()
+{
+    if (XmlScanIsa < 0)
+	initXmlScan ();
+
+    return (XmlScanIsa);
+}
+
+/* initXmlScan - pick the instruction set. Threads racing here all pick
+ * the same one and only write ints */
+static int
+initXmlScan ()
+{
+    int maxIsa = XML_SCAN_SCALAR;
+
+#ifdef XML_SCAN_SIMD
+    __builtin_cpu_init ();
+    if (__builtin_cpu_supports ("avx2")) {
+	maxIsa = XML_SCAN_AVX2;
+    } else if (__builtin_cpu_supports ("sse4.2")) {
+	maxIsa = XML_SCAN_SSE42;
+    }
+#endif
+    XmlScanMaxIsa = maxIsa;
+
+#ifdef XML_SCAN_SIMD
+    /* publish the max isa before the isa */
+    __sync_bool_compare_and_swap (&XmlScanIsa, -1, maxIsa);
+#else
+    XmlScanIsa = maxIsa;
+#endif
+
+    return (0);
+}
+
+static int
+scanXmlSetScalar (char *inStr, int len, const xmlCharSet_t *charSet)
+{
+    int i;
+
+    for (i = 0; i < len; i++) {
+	if (charSet->member[(unsigned char) inStr[i]])
+	    break;
+    }
+    return (i);
+}
+
+/* scanXmlSetStrScalar - the set must have the '\0' */
+static int
+scanXmlSetStrScalar (char *inStr, const xmlCharSet_t *charSet)
+{
+    int i = 0;
+
+    while (!charSet->member[(unsigned char) inStr[i]]) {
+	i++;
+    }
+    return (i);
+}
+
+#ifdef XML_SCAN_SIMD
+
+/* The Str scanners do not know where the str ends and read it in aligned
+ * blocks, which never cross into the next page. The bytes before inStr
+ * in the first block are masked off */
+
+__attribute__ ((target ("sse4.2"))) static int
+scanXmlSetSse42 (char *inStr, int len, const xmlCharSet_t *charSet)
+{
+    __m128i setVec;
+    __m128i data;
+    int inx;
+    int i = 0;
+
+    if (len < 16)
+	return (scanXmlSetScalar (inStr, len, charSet));
+
+    setVec = _mm_loadu_si128 ((const __m128i *) charSet->ch);
+    while (1) {
+	data = _mm_loadu_si128 ((const __m128i *) (inStr + i));
+	inx = _mm_cmpestri (setVec, charSet->numChar, data, 16,
+	  _SIDD_UBYTE_OPS | _SIDD_CMP_EQUAL_ANY | _SIDD_LEAST_SIGNIFICANT);
+	if (inx < 16)
+	    return (i + inx);
+	if (i + 16 >= len)
+	    return (len);
+	i += 16;
+	/* the last block overlaps the one before, which had no match */
+	if (i + 16 > len)
+	    i = len - 16;
+    }
+}
+
+__attribute__ ((target ("sse4.2"))) static int
+scanXmlSetStrSse42 (char *inStr, const xmlCharSet_t *charSet)
+{
+    __m128i setVec;
+    __m128i data;
+    char *blockPtr;
+    unsigned int mask;
+
+    setVec = _mm_loadu_si128 ((const __m128i *) charSet->ch);
+    blockPtr = (char *) ((uintptr_t) inStr & ~(uintptr_t) 15);
+    data = _mm_load_si128 ((const __m128i *) blockPtr);
+    mask = _mm_cvtsi128_si32 (_mm_cmpestrm (setVec, charSet->numChar,
+      data, 16, _SIDD_UBYTE_OPS | _SIDD_CMP_EQUAL_ANY | _SIDD_BIT_MASK));
+    mask >>= inStr - blockPtr;
+    if (mask != 0)
+	return (__builtin_ctz (mask));
+
+    while (1) {
+	blockPtr += 16;
+	data = _mm_load_si128 ((const __m128i *) blockPtr);
+	mask = _mm_cvtsi128_si32 (_mm_cmpestrm (setVec, charSet->numChar,
+	  data, 16, _SIDD_UBYTE_OPS | _SIDD_CMP_EQUAL_ANY | _SIDD_BIT_MASK));
+	if (mask != 0)
+	    return ((blockPtr - inStr) + __builtin_ctz (mask));
+    }
+}
+
+/* matchXmlSetAvx2 - the bit mask of the bytes of data in the set. Always
+ * inlined, the lib may be built without optimization */
+__attribute__ ((target ("avx2"), always_inline)) static inline unsigned int
+matchXmlSetAvx2 (__m256i data, const xmlCharSet_t *charSet)
+{
+    __m256i match;
+    int i;
+
+    match = _mm256_cmpeq_epi8 (data,
+      _mm256_loadu_si256 ((const __m256i *) charSet->chVec[0]));
+    for (i = 1; i < charSet->numChar; i++) {
+	match = _mm256_or_si256 (match, _mm256_cmpeq_epi8 (data,
+	  _mm256_loadu_si256 ((const __m256i *) charSet->chVec[i])));
+    }
+    return ((unsigned int) _mm256_movemask_epi8 (match));
+}
+
+/* matchXmlSetAvx2Half - matchXmlSetAvx2 of 16 bytes */
+__attribute__ ((target ("avx2"), always_inline)) static inline unsigned int
+matchXmlSetAvx2Half (__m128i data, const xmlCharSet_t *charSet)
+{
+    __m128i match;
+    int i;
+
+    match = _mm_cmpeq_epi8 (data,
+      _mm_loadu_si128 ((const __m128i *) charSet->chVec[0]));
+    for (i = 1; i < charSet->numChar; i++) {
+	match = _mm_or_si128 (match, _mm_cmpeq_epi8 (data,
+	  _mm_loadu_si128 ((const __m128i *) charSet->chVec[i])));
+    }
+    return ((unsigned int) _mm_movemask_epi8 (match));
+}
+
+/* The AVX2 scanners call _mm256_zeroupper before returning. The SSE code
+ * of the caller is slowed down by dirty upper halves of the ymm
+ * registers, which the compiler does not always clear */
+
+__attribute__ ((target ("avx2"))) static int
+scanXmlSetAvx2 (char *inStr, int len, const xmlCharSet_t *charSet)
+{
+    __m256i data;
+    unsigned int mask;
+    int i = 0;
+
+    if (len < 32) {
+	/* two blocks of 16, the second one overlapping the first */
+	if (len < 16)
+	    return (scanXmlSetScalar (inStr, len, charSet));
+	mask = matchXmlSetAvx2Half (
+	  _mm_loadu_si128 ((const __m128i *) inStr), charSet);
+	if (mask != 0)
+	    return (__builtin_ctz (mask));
+	mask = matchXmlSetAvx2Half (
+	  _mm_loadu_si128 ((const __m128i *) (inStr + len - 16)), charSet);
+	if (mask != 0)
+	    return (len - 16 + __builtin_ctz (mask));
+	return (len);
+    }
+
+    while (1) {
+	data = _mm256_loadu_si256 ((const __m256i *) (inStr + i));
+	mask = matchXmlSetAvx2 (data, charSet);
+	if (mask != 0) {
+	    _mm256_zeroupper ();
+	    return (i + __builtin_ctz (mask));
+	}
+	if (i + 32 >= len) {
+	    _mm256_zeroupper ();
+	    return (len);
+	}
+	i += 32;
+	/* the last block overlaps the one before, which had no match */
+	if (i + 32 > len)
+	    i = len - 32;
+    }
+}
+
+__attribute__ ((target ("avx2"))) static int
+scanXmlSetStrAvx2 (char *inStr, const xmlCharSet_t *charSet)
+{
+    __m256i data;
+    char *blockPtr;
+    unsigned int mask;
+
+    blockPtr = (char *) ((uintptr_t) inStr & ~(uintptr_t) 31);
+    data = _mm256_load_si256 ((const __m256i *) blockPtr);
+    mask = matchXmlSetAvx2 (data, charSet) >> (inStr - blockPtr);
+    if (mask != 0) {
+	_mm256_zeroupper ();
+	return (__builtin_ctz (mask));
+    }
+
+    do {
+	blockPtr += 32;
+	data = _mm256_load_si256 ((const __m256i *) blockPtr);
+	mask = matchXmlSetAvx2 (data, charSet);
+    } while (mask == 0);
+    _mm256_zeroupper ();
+    return ((blockPtr - inStr) + __builtin_ctz (mask));
+}
+
+#endif	/* XML_SCAN_SIMD */
@@ -0,0 +1,283 @@
+/*** Copyright (c), The Regents of the University of California            ***
+ *** For more information please refer to files in the COPYRIGHT directory ***/
+/* codectest.c - check that the generated native protocol codecs of
+ * packCodec.c pack and unpack the same bytes as the pack instruction
+ * interpreter of packStruct.c.
+ *
+ * For each struct with a codec, the interpreter output is compared with
+ * the codec output, and the structs unpacked by the codec and by the
+ * interpreter are packed again and compared with the original bytes.
+ */
+
+#include "rodsClient.h"
+
+typedef struct {
+    char *packInstName;
+    void *inStruct;
+} codecSample_t;
+
+int
+initSamples (codecSample_t *samples);
+int
+checkCodec (codecSample_t *sample);
+int
+sameBBuf (bytesBuf_t *bBuf1, bytesBuf_t *bBuf2);
+
+int
+main(int argc, char **argv)
+{
+    codecSample_t samples[20];
+    int numSamples;
+    int failed = 0;
+    int i;
+
+    numSamples = initSamples (samples);
+    for (i = 0; i < numSamples; i++) {
+	if (checkCodec (&samples[i]) < 0) {
+	    printf ("%-20s sample %d FAILED\n", samples[i].packInstName, i);
+	    failed++;
+	} else {
+	    printf ("%-20s sample %d ok\n", samples[i].packInstName, i);
+	}
+    }
+
+    exit (failed > 0 ? 1 : 0);
+}
+
+int
+initSamples (codecSample_t *samples)
+{
+    dataObjInp_t *dataObjInp;
+    openedDataObjInp_t *openedDataObjInp;
+    genQueryInp_t *genQueryInp;
+    genQueryOut_t *genQueryOut;
+    rodsObjStat_t *rodsObjStat;
+    collEnt_t *collEnt;
+    specColl_t *specColl;
+    int n = 0;
+    int i, j;
+
+    /* a plain open with no special collection and keywords */
+    dataObjInp = (dataObjInp_t *) calloc (1, sizeof (dataObjInp_t));
+    rstrcpy (dataObjInp->objPath, "/tempZone/home/rods/file1", MAX_NAME_LEN);
+    dataObjInp->openFlags = O_RDONLY;
+    samples[n].packInstName = "DataObjInp_PI";
+    samples[n++].inStruct = dataObjInp;
+
+    dataObjInp = (dataObjInp_t *) calloc (1, sizeof (dataObjInp_t));
+    rstrcpy (dataObjInp->objPath, "/tempZone/home/rods/mnt/file2",
+      MAX_NAME_LEN);
+    dataObjInp->createMode = 0640;
+    dataObjInp->openFlags = O_WRONLY | O_CREAT;
+    dataObjInp->offset = 4096;
+    dataObjInp->dataSize = 12345678901LL;
+    dataObjInp->numThreads = -1;
+    dataObjInp->oprType = PUT_OPR;
+    specColl = (specColl_t *) calloc (1, sizeof (specColl_t));
+    specColl->collClass = MOUNTED_COLL;
+    rstrcpy (specColl->collection, "/tempZone/home/rods/mnt", MAX_NAME_LEN);
+    rstrcpy (specColl->resource, "demoResc", NAME_LEN);
+    rstrcpy (specColl->phyPath, "/var/lib/irods/mnt", MAX_NAME_LEN);
+    specColl->replNum = 2;
+    dataObjInp->specColl = specColl;
+    addKeyVal (&dataObjInp->condInput, DEST_RESC_NAME_KW, "demoResc");
+    addKeyVal (&dataObjInp->condInput, DATA_TYPE_KW, "generic");
+    addKeyVal (&dataObjInp->condInput, FORCE_FLAG_KW, "");
+    samples[n].packInstName = "DataObjInp_PI";
+    samples[n++].inStruct = dataObjInp;
+
+    openedDataObjInp = (openedDataObjInp_t *)
+      calloc (1, sizeof (openedDataObjInp_t));
+    openedDataObjInp->l1descInx = 3;
+    openedDataObjInp->len = 65536;
+    openedDataObjInp->whence = SEEK_SET;
+    openedDataObjInp->offset = 1LL << 40;
+    openedDataObjInp->bytesWritten = 777;
+    addKeyVal (&openedDataObjInp->condInput, CHKSUM_KW, "abcdef0123456789");
+    samples[n].packInstName = "OpenedDataObjInp_PI";
+    samples[n++].inStruct = openedDataObjInp;
+
+    genQueryInp = (genQueryInp_t *) calloc (1, sizeof (genQueryInp_t));
+    genQueryInp->maxRows = MAX_SQL_ROWS;
+    genQueryInp->options = RETURN_TOTAL_ROW_COUNT;
+    addInxIval (&genQueryInp->selectInp, COL_DATA_NAME, 1);
+    addInxIval (&genQueryInp->selectInp, COL_DATA_SIZE, 1);
+    addInxIval (&genQueryInp->selectInp, COL_D_MODIFY_TIME, 1);
+    addInxVal (&genQueryInp->sqlCondInp, COL_COLL_NAME,
+      "= '/tempZone/home/rods'");
+    addInxVal (&genQueryInp->sqlCondInp, COL_DATA_NAME, "like 'f%'");
+    addKeyVal (&genQueryInp->condInput, ZONE_KW, "tempZone");
+    samples[n].packInstName = "GenQueryInp_PI";
+    samples[n++].inStruct = genQueryInp;
+
+    /* an empty query, e.g. the one closing out a statement */
+    genQueryInp = (genQueryInp_t *) calloc (1, sizeof (genQueryInp_t));
+    genQueryInp->continueInx = 5;
+    samples[n].packInstName = "GenQueryInp_PI";
+    samples[n++].inStruct = genQueryInp;
+
+    genQueryOut = (genQueryOut_t *) calloc (1, sizeof (genQueryOut_t));
+    genQueryOut->rowCnt = 17;
+    genQueryOut->attriCnt = 3;
+    genQueryOut->continueInx = 1;
+    genQueryOut->totalRowCount = 1000;
+    for (i = 0; i < genQueryOut->attriCnt; i++) {
+	genQueryOut->sqlResult[i].attriInx = COL_DATA_NAME + i;
+	genQueryOut->sqlResult[i].len = 40 + i * 8;
+	genQueryOut->sqlResult[i].value = (char *)
+	  calloc (genQueryOut->rowCnt, genQueryOut->sqlResult[i].len);
+	for (j = 0; j < genQueryOut->rowCnt; j++) {
+	    snprintf (&genQueryOut->sqlResult[i].value[j *
+	      genQueryOut->sqlResult[i].len], genQueryOut->sqlResult[i].len,
+	      "col%d row%d", i, j);
+	}
+    }
+    samples[n].packInstName = "GenQueryOut_PI";
+    samples[n++].inStruct = genQueryOut;
+
+    genQueryOut = (genQueryOut_t *) calloc (1, sizeof (genQueryOut_t));
+    samples[n].packInstName = "GenQueryOut_PI";
+    samples[n++].inStruct = genQueryOut;
+
+    rodsObjStat = (rodsObjStat_t *) calloc (1, sizeof (rodsObjStat_t));
+    rodsObjStat->objSize = 98765;
+    rodsObjStat->objType = DATA_OBJ_T;
+    rodsObjStat->dataMode = 0644;
+    rstrcpy (rodsObjStat->dataId, "10023", NAME_LEN);
+    rstrcpy (rodsObjStat->ownerName, "rods", NAME_LEN);
+    rstrcpy (rodsObjStat->ownerZone, "tempZone", NAME_LEN);
+    rstrcpy (rodsObjStat->createTime, "01300000000", TIME_LEN);
+    rstrcpy (rodsObjStat->modifyTime, "01300000001", TIME_LEN);
+    samples[n].packInstName = "RodsObjStat_PI";
+    samples[n++].inStruct = rodsObjStat;
+
+    rodsObjStat = (rodsObjStat_t *) calloc (1, sizeof (rodsObjStat_t));
+    rodsObjStat->objType = COLL_OBJ_T;
+    specColl = (specColl_t *) calloc (1, sizeof (specColl_t));
+    specColl->collClass = LINKED_COLL;
+    rstrcpy (specColl->collection, "/tempZone/home/rods/link", MAX_NAME_LEN);
+    rstrcpy (specColl->objPath, "/tempZone/home/rods/target", MAX_NAME_LEN);
+    rodsObjStat->specColl = specColl;
+    samples[n].packInstName = "RodsObjStat_PI";
+    samples[n++].inStruct = rodsObjStat;
+
+    collEnt = (collEnt_t *) calloc (1, sizeof (collEnt_t));
+    collEnt->objType = DATA_OBJ_T;
+    collEnt->replNum = 1;
+    collEnt->replStatus = 1;
+    collEnt->dataMode = 0600;
+    collEnt->dataSize = 4294967296LL;
+    collEnt->collName = "/tempZone/home/rods";
+    collEnt->dataName = "file1";
+    collEnt->dataId = "10023";
+    collEnt->createTime = "01300000000";
+    collEnt->modifyTime = "01300000001";
+    collEnt->chksum = "";
+    collEnt->resource = "demoResc";
+    collEnt->phyPath = "/var/lib/irods/Vault/home/rods/file1";
+    collEnt->ownerName = "rods";
+    /* rescGrp and dataType stay NULL */
+    collEnt->specColl.collClass = STRUCT_FILE_COLL;
+    collEnt->specColl.type = TAR_STRUCT_FILE_T;
+    rstrcpy (collEnt->specColl.cacheDir, "/tmp/cache", MAX_NAME_LEN);
+    samples[n].packInstName = "CollEnt_PI";
+    samples[n++].inStruct = collEnt;
+
+    return (n);
+}
+
+/* checkCodec - returns 0 if the codec and the interpreter agree on the
+ * sample, -1 otherwise */
+int
+checkCodec (codecSample_t *sample)
+{
+    bytesBuf_t *interpResult = NULL;
+    bytesBuf_t *codecResult = NULL;
+    bytesBuf_t *repackResult = NULL;
+    void *outStruct;
+    int status;
+    int i;
+
+    enablePackCodec (0);
+    status = packStruct (sample->inStruct, &interpResult,
+      sample->packInstName, RodsPackTable, 0, NATIVE_PROT);
+    if (status < 0) {
+	printf ("interpreter packStruct of %s error, status = %d\n",
+	  sample->packInstName, status);
+	return (-1);
+    }
+
+    enablePackCodec (1);
+    if (matchPackCodec (sample->packInstName, RodsPackTable, NATIVE_PROT)
+      == NULL) {
+	printf ("no codec for %s\n", sample->packInstName);
+	return (-1);
+    }
+    status = packStruct (sample->inStruct, &codecResult,
+      sample->packInstName, RodsPackTable, 0, NATIVE_PROT);
+    if (status < 0) {
+	printf ("codec packStruct of %s error, status = %d\n",
+	  sample->packInstName, status);
+	return (-1);
+    }
+    if (sameBBuf (interpResult, codecResult) == 0) {
+	printf ("%s: codec packed output differs from the interpreter\n",
+	  sample->packInstName);
+	return (-1);
+    }
+    freeBBuf (codecResult);
+
+    /* unpack with the codec (i == 1) and the interpreter (i == 0), then
+     * pack the result again with the interpreter */
+    for (i = 1; i >= 0; i--) {
+	enablePackCodec (i);
+	status = unpackStruct (interpResult->buf, &outStruct,
+	  sample->packInstName, RodsPackTable, NATIVE_PROT);
+	if (status < 0) {
+	    printf ("%s unpackStruct of %s error, status = %d\n",
+	      i ? "codec" : "interpreter", sample->packInstName, status);
+	    return (-1);
+	}
+	enablePackCodec (0);
+	status = packStruct (outStruct, &repackResult,
+	  sample->packInstName, RodsPackTable, 0, NATIVE_PROT);
+	if (status < 0) {
+	    printf ("repack of the %s output of %s error, status = %d\n",
+	      i ? "codec" : "interpreter", sample->packInstName, status);
+	    return (-1);
+	}
+	if (sameBBuf (interpResult, repackResult) == 0) {
+	    printf ("%s: %s unpacked struct does not pack back the same\n",
+	      sample->packInstName, i ? "codec" : "interpreter");
+	    return (-1);
+	}
+	freeBBuf (repackResult);
+	repackResult = NULL;
+	/* the pointers of outStruct were allocated with it. Free them
+	 * the way the callers do */
+	status = packStruct (outStruct, &repackResult,
+	  sample->packInstName, RodsPackTable, FREE_POINTER, NATIVE_PROT);
+	if (status < 0) {
+	    printf ("free of the %s output of %s error, status = %d\n",
+	      i ? "codec" : "interpreter", sample->packInstName, status);
+	    return (-1);
+	}
+	freeBBuf (repackResult);
+	repackResult = NULL;
+	free (outStruct);
+    }
+    enablePackCodec (1);
+
+    freeBBuf (interpResult);
+    return (0);
+}
+
+int
+sameBBuf (bytesBuf_t *bBuf1, bytesBuf_t *bBuf2)
+{
+    if (bBuf1->len != bBuf2->len)
+	return (0);
+    if (memcmp (bBuf1->buf, bBuf2->buf, bBuf1->len) != 0)
+	return (0);
+    return (1);
+}
@@ -0,0 +1,191 @@
+/*** Copyright (c), The Regents of the University of California            ***
+ *** For more information please refer to files in the COPYRIGHT directory ***/
+/* packbench.c - time packStruct/unpackStruct with and without the compiled
+ * pack instruction cache, and with the generated native codecs.
+ *
+ * packbench [iterations [rows]]
+ */
+
+#include "rodsClient.h"
+#include <sys/time.h>
+
+#define DEF_ITERATIONS	2000
+#define DEF_ROWS	256
+#define NUM_COLS	8
+#define COL_LEN		64
+
+int
+initQueryOut (genQueryOut_t *myQueryOut, int rows);
+int
+initDataObjInp (dataObjInp_t *dataObjInp);
+double
+timePackStruct (void *inStruct, char *packInstName, irodsProt_t irodsProt,
+int iterations, bytesBuf_t **packedResult);
+double
+getTime ();
+
+int
+main(int argc, char **argv)
+{
+    genQueryOut_t myQueryOut;
+    dataObjInp_t dataObjInp;
+    bytesBuf_t *textResult, *cacheResult, *codecResult;
+    irodsProt_t irodsProt;
+    double textSec, cacheSec, codecSec;
+    int iterations = DEF_ITERATIONS;
+    int rows = DEF_ROWS;
+    int status = 0;
+    int i, j;
+    void *inStruct[2];
+    char *packInstName[2] = {"GenQueryOut_PI", "DataObjInp_PI"};
+
+    if (argc > 1)
+	iterations = atoi (argv[1]);
+    if (argc > 2)
+	rows = atoi (argv[2]);
+
+    initQueryOut (&myQueryOut, rows);
+    initDataObjInp (&dataObjInp);
+    inStruct[0] = &myQueryOut;
+    inStruct[1] = &dataObjInp;
+
+    printf ("%d iterations of pack + unpack, %d rows x %d cols\n",
+      iterations, rows, NUM_COLS);
+    for (i = 0; i < 2; i++) {
+	for (j = 0; j < 2; j++) {
+	    irodsProt = j == 0 ? NATIVE_PROT : XML_PROT;
+
+	    enablePackCodec (0);
+	    enablePackInstructCache (0);
+	    textSec = timePackStruct (inStruct[i], packInstName[i], irodsProt,
+	      iterations, &textResult);
+	    enablePackInstructCache (1);
+	    cacheSec = timePackStruct (inStruct[i], packInstName[i], irodsProt,
+	      iterations, &cacheResult);
+	    if (textSec < 0 || cacheSec < 0) {
+		status = 1;
+		continue;
+	    }
+
+	    if (textResult->len != cacheResult->len ||
+	      memcmp (textResult->buf, cacheResult->buf, textResult->len) != 0) {
+		printf ("%s %s: packed output differs with the cache\n",
+		  packInstName[i], j == 0 ? "NATIVE" : "XML");
+		status = 1;
+	    }
+	    printf ("%-16s %-6s text %10.1f ops/s, cached %10.1f ops/s, %5.2fx\n",
+	      packInstName[i], j == 0 ? "NATIVE" : "XML",
+	      iterations / textSec, iterations / cacheSec, textSec / cacheSec);
+
+	    enablePackCodec (1);
+	    if (irodsProt == NATIVE_PROT) {
+		codecSec = timePackStruct (inStruct[i], packInstName[i],
+		  irodsProt, iterations, &codecResult);
+		if (codecSec < 0) {
+		    status = 1;
+		} else {
+		    if (textResult->len != codecResult->len ||
+		      memcmp (textResult->buf, codecResult->buf,
+		      textResult->len) != 0) {
+			printf ("%s NATIVE: packed output differs with the codec\n",
+			  packInstName[i]);
+			status = 1;
+		    }
+		    printf ("%-16s %-6s codec %9.1f ops/s, %5.2fx of cached\n",
+		      packInstName[i], "NATIVE", iterations / codecSec,
+		      cacheSec / codecSec);
+		    freeBBuf (codecResult);
+		}
+	    }
+	    freeBBuf (textResult);
+	    freeBBuf (cacheResult);
+	}
+    }
+
+    exit (status);
+}
+
+int
+initQueryOut (genQueryOut_t *myQueryOut, int rows)
+{
+    int i, j;
+
+    memset (myQueryOut, 0, sizeof (genQueryOut_t));
+    myQueryOut->rowCnt = rows;
+    myQueryOut->attriCnt = NUM_COLS;
+    for (i = 0; i < NUM_COLS; i++) {
+	myQueryOut->sqlResult[i].attriInx = COL_DATA_NAME + i;
+	myQueryOut->sqlResult[i].len = COL_LEN;
+	myQueryOut->sqlResult[i].value = (char *) calloc (rows, COL_LEN);
+	for (j = 0; j < rows; j++) {
+	    snprintf (&myQueryOut->sqlResult[i].value[j * COL_LEN], COL_LEN,
+	      "/tempZone/home/rods/col%d/row%06d", i, j);
+	}
+    }
+    return (0);
+}
+
+int
+initDataObjInp (dataObjInp_t *dataObjInp)
+{
+    memset (dataObjInp, 0, sizeof (dataObjInp_t));
+    rstrcpy (dataObjInp->objPath, "/tempZone/home/rods/packbench/file1",
+      MAX_NAME_LEN);
+    dataObjInp->createMode = 0644;
+    dataObjInp->openFlags = O_RDONLY;
+    dataObjInp->dataSize = 1234567890;
+    dataObjInp->numThreads = 4;
+    addKeyVal (&dataObjInp->condInput, DEST_RESC_NAME_KW, "demoResc");
+    addKeyVal (&dataObjInp->condInput, DATA_TYPE_KW, "generic");
+    addKeyVal (&dataObjInp->condInput, FORCE_FLAG_KW, "");
+    return (0);
+}
+
+/* timePackStruct - returns the sec taken by iterations of pack + unpack,
+ * -1 on error. *packedResult is the last packed output */
+double
+timePackStruct (void *inStruct, char *packInstName, irodsProt_t irodsProt,
+int iterations, bytesBuf_t **packedResult)
+{
+    double startTime;
+    void *outStruct;
+    int status;
+    int i;
+
+    *packedResult = NULL;
+    startTime = getTime ();
+    for (i = 0; i < iterations; i++) {
+	if (*packedResult != NULL)
+	    freeBBuf (*packedResult);
+	status = packStruct (inStruct, packedResult, packInstName,
+	  NULL, 0, irodsProt);
+	if (status < 0) {
+	    printf ("packStruct of %s failed, status = %d\n",
+	      packInstName, status);
+	    return (-1);
+	}
+	status = unpackStruct ((*packedResult)->buf, &outStruct,
+	  packInstName, NULL, irodsProt);
+	if (status < 0) {
+	    printf ("unpackStruct of %s failed, status = %d\n",
+	      packInstName, status);
+	    return (-1);
+	}
+	if (strcmp (packInstName, "GenQueryOut_PI") == 0) {
+	    freeGenQueryOut ((genQueryOut_t **) &outStruct);
+	} else {
+	    clearDataObjInp ((dataObjInp_t *) outStruct);
+	    free (outStruct);
+	}
+    }
+    return (getTime () - startTime);
+}
+
+double
+getTime ()
+{
+    struct timeval tv;
+
+    gettimeofday (&tv, NULL);
+    return (tv.tv_sec + tv.tv_usec / 1000000.0);
+}
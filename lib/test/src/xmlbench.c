@@ -0,0 +1,241 @@
+/*** Copyright (c), The Regents of the University of California            ***
+ *** For more information please refer to files in the COPYRIGHT directory ***/
+/* xmlbench.c - throughput of the XML_PROT escaping, unescaping and
+ * unpacking of GenQuery replies with each instruction set of xmlScan.c
+ *
+ * xmlbench [iterations [rows]]
+ */
+
+#include "rodsClient.h"
+#include "xmlScan.h"
+#include <sys/time.h>
+
+#define DEF_ITERATIONS	200
+#define DEF_ROWS	500
+#define NUM_COLS	6
+#define COL_LEN		256
+#define ESC_EVERY	16	/* one value in ESC_EVERY has chars to escape */
+
+int
+initQueryOut (genQueryOut_t *myQueryOut, int rows);
+double
+timeEscape (genQueryOut_t *myQueryOut, int iterations, rodsLong_t *bytes);
+double
+timeUnescape (genQueryOut_t *myQueryOut, int iterations, rodsLong_t *bytes);
+double
+timeUnpack (bytesBuf_t *packedBBuf, int iterations);
+double
+getTime ();
+
+int
+main(int argc, char **argv)
+{
+    genQueryOut_t myQueryOut;
+    bytesBuf_t *packedBBuf = NULL;
+    bytesBuf_t *firstBBuf = NULL;
+    double escSec, unescSec, unpackSec;
+    rodsLong_t escBytes, unescBytes;
+    int iterations = DEF_ITERATIONS;
+    int rows = DEF_ROWS;
+    int status = 0;
+    int isa;
+    char *isaName[] = {"scalar", "sse4.2", "avx2"};
+
+    if (argc > 1)
+	iterations = atoi (argv[1]);
+    if (argc > 2)
+	rows = atoi (argv[2]);
+
+    initQueryOut (&myQueryOut, rows);
+    printf ("%d iterations, GenQueryOut of %d rows x %d cols\n",
+      iterations, rows, NUM_COLS);
+
+    for (isa = XML_SCAN_SCALAR; isa <= XML_SCAN_AVX2; isa++) {
+	setXmlScanIsa (isa);
+	if (getXmlScanIsa () != isa) {
+	    printf ("%-8s not supported by the cpu\n", isaName[isa]);
+	    continue;
+	}
+
+	status = packStruct ((void *) &myQueryOut, &packedBBuf,
+	  "GenQueryOut_PI", RodsPackTable, 0, XML_PROT);
+	if (status < 0) {
+	    printf ("packStruct failed, status = %d\n", status);
+	    exit (1);
+	}
+	if (firstBBuf == NULL) {
+	    firstBBuf = packedBBuf;
+	} else {
+	    if (packedBBuf->len != firstBBuf->len ||
+	      memcmp (packedBBuf->buf, firstBBuf->buf, packedBBuf->len) != 0) {
+		printf ("%s: packed output differs with scalar\n",
+		  isaName[isa]);
+		status = 1;
+	    }
+	    freeBBuf (packedBBuf);
+	}
+
+	escSec = timeEscape (&myQueryOut, iterations, &escBytes);
+	unescSec = timeUnescape (&myQueryOut, iterations, &unescBytes);
+	unpackSec = timeUnpack (firstBBuf, iterations);
+	if (unpackSec < 0) {
+	    status = 1;
+	    continue;
+	}
+	printf ("%-8s escape %8.1f MB/s, unescape %8.1f MB/s, unpack %8.1f MB/s %8.1f ops/s\n",
+	  isaName[isa], escBytes / escSec / 1e6, unescBytes / unescSec / 1e6,
+	  (double) firstBBuf->len * iterations / unpackSec / 1e6,
+	  iterations / unpackSec);
+    }
+
+    exit (status);
+}
+
+/* initQueryOut - iRODS paths as an ils -l or a portal would get them back */
+int
+initQueryOut (genQueryOut_t *myQueryOut, int rows)
+{
+    int i, j;
+    char *value;
+
+    memset (myQueryOut, 0, sizeof (genQueryOut_t));
+    myQueryOut->rowCnt = rows;
+    myQueryOut->attriCnt = NUM_COLS;
+    for (i = 0; i < NUM_COLS; i++) {
+	myQueryOut->sqlResult[i].attriInx = COL_COLL_NAME + i;
+	myQueryOut->sqlResult[i].len = COL_LEN;
+	myQueryOut->sqlResult[i].value = (char *) calloc (rows, COL_LEN);
+	for (j = 0; j < rows; j++) {
+	    value = &myQueryOut->sqlResult[i].value[j * COL_LEN];
+	    if ((i * rows + j) % ESC_EVERY == 0) {
+		snprintf (value, COL_LEN,
+		  "/tempZone/home/rods/projects/run%04d/R&D <draft> \"%d\".dat",
+		  j, i);
+	    } else {
+		snprintf (value, COL_LEN,
+		  "/tempZone/home/rods/projects/run%04d/sample_%06d_%d.dat",
+		  j / 10, j, i);
+	    }
+	}
+    }
+    return (0);
+}
+
+/* timeEscape - returns the sec taken by strToXmlStr of all the values */
+double
+timeEscape (genQueryOut_t *myQueryOut, int iterations, rodsLong_t *bytes)
+{
+    double startTime;
+    char *value, *xmlStr;
+    int i, j, k;
+
+    *bytes = 0;
+    startTime = getTime ();
+    for (k = 0; k < iterations; k++) {
+	for (i = 0; i < myQueryOut->attriCnt; i++) {
+	    for (j = 0; j < myQueryOut->rowCnt; j++) {
+		value = &myQueryOut->sqlResult[i].value[j * COL_LEN];
+		*bytes += strToXmlStr (value, &xmlStr);
+		if (xmlStr != value)
+		    free (xmlStr);
+	    }
+	}
+    }
+    return (getTime () - startTime);
+}
+
+/* timeUnescape - returns the sec taken by xmlStrToStr of all the values
+ * escaped */
+double
+timeUnescape (genQueryOut_t *myQueryOut, int iterations, rodsLong_t *bytes)
+{
+    double startTime, totalSec = 0;
+    char *value, *xmlStr;
+    char **xmlStrs;
+    int *xmlLens;
+    char *workBuf;
+    int numStr, i, j, k;
+
+    numStr = myQueryOut->attriCnt * myQueryOut->rowCnt;
+    xmlStrs = (char **) calloc (numStr, sizeof (char *));
+    xmlLens = (int *) calloc (numStr, sizeof (int));
+    workBuf = (char *) malloc (6 * COL_LEN + 1);
+    for (i = 0; i < myQueryOut->attriCnt; i++) {
+	for (j = 0; j < myQueryOut->rowCnt; j++) {
+	    value = &myQueryOut->sqlResult[i].value[j * COL_LEN];
+	    xmlLens[i * myQueryOut->rowCnt + j] = strToXmlStr (value, &xmlStr);
+	    xmlStrs[i * myQueryOut->rowCnt + j] = strdup (xmlStr);
+	    if (xmlStr != value)
+		free (xmlStr);
+	}
+    }
+
+    /* xmlStrToStr decodes in place. The time of the copies made for it is
+     * taken off */
+    *bytes = 0;
+    startTime = getTime ();
+    for (k = 0; k < iterations; k++) {
+	for (i = 0; i < numStr; i++) {
+	    memcpy (workBuf, xmlStrs[i], xmlLens[i]);
+	    xmlStrToStr (workBuf, xmlLens[i]);
+	    *bytes += xmlLens[i];
+	}
+    }
+    totalSec = getTime () - startTime;
+    startTime = getTime ();
+    for (k = 0; k < iterations; k++) {
+	for (i = 0; i < numStr; i++) {
+	    memcpy (workBuf, xmlStrs[i], xmlLens[i]);
+	    /* keep the copy from being optimized away */
+	    __asm__ __volatile__ ("" : : "r" (workBuf) : "memory");
+	}
+    }
+    totalSec -= getTime () - startTime;
+
+    for (i = 0; i < numStr; i++) {
+	free (xmlStrs[i]);
+    }
+    free (xmlStrs);
+    free (xmlLens);
+    free (workBuf);
+    return (totalSec);
+}
+
+/* timeUnpack - returns the sec taken by unpackStruct of the reply,
+ * -1 on error. The entities are decoded in place, so each unpackStruct
+ * is given a fresh copy, as a reply read from the socket would be */
+double
+timeUnpack (bytesBuf_t *packedBBuf, int iterations)
+{
+    double startTime;
+    genQueryOut_t *outQueryOut;
+    char *workBuf;
+    int status;
+    int i;
+
+    workBuf = (char *) malloc (packedBBuf->len);
+    startTime = getTime ();
+    for (i = 0; i < iterations; i++) {
+	memcpy (workBuf, packedBBuf->buf, packedBBuf->len);
+	status = unpackStruct (workBuf, (void **) &outQueryOut,
+	  "GenQueryOut_PI", RodsPackTable, XML_PROT);
+	if (status < 0) {
+	    printf ("unpackStruct failed, status = %d\n", status);
+	    free (workBuf);
+	    return (-1);
+	}
+	freeGenQueryOut (&outQueryOut);
+    }
+    startTime = getTime () - startTime;
+    free (workBuf);
+    return (startTime);
+}
+
+double
+getTime ()
+{
+    struct timeval tv;
+
+    gettimeofday (&tv, NULL);
+    return (tv.tv_sec + tv.tv_usec / 1000000.0);
+}
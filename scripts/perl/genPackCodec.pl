@@ -0,0 +1,745 @@
+#!/usr/bin/perl
+#
+# Copyright (c), The Regents of the University of California            ***
+# For more information please refer to files in the COPYRIGHT directory ***
+#
+# This perl script generates lib/core/src/packCodec.c, the NATIVE_PROT
+# pack and unpack routines of the most used structs, from their pack
+# instructions in rodsPackInstruct.h.  It is run by gmake when the pack
+# instructions or the pack tables are updated.
+#
+# Each routine does what packStruct/unpackStruct do with the interpreter:
+# the same alignment of the C struct, the same packed bytes and the same
+# layout of the unpacked struct.  The pack instruction is resolved here
+# instead of at each call: names of structs against RodsPackTable and then
+# ApiPackTable, dimensions against the int items before them and then
+# PackConstantTable.
+#
+# Usage: genPackCodec.pl [buildDir]
+#
+
+use strict;
+
+# the structs with a codec. a struct that needs what the generator does not
+# handle (?, % and # items, null terminated str in a struct, arrays of
+# pointers to int and double) makes it stop with an error
+my @HotStructs = (
+    "DataObjInp_PI",
+    "OpenedDataObjInp_PI",
+    "GenQueryInp_PI",
+    "GenQueryOut_PI",
+    "RodsObjStat_PI",
+    "CollEnt_PI",
+);
+
+my $buildDir = defined ($ARGV[0]) ? $ARGV[0] : "..";
+my $coreIncDir = "$buildDir/lib/core/include";
+my $apiIncDir = "$buildDir/lib/api/include";
+my $outFile = "$buildDir/lib/core/src/packCodec.c";
+
+my %TypeSize = (
+    "char" => 1, "bin" => 1, "str" => 1, "piStr" => 1,
+    "int" => 4, "int16" => 2, "double" => 8, "struct" => 0,
+);
+
+my %PiDefines = readPiDefines ("$coreIncDir/rodsPackInstruct.h",
+  glob ("$apiIncDir/*.h"));
+my %RodsPackTable = readTable ("$coreIncDir/rodsPackTable.h",
+  "RodsPackTable");
+my %ApiPackTable = readTable ("$apiIncDir/apiPackTable.h", "ApiPackTable");
+my %PackConstants = readTable ("$coreIncDir/rodsPackTable.h",
+  "PackConstantTable");
+
+# state of the routine being generated
+my @Lines;
+my %Decls;
+my $VarCnt;
+my %DepNames;
+
+my $out = "";
+my @entries;
+
+foreach my $piName (@HotStructs) {
+    my $suffix = $piName;
+    $suffix =~ s/_PI$//;
+    $suffix = ucfirst ($suffix);
+
+    %DepNames = ();
+    collectDepNames ($piName, {});
+
+    $out .= genRoutine ($piName, "packCodec$suffix", 1);
+    $out .= genRoutine ($piName, "unpackCodec$suffix", 0);
+    push (@entries, "    {\"$piName\", packCodec$suffix, unpackCodec$suffix},\n");
+}
+
+open (FileOut, ">$outFile.tmp") || die ("Can't open output file $outFile.tmp");
+print FileOut <<'EOF';
+/*** Copyright (c), The Regents of the University of California            ***
+ *** For more information please refer to files in the COPYRIGHT directory ***/
+
+/* packCodec.c - NATIVE_PROT pack and unpack routines of the most used
+ * structs, called by packStruct and unpackStruct instead of interpreting
+ * the pack instruction.
+ *
+ * Generated by scripts/perl/genPackCodec.pl from rodsPackInstruct.h.
+ * Do not edit, edit the pack instruction or the script.
+ */
+
+#include "packStruct.h"
+#include "rodsLog.h"
+#include "rcGlobalExtern.h"
+#include "rcMisc.h"
+#include "rodsGenQuery.h"
+#include "apiHeaderAll.h"
+
+/* the alignment of items in a C struct as alignInt, alignDouble and
+ * ialignAddr do it */
+#define CODEC_ALIGN(ptr, boundary) \
+  ((void *) (((size_t) (ptr) + (boundary) - 1) & ~((size_t) (boundary) - 1)))
+
+#if defined(osx_platform) || (defined(solaris_platform) && defined(i86_hardware))
+#define CODEC_ALIGN_DOUBLE	4	/* osx does not align */
+#elif (defined(linux_platform) || defined(windows_platform)) && !defined(ADDR_64BITS)
+#define CODEC_ALIGN_DOUBLE	4
+#else
+#define CODEC_ALIGN_DOUBLE	8
+#endif
+
+#ifdef ADDR_64BITS
+#define CODEC_ALIGN_POINTER	8
+#else
+#define CODEC_ALIGN_POINTER	4
+#endif
+
+/* solaris on sparc aligns a struct with a double to 64 bit, which is
+ * left to the interpreter */
+#if !defined(solaris_platform) || defined(i86_hardware)
+
+EOF
+print FileOut $out;
+print FileOut "#endif\t/* solaris on sparc */\n\n";
+print FileOut "packCodec_t PackCodecTable[] = {\n";
+print FileOut "#if !defined(solaris_platform) || defined(i86_hardware)\n";
+print FileOut @entries;
+print FileOut "#endif\n";
+print FileOut "    {PACK_TABLE_END_PI, NULL, NULL},\n";
+print FileOut "};\n";
+close (FileOut);
+rename ("$outFile.tmp", $outFile) || die ("Can't rename $outFile.tmp");
+exit (0);
+
+# readPiDefines - the #define NAME "pack instruction" of the files
+sub readPiDefines
+{
+    my %defines;
+
+    foreach my $file (@_) {
+	open (FileIn, $file) || die ("Can't open input file $file");
+	while (my $line = <FileIn>) {
+	    if ($line =~ /^\s*#\s*define\s+(\w+)\s+"(.*)"/) {
+		$defines{$1} = $2 if (!exists ($defines{$1}));
+	    }
+	}
+	close (FileIn);
+    }
+    return (%defines);
+}
+
+# readTable - the {"name", value} entries of a table. entries inside
+# #if are left out, they may not be there at run time
+sub readTable
+{
+    my ($file, $table) = @_;
+    my %entries;
+    my $inTable = 0;
+    my $ifDepth = 0;
+
+    open (FileIn, $file) || die ("Can't open input file $file");
+    while (my $line = <FileIn>) {
+	if (!$inTable) {
+	    $inTable = 1 if ($line =~ /\b$table\s*\[\s*\]\s*=/);
+	    next;
+	}
+	last if ($line =~ /^\s*\}\s*;/);
+	if ($line =~ /^\s*#\s*if/) {
+	    $ifDepth++;
+	} elsif ($line =~ /^\s*#\s*endif/) {
+	    $ifDepth--;
+	} elsif ($ifDepth == 0 && $line =~ /\{\s*"([^"]+)"\s*,\s*([^}]+?)\s*\}/) {
+	    $entries{$1} = $2 if (!exists ($entries{$1}));
+	}
+    }
+    close (FileIn);
+    die ("$table not found in $file") if (!$inTable);
+    return (%entries);
+}
+
+# matchPi - the pack instruction of a struct name, as matchPackInstruct
+# with RodsPackTable as the user table
+sub matchPi
+{
+    my ($name) = @_;
+    my $macro;
+
+    if (exists ($RodsPackTable{$name})) {
+	$macro = $RodsPackTable{$name};
+    } elsif (exists ($ApiPackTable{$name})) {
+	$macro = $ApiPackTable{$name};
+    } else {
+	die ("$name is not in RodsPackTable or ApiPackTable\n");
+    }
+    die ("$macro of $name is not a pack instruction\n")
+      if (!exists ($PiDefines{$macro}));
+    return ($PiDefines{$macro});
+}
+
+# parsePi - the items of a pack instruction
+sub parsePi
+{
+    my ($piName) = @_;
+    my $pi = matchPi ($piName);
+    my @items;
+
+    foreach my $stmt (split (/;/, $pi)) {
+	next if ($stmt =~ /^\s*$/);
+	$stmt =~ s/^\s+//;
+	$stmt =~ s/\s+$//;
+	if ($stmt !~ /^(\w+)\s*([*\$#]?)\s*(\w+)((?:\[\w+\])*)((?:\(\w+\))*)$/) {
+	    die ("$piName: cannot generate \"$stmt\"\n");
+	}
+	my %item = (type => $1, name => $3, stmt => $stmt);
+	my ($ptr, $dims, $hints) = ($2, $4, $5);
+
+	die ("$piName: unknown type in \"$stmt\"\n")
+	  if (!exists ($TypeSize{$item{type}}));
+	$item{pointer} = $ptr eq "" ? 0 : $ptr eq "*" ? 1 : $ptr eq "\$" ? 2 : 3;
+	die ("$piName: # pointer in \"$stmt\"\n") if ($item{pointer} == 3);
+	$item{dims} = [$dims =~ /\[(\w+)\]/g];
+	$item{hints} = [$hints =~ /\((\w+)\)/g];
+	if ($item{pointer} == 0) {
+	    die ("$piName: hint dimension of a non pointer in \"$stmt\"\n")
+	      if (@{$item{hints}} > 0);
+	    die ("$piName: null terminated str in \"$stmt\"\n")
+	      if (($item{type} eq "str" || $item{type} eq "piStr") &&
+	      @{$item{dims}} == 0);
+	} elsif (@{$item{dims}} > 0 && $item{type} ne "str" &&
+	  $item{type} ne "piStr" && $item{type} ne "struct") {
+	    die ("$piName: array of pointers to $item{type} in \"$stmt\"\n");
+	}
+	push (@items, \%item);
+    }
+    return (@items);
+}
+
+# collectDepNames - names used as dimensions anywhere in the struct. only
+# int items of these names keep their values
+sub collectDepNames
+{
+    my ($piName, $seen) = @_;
+
+    die ("$piName contains itself\n") if ($seen->{$piName});
+    $seen->{$piName} = 1;
+    foreach my $item (parsePi ($piName)) {
+	foreach my $dim (@{$item->{dims}}, @{$item->{hints}}) {
+	    $DepNames{$dim} = 1 if ($dim !~ /^\d+$/);
+	}
+	collectDepNames ($item->{name}, $seen) if ($item->{type} eq "struct");
+    }
+    delete ($seen->{$piName});
+}
+
+# resolveDim - the C expression of a dimension, as resolveIntInItem. the
+# scope is a list of [name, expression] of the int items before, the
+# nearest last
+sub resolveDim
+{
+    my ($dim, $scope, $stmt) = @_;
+
+    return ($dim) if ($dim =~ /^\d+$/);
+    foreach my $entry (reverse (@$scope)) {
+	return ($entry->[1]) if ($entry->[0] eq $dim);
+    }
+    return ($PackConstants{$dim}) if (exists ($PackConstants{$dim}));
+    die ("cannot resolve $dim in \"$stmt\"\n");
+}
+
+sub product
+{
+    my (@factors) = @_;
+
+    return ("1") if (@factors == 0);
+    return ($factors[0]) if (@factors == 1);
+    return ("(" . join (") * (", @factors) . ")");
+}
+
+sub newVar
+{
+    my ($type, $prefix) = @_;
+    my $var = $prefix . $VarCnt++;
+
+    $Decls{$type}{$var} = 1;
+    return ($var);
+}
+
+sub emit
+{
+    my ($depth, $line) = @_;
+    my $indent = " " x (4 * $depth);
+
+    $indent =~ s/        /\t/g;
+    push (@Lines, $indent . $line);
+}
+
+sub emitReturnOnError
+{
+    my ($depth, $fmt, @args) = @_;
+
+    $Decls{"int"}{"status"} = 1;
+    emit ($depth, "if (status < 0) {");
+    emit ($depth + 1, "rodsLog (LOG_ERROR,");
+    emit ($depth + 1, "  " . join (", ", "\"$fmt\"", @args) . ");");
+    emit ($depth + 1, "return (status);");
+    emit ($depth, "}");
+}
+
+sub genRoutine
+{
+    my ($piName, $funcName, $isPack) = @_;
+    my $text;
+
+    @Lines = ();
+    %Decls = ();
+    $VarCnt = 1;
+
+    if ($isPack) {
+	$Decls{"void *"}{"inPtr = inStruct"} = 1;
+	genPackStruct ($piName, "inPtr", [], 1);
+	$text = "static int\n$funcName (void *inStruct, " .
+	  "packedOutput_t *packedOutput,\nint packFlag)\n{\n";
+    } else {
+	$Decls{"void *"}{"inPtr = inPackedStr"} = 1;
+	genUnpackStruct ($piName, "unpackedOutput", [], 1);
+	$text = "static int\n$funcName (void *inPackedStr, " .
+	  "packedOutput_t *unpackedOutput)\n{\n";
+    }
+
+    foreach my $type (sort (keys (%Decls))) {
+	foreach my $var (sort (keys (%{$Decls{$type}}))) {
+	    $text .= "    $type" . ($type =~ /\*$/ ? "" : " ") . "$var;\n";
+	}
+    }
+    $text .= "\n" . join ("\n", @Lines) . "\n\n    return (0);\n}\n\n";
+    return ($text);
+}
+
+# genPackStruct - pack one struct at the pointer in $ptr, as
+# packChildStruct does for one element
+sub genPackStruct
+{
+    my ($piName, $ptr, $scope, $depth) = @_;
+    my @scope = @$scope;
+
+    foreach my $item (parsePi ($piName)) {
+	my $stmt = $item->{stmt};
+	my $type = $item->{type};
+	my @dims = map { resolveDim ($_, \@scope, $stmt) } @{$item->{dims}};
+	my @hints = map { resolveDim ($_, \@scope, $stmt) } @{$item->{hints}};
+
+	emit ($depth, "/* $stmt */");
+	if ($item->{pointer} > 0) {
+	    genPackPointer ($item, $ptr, \@scope, $depth, \@dims, \@hints);
+	    push (@scope, [$item->{name}, "0"]) if ($type eq "int");
+	    next;
+	}
+
+	my $numElement = product (@dims);
+	if ($type eq "int" || $type eq "int16" || $type eq "double") {
+	    my $call;
+	    if ($type eq "int") {
+		emit ($depth, "$ptr = CODEC_ALIGN ($ptr, 4);");
+		$call = "codecPackInt";
+	    } elsif ($type eq "int16") {
+		emit ($depth, "$ptr = CODEC_ALIGN ($ptr, 2);");
+		$call = "codecPackInt16";
+	    } else {
+		emit ($depth, "$ptr = CODEC_ALIGN ($ptr, CODEC_ALIGN_DOUBLE);");
+		$call = "codecPackDouble";
+	    }
+	    $call .= " (&$ptr, packedOutput, $numElement);";
+	    if ($type eq "int" && $DepNames{$item->{name}}) {
+		my $var = newVar ("int", "intValue");
+		emit ($depth, "$var = $call");
+		push (@scope, [$item->{name}, $var]);
+	    } else {
+		emit ($depth, $call);
+		push (@scope, [$item->{name}, "0"]) if ($type eq "int");
+	    }
+	} elsif ($type eq "char" || $type eq "bin") {
+	    emit ($depth, "packChar (&$ptr, packedOutput, $numElement, NULL, " .
+	      "NATIVE_PROT);");
+	} elsif ($type eq "str" || $type eq "piStr") {
+	    my $maxStrLen = $dims[$#dims];
+	    my $d = $depth;
+	    if (@dims > 1) {
+		my $i = newVar ("int", "i");
+		emit ($depth, "for ($i = 0; $i < " . product (@dims[0..$#dims-1]) .
+		  "; $i++) {");
+		$d++;
+	    }
+	    emit ($d, "status = packNatString (&$ptr, packedOutput, " .
+	      "$maxStrLen, NULL);");
+	    emitReturnOnError ($d,
+	      "packCodec: strlen of $item->{name} > dim size %d, content: %s",
+	      $maxStrLen, "(char *) $ptr");
+	    emit ($depth, "}") if (@dims > 1);
+	} else {
+	    genPackStructArray ($item->{name}, $ptr, \@scope, $depth,
+	      $numElement);
+	}
+    }
+}
+
+# genPackStructArray - pack numElement structs, each of the items of the
+# struct find the items of the parent before them
+sub genPackStructArray
+{
+    my ($piName, $ptr, $scope, $depth, $numElement) = @_;
+
+    if ($numElement eq "1") {
+	genPackStruct ($piName, $ptr, $scope, $depth);
+    } else {
+	my $i = newVar ("int", "i");
+	emit ($depth, "for ($i = 0; $i < $numElement; $i++) {");
+	genPackStruct ($piName, $ptr, $scope, $depth + 1);
+	emit ($depth, "}");
+    }
+}
+
+# genPackPointer - as packPointerItem
+sub genPackPointer
+{
+    my ($item, $ptr, $scope, $depth, $dims, $hints) = @_;
+    my $type = $item->{type};
+    my $freeIt = $item->{pointer} == 1;
+    my $pointer = newVar ("void *", "pointer");
+    my $elemPtr = newVar ("void *", "elemPtr");
+    my ($numElement, $numPointer, $maxStrLen, $numStr);
+    my $d;
+
+    emit ($depth, "$ptr = CODEC_ALIGN ($ptr, CODEC_ALIGN_POINTER);");
+    emit ($depth, "$pointer = *(void **) $ptr;");
+    emit ($depth, "$ptr = (char *) $ptr + sizeof (void *);");
+    emit ($depth, "if ($pointer == NULL) {");
+    emit ($depth + 1, "packNullString (packedOutput);");
+    emit ($depth, "} else {");
+    $d = $depth + 1;
+
+    $numElement = product (@$hints);
+    if ($numElement ne "1") {
+	my $var = newVar ("int", "numElement");
+	emit ($d, "$var = $numElement;");
+	$numElement = $var;
+    }
+    if (@$dims > 0) {
+	$numPointer = newVar ("int", "numPointer");
+	emit ($d, "$numPointer = " . product (@$dims) . ";");
+    }
+
+    if ($type eq "str" || $type eq "piStr") {
+	if (@$hints == 0) {
+	    $maxStrLen = "-1";
+	    $numStr = "1";
+	} else {
+	    $maxStrLen = newVar ("int", "maxStrLen");
+	    emit ($d, "$maxStrLen = $hints->[$#$hints];");
+	    emit ($d, "if ($numElement > 0 && $maxStrLen > 0) {");
+	    $d++;
+	    if (@$hints > 1) {
+		$numStr = newVar ("int", "numStr");
+		emit ($d, "$numStr = $numElement / $maxStrLen;");
+	    } else {
+		$numStr = "1";
+	    }
+	}
+    }
+
+    if (@$dims > 0) {
+	my $j = newVar ("int", "j");
+	emit ($d, "for ($j = 0; $j < $numPointer; $j++) {");
+	emit ($d + 1, "$elemPtr = ((void **) $pointer)[$j];");
+	genPackElement ($item, $elemPtr, $scope, $d + 1, $numElement,
+	  $maxStrLen, $numStr);
+	emit ($d + 1, "if (packFlag & FREE_POINTER) {") if ($freeIt);
+	emit ($d + 2, "free (((void **) $pointer)[$j]);") if ($freeIt);
+	emit ($d + 1, "}") if ($freeIt);
+	emit ($d, "}");
+	if ($freeIt) {
+	    emit ($d, "if ((packFlag & FREE_POINTER) && $numPointer > 0) {");
+	    emit ($d + 1, "/* Array of pointers */");
+	    emit ($d + 1, "free ($pointer);");
+	    emit ($d, "}");
+	}
+    } else {
+	emit ($d, "$elemPtr = $pointer;");
+	genPackElement ($item, $elemPtr, $scope, $d, $numElement,
+	  $maxStrLen, $numStr);
+	if ($freeIt) {
+	    emit ($d, "if (packFlag & FREE_POINTER) {");
+	    emit ($d + 1, "free ($pointer);");
+	    emit ($d, "}");
+	}
+    }
+
+    if (($type eq "str" || $type eq "piStr") && @$hints > 0) {
+	$d--;
+	emit ($d, "}");
+    }
+    emit ($depth, "}");
+}
+
+# genPackElement - pack what one pointer of an item points to
+sub genPackElement
+{
+    my ($item, $ptr, $scope, $depth, $numElement, $maxStrLen, $numStr) = @_;
+    my $type = $item->{type};
+
+    if ($type eq "str" || $type eq "piStr") {
+	my $d = $depth;
+	if ($numStr ne "1") {
+	    my $i = newVar ("int", "i");
+	    emit ($depth, "for ($i = 0; $i < $numStr; $i++) {");
+	    $d++;
+	}
+	emit ($d, "status = packNatString (&$ptr, packedOutput, " .
+	  "$maxStrLen, NULL);");
+	emitReturnOnError ($d,
+	  "packCodec: strlen of $item->{name} > dim size, content: %s",
+	  "(char *) $ptr");
+	emit ($depth, "}") if ($numStr ne "1");
+    } elsif ($type eq "int") {
+	emit ($depth, "codecPackInt (&$ptr, packedOutput, $numElement);");
+    } elsif ($type eq "int16") {
+	emit ($depth, "codecPackInt16 (&$ptr, packedOutput, $numElement);");
+    } elsif ($type eq "double") {
+	emit ($depth, "codecPackDouble (&$ptr, packedOutput, $numElement);");
+    } elsif ($type eq "char" || $type eq "bin") {
+	emit ($depth, "packChar (&$ptr, packedOutput, $numElement, NULL, " .
+	  "NATIVE_PROT);");
+    } else {
+	genPackStructArray ($item->{name}, $ptr, $scope, $depth, $numElement);
+    }
+}
+
+# genUnpackStruct - unpack one struct into $out, as unpackChildStruct
+# does for one element
+sub genUnpackStruct
+{
+    my ($piName, $out, $scope, $depth) = @_;
+    my @scope = @$scope;
+
+    foreach my $item (parsePi ($piName)) {
+	my $stmt = $item->{stmt};
+	my $type = $item->{type};
+	my @dims = map { resolveDim ($_, \@scope, $stmt) } @{$item->{dims}};
+	my @hints = map { resolveDim ($_, \@scope, $stmt) } @{$item->{hints}};
+
+	emit ($depth, "/* $stmt */");
+	if ($item->{pointer} > 0) {
+	    genUnpackPointer ($item, $out, \@scope, $depth, \@dims, \@hints);
+	    push (@scope, [$item->{name}, "0"]) if ($type eq "int");
+	    next;
+	}
+
+	my $numElement = product (@dims);
+	if ($type eq "int" || $type eq "int16" || $type eq "double") {
+	    my $call = $type eq "int" ? "codecUnpackInt" :
+	      $type eq "int16" ? "codecUnpackInt16" : "codecUnpackDouble";
+	    $call .= " (&inPtr, $out, $numElement);";
+	    if ($type eq "int" && $DepNames{$item->{name}}) {
+		my $var = newVar ("int", "intValue");
+		emit ($depth, "$var = $call");
+		push (@scope, [$item->{name}, $var]);
+	    } else {
+		emit ($depth, $call);
+		push (@scope, [$item->{name}, "0"]) if ($type eq "int");
+	    }
+	} elsif ($type eq "char" || $type eq "bin") {
+	    emit ($depth, "unpackChar (&inPtr, $out, $numElement, NULL, " .
+	      "NATIVE_PROT);");
+	} elsif ($type eq "str" || $type eq "piStr") {
+	    my $maxStrLen = $dims[$#dims];
+	    my $d = $depth;
+	    $Decls{"char *"}{"outStr"} = 1;
+	    if (@dims > 1) {
+		my $i = newVar ("int", "i");
+		emit ($depth, "for ($i = 0; $i < " . product (@dims[0..$#dims-1]) .
+		  "; $i++) {");
+		$d++;
+	    }
+	    emit ($d, "status = unpackNatString (&inPtr, $out, $maxStrLen, " .
+	      "&outStr);");
+	    emitReturnOnError ($d,
+	      "unpackCodec: strlen of $item->{name} > dim size, content: %s",
+	      "(char *) inPtr");
+	    emit ($depth, "}") if (@dims > 1);
+	} else {
+	    genUnpackStructArray ($item->{name}, $out, \@scope, $depth,
+	      $numElement);
+	}
+    }
+}
+
+sub genUnpackStructArray
+{
+    my ($piName, $out, $scope, $depth, $numElement) = @_;
+
+    if ($numElement eq "1") {
+	genUnpackStruct ($piName, $out, $scope, $depth);
+    } else {
+	my $i = newVar ("int", "i");
+	emit ($depth, "for ($i = 0; $i < $numElement; $i++) {");
+	genUnpackStruct ($piName, $out, $scope, $depth + 1);
+	emit ($depth, "}");
+    }
+}
+
+# genUnpackPointer - as unpackNullString and unpackPointerItem
+sub genUnpackPointer
+{
+    my ($item, $out, $scope, $depth, $dims, $hints) = @_;
+    my $type = $item->{type};
+    my $numElement = product (@$hints);
+    my ($numPointer, $pointerArray, $maxStrLen, $numStr);
+    my $d = $depth + 1;
+
+    emit ($depth, "if (codecUnpackNullString (&inPtr, $out) > 0) {");
+    if ($numElement ne "1") {
+	my $var = newVar ("int", "numElement");
+	emit ($d, "$var = $numElement;");
+	$numElement = $var;
+    }
+    if (@$dims > 0) {
+	$numPointer = newVar ("int", "numPointer");
+	emit ($d, "$numPointer = " . product (@$dims) . ";");
+    }
+
+    my $cond = $numElement eq "1" ? "" : "$numElement <= 0";
+    $cond .= ($cond eq "" ? "" : " || ") . "$numPointer <= 0" if (@$dims > 0);
+    if ($cond ne "") {
+	emit ($d, "if ($cond) {");
+	emit ($d + 1, "/* a null pointer */");
+	emit ($d + 1, "addPointerToPackedOut ($out, 0, NULL);");
+	emit ($d, "} else {");
+	$d++;
+    }
+
+    if (@$dims > 0) {
+	$pointerArray = newVar ("void **", "pointerArray");
+	emit ($d, "$pointerArray = (void **) addPointerToPackedOut ($out,");
+	emit ($d, "  codecPtrArrayLen ($numPointer) * sizeof (void *), NULL);");
+    }
+
+    if ($type eq "str" || $type eq "piStr") {
+	my $len = newVar ("int", "allocLen");
+	my $outPtr = newVar ("void *", "outPtr");
+	my $e = $d;
+	my $j;
+
+	if (@$hints == 0) {
+	    $maxStrLen = "-1";
+	    $numStr = "1";
+	} else {
+	    $maxStrLen = newVar ("int", "maxStrLen");
+	    emit ($d, "$maxStrLen = $hints->[$#$hints];");
+	    if (@$hints > 1) {
+		$numStr = newVar ("int", "numStr");
+		emit ($d, "$numStr = $maxStrLen <= 0 ? 0 : " .
+		  "$numElement / $maxStrLen;");
+	    } else {
+		$numStr = "1";
+	    }
+	    emit ($d, "if ($maxStrLen == 0) {");
+	    emit ($d + 1, "addPointerToPackedOut ($out, 0, NULL);");
+	    emit ($d, "} else {");
+	    $e++;
+	}
+	if (@$dims > 0) {
+	    $j = newVar ("int", "j");
+	    emit ($e, "for ($j = 0; $j < $numPointer; $j++) {");
+	    $e++;
+	}
+	emit ($e, "$len = codecAllocLenForStr (inPtr, $numStr, $maxStrLen);");
+	emit ($e, "if ($len < 0) {");
+	emit ($e + 1, "rodsLog (LOG_ERROR,");
+	emit ($e + 1, "  \"unpackCodec: maxStrLen < 0 with numStr > 1 for " .
+	  "$item->{name}\");");
+	emit ($e + 1, "return ($len);");
+	emit ($e, "}");
+	if (@$dims > 0) {
+	    emit ($e, "$outPtr = $pointerArray\[$j\] = malloc ($len);");
+	} else {
+	    emit ($e, "$outPtr = addPointerToPackedOut ($out, $len, NULL);");
+	}
+	my $f = $e;
+	if ($numStr ne "1") {
+	    my $i = newVar ("int", "i");
+	    emit ($e, "for ($i = 0; $i < $numStr; $i++) {");
+	    $f++;
+	}
+	emit ($f, "status = unpackNatStringToOutPtr (&inPtr, &$outPtr, " .
+	  "$maxStrLen);");
+	$Decls{"int"}{"status"} = 1;
+	emit ($f, "if (status < 0) {");
+	emit ($f + 1, "return (status);");
+	emit ($f, "}");
+	emit ($e, "}") if ($numStr ne "1");
+	if (@$dims > 0) {
+	    $e--;
+	    emit ($e, "}");
+	}
+	emit ($d, "}") if (@$hints > 0);
+    } elsif ($type eq "struct") {
+	my $subOut = newVar ("packedOutput_t", "subOutput");
+	my $outPtr = newVar ("void *", "outPtr");
+	my $e = $d;
+	my $j;
+
+	if (@$dims > 0) {
+	    $j = newVar ("int", "j");
+	    emit ($e, "for ($j = 0; $j < $numPointer; $j++) {");
+	    $e++;
+	}
+	emit ($e, "$outPtr = malloc ($numElement * SUB_STRUCT_ALLOC_SZ);");
+	emit ($e, "initPackedOutputWithBuf (&$subOut, $outPtr, " .
+	  "$numElement * SUB_STRUCT_ALLOC_SZ);");
+	genUnpackStructArray ($item->{name}, "&$subOut", $scope, $e,
+	  $numElement);
+	if (@$dims > 0) {
+	    emit ($e, "$pointerArray\[$j\] = $subOut.bBuf->buf;");
+	} else {
+	    emit ($e, "addPointerToPackedOut ($out, " .
+	      "$numElement * SUB_STRUCT_ALLOC_SZ,");
+	    emit ($e, "  $subOut.bBuf->buf);");
+	}
+	emit ($e, "free ($subOut.bBuf);");
+	emit ($d, "}") if (@$dims > 0);
+    } else {
+	my $outPtr = newVar ("void *", "outPtr");
+	my $size = $TypeSize{$type};
+
+	emit ($d, "$outPtr = addPointerToPackedOut ($out, " .
+	  "$numElement * $size, NULL);");
+	if ($type eq "int") {
+	    emit ($d, "unpackNatIntToOutPtr (&inPtr, &$outPtr, $numElement);");
+	} elsif ($type eq "int16") {
+	    emit ($d, "unpackNatInt16ToOutPtr (&inPtr, &$outPtr, $numElement);");
+	} elsif ($type eq "double") {
+	    emit ($d, "unpackNatDoubleToOutPtr (&inPtr, &$outPtr, $numElement);");
+	} else {
+	    emit ($d, "unpackNatCharToOutPtr (&inPtr, &$outPtr, $numElement);");
+	}
+    }
+
+    emit ($depth + 1, "}") if ($cond ne "");
+    emit ($depth, "}");
+}
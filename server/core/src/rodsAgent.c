@@ -191,6 +191,9 @@ agentMain (rsComm_t *rsComm)
         }
 #endif
 
+	/* one request at a time. Requests pipelined by the client
+	 * (procApiAsync.c) wait in the socket behind it and are served
+	 * in the order they were sent, as the client expects */
 	status = readAndProcClientMsg (rsComm, READ_HEADER_TIMEOUT);
 #if 0
 	status = readAndProcClientMsg (rsComm, 0);
@@ -208,6 +211,8 @@ agentMain (rsComm_t *rsComm)
 	    }
 	}
     }
+    freeMsgBufPool (rsComm->msgBufPool);
+    rsComm->msgBufPool = NULL;
     return (status);
 }
 
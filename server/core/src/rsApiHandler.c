@@ -491,6 +491,7 @@ readAndProcClientMsg (rsComm_t *rsComm, int flags)
     int status = 0;
     msgHeader_t myHeader;
     bytesBuf_t inputStructBBuf, bsBBuf, errorBBuf;
+    msgBufPool_t *msgBufPool = NULL;
 
 //#ifndef windows_platform
     svrChkReconnAtReadStart (rsComm);
@@ -622,8 +623,14 @@ readAndProcClientMsg (rsComm_t *rsComm, int flags)
                               &bsBBuf, &errorBBuf, rsComm->irodsProt, NULL, rsComm->ssl);
     else
 #endif
-        status = readMsgBody (rsComm->sock, &myHeader, &inputStructBBuf,
-                              &bsBBuf, &errorBBuf, rsComm->irodsProt, NULL);
+    {
+        if (rsComm->msgBufPool == NULL)
+            rsComm->msgBufPool = allocMsgBufPool ();
+        msgBufPool = rsComm->msgBufPool;
+        status = readMsgBodyWithPool (rsComm->sock, &myHeader,
+          &inputStructBBuf, &bsBBuf, &errorBBuf, rsComm->irodsProt, NULL,
+          msgBufPool);
+    }
     if (status < 0) {
         rodsLog (LOG_NOTICE,
           "agentMain: readMsgBody error. status = %d", status);
@@ -647,9 +654,10 @@ readAndProcClientMsg (rsComm_t *rsComm, int flags)
 	snprintf (tmpStr, NAME_LEN, "handle API %d", myHeader.intInfo);
         printSysTiming ("irodsAgent", tmpStr, 0);
 #endif
-        clearBBuf (&inputStructBBuf);
+        /* msgBufPool is NULL and the bufs are freed on the ssl path */
+        releaseMsgBuf (msgBufPool, &inputStructBBuf);
         clearBBuf (&bsBBuf);
-        clearBBuf (&errorBBuf);
+        releaseMsgBuf (msgBufPool, &errorBBuf);
 	if ((flags & RET_API_STATUS) != 0) {
 	    return (status);
 	} else {